@@ -0,0 +1,136 @@
+/* bathcluster: cluster a profile library by redundancy.
+ *
+ * Groups the models of <hmmfile> into clusters of near-duplicates
+ * (see p7_hmmcluster.c) and saves the cluster map, by default to
+ * <hmmfile>.bclust, where bathsearch --clusters finds it. bathsearch
+ * then screens the target database once per cluster, with the
+ * cluster's representative, instead of once per model.
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type          default   env  range      toggles reqs  incomp  help                                                     docgroup*/
+  { "-h",           eslARG_NONE,    FALSE,  NULL, NULL,      NULL,  NULL,  NULL,  "show brief help on version and usage",                          1 },
+  { "-o",           eslARG_OUTFILE,  NULL,  NULL, NULL,      NULL,  NULL,  NULL,  "save cluster map to file <f>, not <hmmfile>.bclust",            1 },
+  { "--thresh",     eslARG_REAL,    "0.5",  NULL, "0<x<=1",  NULL,  NULL,  NULL,  "link models sharing at least this fraction of consensus words", 1 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+
+static char usage[]  = "[-options] <hmmfile>";
+static char banner[] = "cluster a profile library for bathsearch --clusters";
+
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go       = NULL;
+  char           *hmmfile  = NULL;
+  char           *mapfile  = NULL;
+  P7_HMMFILE     *hfp      = NULL;
+  ESL_ALPHABET   *abc      = NULL;
+  P7_HMM        **hmm      = NULL;
+  P7_HMMCLUSTERS *hc       = NULL;
+  FILE           *ofp      = NULL;
+  int             nhmm     = 0;
+  int             nalloc   = 256;
+  int             nmulti   = 0;    /* clusters of more than one model   */
+  int             nmembers = 0;    /* models in such clusters           */
+  char            errbuf[eslERRBUFSIZE];
+  int             i, c;
+  int             status;
+
+  /* Process command line */
+  go = esl_getopts_Create(options);
+  if (esl_opt_ProcessCmdline(go, argc, argv) != eslOK ||
+      esl_opt_VerifyConfig(go)               != eslOK)
+    {
+      printf("Failed to parse command line: %s\n", go->errbuf);
+      esl_usage(stdout, argv[0], usage);
+      printf("\nTo see more help on available options, do %s -h\n\n", argv[0]);
+      exit(1);
+    }
+  if (esl_opt_GetBoolean(go, "-h") == TRUE)
+    {
+      p7_banner(stdout, argv[0], banner);
+      esl_usage(stdout, argv[0], usage);
+      puts("\nOptions:");
+      esl_opt_DisplayHelp(stdout, go, 1, 2, 80);
+      exit(0);
+    }
+  if (esl_opt_ArgNumber(go) != 1)
+    {
+      puts("Incorrect number of command line arguments.");
+      esl_usage(stdout, argv[0], usage);
+      printf("\nTo see more help on available options, do %s -h\n\n", argv[0]);
+      exit(1);
+    }
+  hmmfile = esl_opt_GetArg(go, 1);
+  if (strcmp(hmmfile, "-") == 0 && ! esl_opt_IsOn(go, "-o"))
+    p7_Fail("Reading <hmmfile> from stdin, so the cluster map needs a name: use -o\n");
+
+  /* Read the whole library */
+  status = p7_hmmfile_OpenE(hmmfile, NULL, &hfp, errbuf);
+  if      (status == eslENOTFOUND) p7_Fail("File existence/permissions problem in trying to open HMM file %s.\n%s\n", hmmfile, errbuf);
+  else if (status == eslEFORMAT)   p7_Fail("File format problem in trying to open HMM file %s.\n%s\n",                hmmfile, errbuf);
+  else if (status != eslOK)        p7_Fail("Unexpected error %d in opening HMM file %s.\n%s\n",               status, hmmfile, errbuf);
+
+  ESL_ALLOC(hmm, sizeof(P7_HMM *) * nalloc);
+  while ((status = p7_hmmfile_Read(hfp, &abc, &(hmm[nhmm]))) == eslOK)
+    {
+      if (hmm[nhmm]->max_length == -1) p7_Builder_MaxLength(hmm[nhmm], p7_DEFAULT_WINDOW_BETA);
+      if (++nhmm == nalloc) {
+        ESL_REALLOC(hmm, sizeof(P7_HMM *) * nalloc * 2);
+        nalloc *= 2;
+      }
+    }
+  if      (status == eslEOD)       p7_Fail("read failed, HMM file %s may be truncated?", hmmfile);
+  else if (status == eslEFORMAT)   p7_Fail("bad file format in HMM file %s",             hmmfile);
+  else if (status == eslEINCOMPAT) p7_Fail("HMM file %s contains different alphabets",   hmmfile);
+  else if (status != eslEOF)       p7_Fail("Unexpected error in reading HMMs from %s",   hmmfile);
+  if (nhmm == 0)                   p7_Fail("HMM file %s is empty", hmmfile);
+
+  /* Cluster */
+  status = p7_hmmclusters_Build(hmm, nhmm, esl_opt_GetReal(go, "--thresh"), &hc);
+  if      (status == eslEDUP) p7_Fail("HMM file %s has two models with the same name; cluster maps need unique names\n", hmmfile);
+  else if (status != eslOK)   goto ERROR;
+
+  /* Save the map */
+  if (esl_opt_IsOn(go, "-o")) { if ((status = esl_strdup(esl_opt_GetString(go, "-o"), -1, &mapfile)) != eslOK) goto ERROR; }
+  else                        { if ((status = esl_sprintf(&mapfile, "%s.bclust", hmmfile))            != eslOK) goto ERROR; }
+  if ((ofp = fopen(mapfile, "w")) == NULL) p7_Fail("Failed to open cluster map %s for writing\n", mapfile);
+  if (fprintf(ofp, "# bathcluster %s: consensus word linkage >= %g\n", hmmfile, esl_opt_GetReal(go, "--thresh")) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "cluster map write failed");
+  if ((status = p7_hmmclusters_Write(ofp, hc)) != eslOK) goto ERROR;
+
+  for (c = 0; c < hc->nclust; c++)
+    if (hc->size[c] > 1) { nmulti++; nmembers += hc->size[c]; }
+
+  printf("# models:                 %d\n", hc->nmodel);
+  printf("# clusters:               %d\n", hc->nclust);
+  printf("# multi-model clusters:   %d  (%d models)\n", nmulti, nmembers);
+  printf("# database screens saved: %d  (%.3g)\n", hc->nmodel - hc->nclust, (double) (hc->nmodel - hc->nclust) / (double) hc->nmodel);
+  printf("# cluster map saved to:   %s\n", mapfile);
+
+  fclose(ofp);
+  free(mapfile);
+  p7_hmmclusters_Destroy(hc);
+  for (i = 0; i < nhmm; i++) p7_hmm_Destroy(hmm[i]);
+  free(hmm);
+  p7_hmmfile_Close(hfp);
+  esl_alphabet_Destroy(abc);
+  esl_getopts_Destroy(go);
+  exit(0);
+
+ ERROR:
+  p7_Fail("bathcluster failed (%d)\n", status);
+  exit(1);
+}
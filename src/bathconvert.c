@@ -120,6 +120,7 @@ main(int argc, char **argv)
   if      (status == eslENOTFOUND) p7_Fail("File existence/permissions problem in trying to open HMM file %s.\n%s\n", hmmfile_in, errbuf);
   else if (status == eslEFORMAT)   p7_Fail("File format problem in trying to open HMM file %s.\n%s\n",                hmmfile_in, errbuf);
   else if (status != eslOK)        p7_Fail("Unexpected error %d in opening HMM file %s.\n%s\n",                       status, hmmfile_in, errbuf);  
+  if (p7_hmmfile_SetParallel(hfp, 0) != eslOK) p7_Fail("Failed to map HMM file %s for parallel parsing\n", hmmfile_in);
 
   ofp = fopen(hmmfile_out, "w");
   if (ofp == NULL) p7_Fail("Failed to open HMM file %s for writing", hmmfile_out);
@@ -181,6 +181,8 @@ create_ssi_index(ESL_GETOPTS *go, P7_HMMFILE *hfp)
   if (esl_newssi_AddFile(ns, hfp->fname, 0, &fh) != eslOK) /* 0 = format code (HMMs don't have any yet) */
     esl_fatal("Failed to add HMM file %s to new SSI index\n", hfp->fname);
 
+  if (p7_hmmfile_SetParallel(hfp, 0) != eslOK) p7_Fail("Failed to map HMM file %s for parallel parsing\n", hfp->fname);
+
   printf("Working...    "); 
   fflush(stdout);
   
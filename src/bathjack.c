@@ -0,0 +1,925 @@
+/* bathjack: iteratively search a protein sequence against a DNA sequence database.
+ *
+ * Each query sequence is turned into a profile (as bathsearch does for
+ * a single sequence), the profile is searched against the translated
+ * target database, and a new profile is built from the query and the
+ * hits that meet the inclusion thresholds; then again, until no new
+ * hits are included or -N rounds have been done.
+ *
+ * Only the first round, and every --rescan'th after it, scans the
+ * whole database. Such a full scan keeps every target window in which
+ * some ORF passed the Viterbi filter; the rounds in between search
+ * only those windows, and report E-values as for a full scan.
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+#include "esl_keyhash.h"
+#include "esl_msa.h"
+#include "esl_msafile.h"
+#include "esl_sq.h"
+#include "esl_sqio.h"
+#include "esl_stopwatch.h"
+#include "esl_gencode.h"
+
+#include "hmmer.h"
+
+/* set the max residue count to 1/4 meg when reading a block */
+#define BATH_MAX_RESIDUE_COUNT (1024 * 256)  /* 1/4 Mb */
+
+#define BLOCK_SIZE 1000
+
+typedef struct {
+  P7_BG            *bg;	         /* null model                                                        */
+  P7_PIPELINE      *pli;         /* work pipeline                                                     */
+  P7_TOPHITS       *th;          /* top hit results                                                   */
+  P7_OPROFILE      *om;          /* optimized query profile                                           */
+  P7_PROFILE       *gm;		 /* non-optimized query profile                                       */
+  P7_FS_PROFILE    *gm_fs;       /* non optimized frameshift query profile                            */
+  P7_SCOREDATA     *scoredata;   /* used to create DNA windows from ORFs                              */
+  ESL_GENCODE      *gcode;       /* used for translating ORFs                                         */
+  ESL_GENCODE_WORKSTATE *wrk1;   /* used for intitial translation of taget DNA to ORFs                */
+  ESL_GENCODE_WORKSTATE *wrk2;   /* used for secondary translation of DNA window for bias calcultaion */
+} WORKER_INFO;
+
+/* items used to keep track ot orignal taget lengths */
+typedef struct {
+  int    id;         /* internal sequence ID  */
+  int    length;     /* length of sequence */
+} ID_LENGTH;
+
+typedef struct {
+  ID_LENGTH  *id_lengths;
+  int        count;
+  int        size;
+} ID_LENGTH_LIST;
+
+static ID_LENGTH_LIST* init_id_length( int size );
+static void            destroy_id_length( ID_LENGTH_LIST *list );
+static int             add_id_length(ID_LENGTH_LIST *list, int id, int L);
+static int             assign_Lengths(P7_TOPHITS *th, ID_LENGTH_LIST *id_length_list);
+
+/* Target windows carried between rounds.
+ * A full scan keeps a copy of every window in which some ORF passed
+ * the Viterbi filter, and what the full scan counted (residues,
+ * sequences, target lengths). The rounds until the next full scan
+ * search only these windows, and get the full scan's counts for their
+ * E-values and summary. A window in which no ORF passes Viterbi in one
+ * of those rounds is dropped, and not searched again until the next
+ * full scan.
+ */
+typedef struct {
+  ESL_SQ         **win;            /* copies of target windows that passed Viterbi       */
+  int              nwin;
+  int              nalloc;
+  uint64_t         nres;           /* residues in the last full scan                     */
+  uint64_t         nseqs;          /* target sequences in the last full scan             */
+  ID_LENGTH_LIST  *id_length_list; /* full length of every target                        */
+} WINCACHE;
+
+static WINCACHE *wincache_Create (void);
+static int       wincache_Reuse  (WINCACHE *wc);
+static int       wincache_Add    (WINCACHE *wc, const ESL_SQ *sq);
+static void      wincache_Destroy(WINCACHE *wc);
+
+#define REPOPTS     "-E,-T"
+#define DOMREPOPTS  "--domE,--domT"
+#define INCOPTS     "--incE,--incT"
+#define INCDOMOPTS  "--incdomE,--incdomT"
+
+static ESL_OPTIONS options[] = {
+  /* name             type            default    env          range      toggles reqs  incomp          help                                                                        docgroup*/
+  { "-h",             eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "show brief help on version and usage",                                     1 },
+  { "-N",             eslARG_INT,     "5",       NULL,       "n>=1",     NULL,   NULL, NULL,           "set maximum number of iterations to <n>",                                  1 },
+  { "--rescan",       eslARG_INT,     "3",       NULL,       "n>=0",     NULL,   NULL, NULL,           "scan the whole target db every <n> rounds (0: first round only)",          1 },
+  /* Control of output */
+  { "-o",             eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "direct output to file <f>, not stdout",                                    2 },
+  { "-A",             eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "save multiple alignment of hits from last round to file <f>",              2 },
+  { "--tblout",       eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "save parseable table of hits from last round to file <f>",                 2 },
+  { "--fstblout",     eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "save table of frameshift locations from last round to file <f>",           2 },
+  { "--chkhmm",       eslARG_STRING,  NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "save HMM checkpoints to files <s>-<iteration>.hmm",                        2 },
+  { "--acc",          eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "prefer accessions over names in output",                                   2 },
+  { "--noali",        eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "don't output alignments, so output is smaller",                            2 },
+  { "--notrans",      eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "don't show the translated DNA sequence in  alignment",                     2 },
+  { "--frameline",    eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "include frame of each codon in  alignment",                                2 },
+  { "--cigar",        eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,"--tblout", NULL,        "include alignment CIGAR string in table output (with --tblout)",           2 },
+  { "--notextw",      eslARG_NONE,    NULL,      NULL,        NULL,      NULL,   NULL,"--textw",       "unlimit ASCII text output line width",                                     2 },
+  { "--textw",        eslARG_INT,    "150",      NULL,       "n>=150",   NULL,   NULL,"--notextw",     "set max width of ASCII text output lines",                                 2 },
+  /* Control of scoring system */
+  { "--popen",        eslARG_REAL,   "0.02",     NULL,       "0<=x<0.5", NULL,   NULL, NULL,           "gap open probability",                                                     3 },
+  { "--pextend",      eslARG_REAL,   "0.4",      NULL,       "0<=x<1",   NULL,   NULL, NULL,           "gap extend probability",                                                   3 },
+  { "--mx",           eslARG_STRING, "BLOSUM62", NULL,        NULL,      NULL,   NULL,"--mxfile",      "substitution score matrix choice (of some built-in matrices)",             3 },
+  { "--mxfile",       eslARG_INFILE,  NULL,      NULL,        NULL,      NULL,   NULL,"--mx",          "read substitution score matrix from file <f>",                             3 },
+  /* Control of reporting and inclusion thresholds */
+  { "-E",             eslARG_REAL,   "10.0",     NULL,       "x>0",      NULL,   NULL, REPOPTS,        "report sequences <= this E-value threshold in output",                     4 },
+  { "-T",             eslARG_REAL,    FALSE,     NULL,        NULL,      NULL,   NULL, REPOPTS,        "report sequences >= this score threshold in output",                       4 },
+  { "--incE",         eslARG_REAL,   "0.001",    NULL,       "x>0",      NULL,   NULL, INCOPTS,        "consider sequences <= this E-value threshold as significant",              4 },
+  { "--incT",         eslARG_REAL,    FALSE,     NULL,        NULL,      NULL,   NULL, INCOPTS,        "consider sequences >= this score threshold as significant",                4 },
+  /* input formats */
+  { "--qformat",      eslARG_STRING,  NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "assert query <seqfile> is in format <s>: no autodetection",                5 },
+  { "--tformat",      eslARG_STRING,  NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "assert target <seqdb> is in format <s>: no autodetection",                 5 },
+  /* Control of acceleration pipeline */
+  { "--max",          eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"--F1,--F2,--F3","turn all heuristic filters off (less speed, more power)",                  7 },
+  { "--F1",           eslARG_REAL,   "0.02",     NULL,        NULL,      NULL,   NULL,"--max",         "stage 1 (MSV) threshold: promote hits w/ P <= F1",                         7 },
+  { "--F2",           eslARG_REAL,   "1e-3",     NULL,        NULL,      NULL,   NULL,"--max",         "stage 2 (Vit) threshold: promote hits w/ P <= F2",                         7 },
+  { "--F3",           eslARG_REAL,   "1e-5",     NULL,        NULL,      NULL,   NULL,"--max",         "stage 3 (Fwd) threshold: promote hits w/ P <= F3",                         7 },
+  { "--nobias",       eslARG_NONE,    NULL,      NULL,        NULL,      NULL,   NULL,"--max",         "turn off composition bias filter",                                         7 },
+  { "--nonull2",      eslARG_NONE,    NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "turn off biased composition score corrections",                            7 },
+  { "--fsonly",       eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"--nofs",        "send all potential hits to the frameshift aware pipeline",                 7 },
+  { "--nofs",         eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"--fsonly",      "send all potential hits to the non-frameshift aware pipeline",             7 },
+  { "--tmask",        eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "mask low-complexity target DNA (dust) and translations (SEG)",             7 },
+  /* Other options */
+  { "-Z",             eslARG_REAL,    FALSE,     NULL,       "x>=0",     NULL,   NULL, NULL,           "set database size (Megabases) to <x> for E-value calculations",            12 },
+  { "--seed",         eslARG_INT,    "42",       NULL,       "n>=0",     NULL,   NULL, NULL,           "set RNG seed to <n> (if 0: one-time arbitrary seed)",                      12 },
+  { "--w_beta",       eslARG_REAL,    NULL,      NULL,       "0>=x<=1",  NULL,   NULL, NULL,           "tail mass at which window length is determined",                           12 },
+  { "--w_length",     eslARG_INT,     NULL,      NULL,       "x>=4",      NULL,   NULL, NULL,           "window length - essentially max expected hit length" ,                     12 },
+  { "--block_length", eslARG_INT,     NULL,      NULL,       "n>=50000", NULL,   NULL, NULL,           "length of blocks read from target database",                               12 },
+  { "--perfctr",      eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "report hardware performance counters per pipeline stage",                  12 },
+#ifdef HMMER_THREADS
+  { "--fwd_cpu",      eslARG_INT,       "0",     NULL,       "n>=0",     NULL,   NULL, NULL,           "threads for Forward on very large frameshift envelopes (0,1: no split)",   12 },
+#endif
+  /* Translation options */
+  { "--ct",           eslARG_INT,    "1",        NULL,        NULL,      NULL,   NULL, NULL,           "use alt genetic code of NCBI translation table (see end of help)",         15 },
+  { "-l",             eslARG_INT,    "20",       NULL,        NULL,      NULL,   NULL, NULL,           "minimum ORF length",                                                       15 },
+  { "-m",             eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"-M",            "ORFs must initiate with AUG only",                                         15 },
+  { "-M",             eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"-m",            "ORFs must start with allowed initiation codon",                            15 },
+  { "--strand",       eslARG_STRING, "both",     NULL,        NULL,      NULL,   NULL, NULL,           "translate only forward strand 'plus' or reverse complement strand 'minus'",15 },
+
+  /* stage-specific window length used for bias composition estimate,
+   * hidden because they are confusing/expert options. May drag them out
+   * into the daylight eventually
+   */
+  { "--B1",           eslARG_INT,    "110",      NULL,        NULL,      NULL,  NULL,"--max,--nobias", "window length for biased-composition modifier (SSV)",                      99 },
+  { "--B2",           eslARG_INT,    "240",      NULL,        NULL,      NULL,  NULL,"--max,--nobias", "window length for biased-composition modifier (Vit)",                      99 },
+  { "--B3",           eslARG_INT,    "1000",     NULL,        NULL,      NULL,  NULL,"--max,--nobias", "window length for biased-composition modifier (Fwd)",                      99 },
+
+  /* Not used, but retained because esl option-handling code errors if it isn't kept here.  Placed in group 99 so that it doesn't print to help*/
+  { "--domZ",         eslARG_REAL,    FALSE,     NULL,       "x>0",      NULL,  NULL, NULL,            "Not used",                                                                 99 },
+  { "--domE",         eslARG_REAL,   "10.0",     NULL,       "x>0",      NULL,  NULL, DOMREPOPTS,      "Not used",                                                                 99 },
+  { "--domT",         eslARG_REAL,    FALSE,     NULL,        NULL,      NULL,  NULL, DOMREPOPTS,      "Not used",                                                                 99 },
+  { "--incdomE",      eslARG_REAL,   "0.001",    NULL,       "x>0",      NULL,  NULL, INCDOMOPTS,      "Not used",                                                                 99 },
+  { "--incdomT",      eslARG_REAL,    FALSE,     NULL,        NULL,      NULL,  NULL, INCDOMOPTS,      "Not used",                                                                 99 },
+  { "--crick",        eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,  NULL, NULL,            "only translate top strand",                                                99 },
+  { "--watson",       eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,  NULL, NULL,            "only translate bottom strand",                                             99 },
+  { "--fs",           eslARG_REAL,   "0.01",     NULL,       "0<=x<=1",  NULL,  NULL, NULL,            "set the frameshift probabilty",                                            99 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+
+static char usage[]  = "[options] <query seqfile> <seqdb>";
+static char banner[] = "iteratively search a protein sequence against a DNA sequence database";
+
+static int  serial_master(ESL_GETOPTS *go, char *queryfile, char *dbfile);
+static int  full_scan    (WORKER_INFO *info, ESL_SQFILE *dbfp, WINCACHE *wc);
+static int  cached_scan  (WORKER_INFO *info, WINCACHE *wc);
+static int  search_window(WORKER_INFO *info, ESL_SQ *dbsq_dna);
+static int  count_new_included(const P7_TOPHITS *th, ESL_KEYHASH **kh);
+
+static int
+process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_queryfile, char **ret_seqfile)
+{
+  ESL_GETOPTS *go = esl_getopts_Create(options);
+  int          status;
+
+  if (esl_opt_ProcessEnvironment(go)         != eslOK)  { if (printf("Failed to process environment: %s\n", go->errbuf) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+  if (esl_opt_ProcessCmdline(go, argc, argv) != eslOK)  { if (printf("Failed to parse command line: %s\n",  go->errbuf) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+  if (esl_opt_VerifyConfig(go)               != eslOK)  { if (printf("Failed to parse command line: %s\n",  go->errbuf) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+
+  /* help format: */
+  if (esl_opt_GetBoolean(go, "-h") == TRUE)
+    {
+      p7_banner(stdout, argv[0], banner);
+      esl_usage(stdout, argv[0], usage);
+      if (puts("\nBasic options:")                                           < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 1, 2, 100); /* 1= group; 2 = indentation; 100=textwidth*/
+
+      if (puts("\nOptions directing output:")                                < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 2, 2, 100);
+
+      if (puts("\nOptions controlling translation:")                         < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 15, 2, 100);
+
+      if (puts("\nOptions controlling scoring system in first iteration:")  < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 3, 2, 100);
+
+      if (puts("\nOptions controlling reporting and inclusion thresholds:")  < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 4, 2, 100);
+
+      if (puts("\nOptions controlling acceleration heuristics:")             < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 7, 2, 100);
+
+      if (puts("\nOptions setting input formats:")                           < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 5, 2, 100);
+
+      if (puts("\nOther expert options:")                                    < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_opt_DisplayHelp(stdout, go, 12, 2, 100);
+
+      if (puts("\nAvailable NCBI genetic code tables (for --ct <id>):")      < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+      esl_gencode_DumpAltCodeTable(stdout);
+
+      exit(0);
+    }
+
+  if (esl_opt_ArgNumber(go)                    != 2)     { if (puts("Incorrect number of command line arguments.")          < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+  if ((*ret_queryfile = esl_opt_GetArg(go, 1)) == NULL)  { if (puts("Failed to get <query seqfile> argument on command line") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+  if ((*ret_seqfile   = esl_opt_GetArg(go, 2)) == NULL)  { if (puts("Failed to get <seqdb> argument on command line")       < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+
+  /* Every round after a full scan reads the target database again, so it can't be a stream */
+  if (strcmp(*ret_seqfile, "-") == 0)
+    { if (puts("<seqdb> is read more than once, so it can't be read from stdin.") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+
+  *ret_go = go;
+  return eslOK;
+
+ FAILURE:  /* all errors handled here are user errors, so be polite.  */
+  esl_usage(stdout, argv[0], usage);
+  if (puts("\nwhere most common options are:")                                 < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+  esl_opt_DisplayHelp(stdout, go, 1, 2, 80); /* 1= group; 2 = indentation; 80=textwidth*/
+  if (printf("\nTo see more help on available options, do %s -h\n\n", argv[0]) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed");
+  esl_getopts_Destroy(go);
+  exit(1);
+
+ ERROR:
+  if (go) esl_getopts_Destroy(go);
+  exit(status);
+}
+
+static int
+output_header(FILE *ofp, const ESL_GETOPTS *go, char *queryfile, char *seqfile)
+{
+  p7_banner(ofp, go->argv[0], banner);
+
+  if (                                                         fprintf(ofp, "# query sequence file:                           %s\n", queryfile)                                        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (                                                         fprintf(ofp, "# target sequence database:                      %s\n", seqfile)                                          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (                                                         fprintf(ofp, "# frameshift probability:                        %f\n", esl_opt_GetReal(go, "--fs"))                      < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (                                                         fprintf(ofp, "# codon translation table:                       %d\n", esl_opt_GetInteger(go, "--ct"))                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "-N")                              && fprintf(ofp, "# maximum iterations set to:                     %d\n",      esl_opt_GetInteger(go, "-N"))                < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--rescan")                        && fprintf(ofp, "# full target db scan every:                     %d rounds\n", esl_opt_GetInteger(go, "--rescan"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "-o")                              && fprintf(ofp, "# output directed to file:                       %s\n",      esl_opt_GetString(go, "-o"))                 < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "-A")                              && fprintf(ofp, "# MSA of hits saved to file:                     %s\n",      esl_opt_GetString(go, "-A"))                 < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--tblout")                        && fprintf(ofp, "# per-seq hits tabular output:                   %s\n",      esl_opt_GetString(go, "--tblout"))           < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--fstblout")                      && fprintf(ofp, "# frameshift tabular output:                     %s\n",      esl_opt_GetString(go, "--fstblout"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--chkhmm")                        && fprintf(ofp, "# HMM checkpoint files output:                   %s-<n>.hmm\n", esl_opt_GetString(go, "--chkhmm"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--acc")                           && fprintf(ofp, "# prefer accessions over names:                  yes\n")                                                  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--noali")                         && fprintf(ofp, "# show alignments in output:                     no\n")                                                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--notextw")                       && fprintf(ofp, "# max ASCII text line length:                    unlimited\n")                                            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--textw")                         && fprintf(ofp, "# max ASCII text line length:                    %d\n",      esl_opt_GetInteger(go, "--textw"))           < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--popen")                         && fprintf(ofp, "# gap open probability:                          %f\n",      esl_opt_GetReal   (go, "--popen"))           < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--pextend")                       && fprintf(ofp, "# gap extend probability:                        %f\n",      esl_opt_GetReal   (go, "--pextend"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--mx")                            && fprintf(ofp, "# subst score matrix (built-in):                 %s\n",      esl_opt_GetString (go, "--mx"))              < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--mxfile")                        && fprintf(ofp, "# subst score matrix (file):                     %s\n",      esl_opt_GetString (go, "--mxfile"))          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "-E")                              && fprintf(ofp, "# sequence reporting threshold:                  E-value <= %g\n",  esl_opt_GetReal(go, "-E"))            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "-T")                              && fprintf(ofp, "# sequence reporting threshold:                  score >= %g\n",    esl_opt_GetReal(go, "-T"))            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--incE")                          && fprintf(ofp, "# sequence inclusion threshold:                  E-value <= %g\n",  esl_opt_GetReal(go, "--incE"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--incT")                          && fprintf(ofp, "# sequence inclusion threshold:                  score >= %g\n",    esl_opt_GetReal(go, "--incT"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--max")                           && fprintf(ofp, "# Max sensitivity mode:                          on [all heuristic filters off]\n")                       < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--F1")                            && fprintf(ofp, "# MSV filter P threshold:                     <= %g\n",      esl_opt_GetReal(go, "--F1"))                 < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--F2")                            && fprintf(ofp, "# Vit filter P threshold:                     <= %g\n",      esl_opt_GetReal(go, "--F2"))                 < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--F3")                            && fprintf(ofp, "# Fwd filter P threshold:                     <= %g\n",      esl_opt_GetReal(go, "--F3"))                 < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--nobias")                        && fprintf(ofp, "# biased composition HMM filter:                 off\n")                                                  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--nonull2")                       && fprintf(ofp, "# null2 bias corrections:                        off\n")                                                  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--tmask")                         && fprintf(ofp, "# target masking:                                on [dust + SEG]\n")                                      < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--perfctr")                       && fprintf(ofp, "# hardware performance counters:                 on\n")                                                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#ifdef HMMER_THREADS
+  if (esl_opt_IsUsed(go, "--fwd_cpu")                       && fprintf(ofp, "# threads for large envelope Forward:            %d\n",      esl_opt_GetInteger(go, "--fwd_cpu"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#endif
+  if (esl_opt_IsUsed(go, "-Z")                              && fprintf(ofp, "# database size is set to:                       %.1f Mb\n", esl_opt_GetReal(go, "-Z"))                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--seed"))  {
+    if (esl_opt_GetInteger(go, "--seed") == 0               && fprintf(ofp, "# random number seed:                            one-time arbitrary\n")                                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+    else if (                                                  fprintf(ofp, "# random number seed set to:                     %d\n",      esl_opt_GetInteger(go, "--seed"))            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  }
+  if (esl_opt_IsUsed(go, "--qformat")                       && fprintf(ofp, "# query format asserted:                         %s\n",      esl_opt_GetString(go, "--qformat"))          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--tformat")                       && fprintf(ofp, "# targ <seqfile> format asserted:                %s\n",      esl_opt_GetString(go, "--tformat"))          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (fprintf(ofp, "# - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -\n\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  return eslOK;
+}
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS *go        = NULL;
+  char        *queryfile = NULL;
+  char        *dbfile    = NULL;
+  int          status;
+
+  impl_Init();                  /* processor specific initialization */
+  p7_FLogsumInit();		/* we're going to use table-driven Logsum() approximations at times */
+
+  process_commandline(argc, argv, &go, &queryfile, &dbfile);
+  status = serial_master(go, queryfile, dbfile);
+
+  esl_getopts_Destroy(go);
+  return status;
+}
+
+/* create a set of ORFs for each DNA target sequence */
+static int
+do_sq_by_sequences(ESL_GENCODE *gcode, ESL_GENCODE_WORKSTATE *wrk, ESL_SQ *sq)
+{
+      esl_gencode_ProcessStart(gcode, wrk, sq);
+      esl_gencode_ProcessPiece(gcode, wrk, sq);
+      esl_gencode_ProcessEnd(wrk, sq);
+
+  return eslOK;
+}
+
+/* serial_master()
+ * For each query sequence in <queryfile>, iterate: search the target
+ * database with the current profile, then build the next profile from
+ * the query and the included hits, until no new hits are included or
+ * -N rounds are done.
+ */
+static int
+serial_master(ESL_GETOPTS *go, char *queryfile, char *dbfile)
+{
+  FILE            *ofp       = stdout;             /* results output file (-o)                        */
+  FILE            *afp       = NULL;               /* alignment output file (-A)                      */
+  FILE            *tblfp     = NULL;               /* output stream for tabular per-seq (--tblout)    */
+  FILE            *fstblfp   = NULL;               /* output stream for frameshifts (--fstblout)      */
+  ESL_SQFILE      *qfp       = NULL;               /* open query seqfile                              */
+  ESL_SQFILE      *dbfp      = NULL;               /* open target sequence database                   */
+  int              qfmt      = eslSQFILE_UNKNOWN;
+  int              dbfmt     = eslSQFILE_UNKNOWN;
+  ESL_ALPHABET    *abcAA     = esl_alphabet_Create(eslAMINO);
+  ESL_ALPHABET    *abcDNA    = esl_alphabet_Create(eslDNA);
+  ESL_GENCODE     *gcode     = NULL;
+  P7_BUILDER      *bld       = NULL;
+  ESL_SQ          *qsq       = esl_sq_CreateDigital(abcAA);
+  P7_TRACE        *qtr       = NULL;               /* query's trace from the single-sequence model    */
+  P7_HMM          *hmm       = NULL;
+  ESL_MSA         *msa       = NULL;
+  WORKER_INFO      info;
+  WINCACHE        *wc        = NULL;
+  ESL_KEYHASH     *kh        = NULL;               /* included hits of the previous round             */
+  ESL_STOPWATCH   *watch     = esl_stopwatch_Create();
+  char            *chkfile   = NULL;
+  FILE            *chkfp     = NULL;
+  int64_t          resCnt;
+  int              textw     = (esl_opt_GetBoolean(go, "--notextw") ? 0 : esl_opt_GetInteger(go, "--textw"));
+  int              maxiter   = esl_opt_GetInteger(go, "-N");
+  int              rescan    = esl_opt_GetInteger(go, "--rescan");
+  int              iteration;
+  int              full;
+  int              nnew;
+  int              nquery    = 0;
+  int              qstatus;
+  int              sstatus;
+  int              i, d;
+  int              status;
+
+  /* Open the query and target files */
+  if (esl_opt_IsOn(go, "--qformat")) {
+    qfmt = esl_sqio_EncodeFormat(esl_opt_GetString(go, "--qformat"));
+    if (qfmt == eslSQFILE_UNKNOWN) p7_Fail("%s is not a recognized input sequence file format\n", esl_opt_GetString(go, "--qformat"));
+  }
+  status = esl_sqfile_OpenDigital(abcAA, queryfile, qfmt, NULL, &qfp);
+  if      (status == eslENOTFOUND) p7_Fail("Failed to open sequence file %s for reading\n",      queryfile);
+  else if (status == eslEFORMAT)   p7_Fail("Sequence file %s is empty or misformatted\n",        queryfile);
+  else if (status != eslOK)        p7_Fail("Unexpected error %d opening sequence file %s\n", status, queryfile);
+
+  if (esl_opt_IsOn(go, "--tformat")) {
+    dbfmt = esl_sqio_EncodeFormat(esl_opt_GetString(go, "--tformat"));
+    if (dbfmt == eslSQFILE_UNKNOWN) p7_Fail("%s is not a recognized sequence database file format\n", esl_opt_GetString(go, "--tformat"));
+  }
+  status = esl_sqfile_Open(dbfile, dbfmt, p7_SEQDBENV, &dbfp);
+  if      (status == eslENOTFOUND) p7_Fail("Failed to open sequence file %s for reading\n",          dbfile);
+  else if (status == eslEFORMAT)   p7_Fail("Sequence file %s is empty or misformatted\n",            dbfile);
+  else if (status == eslEINVAL)    p7_Fail("Can't autodetect format of a stdin or .gz seqfile");
+  else if (status != eslOK)        p7_Fail("Unexpected error %d opening sequence file %s\n", status, dbfile);
+  if (! esl_sqfile_IsRewindable(dbfp)) p7_Fail("Target sequence file %s isn't rewindable; bathjack reads it more than once\n", dbfile);
+  esl_sqfile_SetDigital(dbfp, abcDNA);
+
+  /* Open the results output files */
+  if (esl_opt_IsOn(go, "-o"))       { if ((ofp   = fopen(esl_opt_GetString(go, "-o"),       "w")) == NULL) p7_Fail("Failed to open output file %s for writing\n",                   esl_opt_GetString(go, "-o")); }
+  if (esl_opt_IsOn(go, "-A"))       { if ((afp   = fopen(esl_opt_GetString(go, "-A"),       "w")) == NULL) p7_Fail("Failed to open alignment output file %s for writing\n",         esl_opt_GetString(go, "-A")); }
+  if (esl_opt_IsOn(go, "--tblout")) { if ((tblfp = fopen(esl_opt_GetString(go, "--tblout"), "w")) == NULL) p7_Fail("Failed to open tabular per-seq output file %s for writing\n",   esl_opt_GetString(go, "--tblout")); }
+  if (esl_opt_IsOn(go, "--fstblout")) { if ((fstblfp = fopen(esl_opt_GetString(go, "--fstblout"), "w")) == NULL) p7_Fail("Failed to open tabular per-ali frameshift file %s for writing\n", esl_opt_GetString(go, "--fstblout")); }
+
+  output_header(ofp, go, queryfile, dbfile);
+
+  /* Set up the genetic code. Default = NCBI 1, the standard code; allow ORFs to start at any aa */
+  gcode = esl_gencode_Create(abcDNA, abcAA);
+  if (esl_gencode_Set(gcode, esl_opt_GetInteger(go, "--ct")) != eslOK) p7_Fail("%d is not an NCBI translation table id (see end of help)\n", esl_opt_GetInteger(go, "--ct"));
+  if      (esl_opt_GetBoolean(go, "-m"))   esl_gencode_SetInitiatorOnlyAUG(gcode);
+  else if (! esl_opt_GetBoolean(go, "-M")) esl_gencode_SetInitiatorAny(gcode);      // note this is the default, if neither -m nor -M are set
+
+  info.bg    = p7_bg_fs_Create(abcAA);
+  info.gcode = gcode;
+
+  /* The first round's model comes from the query alone, with a score
+   * matrix; later rounds' models come from the alignment of the query
+   * and the included hits, with its consensus columns as match states
+   * so the model keeps the query's length. */
+  bld = p7_builder_Create(NULL, abcAA);
+  if (bld == NULL)  p7_Fail("p7_builder_Create failed");
+  bld->w_len         = esl_opt_IsOn(go, "--w_length") ?  esl_opt_GetInteger(go, "--w_length") : -1;
+  bld->w_beta        = esl_opt_IsOn(go, "--w_beta")   ?  esl_opt_GetReal   (go, "--w_beta")   : p7_DEFAULT_WINDOW_BETA;
+  if ( bld->w_beta < 0 || bld->w_beta > 1  ) esl_fatal("Invalid window-length beta value\n");
+  bld->fs            = esl_opt_GetReal(go, "--fs");
+  bld->arch_strategy = p7_ARCH_HAND;
+  if (esl_opt_IsOn(go, "--mxfile")) status = p7_builder_SetScoreSystem (bld, esl_opt_GetString(go, "--mxfile"), NULL, esl_opt_GetReal(go, "--popen"), esl_opt_GetReal(go, "--pextend"), info.bg);
+  else                              status = p7_builder_LoadScoreSystem(bld, esl_opt_GetString(go, "--mx"),           esl_opt_GetReal(go, "--popen"), esl_opt_GetReal(go, "--pextend"), info.bg);
+  if (status != eslOK) p7_Fail("Failed to set single query seq score system:\n%s\n", bld->errbuf);
+
+  if ((wc = wincache_Create()) == NULL) p7_Fail("Failed to allocate target window cache\n");
+
+  /* Outer loop: over each query sequence in <queryfile>. */
+  while ((qstatus = esl_sqio_Read(qfp, qsq)) == eslOK)
+  {
+    nquery++;
+
+    if (fprintf(ofp, "Query:       %s  [L=%ld]\n", qsq->name, (long) qsq->n) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+    if (qsq->acc[0]  != 0 && fprintf(ofp, "Accession:   %s\n", qsq->acc)  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+    if (qsq->desc[0] != 0 && fprintf(ofp, "Description: %s\n", qsq->desc) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+
+    if (p7_SingleBuilder(bld, qsq, info.bg, &hmm, &qtr, NULL, NULL) != eslOK) p7_Fail("build failed: %s", bld->errbuf);
+
+    /* Inner loop: over search rounds */
+    for (iteration = 1; iteration <= maxiter; iteration++)
+    {
+      esl_stopwatch_Start(watch);
+      full = (iteration == 1 || (rescan > 0 && (iteration-1) % rescan == 0));
+      if (hmm->max_length == -1) p7_Builder_MaxLength(hmm, p7_DEFAULT_WINDOW_BETA);
+
+      if (esl_opt_IsOn(go, "--chkhmm")) {
+        if ((status = esl_sprintf(&chkfile, "%s-%d.hmm", esl_opt_GetString(go, "--chkhmm"), iteration)) != eslOK) goto ERROR;
+        if ((chkfp = fopen(chkfile, "w")) == NULL) p7_Fail("Failed to open HMM checkpoint file %s for writing\n", chkfile);
+        hmm->fs = bld->fs;
+        hmm->ct = esl_opt_GetInteger(go, "--ct");
+        if ((status = p7_hmmfile_WriteASCII(chkfp, p7_BATH_3f, hmm)) != eslOK) p7_Fail("HMM checkpoint save failed\n");
+        fclose(chkfp);
+        free(chkfile);
+        chkfile = NULL;
+      }
+
+      /* Convert to an optimized model */
+      info.gm_fs = p7_profile_fs_Create (hmm->M, abcAA);
+      info.gm    = p7_profile_Create (hmm->M, abcAA);
+      info.om    = p7_oprofile_Create(hmm->M, abcAA);
+      p7_ProfileConfig(hmm, info.bg, info.gm, 100, p7_LOCAL); /* 100 is a dummy length for now; and MSVFilter requires local mode */
+      p7_oprofile_Convert(info.gm, info.om);                                      /* convert <om> to <gm>*/
+      p7_ProfileConfig_fs(hmm, info.bg, gcode, info.gm_fs, 100, p7_LOCAL);  /* build framshift aware codon HMM */
+      info.scoredata = p7_hmm_ScoreDataCreate(info.om, NULL);
+
+      info.wrk1 = esl_gencode_WorkstateCreate(go, gcode);
+      info.wrk1->orf_block = esl_sq_CreateDigitalBlock(BLOCK_SIZE, abcAA);
+      info.wrk2 = esl_gencode_WorkstateCreate(go, gcode);
+      info.wrk2->orf_block = esl_sq_CreateDigitalBlock(BLOCK_SIZE, abcAA);
+      info.th   = p7_tophits_Create();
+      info.pli  = p7_pipeline_fs_Create(go, info.om->M, 300, TRUE, p7_SEARCH_SEQS); /* L_hint = 300 is just a dummy for now */
+      status    = p7_pli_NewModel(info.pli, info.om, info.bg);
+      if (status == eslEINVAL) p7_Fail(info.pli->errbuf);
+      info.pli->nmodels = 1;
+      info.pli->nnodes  = hmm->M;
+
+      if      (strcmp(esl_opt_GetString(go, "--strand"), "both")  == 0) info.pli->strands = p7_STRAND_BOTH;
+      else if (strcmp(esl_opt_GetString(go, "--strand"), "plus")  == 0) info.pli->strands = p7_STRAND_TOPONLY;
+      else if (strcmp(esl_opt_GetString(go, "--strand"), "minus") == 0) info.pli->strands = p7_STRAND_BOTTOMONLY;
+      else     p7_Fail("Unrecognized argument for --strand ('%s'). Only 'both', 'plus', and 'minus' allowed.", esl_opt_GetString(go, "--strand"));
+
+      if (  esl_opt_IsUsed(go, "--block_length") )
+        info.pli->block_length = esl_opt_GetInteger(go, "--block_length");
+      else
+        info.pli->block_length = BATH_MAX_RESIDUE_COUNT;
+
+      if (fprintf(ofp, "Scores for complete sequences (score includes all domains):\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+      if (fprintf(ofp, "@@ Round:                  %d\n", iteration) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+      if (fprintf(ofp, "@@ Target windows searched: %s\n", full ? "all [full scan]" : "only those that passed Viterbi in the last full scan") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+
+      if (full) {
+        esl_sqfile_Position(dbfp, 0);
+        sstatus = full_scan(&info, dbfp, wc);
+      }
+      else sstatus = cached_scan(&info, wc);
+
+      switch(sstatus) {
+        case eslEFORMAT:
+          esl_fatal("Parse failed (sequence file %s):\n%s\n",
+                     dbfp->filename, esl_sqfile_GetErrorBuf(dbfp));
+          break;
+        case eslEOF:
+        case eslOK:
+          /* do nothing */
+          break;
+        default:
+          esl_fatal("Unexpected error %d reading sequence file %s", sstatus, dbfp->filename);
+      }
+
+      if (esl_opt_IsUsed(go, "-Z")) {
+        resCnt = 1000000*esl_opt_GetReal(go, "-Z");
+        if ( info.pli->strands == p7_STRAND_BOTH)
+          resCnt *= 2;
+      }
+      else resCnt = info.pli->nres;
+      p7_tophits_ComputeBATHEvalues(info.th, resCnt, info.om->max_length);
+
+      /* Sort and remove duplicates */
+      p7_tophits_SortBySeqidxAndAlipos(info.th);
+      assign_Lengths(info.th, wc->id_length_list);
+      p7_tophits_RemoveDuplicates(info.th, info.pli->use_bit_cutoffs);
+
+      /* Sort and remove hits bellow threshold */
+      p7_tophits_SortBySortkey(info.th);
+      /* Set Z = 1 to prevent changing e-values. Correct Z
+       * was calcualted by p7_tophits_ComputeBathEvalues() */
+      info.pli->Z = 1;
+      p7_tophits_Threshold(info.th, info.pli);
+
+      /* Print the results.  */
+      info.pli->n_output = info.pli->pos_output = 0;
+      for (i = 0; i < info.th->N; i++) {
+        if ( (info.th->hit[i]->flags & p7_IS_REPORTED) || info.th->hit[i]->flags & p7_IS_INCLUDED) {
+          info.pli->n_output++;
+          for(d = 0; d < info.th->hit[i]->ndom; d++)
+            info.pli->pos_output += 1 + (info.th->hit[i]->dcl[d].jali > info.th->hit[i]->dcl[d].iali ? info.th->hit[i]->dcl[d].jali - info.th->hit[i]->dcl[d].iali : info.th->hit[i]->dcl[d].iali - info.th->hit[i]->dcl[d].jali) ;
+        }
+      }
+
+      p7_tophits_Targets(ofp, info.th, info.pli, textw); if (fprintf(ofp, "\n\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+      p7_tophits_Domains(ofp, info.th, info.pli, textw); if (fprintf(ofp, "\n\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+
+      esl_stopwatch_Stop(watch);
+      p7_pli_Statistics(ofp, info.pli, watch);
+
+      /* Build the next round's model from the query and the included hits */
+      if ((nnew = count_new_included(info.th, &kh)) < 0) p7_Fail("Failed to compare included hits between rounds\n");
+      if (msa != NULL) esl_msa_Destroy(msa);
+      msa    = NULL;
+      status = p7_tophits_Alignment(info.th, abcAA, &qsq, &qtr, 1, p7_ALL_CONSENSUS_COLS | p7_DIGITIZE, &msa);
+      if (status != eslOK) p7_Fail("Failed to create alignment of included hits (%d)\n", status);
+      esl_msa_FormatName(msa, "%s-i%d", qsq->name, iteration);
+      esl_msa_SetAccession(msa, qsq->acc, -1);
+      esl_msa_SetDesc     (msa, qsq->desc, -1);
+      esl_msa_FormatAuthor(msa, "bathjack (HMMER %s)", HMMER_VERSION);
+
+      if (fprintf(ofp, "@@ New targets included:   %d\n", nnew)      < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+      if (fprintf(ofp, "@@ Included in MSA:        %d subsequences (query + %d subseqs from %d targets)\n", msa->nseq, msa->nseq-1, (int) info.th->nincluded) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+
+      if (iteration == maxiter || nnew == 0)
+      {
+        if (nnew == 0 && fprintf(ofp, "@@\n@@ CONVERGED (in %d rounds). \n@@\n\n", iteration) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+        if (afp   != NULL && esl_msafile_Write(afp, msa, eslMSAFILE_STOCKHOLM) != eslOK) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+        if (tblfp != NULL) p7_tophits_TabularTargets(tblfp, qsq->name, qsq->acc, info.th, info.pli, (nquery == 1));
+        if (fstblfp != NULL) p7_tophits_TabularFrameshifts(fstblfp, qsq->name, qsq->acc, info.th, info.pli, (nquery == 1));
+      }
+      else
+      {
+        p7_hmm_Destroy(hmm);
+        hmm = NULL;
+        if (p7_Builder(bld, msa, info.bg, &hmm, NULL, NULL, NULL, NULL) != eslOK) p7_Fail("build failed: %s", bld->errbuf);
+        if (fprintf(ofp, "@@ Model size:             %d positions\n@@\n\n", hmm->M) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+      }
+      if (fprintf(ofp, "//\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+
+      p7_pipeline_fs_Destroy(info.pli);
+      p7_tophits_Destroy(info.th);
+      p7_oprofile_Destroy(info.om);
+      p7_profile_Destroy(info.gm);
+      p7_profile_fs_Destroy(info.gm_fs);
+      p7_hmm_ScoreDataDestroy(info.scoredata);
+      esl_sq_DestroyBlock(info.wrk1->orf_block);
+      esl_sq_DestroyBlock(info.wrk2->orf_block);
+      info.wrk1->orf_block = info.wrk2->orf_block = NULL;
+      esl_gencode_WorkstateDestroy(info.wrk1);
+      esl_gencode_WorkstateDestroy(info.wrk2);
+
+      if (nnew == 0) break;
+    } /* end iteration loop */
+
+    p7_hmm_Destroy(hmm);
+    p7_trace_Destroy(qtr);
+    if (msa != NULL) esl_msa_Destroy(msa);
+    if (kh  != NULL) esl_keyhash_Destroy(kh);
+    hmm = NULL;
+    qtr = NULL;
+    msa = NULL;
+    kh  = NULL;
+    esl_sq_Reuse(qsq);
+  } /* end loop over query sequences */
+
+  if      (qstatus == eslEFORMAT) p7_Fail("Parse failed (sequence file %s):\n%s\n", qfp->filename, esl_sqfile_GetErrorBuf(qfp));
+  else if (qstatus != eslEOF)     p7_Fail("Unexpected error %d reading sequence file %s", qstatus, qfp->filename);
+
+  /* Terminate outputs... any last words? */
+  if (tblfp)    p7_tophits_TabularTail(tblfp, "bathjack", p7_SEARCH_SEQS, queryfile, dbfile, go);
+  if (fstblfp)  p7_tophits_TabularTail(fstblfp, "bathjack", p7_SEARCH_SEQS, queryfile, dbfile, go);
+  if (ofp)      { if (fprintf(ofp, "[ok]\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed"); }
+
+  /* Cleanup - prepare for exit */
+  wincache_Destroy(wc);
+  p7_builder_Destroy(bld);
+  p7_bg_Destroy(info.bg);
+  esl_gencode_Destroy(gcode);
+  esl_sq_Destroy(qsq);
+  esl_stopwatch_Destroy(watch);
+  esl_sqfile_Close(qfp);
+  esl_sqfile_Close(dbfp);
+  esl_alphabet_Destroy(abcAA);
+  esl_alphabet_Destroy(abcDNA);
+
+  if (ofp != stdout) fclose(ofp);
+  if (afp)           fclose(afp);
+  if (tblfp)         fclose(tblfp);
+  if (fstblfp)       fclose(fstblfp);
+  return eslOK;
+
+ ERROR:
+  if (chkfile) free(chkfile);
+  return status;
+}
+
+/* full_scan()
+ * Search every window of the target database with the query in
+ * <info>, and refill <wc> with the windows in which some ORF passed
+ * the Viterbi filter, and with what was counted. Returns the final
+ * read status, as bathsearch's serial_loop() does.
+ */
+static int
+full_scan(WORKER_INFO *info, ESL_SQFILE *dbfp, WINCACHE *wc)
+{
+  ESL_SQ   *dbsq    = esl_sq_CreateDigital(info->gcode->nt_abc);
+  int64_t   seq_id  = 0;
+  uint64_t  pos_vit;
+  int       sstatus = eslOK;
+  int       status;
+
+  if ((status = wincache_Reuse(wc)) != eslOK) goto ERROR;
+
+  sstatus = esl_sqio_ReadWindow(dbfp, 0, info->pli->block_length, dbsq);
+  while (sstatus == eslOK)
+  {
+    dbsq->idx = seq_id;
+    if (dbsq->n >= 15) /* do not process sequence of less than 5 codons */
+    {
+      pos_vit = info->pli->pos_past_vit;
+      if ((status = search_window(info, dbsq)) != eslOK) goto ERROR;
+      if (info->pli->pos_past_vit > pos_vit && (status = wincache_Add(wc, dbsq)) != eslOK) goto ERROR;
+    }
+
+    sstatus = esl_sqio_ReadWindow(dbfp, info->om->max_length, info->pli->block_length, dbsq);
+    if (sstatus == eslEOD)
+    {
+      /* no more left of this sequence ... move along to the next sequence. */
+      add_id_length(wc->id_length_list, dbsq->idx, dbsq->L);
+      info->pli->nseqs++;
+      esl_sq_Reuse(dbsq);
+      sstatus = esl_sqio_ReadWindow(dbfp, 0, info->pli->block_length, dbsq);
+      seq_id++;
+    }
+  }
+  wc->nres  = info->pli->nres;
+  wc->nseqs = info->pli->nseqs;
+
+  esl_sq_Destroy(dbsq);
+  return sstatus;
+
+ ERROR:
+  esl_sq_Destroy(dbsq);
+  return status;
+}
+
+/* cached_scan()
+ * Search only the windows a full scan kept in <wc>, dropping those in
+ * which no ORF passes the Viterbi filter with this round's query, and
+ * set the pipeline's residue and sequence counts to the full scan's,
+ * so E-values and the summary come out as for a full scan.
+ */
+static int
+cached_scan(WORKER_INFO *info, WINCACHE *wc)
+{
+  uint64_t pos_vit;
+  int      i, n;
+  int      status;
+
+  for (i = 0, n = 0; i < wc->nwin; i++)
+  {
+    pos_vit = info->pli->pos_past_vit;
+    if ((status = search_window(info, wc->win[i])) != eslOK) return status;
+
+    if (info->pli->pos_past_vit > pos_vit) wc->win[n++] = wc->win[i];
+    else                                   esl_sq_Destroy(wc->win[i]);
+  }
+  wc->nwin = n;
+
+  info->pli->nres  = wc->nres;
+  info->pli->nseqs = wc->nseqs;
+  return eslOK;
+}
+
+/* search_window()
+ * Search one window of target DNA, both strands (or the one selected
+ * by --strand), with the query in <info>. <dbsq_dna> is returned as it
+ * came in, apart from any masking.
+ */
+static int
+search_window(WORKER_INFO *info, ESL_SQ *dbsq_dna)
+{
+  int status;
+
+  dbsq_dna->L = dbsq_dna->n; /* here, L is not the full length of the sequence in the db, just of the currently-active window;  required for esl_gencode machinations */
+  if ((status = p7_pli_MaskTarget(info->pli, info->gcode, dbsq_dna)) != eslOK) return status;
+
+  if (info->pli->strands != p7_STRAND_BOTTOMONLY)
+  {
+    info->pli->nres += dbsq_dna->n;
+     /* translate DNA sequence to 3 frame ORFs */
+    do_sq_by_sequences(info->gcode, info->wrk1, dbsq_dna);
+
+    p7_Pipeline_BATH(info->pli, info->om, info->gm, info->gm_fs, info->scoredata, info->bg, info->th, dbsq_dna->idx, dbsq_dna, info->wrk1->orf_block, info->wrk2, info->gcode, p7_NOCOMPLEMENT);
+    p7_pipeline_fs_Reuse(info->pli); // prepare for next search
+
+    esl_sq_ReuseBlock(info->wrk1->orf_block);
+  }
+
+  if (info->pli->strands != p7_STRAND_TOPONLY)
+  {
+    info->pli->nres += dbsq_dna->n;
+    /* Reverse complement and translate DNA sequence to 3 frame ORFs */
+    esl_sq_ReverseComplement(dbsq_dna);
+    do_sq_by_sequences(info->gcode, info->wrk1, dbsq_dna);
+
+    p7_Pipeline_BATH(info->pli, info->om, info->gm, info->gm_fs, info->scoredata, info->bg, info->th, dbsq_dna->idx, dbsq_dna, info->wrk1->orf_block, info->wrk2, info->gcode, p7_COMPLEMENT);
+    p7_pipeline_fs_Reuse(info->pli); // prepare for next search
+
+    esl_sq_ReuseBlock(info->wrk1->orf_block);
+
+    /* Reverse sequence back to original */
+    esl_sq_ReverseComplement(dbsq_dna);
+  }
+  return eslOK;
+}
+
+/* count_new_included()
+ * Count the included domains of <th> that weren't included in the
+ * previous round, as recorded in <*kh>, and replace <*kh> with this
+ * round's. A domain is named by its target and its coordinates on it.
+ * Returns the count, or -1 on allocation failure.
+ */
+static int
+count_new_included(const P7_TOPHITS *th, ESL_KEYHASH **kh)
+{
+  ESL_KEYHASH *newkh = esl_keyhash_Create();
+  char        *key   = NULL;
+  int          nnew  = 0;
+  int          h, d;
+
+  if (newkh == NULL) return -1;
+  for (h = 0; h < th->N; h++)
+    if (th->hit[h]->flags & p7_IS_INCLUDED)
+      for (d = 0; d < th->hit[h]->ndom; d++)
+        if (th->hit[h]->dcl[d].is_included)
+        {
+          if (esl_sprintf(&key, "%s/%" PRId64 "-%" PRId64, th->hit[h]->name, th->hit[h]->dcl[d].iali, th->hit[h]->dcl[d].jali) != eslOK) goto ERROR;
+          if (*kh == NULL || esl_keyhash_Lookup(*kh, key, -1, NULL) != eslOK) nnew++;
+          if (esl_keyhash_Store(newkh, key, -1, NULL) == eslEMEM) goto ERROR;
+          free(key);
+          key = NULL;
+        }
+
+  if (*kh != NULL) esl_keyhash_Destroy(*kh);
+  *kh = newkh;
+  return nnew;
+
+ ERROR:
+  if (key) free(key);
+  esl_keyhash_Destroy(newkh);
+  return -1;
+}
+
+static WINCACHE *
+wincache_Create(void)
+{
+  WINCACHE *wc = NULL;
+  int       status;
+
+  ESL_ALLOC(wc, sizeof(WINCACHE));
+  wc->win            = NULL;
+  wc->nwin           = 0;
+  wc->nalloc         = 0;
+  wc->nres           = 0;
+  wc->nseqs          = 0;
+  if ((wc->id_length_list = init_id_length(1000)) == NULL) goto ERROR;
+  return wc;
+
+ ERROR:
+  wincache_Destroy(wc);
+  return NULL;
+}
+
+static int
+wincache_Reuse(WINCACHE *wc)
+{
+  int i;
+
+  for (i = 0; i < wc->nwin; i++) esl_sq_Destroy(wc->win[i]);
+  wc->nwin  = 0;
+  wc->nres  = 0;
+  wc->nseqs = 0;
+  wc->id_length_list->count = 0;
+  return eslOK;
+}
+
+static int
+wincache_Add(WINCACHE *wc, const ESL_SQ *sq)
+{
+  int status;
+
+  if (wc->nwin == wc->nalloc) {
+    wc->nalloc = ESL_MAX(64, wc->nalloc * 2);
+    ESL_REALLOC(wc->win, sizeof(ESL_SQ *) * wc->nalloc);
+  }
+  if ((wc->win[wc->nwin] = esl_sq_CreateDigital(sq->abc)) == NULL) { status = eslEMEM; goto ERROR; }
+  if ((status = esl_sq_Copy(sq, wc->win[wc->nwin])) != eslOK) goto ERROR;
+  wc->nwin++;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+static void
+wincache_Destroy(WINCACHE *wc)
+{
+  int i;
+
+  if (wc == NULL) return;
+  for (i = 0; i < wc->nwin; i++) esl_sq_Destroy(wc->win[i]);
+  if (wc->win)            free(wc->win);
+  if (wc->id_length_list) destroy_id_length(wc->id_length_list);
+  free(wc);
+}
+
+static ID_LENGTH_LIST *
+init_id_length( int size )
+{
+  int status;
+  ID_LENGTH_LIST *list;
+
+  ESL_ALLOC (list, sizeof(ID_LENGTH_LIST));
+  list->count = 0;
+  list->size  = size;
+  list->id_lengths = NULL;
+
+  ESL_ALLOC (list->id_lengths, size * sizeof(ID_LENGTH));
+
+  return list;
+
+ERROR:
+  return NULL;
+}
+
+static void
+destroy_id_length( ID_LENGTH_LIST *list )
+{
+
+  if (list != NULL) {
+    if (list->id_lengths != NULL) free (list->id_lengths);
+    free (list);
+  }
+
+}
+
+static int
+add_id_length(ID_LENGTH_LIST *list, int id, int L)
+{
+  int status;
+
+  if (list->count > 0 && list->id_lengths[list->count-1].id == id) {
+    /* the last time this gets updated, it'll have the sequence's actual length */
+    list->id_lengths[list->count-1].length = L;
+  } else {
+    if (list->count == list->size) {
+      list->size *= 10;
+      ESL_REALLOC(list->id_lengths, list->size * sizeof(ID_LENGTH));
+    }
+
+    list->id_lengths[list->count].id     = id;
+    list->id_lengths[list->count].length = L;
+
+    list->count++;
+  }
+  return eslOK;
+
+ERROR:
+  return status;
+}
+
+static int
+assign_Lengths(P7_TOPHITS *th, ID_LENGTH_LIST *id_length_list)
+{
+
+  int i;
+  int j = 0;
+
+  for (i=0; i<th->N; i++) {
+    while (th->hit[i]->seqidx != id_length_list->id_lengths[j].id) { j++; }
+    th->hit[i]->dcl[0].ad->L = id_length_list->id_lengths[j].length;
+  }
+
+  return eslOK;
+}
@@ -0,0 +1,175 @@
+/* bathmask: precompute low-complexity masks for a target DNA database.
+ *
+ * Runs the dust and SEG maskers of p7_tmask.c once over every sequence
+ * in <seqdb> and saves the masked spans as BED, by default to
+ * <seqdb>.bmask, where bathsearch --tmask finds them. Searching many
+ * queries against the same genome then pays for masking once instead
+ * of once per query.
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_gencode.h"
+#include "esl_getopts.h"
+#include "esl_sq.h"
+#include "esl_sqio.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type          default   env  range      toggles reqs  incomp  help                                                     docgroup*/
+  { "-h",           eslARG_NONE,    FALSE,  NULL, NULL,      NULL,  NULL,  NULL,  "show brief help on version and usage",                          1 },
+  { "-o",           eslARG_OUTFILE,  NULL,  NULL, NULL,      NULL,  NULL,  NULL,  "save masks to file <f>, not <seqdb>.bmask",                     1 },
+  { "--tformat",    eslARG_STRING,   NULL,  NULL, NULL,      NULL,  NULL,  NULL,  "assert <seqdb> is in format <s>: no autodetection",             1 },
+  { "--ct",         eslARG_INT,       "1",  NULL, NULL,      NULL,  NULL,  NULL,  "use alt genetic code of NCBI translation table <n> for SEG",   1 },
+  { "--nodust",     eslARG_NONE,    FALSE,  NULL, NULL,      NULL,  NULL, "--noseg", "don't mask with dust",                                    2 },
+  { "--dust_w",     eslARG_INT,      "64",  NULL, "n>=4",    NULL,  NULL, "--nodust", "dust window length, in nucleotides",                     2 },
+  { "--dust_level", eslARG_REAL,     "20",  NULL, "x>0",     NULL,  NULL, "--nodust", "dust score threshold",                                   2 },
+  { "--noseg",      eslARG_NONE,    FALSE,  NULL, NULL,      NULL,  NULL, "--nodust", "don't mask with SEG",                                    2 },
+  { "--seg_w",      eslARG_INT,      "12",  NULL, "n>=2",    NULL,  NULL, "--noseg",  "SEG window length, in amino acids",                      2 },
+  { "--seg_k1",     eslARG_REAL,    "2.2",  NULL, "x>=0",    NULL,  NULL, "--noseg",  "SEG trigger complexity, in bits",                        2 },
+  { "--seg_k2",     eslARG_REAL,    "2.5",  NULL, "x>=0",    NULL,  NULL, "--noseg",  "SEG extension complexity, in bits",                      2 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+
+static char usage[]  = "[-options] <seqdb>";
+static char banner[] = "precompute low-complexity target masks for bathsearch --tmask";
+
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS  *go       = NULL;
+  char         *seqfile  = NULL;
+  char         *maskfile = NULL;
+  ESL_SQFILE   *sqfp     = NULL;
+  int           fmt      = eslSQFILE_UNKNOWN;
+  ESL_ALPHABET *abcDNA   = NULL;
+  ESL_ALPHABET *abcAA    = NULL;
+  ESL_GENCODE  *gcode    = NULL;
+  ESL_SQ       *sq       = NULL;
+  P7_TMASK     *tm       = NULL;
+  FILE         *ofp      = NULL;
+  int64_t       nseq     = 0;
+  int64_t       nres     = 0;
+  int64_t       nmasked  = 0;
+  int64_t       nspans   = 0;
+  int           j;
+  int           status;
+
+  /* Process command line */
+  go = esl_getopts_Create(options);
+  if (esl_opt_ProcessCmdline(go, argc, argv) != eslOK ||
+      esl_opt_VerifyConfig(go)               != eslOK)
+    {
+      printf("Failed to parse command line: %s\n", go->errbuf);
+      esl_usage(stdout, argv[0], usage);
+      printf("\nTo see more help on available options, do %s -h\n\n", argv[0]);
+      exit(1);
+    }
+  if (esl_opt_GetBoolean(go, "-h") == TRUE)
+    {
+      p7_banner(stdout, argv[0], banner);
+      esl_usage(stdout, argv[0], usage);
+      puts("\nBasic options:");
+      esl_opt_DisplayHelp(stdout, go, 1, 2, 80);
+      puts("\nMasker parameters:");
+      esl_opt_DisplayHelp(stdout, go, 2, 2, 80);
+      exit(0);
+    }
+  if (esl_opt_ArgNumber(go) != 1)
+    {
+      puts("Incorrect number of command line arguments.");
+      esl_usage(stdout, argv[0], usage);
+      printf("\nTo see more help on available options, do %s -h\n\n", argv[0]);
+      exit(1);
+    }
+  seqfile = esl_opt_GetArg(go, 1);
+  if (strcmp(seqfile, "-") == 0 && ! esl_opt_IsOn(go, "-o"))
+    p7_Fail("Reading <seqdb> from stdin, so the mask file needs a name: use -o\n");
+
+  /* Open the target database */
+  if (esl_opt_IsOn(go, "--tformat")) {
+    fmt = esl_sqio_EncodeFormat(esl_opt_GetString(go, "--tformat"));
+    if (fmt == eslSQFILE_UNKNOWN) p7_Fail("%s is not a recognized sequence database file format\n", esl_opt_GetString(go, "--tformat"));
+  }
+  status = esl_sqfile_Open(seqfile, fmt, p7_SEQDBENV, &sqfp);
+  if      (status == eslENOTFOUND) p7_Fail("Failed to open sequence file %s for reading\n", seqfile);
+  else if (status == eslEFORMAT)   p7_Fail("Sequence file %s is empty or misformatted\n",   seqfile);
+  else if (status == eslEINVAL)    p7_Fail("Can't autodetect format of a stdin or .gz seqfile");
+  else if (status != eslOK)        p7_Fail("Unexpected error %d opening sequence file %s\n", status, seqfile);
+
+  abcDNA = esl_alphabet_Create(eslDNA);
+  abcAA  = esl_alphabet_Create(eslAMINO);
+  esl_sqfile_SetDigital(sqfp, abcDNA);
+
+  gcode = esl_gencode_Create(abcDNA, abcAA);
+  if (esl_gencode_Set(gcode, esl_opt_GetInteger(go, "--ct")) != eslOK)
+    p7_Fail("Failed to set genetic code %d\n", esl_opt_GetInteger(go, "--ct"));
+
+  /* Open the mask file */
+  if (esl_opt_IsOn(go, "-o")) { if ((status = esl_strdup(esl_opt_GetString(go, "-o"), -1, &maskfile)) != eslOK) goto ERROR; }
+  else                        { if ((status = esl_sprintf(&maskfile, "%s.bmask", seqfile))             != eslOK) goto ERROR; }
+  if ((ofp = fopen(maskfile, "w")) == NULL) p7_Fail("Failed to open mask file %s for writing\n", maskfile);
+  if (fprintf(ofp, "# bathmask %s: dust %s, SEG %s\n", seqfile,
+              esl_opt_GetBoolean(go, "--nodust") ? "off" : "on",
+              esl_opt_GetBoolean(go, "--noseg")  ? "off" : "on") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "mask file write failed");
+
+  /* Mask each sequence in turn */
+  sq = esl_sq_CreateDigital(abcDNA);
+  tm = p7_tmask_Create();
+  if (sq == NULL || tm == NULL) { status = eslEMEM; goto ERROR; }
+
+  while ((status = esl_sqio_Read(sqfp, sq)) == eslOK)
+    {
+      p7_tmask_Reuse(tm);
+      if ((status = p7_tmask_SetName(tm, sq->name)) != eslOK) goto ERROR;
+
+      if (! esl_opt_GetBoolean(go, "--nodust"))
+        {
+          status = p7_tmask_Dust(tm, abcDNA, sq->dsq, sq->n, 0, esl_opt_GetInteger(go, "--dust_w"), esl_opt_GetReal(go, "--dust_level"));
+          if (status != eslOK) goto ERROR;
+        }
+      if (! esl_opt_GetBoolean(go, "--noseg"))
+        {
+          status = p7_tmask_Seg(tm, gcode, sq->dsq, sq->n, 0, esl_opt_GetInteger(go, "--seg_w"), esl_opt_GetReal(go, "--seg_k1"), esl_opt_GetReal(go, "--seg_k2"));
+          if (status != eslOK) goto ERROR;
+        }
+      p7_tmask_Finalize(tm);
+      if ((status = p7_tmask_WriteBED(ofp, tm)) != eslOK) goto ERROR;
+
+      nseq++;
+      nres   += sq->n;
+      nspans += tm->nseg;
+      for (j = 0; j < tm->nseg; j++) nmasked += tm->seg[j].end - tm->seg[j].beg + 1;
+      esl_sq_Reuse(sq);
+    }
+  if      (status == eslEFORMAT) p7_Fail("Parse failed (sequence file %s):\n%s\n", sqfp->filename, esl_sqfile_GetErrorBuf(sqfp));
+  else if (status != eslEOF)     p7_Fail("Unexpected error %d reading sequence file %s", status, sqfp->filename);
+
+  printf("# sequences:        %" PRId64 "\n", nseq);
+  printf("# residues:         %" PRId64 "\n", nres);
+  printf("# masked spans:     %" PRId64 "\n", nspans);
+  printf("# masked residues:  %" PRId64 "  (%.3g)\n", nmasked, (nres > 0 ? (double) nmasked / (double) nres : 0.));
+  printf("# masks saved to:   %s\n", maskfile);
+
+  fclose(ofp);
+  free(maskfile);
+  p7_tmask_Destroy(tm);
+  esl_sq_Destroy(sq);
+  esl_gencode_Destroy(gcode);
+  esl_alphabet_Destroy(abcAA);
+  esl_alphabet_Destroy(abcDNA);
+  esl_sqfile_Close(sqfp);
+  esl_getopts_Destroy(go);
+  exit(0);
+
+ ERROR:
+  p7_Fail("bathmask failed (%d)\n", status);
+  exit(1);
+}
@@ -4,14 +4,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef HMMER_THREADS
+#include <pthread.h>
+#endif
+
+#ifdef HMMER_MPI
+#include "mpi.h"
+#endif
 
 #include "easel.h"
 #include "esl_alphabet.h"
 #include "esl_getopts.h"
+#include "esl_mpi.h"
 #include "esl_msa.h"
 #include "esl_msafile.h"
 #include "esl_sq.h"
 #include "esl_sqio.h"
+#include "esl_ssi.h"
 #include "esl_stopwatch.h"
 #include "esl_gencode.h"
 
@@ -25,10 +36,87 @@
 /* set the max residue count to 1/4 meg when reading a block */
 #define BATH_MAX_RESIDUE_COUNT (1024 * 256)  /* 1/4 Mb */
 
+#ifdef HMMER_MPI
+/* MPI message tags */
+#define BATH_HMM_TAG          2
+#define BATH_BLOCK_TAG        4
+#define BATH_PIPELINE_TAG     5
+#define BATH_TOPHITS_TAG      6
+#define BATH_READY_TAG       10
+
+/* the master hands out the target database in blocks of whole
+ * sequences holding at least this many residues */
+#define BATH_MPI_BLOCK_RESIDUES (1024 * 1024 * 4)  /* 4 Mb */
+
+/* A block of whole target sequences, addressed by the disk offset of
+ * its first record. <first_seqidx> is the index of that sequence in the
+ * full database, so hits from all workers share one seqidx space.
+ */
+typedef struct {
+  int64_t  offset;        /* disk offset of the first record in the block */
+  int64_t  count;         /* number of sequences in the block             */
+  int64_t  first_seqidx;  /* database index of the first sequence         */
+} MPI_BLOCK;
+
+typedef struct {
+  MPI_BLOCK  *blocks;
+  int         count;
+  int         size;
+} MPI_BLOCKLIST;
+#endif /*HMMER_MPI*/
+
+#ifdef HMMER_THREADS
+/* Live progress reporting (--progress).
+ * Workers publish a snapshot of their pipeline counters into their own
+ * slot after each target sequence; a sampler thread wakes every
+ * <interval> seconds, sums the slots, and writes one status line.
+ * The workers' hot paths never touch the shared state.
+ */
+typedef struct {
+  int64_t  nres;           /* residues into MSV (both strands)  */
+  int64_t  pos_past_msv;   /* residues into the bias filter     */
+  int64_t  pos_past_bias;  /* residues into Viterbi             */
+  int64_t  pos_past_vit;   /* residues into Forward             */
+  int      nhits;          /* hits found so far                 */
+} PROGRESS_COUNTS;
+
+typedef struct {
+  FILE             *fp;        /* where status lines go                                   */
+  int               interval;  /* seconds between status lines                            */
+  int               nworkers;  /* number of slots in <counts>                             */
+  PROGRESS_COUNTS  *counts;    /* one slot per worker; guarded by <mutex>                 */
+  char             *qname;     /* name of the current query                               */
+  int               nquery;    /* index of the current query, 1..                         */
+  int64_t           dbres;     /* residues per full db pass; 0 until the first query ends */
+  time_t            qstart;    /* when the current query started                          */
+  ESL_WORK_QUEUE   *queue;     /* reader/worker queue, or NULL if serial                  */
+  int               done;      /* TRUE tells the sampler to exit                          */
+  pthread_t         thread;
+  pthread_mutex_t   mutex;
+  pthread_cond_t    cond;      /* lets progress_Destroy() wake the sampler early          */
+} PROGRESS;
+
+static PROGRESS *progress_Create  (FILE *fp, int interval, int nworkers, ESL_WORK_QUEUE *queue);
+static void      progress_NewQuery(PROGRESS *prog, char *qname, int nquery, int64_t dbres);
+static void      progress_Publish (PROGRESS *prog, int wid, const P7_PIPELINE *pli, const P7_TOPHITS *th);
+static void      progress_Destroy (PROGRESS *prog);
+#endif /*HMMER_THREADS*/
+
+
+/* A genetic code searched in the same pass as the worker's first one (--ctlist) */
+typedef struct {
+  int                    ct;     /* NCBI translation table id                     */
+  ESL_GENCODE           *gcode;  /* shared by all workers                         */
+  P7_FS_PROFILE         *gm_fs;  /* frameshift query profile built with <gcode>   */
+  ESL_GENCODE_WORKSTATE *wrk1;
+  ESL_GENCODE_WORKSTATE *wrk2;
+} XCODE;
 
 typedef struct {
 #ifdef HMMER_THREADS
   ESL_WORK_QUEUE   *queue;
+  PROGRESS         *progress;    /* live progress reporting, or NULL                                  */
+  int               wid;         /* this worker's slot in <progress>                                  */
 #endif /*HMMER_THREADS*/
   P7_BG            *bg;	         /* null model                                                        */
   ESL_SQ           *ntsq;        /* DNA target sequence                                               */
@@ -41,6 +129,12 @@ typedef struct {
   ESL_GENCODE      *gcode;       /* used for translating ORFs                                         */
   ESL_GENCODE_WORKSTATE *wrk1;   /* used for intitial translation of taget DNA to ORFs                */ 
   ESL_GENCODE_WORKSTATE *wrk2;   /* used for secondary translation of DNA window for bias calcultaion */
+  int               ct;          /* NCBI translation table id of <gcode>                              */
+  XCODE            *xcode;       /* further genetic codes each window is searched with (--ctlist)     */
+  int               nxcode;      /*   ... and how many; 0 for a single code                           */
+  int               do_batch;    /* TRUE to search each block with p7_Pipeline_BATH_Batch()           */
+  struct cluster_cache_s *cc;    /* --clusters: while screening with a representative, the cache the  */
+                                 /*   windows that pass go to; NULL while searching                    */
 } WORKER_INFO;
 
 
@@ -61,6 +155,52 @@ static void            destroy_id_length( ID_LENGTH_LIST *list );
 static int             add_id_length(ID_LENGTH_LIST *list, int id, int L);
 static int             assign_Lengths(P7_TOPHITS *th, ID_LENGTH_LIST *id_length_list);
 
+/* Model clusters (--clusters).
+ * The first member of a cluster to come up as a query screens the
+ * whole target database with the cluster's representative profile,
+ * and the windows that pass are kept here; every member, that one
+ * included, is then searched against just those windows. What a full
+ * pass would have counted (residues, sequences, target lengths) is
+ * kept too, so members get the same E-values and output as without
+ * --clusters. With --cpu, both the screen and the member searches run
+ * on the worker threads.
+ */
+typedef struct cluster_cache_s {
+  ESL_SQ         **win;            /* copies of target windows that passed the representative's filters */
+  int              nwin;
+  int              nalloc;
+  int64_t          nres;           /* residues in the full pass, counted as the pipeline counts them     */
+  int64_t          nseqs;          /* target sequences in the full pass                                   */
+  ID_LENGTH_LIST  *id_length_list; /* full length of every target                                         */
+  int              nleft;          /* members not yet searched; the cache is freed when this reaches 0   */
+#ifdef HMMER_THREADS
+  pthread_mutex_t  mutex;          /* guards <win> while worker threads screen                            */
+#endif
+} CLUSTER_CACHE;
+
+static int            open_clusters        (ESL_GETOPTS *go, char *hmmfile, ESL_ALPHABET **byp_abc, P7_HMMCLUSTERS **ret_hc, P7_HMM ***ret_rephmm);
+static CLUSTER_CACHE *cluster_cache_Create (void);
+static P7_PIPELINE   *cluster_pipeline     (ESL_GETOPTS *go, WORKER_INFO *info, P7_OPROFILE *om);
+static int            cluster_screen       (WORKER_INFO *info, CLUSTER_CACHE *cc, ESL_SQ *dbsq);
+static int            cluster_sweep        (ESL_GETOPTS *go, WORKER_INFO *info, P7_HMM *rephmm, ESL_SQFILE *dbfp, CLUSTER_CACHE **ret_cc);
+static int            cluster_rerun        (WORKER_INFO *info, CLUSTER_CACHE *cc);
+static void           cluster_cache_Destroy(CLUSTER_CACHE *cc);
+
+/* Target regions (--regions).
+ * The intervals to search on each target sequence, as read from BED,
+ * with the full length of each of those sequences and the size of
+ * the whole database, both from its SSI index.
+ */
+typedef struct {
+  P7_TMASKDB  *db;     /* intervals of each sequence, sorted and merged    */
+  int64_t     *L;      /* L[0..db->nmask-1]: full length of each sequence  */
+  int64_t      dbres;  /* residues in the whole database, one strand       */
+} REGIONS;
+
+static int  open_regions   (ESL_GETOPTS *go, ESL_SQFILE *dbfp, REGIONS **ret_rg);
+static int  regions_loop   (WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_SQFILE *dbfp, REGIONS *rg);
+static void regions_Destroy(REGIONS *rg);
+
 #define REPOPTS     "-E,-T"//--cut_ga,--cut_nc,--cut_tc"
 #define DOMREPOPTS  "--domE,--domT,--cut_ga,--cut_nc,--cut_tc"
 #define INCOPTS     "--incE,--incT"//--cut_ga,--cut_nc,--cut_tc"
@@ -68,7 +208,7 @@ static int             assign_Lengths(P7_TOPHITS *th, ID_LENGTH_LIST *id_length_
 #define THRESHOPTS  "-E,-T,--domE,--domT,--incE,--incT,,--incdomE,--incdomT,--cut_ga,--cut_nc,--cut_tc"
 
 #define CPUOPTS     NULL
-#define MPIOPTS     NULL
+#define MPIOPTS     "--fstblout,--restrictdb_stkey,--restrictdb_n,--progress,--dpocc,--clusters,--regions,--perfctr,--alloctrack"
 
 static ESL_OPTIONS options[] = {
   /* name             type            default    env          range      toggles reqs  incomp          help                                                                        docgroup*/
@@ -77,6 +217,9 @@ static ESL_OPTIONS options[] = {
   { "-o",             eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "direct output to file <f>, not stdout",                                    2 },
   { "--tblout",       eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "save parseable table of hits to file <f>",                                 2 },
   { "--fstblout",     eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "save table of frameshift locations to file <f>",                           2 },
+  { "-A",             eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "save multiple alignment of all included hits to file <f>",                 2 },
+  { "--Aformat",      eslARG_STRING, "stockholm",NULL,        NULL,      NULL,   "-A", NULL,           "format of -A alignment: stockholm, a2m, or psiblast",                      2 },
+  { "--Amatch",       eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   "-A", NULL,           "drop insert columns from -A alignment (consensus columns only)",           2 },
   { "--hmmout",       eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "if input is alignment(s) or sequence(s) write produced hmms to file <f>",  2 },
   { "--acc",          eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "prefer accessions over names in output",                                   2 },
   { "--noali",        eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "don't output alignments, so output is smaller",                            2 },
@@ -110,17 +253,38 @@ static ESL_OPTIONS options[] = {
   { "--nonull2",      eslARG_NONE,    NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "turn off biased composition score corrections",                            7 },
   { "--fsonly",       eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"--nofs",        "send all potential hits to the frameshift aware pipeline",                 7 },
   { "--nofs",         eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"--fsonly",      "send all potential hits to the non-frameshift aware pipeline",             7 },
+  { "--tmask",        eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "mask low-complexity target DNA (dust) and translations (SEG)",             7 },
+  { "--tmaskfile",    eslARG_INFILE,  NULL,      NULL,        NULL,      NULL,"--tmask", NULL,         "read precomputed target masks (BED) from <f> [default: <seqdb>.bmask]",    7 },
+  { "--clusters",     eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "screen db once per model cluster (see bathcluster), rerun members on hits", 7 },
+  { "--clusterfile",  eslARG_INFILE,  NULL,      NULL,        NULL,      NULL,"--clusters", NULL,      "read model cluster map from <f> [default: <hmmfile>.bclust]",              7 },
+  { "--kseed",        eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"--max",         "skip ORFs with no scoring amino acid k-mer seed before MSV",               7 },
+  { "--kseed_k",      eslARG_INT,     "5",       NULL,     "3<=n<=6",    NULL,"--kseed", NULL,         "seed word length for --kseed",                                             7 },
+  { "--kseed_T",      eslARG_REAL,    "10.0",    NULL,        "x>0",     NULL,"--kseed", NULL,         "seed word score threshold (bits) for --kseed",                             7 },
 /* Other options */
   { "-Z",             eslARG_REAL,    FALSE,     NULL,       "x>=0",     NULL,   NULL, NULL,           "set database size (Megabases) to <x> for E-value calculations",            12 }, 
+  { "--regions",      eslARG_INFILE,  NULL,      NULL,        NULL,      NULL,   NULL,"--restrictdb_stkey,--restrictdb_n,--clusters", "search only the intervals in BED file <f>, plus flanks (needs SSI index)", 12 },
+  { "--regions_searched", eslARG_NONE, FALSE,    NULL,        NULL,      NULL,"--regions", NULL,         "with --regions, E-values from residues searched, not whole db size",      12 },
   { "--seed",         eslARG_INT,    "42",       NULL,       "n>=0",     NULL,   NULL, NULL,           "set RNG seed to <n> (if 0: one-time arbitrary seed)",                      12 },
   { "--w_beta",       eslARG_REAL,    NULL,      NULL,       "0>=x<=1",  NULL,   NULL, NULL,           "tail mass at which window length is determined",                           12 },
   { "--w_length",     eslARG_INT,     NULL,      NULL,       "x>=4",      NULL,   NULL, NULL,           "window length - essentially max expected hit length" ,                     12 },
+  { "--dpocc",        eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "save frameshift DP posterior occupancy stats (JSON lines) to file <f>",    12 },
+  { "--dpocc_ps",     eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL, "--dpocc", NULL,        "save posterior band heatmaps (PostScript) to file <f>",                    12 },
+  { "--dpocc_every",  eslARG_INT,     "1",       NULL,       "n>=1",     NULL, "--dpocc", NULL,        "sample one of every <n> envelopes for --dpocc",                            12 },
+  { "--perfctr",      eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "report hardware performance counters per pipeline stage",                  12 },
+  { "--alloctrack",   eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, NULL,           "report allocations per pipeline stage (needs --enable-alloctrack build)",  12 },
   #ifdef HMMER_THREADS 
   { "--block_length", eslARG_INT,     NULL,      NULL,       "n>=50000", NULL,   NULL, NULL,           "length of blocks read from target database (threaded) ",                   12 },
   { "--cpu",          eslARG_INT,     p7_NCPU,  "HMMER_NCPU","n>=0",     NULL,   NULL, CPUOPTS,        "number of parallel CPU workers to use for multithreads",                   12 },
+  { "--fwd_cpu",      eslARG_INT,       "0",     NULL,       "n>=0",     NULL,   NULL, NULL,           "threads for Forward on very large frameshift envelopes (0,1: no split)",   12 },
+  { "--progress",     eslARG_OUTFILE, NULL,      NULL,        NULL,      NULL,   NULL, NULL,           "write periodic progress/throughput lines to file <f> ('-' for stderr)",    12 },
+  { "--progress_int", eslARG_INT,     "10",      NULL,       "n>=1",     NULL, "--progress", NULL,     "seconds between --progress lines",                                         12 },
+#endif
+#ifdef HMMER_MPI
+  { "--mpi",          eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL, MPIOPTS,        "run as an MPI parallel program (workers use --cpu threads each)",          12 },
 #endif
   /* Translation options */ 
   { "--ct",           eslARG_INT,    "1",        NULL,        NULL,      NULL,   NULL, NULL,           "use alt genetic code of NCBI translation table (see end of help)",         15 },
+  { "--ctlist",       eslARG_STRING,  NULL,      NULL,        NULL,      NULL,   NULL,"--ct,--clusters","search with each NCBI translation table in comma-separated list <s>",    15 },
   { "-l",             eslARG_INT,    "20",       NULL,        NULL,      NULL,   NULL, NULL,           "minimum ORF length",                                                       15 },
   { "-m",             eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"-M",            "ORFs must initiate with AUG only",                                         15 },
   { "-M",             eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,   NULL,"-m",            "ORFs must start with allowed initiation codon",                            15 },
@@ -151,6 +315,7 @@ static ESL_OPTIONS options[] = {
   { "--crick",        eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,  NULL, NULL,            "only translate top strand",                                                99 },
   { "--watson",       eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,  NULL, NULL,            "only translate bottom strand",                                             99 }, 
   { "--fs",           eslARG_REAL,   "0.01",     NULL,       "0<=x<=1",  NULL,  NULL, NULL,            "set the frameshift probabilty",                                            99 },
+  { "--nobatch",      eslARG_NONE,    FALSE,     NULL,        NULL,      NULL,  NULL, NULL,            "search threaded blocks one target at a time, without short-target batching", 99 },
   {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 };
 
@@ -166,21 +331,40 @@ struct cfg_s {
 
   char             *firstseq_key;     /* name of the first sequence in the restricted db range */
   int              n_targetseq;       /* number of sequences in the restricted range */
+
+  int              do_mpi;            /* TRUE if we're doing MPI parallelization */
+  int              nproc;             /* how many MPI processes, total */
+  int              my_rank;           /* who am I, in 0..nproc-1 */
 };
 
 static char usage[]  = "[options] <hmm, msa, or seq file> <seqdb>";
 static char banner[] = "search protein profile(s) against DNA sequence database";
 
 static int  serial_master(ESL_GETOPTS *go, struct cfg_s *cfg);
-static int  serial_loop  (WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_SQFILE *dbfp, char *firstseq_key, int n_targetseqs);
+static int  open_tmaskdb (ESL_GETOPTS *go, char *dbfile, P7_TMASKDB **ret_db);
+static int  serial_loop  (WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_SQFILE *dbfp, char *firstseq_key, int n_targetseqs, int64_t seqidx_base);
+static void search_window(WORKER_INFO *info, ESL_SQ *dbsq_dna);
+static void search_strands(WORKER_INFO *info, ESL_GENCODE *gcode, P7_FS_PROFILE *gm_fs, ESL_GENCODE_WORKSTATE *wrk1, ESL_GENCODE_WORKSTATE *wrk2, int ct, ESL_SQ *dbsq_dna);
+static int  create_gencodes (ESL_GETOPTS *go, const ESL_ALPHABET *abcDNA, const ESL_ALPHABET *abcAA, ESL_GENCODE ***ret_gcodes, int *ret_ncodes);
+static void destroy_gencodes(ESL_GENCODE **gcodes, int ncodes);
+static int  xcodes_Create   (ESL_GETOPTS *go, WORKER_INFO *info, P7_HMM *hmm, ESL_GENCODE **gcodes, int ncodes);
+static void xcodes_Destroy  (WORKER_INFO *info);
 
-#ifdef HMMER_THREADS
 #define BLOCK_SIZE 1000
 
-static int  thread_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, char *firstseq_key, int n_targetseq);
+#ifdef HMMER_THREADS
+static int  thread_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, char *firstseq_key, int n_targetseq, int64_t seqidx_base);
 static void pipeline_thread(void *arg);
+static int  cluster_thread_sweep(ESL_GETOPTS *go, WORKER_INFO *info, int ninfo, P7_HMM *rephmm, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, CLUSTER_CACHE **ret_cc);
+static int  cluster_thread_rerun(WORKER_INFO *info, int ninfo, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, CLUSTER_CACHE *cc);
 #endif /*HMMER_THREADS*/
 
+#ifdef HMMER_MPI
+static int  mpi_search   (ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, ESL_SQFILE *dbfp, P7_HMM *hmm, MPI_BLOCKLIST **ret_list);
+static int  mpi_worker   (ESL_GETOPTS *go, struct cfg_s *cfg);
+static int  mpi_create_blocklist(ESL_SQFILE *dbfp, MPI_BLOCKLIST **ret_list);
+#endif /*HMMER_MPI*/
+
 
 static int
 process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_hmmfile, char **ret_seqfile)
@@ -233,6 +417,10 @@ process_commandline(int argc, char **argv, ESL_GETOPTS **ret_go, char **ret_hmmf
   /* Validate any attempted use of stdin streams */
   if (strcmp(*ret_hmmfile, "-") == 0 && strcmp(*ret_seqfile, "-") == 0) 
     { if (puts("Either <hmmfile> or <seqdb> may be '-' (to read from stdin), but not both.") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+#ifdef HMMER_MPI
+  if (esl_opt_GetBoolean(go, "--mpi") && strcmp(*ret_seqfile, "-") == 0)
+    { if (puts("With --mpi, <seqdb> must be a file that workers can open; it can't be read from stdin.") < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "write failed"); goto FAILURE; }
+#endif
 
   *ret_go = go;
   return eslOK;
@@ -257,11 +445,15 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *hmmfile, char *seqfile)
   if (                                                         fprintf(ofp, "# query HMM file:                                %s\n", hmmfile)                                          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (                                                         fprintf(ofp, "# target sequence database:                      %s\n", seqfile)                                          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (	                                                       fprintf(ofp, "# frameshift probability:                        %f\n", esl_opt_GetReal(go, "--fs"))                      < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
-  if (                                                         fprintf(ofp, "# codon translation table:                       %d\n", esl_opt_GetInteger(go, "--ct"))                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsOn(go, "--ctlist"))                    { if (fprintf(ofp, "# codon translation tables:                      %s\n", esl_opt_GetString(go, "--ctlist"))               < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed"); }
+  else if (                                                    fprintf(ofp, "# codon translation table:                       %d\n", esl_opt_GetInteger(go, "--ct"))                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "-o")                              && fprintf(ofp, "# output directed to file:                       %s\n",      esl_opt_GetString(go, "-o"))                 < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--tblout")                        && fprintf(ofp, "# per-seq hits tabular output:                   %s\n",      esl_opt_GetString(go, "--tblout"))           < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--fstblout")                      && fprintf(ofp, "# frameshift tabular output:                     %s\n",      esl_opt_GetString(go, "--fstblout"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "-A")                              && fprintf(ofp, "# MSA of all hits saved to file:                 %s (%s%s)\n", esl_opt_GetString(go, "-A"), esl_opt_GetString(go, "--Aformat"), esl_opt_GetBoolean(go, "--Amatch") ? ", consensus columns only" : "") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--hmmout")                        && fprintf(ofp, "# hmm output:                                    %s\n",      esl_opt_GetString(go, "--hmmout"))           < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--dpocc")                         && fprintf(ofp, "# DP occupancy stats saved to:                   %s\n",      esl_opt_GetString(go, "--dpocc"))            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--dpocc_ps")                      && fprintf(ofp, "# DP occupancy heatmaps saved to:                %s\n",      esl_opt_GetString(go, "--dpocc_ps"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--acc")                           && fprintf(ofp, "# prefer accessions over names:                  yes\n")                                                  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--noali")                         && fprintf(ofp, "# show alignments in output:                     no\n")                                                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--notextw")                       && fprintf(ofp, "# max ASCII text line length:                    unlimited\n")                                            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
@@ -284,8 +476,19 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *hmmfile, char *seqfile)
   if (esl_opt_IsUsed(go, "--nonull2")                       && fprintf(ofp, "# null2 bias corrections:                        off\n")                                                  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--fsonly")                        && fprintf(ofp, "# Use only the frameshift aware pipeline\n")                                                              < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed"); 
   if (esl_opt_IsUsed(go, "--nofs")                          && fprintf(ofp, "# Use only the non-frameshift aware pipeline\n")                                                          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--tmask")                         && fprintf(ofp, "# target masking:                                on [dust + SEG]\n")                                      < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--perfctr")                       && fprintf(ofp, "# hardware performance counters:                 on\n")                                                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--alloctrack")                    && fprintf(ofp, "# allocation accounting:                         on\n")                                                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--tmaskfile")                     && fprintf(ofp, "# precomputed target masks:                      %s\n",      esl_opt_GetString(go, "--tmaskfile"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--clusters")                      && fprintf(ofp, "# model clusters:                                on [screen once per cluster]\n")                       < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--clusterfile")                   && fprintf(ofp, "# model cluster map:                             %s\n",      esl_opt_GetString(go, "--clusterfile"))      < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--kseed")                         && fprintf(ofp, "# k-mer seed prefilter:                          on\n")                                                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--kseed_k")                       && fprintf(ofp, "# k-mer seed word length:                        %d\n",      esl_opt_GetInteger(go, "--kseed_k"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--kseed_T")                       && fprintf(ofp, "# k-mer seed score threshold:                    %g bits\n", esl_opt_GetReal(go, "--kseed_T"))            < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--restrictdb_stkey")              && fprintf(ofp, "# Restrict db to start at seq key:               %s\n",      esl_opt_GetString(go, "--restrictdb_stkey")) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--restrictdb_n")                  && fprintf(ofp, "# Restrict db to # target seqs:                  %d\n",      esl_opt_GetInteger(go, "--restrictdb_n"))    < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--regions")                       && fprintf(ofp, "# search restricted to regions in:               %s\n",      esl_opt_GetString(go, "--regions"))          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--regions_searched")              && fprintf(ofp, "# E-values from residues searched:               on\n")                                                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "--ssifile")                       && fprintf(ofp, "# Override ssi file to:                          %s\n",      esl_opt_GetString(go, "--ssifile"))          < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
 
   if (esl_opt_IsUsed(go, "-Z")                              && fprintf(ofp, "# database size is set to:                       %.1f Mb\n", esl_opt_GetReal(go, "-Z"))                   < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed"); 
@@ -300,6 +503,11 @@ output_header(FILE *ofp, const ESL_GETOPTS *go, char *hmmfile, char *seqfile)
   if (esl_opt_IsUsed(go, "--w_length")                      && fprintf(ofp, "# window length :                                %d\n",      esl_opt_GetInteger(go, "--w_length"))        < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed"); 
 #ifdef HMMER_THREADS
   if (esl_opt_IsUsed(go, "--cpu")                           && fprintf(ofp, "# number of worker threads:                      %d\n",      esl_opt_GetInteger(go, "--cpu"))             < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");  
+  if (esl_opt_IsUsed(go, "--fwd_cpu")                       && fprintf(ofp, "# threads for large envelope Forward:            %d\n",      esl_opt_GetInteger(go, "--fwd_cpu"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (esl_opt_IsUsed(go, "--progress")                      && fprintf(ofp, "# progress reports written to:                   %s\n",      esl_opt_GetString(go, "--progress"))         < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#endif
+#ifdef HMMER_MPI
+  if (esl_opt_IsUsed(go, "--mpi")                           && fprintf(ofp, "# parallelization mode:                          MPI\n")                                                  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
 #endif
   if (esl_opt_IsUsed(go, "-l")                              && fprintf(ofp, "# minimum ORF length:                            %d\n",      esl_opt_GetInteger(go, "-l"))                < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
   if (esl_opt_IsUsed(go, "-m")                              && fprintf(ofp, "# ORFs must initiate with AUG only:              yes\n")                                                  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
@@ -329,6 +537,9 @@ main(int argc, char **argv)
   cfg.qfmt         = eslSQFILE_UNKNOWN;
   cfg.firstseq_key = NULL;
   cfg.n_targetseq  = -1;
+  cfg.do_mpi       = FALSE;	/* this gets reset below, if we init MPI */
+  cfg.nproc        = 0;		/* this gets reset below, if we init MPI */
+  cfg.my_rank      = 0;		/* this gets reset below, if we init MPI */
   process_commandline(argc, argv, &go, &cfg.queryfile, &cfg.dbfile);    
 
   if (esl_opt_IsOn(go, "--qformat")) { /* is this an msa or a single sequence file? */
@@ -345,7 +556,7 @@ main(int argc, char **argv)
 /* is the range restricted? */
 
 #ifndef eslAUGMENT_SSI
-  if (esl_opt_IsUsed(go, "--restrictdb_stkey") || esl_opt_IsUsed(go, "--restrictdb_n")  || esl_opt_IsUsed(go, "--ssifile")  )
+  if (esl_opt_IsUsed(go, "--restrictdb_stkey") || esl_opt_IsUsed(go, "--restrictdb_n")  || esl_opt_IsUsed(go, "--ssifile") || esl_opt_IsUsed(go, "--regions") )
     p7_Fail("Unable to use range-control options unless an SSI index file is available. See 'esl_sfetch --index'\n");
 #else
   if (esl_opt_IsUsed(go, "--restrictdb_stkey") )
@@ -358,7 +569,26 @@ main(int argc, char **argv)
 
 #endif
 
-  status = serial_master(go, &cfg);
+  /* Figure out who we are, and send control there: 
+   * we might be an MPI master, an MPI worker, or a serial program.
+   */
+#ifdef HMMER_MPI
+  if (esl_opt_GetBoolean(go, "--mpi")) 
+    {
+      cfg.do_mpi     = TRUE;
+      MPI_Init(&argc, &argv);
+      MPI_Comm_rank(MPI_COMM_WORLD, &(cfg.my_rank));
+      MPI_Comm_size(MPI_COMM_WORLD, &(cfg.nproc));
+      if (cfg.nproc < 2) p7_Fail("--mpi requires at least 2 MPI processes (one master, one or more workers)\n");
+
+      if (cfg.my_rank > 0)  status = mpi_worker(go, &cfg);
+      else                  status = serial_master(go, &cfg);
+
+      MPI_Finalize();
+    }
+  else
+#endif /*HMMER_MPI*/
+    status = serial_master(go, &cfg);
 
   esl_getopts_Destroy(go);
 
@@ -439,9 +669,589 @@ bath_open_seq_file (struct cfg_s *cfg, ESL_SQFILE **qfp_sq, ESL_ALPHABET **abc,
     return status;
 }
 
+/* open_tmaskdb()
+ * If target masking is on, load the precomputed masks for <dbfile>:
+ * the --tmaskfile if given, else <dbfile>.bmask if bathmask has written
+ * one. If there is none, <*ret_db> is NULL and masks are computed on
+ * the fly. Fails with a user error if a mask file can't be read.
+ */
+static int
+open_tmaskdb(ESL_GETOPTS *go, char *dbfile, P7_TMASKDB **ret_db)
+{
+  char  errbuf[eslERRBUFSIZE];
+  char *maskfile = NULL;
+  FILE *fp;
+  int   status;
+
+  *ret_db = NULL;
+  if (! esl_opt_GetBoolean(go, "--tmask")) return eslOK;
+
+  if (esl_opt_IsOn(go, "--tmaskfile"))
+    {
+      if ((status = esl_strdup(esl_opt_GetString(go, "--tmaskfile"), -1, &maskfile)) != eslOK) goto ERROR;
+    }
+  else
+    {
+      if ((status = esl_sprintf(&maskfile, "%s.bmask", dbfile)) != eslOK) goto ERROR;
+      if ((fp = fopen(maskfile, "r")) == NULL) { free(maskfile); return eslOK; }
+      fclose(fp);
+    }
+
+  status = p7_tmaskdb_Read(maskfile, ret_db, errbuf);
+  if      (status == eslENOTFOUND || status == eslEFORMAT) p7_Fail("Failed to read target masks: %s\n", errbuf);
+  else if (status != eslOK)                                goto ERROR;
+
+  free(maskfile);
+  return eslOK;
+
+ ERROR:
+  if (maskfile) free(maskfile);
+  return status;
+}
+
+/* create_gencodes()
+ * The genetic codes to search with: the one NCBI table --ct names, or
+ * each table in the comma-separated --ctlist, in order. Each allows
+ * ORF initiation as -m/-M say. Fails with a user error on a table id
+ * that isn't one, or is listed twice.
+ */
+static int
+create_gencodes(ESL_GETOPTS *go, const ESL_ALPHABET *abcDNA, const ESL_ALPHABET *abcAA, ESL_GENCODE ***ret_gcodes, int *ret_ncodes)
+{
+  ESL_GENCODE **gcodes = NULL;
+  char         *list   = NULL;
+  char         *s;
+  char         *tok;
+  int           nalloc = 1;
+  int           ncodes = 0;
+  int           ct, c;
+  int           status;
+
+  if (esl_opt_IsOn(go, "--ctlist"))
+    for (s = esl_opt_GetString(go, "--ctlist"); *s != '\0'; s++)
+      if (*s == ',') nalloc++;
+  ESL_ALLOC(gcodes, sizeof(ESL_GENCODE *) * nalloc);
+
+  if (esl_opt_IsOn(go, "--ctlist")) {
+    if ((status = esl_strdup(esl_opt_GetString(go, "--ctlist"), -1, &list)) != eslOK) goto ERROR;
+    s = list;
+  }
+
+  do {
+    if (list == NULL) ct = esl_opt_GetInteger(go, "--ct");
+    else {
+      if (esl_strtok(&s, ",", &tok) != eslOK) break;
+      if (esl_str_IsInteger(tok) != eslOK) p7_Fail("--ctlist: '%s' is not a translation table id\n", tok);
+      ct = atoi(tok);
+      for (c = 0; c < ncodes; c++)
+        if (gcodes[c]->transl_table == ct) p7_Fail("--ctlist: translation table %d is listed twice\n", ct);
+    }
+
+    if ((gcodes[ncodes] = esl_gencode_Create(abcDNA, abcAA)) == NULL) { status = eslEMEM; goto ERROR; }
+    ncodes++;
+    if (esl_gencode_Set(gcodes[ncodes-1], ct) != eslOK) p7_Fail("%d is not an NCBI translation table id (see end of help)\n", ct);
+
+    if      (esl_opt_GetBoolean(go, "-m"))   esl_gencode_SetInitiatorOnlyAUG(gcodes[ncodes-1]);
+    else if (! esl_opt_GetBoolean(go, "-M")) esl_gencode_SetInitiatorAny(gcodes[ncodes-1]);      // note this is the default, if neither -m nor -M are set
+  } while (list != NULL && ncodes < nalloc);
+
+  if (ncodes == 0) p7_Fail("--ctlist: no translation table ids given\n");
+
+  if (list) free(list);
+  *ret_gcodes = gcodes;
+  *ret_ncodes = ncodes;
+  return eslOK;
+
+ ERROR:
+  if (list) free(list);
+  destroy_gencodes(gcodes, ncodes);
+  *ret_gcodes = NULL;
+  *ret_ncodes = 0;
+  return status;
+}
+
+static void
+destroy_gencodes(ESL_GENCODE **gcodes, int ncodes)
+{
+  int c;
+
+  if (gcodes == NULL) return;
+  for (c = 0; c < ncodes; c++) esl_gencode_Destroy(gcodes[c]);
+  free(gcodes);
+}
+
+/* xcodes_Create()
+ * Give worker <info> a frameshift profile of query <hmm>, and
+ * translation workstates, for each genetic code after the first,
+ * <gcodes[1..ncodes-1]>. The worker's own <gcode>, <gm_fs>, <wrk1>
+ * and <wrk2> are those of <gcodes[0]>.
+ */
+static int
+xcodes_Create(ESL_GETOPTS *go, WORKER_INFO *info, P7_HMM *hmm, ESL_GENCODE **gcodes, int ncodes)
+{
+  XCODE *xc;
+  int    c;
+  int    status;
+
+  info->ct     = gcodes[0]->transl_table;
+  info->xcode  = NULL;
+  info->nxcode = 0;
+  if (ncodes < 2) return eslOK;
+
+  ESL_ALLOC(info->xcode, sizeof(XCODE) * (ncodes-1));
+  for (c = 1; c < ncodes; c++)
+  {
+    xc = info->xcode + info->nxcode;
+    xc->ct    = gcodes[c]->transl_table;
+    xc->gcode = gcodes[c];
+    xc->gm_fs = NULL;
+    xc->wrk1  = NULL;
+    xc->wrk2  = NULL;
+    info->nxcode++;
+
+    if ((xc->gm_fs = p7_profile_fs_Create(hmm->M, hmm->abc))                           == NULL)  { status = eslEMEM; goto ERROR; }
+    if ((status = p7_ProfileConfig_fs(hmm, info->bg, gcodes[c], xc->gm_fs, 100, p7_LOCAL)) != eslOK) goto ERROR;
+    if ((xc->wrk1 = esl_gencode_WorkstateCreate(go, gcodes[c]))                        == NULL)  { status = eslEMEM; goto ERROR; }
+    if ((xc->wrk1->orf_block = esl_sq_CreateDigitalBlock(BLOCK_SIZE, hmm->abc))        == NULL)  { status = eslEMEM; goto ERROR; }
+    if ((xc->wrk2 = esl_gencode_WorkstateCreate(go, gcodes[c]))                        == NULL)  { status = eslEMEM; goto ERROR; }
+    if ((xc->wrk2->orf_block = esl_sq_CreateDigitalBlock(BLOCK_SIZE, hmm->abc))        == NULL)  { status = eslEMEM; goto ERROR; }
+  }
+  return eslOK;
+
+ ERROR:
+  xcodes_Destroy(info);
+  return status;
+}
+
+static void
+xcodes_Destroy(WORKER_INFO *info)
+{
+  XCODE *xc;
+  int    c;
+
+  for (c = 0; c < info->nxcode; c++)
+  {
+    xc = info->xcode + c;
+    if (xc->gm_fs) p7_profile_fs_Destroy(xc->gm_fs);
+    if (xc->wrk1)  { esl_sq_DestroyBlock(xc->wrk1->orf_block); esl_gencode_WorkstateDestroy(xc->wrk1); }
+    if (xc->wrk2)  { esl_sq_DestroyBlock(xc->wrk2->orf_block); esl_gencode_WorkstateDestroy(xc->wrk2); }
+  }
+  if (info->xcode) free(info->xcode);
+  info->xcode  = NULL;
+  info->nxcode = 0;
+}
+
+/* open_clusters()
+ * With --clusters, read the model cluster map for the query library
+ * <hmmfile> (the --clusterfile, else <hmmfile>.bclust, as written by
+ * bathcluster), and pull the representative of each cluster of more
+ * than one model out of the library, with its window length raised
+ * to the longest of its cluster so that screened windows overlap
+ * enough for any member. <*ret_rephmm> is indexed by cluster, NULL
+ * for single-model clusters. Fails with a user error if the map
+ * can't be read or names a representative the library lacks.
+ */
+static int
+open_clusters(ESL_GETOPTS *go, char *hmmfile, ESL_ALPHABET **byp_abc, P7_HMMCLUSTERS **ret_hc, P7_HMM ***ret_rephmm)
+{
+  char            errbuf[eslERRBUFSIZE];
+  char           *mapfile = NULL;
+  P7_HMMCLUSTERS *hc      = NULL;
+  P7_HMM        **rephmm  = NULL;
+  P7_HMMFILE     *hfp     = NULL;
+  P7_HMM         *hmm     = NULL;
+  int             c;
+  int             status;
+
+  *ret_hc     = NULL;
+  *ret_rephmm = NULL;
+  if (! esl_opt_GetBoolean(go, "--clusters")) return eslOK;
+
+  if (esl_opt_IsOn(go, "--clusterfile")) { if ((status = esl_strdup(esl_opt_GetString(go, "--clusterfile"), -1, &mapfile)) != eslOK) goto ERROR; }
+  else                                   { if ((status = esl_sprintf(&mapfile, "%s.bclust", hmmfile))                       != eslOK) goto ERROR; }
+
+  status = p7_hmmclusters_Read(mapfile, &hc, errbuf);
+  if      (status == eslENOTFOUND || status == eslEFORMAT) p7_Fail("Failed to read model clusters: %s\n(run bathcluster on %s first?)\n", errbuf, hmmfile);
+  else if (status != eslOK)                                goto ERROR;
+
+  ESL_ALLOC(rephmm, sizeof(P7_HMM *) * ESL_MAX(1, hc->nclust));
+  for (c = 0; c < hc->nclust; c++) rephmm[c] = NULL;
+
+  if (p7_hmmfile_OpenE(hmmfile, NULL, &hfp, errbuf) != eslOK) p7_Fail("Failed to reopen HMM file %s for cluster representatives\n%s\n", hmmfile, errbuf);
+#ifdef HMMER_THREADS
+  if (p7_hmmfile_SetParallel(hfp, ESL_MAX(1, esl_opt_GetInteger(go, "--cpu"))) != eslOK) p7_Fail("Failed to map HMM file %s for parallel parsing\n", hmmfile);
+#endif
+  while ((status = p7_hmmfile_Read(hfp, byp_abc, &hmm)) == eslOK)
+    {
+      if (p7_hmmclusters_Lookup(hc, hmm->name, &c) == eslOK && hc->size[c] > 1 && strcmp(hc->name[hc->rep[c]], hmm->name) == 0)
+        {
+          if (hmm->max_length == -1) p7_Builder_MaxLength(hmm, p7_DEFAULT_WINDOW_BETA);
+          hmm->max_length = ESL_MAX(hmm->max_length, hc->maxW[c]);
+          rephmm[c] = hmm;
+        }
+      else p7_hmm_Destroy(hmm);
+      hmm = NULL;
+    }
+  if (status != eslEOF) p7_Fail("Failed to read cluster representatives from HMM file %s (%d)\n", hmmfile, status);
+
+  for (c = 0; c < hc->nclust; c++)
+    if (hc->size[c] > 1 && rephmm[c] == NULL)
+      p7_Fail("Representative %s of model cluster %d is not in HMM file %s; was the cluster map made from another library?\n", hc->name[hc->rep[c]], c, hmmfile);
+
+  p7_hmmfile_Close(hfp);
+  free(mapfile);
+  *ret_hc     = hc;
+  *ret_rephmm = rephmm;
+  return eslOK;
+
+ ERROR:
+  if (hfp)     p7_hmmfile_Close(hfp);
+  if (mapfile) free(mapfile);
+  if (rephmm) { for (c = 0; c < hc->nclust; c++) if (rephmm[c]) p7_hmm_Destroy(rephmm[c]); free(rephmm); }
+  if (hc)      p7_hmmclusters_Destroy(hc);
+  return status;
+}
+
+/* cluster_cache_Create()
+ * An empty window cache for one cluster.
+ */
+static CLUSTER_CACHE *
+cluster_cache_Create(void)
+{
+  CLUSTER_CACHE *cc = NULL;
+  int            status;
+
+  ESL_ALLOC(cc, sizeof(CLUSTER_CACHE));
+  cc->win            = NULL;
+  cc->nwin           = 0;
+  cc->nalloc         = 0;
+  cc->nres           = 0;
+  cc->nseqs          = 0;
+  cc->nleft          = 0;
+  cc->id_length_list = init_id_length(1000);
+#ifdef HMMER_THREADS
+  if (pthread_mutex_init(&cc->mutex, NULL) != 0) { destroy_id_length(cc->id_length_list); free(cc); return NULL; }
+#endif
+  return cc;
+
+ ERROR:
+  return NULL;
+}
+
+/* cluster_pipeline()
+ * A pipeline for screening with representative <om>: the members' F1
+ * and F2 relaxed by p7_HMMCLUSTER_FRELAX, since a member scores its
+ * windows a little differently than its representative does, and
+ * otherwise set up like the member pipeline in <info>.
+ */
+static P7_PIPELINE *
+cluster_pipeline(ESL_GETOPTS *go, WORKER_INFO *info, P7_OPROFILE *om)
+{
+  P7_PIPELINE *pli = p7_pipeline_fs_Create(go, om->M, 300, TRUE, p7_SEARCH_SEQS);
+
+  if (pli == NULL) return NULL;
+  if (p7_pli_NewModel(pli, om, info->bg) == eslEINVAL) p7_Fail(pli->errbuf);
+  pli->F1           = ESL_MIN(1.0, pli->F1 * p7_HMMCLUSTER_FRELAX);
+  pli->F2           = ESL_MIN(1.0, pli->F2 * p7_HMMCLUSTER_FRELAX);
+  pli->strands      = info->pli->strands;
+  pli->block_length = info->pli->block_length;
+  pli->tmaskdb      = info->pli->tmaskdb;
+  return pli;
+}
+
+/* cluster_screen()
+ * Mask window <dbsq>, and if some ORF in it passes the MSV, bias and
+ * Viterbi filters of the representative in <info>, add a copy of it to
+ * <cc>. Called by the worker threads concurrently.
+ */
+static int
+cluster_screen(WORKER_INFO *info, CLUSTER_CACHE *cc, ESL_SQ *dbsq)
+{
+  int pass;
+  int status;
+
+  dbsq->L = dbsq->n;
+  if ((status = p7_pli_MaskTarget(info->pli, info->gcode, dbsq))                                        != eslOK) return status;
+  if ((status = p7_pli_BATH_Prescreen(info->pli, info->om, info->bg, dbsq, info->wrk1, info->gcode, &pass)) != eslOK) return status;
+  if (! pass) return eslOK;
+
+#ifdef HMMER_THREADS
+  pthread_mutex_lock(&cc->mutex);
+#endif
+  if (cc->nwin == cc->nalloc) {
+    cc->nalloc = ESL_MAX(64, cc->nalloc * 2);
+    ESL_REALLOC(cc->win, sizeof(ESL_SQ *) * cc->nalloc);
+  }
+  if ((cc->win[cc->nwin] = esl_sq_CreateDigital(dbsq->abc)) == NULL) { status = eslEMEM; goto ERROR; }
+  if ((status = esl_sq_Copy(dbsq, cc->win[cc->nwin])) != eslOK) goto ERROR;
+  cc->nwin++;
+#ifdef HMMER_THREADS
+  pthread_mutex_unlock(&cc->mutex);
+#endif
+  return eslOK;
+
+ ERROR:
+#ifdef HMMER_THREADS
+  pthread_mutex_unlock(&cc->mutex);
+#endif
+  return status;
+}
+
+/* cluster_window_sorter()
+ * qsort() order of cached windows: by target, then by position, so
+ * that a threaded screen gives the same cache as a serial one.
+ */
+static int
+cluster_window_sorter(const void *vw1, const void *vw2)
+{
+  const ESL_SQ *w1 = *((const ESL_SQ **) vw1);
+  const ESL_SQ *w2 = *((const ESL_SQ **) vw2);
+
+  if (w1->idx   != w2->idx)   return (w1->idx   < w2->idx)   ? -1 : 1;
+  if (w1->start != w2->start) return (w1->start < w2->start) ? -1 : 1;
+  return 0;
+}
+
+/* cluster_sweep()
+ * Screen the whole target database with <rephmm>, the representative
+ * of a model cluster, and return in <*ret_cc> a copy of every window
+ * in which some ORF passes its (relaxed) MSV, bias and Viterbi
+ * filters. Runs serially on <info>'s null model and translation
+ * workspace; cluster_thread_sweep() is the threaded version. Returns
+ * the final read status, as serial_loop() does.
+ */
+static int
+cluster_sweep(ESL_GETOPTS *go, WORKER_INFO *info, P7_HMM *rephmm, ESL_SQFILE *dbfp, CLUSTER_CACHE **ret_cc)
+{
+  CLUSTER_CACHE *cc      = NULL;
+  P7_PROFILE    *gm      = NULL;
+  WORKER_INFO    rinfo   = *info;   /* <info>, with the representative's profile and pipeline */
+  ESL_SQ        *dbsq    = NULL;
+  int64_t        seq_id  = 0;
+  int            sstatus = eslOK;
+  int            status;
+
+  rinfo.om  = NULL;
+  rinfo.pli = NULL;
+  if ((cc = cluster_cache_Create()) == NULL) { status = eslEMEM; goto ERROR; }
+
+  gm       = p7_profile_Create (rephmm->M, rephmm->abc);
+  rinfo.om = p7_oprofile_Create(rephmm->M, rephmm->abc);
+  p7_ProfileConfig(rephmm, info->bg, gm, 100, p7_LOCAL);
+  p7_oprofile_Convert(gm, rinfo.om);
+  if ((rinfo.pli = cluster_pipeline(go, info, rinfo.om)) == NULL) { status = eslEMEM; goto ERROR; }
+
+  dbsq    = esl_sq_CreateDigital(info->gcode->nt_abc);
+  sstatus = esl_sqio_ReadWindow(dbfp, 0, rinfo.pli->block_length, dbsq);
+  while (sstatus == eslOK)
+  {
+    dbsq->idx = seq_id;
+    if ((status = cluster_screen(&rinfo, cc, dbsq)) != eslOK) goto ERROR;
+
+    sstatus = esl_sqio_ReadWindow(dbfp, rinfo.om->max_length, rinfo.pli->block_length, dbsq);
+    if (sstatus == eslEOD)
+    {
+      add_id_length(cc->id_length_list, dbsq->idx, dbsq->L);
+      cc->nseqs++;
+      esl_sq_Reuse(dbsq);
+      sstatus = esl_sqio_ReadWindow(dbfp, 0, rinfo.pli->block_length, dbsq);
+      seq_id++;
+    }
+  }
+  cc->nres = rinfo.pli->nres;
+
+  esl_sq_Destroy(dbsq);
+  p7_pipeline_fs_Destroy(rinfo.pli);
+  p7_oprofile_Destroy(rinfo.om);
+  p7_profile_Destroy(gm);
+  *ret_cc = cc;
+  return sstatus;
+
+ ERROR:
+  if (dbsq)      esl_sq_Destroy(dbsq);
+  if (rinfo.pli) p7_pipeline_fs_Destroy(rinfo.pli);
+  if (rinfo.om)  p7_oprofile_Destroy(rinfo.om);
+  if (gm)        p7_profile_Destroy(gm);
+  cluster_cache_Destroy(cc);
+  *ret_cc = NULL;
+  return status;
+}
+
+/* cluster_rerun()
+ * Search the windows a cluster's representative kept with the query
+ * in <info>, then set the pipeline's residue and sequence counts to
+ * those of the full database, so E-values and the summary come out as
+ * for a full pass.
+ */
+static int
+cluster_rerun(WORKER_INFO *info, CLUSTER_CACHE *cc)
+{
+  int i;
+
+  for (i = 0; i < cc->nwin; i++)
+    search_window(info, cc->win[i]);
+
+  info->pli->nres  = cc->nres;
+  info->pli->nseqs = cc->nseqs;
+  return eslOK;
+}
+
+static void
+cluster_cache_Destroy(CLUSTER_CACHE *cc)
+{
+  int i;
+
+  if (cc == NULL) return;
+  for (i = 0; i < cc->nwin; i++) esl_sq_Destroy(cc->win[i]);
+  if (cc->win)            free(cc->win);
+  if (cc->id_length_list) destroy_id_length(cc->id_length_list);
+#ifdef HMMER_THREADS
+  pthread_mutex_destroy(&cc->mutex);
+#endif
+  free(cc);
+}
+
+/* open_regions()
+ * With --regions, read the target intervals from its BED file, and
+ * look up in <dbfp>'s SSI index the full length of each sequence they
+ * are on, and the size of the whole database. Fails with a user error
+ * if there's no SSI index, or if an interval is on a sequence the
+ * database lacks or runs off its end.
+ */
+static int
+open_regions(ESL_GETOPTS *go, ESL_SQFILE *dbfp, REGIONS **ret_rg)
+{
+  char      errbuf[eslERRBUFSIZE];
+  REGIONS  *rg = NULL;
+  ESL_SSI  *ssi;
+  P7_TMASK *tm;
+  uint16_t  fh;
+  off_t     roff;
+  int64_t   L;
+  int64_t   k;
+  int       i;
+  int       status;
+
+  *ret_rg = NULL;
+  if (! esl_opt_IsOn(go, "--regions")) return eslOK;
+
+  if (esl_sqfile_OpenSSI(dbfp, esl_opt_GetString(go, "--ssifile")) != eslOK)
+    p7_Fail("--regions needs an SSI index of %s. See 'esl-sfetch --index'\n", dbfp->filename);
+  ssi = dbfp->data.ascii.ssi;
+
+  ESL_ALLOC(rg, sizeof(REGIONS));
+  rg->db    = NULL;
+  rg->L     = NULL;
+  rg->dbres = 0;
+
+  status = p7_tmaskdb_Read(esl_opt_GetString(go, "--regions"), &(rg->db), errbuf);
+  if      (status == eslENOTFOUND || status == eslEFORMAT) p7_Fail("Failed to read --regions file: %s\n", errbuf);
+  else if (status != eslOK)                                goto ERROR;
+
+  ESL_ALLOC(rg->L, sizeof(int64_t) * ESL_MAX(1, rg->db->nmask));
+  for (i = 0; i < rg->db->nmask; i++)
+    {
+      tm = rg->db->mask[i];
+      if (esl_ssi_FindName(ssi, tm->name, &fh, &roff, NULL, &(rg->L[i])) != eslOK)
+        p7_Fail("--regions names sequence %s, which is not in %s\n", tm->name, dbfp->filename);
+      if (rg->L[i] <= 0)
+        p7_Fail("SSI index of %s has no sequence lengths; rebuild it with 'esl-sfetch --index'\n", dbfp->filename);
+      if (tm->nseg > 0 && tm->seg[tm->nseg-1].end > rg->L[i])
+        p7_Fail("--regions interval ending at %" PRId64 " runs off the end of %s (length %" PRId64 ")\n", tm->seg[tm->nseg-1].end, tm->name, rg->L[i]);
+    }
+
+  for (k = 0; k < ssi->nprimary; k++)
+    {
+      if ((status = esl_ssi_FindNumber(ssi, k, &fh, &roff, NULL, &L, NULL)) != eslOK) goto ERROR;
+      rg->dbres += L;
+    }
+
+  *ret_rg = rg;
+  return eslOK;
+
+ ERROR:
+  regions_Destroy(rg);
+  return status;
+}
+
+/* regions_loop()
+ * With --regions, search each interval of <rg>, widened on both sides
+ * by the query's window length so that hits reaching past its ends
+ * are found whole. Intervals whose widened spans touch are searched
+ * as one. Each span is fetched through the SSI index, in blocks that
+ * overlap by the window length as serial_loop() reads them, so hits
+ * keep their coordinates in the full sequence. Runs serially on
+ * <info>. Returns <eslOK>, or the error status of a failed fetch.
+ */
+static int
+regions_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_SQFILE *dbfp, REGIONS *rg)
+{
+  ESL_SQ   *dbsq  = esl_sq_CreateDigital(info->gcode->nt_abc);
+  P7_TMASK *tm;
+  int64_t   W     = info->om->max_length;
+  int64_t   B     = info->pli->block_length;
+  int64_t   beg, end;
+  int64_t   wbeg, wend;
+  int       idx, s;
+  int       status;
+
+  for (idx = 0; idx < rg->db->nmask; idx++)
+  {
+    tm = rg->db->mask[idx];
+    for (s = 0; s < tm->nseg; s++)
+    {
+      beg = ESL_MAX(1,          tm->seg[s].beg - W);
+      end = ESL_MIN(rg->L[idx], tm->seg[s].end + W);
+      while (s+1 < tm->nseg && tm->seg[s+1].beg - W <= end + 1)
+        end = ESL_MIN(rg->L[idx], tm->seg[++s].end + W);
+
+      for (wbeg = beg; ; wbeg += ESL_MAX(1, B - W))
+      {
+        wend = ESL_MIN(end, wbeg + B - 1);
+        esl_sq_Reuse(dbsq);
+        if ((status = esl_sqio_FetchSubseq(dbfp, tm->name, wbeg, wend, dbsq)) != eslOK) goto ERROR;
+        if ((status = esl_sq_SetName(dbsq, tm->name))                         != eslOK) goto ERROR;
+        dbsq->idx   = idx;
+        dbsq->start = wbeg;
+        dbsq->end   = wend;
+        dbsq->C     = (wbeg > beg) ? ESL_MIN(W, dbsq->n) : 0; /* context already searched in the previous block */
+        dbsq->W     = dbsq->n - dbsq->C;
+
+        if (dbsq->n >= 15) search_window(info, dbsq); /* do not process sequence of less than 5 codons */
+#ifdef HMMER_THREADS
+        if (info->progress != NULL) progress_Publish(info->progress, info->wid, info->pli, info->th);
+#endif
+        if (wend == end) break;
+      }
+    }
+    add_id_length(id_length_list, idx, rg->L[idx]);
+    info->pli->nseqs++;
+  }
+
+  esl_sq_Destroy(dbsq);
+  return eslOK;
+
+ ERROR:
+  esl_sq_Destroy(dbsq);
+  return status;
+}
+
+static void
+regions_Destroy(REGIONS *rg)
+{
+  if (rg == NULL) return;
+  if (rg->db) p7_tmaskdb_Destroy(rg->db);
+  if (rg->L)  free(rg->L);
+  free(rg);
+}
+
 /* serial_master()
  * The serial version of bathsearch.
  * For each query HMM search the target database for hits.
+ *
+ * With --mpi, rank 0 runs this same routine: it reads the queries and
+ * writes all output, but hands each query's search to the MPI workers
+ * (see mpi_search()) instead of running it in local threads.
  * 
  * A master can only return if it's successful. All errors are handled
  * immediately and fatally with p7_Fail().  We also use the
@@ -458,7 +1268,11 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   FILE            *ofp                      = stdout;            /* results output file (-o)                        */
   FILE            *tblfp                    = NULL;              /* output stream for tabular per-seq (--tblout)    */
   FILE            *fstblfp                  = NULL;              /* output stream for tabular per-ali (--fstblout)  */
+  FILE            *afp                      = NULL;              /* output stream for alignment of hits (-A)        */
+  int              afmt                     = p7_STREAMALI_STOCKHOLM;
   FILE            *hmmoutfp                 = NULL;              /* output stream for hmms (--hmmout),  only if input is an alignment file    */  
+  FILE            *occfp                    = NULL;              /* output stream for DP occupancy stats (--dpocc)  */
+  FILE            *occpsfp                  = NULL;              /* output stream for occupancy heatmaps (--dpocc_ps) */
   char            *hmmfile                  = NULL;              /* file to write HMM to                            */
   int              force_single             = ( esl_opt_IsOn(go, "--singlemx") ? TRUE : FALSE );
   int              textw                    = 0;
@@ -469,6 +1283,12 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   ESL_MSAFILE     *qfp_msa                  = NULL;              /* open query alifile                              */
   ESL_SQFILE      *qfp_sq                   = NULL;              /* open query seqfile                              */
   int              dbfmt                    = eslSQFILE_UNKNOWN; /* format code for sequence database file          */
+  P7_TMASKDB      *tmaskdb                  = NULL;              /* precomputed target masks (--tmask), or NULL     */
+  P7_HMMCLUSTERS  *clusters                 = NULL;              /* model cluster map (--clusters), or NULL         */
+  P7_HMM         **rephmm                   = NULL;              /* rephmm[c]: representative of cluster c, or NULL */
+  CLUSTER_CACHE  **ccache                   = NULL;              /* ccache[c]: windows kept for cluster c, or NULL  */
+  int              cl                       = -1;                /* cluster of the current query, if screened by it */
+  REGIONS         *regions                  = NULL;              /* target intervals to search (--regions), or NULL */
   
   /* query formats and HMM construction*/
   P7_HMM          *hmm                      = NULL;              /* one HMM query                                   */
@@ -484,10 +1304,13 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   ESL_ALPHABET    *abcAA                    = NULL;              /* AA  query  alphabet                                */
   ESL_ALPHABET    *abcDNA                   = NULL;              /* DNA target alphabet                              */
   ESL_GENCODE     *gcode                    = NULL;
+  ESL_GENCODE    **gcodes                   = NULL;              /* every code searched (--ctlist); gcode = gcodes[0] */
+  int              ncodes                   = 0;
  
  /* worker and worker items */ 
   WORKER_INFO     *info                     = NULL;
   P7_SCOREDATA    *scoredata                = NULL;              
+  P7_SEEDINDEX    *seeds                    = NULL;              /* per-query k-mer seed index (--kseed), or NULL   */
   P7_FS_PROFILE   *gm_fs                    = NULL;
   P7_PROFILE      *gm                       = NULL;
   P7_OPROFILE     *om                       = NULL;       /* optimized query profile                  */
@@ -496,6 +1319,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   int64_t          resCnt                   = 0;
   P7_TOPHITS      *tophits_accumulator      = NULL; /* to hold the top hits information from all 6 frame translations     */
   P7_PIPELINE     *pipelinehits_accumulator = NULL; /* to hold the pipeline hit information from all 6 frame translations */
+  P7_DPOCC        *occ_accumulator          = NULL; /* DP occupancy statistics from all workers (--dpocc)                 */
   ID_LENGTH_LIST  *id_length_list           = NULL;
   ESL_STOPWATCH   *watch;
   
@@ -508,6 +1332,12 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   ESL_SQ_BLOCK    *block                    = NULL;
   ESL_THREADS     *threadObj                = NULL;
   ESL_WORK_QUEUE  *queue                    = NULL;
+  PROGRESS        *progress                 = NULL;              /* live progress reporting (--progress)           */
+  FILE            *progfp                   = NULL;
+  int64_t          dbres                    = 0;                 /* residues per db pass, for progress estimates   */
+#endif
+#ifdef HMMER_MPI
+  MPI_BLOCKLIST   *blocklist                = NULL;              /* target db blocks handed out to MPI workers    */
 #endif
 
   /*error handeling */
@@ -616,11 +1446,34 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     else
       esl_sqfile_OpenSSI(dbfp, NULL);
   }
+  if (open_tmaskdb(go, cfg->dbfile, &tmaskdb) != eslOK) p7_Fail("Failed to load target masks\n");
+  if (open_regions(go, dbfp, &regions)        != eslOK) p7_Fail("Failed to load target regions\n");
+
+  if (esl_opt_GetBoolean(go, "--alloctrack") && p7_alloctrack_Enable() != eslOK)
+    p7_Fail("--alloctrack needs a build configured with --enable-alloctrack\n");
+
+  if (esl_opt_GetBoolean(go, "--clusters")) {
+    if (hfp == NULL || strcmp(cfg->queryfile, "-") == 0)
+      p7_Fail("--clusters needs a query file of HMMs (not stdin), clustered with bathcluster\n");
+    if (esl_opt_IsUsed(go, "--restrictdb_stkey") || esl_opt_IsUsed(go, "--restrictdb_n"))
+      p7_Fail("--clusters can't be used with --restrictdb_stkey or --restrictdb_n\n");
+    if (open_clusters(go, cfg->queryfile, &abcAA, &clusters, &rephmm) != eslOK) p7_Fail("Failed to load model clusters\n");
+    ESL_ALLOC(ccache, sizeof(CLUSTER_CACHE *) * ESL_MAX(1, clusters->nclust));
+    for (i = 0; i < clusters->nclust; i++) ccache[i] = NULL;
+  }
 
   /* Open the results output files */
   if (esl_opt_IsOn(go, "-o"))          { if ((ofp      = fopen(esl_opt_GetString(go, "-o"), "w")) == NULL) p7_Fail("Failed to open output file %s for writing\n",    esl_opt_GetString(go, "-o")); }
   if (esl_opt_IsOn(go, "--tblout"))    { if ((tblfp    = fopen(esl_opt_GetString(go, "--tblout"),    "w")) == NULL)  esl_fatal("Failed to open tabular per-seq output file %s for writing\n", esl_opt_GetString(go, "--tblout")); }
   if (esl_opt_IsOn(go, "--fstblout"))    { if ((fstblfp    = fopen(esl_opt_GetString(go, "--fstblout"),    "w")) == NULL)  esl_fatal("Failed to open tabular per-ali frameshift file %s for writing\n", esl_opt_GetString(go, "--fstblout")); }
+  if (esl_opt_IsOn(go, "-A"))          { if ((afp      = fopen(esl_opt_GetString(go, "-A"), "w")) == NULL) p7_Fail("Failed to open alignment file %s for writing\n", esl_opt_GetString(go, "-A"));
+                                         if      (strcasecmp(esl_opt_GetString(go, "--Aformat"), "stockholm") == 0) afmt = p7_STREAMALI_STOCKHOLM;
+                                         else if (strcasecmp(esl_opt_GetString(go, "--Aformat"), "a2m")       == 0) afmt = p7_STREAMALI_A2M;
+                                         else if (strcasecmp(esl_opt_GetString(go, "--Aformat"), "psiblast")  == 0) afmt = p7_STREAMALI_PSIBLAST;
+                                         else p7_Fail("--Aformat must be stockholm, a2m, or psiblast; not %s\n", esl_opt_GetString(go, "--Aformat")); }
+  if (esl_opt_IsOn(go, "--dpocc"))       { if ((occfp      = fopen(esl_opt_GetString(go, "--dpocc"),       "w")) == NULL)  esl_fatal("Failed to open DP occupancy file %s for writing\n", esl_opt_GetString(go, "--dpocc")); }
+  if (esl_opt_IsOn(go, "--dpocc_ps"))    { if ((occpsfp    = fopen(esl_opt_GetString(go, "--dpocc_ps"),    "w")) == NULL)  esl_fatal("Failed to open DP occupancy heatmap file %s for writing\n", esl_opt_GetString(go, "--dpocc_ps")); 
+                                           if (fprintf(occpsfp, "%%!PS-Adobe-3.0\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed"); }
   if (qfp_msa != NULL || qfp_sq != NULL) {
     if (esl_opt_IsOn(go, "--hmmout")) {
       hmmfile = esl_opt_GetString(go, "--hmmout");
@@ -632,6 +1485,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 #ifdef HMMER_THREADS
   /* initialize thread data */
    ncpus = ESL_MIN(esl_opt_GetInteger(go, "--cpu"), esl_threads_GetCPUCount());
+   if (cfg->do_mpi) ncpus = 0; /* the MPI master doesn't search; its workers thread their own searches */
  
   if (ncpus > 0)
     {
@@ -642,6 +1496,15 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 
   infocnt = (ncpus == 0) ? 1 : ncpus;
   ESL_ALLOC(info, sizeof(*info) * infocnt);
+
+#ifdef HMMER_THREADS
+  if (esl_opt_IsOn(go, "--progress"))
+  {
+    if (strcmp(esl_opt_GetString(go, "--progress"), "-") == 0) progfp = stderr;
+    else if ((progfp = fopen(esl_opt_GetString(go, "--progress"), "w")) == NULL) p7_Fail("Failed to open progress file %s for writing\n", esl_opt_GetString(go, "--progress"));
+    if ((progress = progress_Create(progfp, esl_opt_GetInteger(go, "--progress_int"), infocnt, (ncpus > 0) ? queue : NULL)) == NULL) p7_Fail("Failed to start progress reporting\n");
+  }
+#endif
   
 
    /*the query sequence will be DNA but will be translated to amino acids */
@@ -694,12 +1557,9 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     if (status != eslOK) p7_Fail("Failed to set single query seq score system:\n%s\n", builder->errbuf);
   }
 
-  /* Set up the genetic code. Default = NCBI 1, the standard code; allow ORFs to start at any aa   */
-  gcode = esl_gencode_Create(abcDNA, abcAA);
-  esl_gencode_Set(gcode, codon_table);  // default = 1, the standard genetic code
-
-  if      (esl_opt_GetBoolean(go, "-m"))   esl_gencode_SetInitiatorOnlyAUG(gcode);
-  else if (! esl_opt_GetBoolean(go, "-M")) esl_gencode_SetInitiatorAny(gcode);      // note this is the default, if neither -m nor -M are set
+  /* Set up the genetic code(s). Default = NCBI 1, the standard code; allow ORFs to start at any aa   */
+  if (create_gencodes(go, abcDNA, abcAA, &gcodes, &ncodes) != eslOK) p7_Fail("Failed to set up genetic codes\n");
+  gcode = gcodes[0];
 
   /* Outer loop: over each query HMM, alignment , or sequence in <query file>. */
   while (qhstatus == eslOK) 
@@ -744,7 +1604,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
      
       if( hmm->fs != indel_cost)  p7_Fail("Requested frameshift probability of %f does not match the frameshift probability in the HMM file %s. Please either run bathsearch with option '--fs %f' or run bathconvert with option '--fs %f'.\n", indel_cost, cfg->queryfile, hmm->fs, indel_cost);
       
-      if( hmm->ct != esl_opt_GetInteger(go, "--ct"))  p7_Fail("Requested codon translation tabel ID %d does not match the codon translation tabel ID of the HMM file %s. Please either run bathsearch with option '--ct %d' or run bathconvert with option '--ct %d'.\n", codon_table, cfg->queryfile, hmm->ct, codon_table);
+      if( ! esl_opt_IsOn(go, "--ctlist") && hmm->ct != esl_opt_GetInteger(go, "--ct"))  p7_Fail("Requested codon translation tabel ID %d does not match the codon translation tabel ID of the HMM file %s. Please either run bathsearch with option '--ct %d' or run bathconvert with option '--ct %d'.\n", codon_table, cfg->queryfile, hmm->ct, codon_table);
     } 
 
     if(hmm->max_length == -1)
@@ -781,6 +1641,10 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     if (hmm->acc)  { if (fprintf(ofp, "Accession:   %s\n", hmm->acc)  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed"); }
     if (hmm->desc) { if (fprintf(ofp, "Description: %s\n", hmm->desc) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed"); }
 
+    /* With --clusters, a member of a multi-model cluster searches only the windows its representative kept */
+    cl = -1;
+    if (clusters != NULL && p7_hmmclusters_Lookup(clusters, hmm->name, &cl) == eslOK && clusters->size[cl] < 2) cl = -1;
+
     /* Convert to an optimized model */
     gm_fs = p7_profile_fs_Create (hmm->M, abcAA);
     gm = p7_profile_Create (hmm->M, abcAA);
@@ -792,12 +1656,18 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
       
     /* Create processing pipeline and hit list accumulators */
     tophits_accumulator  = p7_tophits_Create(); 
-    pipelinehits_accumulator = p7_pipeline_fs_Create(go, 100, 300, p7_SEARCH_SEQS);
+    pipelinehits_accumulator = p7_pipeline_fs_Create(go, 100, 300, TRUE, p7_SEARCH_SEQS);
     pipelinehits_accumulator->nmodels = 1;
+    pipelinehits_accumulator->tmaskdb = tmaskdb;
     pipelinehits_accumulator->nnodes = hmm->M;
 
     scoredata = p7_hmm_ScoreDataCreate(om, NULL);
 
+    if (esl_opt_GetBoolean(go, "--kseed") &&
+        p7_seedindex_Build(&gm, 1, esl_opt_GetInteger(go, "--kseed_k"), esl_opt_GetReal(go, "--kseed_T"), &seeds) != eslOK)
+      p7_Fail("Failed to build k-mer seed index for %s\n", hmm->name);
+    pipelinehits_accumulator->seeds = seeds;
+
     for (i = 0; i < infocnt; ++i)
     {
       /* Create processing pipeline and hit list */
@@ -811,10 +1681,21 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
       info[i].gm     = p7_profile_Clone(gm);
       info[i].gm_fs  = p7_profile_fs_Clone(gm_fs);
       info[i].scoredata = p7_hmm_ScoreDataClone(scoredata, om->abc->Kp);
-      info[i].pli = p7_pipeline_fs_Create(go, om->M, 300, p7_SEARCH_SEQS); /* L_hint = 300 is just a dummy for now */
+      info[i].do_batch  = ! esl_opt_GetBoolean(go, "--nobatch");
+      info[i].cc        = NULL;
+      if (xcodes_Create(go, &info[i], hmm, gcodes, ncodes) != eslOK) p7_Fail("Failed to set up genetic codes for %s\n", hmm->name);
+#ifdef HMMER_THREADS
+      info[i].progress = progress;
+      info[i].wid      = i;
+#endif
+      info[i].pli = p7_pipeline_fs_Create(go, om->M, 300, TRUE, p7_SEARCH_SEQS); /* L_hint = 300 is just a dummy for now */
+      info[i].pli->tmaskdb = tmaskdb;
+      info[i].pli->seeds   = seeds;
       status = p7_pli_NewModel(info[i].pli, info[i].om, info[i].bg);
       if (status == eslEINVAL) p7_Fail(info->pli->errbuf);
 
+      if (occfp != NULL && (info[i].pli->ddef->occ = p7_dpocc_Create(esl_opt_GetInteger(go, "--dpocc_every"))) == NULL) p7_Fail("Failed to allocate DP occupancy collector\n");
+
       if      (strcmp(esl_opt_GetString(go, "--strand"), "both")  == 0) info[i].pli->strands = p7_STRAND_BOTH; 
       else if (strcmp(esl_opt_GetString(go, "--strand"), "plus")  == 0) info[i].pli->strands = p7_STRAND_TOPONLY;
       else if (strcmp(esl_opt_GetString(go, "--strand"), "minus") == 0) info[i].pli->strands = p7_STRAND_BOTTOMONLY;
@@ -826,7 +1707,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
         info[i].pli->block_length = BATH_MAX_RESIDUE_COUNT;
 
 #ifdef HMMER_THREADS
-      if (ncpus > 0) esl_threads_AddThread(threadObj, &info[i]);
+      if (ncpus > 0 && cl < 0 && regions == NULL) esl_threads_AddThread(threadObj, &info[i]);
 #endif
     }
 
@@ -834,10 +1715,41 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     id_length_list = init_id_length(1000);
 
 #ifdef HMMER_THREADS
-    if (ncpus > 0)  sstatus = thread_loop(info, id_length_list,threadObj, queue, dbfp, cfg->firstseq_key, cfg->n_targetseq);
+    if (progress != NULL) progress_NewQuery(progress, hmm->name, nquery, dbres);
+#endif
+
+    if (cl >= 0)
+    {
+      sstatus = eslOK;
+#ifdef HMMER_THREADS
+      if (ncpus > 0) {
+        if (ccache[cl] == NULL) {
+          sstatus = cluster_thread_sweep(go, info, infocnt, rephmm[cl], threadObj, queue, dbfp, &(ccache[cl]));
+          if (ccache[cl] != NULL) ccache[cl]->nleft = clusters->size[cl];
+        }
+        if (sstatus == eslOK || sstatus == eslEOF) sstatus = cluster_thread_rerun(info, infocnt, threadObj, queue, ccache[cl]);
+      } else
+#endif
+      {
+        if (ccache[cl] == NULL) {
+          sstatus = cluster_sweep(go, info, rephmm[cl], dbfp, &(ccache[cl]));
+          if (ccache[cl] != NULL) ccache[cl]->nleft = clusters->size[cl];
+        }
+        if (sstatus == eslOK || sstatus == eslEOF) sstatus = cluster_rerun(info, ccache[cl]);
+      }
+    }
+    else if (regions != NULL)
+      sstatus = regions_loop(info, id_length_list, dbfp, regions);
+    else
+#ifdef HMMER_MPI
+    if (cfg->do_mpi) sstatus = mpi_search(go, cfg, info, dbfp, hmm, &blocklist);
+    else
+#endif
+#ifdef HMMER_THREADS
+    if (ncpus > 0)  sstatus = thread_loop(info, id_length_list,threadObj, queue, dbfp, cfg->firstseq_key, cfg->n_targetseq, 0);
     else
 #endif
-      sstatus = serial_loop(info, id_length_list, dbfp, cfg->firstseq_key, cfg->n_targetseq);
+      sstatus = serial_loop(info, id_length_list, dbfp, cfg->firstseq_key, cfg->n_targetseq, 0);
 
     switch(sstatus) {
       case eslEFORMAT:
@@ -851,6 +1763,11 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
       default:
         esl_fatal("Unexpected error %d reading sequence file %s", sstatus, dbfp->filename);
     }
+
+#ifdef HMMER_THREADS
+    if (progress != NULL && dbres == 0) /* every query scans the same db; later queries can estimate time remaining */
+      for (i = 0; i < infocnt; ++i) dbres += info[i].pli->nres;
+#endif
       
     //need to re-compute e-values before merging (when list will be sorted)
     if (esl_opt_IsUsed(go, "-Z")) {
@@ -858,16 +1775,37 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
       if ( info[0].pli->strands == p7_STRAND_BOTH)
         resCnt *= 2;
     }
-    else
+    else if (regions != NULL && ! esl_opt_GetBoolean(go, "--regions_searched"))
     {
-      for (i = 0; i < infocnt; ++i){
-        resCnt += info[i].pli->nres;
+      resCnt = regions->dbres; /* as if the whole database had been searched */
+      if ( info[0].pli->strands == p7_STRAND_BOTH)
+        resCnt *= 2;
+    }
+    else
+    {
+      for (i = 0; i < infocnt; ++i){
+        resCnt += info[i].pli->nres;
       }
     }
 
     for (i = 0; i < infocnt; ++i)
       p7_tophits_ComputeBATHEvalues(info[i].th, resCnt, info[i].om->max_length);
 
+    /* collect DP occupancy statistics from all workers */
+    if (occfp != NULL) 
+    {
+      if ((occ_accumulator = p7_dpocc_Create(1)) == NULL) p7_Fail("Failed to allocate DP occupancy collector\n");
+      for (i = 0; i < infocnt; ++i) {
+        p7_dpocc_Merge(occ_accumulator, info[i].pli->ddef->occ);
+        p7_dpocc_Destroy(info[i].pli->ddef->occ);
+        info[i].pli->ddef->occ = NULL;
+      }
+      if (p7_dpocc_WriteJSON(occfp, occ_accumulator, hmm->name, hmm->M) != eslOK) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+      if (occpsfp != NULL && p7_dpocc_Heatmap(occpsfp, occ_accumulator) != eslOK) p7_Fail("Failed to draw DP occupancy heatmap\n");
+      p7_dpocc_Destroy(occ_accumulator);
+      occ_accumulator = NULL;
+    }
+
     /* merge the results of the search results */
     for (i = 0; i < infocnt; ++i)
     {
@@ -879,6 +1817,7 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
       p7_profile_Destroy(info[i].gm);
       p7_profile_fs_Destroy(info[i].gm_fs);
       p7_hmm_ScoreDataDestroy(info[i].scoredata);
+      xcodes_Destroy(&info[i]);
 
       if(info[i].wrk1->orf_block != NULL)
       {
@@ -896,7 +1835,9 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 
     /* Sort and remove duplicates */
     p7_tophits_SortBySeqidxAndAlipos(tophits_accumulator);
-    assign_Lengths(tophits_accumulator, id_length_list);
+    if (cl >= 0)            assign_Lengths(tophits_accumulator, ccache[cl]->id_length_list);
+    else if (! cfg->do_mpi) assign_Lengths(tophits_accumulator, id_length_list); /* MPI workers assign lengths before sending their hits */
+    if (cl >= 0 && --(ccache[cl]->nleft) == 0) { cluster_cache_Destroy(ccache[cl]); ccache[cl] = NULL; }
     p7_tophits_RemoveDuplicates(tophits_accumulator, pipelinehits_accumulator->use_bit_cutoffs);
 
 
@@ -925,6 +1866,8 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
 
     if (tblfp)     p7_tophits_TabularTargets(tblfp,    hmm->name, hmm->acc, tophits_accumulator, pipelinehits_accumulator, (nquery == 1));
     if (fstblfp)   p7_tophits_TabularFrameshifts(fstblfp,    hmm->name, hmm->acc, tophits_accumulator, pipelinehits_accumulator, (nquery == 1));
+    if (afp && p7_tophits_StreamAlignment(afp, hmm->name, tophits_accumulator, hmm->M, afmt, esl_opt_GetBoolean(go, "--Amatch")) != eslOK)
+      p7_Fail("Failed to write alignment of hits to %s\n", esl_opt_GetString(go, "-A"));
 
     esl_stopwatch_Stop(watch);
     p7_pli_Statistics(ofp, pipelinehits_accumulator, watch);
@@ -937,6 +1880,8 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
     p7_profile_fs_Destroy(gm_fs);
     p7_hmm_Destroy(hmm);
     p7_hmm_ScoreDataDestroy(scoredata);
+    p7_seedindex_Destroy(seeds);
+    seeds = NULL;
     destroy_id_length(id_length_list);
     if (qsq != NULL) esl_sq_Reuse(qsq);
       
@@ -972,15 +1917,36 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   if (hmmoutfp != NULL)
     fclose(hmmoutfp);
 
+#ifdef HMMER_MPI
+  /* Tell the workers there are no more queries: a NULL HMM is the shutdown signal */
+  if (cfg->do_mpi) {
+    char *mpi_buf  = NULL;
+    int   mpi_size = 0;
+    for (i = 1; i < cfg->nproc; i++)
+      p7_hmm_MPISend(NULL, i, BATH_HMM_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size);
+    free(mpi_buf);
+  }
+  if (blocklist != NULL) {
+    free(blocklist->blocks);
+    free(blocklist);
+  }
+#endif
+
   /* Terminate outputs... any last words? */
   if (tblfp)    p7_tophits_TabularTail(tblfp,    "bathsearch", p7_SEARCH_SEQS, cfg->queryfile, cfg->dbfile, go);
   if (fstblfp)  p7_tophits_TabularTail(fstblfp,  "bathsearch", p7_SEARCH_SEQS, cfg->queryfile, cfg->dbfile, go); 
+  if (esl_opt_GetBoolean(go, "--alloctrack")) p7_alloctrack_Report(ofp);
   if (ofp)      { if (fprintf(ofp, "[ok]\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed"); }
 
   /* Cleanup - prepare for exit */
   for (i = 0; i < infocnt; ++i)
     p7_bg_Destroy(info[i].bg);
 
+#ifdef HMMER_THREADS
+  if (progress != NULL) progress_Destroy(progress);
+  if (progfp != NULL && progfp != stderr) fclose(progfp);
+#endif
+
 #ifdef HMMER_THREADS
   if (ncpus > 0)
   {
@@ -1005,12 +1971,26 @@ serial_master(ESL_GETOPTS *go, struct cfg_s *cfg)
   esl_sqfile_Close(dbfp);
   esl_alphabet_Destroy(abcAA);
   esl_alphabet_Destroy(abcDNA);
-  esl_gencode_Destroy(gcode);
+  destroy_gencodes(gcodes, ncodes);
   esl_stopwatch_Destroy(watch);
+  p7_tmaskdb_Destroy(tmaskdb);
+  regions_Destroy(regions);
+  if (clusters != NULL) {
+    for (i = 0; i < clusters->nclust; i++) {
+      cluster_cache_Destroy(ccache[i]);
+      if (rephmm[i]) p7_hmm_Destroy(rephmm[i]);
+    }
+    free(ccache);
+    free(rephmm);
+    p7_hmmclusters_Destroy(clusters);
+  }
 
   if (ofp != stdout) fclose(ofp);
   if (tblfp)         fclose(tblfp);
   if (fstblfp)         fclose(fstblfp);
+  if (afp)           fclose(afp);
+  if (occfp)         fclose(occfp);
+  if (occpsfp)       fclose(occpsfp);
 
   return eslOK;
 
@@ -1026,13 +2006,16 @@ ERROR:
   if (ofp != stdout) fclose(ofp);
   if (tblfp)         fclose(tblfp);
   if (fstblfp)       fclose(fstblfp);
+  if (afp)           fclose(afp);
+  if (occfp)         fclose(occfp);
+  if (occpsfp)       fclose(occpsfp);
 
   if (hmmfile != NULL) free (hmmfile);
   return eslFAIL;
 }
 
 static int
-serial_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_SQFILE *dbfp, char *firstseq_key, int n_targetseqs)
+serial_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_SQFILE *dbfp, char *firstseq_key, int n_targetseqs, int64_t seqidx_base)
 {
   int  sstatus = eslOK;
   int seq_id = 0;
@@ -1043,40 +2026,14 @@ serial_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_SQFILE *dbfp,
 
   while (sstatus == eslOK && (n_targetseqs==-1 || seq_id < n_targetseqs) ) 
   {
-    dbsq_dna->idx = seq_id;
+    dbsq_dna->idx = seqidx_base + seq_id;
     if (dbsq_dna->n < 15) continue; /* do not process sequence of less than 5 codons */
 
-    dbsq_dna->L = dbsq_dna->n; /* here, L is not the full length of the sequence in the db, just of the currently-active window;  required for esl_gencode machinations */
-    
-    if (info->pli->strands != p7_STRAND_BOTTOMONLY) 
-    {
-      info->pli->nres += dbsq_dna->n;
-   
-       /* translate DNA sequence to 3 frame ORFs */
-      do_sq_by_sequences(info->gcode, info->wrk1, dbsq_dna);
-
-      p7_Pipeline_BATH(info->pli, info->om, info->gm, info->gm_fs, info->scoredata, info->bg, info->th, info->pli->nseqs, dbsq_dna, info->wrk1->orf_block, info->wrk2, info->gcode, p7_NOCOMPLEMENT);
-      p7_pipeline_fs_Reuse(info->pli); // prepare for next search
-
-      esl_sq_ReuseBlock(info->wrk1->orf_block);    
-    } 
+    search_window(info, dbsq_dna);
 
-    if (info->pli->strands != p7_STRAND_TOPONLY) 
-    {   
-      info->pli->nres += dbsq_dna->n;
-  
-      /* Reverse complement and translate DNA sequence to 3 frame ORFs */
-      esl_sq_ReverseComplement(dbsq_dna);
-      do_sq_by_sequences(info->gcode, info->wrk1, dbsq_dna);
-	
-      p7_Pipeline_BATH(info->pli, info->om, info->gm, info->gm_fs, info->scoredata, info->bg, info->th, info->pli->nseqs, dbsq_dna, info->wrk1->orf_block, info->wrk2, info->gcode, p7_COMPLEMENT); 
-      p7_pipeline_fs_Reuse(info->pli); // prepare for next search
-      
-      esl_sq_ReuseBlock(info->wrk1->orf_block);
-      
-      /* Reverse sequence back to original */
-      esl_sq_ReverseComplement(dbsq_dna);
-    } 
+#ifdef HMMER_THREADS
+    if (info->progress != NULL) progress_Publish(info->progress, info->wid, info->pli, info->th);
+#endif
 
     sstatus = esl_sqio_ReadWindow(dbfp, info->om->max_length, info->pli->block_length, dbsq_dna);
     
@@ -1097,15 +2054,79 @@ serial_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_SQFILE *dbfp,
   return sstatus;
 }
 
+/* search_window()
+ * Search one window of target DNA, both strands (or the one selected
+ * by --strand), with the query in <info>, once for each genetic code
+ * (--ctlist). The window is read and masked only once. <dbsq_dna> is
+ * returned as it came in, apart from any masking.
+ */
+static void
+search_window(WORKER_INFO *info, ESL_SQ *dbsq_dna)
+{
+  int c;
+
+  dbsq_dna->L = dbsq_dna->n; /* here, L is not the full length of the sequence in the db, just of the currently-active window;  required for esl_gencode machinations */
+  p7_pli_MaskTarget(info->pli, info->gcode, dbsq_dna);
+
+  if (info->pli->strands != p7_STRAND_BOTTOMONLY) info->pli->nres += dbsq_dna->n;
+  if (info->pli->strands != p7_STRAND_TOPONLY)    info->pli->nres += dbsq_dna->n;
+
+  search_strands(info, info->gcode, info->gm_fs, info->wrk1, info->wrk2, info->ct, dbsq_dna);
+  for (c = 0; c < info->nxcode; c++)
+    search_strands(info, info->xcode[c].gcode, info->xcode[c].gm_fs, info->xcode[c].wrk1, info->xcode[c].wrk2, info->xcode[c].ct, dbsq_dna);
+}
+
+/* search_strands()
+ * Translate <dbsq_dna> with <gcode> and run the pipeline on it with
+ * <gm_fs>, on each strand selected by --strand. When more than one
+ * genetic code is searched, the new hits are marked with table <ct>.
+ */
+static void
+search_strands(WORKER_INFO *info, ESL_GENCODE *gcode, P7_FS_PROFILE *gm_fs, ESL_GENCODE_WORKSTATE *wrk1, ESL_GENCODE_WORKSTATE *wrk2, int ct, ESL_SQ *dbsq_dna)
+{
+  uint64_t h0 = info->th->N;
+  uint64_t h;
+
+  if (info->pli->strands != p7_STRAND_BOTTOMONLY) 
+  {
+     /* translate DNA sequence to 3 frame ORFs */
+    do_sq_by_sequences(gcode, wrk1, dbsq_dna);
+
+    p7_Pipeline_BATH(info->pli, info->om, info->gm, gm_fs, info->scoredata, info->bg, info->th, dbsq_dna->idx, dbsq_dna, wrk1->orf_block, wrk2, gcode, p7_NOCOMPLEMENT);
+    p7_pipeline_fs_Reuse(info->pli); // prepare for next search
+
+    esl_sq_ReuseBlock(wrk1->orf_block);    
+  } 
+
+  if (info->pli->strands != p7_STRAND_TOPONLY) 
+  {   
+    /* Reverse complement and translate DNA sequence to 3 frame ORFs */
+    esl_sq_ReverseComplement(dbsq_dna);
+    do_sq_by_sequences(gcode, wrk1, dbsq_dna);
+	
+    p7_Pipeline_BATH(info->pli, info->om, info->gm, gm_fs, info->scoredata, info->bg, info->th, dbsq_dna->idx, dbsq_dna, wrk1->orf_block, wrk2, gcode, p7_COMPLEMENT); 
+    p7_pipeline_fs_Reuse(info->pli); // prepare for next search
+    
+    esl_sq_ReuseBlock(wrk1->orf_block);
+    
+    /* Reverse sequence back to original */
+    esl_sq_ReverseComplement(dbsq_dna);
+  } 
+
+  if (info->nxcode > 0)
+    for (h = h0; h < info->th->N; h++) info->th->unsrt[h].ct = ct;
+}
+
 #ifdef HMMER_THREADS
 static int
-thread_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, char *firstseq_key, int n_targetseqs)
+thread_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, char *firstseq_key, int n_targetseqs, int64_t seqidx_base)
 {
   int i;
+  int64_t       nseqs0   = info->pli->nseqs; // sequences this pipeline had already counted before this call
   int           status   = eslOK;
   int           sstatus  = eslOK;
   int           eofCount = 0;
-  int           seqid    = -1;
+  int64_t       seqid    = -1;
   int           abort    = FALSE; // in the case n_targetseqs != -1, a block may get abbreviated
   ESL_SQ_BLOCK *block;
   ESL_SQ       *tmpsq;
@@ -1132,7 +2153,7 @@ thread_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_THREADS *obj,
       sstatus = esl_sqio_ReadBlock(dbfp, block, info->pli->block_length, n_targetseqs, FALSE, TRUE);
     }
 
-    block->first_seqidx = info->pli->nseqs;
+    block->first_seqidx = seqidx_base + (info->pli->nseqs - nseqs0);
     seqid = block->first_seqidx;
 
     for (i=0; i<block->count; i++) {
@@ -1140,7 +2161,7 @@ thread_loop(WORKER_INFO *info, ID_LENGTH_LIST *id_length_list, ESL_THREADS *obj,
       add_id_length(id_length_list, seqid, block->list[i].L); // NOLINT(cppcoreguidelines-narrowing-conversions)
       seqid++;
 
-      if (       seqid == n_targetseqs // hit the sequence target
+      if (       seqid - seqidx_base == n_targetseqs // hit the sequence target
            && ( i<block->count-1 ||  block->complete ) // and either it's not the last sequence (so it's complete), or its complete
          ) 
       {
@@ -1213,6 +2234,9 @@ pipeline_thread(void *arg)
   ESL_THREADS   *obj;
   ESL_SQ_BLOCK  *block = NULL;
   void          *newBlock;
+  uint64_t       h, h0;
+  uint64_t       nres;
+  int            c;
 
   impl_Init();
   obj = (ESL_THREADS *) arg;
@@ -1229,36 +2253,43 @@ pipeline_thread(void *arg)
   while (block->count > 0)
   {
     /* Main loop: */
-    for (i = 0; i < block->count; ++i)
+    if (info->cc != NULL)  /* screening for a model cluster (--clusters) */
     {
-      ESL_SQ *dnaSeq = block->list + i;
-      dnaSeq->L = dnaSeq->n; /* here, L is not the full length of the sequence in the db, just of the currently-active window;  required for esl_gencode machinations */
-     
-
-      if (info->pli->strands != p7_STRAND_BOTTOMONLY) {
-
-        info->pli->nres += dnaSeq->n;
-        do_sq_by_sequences(info->gcode, info->wrk1, dnaSeq);
-       
-        p7_Pipeline_BATH(info->pli, info->om, info->gm, info->gm_fs, info->scoredata, info->bg, info->th, block->first_seqidx + i, dnaSeq, info->wrk1->orf_block, info->wrk2, info->gcode, p7_NOCOMPLEMENT);
-
-        p7_pipeline_fs_Reuse(info->pli); // prepare for next search
-
-        esl_sq_ReuseBlock(info->wrk1->orf_block);
-      } 
-
-      if (info->pli->strands != p7_STRAND_TOPONLY) {
-        info->pli->nres += dnaSeq->n;
-        esl_sq_ReverseComplement(dnaSeq);
-        do_sq_by_sequences(info->gcode, info->wrk1, dnaSeq);
-	
-        p7_Pipeline_BATH(info->pli, info->om, info->gm, info->gm_fs, info->scoredata, info->bg, info->th, block->first_seqidx + i, dnaSeq, info->wrk1->orf_block, info->wrk2, info->gcode, p7_COMPLEMENT);
+      for (i = 0; i < block->count; ++i)
+        if (cluster_screen(info, info->cc, block->list + i) != eslOK) esl_fatal("Cluster screen failed");
+    }
+    else if (info->do_batch)
+    {
+      /* mask once; every genetic code searches the same masked block */
+      for (i = 0; i < block->count; ++i)
+        if (p7_pli_MaskTarget(info->pli, info->gcode, block->list + i) != eslOK) esl_fatal("Target masking failed");
 
-        p7_pipeline_fs_Reuse(info->pli); // prepare for next search
+      h0 = info->th->N;
+      p7_Pipeline_BATH_Batch(info->pli, info->om, info->gm, info->gm_fs, info->scoredata, info->bg, info->th, block, info->wrk1, info->wrk2, info->gcode);
 
-	esl_sq_ReuseBlock(info->wrk1->orf_block);
-        esl_sq_ReverseComplement(dnaSeq);
+      /* Further genetic codes: same block, already read and masked;
+       * only the first pass counts residues.
+       */
+      if (info->nxcode > 0)
+      {
+        nres   = info->pli->nres;
+        for (h = h0; h < info->th->N; h++) info->th->unsrt[h].ct = info->ct;
+        for (c = 0; c < info->nxcode; c++)
+        {
+          h0 = info->th->N;
+          p7_Pipeline_BATH_Batch(info->pli, info->om, info->gm, info->xcode[c].gm_fs, info->scoredata, info->bg, info->th, block, info->xcode[c].wrk1, info->xcode[c].wrk2, info->xcode[c].gcode);
+          for (h = h0; h < info->th->N; h++) info->th->unsrt[h].ct = info->xcode[c].ct;
+        }
+        info->pli->nres = nres;
       }
+
+      if (info->progress != NULL) progress_Publish(info->progress, info->wid, info->pli, info->th);
+    }
+    else
+    for (i = 0; i < block->count; ++i)
+    {
+      search_window(info, block->list + i);
+      if (info->progress != NULL) progress_Publish(info->progress, info->wid, info->pli, info->th);
     }  
     status = esl_workqueue_WorkerUpdate(info->queue, block, &newBlock);
     if (status != eslOK) esl_fatal("Work queue worker failed");
@@ -1272,9 +2303,668 @@ pipeline_thread(void *arg)
 
   esl_threads_Finished(obj, workeridx);
 }
+
+/* cluster_thread_sweep()
+ * cluster_sweep() on the worker threads. Each worker gets its own copy
+ * of the representative and a screening pipeline in place of the
+ * member's, which are put back afterwards; thread_loop() then reads
+ * the database as for a search, and the workers add the windows that
+ * pass to the shared cache. The cache is sorted at the end so it
+ * doesn't depend on thread scheduling.
+ */
+static int
+cluster_thread_sweep(ESL_GETOPTS *go, WORKER_INFO *info, int ninfo, P7_HMM *rephmm, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, ESL_SQFILE *dbfp, CLUSTER_CACHE **ret_cc)
+{
+  CLUSTER_CACHE *cc      = NULL;
+  P7_PROFILE    *gm      = NULL;
+  P7_OPROFILE   *om      = NULL;
+  P7_OPROFILE  **mom     = NULL;   /* members' own profiles, set aside during the screen  */
+  P7_PIPELINE  **mpli    = NULL;   /* ... and pipelines                                   */
+  int            nswap   = 0;
+  int            sstatus = eslOK;
+  int            status;
+  int            i;
+
+  if ((cc = cluster_cache_Create()) == NULL) { status = eslEMEM; goto ERROR; }
+  ESL_ALLOC(mom,  sizeof(P7_OPROFILE *) * ninfo);
+  ESL_ALLOC(mpli, sizeof(P7_PIPELINE *) * ninfo);
+
+  gm = p7_profile_Create (rephmm->M, rephmm->abc);
+  om = p7_oprofile_Create(rephmm->M, rephmm->abc);
+  p7_ProfileConfig(rephmm, info->bg, gm, 100, p7_LOCAL);
+  p7_oprofile_Convert(gm, om);
+
+  for (nswap = 0; nswap < ninfo; nswap++)
+  {
+    mom[nswap]  = info[nswap].om;
+    mpli[nswap] = info[nswap].pli;
+    info[nswap].om  = p7_oprofile_Clone(om);
+    info[nswap].pli = cluster_pipeline(go, &info[nswap], info[nswap].om);
+    info[nswap].cc  = cc;
+    if (info[nswap].om == NULL || info[nswap].pli == NULL) { nswap++; status = eslEMEM; goto ERROR; }
+  }
+  for (i = 0; i < ninfo; i++) esl_threads_AddThread(obj, &info[i]);
+
+  sstatus = thread_loop(info, cc->id_length_list, obj, queue, dbfp, NULL, -1, 0);
+
+  cc->nseqs = info[0].pli->nseqs;  /* counted by the reader, on the first worker's pipeline */
+  for (i = 0; i < ninfo; i++) cc->nres += info[i].pli->nres;
+  qsort(cc->win, cc->nwin, sizeof(ESL_SQ *), cluster_window_sorter);
+
+  status = sstatus;
+  /* fall through: put the members' profiles and pipelines back */
+
+ ERROR:
+  for (i = 0; i < nswap; i++)
+  {
+    if (info[i].pli) p7_pipeline_fs_Destroy(info[i].pli);
+    if (info[i].om)  p7_oprofile_Destroy(info[i].om);
+    info[i].om  = mom[i];
+    info[i].pli = mpli[i];
+    info[i].cc  = NULL;
+  }
+  if (mom)  free(mom);
+  if (mpli) free(mpli);
+  if (om)   p7_oprofile_Destroy(om);
+  if (gm)   p7_profile_Destroy(gm);
+  if (status != eslOK && status != eslEOF) { cluster_cache_Destroy(cc); cc = NULL; }
+  *ret_cc = cc;
+  return status;
+}
+
+/* cluster_thread_rerun()
+ * cluster_rerun() on the worker threads: the cached windows are copied
+ * into blocks and handed to the workers through the work queue, just
+ * as thread_loop() hands out blocks read from the database. The
+ * residue and sequence counts of the full pass then go on the first
+ * worker's pipeline, and the others' are zeroed, so their sum is the
+ * same as for a full pass.
+ */
+static int
+cluster_thread_rerun(WORKER_INFO *info, int ninfo, ESL_THREADS *obj, ESL_WORK_QUEUE *queue, CLUSTER_CACHE *cc)
+{
+  ESL_SQ_BLOCK *block;
+  void         *newBlock;
+  int64_t       nres;
+  int           neof = 0;
+  int           w    = 0;
+  int           i;
+
+  for (i = 0; i < ninfo; i++) esl_threads_AddThread(obj, &info[i]);
+
+  esl_workqueue_Reset(queue);
+  esl_threads_WaitForStart(obj);
+
+  if (esl_workqueue_ReaderUpdate(queue, NULL, &newBlock) != eslOK) esl_fatal("Work queue reader failed");
+
+  while (1)
+  {
+    block        = (ESL_SQ_BLOCK *) newBlock;
+    block->count = 0;
+    for (nres = 0; w < cc->nwin && block->count < block->listSize && nres < info->pli->block_length; w++)
+    {
+      esl_sq_Copy(cc->win[w], block->list + block->count);
+      nres += cc->win[w]->n;
+      block->count++;
+    }
+    block->complete = TRUE;
+
+    /* an empty block tells a worker to finish; send one to each */
+    if (block->count == 0 && ++neof > esl_threads_GetWorkerCount(obj)) break;
+    if (esl_workqueue_ReaderUpdate(queue, block, &newBlock) != eslOK) esl_fatal("Work queue reader failed");
+  }
+
+  if (esl_workqueue_ReaderUpdate(queue, block, NULL) != eslOK) esl_fatal("Work queue reader failed");
+  esl_threads_WaitForFinish(obj);
+  esl_workqueue_Complete(queue);
+
+  for (i = 0; i < ninfo; i++) { info[i].pli->nres = 0; info[i].pli->nseqs = 0; }
+  info[0].pli->nres  = cc->nres;
+  info[0].pli->nseqs = cc->nseqs;
+  return eslOK;
+}
+
+/* progress_sampler()
+ * The --progress sampler thread. Sleeps <interval> seconds at a time,
+ * then sums the workers' published counters and writes one line:
+ *   residues searched, input rate (Mb/s) into each filter stage, the
+ *   reader/worker queue depths, hits so far, and (once one full db
+ *   pass has been timed) an estimate of time left on this query.
+ */
+static void *
+progress_sampler(void *arg)
+{
+  PROGRESS        *prog = (PROGRESS *) arg;
+  PROGRESS_COUNTS  sum;
+  struct timespec  wake;
+  char             eta[32];
+  double           elapsed;
+  double           mb;
+  int              nfull, nempty;
+  int              i;
+
+  pthread_mutex_lock(&prog->mutex);
+  while (! prog->done)
+  {
+    wake.tv_sec  = time(NULL) + prog->interval;
+    wake.tv_nsec = 0;
+    while (! prog->done && pthread_cond_timedwait(&prog->cond, &prog->mutex, &wake) == 0) ;
+    if (prog->done || prog->qname == NULL) continue;
+
+    memset(&sum, 0, sizeof(PROGRESS_COUNTS));
+    for (i = 0; i < prog->nworkers; i++) {
+      sum.nres          += prog->counts[i].nres;
+      sum.pos_past_msv  += prog->counts[i].pos_past_msv;
+      sum.pos_past_bias += prog->counts[i].pos_past_bias;
+      sum.pos_past_vit  += prog->counts[i].pos_past_vit;
+      sum.nhits         += prog->counts[i].nhits;
+    }
+    elapsed = ESL_MAX(1.0, difftime(time(NULL), prog->qstart));
+
+    nfull = nempty = 0;
+    if (prog->queue != NULL) {
+      pthread_mutex_lock(&prog->queue->queueMutex);
+      nfull  = prog->queue->workerQueueCnt;   /* blocks read, waiting for a worker */
+      nempty = prog->queue->readerQueueCnt;   /* blocks free, waiting for the reader */
+      pthread_mutex_unlock(&prog->queue->queueMutex);
+    }
+
+    if (prog->dbres > 0 && sum.nres > 0) snprintf(eta, sizeof(eta), "%.0fs", ESL_MAX(0., (double) (prog->dbres - sum.nres) * elapsed / (double) sum.nres));
+    else                                 snprintf(eta, sizeof(eta), "unknown");
+
+    mb = 1000000. * elapsed;
+    fprintf(prog->fp, "[bathsearch] query %d (%s)  elapsed %.0fs  searched %.2f Mb  Mb/s: msv %.3f bias %.3f vit %.3f fwd %.3f  queue %d full/%d free  hits %d  eta %s\n",
+            prog->nquery, prog->qname, elapsed, (double) sum.nres / 1000000.,
+            (double) sum.nres / mb, (double) sum.pos_past_msv / mb, (double) sum.pos_past_bias / mb, (double) sum.pos_past_vit / mb,
+            nfull, nempty, sum.nhits, eta);
+    fflush(prog->fp);
+  }
+  pthread_mutex_unlock(&prog->mutex);
+  return NULL;
+}
+
+/* progress_Create()
+ * Start a --progress sampler writing to <fp> every <interval> seconds,
+ * with one counter slot per worker. <queue> is the reader/worker work
+ * queue whose depth is reported, or NULL. Returns NULL on failure.
+ */
+static PROGRESS *
+progress_Create(FILE *fp, int interval, int nworkers, ESL_WORK_QUEUE *queue)
+{
+  PROGRESS *prog  = NULL;
+  int       nsync = 0;     /* mutex, cond initialized so far */
+  int       status;
+
+  ESL_ALLOC(prog, sizeof(PROGRESS));
+  prog->fp       = fp;
+  prog->interval = interval;
+  prog->nworkers = nworkers;
+  prog->counts   = NULL;
+  prog->qname    = NULL;
+  prog->nquery   = 0;
+  prog->dbres    = 0;
+  prog->qstart   = time(NULL);
+  prog->queue    = queue;
+  prog->done     = FALSE;
+  ESL_ALLOC(prog->counts, sizeof(PROGRESS_COUNTS) * nworkers);
+  memset(prog->counts, 0, sizeof(PROGRESS_COUNTS) * nworkers);
+
+  if (pthread_mutex_init(&prog->mutex, NULL) != 0)                       goto ERROR;
+  nsync++;
+  if (pthread_cond_init(&prog->cond, NULL)   != 0)                       goto ERROR;
+  nsync++;
+  if (pthread_create(&prog->thread, NULL, progress_sampler, prog) != 0) goto ERROR;
+  return prog;
+
+ ERROR:
+  if (prog != NULL) {
+    if (nsync > 1) pthread_cond_destroy(&prog->cond);
+    if (nsync > 0) pthread_mutex_destroy(&prog->mutex);
+    free(prog->counts);
+    free(prog);
+  }
+  return NULL;
+}
+
+/* progress_NewQuery()
+ * Reset the counters for query number <nquery>, named <qname>.
+ * <dbres> is the residue count of one full database pass, if known
+ * (0 if not); it's what the time-left estimate is based on.
+ */
+static void
+progress_NewQuery(PROGRESS *prog, char *qname, int nquery, int64_t dbres)
+{
+  pthread_mutex_lock(&prog->mutex);
+  memset(prog->counts, 0, sizeof(PROGRESS_COUNTS) * prog->nworkers);
+  free(prog->qname);
+  esl_strdup(qname, -1, &(prog->qname));
+  prog->nquery = nquery;
+  prog->dbres  = dbres;
+  prog->qstart = time(NULL);
+  pthread_mutex_unlock(&prog->mutex);
+}
+
+/* progress_Publish()
+ * Called by worker <wid> between target sequences: copy its pipeline
+ * counters and hit count into its slot. 
+ */
+static void
+progress_Publish(PROGRESS *prog, int wid, const P7_PIPELINE *pli, const P7_TOPHITS *th)
+{
+  PROGRESS_COUNTS *c = prog->counts + wid;
+
+  pthread_mutex_lock(&prog->mutex);
+  c->nres          = pli->nres;
+  c->pos_past_msv  = pli->pos_past_msv;
+  c->pos_past_bias = pli->pos_past_bias;
+  c->pos_past_vit  = pli->pos_past_vit;
+  c->nhits         = th->N;
+  pthread_mutex_unlock(&prog->mutex);
+}
+
+/* progress_Destroy()
+ * Stop the sampler thread and free <prog>.
+ */
+static void
+progress_Destroy(PROGRESS *prog)
+{
+  pthread_mutex_lock(&prog->mutex);
+  prog->done = TRUE;
+  pthread_cond_signal(&prog->cond);
+  pthread_mutex_unlock(&prog->mutex);
+  pthread_join(prog->thread, NULL);
+
+  pthread_cond_destroy(&prog->cond);
+  pthread_mutex_destroy(&prog->mutex);
+  free(prog->qname);
+  free(prog->counts);
+  free(prog);
+}
 #endif   /* HMMER_THREADS */
  
 
+#ifdef HMMER_MPI
+/* mpi_create_blocklist()
+ * Scan the target database once, recording the disk offset of every
+ * BATH_MPI_BLOCK_RESIDUES worth of whole sequences. The resulting list
+ * is reused for every query; blocks never split a sequence, so each
+ * worker can search its block with the usual serial/thread loops.
+ */
+static int
+mpi_create_blocklist(ESL_SQFILE *dbfp, MPI_BLOCKLIST **ret_list)
+{
+  MPI_BLOCKLIST *list  = NULL;
+  ESL_SQ        *sq    = NULL;
+  int64_t        nseq  = 0;
+  int64_t        nres  = 0;
+  int            status;
+
+  if (! esl_sqfile_IsRewindable(dbfp))
+    p7_Fail("Target sequence file %s isn't rewindable; can't split it among MPI workers", dbfp->filename);
+
+  ESL_ALLOC(list, sizeof(MPI_BLOCKLIST));
+  list->count  = 0;
+  list->size   = 1000;
+  list->blocks = NULL;
+  ESL_ALLOC(list->blocks, sizeof(MPI_BLOCK) * list->size);
+
+  if ((sq = esl_sq_CreateDigital(dbfp->abc)) == NULL) { status = eslEMEM; goto ERROR; }
+  if ((status = esl_sqfile_Position(dbfp, 0)) != eslOK) goto ERROR;
+
+  while ((status = esl_sqio_ReadInfo(dbfp, sq)) == eslOK)
+  {
+    if (nres == 0) { /* start a new block at this record */
+      if (list->count == list->size) {
+        list->size *= 2;
+        ESL_REALLOC(list->blocks, sizeof(MPI_BLOCK) * list->size);
+      }
+      list->blocks[list->count].offset       = sq->roff;
+      list->blocks[list->count].count        = 0;
+      list->blocks[list->count].first_seqidx = nseq;
+      list->count++;
+    }
+
+    list->blocks[list->count-1].count++;
+    nres += sq->L;
+    nseq++;
+
+    if (nres >= BATH_MPI_BLOCK_RESIDUES) nres = 0;
+    esl_sq_Reuse(sq);
+  }
+  if (status != eslEOF) goto ERROR;
+
+  if ((status = esl_sqfile_Position(dbfp, 0)) != eslOK) goto ERROR;
+
+  esl_sq_Destroy(sq);
+  *ret_list = list;
+  return eslOK;
+
+ ERROR:
+  if (sq   != NULL) esl_sq_Destroy(sq);
+  if (list != NULL) { free(list->blocks); free(list); }
+  *ret_list = NULL;
+  return status;
+}
+
+/* mpi_search()
+ * The MPI master's version of the per-query search.
+ *
+ * Sends the query HMM to every worker, then hands out target database
+ * blocks on request until they run out; each worker gets an empty block
+ * to tell it the query is done. The worker's pipeline statistics and
+ * hits are then collected and merged into <info>, exactly as though the
+ * master had searched the whole database itself, so serial_master's
+ * E-value, merge, and output steps are unchanged.
+ *
+ * Hits arrive with their target lengths already assigned by the worker.
+ */
+static int
+mpi_search(ESL_GETOPTS *go, struct cfg_s *cfg, WORKER_INFO *info, ESL_SQFILE *dbfp, P7_HMM *hmm, MPI_BLOCKLIST **ret_list)
+{
+  MPI_BLOCKLIST *list     = *ret_list;
+  MPI_BLOCK      empty    = { 0, 0, 0 };
+  P7_PIPELINE   *pli      = NULL;
+  P7_TOPHITS    *th       = NULL;
+  char          *mpi_buf  = NULL;
+  int            mpi_size = 0;
+  int            next     = 0;
+  int            done     = 0;
+  int            ready;
+  int            status;
+  int            w;
+  MPI_Status     mpistatus;
+
+  if (list == NULL) {
+    if ((status = mpi_create_blocklist(dbfp, &list)) != eslOK) return status;
+    *ret_list = list;
+  }
+
+  for (w = 1; w < cfg->nproc; w++)
+    p7_hmm_MPISend(hmm, w, BATH_HMM_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size);
+
+  /* load balance: whoever asks next gets the next block */
+  while (done < cfg->nproc - 1)
+  {
+    MPI_Recv(&ready, 1, MPI_INT, MPI_ANY_SOURCE, BATH_READY_TAG, MPI_COMM_WORLD, &mpistatus);
+
+    if (next < list->count) {
+      MPI_Send(&(list->blocks[next]), 3, MPI_INT64_T, mpistatus.MPI_SOURCE, BATH_BLOCK_TAG, MPI_COMM_WORLD);
+      next++;
+    } else {
+      MPI_Send(&empty, 3, MPI_INT64_T, mpistatus.MPI_SOURCE, BATH_BLOCK_TAG, MPI_COMM_WORLD);
+      done++;
+    }
+  }
+
+  for (w = 1; w < cfg->nproc; w++)
+  {
+    if ((status = p7_pipeline_MPIRecv(w, BATH_PIPELINE_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, go, &pli)) != eslOK)
+      p7_Fail("Failed to receive pipeline statistics from MPI worker %d", w);
+    if ((status = p7_tophits_MPIRecv (w, BATH_TOPHITS_TAG,  MPI_COMM_WORLD, &mpi_buf, &mpi_size, &th))      != eslOK)
+      p7_Fail("Failed to receive hits from MPI worker %d", w);
+
+    p7_pipeline_Merge(info->pli, pli);
+    p7_tophits_Merge(info->th, th);
+
+    p7_pipeline_fs_Destroy(pli);
+    p7_tophits_Destroy(th);
+    pli = NULL;
+    th  = NULL;
+  }
+
+  free(mpi_buf);
+  return eslOK;
+}
+
+/* mpi_worker()
+ * An MPI worker for bathsearch.
+ *
+ * Receives one query HMM at a time from the master, and searches the
+ * target database blocks it is handed until it gets an empty block.
+ * Each block is searched with the threaded (--cpu) or serial loop, so a
+ * worker uses its whole node. Results for the query are sent back to
+ * the master; a NULL HMM means there are no more queries.
+ *
+ * As with serial_master(), errors are fatal and handled by p7_Fail().
+ */
+static int
+mpi_worker(ESL_GETOPTS *go, struct cfg_s *cfg)
+{
+  int              i;
+  ESL_SQFILE      *dbfp                     = NULL;
+  int              dbfmt                    = eslSQFILE_UNKNOWN;
+  ESL_ALPHABET    *abcAA                    = NULL;
+  ESL_ALPHABET    *abcDNA                   = NULL;
+  ESL_GENCODE     *gcode                    = NULL;
+  ESL_GENCODE    **gcodes                   = NULL;
+  int              ncodes                   = 0;
+  P7_HMM          *hmm                      = NULL;
+  P7_SCOREDATA    *scoredata                = NULL;
+  P7_SEEDINDEX    *seeds                    = NULL;
+  P7_FS_PROFILE   *gm_fs                    = NULL;
+  P7_PROFILE      *gm                       = NULL;
+  P7_OPROFILE     *om                       = NULL;
+  WORKER_INFO     *info                     = NULL;
+  ID_LENGTH_LIST  *id_length_list           = NULL;
+  P7_TMASKDB      *tmaskdb                  = NULL;
+  MPI_BLOCK        blk;
+  MPI_Status       mpistatus;
+  char            *mpi_buf                  = NULL;
+  int              mpi_size                 = 0;
+  int              ncpus                    = 0;
+  int              infocnt                  = 0;
+#ifdef HMMER_THREADS
+  ESL_SQ_BLOCK    *block                    = NULL;
+  ESL_THREADS     *threadObj                = NULL;
+  ESL_WORK_QUEUE  *queue                    = NULL;
+#endif
+  int              status                   = eslOK;
+  int              sstatus                  = eslOK;
+
+  if (esl_opt_IsOn(go, "--tformat")) {
+    dbfmt = esl_sqio_EncodeFormat(esl_opt_GetString(go, "--tformat"));
+    if (dbfmt == eslSQFILE_UNKNOWN) p7_Fail("%s is not a recognized sequence database file format\n", esl_opt_GetString(go, "--tformat"));
+  }
+
+  status = esl_sqfile_Open(cfg->dbfile, dbfmt, p7_SEQDBENV, &dbfp);
+  if      (status == eslENOTFOUND) p7_Fail("MPI worker %d failed to open sequence file %s for reading\n", cfg->my_rank, cfg->dbfile);
+  else if (status == eslEFORMAT)   p7_Fail("Sequence file %s is empty or misformatted\n",                cfg->dbfile);
+  else if (status != eslOK)        p7_Fail("Unexpected error %d opening sequence file %s\n", status, cfg->dbfile);
+
+  abcDNA = esl_alphabet_Create(eslDNA);
+  esl_sqfile_SetDigital(dbfp, abcDNA);
+  if (open_tmaskdb(go, cfg->dbfile, &tmaskdb) != eslOK) p7_Fail("MPI worker %d failed to load target masks\n", cfg->my_rank);
+
+#ifdef HMMER_THREADS
+  ncpus = ESL_MIN(esl_opt_GetInteger(go, "--cpu"), esl_threads_GetCPUCount());
+  if (ncpus > 0)
+    {
+      threadObj = esl_threads_Create(&pipeline_thread);
+      queue = esl_workqueue_Create(ncpus * 2);
+      for (i = 0; i < ncpus * 2; ++i)
+      {
+        block = esl_sq_CreateDigitalBlock(BLOCK_SIZE, abcDNA);
+        if (block == NULL)           esl_fatal("Failed to allocate sequence block");
+        status = esl_workqueue_Init(queue, block);
+        if (status != eslOK)          esl_fatal("Failed to add block to work queue");
+      }
+    }
+#endif
+
+  infocnt = (ncpus == 0) ? 1 : ncpus;
+  ESL_ALLOC(info, sizeof(*info) * infocnt);
+
+  /* Outer loop: over each query HMM the master sends */
+  while ((status = p7_hmm_MPIRecv(0, BATH_HMM_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size, &abcAA, &hmm)) == eslOK)
+  {
+    if (gcode == NULL) { /* one-time initializations after the query alphabet becomes known */
+      if (create_gencodes(go, abcDNA, abcAA, &gcodes, &ncodes) != eslOK) p7_Fail("MPI worker %d failed to set up genetic codes\n", cfg->my_rank);
+      gcode = gcodes[0];
+
+      for (i = 0; i < infocnt; ++i)
+      {
+        info[i].bg    = p7_bg_fs_Create(abcAA);
+#ifdef HMMER_THREADS
+        info[i].queue = queue;
+#endif
+      }
+    }
+
+    gm_fs = p7_profile_fs_Create (hmm->M, abcAA);
+    gm    = p7_profile_Create (hmm->M, abcAA);
+    om    = p7_oprofile_Create(hmm->M, abcAA);
+    p7_ProfileConfig(hmm, info->bg, gm, 100, p7_LOCAL);
+    p7_oprofile_Convert(gm, om);
+    p7_ProfileConfig_fs(hmm, info->bg, gcode, gm_fs, 100, p7_LOCAL);
+    scoredata = p7_hmm_ScoreDataCreate(om, NULL);
+
+    if (esl_opt_GetBoolean(go, "--kseed") &&
+        p7_seedindex_Build(&gm, 1, esl_opt_GetInteger(go, "--kseed_k"), esl_opt_GetReal(go, "--kseed_T"), &seeds) != eslOK)
+      p7_Fail("MPI worker %d failed to build k-mer seed index for %s\n", cfg->my_rank, hmm->name);
+
+    for (i = 0; i < infocnt; ++i)
+    {
+      info[i].gcode = gcode;
+      info[i].wrk1 = esl_gencode_WorkstateCreate(go, gcode);
+      info[i].wrk1->orf_block = esl_sq_CreateDigitalBlock(BLOCK_SIZE, abcAA);
+      info[i].wrk2 = esl_gencode_WorkstateCreate(go, gcode);
+      info[i].wrk2->orf_block = esl_sq_CreateDigitalBlock(BLOCK_SIZE, abcAA);
+      info[i].th     = p7_tophits_Create();
+      info[i].om     = p7_oprofile_Clone(om);
+      info[i].gm     = p7_profile_Clone(gm);
+      info[i].gm_fs  = p7_profile_fs_Clone(gm_fs);
+      info[i].scoredata = p7_hmm_ScoreDataClone(scoredata, om->abc->Kp);
+      info[i].do_batch  = ! esl_opt_GetBoolean(go, "--nobatch");
+      info[i].cc        = NULL;
+      if (xcodes_Create(go, &info[i], hmm, gcodes, ncodes) != eslOK) p7_Fail("Failed to set up genetic codes for %s\n", hmm->name);
+#ifdef HMMER_THREADS
+      info[i].progress = NULL;
+      info[i].wid      = i;
+#endif
+      info[i].pli = p7_pipeline_fs_Create(go, om->M, 300, TRUE, p7_SEARCH_SEQS);
+      info[i].pli->tmaskdb = tmaskdb;
+      info[i].pli->seeds   = seeds;
+      status = p7_pli_NewModel(info[i].pli, info[i].om, info[i].bg);
+      if (status == eslEINVAL) p7_Fail(info->pli->errbuf);
+
+      if      (strcmp(esl_opt_GetString(go, "--strand"), "both")  == 0) info[i].pli->strands = p7_STRAND_BOTH;
+      else if (strcmp(esl_opt_GetString(go, "--strand"), "plus")  == 0) info[i].pli->strands = p7_STRAND_TOPONLY;
+      else if (strcmp(esl_opt_GetString(go, "--strand"), "minus") == 0) info[i].pli->strands = p7_STRAND_BOTTOMONLY;
+      else     p7_Fail("Unrecognized argument for --strand ('%s'). Only 'both', 'plus', and 'minus' allowed.", esl_opt_GetString(go, "--strand"));
+
+      if (  esl_opt_IsUsed(go, "--block_length") )
+        info[i].pli->block_length = esl_opt_GetInteger(go, "--block_length");
+      else
+        info[i].pli->block_length = BATH_MAX_RESIDUE_COUNT;
+    }
+
+    id_length_list = init_id_length(1000);
+
+    /* Inner loop: over each target db block the master hands us */
+    while (1)
+    {
+      MPI_Send(&(cfg->my_rank), 1, MPI_INT, 0, BATH_READY_TAG, MPI_COMM_WORLD);
+      MPI_Recv(&blk, 3, MPI_INT64_T, 0, BATH_BLOCK_TAG, MPI_COMM_WORLD, &mpistatus);
+      if (blk.count == 0) break;
+
+      if (esl_sqfile_Position(dbfp, blk.offset) != eslOK)
+        p7_Fail("MPI worker %d failed to position %s at offset %" PRId64 "\n", cfg->my_rank, cfg->dbfile, blk.offset);
+
+#ifdef HMMER_THREADS
+      if (ncpus > 0) {
+        for (i = 0; i < infocnt; ++i)  /* thread_loop() joins its threads when it's done */
+          esl_threads_AddThread(threadObj, &info[i]);
+        sstatus = thread_loop(info, id_length_list, threadObj, queue, dbfp, NULL, blk.count, blk.first_seqidx);
+      }
+      else
+#endif
+        sstatus = serial_loop(info, id_length_list, dbfp, NULL, blk.count, blk.first_seqidx);
+
+      switch(sstatus) {
+        case eslEFORMAT:
+          esl_fatal("Parse failed (sequence file %s):\n%s\n",
+                     dbfp->filename, esl_sqfile_GetErrorBuf(dbfp));
+          break;
+        case eslEOF:
+        case eslOK:
+          /* do nothing */
+          break;
+        default:
+          esl_fatal("Unexpected error %d reading sequence file %s", sstatus, dbfp->filename);
+      }
+    }
+
+    /* collect this worker's results in info[0], and send them home */
+    for (i = 1; i < infocnt; ++i)
+    {
+      p7_tophits_Merge(info[0].th, info[i].th);
+      p7_pipeline_Merge(info[0].pli, info[i].pli);
+    }
+    p7_tophits_SortBySeqidxAndAlipos(info[0].th);
+    assign_Lengths(info[0].th, id_length_list);
+
+    p7_pipeline_MPISend(info[0].pli, 0, BATH_PIPELINE_TAG, MPI_COMM_WORLD, &mpi_buf, &mpi_size);
+    p7_tophits_MPISend (info[0].th,  0, BATH_TOPHITS_TAG,  MPI_COMM_WORLD, &mpi_buf, &mpi_size);
+
+    for (i = 0; i < infocnt; ++i)
+    {
+      p7_pipeline_fs_Destroy(info[i].pli);
+      p7_tophits_Destroy(info[i].th);
+      p7_oprofile_Destroy(info[i].om);
+      p7_profile_Destroy(info[i].gm);
+      p7_profile_fs_Destroy(info[i].gm_fs);
+      p7_hmm_ScoreDataDestroy(info[i].scoredata);
+      xcodes_Destroy(&info[i]);
+      esl_sq_DestroyBlock(info[i].wrk1->orf_block);
+      esl_gencode_WorkstateDestroy(info[i].wrk1);
+      esl_sq_DestroyBlock(info[i].wrk2->orf_block);
+      esl_gencode_WorkstateDestroy(info[i].wrk2);
+    }
+
+    p7_oprofile_Destroy(om);
+    p7_profile_Destroy(gm);
+    p7_profile_fs_Destroy(gm_fs);
+    p7_hmm_ScoreDataDestroy(scoredata);
+    p7_seedindex_Destroy(seeds);
+    seeds = NULL;
+    p7_hmm_Destroy(hmm);
+    destroy_id_length(id_length_list);
+    hmm = NULL;
+  }
+  if (status != eslEOD) p7_Fail("MPI worker %d failed to receive a query HMM (%d)\n", cfg->my_rank, status);
+
+  if (gcode != NULL)
+    for (i = 0; i < infocnt; ++i)
+      p7_bg_Destroy(info[i].bg);
+
+#ifdef HMMER_THREADS
+  if (ncpus > 0)
+  {
+    esl_workqueue_Reset(queue);
+    while (esl_workqueue_Remove(queue, (void **) &block) == eslOK) {
+      esl_sq_DestroyBlock(block);
+    }
+    esl_workqueue_Destroy(queue);
+    esl_threads_Destroy(threadObj);
+  }
+#endif
+
+  free(info);
+  free(mpi_buf);
+  esl_sqfile_Close(dbfp);
+  p7_tmaskdb_Destroy(tmaskdb);
+  if (gcode)  destroy_gencodes(gcodes, ncodes);
+  if (abcAA)  esl_alphabet_Destroy(abcAA);
+  esl_alphabet_Destroy(abcDNA);
+  return eslOK;
+
+ ERROR:
+  p7_Fail("MPI worker %d: allocation failed\n", cfg->my_rank);
+  return status;
+}
+#endif /*HMMER_MPI*/
+
+
 static ID_LENGTH_LIST *
 init_id_length( int size )
 {
@@ -21,36 +21,49 @@
  * 1. Forward, Backward, Hybrid implementations.
  *****************************************************************/
 
-/* Function:  p7_Forward_Frameshift()
- * Synopsis:  The Forward algorithm.
- *
- * Purpose:   The Forward dynamic programming algorithm for frameshift
- *            aware translated comarison between a dna sequence and an
- *            amino acid HMM. 
- *
- *            Given a digital sequence <dsq> of length <L>, a profile
- *            <gm>, and DP matrix <gx> allocated for at least <gm->M>
- *            by <L> cells; calculate the probability of the sequence
- *            given the model using the Forward algorithm; return the
- *            Forward matrix in <gx>, and the Forward score in <ret_sc>.
- *           
- *            The Forward score is in lod score form.  To convert to a
- *            bitscore, the caller needs to subtract a null model lod
- *            score, then convert to bits.
- *           
- *            Caller must have initialized the log-sum calculation
- *            with a call to <p7_FLogsumInit()>.
- *
- * Args:      dsq    - sequence in digitized form, 1..L
- *            L      - length of dsq
- *            gm     - profile. 
- *            gx     - DP matrix with room for an MxL alignment
- *            opt_sc - optRETURN: Forward lod score in nats
- *           
- * Return:    <eslOK> on success.
+/* The Forward kernels are specialized at compile time on the three
+ * properties that change the inner recursion: local vs. glocal entry/exit
+ * (do the M/D -> E transitions at k < M exist?), multihit vs. unihit
+ * (is the J state reachable?) and whether every residue of the target
+ * window is A/C/G/T (can the per-residue canonical check be skipped?).
+ * FS_KERNEL() stamps out one wrapper per combination around a
+ * <static inline> body, and fs_kernel_index() picks the wrapper at run time.
+ * Every specialization computes exactly the same matrix as the general case.
  */
-int
-p7_Forward_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc)
+typedef int (*fs_kernel_f)(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc);
+
+#define FS_KERNEL(kname, body, local, multi, canon)                                                                   \
+  static int kname(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc) \
+  { return body(dsq, gcode, L, gm_fs, gx, opt_sc, (local), (multi), (canon)); }
+
+/* fs_kernel_index()
+ * Returns the index into a kernel table for the configuration of <gm_fs>
+ * and the content of <dsq>: bit 2 = local, bit 1 = multihit, bit 0 = all
+ * residues canonical. Unihit is judged by the E->J transition rather than
+ * by <gm_fs->mode>, because p7_fs_ReconfigUnihit() only edits <xsc>.
+ */
+static int
+fs_kernel_index(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs)
+{
+  int do_local      = p7_fs_profile_IsLocal(gm_fs)                   ? 1 : 0;
+  int do_multi      = (gm_fs->xsc[p7P_E][p7P_LOOP] != -eslINFINITY) ? 1 : 0;
+  int all_canonical = 1;
+  int i;
+
+  for (i = 1; i <= L; i++)
+    if (! esl_abc_XIsCanonical(gcode->nt_abc, dsq[i])) { all_canonical = 0; break; }
+
+  return (do_local << 2) | (do_multi << 1) | all_canonical;
+}
+
+/* forward_frameshift_body() is the shared body of the <p7_Forward_Frameshift()> kernels.
+ * <do_local>, <do_multi> and <all_canonical> are always compile-time
+ * constants at the call sites below, so the compiler folds the
+ * mode tests out of the i >= 5 recursion in each specialization.
+ */
+static inline int
+forward_frameshift_body(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc,
+                        const int do_local, const int do_multi, const int all_canonical)
 { 
 
   float const *tsc  = gm_fs->tsc;
@@ -61,7 +74,7 @@ p7_Forward_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const
   int          c1, c2, c3, c4, c5;
   int          t, u, v, w, x;  
   int          status;
-  float        esc  = p7_fs_profile_IsLocal(gm_fs) ? 0 : -eslINFINITY;
+  float        esc  = do_local ? 0 : -eslINFINITY;
   float *iv        = NULL;
 
   /* Allocation and initalization of invermediate value array */
@@ -231,8 +244,8 @@ p7_Forward_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const
     w = x;
 
     /* if new nucleotide is not A,C,G, or T set it to placeholder vlaue */  
-    if(esl_abc_XIsCanonical(gcode->nt_abc, dsq[i])) x = dsq[i];
-    else                                            x = p7P_MAXCODONS; 
+    if(all_canonical || esl_abc_XIsCanonical(gcode->nt_abc, dsq[i])) x = dsq[i];
+    else                                                              x = p7P_MAXCODONS; 
   
     /* find correct index for looking up scores of codons and quasicodons */ 
     c1 = p7P_CODON1(x);
@@ -280,10 +293,11 @@ p7_Forward_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const
       DMX_FS(i,k) = p7_FLogsum(MMX_FS(i,k-1,p7G_C0) + TSC(p7P_MD,k-1),
                                DMX_FS(i,k-1)        + TSC(p7P_DD,k-1));
 
-      /* E state update */
-      XMX_FS(i,p7G_E) = p7_FLogsum(MMX_FS(i,k,p7G_C0) + esc,
-                        p7_FLogsum(DMX_FS(i,k)        + esc,  
-                                   XMX_FS(i,p7G_E)));
+      /* E state update; in glocal mode only M_M and D_M reach E */
+      if (do_local)
+        XMX_FS(i,p7G_E) = p7_FLogsum(MMX_FS(i,k,p7G_C0),
+                          p7_FLogsum(DMX_FS(i,k),
+                                     XMX_FS(i,p7G_E)));
     }
 
     /* unrolled match state M_M */
@@ -317,14 +331,20 @@ p7_Forward_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const
                                             DMX_FS(i,M)),
                                             XMX_FS(i,p7G_E));
 
-    /* J, C and N states */
-    XMX_FS(i,p7G_J) = p7_FLogsum(XMX_FS(i-3,p7G_J) + gm_fs->xsc[p7P_J][p7P_LOOP],
-                                 XMX_FS(i,p7G_E)   + gm_fs->xsc[p7P_E][p7P_LOOP]);
+    /* J, C and N states; J is unreachable in unihit mode */
+    if (do_multi)
+      XMX_FS(i,p7G_J) = p7_FLogsum(XMX_FS(i-3,p7G_J) + gm_fs->xsc[p7P_J][p7P_LOOP],
+                                   XMX_FS(i,p7G_E)   + gm_fs->xsc[p7P_E][p7P_LOOP]);
+    else
+      XMX_FS(i,p7G_J) = -eslINFINITY;
     XMX_FS(i,p7G_C) = p7_FLogsum(XMX_FS(i-3,p7G_C) + gm_fs->xsc[p7P_C][p7P_LOOP],
                                  XMX_FS(i,p7G_E)   + gm_fs->xsc[p7P_E][p7P_MOVE]);
     XMX_FS(i,p7G_N) =            XMX_FS(i-3,p7G_N) + gm_fs->xsc[p7P_N][p7P_LOOP];
-    XMX_FS(i,p7G_B) = p7_FLogsum(XMX_FS(i,p7G_N) + gm_fs->xsc[p7P_N][p7P_MOVE],
-                                 XMX_FS(i,p7G_J) + gm_fs->xsc[p7P_J][p7P_MOVE]);
+    if (do_multi)
+      XMX_FS(i,p7G_B) = p7_FLogsum(XMX_FS(i,p7G_N) + gm_fs->xsc[p7P_N][p7P_MOVE],
+                                   XMX_FS(i,p7G_J) + gm_fs->xsc[p7P_J][p7P_MOVE]);
+    else
+      XMX_FS(i,p7G_B) =            XMX_FS(i,p7G_N) + gm_fs->xsc[p7P_N][p7P_MOVE];
 	
   }
 
@@ -345,7 +365,21 @@ ERROR:
   return status;
 }
 
-/* Function:  p7_Forward_Parser_Frameshift()
+FS_KERNEL(fwd_fs_gl_uni_any, forward_frameshift_body, 0, 0, 0)
+FS_KERNEL(fwd_fs_gl_uni_acgt, forward_frameshift_body, 0, 0, 1)
+FS_KERNEL(fwd_fs_gl_mul_any, forward_frameshift_body, 0, 1, 0)
+FS_KERNEL(fwd_fs_gl_mul_acgt, forward_frameshift_body, 0, 1, 1)
+FS_KERNEL(fwd_fs_lo_uni_any, forward_frameshift_body, 1, 0, 0)
+FS_KERNEL(fwd_fs_lo_uni_acgt, forward_frameshift_body, 1, 0, 1)
+FS_KERNEL(fwd_fs_lo_mul_any, forward_frameshift_body, 1, 1, 0)
+FS_KERNEL(fwd_fs_lo_mul_acgt, forward_frameshift_body, 1, 1, 1)
+
+static const fs_kernel_f fwd_fs_kernels[8] = {
+  fwd_fs_gl_uni_any, fwd_fs_gl_uni_acgt, fwd_fs_gl_mul_any, fwd_fs_gl_mul_acgt,
+  fwd_fs_lo_uni_any, fwd_fs_lo_uni_acgt, fwd_fs_lo_mul_any, fwd_fs_lo_mul_acgt
+};
+
+/* Function:  p7_Forward_Frameshift()
  * Synopsis:  The Forward algorithm.
  *
  * Purpose:   The Forward dynamic programming algorithm for frameshift
@@ -374,7 +408,19 @@ ERROR:
  * Return:    <eslOK> on success.
  */
 int
-p7_ForwardParser_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc)
+p7_Forward_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc)
+{
+  return fwd_fs_kernels[fs_kernel_index(dsq, gcode, L, gm_fs)](dsq, gcode, L, gm_fs, gx, opt_sc);
+}
+
+/* forward_parser_frameshift_body() is the shared body of the <p7_ForwardParser_Frameshift()> kernels.
+ * <do_local>, <do_multi> and <all_canonical> are always compile-time
+ * constants at the call sites below, so the compiler folds the
+ * mode tests out of the i >= 5 recursion in each specialization.
+ */
+static inline int
+forward_parser_frameshift_body(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc,
+                               const int do_local, const int do_multi, const int all_canonical)
 { 
 
   float const *tsc  = gm_fs->tsc;
@@ -386,7 +432,7 @@ p7_ForwardParser_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L,
   int          c1, c2, c3, c4, c5;  
   int          t, u, v, w, x;
   int          status;
-  float        esc  = p7_fs_profile_IsLocal(gm_fs) ? 0 : -eslINFINITY;
+  float        esc  = do_local ? 0 : -eslINFINITY;
   float *iv        = NULL;
   int curr, prev1, prev3;
 
@@ -544,8 +590,8 @@ p7_ForwardParser_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L,
     w = x;
 
     /* if new nucleotide is not A,C,G, or T set it to placeholder vlaue */  
-    if(esl_abc_XIsCanonical(gcode->nt_abc, dsq[i])) x = dsq[i];
-    else                                            x = p7P_MAXCODONS; 
+    if(all_canonical || esl_abc_XIsCanonical(gcode->nt_abc, dsq[i])) x = dsq[i];
+    else                                                              x = p7P_MAXCODONS; 
   
     /* find correct index for looking up scores of codons and quasicodons */ 
     c1 = p7P_CODON1(x);
@@ -589,10 +635,11 @@ p7_ForwardParser_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L,
       DMX(curr,k) = p7_FLogsum(MMX(curr,k-1) + TSC(p7P_MD,k-1),
                                DMX(curr,k-1) + TSC(p7P_DD,k-1));
 
-      /* E state update */
-      XMX(i,p7G_E) = p7_FLogsum(MMX(curr,k) + esc,
-                     p7_FLogsum(DMX(curr,k) + esc,  
-                                XMX(i,p7G_E)));
+      /* E state update; in glocal mode only M_M and D_M reach E */
+      if (do_local)
+        XMX(i,p7G_E) = p7_FLogsum(MMX(curr,k),
+                       p7_FLogsum(DMX(curr,k),
+                                  XMX(i,p7G_E)));
     }
 
     /* unrolled match state M_M */
@@ -622,17 +669,23 @@ p7_ForwardParser_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L,
                    p7_FLogsum(DMX(curr,M),
                               XMX(i,p7G_E)));
 
-    /* J, C and N states */
-    XMX(i,p7G_J) = p7_FLogsum(XMX(i-3,p7G_J) + gm_fs->xsc[p7P_J][p7P_LOOP],
-                              XMX(i,p7G_E)   + gm_fs->xsc[p7P_E][p7P_LOOP]);
+    /* J, C and N states; J is unreachable in unihit mode */
+    if (do_multi)
+      XMX(i,p7G_J) = p7_FLogsum(XMX(i-3,p7G_J) + gm_fs->xsc[p7P_J][p7P_LOOP],
+                                XMX(i,p7G_E)   + gm_fs->xsc[p7P_E][p7P_LOOP]);
+    else
+      XMX(i,p7G_J) = -eslINFINITY;
 
     XMX(i,p7G_C) = p7_FLogsum(XMX(i-3,p7G_C) + gm_fs->xsc[p7P_C][p7P_LOOP],
                               XMX(i,p7G_E)   + gm_fs->xsc[p7P_E][p7P_MOVE]);
 
     XMX(i,p7G_N) =            XMX(i-3,p7G_N) + gm_fs->xsc[p7P_N][p7P_LOOP];
 
-    XMX(i,p7G_B) = p7_FLogsum(XMX(i,p7G_N) + gm_fs->xsc[p7P_N][p7P_MOVE],
-                              XMX(i,p7G_J) + gm_fs->xsc[p7P_J][p7P_MOVE]);
+    if (do_multi)
+      XMX(i,p7G_B) = p7_FLogsum(XMX(i,p7G_N) + gm_fs->xsc[p7P_N][p7P_MOVE],
+                                XMX(i,p7G_J) + gm_fs->xsc[p7P_J][p7P_MOVE]);
+    else
+      XMX(i,p7G_B) =            XMX(i,p7G_N) + gm_fs->xsc[p7P_N][p7P_MOVE];
   }
 
 
@@ -652,6 +705,54 @@ ERROR:
   return status;
 }
 
+FS_KERNEL(fwdparser_fs_gl_uni_any, forward_parser_frameshift_body, 0, 0, 0)
+FS_KERNEL(fwdparser_fs_gl_uni_acgt, forward_parser_frameshift_body, 0, 0, 1)
+FS_KERNEL(fwdparser_fs_gl_mul_any, forward_parser_frameshift_body, 0, 1, 0)
+FS_KERNEL(fwdparser_fs_gl_mul_acgt, forward_parser_frameshift_body, 0, 1, 1)
+FS_KERNEL(fwdparser_fs_lo_uni_any, forward_parser_frameshift_body, 1, 0, 0)
+FS_KERNEL(fwdparser_fs_lo_uni_acgt, forward_parser_frameshift_body, 1, 0, 1)
+FS_KERNEL(fwdparser_fs_lo_mul_any, forward_parser_frameshift_body, 1, 1, 0)
+FS_KERNEL(fwdparser_fs_lo_mul_acgt, forward_parser_frameshift_body, 1, 1, 1)
+
+static const fs_kernel_f fwdparser_fs_kernels[8] = {
+  fwdparser_fs_gl_uni_any, fwdparser_fs_gl_uni_acgt, fwdparser_fs_gl_mul_any, fwdparser_fs_gl_mul_acgt,
+  fwdparser_fs_lo_uni_any, fwdparser_fs_lo_uni_acgt, fwdparser_fs_lo_mul_any, fwdparser_fs_lo_mul_acgt
+};
+
+/* Function:  p7_Forward_Parser_Frameshift()
+ * Synopsis:  The Forward algorithm.
+ *
+ * Purpose:   The Forward dynamic programming algorithm for frameshift
+ *            aware translated comarison between a dna sequence and an
+ *            amino acid HMM. 
+ *
+ *            Given a digital sequence <dsq> of length <L>, a profile
+ *            <gm>, and DP matrix <gx> allocated for at least <gm->M>
+ *            by <L> cells; calculate the probability of the sequence
+ *            given the model using the Forward algorithm; return the
+ *            Forward matrix in <gx>, and the Forward score in <ret_sc>.
+ *           
+ *            The Forward score is in lod score form.  To convert to a
+ *            bitscore, the caller needs to subtract a null model lod
+ *            score, then convert to bits.
+ *           
+ *            Caller must have initialized the log-sum calculation
+ *            with a call to <p7_FLogsumInit()>.
+ *
+ * Args:      dsq    - sequence in digitized form, 1..L
+ *            L      - length of dsq
+ *            gm     - profile. 
+ *            gx     - DP matrix with room for an MxL alignment
+ *            opt_sc - optRETURN: Forward lod score in nats
+ *           
+ * Return:    <eslOK> on success.
+ */
+int
+p7_ForwardParser_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc)
+{
+  return fwdparser_fs_kernels[fs_kernel_index(dsq, gcode, L, gm_fs)](dsq, gcode, L, gm_fs, gx, opt_sc);
+}
+
 
 /* Function:  p7_Backward_Frameshift()
  * Synopsis:  The Backward algorithm.
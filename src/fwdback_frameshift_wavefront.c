@@ -0,0 +1,1419 @@
+/* Tiled and wavefront parallel Forward/Backward for frameshift aware models.
+ *
+ * For very long models on long DNA windows a single call to
+ * p7_Forward_Frameshift() can take seconds, and it bounds the latency
+ * of each hit no matter how many cores are idle. Here the M x L
+ * matrix is cut into tiles of <TR> rows by <TK> nodes, and worker
+ * threads fill the tiles in anti-diagonal (wavefront) order. Tile
+ * (b,t) may start as soon as tile (b-1,t) above it and tile (b,t-1) to
+ * its left are done.
+ *
+ * The same tiles also help a single thread. A Forward row of a large
+ * model (8 floats per node, read back one and three rows later) no
+ * longer fits in L2, so the row-at-a-time recursion streams every row
+ * from L3 or memory. p7_Forward_Frameshift_Tiled() and
+ * p7_Backward_Frameshift_Tiled() fill the tiles one after another,
+ * row of tiles by row of tiles, with the tile width chosen from the
+ * detected L2 size so that the rows a tile reads stay cached.
+ *
+ * Tiling is only exact when the special states in row i do not feed
+ * back into the core model in row i+1; that is, when the profile is
+ * in a unihit configuration (E->J is impossible), which is the case
+ * for the envelope rescoring done by domain definition. The B state
+ * (Forward) or the E state (Backward) then depends only on the flanking
+ * N or C states, and can be computed for all rows before the core is
+ * filled; the rest of the special states are finished afterwards.
+ * Multihit profiles, short windows, and (for the wavefront)
+ * non-threaded builds fall back to the serial implementations.
+ *
+ * Forward cells are computed with exactly the same operations, in the
+ * same order, as p7_Forward_Frameshift(), so the two give identical
+ * matrices and scores. Tiled Backward core cells are identical to
+ * p7_Backward_Frameshift()'s too; only the B state, which sums over
+ * all nodes of a row, is accumulated tile by tile in a different
+ * order, so B, J, N and the score agree to within logsum roundoff.
+ *
+ * Contents:
+ *   1. Tiled and wavefront Forward/Backward implementation.
+ *   2. Benchmark driver.
+ *   3. Unit tests.
+ *   4. Test driver.
+ */
+#include "p7_config.h"
+
+#include <unistd.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_gencode.h"
+
+#ifdef HMMER_THREADS
+#include <pthread.h>
+#endif /*HMMER_THREADS*/
+
+#include "hmmer.h"
+
+/* The codon lookback of the M state reaches back to the C1 value
+ * computed four rows earlier, and the I state reaches back three
+ * rows. Tiles at least this tall only look back into the tile row
+ * immediately above them; shorter tiles would just add
+ * synchronization.
+ */
+#define p7_WAVEFRONT_MINROWS 8
+
+/* Serial tiles are this tall; their width is then fitted to L2. */
+#define p7_FS_TILE_ROWS      32
+
+typedef struct {
+  const P7_FS_PROFILE *gm_fs;
+  P7_GMX              *gx;
+  int                  L;
+  int                  M;
+  float                esc;    /* local/glocal end score                                           */
+  int                 *cidx;   /* cidx[i*p7P_CODONS+c]: emission index of codon C(c+1) ending at i  */
+                               /*   (Backward: starting at i+1)                                     */
+  float               *iv;     /* iv[k*p7P_CODONS + i%p7P_CODONS]: C1 value of node k, last 5 rows */
+                               /*   (Backward: iv[k] of the current row)                            */
+
+  int                  TR;     /* tile height, in rows                                             */
+  int                  TK;     /* tile width, in model nodes                                       */
+  int                  nbi;    /* number of tile rows                                              */
+  int                  nbk;    /* number of tile columns                                           */
+  int                 *order;  /* tiles in wavefront order; tile = b*nbk + t                       */
+  int                 *done;   /* done[tile] = TRUE once tile is filled                            */
+  int                  next;   /* next position in <order> to hand out                             */
+
+#ifdef HMMER_THREADS
+  pthread_mutex_t      mutex;
+  pthread_cond_t       cond;
+#endif /*HMMER_THREADS*/
+} P7_WAVEFRONT;
+
+/* A pool of wavefront workers that outlives one matrix. Starting and
+ * joining threads for every Forward call costs about as much as the
+ * smaller envelopes the wavefront is meant to speed up, so the pool is
+ * created once (by the domain definition object, for --fwd_cpu) and its
+ * workers sleep on <start> between matrices. A pool serves one caller
+ * at a time.
+ */
+struct p7_fs_wavepool_s {
+  int                  nthreads; /* number of workers; <2 means the wavefront is never used    */
+#ifdef HMMER_THREADS
+  pthread_t           *tid;
+  pthread_mutex_t      mutex;
+  pthread_cond_t       start;    /* broadcast when a matrix is posted, or on shutdown          */
+  pthread_cond_t       finish;   /* signalled when the last worker is done with the matrix     */
+  P7_WAVEFRONT        *wf;       /* matrix being filled                                         */
+  uint64_t             njobs;    /* matrices posted so far; workers compare it to the last seen */
+  int                  nbusy;    /* workers still working on the current matrix                 */
+  int                  shutdown; /* TRUE: workers exit                                          */
+#endif /*HMMER_THREADS*/
+};
+
+static int  wavefront_setup (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, int TR, int TK, P7_WAVEFRONT *wf);
+static void wavefront_finish(P7_WAVEFRONT *wf, float *opt_sc);
+static void wavefront_free  (P7_WAVEFRONT *wf);
+static void wavefront_tile  (P7_WAVEFRONT *wf, int b, int t);
+static int  forward_tiled   (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, int TR, int TK, float *opt_sc);
+static int  backward_tiled  (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, int TR, int TK, float *opt_sc);
+static void backward_tile   (P7_WAVEFRONT *wf, int b, int t);
+static long fs_cache_bytes  (void);
+static int  fs_tile_width   (int M, int cellbytes, int nrows);
+#ifdef HMMER_THREADS
+static int   forward_wavefront(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, P7_FS_WAVEPOOL *pool, int TR, int TK, float *opt_sc);
+static void  wavefront_work  (P7_WAVEFRONT *wf);
+static void *wavepool_thread (void *arg);
+#endif /*HMMER_THREADS*/
+
+/* Bytes of DP matrix per node and row, and the rows a row reads:
+ * Forward reads i-1 and i-3 and the C1 ring; Backward reads i+1..i+5.
+ */
+#define FWD_CELLBYTES  ((int) sizeof(float) * (p7G_NSCELLS_FS + p7P_CODONS))
+#define FWD_NROWS      4
+#define BCK_CELLBYTES  ((int) sizeof(float) * (p7G_NSCELLS + 1))
+#define BCK_NROWS      6
+
+/*****************************************************************
+ * 1. Tiled and wavefront Forward/Backward implementation.
+ *****************************************************************/
+
+/* Function:  p7_ForwardAuto_Frameshift() - BATH
+ * Synopsis:  Forward, using the wavefront or tiled version on large matrices.
+ *
+ * Purpose:   Dispatcher for the frameshift aware Forward algorithm.
+ *            If <gm_fs> is in a unihit configuration, <pool> has at
+ *            least two workers and the DP matrix has at least
+ *            <p7_FS_WAVEFRONT_MINCELLS> cells, run
+ *            <p7_Forward_Frameshift_Wavefront()> on <pool>.
+ *            Otherwise, if <gm_fs> is unihit and the rows one Forward
+ *            row reads don't fit in L2, run the serial
+ *            <p7_Forward_Frameshift_Tiled()>; otherwise run the plain
+ *            serial <p7_Forward_Frameshift()>. Either way the result
+ *            in <gx> and <opt_sc> is the same.
+ *
+ * Args:      dsq    - sequence in digitized form, 1..L
+ *            gcode  - genetic code
+ *            L      - length of dsq
+ *            gm_fs  - frameshift aware profile
+ *            gx     - DP matrix with room for an MxL alignment
+ *            pool   - wavefront workers, or NULL to stay serial
+ *            opt_sc - optRETURN: Forward lod score in nats
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_ForwardAuto_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, P7_FS_WAVEPOOL *pool, float *opt_sc)
+{
+  if (gm_fs->xsc[p7P_E][p7P_LOOP] == -eslINFINITY)
+    {
+      if (pool != NULL && pool->nthreads > 1 && (int64_t) gm_fs->M * (int64_t) L >= p7_FS_WAVEFRONT_MINCELLS)
+        return p7_Forward_Frameshift_Wavefront(dsq, gcode, L, gm_fs, gx, pool, opt_sc);
+      if ((int64_t) (gm_fs->M+1) * FWD_CELLBYTES * FWD_NROWS > fs_cache_bytes())
+        return p7_Forward_Frameshift_Tiled(dsq, gcode, L, gm_fs, gx, opt_sc);
+    }
+  return p7_Forward_Frameshift(dsq, gcode, L, gm_fs, gx, opt_sc);
+}
+
+
+/* Function:  p7_BackwardAuto_Frameshift() - BATH
+ * Synopsis:  Backward, using the tiled version on large matrices.
+ *
+ * Purpose:   Dispatcher for the frameshift aware Backward algorithm:
+ *            if <gm_fs> is in a unihit configuration and the rows one
+ *            Backward row reads don't fit in L2, run
+ *            <p7_Backward_Frameshift_Tiled()>, else the serial
+ *            <p7_Backward_Frameshift()>.
+ *
+ * Args:      dsq    - sequence in digitized form, 1..L
+ *            gcode  - genetic code
+ *            L      - length of dsq
+ *            gm_fs  - frameshift aware profile
+ *            gx     - DP matrix with room for an MxL alignment
+ *            opt_sc - optRETURN: Backward lod score in nats
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_BackwardAuto_Frameshift(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc)
+{
+  if (gm_fs->xsc[p7P_E][p7P_LOOP] == -eslINFINITY &&
+      (int64_t) (gm_fs->M+1) * BCK_CELLBYTES * BCK_NROWS > fs_cache_bytes())
+    return p7_Backward_Frameshift_Tiled(dsq, gcode, L, gm_fs, gx, opt_sc);
+
+  return p7_Backward_Frameshift(dsq, gcode, L, gm_fs, gx, opt_sc);
+}
+
+
+/* Function:  p7_Forward_Frameshift_Wavefront() - BATH
+ * Synopsis:  Multithreaded anti-diagonal Forward algorithm.
+ *
+ * Purpose:   Same as <p7_Forward_Frameshift()>, but the core of the
+ *            DP matrix is filled by the workers of <pool> along
+ *            anti-diagonal wavefronts of tiles. Tile sizes are chosen
+ *            so that there are about twice as many tile columns as
+ *            workers.
+ *
+ *            <gm_fs> must be in a unihit configuration (as set by
+ *            <p7_fs_ReconfigUnihit()>). If it isn't, or if <pool> is
+ *            NULL or has fewer than two workers, or HMMER was built
+ *            without thread support, this silently falls back to the
+ *            serial <p7_Forward_Frameshift()>.
+ *
+ * Args:      dsq    - sequence in digitized form, 1..L
+ *            gcode  - genetic code
+ *            L      - length of dsq
+ *            gm_fs  - frameshift aware profile, unihit mode
+ *            gx     - DP matrix with room for an MxL alignment
+ *            pool   - wavefront workers, from <p7_fs_wavepool_Create()>
+ *            opt_sc - optRETURN: Forward lod score in nats
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_Forward_Frameshift_Wavefront(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, P7_FS_WAVEPOOL *pool, float *opt_sc)
+{
+#ifdef HMMER_THREADS
+  int TK, TR;
+
+  if (pool == NULL || pool->nthreads < 2 || L < p7_WAVEFRONT_MINROWS || gm_fs->M < 2 || gm_fs->xsc[p7P_E][p7P_LOOP] != -eslINFINITY)
+    return p7_Forward_Frameshift(dsq, gcode, L, gm_fs, gx, opt_sc);
+
+  TK = ESL_MAX(16, (gm_fs->M + 2*pool->nthreads - 1) / (2*pool->nthreads));
+  TR = ESL_MAX(p7_WAVEFRONT_MINROWS, TK / 2);
+  return forward_wavefront(dsq, gcode, L, gm_fs, gx, pool, TR, TK, opt_sc);
+#else
+  return p7_Forward_Frameshift(dsq, gcode, L, gm_fs, gx, opt_sc);
+#endif /*HMMER_THREADS*/
+}
+
+
+/* Function:  p7_fs_wavepool_Create() - BATH
+ * Synopsis:  Start a pool of wavefront Forward workers.
+ *
+ * Purpose:   Start <ncpu> worker threads for
+ *            <p7_Forward_Frameshift_Wavefront()>. The workers sleep
+ *            until a matrix is handed to the pool, so one pool can be
+ *            kept for a whole search and reused for every large
+ *            envelope. A pool serves one caller at a time.
+ *
+ *            If <ncpu> is less than two, or HMMER was built without
+ *            thread support, no threads are started, and the
+ *            wavefront functions fall back to serial Forward.
+ *
+ * Returns:   a pointer to the new pool.
+ *
+ * Throws:    <NULL> on allocation or thread creation failure.
+ */
+P7_FS_WAVEPOOL *
+p7_fs_wavepool_Create(int ncpu)
+{
+  P7_FS_WAVEPOOL *pool  = NULL;
+#ifdef HMMER_THREADS
+  int             nsync = 0;      /* how many of mutex, start, finish are initialized */
+#endif
+  int             status;
+
+  ESL_ALLOC(pool, sizeof(P7_FS_WAVEPOOL));
+  pool->nthreads = 0;
+#ifdef HMMER_THREADS
+  pool->tid      = NULL;
+  pool->wf       = NULL;
+  pool->njobs    = 0;
+  pool->nbusy    = 0;
+  pool->shutdown = FALSE;
+  if (pthread_mutex_init(&pool->mutex,  NULL) != 0) ESL_XEXCEPTION(eslESYS, "mutex init failed");
+  nsync++;
+  if (pthread_cond_init (&pool->start,  NULL) != 0) ESL_XEXCEPTION(eslESYS, "cond init failed");
+  nsync++;
+  if (pthread_cond_init (&pool->finish, NULL) != 0) ESL_XEXCEPTION(eslESYS, "cond init failed");
+  nsync++;
+  if (ncpu < 2) return pool;
+
+  ESL_ALLOC(pool->tid, sizeof(pthread_t) * ncpu);
+  while (pool->nthreads < ncpu)
+    {
+      if (pthread_create(&pool->tid[pool->nthreads], NULL, wavepool_thread, pool) != 0) ESL_XEXCEPTION(eslESYS, "thread creation failed");
+      pool->nthreads++;
+    }
+#endif /*HMMER_THREADS*/
+  return pool;
+
+ ERROR:
+#ifdef HMMER_THREADS
+  if (pool != NULL && nsync < 3) {
+    /* the pool never got its sync objects: undo what was made, without Destroy() */
+    if (nsync > 1) pthread_cond_destroy(&pool->start);
+    if (nsync > 0) pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+    return NULL;
+  }
+#endif /*HMMER_THREADS*/
+  p7_fs_wavepool_Destroy(pool);
+  return NULL;
+}
+
+
+/* Function:  p7_fs_wavepool_Destroy() - BATH
+ * Synopsis:  Stop and free a pool of wavefront workers.
+ */
+void
+p7_fs_wavepool_Destroy(P7_FS_WAVEPOOL *pool)
+{
+#ifdef HMMER_THREADS
+  int n;
+#endif
+
+  if (pool == NULL) return;
+#ifdef HMMER_THREADS
+  pthread_mutex_lock(&pool->mutex);
+  pool->shutdown = TRUE;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->mutex);
+  for (n = 0; n < pool->nthreads; n++) pthread_join(pool->tid[n], NULL);
+
+  pthread_cond_destroy(&pool->finish);
+  pthread_cond_destroy(&pool->start);
+  pthread_mutex_destroy(&pool->mutex);
+  if (pool->tid) free(pool->tid);
+#endif /*HMMER_THREADS*/
+  free(pool);
+}
+
+
+/* Function:  p7_Forward_Frameshift_Tiled() - BATH
+ * Synopsis:  Cache-blocked serial Forward algorithm.
+ *
+ * Purpose:   Same as <p7_Forward_Frameshift()>, but the core of the
+ *            DP matrix is filled in tiles of <p7_FS_TILE_ROWS> rows by
+ *            as many nodes as keep the rows a tile reads within half
+ *            of L2. The matrix and score are identical to the serial
+ *            ones.
+ *
+ *            <gm_fs> must be in a unihit configuration; if it isn't,
+ *            or the window is very short, this falls back to
+ *            <p7_Forward_Frameshift()>.
+ *
+ * Args:      dsq    - sequence in digitized form, 1..L
+ *            gcode  - genetic code
+ *            L      - length of dsq
+ *            gm_fs  - frameshift aware profile, unihit mode
+ *            gx     - DP matrix with room for an MxL alignment
+ *            opt_sc - optRETURN: Forward lod score in nats
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_Forward_Frameshift_Tiled(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc)
+{
+  if (L < p7_WAVEFRONT_MINROWS || gm_fs->M < 2 || gm_fs->xsc[p7P_E][p7P_LOOP] != -eslINFINITY)
+    return p7_Forward_Frameshift(dsq, gcode, L, gm_fs, gx, opt_sc);
+
+  return forward_tiled(dsq, gcode, L, gm_fs, gx, p7_FS_TILE_ROWS,
+                       fs_tile_width(gm_fs->M, FWD_CELLBYTES, p7_FS_TILE_ROWS + FWD_NROWS), opt_sc);
+}
+
+
+/* Function:  p7_Backward_Frameshift_Tiled() - BATH
+ * Synopsis:  Cache-blocked serial Backward algorithm.
+ *
+ * Purpose:   Same as <p7_Backward_Frameshift()>, but the core of the
+ *            DP matrix is filled in tiles, from the bottom right, of
+ *            <p7_FS_TILE_ROWS> rows by as many nodes as keep the rows
+ *            a tile reads within half of L2. Core cells are identical
+ *            to the serial ones; the B state is summed over nodes in
+ *            tile order, so B, N, J and the score may differ from the
+ *            serial ones by logsum roundoff.
+ *
+ *            <gm_fs> must be in a unihit configuration; if it isn't,
+ *            or the window is very short, this falls back to
+ *            <p7_Backward_Frameshift()>.
+ *
+ * Args:      dsq    - sequence in digitized form, 1..L
+ *            gcode  - genetic code
+ *            L      - length of dsq
+ *            gm_fs  - frameshift aware profile, unihit mode
+ *            gx     - DP matrix with room for an MxL alignment
+ *            opt_sc - optRETURN: Backward lod score in nats
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_Backward_Frameshift_Tiled(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *opt_sc)
+{
+  if (L < p7_WAVEFRONT_MINROWS || gm_fs->M < 2 || gm_fs->xsc[p7P_E][p7P_LOOP] != -eslINFINITY)
+    return p7_Backward_Frameshift(dsq, gcode, L, gm_fs, gx, opt_sc);
+
+  return backward_tiled(dsq, gcode, L, gm_fs, gx, p7_FS_TILE_ROWS,
+                        fs_tile_width(gm_fs->M, BCK_CELLBYTES, p7_FS_TILE_ROWS + BCK_NROWS), opt_sc);
+}
+
+
+/* fs_cache_bytes()
+ *
+ * Size of the L2 data cache, from sysconf() where the C library
+ * reports it, else the <p7_FS_TILE_CACHEBYTES> guess. Looked up on
+ * the first call only; this is asked once per envelope. Threads that
+ * race on the first call all store the same value.
+ */
+static long
+fs_cache_bytes(void)
+{
+  static long cachebytes = 0;
+  long        n          = -1;
+
+  if (cachebytes > 0) return cachebytes;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+  n = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+  cachebytes = (n > 0) ? n : p7_FS_TILE_CACHEBYTES;
+  return cachebytes;
+}
+
+/* fs_tile_width()
+ *
+ * Tile width, in nodes, such that <nrows> rows of <cellbytes> per node
+ * fill half of L2, leaving the other half for the emission scores.
+ */
+static int
+fs_tile_width(int M, int cellbytes, int nrows)
+{
+  long TK = fs_cache_bytes() / 2 / ((long) cellbytes * (long) nrows);
+  return (int) ESL_MIN((long) M, ESL_MAX(16L, TK));
+}
+
+
+/* wavefront_setup()
+ *
+ * Shared set-up of the tiled and wavefront Forward: allocate <wf>
+ * for <TR> x <TK> tiles, compute the codon indices, row 0, and the N,
+ * J and B states of every row. The core model is left for the tiles.
+ */
+static int
+wavefront_setup(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, int TR, int TK, P7_WAVEFRONT *wf)
+{
+  float       **dp        = gx->dp;
+  float        *xmx       = gx->xmx;
+  int           M         = gm_fs->M;
+  int           i, k, b, t, d, n;
+  int           t_, u, v, w, x;
+  int          *cx;
+  int           status;
+
+  wf->gm_fs = gm_fs;
+  wf->gx    = gx;
+  wf->L     = L;
+  wf->M     = M;
+  wf->esc   = p7_fs_profile_IsLocal(gm_fs) ? 0 : -eslINFINITY;
+  wf->cidx  = NULL;
+  wf->iv    = NULL;
+  wf->order = NULL;
+  wf->done  = NULL;
+  wf->TR    = ESL_MAX(TR, p7_WAVEFRONT_MINROWS);
+  wf->TK    = ESL_MAX(TK, 1);
+  wf->nbi   = (L + wf->TR - 1) / wf->TR;
+  wf->nbk   = (M + wf->TK - 1) / wf->TK;
+  wf->next  = 0;
+
+  ESL_ALLOC(wf->cidx,  sizeof(int)   * p7P_CODONS * (L+1));
+  ESL_ALLOC(wf->iv,    sizeof(float) * p7P_CODONS * (M+1));
+  ESL_ALLOC(wf->order, sizeof(int)   * wf->nbi * wf->nbk);
+  ESL_ALLOC(wf->done,  sizeof(int)   * wf->nbi * wf->nbk);
+
+  for (k = 0; k < p7P_CODONS * (M+1); k++) wf->iv[k] = -eslINFINITY;
+
+  /* Tiles in wavefront order: diagonal d = b + t */
+  n = 0;
+  for (d = 0; d < wf->nbi + wf->nbk - 1; d++)
+    for (b = ESL_MAX(0, d - wf->nbk + 1); b <= ESL_MIN(d, wf->nbi - 1); b++)
+      {
+        t = d - b;
+        wf->order[n]  = b * wf->nbk + t;
+        wf->done[n++] = FALSE;
+      }
+
+  /* Codon and quasicodon emission indices, rolled exactly as in
+   * p7_Forward_Frameshift() so that the warm-up rows match
+   */
+  t_ = u = v = w = x = -1;
+  for (i = 1; i <= L; i++)
+    {
+      if (i >= 5) t_ = u;
+      u = v;
+      v = w;
+      w = x;
+
+      /* if new nucleotide is not A,C,G, or T set it to placeholder vlaue */
+      if(esl_abc_XIsCanonical(gcode->nt_abc, dsq[i])) x = dsq[i];
+      else                                            x = p7P_MAXCODONS;
+
+      cx = wf->cidx + i * p7P_CODONS;
+      cx[p7P_C1] = p7P_MINIDX(p7P_CODON1(x),               p7P_DEGEN_QC2);
+      cx[p7P_C2] = p7P_MINIDX(p7P_CODON2(w, x),            p7P_DEGEN_QC1);
+      cx[p7P_C3] = p7P_MINIDX(p7P_CODON3(v, w, x),         p7P_DEGEN_C);
+      cx[p7P_C4] = p7P_MINIDX(p7P_CODON4(u, v, w, x),      p7P_DEGEN_QC1);
+      cx[p7P_C5] = (i >= 5) ? p7P_MINIDX(p7P_CODON5(t_, u, v, w, x), p7P_DEGEN_QC2) : 0;
+    }
+
+  /* Row 0 */
+  XMX_FS(0,p7G_N) = 0.;
+  XMX_FS(0,p7G_B) = gm_fs->xsc[p7P_N][p7P_MOVE];
+  XMX_FS(0,p7G_E) = XMX_FS(0,p7G_J) = XMX_FS(0,p7G_C) = -eslINFINITY;
+  for (k = 0; k <= M; k++)
+    MMX_FS(0,k,p7G_C0) = MMX_FS(0,k,p7G_C1) = MMX_FS(0,k,p7G_C2) = MMX_FS(0,k,p7G_C3) =
+    MMX_FS(0,k,p7G_C4) = MMX_FS(0,k,p7G_C5) = IMX_FS(0,k)        = DMX_FS(0,k)        = -eslINFINITY;
+
+  /* N, J and B states. In unihit mode E->J is -inf, so J never
+   * becomes reachable and B does not depend on the core model.
+   */
+  for (i = 1; i <= L; i++)
+    {
+      if (i > 2) {
+        XMX_FS(i,p7G_J) = p7_FLogsum(XMX_FS(i-3,p7G_J) + gm_fs->xsc[p7P_J][p7P_LOOP], -eslINFINITY);
+        XMX_FS(i,p7G_N) =            XMX_FS(i-3,p7G_N) + gm_fs->xsc[p7P_N][p7P_LOOP];
+      } else {
+        XMX_FS(i,p7G_J) = -eslINFINITY;
+        XMX_FS(i,p7G_N) = 0.;
+      }
+      XMX_FS(i,p7G_B) = p7_FLogsum(XMX_FS(i,p7G_N) + gm_fs->xsc[p7P_N][p7P_MOVE],
+                                   XMX_FS(i,p7G_J) + gm_fs->xsc[p7P_J][p7P_MOVE]);
+      XMX_FS(i,p7G_E) = -eslINFINITY;
+    }
+  return eslOK;
+
+ ERROR:
+  wavefront_free(wf);
+  return status;
+}
+
+/* wavefront_finish()
+ *
+ * Once every tile is filled and E is complete: the C state, the
+ * score, and the matrix dimensions.
+ */
+static void
+wavefront_finish(P7_WAVEFRONT *wf, float *opt_sc)
+{
+  const P7_FS_PROFILE *gm_fs = wf->gm_fs;
+  float               *xmx   = wf->gx->xmx;
+  int                  L     = wf->L;
+  int                  i;
+
+  for (i = 1; i <= L; i++)
+    {
+      if (i > 2) XMX_FS(i,p7G_C) = p7_FLogsum(XMX_FS(i-3,p7G_C) + gm_fs->xsc[p7P_C][p7P_LOOP],
+                                              XMX_FS(i,p7G_E)   + gm_fs->xsc[p7P_E][p7P_MOVE]);
+      else       XMX_FS(i,p7G_C) =            XMX_FS(i,p7G_E)   + gm_fs->xsc[p7P_E][p7P_MOVE];
+    }
+
+  if (opt_sc != NULL) *opt_sc = p7_FLogsum( XMX_FS(L,p7G_C),
+                                p7_FLogsum( XMX_FS(L-1,p7G_C) + gm_fs->xsc[p7P_C][p7P_LOOP],
+                                            XMX_FS(L-2,p7G_C) + gm_fs->xsc[p7P_C][p7P_LOOP])) +
+                                            gm_fs->xsc[p7P_C][p7P_MOVE];
+  wf->gx->M = wf->M;
+  wf->gx->L = L;
+}
+
+static void
+wavefront_free(P7_WAVEFRONT *wf)
+{
+  if (wf->cidx  != NULL) free(wf->cidx);
+  if (wf->iv    != NULL) free(wf->iv);
+  if (wf->order != NULL) free(wf->order);
+  if (wf->done  != NULL) free(wf->done);
+  wf->cidx  = NULL;
+  wf->iv    = NULL;
+  wf->order = NULL;
+  wf->done  = NULL;
+}
+
+
+/* forward_tiled()
+ *
+ * The body of p7_Forward_Frameshift_Tiled(), with the tile size given
+ * explicitly. Row-major tile order satisfies the same dependencies as
+ * the wavefront: tile (b,t) comes after (b-1,t) and (b,t-1).
+ */
+static int
+forward_tiled(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, int TR, int TK, float *opt_sc)
+{
+  P7_WAVEFRONT wf;
+  int          b, t;
+  int          status;
+
+  if ((status = wavefront_setup(dsq, gcode, L, gm_fs, gx, TR, TK, &wf)) != eslOK) return status;
+
+  for (b = 0; b < wf.nbi; b++)
+    for (t = 0; t < wf.nbk; t++)
+      wavefront_tile(&wf, b, t);
+
+  wavefront_finish(&wf, opt_sc);
+  wavefront_free(&wf);
+  return eslOK;
+}
+
+
+#ifdef HMMER_THREADS
+/* forward_wavefront()
+ *
+ * The body of p7_Forward_Frameshift_Wavefront(), with the tile size
+ * given explicitly (so the unit tests can force many small tiles).
+ *
+ * Row 0, the codon indices, and the N, J and B states of every row
+ * are set up serially first. The workers of <pool> then fill the core
+ * model tile by tile, accumulating E along each row as they go, while
+ * the caller waits. Finally C and the score are computed serially.
+ */
+static int
+forward_wavefront(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, P7_FS_WAVEPOOL *pool, int TR, int TK, float *opt_sc)
+{
+  P7_WAVEFRONT  wf;
+  int           status;
+
+  if ((status = wavefront_setup(dsq, gcode, L, gm_fs, gx, TR, TK, &wf)) != eslOK) return status;
+
+  /* Fill the core model along the wavefront */
+  if (pthread_mutex_init(&wf.mutex, NULL) != 0) ESL_XEXCEPTION(eslESYS, "mutex init failed");
+  if (pthread_cond_init(&wf.cond, NULL)   != 0) ESL_XEXCEPTION(eslESYS, "cond init failed");
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->wf    = &wf;
+  pool->nbusy = pool->nthreads;
+  pool->njobs++;
+  pthread_cond_broadcast(&pool->start);
+  while (pool->nbusy > 0) pthread_cond_wait(&pool->finish, &pool->mutex);
+  pool->wf    = NULL;
+  pthread_mutex_unlock(&pool->mutex);
+
+  pthread_cond_destroy(&wf.cond);
+  pthread_mutex_destroy(&wf.mutex);
+
+  wavefront_finish(&wf, opt_sc);
+  wavefront_free(&wf);
+  return eslOK;
+
+ ERROR:
+  wavefront_free(&wf);
+  return status;
+}
+
+/* wavepool_thread()
+ *
+ * Pool worker: sleep until a new matrix is posted, help fill it,
+ * report back, and go back to sleep. The poster waits for every
+ * worker to finish a matrix before posting the next, so no worker
+ * can miss one.
+ */
+static void *
+wavepool_thread(void *arg)
+{
+  P7_FS_WAVEPOOL *pool = (P7_FS_WAVEPOOL *) arg;
+  P7_WAVEFRONT   *wf;
+  uint64_t        seen = 0;
+
+  pthread_mutex_lock(&pool->mutex);
+  while (1)
+    {
+      while (! pool->shutdown && pool->njobs == seen)
+        pthread_cond_wait(&pool->start, &pool->mutex);
+      if (pool->shutdown) break;
+      seen = pool->njobs;
+      wf   = pool->wf;
+      pthread_mutex_unlock(&pool->mutex);
+
+      wavefront_work(wf);
+
+      pthread_mutex_lock(&pool->mutex);
+      if (--pool->nbusy == 0) pthread_cond_signal(&pool->finish);
+    }
+  pthread_mutex_unlock(&pool->mutex);
+  return NULL;
+}
+
+/* wavefront_work()
+ *
+ * Repeatedly take the next tile in wavefront order, wait until the
+ * tiles above and to the left of it are done, fill it, and mark it
+ * done. Because tiles are handed out in topological order, every tile
+ * a worker waits on has already been handed to another (running)
+ * worker, so this can't deadlock.
+ */
+static void
+wavefront_work(P7_WAVEFRONT *wf)
+{
+  int tile, b, t;
+
+  while (1)
+    {
+      pthread_mutex_lock(&wf->mutex);
+      if (wf->next == wf->nbi * wf->nbk) { pthread_mutex_unlock(&wf->mutex); break; }
+      tile = wf->order[wf->next++];
+      b    = tile / wf->nbk;
+      t    = tile % wf->nbk;
+      while ((b > 0 && ! wf->done[tile - wf->nbk]) || (t > 0 && ! wf->done[tile - 1]))
+        pthread_cond_wait(&wf->cond, &wf->mutex);
+      pthread_mutex_unlock(&wf->mutex);
+
+      wavefront_tile(wf, b, t);
+
+      pthread_mutex_lock(&wf->mutex);
+      wf->done[tile] = TRUE;
+      pthread_cond_broadcast(&wf->cond);
+      pthread_mutex_unlock(&wf->mutex);
+    }
+}
+
+#endif /*HMMER_THREADS*/
+
+/* wavefront_tile()
+ *
+ * Fill rows <b*TR+1..> and nodes <t*TK+1..> of the core model. This is
+ * the inner loop of p7_Forward_Frameshift(), including its warm-up
+ * rows i<5, with the intermediate C1 values kept in a ring of the
+ * last five rows per node instead of the serial diagonal buffer.
+ * The ring of node k is only touched by tiles in column t, which
+ * never run concurrently.
+ */
+static void
+wavefront_tile(P7_WAVEFRONT *wf, int b, int t)
+{
+  const P7_FS_PROFILE *gm_fs = wf->gm_fs;
+  float const         *tsc   = gm_fs->tsc;
+  float              **dp    = wf->gx->dp;
+  float               *xmx   = wf->gx->xmx;
+  float                esc   = wf->esc;
+  int                  M     = wf->M;
+  int                  i0    = b * wf->TR + 1;
+  int                  i1    = ESL_MIN(wf->L, (b+1) * wf->TR);
+  int                  k0    = t * wf->TK + 1;
+  int                  k1    = ESL_MIN(M, (t+1) * wf->TK);
+  float               *ivk;
+  int                 *cx;
+  float                E;
+  int                  i, k;
+
+  for (i = i0; i <= i1; i++)
+    {
+      cx = wf->cidx + i * p7P_CODONS;
+
+      if (k0 == 1) {
+        MMX_FS(i,0,p7G_C0) = MMX_FS(i,0,p7G_C1) = MMX_FS(i,0,p7G_C2) = MMX_FS(i,0,p7G_C3) =
+        MMX_FS(i,0,p7G_C4) = MMX_FS(i,0,p7G_C5) = IMX_FS(i,0)        = DMX_FS(i,0)        = -eslINFINITY;
+      }
+      E = XMX_FS(i,p7G_E);
+
+      for (k = k0; k <= k1; k++)
+        {
+          ivk = wf->iv + k * p7P_CODONS;
+
+          ivk[i % p7P_CODONS] = p7_FLogsum(MMX_FS(i-1,k-1,p7G_C0)   + TSC(p7P_MM,k-1),
+                                p7_FLogsum(IMX_FS(i-1,k-1)          + TSC(p7P_IM,k-1),
+                                p7_FLogsum(DMX_FS(i-1,k-1)          + TSC(p7P_DM,k-1),
+                                           XMX_FS(i-1,p7G_B)        + TSC(p7P_BM,k-1))));
+
+          MMX_FS(i,k,p7G_C1) = ivk[i % p7P_CODONS] + p7P_MSC_CODON(gm_fs, k, cx[p7P_C1]);
+
+          if (i >= 5)
+            {
+              MMX_FS(i,k,p7G_C2) = ivk[(i-1) % p7P_CODONS] + p7P_MSC_CODON(gm_fs, k, cx[p7P_C2]);
+              MMX_FS(i,k,p7G_C3) = ivk[(i-2) % p7P_CODONS] + p7P_MSC_CODON(gm_fs, k, cx[p7P_C3]);
+              MMX_FS(i,k,p7G_C4) = ivk[(i-3) % p7P_CODONS] + p7P_MSC_CODON(gm_fs, k, cx[p7P_C4]);
+              MMX_FS(i,k,p7G_C5) = ivk[(i-4) % p7P_CODONS] + p7P_MSC_CODON(gm_fs, k, cx[p7P_C5]);
+
+              MMX_FS(i,k,p7G_C0) =  p7_FLogsum(p7_FLogsum(MMX_FS(i,k,p7G_C1),
+                                    p7_FLogsum(MMX_FS(i,k,p7G_C2), MMX_FS(i,k,p7G_C3))),
+                                    p7_FLogsum(MMX_FS(i,k,p7G_C4), MMX_FS(i,k,p7G_C5)));
+            }
+          else
+            {
+              MMX_FS(i,k,p7G_C2) = (i > 1) ? ivk[(i-1) % p7P_CODONS] + p7P_MSC_CODON(gm_fs, k, cx[p7P_C2]) : -eslINFINITY;
+              MMX_FS(i,k,p7G_C3) = (i > 2) ? ivk[(i-2) % p7P_CODONS] + p7P_MSC_CODON(gm_fs, k, cx[p7P_C3]) : -eslINFINITY;
+              MMX_FS(i,k,p7G_C4) = (i > 3) ? ivk[(i-3) % p7P_CODONS] + p7P_MSC_CODON(gm_fs, k, cx[p7P_C4]) : -eslINFINITY;
+              MMX_FS(i,k,p7G_C5) = -eslINFINITY;
+
+              MMX_FS(i,k,p7G_C0) =  p7_FLogsum(p7_FLogsum(MMX_FS(i,k,p7G_C1), MMX_FS(i,k,p7G_C2)),
+                                               p7_FLogsum(MMX_FS(i,k,p7G_C3), MMX_FS(i,k,p7G_C4)));
+            }
+
+          /* insert state */
+          if (k < M && i > 2)
+            IMX_FS(i,k) = p7_FLogsum(MMX_FS(i-3,k,p7G_C0) + TSC(p7P_MI,k),
+                                     IMX_FS(i-3,k)        + TSC(p7P_II,k));
+          else
+            IMX_FS(i,k) = -eslINFINITY;
+
+          /* delete state */
+          DMX_FS(i,k) = p7_FLogsum(MMX_FS(i,k-1,p7G_C0) + TSC(p7P_MD,k-1),
+                                   DMX_FS(i,k-1)        + TSC(p7P_DD,k-1));
+
+          /* E state update */
+          if (k < M)      E = p7_FLogsum(MMX_FS(i,k,p7G_C0) + esc,
+                              p7_FLogsum(DMX_FS(i,k)        + esc, E));
+          else if (i < 5) E = p7_FLogsum(MMX_FS(i,M,p7G_C0),
+                              p7_FLogsum(DMX_FS(i,M), E));
+          else            E = p7_FLogsum(p7_FLogsum(MMX_FS(i,M,p7G_C0), DMX_FS(i,M)), E);
+        }
+
+      XMX_FS(i,p7G_E) = E;
+    }
+}
+
+
+/* backward_tiled()
+ *
+ * The body of p7_Backward_Frameshift_Tiled(), with the tile size
+ * given explicitly. Row L, the codon indices, and the C and E states
+ * of every row are set up first; in unihit mode E no longer depends
+ * on J, so none of them depend on the core. The tiles of core rows
+ * L-1..1 are then filled from the bottom right, each adding its
+ * nodes' share to B. J and N, and row 0, come last.
+ */
+static int
+backward_tiled(const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, int TR, int TK, float *opt_sc)
+{
+  P7_WAVEFRONT wf;
+  float const *tsc  = gm_fs->tsc;
+  float      **dp   = gx->dp;
+  float       *xmx  = gx->xmx;
+  int          M    = gm_fs->M;
+  float        esc  = p7_fs_profile_IsLocal(gm_fs) ? 0 : -eslINFINITY;
+  float       *iv;
+  int         *cx;
+  int          nt[6];   /* nt[j]: code of dsq[i+j], p7P_MAXCODONS if degenerate, -1 past L */
+  int          i, j, k, b, t;
+  int          status;
+
+  wf.gm_fs = gm_fs;
+  wf.gx    = gx;
+  wf.L     = L;
+  wf.M     = M;
+  wf.esc   = esc;
+  wf.cidx  = NULL;
+  wf.iv    = NULL;
+  wf.order = NULL;
+  wf.done  = NULL;
+  wf.TR    = ESL_MAX(TR, p7_WAVEFRONT_MINROWS);
+  wf.TK    = ESL_MAX(TK, 1);
+  wf.nbi   = (L - 1 + wf.TR - 1) / wf.TR;   /* core rows 1..L-1 */
+  wf.nbk   = (M + wf.TK - 1) / wf.TK;
+  wf.next  = 0;
+
+  ESL_ALLOC(wf.cidx, sizeof(int)   * p7P_CODONS * L);
+  ESL_ALLOC(wf.iv,   sizeof(float) * (M+2));
+  iv = wf.iv;
+
+  /* Codon and quasicodon emission indices of rows 0..L-1, as
+   * p7_Backward_Frameshift() rolls them: row i reads the codons that
+   * start at i+1. Codons running past L are never used; index 0.
+   */
+  for (i = 0; i < L; i++)
+    {
+      for (j = 1; j <= 5; j++)
+        {
+          if      (i+j > L)                                       nt[j] = -1;
+          else if (esl_abc_XIsCanonical(gcode->nt_abc, dsq[i+j])) nt[j] = dsq[i+j];
+          else                                                    nt[j] = p7P_MAXCODONS;
+        }
+      cx = wf.cidx + i * p7P_CODONS;
+      cx[p7P_C1] =              p7P_MINIDX(p7P_CODON1(nt[1]),                             p7P_DEGEN_QC2);
+      cx[p7P_C2] = (i+2 <= L) ? p7P_MINIDX(p7P_CODON2(nt[1], nt[2]),                      p7P_DEGEN_QC1) : 0;
+      cx[p7P_C3] = (i+3 <= L) ? p7P_MINIDX(p7P_CODON3(nt[1], nt[2], nt[3]),               p7P_DEGEN_C)   : 0;
+      cx[p7P_C4] = (i+4 <= L) ? p7P_MINIDX(p7P_CODON4(nt[1], nt[2], nt[3], nt[4]),        p7P_DEGEN_QC1) : 0;
+      cx[p7P_C5] = (i+5 <= L) ? p7P_MINIDX(p7P_CODON5(nt[1], nt[2], nt[3], nt[4], nt[5]), p7P_DEGEN_QC2) : 0;
+    }
+
+  /* Row L, as in the serial version */
+  XMX(L,p7G_J) = XMX(L,p7G_B) = XMX(L,p7G_N) = -eslINFINITY;
+  XMX(L,p7G_C) = gm_fs->xsc[p7P_C][p7P_MOVE];
+  XMX(L,p7G_E) = XMX(L,p7G_C) + gm_fs->xsc[p7P_E][p7P_MOVE];
+  MMX(L,M)     = DMX(L,M) = XMX(L,p7G_E);
+  IMX(L,M)     = -eslINFINITY;
+  for (k = M-1; k >= 1; k--)
+    {
+      MMX(L,k) = p7_FLogsum( XMX(L,p7G_E) + esc,
+                             DMX(L, k+1)  + TSC(p7P_MD,k));
+      DMX(L,k) = p7_FLogsum( XMX(L,p7G_E) + esc,
+                             DMX(L, k+1)  + TSC(p7P_DD,k));
+      IMX(L,k) = -eslINFINITY;
+    }
+  MMX(L,0) = IMX(L,0) = DMX(L,0) = -eslINFINITY;
+
+  /* C and E states. J + E->J is -inf in unihit mode. */
+  for (i = L-1; i >= 1; i--)
+    {
+      if (i < L-2) XMX(i,p7G_C) = XMX(i+3,p7G_C) + gm_fs->xsc[p7P_C][p7P_LOOP];
+      else         XMX(i,p7G_C) =                  gm_fs->xsc[p7P_C][p7P_MOVE];
+      XMX(i,p7G_E) = p7_FLogsum(-eslINFINITY, XMX(i,p7G_C) + gm_fs->xsc[p7P_E][p7P_MOVE]);
+      XMX(i,p7G_B) = -eslINFINITY;
+    }
+
+  /* Fill the core model, bottom right to top left */
+  for (b = wf.nbi-1; b >= 0; b--)
+    for (t = wf.nbk-1; t >= 0; t--)
+      backward_tile(&wf, b, t);
+
+  /* J and N, now that B is complete */
+  for (i = L-1; i >= 1; i--)
+    {
+      if (i < L-2) {
+        XMX(i,p7G_J) = p7_FLogsum( XMX(i+3,p7G_J) + gm_fs->xsc[p7P_J][p7P_LOOP],
+                                   XMX(i,  p7G_B) + gm_fs->xsc[p7P_J][p7P_MOVE]);
+        XMX(i,p7G_N) = p7_FLogsum( XMX(i+3,p7G_N) + gm_fs->xsc[p7P_N][p7P_LOOP],
+                                   XMX(i,  p7G_B) + gm_fs->xsc[p7P_N][p7P_MOVE]);
+      } else {
+        XMX(i,p7G_J) =             XMX(i,  p7G_B) + gm_fs->xsc[p7P_J][p7P_MOVE];
+        XMX(i,p7G_N) =             XMX(i,  p7G_B) + gm_fs->xsc[p7P_N][p7P_MOVE];
+      }
+    }
+
+  /* At i=0, only N,B states are reachable. */
+  cx = wf.cidx;
+  for (k = 1; k <= M; k++)
+    {
+      iv[k] = p7_FLogsum( MMX(1,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C1]),
+              p7_FLogsum( MMX(2,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C2]),
+              p7_FLogsum( MMX(3,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C3]),
+              p7_FLogsum( MMX(4,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C4]),
+                          MMX(5,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C5])))));
+      if (k == 1) XMX(0,p7G_B) = iv[1] + TSC(p7P_BM,0);
+      else        XMX(0,p7G_B) = p7_FLogsum(XMX(0, p7G_B), iv[k] + TSC(p7P_BM,k-1));
+    }
+  XMX(0,p7G_J) = XMX(0,p7G_C) = XMX(0,p7G_E) = -eslINFINITY;
+  XMX(0,p7G_N) = p7_FLogsum( XMX(3,p7G_N)   + gm_fs->xsc[p7P_N][p7P_LOOP],
+                             XMX(0,  p7G_B) + gm_fs->xsc[p7P_N][p7P_MOVE]);
+  for (k = M; k >= 0; k--)
+    MMX(0,k) = DMX(0,k) = IMX(0,k) = -eslINFINITY;
+
+  if (opt_sc != NULL) *opt_sc = p7_FLogsum( XMX(0,p7G_N),
+                                p7_FLogsum( XMX(1,p7G_N),
+                                            XMX(2,p7G_N)));
+  gx->M = M;
+  gx->L = L;
+  wavefront_free(&wf);
+  return eslOK;
+
+ ERROR:
+  wavefront_free(&wf);
+  return status;
+}
+
+/* backward_tile()
+ *
+ * Fill rows <i1..i0> (bottom up) and nodes <k1..k0> (right to left)
+ * of tile (b,t) of the Backward core: the inner loops of
+ * p7_Backward_Frameshift(), including its warm-up rows L-4..L-1.
+ * M(i,k1) needs iv[k1+1] of the same row, which the tile to the right
+ * computed and has since overwritten; it is recomputed here, with the
+ * same operations, from the finished rows below.
+ */
+static void
+backward_tile(P7_WAVEFRONT *wf, int b, int t)
+{
+  const P7_FS_PROFILE *gm_fs = wf->gm_fs;
+  float const         *tsc   = gm_fs->tsc;
+  float              **dp    = wf->gx->dp;
+  float               *xmx   = wf->gx->xmx;
+  float               *iv    = wf->iv;
+  float                esc   = wf->esc;
+  int                  L     = wf->L;
+  int                  M     = wf->M;
+  int                  i0    = b * wf->TR + 1;
+  int                  i1    = ESL_MIN(L-1, (b+1) * wf->TR);
+  int                  k0    = t * wf->TK + 1;
+  int                  k1    = ESL_MIN(M, (t+1) * wf->TK);
+  int                  kx    = ESL_MIN(M, k1+1);
+  int                 *cx;
+  float                B;
+  int                  i, k;
+
+  for (i = i1; i >= i0; i--)
+    {
+      cx = wf->cidx + i * p7P_CODONS;
+
+      for (k = k0; k <= kx; k++)
+        {
+          if (i <= L-5)
+            iv[k] = p7_FLogsum( MMX(i+1,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C1]),
+                    p7_FLogsum( MMX(i+2,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C2]),
+                    p7_FLogsum( MMX(i+3,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C3]),
+                    p7_FLogsum( MMX(i+4,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C4]),
+                                MMX(i+5,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C5])))));
+          else
+            {
+              iv[k] =                          MMX(i+1,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C1]);
+              if (i < L-1) iv[k] = p7_FLogsum( iv[k], MMX(i+2,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C2]));
+              if (i < L-2) iv[k] = p7_FLogsum( iv[k], MMX(i+3,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C3]));
+              if (i < L-3) iv[k] = p7_FLogsum( iv[k], MMX(i+4,k) + p7P_MSC_CODON(gm_fs, k, cx[p7P_C4]));
+            }
+        }
+
+      /* this tile's share of B */
+      B = iv[k0] + TSC(p7P_BM,k0-1);
+      for (k = k0+1; k <= k1; k++) B = p7_FLogsum(B, iv[k] + TSC(p7P_BM,k-1));
+      XMX(i,p7G_B) = p7_FLogsum(XMX(i,p7G_B), B);
+
+      if (k1 == M)
+        {
+          MMX(i,M) = DMX(i,M) = XMX(i,p7G_E); /* {MD}_M <- E (prob 1.0) */
+          IMX(i,M) = -eslINFINITY;            /* no I_M state        */
+        }
+
+      for (k = ESL_MIN(k1, M-1); k >= k0; k--)
+        {
+          if (i <= L-5)
+            {
+              MMX(i,k) = p7_FLogsum( p7_FLogsum( DMX(i,k+1)   + TSC(p7P_MD,k),
+                                     p7_FLogsum( IMX(i+3,k)   + TSC(p7P_MI,k),
+                                                 iv[k+1]      + TSC(p7P_MM,k))),
+                                                 XMX(i,p7G_E) + esc);
+
+              DMX(i,k) = p7_FLogsum( p7_FLogsum( XMX(i,p7G_E) + esc,
+                                                 DMX(i, k+1)  + TSC(p7P_DD,k)),
+                                                 iv[k+1]      + TSC(p7P_DM,k));
+
+              IMX(i,k) = p7_FLogsum(             IMX(i+3,k  ) + TSC(p7P_II,k),
+                                                 iv[k+1]      + TSC(p7P_IM,k));
+            }
+          else
+            {
+              MMX(i,k) = p7_FLogsum( DMX(i,k+1)   + TSC(p7P_MD,k),
+                         p7_FLogsum( iv[k+1]      + TSC(p7P_MM,k),
+                                     XMX(i,p7G_E) + esc));
+              if (i < L-2)
+                MMX(i,k) = p7_FLogsum( MMX(i,k) , IMX(i+3,k)  + TSC(p7P_MI,k));
+
+              DMX(i,k) = p7_FLogsum( p7_FLogsum( XMX(i,p7G_E) + esc,
+                                                 DMX(i, k+1)  + TSC(p7P_DD,k)),
+                                                 iv[k+1]      + TSC(p7P_DM,k));
+
+              if (i < L-2)
+                IMX(i,k) = p7_FLogsum(           IMX(i+3,k  ) + TSC(p7P_II,k),
+                                                 iv[k+1]      + TSC(p7P_IM,k));
+              else
+                IMX(i,k) = iv[k+1]            + TSC(p7P_IM,k);
+            }
+        }
+
+      if (k0 == 1) MMX(i,0) = IMX(i,0) = DMX(i,0) = -eslINFINITY;
+    }
+}
+/*------------- end, tiled and wavefront Forward/Backward -------*/
+
+
+
+/*****************************************************************
+ * 2. Benchmark driver.
+ *****************************************************************/
+#ifdef p7FWDBACK_FRAMESHIFT_WAVEFRONT_BENCHMARK
+/*
+   gcc -g -O2 -pthread -o fwdback_frameshift_wavefront_benchmark -I. -L. -I../easel -L../easel -Dp7FWDBACK_FRAMESHIFT_WAVEFRONT_BENCHMARK fwdback_frameshift_wavefront.c -lhmmer -leasel -lm
+   ./fwdback_frameshift_wavefront_benchmark
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_gencode.h"
+#include "esl_getopts.h"
+#include "esl_random.h"
+#include "esl_randomseq.h"
+#include "esl_stopwatch.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default   env  range toggles reqs incomp  help                                          docgroup*/
+  { "-h",        eslARG_NONE,   FALSE,  NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",              0 },
+  { "-s",        eslARG_INT,     "42",  NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                     0 },
+  { "-L",        eslARG_INT,   "6000",  NULL, "n>0", NULL,  NULL, NULL, "length of random target seqs (nucleotides)",        0 },
+  { "-N",        eslARG_INT,      "2",  NULL, "n>0", NULL,  NULL, NULL, "number of random target seqs per model size",       0 },
+  { "--minM",    eslARG_INT,    "100",  NULL, "n>1", NULL,  NULL, NULL, "smallest sampled model",                            0 },
+  { "--maxM",    eslARG_INT,   "3200",  NULL, "n>1", NULL,  NULL, NULL, "largest sampled model; sizes double from --minM",   0 },
+  { "--cpu",     eslARG_INT,      "4",  NULL, "n>0", NULL,  NULL, NULL, "number of wavefront threads",                       0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+static char usage[]  = "[-options]";
+static char banner[] = "benchmark driver for the tiled and wavefront frameshift Forward/Backward";
+
+/* Time <N> runs of one implementation; <which> is 0..4 for serial
+ * Forward, tiled Forward, serial Backward, tiled Backward, wavefront.
+ */
+static double
+time_one(ESL_STOPWATCH *w, ESL_RANDOMNESS *r, int which, ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, int N, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, P7_FS_WAVEPOOL *pool)
+{
+  double fq[4] = { 0.25, 0.25, 0.25, 0.25 };
+  float  sc;
+  int    i;
+
+  esl_stopwatch_Start(w);
+  for (i = 0; i < N; i++)
+    {
+      esl_rsq_xfIID(r, fq, 4, L, dsq);
+      switch (which) {
+      case 0: p7_Forward_Frameshift          (dsq, gcode, L, gm_fs, gx, &sc);       break;
+      case 1: p7_Forward_Frameshift_Tiled    (dsq, gcode, L, gm_fs, gx, &sc);       break;
+      case 2: p7_Backward_Frameshift         (dsq, gcode, L, gm_fs, gx, &sc);       break;
+      case 3: p7_Backward_Frameshift_Tiled   (dsq, gcode, L, gm_fs, gx, &sc);       break;
+      case 4: p7_Forward_Frameshift_Wavefront(dsq, gcode, L, gm_fs, gx, pool, &sc); break;
+      }
+    }
+  esl_stopwatch_Stop(w);
+  return w->elapsed;
+}
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go      = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_STOPWATCH  *w       = esl_stopwatch_Create();
+  ESL_RANDOMNESS *r       = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc     = esl_alphabet_Create(eslAMINO);
+  ESL_ALPHABET   *abcDNA  = esl_alphabet_Create(eslDNA);
+  ESL_GENCODE    *gcode   = esl_gencode_Create(abcDNA, abc);
+  P7_BG          *bg      = p7_bg_Create(abc);
+  P7_HMM         *hmm     = NULL;
+  P7_FS_PROFILE  *gm_fs   = NULL;
+  P7_GMX         *gx      = NULL;
+  int             L       = esl_opt_GetInteger(go, "-L");
+  int             N       = esl_opt_GetInteger(go, "-N");
+  int             ncpu    = esl_opt_GetInteger(go, "--cpu");
+  P7_FS_WAVEPOOL *pool    = p7_fs_wavepool_Create(ncpu);
+  int             maxM    = esl_opt_GetInteger(go, "--maxM");
+  ESL_DSQ        *dsq     = malloc(sizeof(ESL_DSQ) * (L+2));
+  double          t[5];
+  int             M;
+
+  p7_FLogsumInit();
+  esl_gencode_Set(gcode, 1);
+
+  printf("# L2 cache:   %ld bytes\n", fs_cache_bytes());
+  printf("# %6s %6s %6s %9s %9s %7s %9s %9s %7s %9s %7s\n",
+         "M", "TK(F)", "TK(B)", "fwd", "fwd-tile", "speedup", "bck", "bck-tile", "speedup", "fwd-wave", "speedup");
+
+  for (M = esl_opt_GetInteger(go, "--minM"); M <= maxM; M *= 2)
+    {
+      if (p7_hmm_Sample(r, M, abc, &hmm) != eslOK) p7_Fail("failed to sample an HMM");
+      hmm->fs = 0.01;
+      gm_fs = p7_profile_fs_Create(hmm->M, abc);
+      p7_ProfileConfig_fs(hmm, bg, gcode, gm_fs, L/3, p7_LOCAL);
+      p7_fs_ReconfigUnihit(gm_fs, L);
+      gx    = p7_gmx_fs_Create(gm_fs->M, L, L, p7P_CODONS);
+
+      t[0] = time_one(w, r, 0, dsq, gcode, L, N, gm_fs, gx, pool);
+      t[1] = time_one(w, r, 1, dsq, gcode, L, N, gm_fs, gx, pool);
+      t[2] = time_one(w, r, 2, dsq, gcode, L, N, gm_fs, gx, pool);
+      t[3] = time_one(w, r, 3, dsq, gcode, L, N, gm_fs, gx, pool);
+      t[4] = time_one(w, r, 4, dsq, gcode, L, N, gm_fs, gx, pool);
+
+      printf("%8d %6d %6d %9.3f %9.3f %7.2f %9.3f %9.3f %7.2f %9.3f %7.2f\n", M,
+             fs_tile_width(M, FWD_CELLBYTES, p7_FS_TILE_ROWS + FWD_NROWS),
+             fs_tile_width(M, BCK_CELLBYTES, p7_FS_TILE_ROWS + BCK_NROWS),
+             t[0], t[1], t[0] / t[1], t[2], t[3], t[2] / t[3], t[4], t[0] / t[4]);
+
+      p7_gmx_Destroy(gx);
+      p7_profile_fs_Destroy(gm_fs);
+      p7_hmm_Destroy(hmm);
+    }
+  printf("# times are wall clock seconds for %d seqs of %d nt; wavefront uses %d threads\n", N, L, ncpu);
+
+  free(dsq);
+  p7_fs_wavepool_Destroy(pool);
+  esl_gencode_Destroy(gcode);
+  p7_bg_Destroy(bg);
+  esl_alphabet_Destroy(abcDNA);
+  esl_alphabet_Destroy(abc);
+  esl_stopwatch_Destroy(w);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return 0;
+}
+#endif /*p7FWDBACK_FRAMESHIFT_WAVEFRONT_BENCHMARK*/
+/*----------------- end, benchmark ------------------------------*/
+
+
+
+/*****************************************************************
+ * 3. Unit tests.
+ *****************************************************************/
+#ifdef p7FWDBACK_FRAMESHIFT_WAVEFRONT_TESTDRIVE
+#include <math.h>
+
+#include "esl_getopts.h"
+#include "esl_random.h"
+#include "esl_randomseq.h"
+
+#ifdef HMMER_THREADS
+/* The wavefront matrix and score must be identical to the serial
+ * ones, for any tile shape; small tiles exercise the tile boundaries
+ * and the codon lookback across them. Random DNA gets a few N's to
+ * exercise the degenerate codon indices too.
+ */
+static void
+utest_wavefront(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, P7_BG *bg, int M, int L, int nseq)
+{
+  char           msg[]  = "wavefront frameshift Forward unit test failed";
+  ESL_ALPHABET  *abcDNA = esl_alphabet_Create(eslDNA);
+  ESL_GENCODE   *gcode  = esl_gencode_Create(abcDNA, abc);
+  P7_HMM        *hmm    = NULL;
+  P7_FS_PROFILE *gm_fs  = NULL;
+  P7_GMX        *gx1    = NULL;
+  P7_GMX        *gx2    = NULL;
+  P7_FS_WAVEPOOL *pool  = p7_fs_wavepool_Create(3);
+  ESL_DSQ       *dsq    = malloc(sizeof(ESL_DSQ) * (L+2));
+  double         fq[4]  = { 0.25, 0.25, 0.25, 0.25 };
+  int            tiles[3][2] = { { 8, 1 }, { 8, 7 }, { 13, 32 } };
+  int            idx, i, k, s;
+  float          sc1, sc2;
+
+  if (pool == NULL)                            esl_fatal(msg);
+  if (p7_hmm_Sample(r, M, abc, &hmm) != eslOK) esl_fatal(msg);
+  hmm->fs = 0.01;
+  esl_gencode_Set(gcode, 1);
+  if ((gm_fs = p7_profile_fs_Create(hmm->M, abc))                     == NULL)  esl_fatal(msg);
+  if (p7_ProfileConfig_fs(hmm, bg, gcode, gm_fs, L/3, p7_LOCAL)       != eslOK) esl_fatal(msg);
+  if (p7_fs_ReconfigUnihit(gm_fs, L)                                  != eslOK) esl_fatal(msg);
+  if ((gx1 = p7_gmx_fs_Create(gm_fs->M, L, L, p7P_CODONS))            == NULL)  esl_fatal(msg);
+  if ((gx2 = p7_gmx_fs_Create(gm_fs->M, L, L, p7P_CODONS))            == NULL)  esl_fatal(msg);
+
+  while (nseq--)
+    {
+      if (esl_rsq_xfIID(r, fq, 4, L, dsq) != eslOK) esl_fatal(msg);
+      for (i = 0; i < 3; i++) dsq[1 + esl_rnd_Roll(r, L)] = esl_abc_XGetUnknown(abcDNA);
+
+      if (p7_Forward_Frameshift(dsq, gcode, L, gm_fs, gx1, &sc1) != eslOK) esl_fatal(msg);
+
+      for (idx = 0; idx < 3; idx++)
+        {
+          if (forward_wavefront(dsq, gcode, L, gm_fs, gx2, pool, tiles[idx][0], tiles[idx][1], &sc2) != eslOK) esl_fatal(msg);
+          if (sc1 != sc2) esl_fatal("%s: score %f != %f", msg, sc1, sc2);
+
+          for (i = 0; i <= L; i++)
+            {
+              for (s = 0; s < p7G_NXCELLS; s++)
+                if (gx1->xmx[i*p7G_NXCELLS+s] != gx2->xmx[i*p7G_NXCELLS+s]) esl_fatal("%s: special state differs at row %d", msg, i);
+              for (k = 0; k <= M; k++)
+                for (s = 0; s < p7G_NSCELLS_FS; s++)
+                  if (gx1->dp[i][k*p7G_NSCELLS_FS+s] != gx2->dp[i][k*p7G_NSCELLS_FS+s]) esl_fatal("%s: cell differs at i=%d k=%d", msg, i, k);
+            }
+        }
+    }
+
+  free(dsq);
+  p7_fs_wavepool_Destroy(pool);
+  p7_gmx_Destroy(gx1);
+  p7_gmx_Destroy(gx2);
+  p7_profile_fs_Destroy(gm_fs);
+  p7_hmm_Destroy(hmm);
+  esl_gencode_Destroy(gcode);
+  esl_alphabet_Destroy(abcDNA);
+}
+#endif /*HMMER_THREADS*/
+
+/* The tiled Forward must match the serial one exactly, and the tiled
+ * Backward core cells too; its B state is summed over nodes in a
+ * different order, so B, J, N and the score only agree within logsum
+ * roundoff. E and C don't depend on B in unihit mode, and stay exact.
+ */
+static void
+utest_tiled(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, P7_BG *bg, int M, int L, int nseq)
+{
+  char           msg[]  = "tiled frameshift Forward/Backward unit test failed";
+  ESL_ALPHABET  *abcDNA = esl_alphabet_Create(eslDNA);
+  ESL_GENCODE   *gcode  = esl_gencode_Create(abcDNA, abc);
+  P7_HMM        *hmm    = NULL;
+  P7_FS_PROFILE *gm_fs  = NULL;
+  P7_GMX        *gx1    = NULL;
+  P7_GMX        *gx2    = NULL;
+  ESL_DSQ       *dsq    = malloc(sizeof(ESL_DSQ) * (L+2));
+  double         fq[4]  = { 0.25, 0.25, 0.25, 0.25 };
+  int            tiles[3][2] = { { 8, 1 }, { 8, 7 }, { 13, 32 } };
+  float          tol    = 0.01;
+  int            idx, i, k, s;
+  float          sc1, sc2;
+
+  if (p7_hmm_Sample(r, M, abc, &hmm) != eslOK) esl_fatal(msg);
+  hmm->fs = 0.01;
+  esl_gencode_Set(gcode, 1);
+  if ((gm_fs = p7_profile_fs_Create(hmm->M, abc))                     == NULL)  esl_fatal(msg);
+  if (p7_ProfileConfig_fs(hmm, bg, gcode, gm_fs, L/3, p7_LOCAL)       != eslOK) esl_fatal(msg);
+  if (p7_fs_ReconfigUnihit(gm_fs, L)                                  != eslOK) esl_fatal(msg);
+  if ((gx1 = p7_gmx_fs_Create(gm_fs->M, L, L, p7P_CODONS))            == NULL)  esl_fatal(msg);
+  if ((gx2 = p7_gmx_fs_Create(gm_fs->M, L, L, p7P_CODONS))            == NULL)  esl_fatal(msg);
+
+  while (nseq--)
+    {
+      if (esl_rsq_xfIID(r, fq, 4, L, dsq) != eslOK) esl_fatal(msg);
+      for (i = 0; i < 3; i++) dsq[1 + esl_rnd_Roll(r, L)] = esl_abc_XGetUnknown(abcDNA);
+
+      /* Forward */
+      if (p7_Forward_Frameshift(dsq, gcode, L, gm_fs, gx1, &sc1) != eslOK) esl_fatal(msg);
+      for (idx = 0; idx < 3; idx++)
+        {
+          if (forward_tiled(dsq, gcode, L, gm_fs, gx2, tiles[idx][0], tiles[idx][1], &sc2) != eslOK) esl_fatal(msg);
+          if (sc1 != sc2) esl_fatal("%s: Forward score %f != %f", msg, sc1, sc2);
+
+          for (i = 0; i <= L; i++)
+            {
+              for (s = 0; s < p7G_NXCELLS; s++)
+                if (gx1->xmx[i*p7G_NXCELLS+s] != gx2->xmx[i*p7G_NXCELLS+s]) esl_fatal("%s: Forward special state differs at row %d", msg, i);
+              for (k = 0; k <= M; k++)
+                for (s = 0; s < p7G_NSCELLS_FS; s++)
+                  if (gx1->dp[i][k*p7G_NSCELLS_FS+s] != gx2->dp[i][k*p7G_NSCELLS_FS+s]) esl_fatal("%s: Forward cell differs at i=%d k=%d", msg, i, k);
+            }
+        }
+
+      /* Backward */
+      if (p7_Backward_Frameshift(dsq, gcode, L, gm_fs, gx1, &sc1) != eslOK) esl_fatal(msg);
+      for (idx = 0; idx < 3; idx++)
+        {
+          if (backward_tiled(dsq, gcode, L, gm_fs, gx2, tiles[idx][0], tiles[idx][1], &sc2) != eslOK) esl_fatal(msg);
+          if (fabs(sc1 - sc2) > tol) esl_fatal("%s: Backward score %f != %f", msg, sc1, sc2);
+
+          for (i = 0; i <= L; i++)
+            {
+              for (s = 0; s < p7G_NXCELLS; s++)
+                {
+                  if (s == p7G_E || s == p7G_C) {
+                    if (gx1->xmx[i*p7G_NXCELLS+s] != gx2->xmx[i*p7G_NXCELLS+s]) esl_fatal("%s: Backward E/C differs at row %d", msg, i);
+                  } else if (gx1->xmx[i*p7G_NXCELLS+s] != gx2->xmx[i*p7G_NXCELLS+s] &&
+                             fabs(gx1->xmx[i*p7G_NXCELLS+s] - gx2->xmx[i*p7G_NXCELLS+s]) > tol)
+                    esl_fatal("%s: Backward special state differs at row %d", msg, i);
+                }
+              for (k = 0; k <= M; k++)
+                for (s = 0; s < p7G_NSCELLS; s++)
+                  if (gx1->dp[i][k*p7G_NSCELLS+s] != gx2->dp[i][k*p7G_NSCELLS+s]) esl_fatal("%s: Backward cell differs at i=%d k=%d", msg, i, k);
+            }
+        }
+    }
+
+  free(dsq);
+  p7_gmx_Destroy(gx1);
+  p7_gmx_Destroy(gx2);
+  p7_profile_fs_Destroy(gm_fs);
+  p7_hmm_Destroy(hmm);
+  esl_gencode_Destroy(gcode);
+  esl_alphabet_Destroy(abcDNA);
+}
+#endif /*p7FWDBACK_FRAMESHIFT_WAVEFRONT_TESTDRIVE*/
+/*-------------------- end, unit tests --------------------------*/
+
+
+
+/*****************************************************************
+ * 4. Test driver.
+ *****************************************************************/
+#ifdef p7FWDBACK_FRAMESHIFT_WAVEFRONT_TESTDRIVE
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default   env  range toggles reqs incomp  help                                    docgroup*/
+  { "-h",        eslARG_NONE,    FALSE, NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",           0 },
+  { "-s",        eslARG_INT,      "42", NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                  0 },
+  { "-L",        eslARG_INT,     "200", NULL, "n>0", NULL,  NULL, NULL, "length of random target seqs (nucleotides)",     0 },
+  { "-M",        eslARG_INT,      "45", NULL, NULL,  NULL,  NULL, NULL, "size of random models to sample",                0 },
+  { "-N",        eslARG_INT,       "5", NULL, NULL,  NULL,  NULL, NULL, "number of random target seqs",                   0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for the tiled and wavefront frameshift Forward/Backward";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go   = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r    = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc  = esl_alphabet_Create(eslAMINO);
+  P7_BG          *bg   = p7_bg_Create(abc);
+  int             M    = esl_opt_GetInteger(go, "-M");
+  int             L    = esl_opt_GetInteger(go, "-L");
+  int             N    = esl_opt_GetInteger(go, "-N");
+
+  p7_FLogsumInit();
+
+  utest_tiled(r, abc, bg, M, L, N);
+#ifdef HMMER_THREADS
+  utest_wavefront(r, abc, bg, M, L, N);
+#endif
+
+  p7_bg_Destroy(bg);
+  esl_alphabet_Destroy(abc);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7FWDBACK_FRAMESHIFT_WAVEFRONT_TESTDRIVE*/
+/*------------------ end, test driver ---------------------------*/
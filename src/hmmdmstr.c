@@ -69,10 +69,19 @@ typedef struct {
   pthread_cond_t   start_cond;
   pthread_cond_t   complete_cond;
 
-  int              db_version;
+  int              db_version;   /* generation that searches run on                */
   P7_SEQCACHE     *seq_db;
   P7_HMMCACHE     *hmm_db;
 
+  /* a !reload loads the next generation here; searches stay on <db_version>
+   * until every worker has it too. <next_version> equals <db_version> until
+   * the master's own copy is loaded.
+   */
+  int              reloading;    /* TRUE from !reload until the switch             */
+  int              next_version;
+  P7_SEQCACHE     *next_seq_db;
+  P7_HMMCACHE     *next_hmm_db;
+
   int              ready;
   int              failed;
   struct worker_s *head;
@@ -96,6 +105,7 @@ typedef struct worker_s {
   int                   completed;
   int                   terminated;
   HMMD_COMMAND         *cmd;
+  int                   db_version;  /* newest generation the worker has loaded */
 
   uint32_t              srch_inx;
   uint32_t              srch_cnt;
@@ -117,6 +127,10 @@ typedef struct worker_s {
 static void setup_clientside_comm(ESL_GETOPTS *opts, CLIENTSIDE_ARGS  *args);
 static void setup_workerside_comm(ESL_GETOPTS *opts, WORKERSIDE_ARGS  *args);
 
+static HMMD_COMMAND *init_command(P7_SEQCACHE *seq_db, P7_HMMCACHE *hmm_db, int version);
+static void         *reload_thread(void *arg);
+static void          reload_switch(WORKERSIDE_ARGS *args);
+
 static void destroy_worker(WORKER_DATA *worker);
 
 static void init_results(SEARCH_RESULTS *results);
@@ -290,6 +304,26 @@ update_workers(WORKERSIDE_ARGS *args)
   assert(validate_workers(args));
 }
 
+/* bath_share()
+ * For a --bath scan of a DNA query of length <L>, the number of
+ * models from <inx> on that make one worker's share of the predicted
+ * cost of the <cnt> models left, split among <nworkers>. The last
+ * worker takes all that are left.
+ */
+static int
+bath_share(P7_HMMCACHE *hmm_db, int inx, int cnt, int nworkers, int64_t L)
+{
+  double total = 0.;
+  double sum   = 0.;
+  int    i;
+
+  if (nworkers <= 1) return cnt;
+  for (i = inx; i < inx + cnt; i++) total += hmmpgmd_BathCost(hmm_db->list[i], L);
+
+  for (i = 0; i < cnt && sum < total / nworkers; i++) sum += hmmpgmd_BathCost(hmm_db->list[inx+i], L);
+  return i;
+}
+
 static void
 process_search(WORKERSIDE_ARGS *args, QUEUE_DATA *query)
 {
@@ -302,6 +336,7 @@ process_search(WORKERSIDE_ARGS *args, QUEUE_DATA *query)
   int ready_workers;    /* counter variable used to track the number of workers currently available to receive work; short for "remaining", I imagine */
   int tries;
   int i;
+  int64_t bath_L = 0;   /* DNA query length, if this is a --bath scan */
 
 
   memset(&results, 0, sizeof(SEARCH_RESULTS)); /* avoid valgrind bitching about uninit bytes; remove, if we ever serialize structs properly */
@@ -325,8 +360,12 @@ process_search(WORKERSIDE_ARGS *args, QUEUE_DATA *query)
     else{ 
      cnt = args->hmm_db->n;
     }
+    if (esl_opt_IsUsed(query->opts, "--bath")) bath_L = query->seq->n;
   }
   
+  /* every worker searches the generation the master counted on */
+  query->cmd->srch.db_version = args->db_version;
+
   // start timer after we make sure the relevant database exists to make cleanup easier on error
   w = esl_stopwatch_Create();
   esl_stopwatch_Start(w);
@@ -379,6 +418,11 @@ process_search(WORKERSIDE_ARGS *args, QUEUE_DATA *query)
             inx++;
           }
           cnt -= curr;
+        } else if (bath_L > 0) {
+          // --bath scans - split so that each worker gets the same predicted cost, not the same number of models
+          worker->srch_cnt = bath_share(args->hmm_db, inx, cnt, ready_workers, bath_L);
+          inx += worker->srch_cnt;
+          cnt -= worker->srch_cnt;
         } else {
           // default - split evenly among workers
           worker->srch_cnt = cnt / ready_workers;
@@ -506,6 +550,130 @@ process_shutdown(WORKERSIDE_ARGS *args, QUEUE_DATA *query)
   if ((n = pthread_mutex_unlock (&args->work_mutex)) != 0) LOG_FATAL_MSG("mutex unlock", n);
 }
 
+/* process_reload()
+ * Start a client's !reload: the databases the master was started on
+ * are read again, into a new generation, on a background thread;
+ * searches go on as before until every worker has it too. One reload
+ * at a time.
+ */
+static void
+process_reload(WORKERSIDE_ARGS *args, QUEUE_DATA *query)
+{
+  pthread_t thread_id;
+  int       busy;
+  int       n;
+
+  if ((n = pthread_mutex_lock (&args->work_mutex)) != 0) LOG_FATAL_MSG("mutex lock", n);
+  if (! (busy = args->reloading)) args->reloading = TRUE;
+  if ((n = pthread_mutex_unlock (&args->work_mutex)) != 0)  LOG_FATAL_MSG("mutex unlock", n);
+
+  if (busy) {
+    client_msg(query->sock, eslFAIL, "A reload is already in progress\n");
+    return;
+  }
+
+  if ((n = pthread_create(&thread_id, NULL, reload_thread, (void *) args)) != 0) LOG_FATAL_MSG("thread create", n);
+  pthread_detach(thread_id);
+  client_msg(query->sock, eslOK, "Reloading data in the background\n");
+}
+
+/* reload_thread()
+ * Load the master's copy of the next generation, and hand it to the
+ * worker threads, which ask their workers to load it too.
+ */
+static void *
+reload_thread(void *arg)
+{
+  WORKERSIDE_ARGS *args   = (WORKERSIDE_ARGS *) arg;
+  P7_SEQCACHE     *seq_db = NULL;
+  P7_HMMCACHE     *hmm_db = NULL;
+  char             errbuf[eslERRBUFSIZE];
+  int              version = 0;
+  int              n;
+  int              status = eslOK;
+
+  /* only reload_switch() replaces the current caches, and not while we're reloading */
+  if (args->seq_db != NULL) {
+    if ((status = p7_seqcache_Open(args->seq_db->name, &seq_db, errbuf)) != eslOK)
+      p7_syslog(LOG_ERR,"[%s:%d] - reload: p7_seqcache_Open %s error %d\n", __FILE__, __LINE__, args->seq_db->name, status);
+  }
+
+  if (status == eslOK && args->hmm_db != NULL) {
+    if ((status = p7_hmmcache_Open(args->hmm_db->name, &hmm_db, errbuf)) != eslOK)
+      p7_syslog(LOG_ERR,"[%s:%d] - reload: p7_hmmcache_Open %s error %d - %s\n", __FILE__, __LINE__, args->hmm_db->name, status, errbuf);
+    else
+      status = p7_hmmcache_SetNumericNames(hmm_db);
+  }
+
+  if ((n = pthread_mutex_lock (&args->work_mutex)) != 0) LOG_FATAL_MSG("mutex lock", n);
+  if (status == eslOK) {
+    args->next_seq_db  = seq_db;
+    args->next_hmm_db  = hmm_db;
+    args->next_version = version = args->db_version + 1;
+
+    /* wake the idle worker threads to start their workers loading */
+    if ((n = pthread_cond_broadcast(&args->start_cond)) != 0) LOG_FATAL_MSG("cond broadcast", n);
+  } else {
+    args->reloading = FALSE;
+  }
+  if ((n = pthread_mutex_unlock (&args->work_mutex)) != 0)  LOG_FATAL_MSG("mutex unlock", n);
+
+  if (status == eslOK) {
+    printf("Reloaded data generation %d in the master.\n", version);
+  } else {
+    if (hmm_db) p7_hmmcache_Close(hmm_db);
+    if (seq_db) p7_seqcache_Close(seq_db);
+    printf("Reload failed (%d); keeping the current data.\n", status);
+  }
+  fflush(stdout);
+
+  pthread_exit(NULL);
+}
+
+/* reload_switch()
+ * If a reload's next generation is loaded in the master and in every
+ * worker, make it the current one; the master's old caches are closed,
+ * and each worker drops its old one on its first search of the new one.
+ * Called by the master thread between commands, so no search is running.
+ */
+static void
+reload_switch(WORKERSIDE_ARGS *args)
+{
+  WORKER_DATA *worker;
+  P7_SEQCACHE *seq_db = NULL;
+  P7_HMMCACHE *hmm_db = NULL;
+  int          ready  = TRUE;
+  int          n;
+
+  if ((n = pthread_mutex_lock (&args->work_mutex)) != 0) LOG_FATAL_MSG("mutex lock", n);
+
+  if (args->next_version != args->db_version) {
+    /* a failed worker is dropped, not waited for */
+    for (worker = args->head;    worker != NULL; worker = worker->next)
+      if (! worker->terminated && worker->db_version != args->next_version) ready = FALSE;
+    for (worker = args->pending; worker != NULL; worker = worker->next)
+      if (! worker->terminated && worker->db_version != args->next_version) ready = FALSE;
+
+    if (ready) {
+      seq_db            = args->seq_db;
+      hmm_db            = args->hmm_db;
+      args->seq_db      = args->next_seq_db;
+      args->hmm_db      = args->next_hmm_db;
+      args->db_version  = args->next_version;
+      args->next_seq_db = NULL;
+      args->next_hmm_db = NULL;
+      args->reloading   = FALSE;
+      printf("Switched to data generation %d.\n", args->db_version);
+      fflush(stdout);
+    }
+  }
+
+  if ((n = pthread_mutex_unlock (&args->work_mutex)) != 0)  LOG_FATAL_MSG("mutex unlock", n);
+
+  if (hmm_db) p7_hmmcache_Close(hmm_db);
+  if (seq_db) p7_seqcache_Close(seq_db);
+}
+
 
 void
 master_process(ESL_GETOPTS *go)
@@ -577,6 +745,11 @@ master_process(ESL_GETOPTS *go)
   worker_comm.hmm_db     = hmm_db;
   worker_comm.db_version = 1;
 
+  worker_comm.reloading    = FALSE;
+  worker_comm.next_version = worker_comm.db_version;
+  worker_comm.next_seq_db  = NULL;
+  worker_comm.next_hmm_db  = NULL;
+
   worker_comm.ready      = 0;
   worker_comm.failed     = 0;
   worker_comm.pend_cnt   = 0;
@@ -592,6 +765,9 @@ master_process(ESL_GETOPTS *go)
     printf("Processing command %d from %s\n", query->cmd_type, query->ip_addr);
     fflush(stdout);
 
+    /* move on to a reloaded generation once every worker has it */
+    reload_switch(&worker_comm);
+
     worker_comm.range_list = NULL;
 
     switch(query->cmd_type) {
@@ -603,6 +779,7 @@ master_process(ESL_GETOPTS *go)
       process_search(&worker_comm, query); 
       break;
     case HMMD_CMD_SCAN:        process_search(&worker_comm, query); break;
+    case HMMD_CMD_INIT:        process_reload(&worker_comm, query); break;
     case HMMD_CMD_SHUTDOWN:    
       process_shutdown(&worker_comm, query);
       p7_syslog(LOG_ERR,"[%s:%d] - shutting down...\n", __FILE__, __LINE__);
@@ -618,8 +795,8 @@ master_process(ESL_GETOPTS *go)
 
   esl_stack_ReleaseCond(cmdstack);
 
-  if (hmm_db) p7_hmmcache_Close(hmm_db);
-  if (seq_db) p7_seqcache_Close(seq_db);
+  if (worker_comm.hmm_db) p7_hmmcache_Close(worker_comm.hmm_db);   /* a reload may have replaced the ones we started with */
+  if (worker_comm.seq_db) p7_seqcache_Close(worker_comm.seq_db);
 
   esl_stack_Destroy(cmdstack);
 
@@ -1027,6 +1204,13 @@ process_ServerCmd(char *ptr, CLIENTSIDE_ARGS *data)
       cmd->hdr.length  = 0;
       cmd->hdr.command = HMMD_CMD_SHUTDOWN;
     } 
+  else if (strcmp(s, "reload") == 0) 
+    {
+      if ((cmd = malloc(sizeof(HMMD_HEADER))) == NULL) LOG_FATAL_MSG("malloc", errno);
+      memset(cmd, 0, sizeof(HMMD_HEADER));
+      cmd->hdr.length  = 0;
+      cmd->hdr.command = HMMD_CMD_INIT;
+    } 
   else 
     {
       client_msg(fd, eslEINVAL, "Unknown command %s\n", s);
@@ -1192,6 +1376,10 @@ clientside_loop(CLIENTSIDE_ARGS *data)
       client_msg_longjmp(data->sock_fd, eslEINVAL, &jmp_env, "No search database specified, --seqdb or --hmmdb.");
     }
 
+    /* the workers' resident frameshift models are configured for the standard code */
+    if (esl_opt_IsUsed(opts, "--bath") && esl_opt_GetInteger(opts, "-c") != 1)
+      client_msg_longjmp(data->sock_fd, eslEINVAL, &jmp_env, "--bath searches use the standard genetic code; -c is not supported.");
+
 
     abc = esl_alphabet_Create(eslAMINO);
     seq = NULL;
@@ -1199,7 +1387,7 @@ clientside_loop(CLIENTSIDE_ARGS *data)
 
     if (*ptr == '>') {
       /* try to parse the input buffer as a FASTA sequence */
-      if (esl_opt_IsUsed(opts, "--hmmscant")) {
+      if (esl_opt_IsUsed(opts, "--hmmscant") || esl_opt_IsUsed(opts, "--bath")) {
         abcDNA = esl_alphabet_Create(eslDNA);
         seq = esl_sq_CreateDigital(abcDNA);
         if (abcDNA  != NULL) esl_alphabet_Destroy(abcDNA);
@@ -1485,12 +1673,113 @@ setup_clientside_comm(ESL_GETOPTS *opts, CLIENTSIDE_ARGS *args)
   if ((n = pthread_create(&thread_id, NULL, client_comm_thread, (void *)args)) != 0) LOG_FATAL_MSG("socket", n);
 }
 
+/* init_command()
+ * Build the INIT command that has a worker load <seq_db> and <hmm_db>
+ * as generation <version>. Caller holds the work mutex, and frees the
+ * command. Returns NULL on allocation failure.
+ */
+static HMMD_COMMAND *
+init_command(P7_SEQCACHE *seq_db, P7_HMMCACHE *hmm_db, int version)
+{
+  HMMD_COMMAND *cmd = NULL;
+  char         *p;
+  int           n;
+
+  n = sizeof(HMMD_COMMAND);
+  if (seq_db != NULL) n += strlen(seq_db->name) + 1;
+  if (hmm_db != NULL) n += strlen(hmm_db->name) + 1;
+
+  if ((cmd = malloc(n)) == NULL) return NULL;
+  memset(cmd, 0, n);
+
+  cmd->hdr.length      = n - sizeof(HMMD_HEADER);
+  cmd->hdr.command     = HMMD_CMD_INIT;
+  cmd->init.db_version = version;
+
+  p = cmd->init.data;
+
+  if (seq_db != NULL) {
+    cmd->init.db_cnt      = seq_db->db_cnt;
+    cmd->init.seq_cnt     = seq_db->count;
+    cmd->init.seqdb_off   = p - cmd->init.data;
+
+    strncpy(cmd->init.sid, seq_db->id, sizeof(cmd->init.sid));
+    cmd->init.sid[sizeof(cmd->init.sid)-1] = 0;
+
+    strcpy(p, seq_db->name);
+    p += strlen(seq_db->name) + 1;
+  }
+
+  if (hmm_db != NULL) {
+    cmd->init.hmm_cnt     = 1;
+    cmd->init.model_cnt   = hmm_db->n;
+    cmd->init.hmmdb_off   = p - cmd->init.data;
+
+    //strncpy(cmd->init.hid, hmm_db->id, sizeof(cmd->init.hid));
+    //cmd->init.hid[sizeof(cmd->init.hid)-1] = 0;
+
+    strcpy(p, hmm_db->name);
+    p += strlen(hmm_db->name) + 1;
+  }
+
+  return cmd;
+}
+
+/* reload_poll()
+ * Send <worker> INIT command <init> for a reload, and record the
+ * generation its reply says it has loaded. The reply comes at once:
+ * the worker loads in the background. Returns <eslOK>, or <eslFAIL>
+ * if the connection failed.
+ */
+static int
+reload_poll(WORKERSIDE_ARGS *data, WORKER_DATA *worker, HMMD_COMMAND *init)
+{
+  HMMD_COMMAND *reply = NULL;
+  HMMD_HEADER   hdr;
+  int           n;
+
+  n = MSG_SIZE(init);
+  if (writen(worker->sock_fd, init, n) != n) {
+    p7_syslog(LOG_ERR,"[%s:%d] - writing %s error %d - %s\n", __FILE__, __LINE__, worker->ip_addr, errno, strerror(errno));
+    return eslFAIL;
+  }
+
+  if (readn(worker->sock_fd, &hdr, sizeof(hdr)) == -1) {
+    p7_syslog(LOG_ERR,"[%s:%d] - reading %s error %d - %s\n", __FILE__, __LINE__, worker->ip_addr, errno, strerror(errno));
+    return eslFAIL;
+  }
+  if (hdr.command != HMMD_CMD_INIT || hdr.length < sizeof(HMMD_INIT_CMD) - 1) {
+    p7_syslog(LOG_ERR,"[%s:%d] - expecting HMMD_CMD_INIT from %s, got %d\n", __FILE__, __LINE__, worker->ip_addr, hdr.command);
+    return eslFAIL;
+  }
+  if ((reply = malloc(MSG_SIZE(&hdr))) == NULL) LOG_FATAL_MSG("malloc", errno);
+  if (readn(worker->sock_fd, &(reply->init), hdr.length) == -1) {
+    p7_syslog(LOG_ERR,"[%s:%d] - reading %s error %d - %s\n", __FILE__, __LINE__, worker->ip_addr, errno, strerror(errno));
+    free(reply);
+    return eslFAIL;
+  }
+
+  if ((n = pthread_mutex_lock (&data->work_mutex)) != 0) LOG_FATAL_MSG("mutex lock", n);
+  if (hdr.status == eslOK) worker->db_version = reply->init.db_version;
+  if ((n = pthread_mutex_unlock (&data->work_mutex)) != 0) LOG_FATAL_MSG("mutex unlock", n);
+
+  if (worker->db_version == init->init.db_version) {
+    printf("WORKER %s loaded data generation %d\n", worker->ip_addr, worker->db_version);
+    fflush(stdout);
+  }
+  free(reply);
+  return eslOK;
+}
+
 static void
 workerside_loop(WORKERSIDE_ARGS *data, WORKER_DATA *worker)
 {
   ESL_STOPWATCH      *w     = NULL;
   HMMD_SEARCH_STATS  *stats = NULL;
+  HMMD_COMMAND       *init  = NULL;  /* a reload's INIT for this worker           */
   HMMD_COMMAND        cmd;
+  struct timespec     ts;
+  time_t              poll_at = 0;   /* when to next ask a reloading worker       */
   int    n, i;
   int    size;
   int    total;
@@ -1505,13 +1794,35 @@ workerside_loop(WORKERSIDE_ARGS *data, WORKER_DATA *worker)
     /* wait for the next search object */
     if ((n = pthread_mutex_lock (&data->work_mutex)) != 0) LOG_FATAL_MSG("mutex lock", n);
 
-    /* wait for the master's signal to start the calculations */
+    /* wait for the master's signal to start the calculations; in between,
+     * during a reload, ask the worker to load the next generation, and
+     * keep asking (once a second) until it has
+     */
     while (worker->cmd == NULL) {
-      if ((n = pthread_cond_wait(&data->start_cond, &data->work_mutex)) != 0) LOG_FATAL_MSG("cond wait", n);
+      if (data->next_version != data->db_version && worker->db_version != data->next_version) {
+        if (time(NULL) >= poll_at) {
+          if ((init = init_command(data->next_seq_db, data->next_hmm_db, data->next_version)) == NULL) LOG_FATAL_MSG("malloc", errno);
+          break;
+        }
+        ts.tv_sec  = poll_at;
+        ts.tv_nsec = 0;
+        if ((n = pthread_cond_timedwait(&data->start_cond, &data->work_mutex, &ts)) != 0 && n != ETIMEDOUT) LOG_FATAL_MSG("cond wait", n);
+      } else {
+        if ((n = pthread_cond_wait(&data->start_cond, &data->work_mutex)) != 0) LOG_FATAL_MSG("cond wait", n);
+      }
     }
 
     if ((n = pthread_mutex_unlock (&data->work_mutex)) != 0) LOG_FATAL_MSG("mutex unlock", n);
 
+    if (init != NULL) {
+      n = reload_poll(data, worker, init);
+      free(init);
+      init    = NULL;
+      poll_at = time(NULL) + 1;
+      if (n != eslOK) break;
+      continue;
+    }
+
     if (worker->cmd->hdr.command == HMMD_CMD_SHUTDOWN) {
       fd_set rset;
       struct timeval tv;
@@ -1681,7 +1992,6 @@ workerside_thread(void *arg)
   int               version;
   int               updated;
   int               status = eslOK;
-  char             *p;
 
   memset(&hdr, 0, sizeof(HMMD_HEADER)); /* silence valgrind; remove if/when we serialize structs properly */
 
@@ -1696,47 +2006,15 @@ workerside_thread(void *arg)
     /* get the database version to load */
     if ((n = pthread_mutex_lock (&parent->work_mutex)) != 0) LOG_FATAL_MSG("mutex lock", n);
     version = parent->db_version;
+    if (cmd != NULL) free(cmd);
+    cmd = init_command(parent->seq_db, parent->hmm_db, version);
     if ((n = pthread_mutex_unlock (&parent->work_mutex)) != 0)  LOG_FATAL_MSG("mutex unlock", n);
 
-    n = sizeof(HMMD_COMMAND);
-    if (parent->seq_db != NULL) n += strlen(parent->seq_db->name) + 1;
-    if (parent->hmm_db != NULL) n += strlen(parent->hmm_db->name) + 1;
-
-    cmd = malloc(n);
     if (cmd == NULL) {
       p7_syslog(LOG_ERR,"[%s:%d] - malloc %d - %s\n", __FILE__, __LINE__, errno, strerror(errno));
       goto EXIT;
     }
-    memset(cmd, 0, n);
-
-    cmd->hdr.length  = n - sizeof(HMMD_HEADER);
-    cmd->hdr.command = HMMD_CMD_INIT;
-
-    p = cmd->init.data;
-
-    if (parent->seq_db != NULL) {
-      cmd->init.db_cnt      = parent->seq_db->db_cnt;
-      cmd->init.seq_cnt     = parent->seq_db->count;
-      cmd->init.seqdb_off   = p - cmd->init.data;
-
-      strncpy(cmd->init.sid, parent->seq_db->id, sizeof(cmd->init.sid));
-      cmd->init.sid[sizeof(cmd->init.sid)-1] = 0;
-
-      strcpy(p, parent->seq_db->name);
-      p += strlen(parent->seq_db->name) + 1;
-    }
-
-    if (parent->hmm_db != NULL) {
-      cmd->init.hmm_cnt     = 1;
-      cmd->init.model_cnt   = parent->hmm_db->n;
-      cmd->init.hmmdb_off   = p - cmd->init.data;
-
-      //strncpy(cmd->init.hid, parent->hmm_db->id, sizeof(cmd->init.hid));
-      //cmd->init.hid[sizeof(cmd->init.hid)-1] = 0;
-
-      strcpy(p, parent->hmm_db->name);
-      p += strlen(parent->hmm_db->name) + 1;
-    }
+    n = MSG_SIZE(cmd);
 
     if (writen(worker->sock_fd, cmd, n) != n) {
       p7_syslog(LOG_ERR,"[%s:%d] - writing (%d) error %d - %s\n", __FILE__, __LINE__, worker->sock_fd, errno, strerror(errno));
@@ -1775,6 +2053,12 @@ workerside_thread(void *arg)
       status = eslFAIL;
     }
 
+    /* a worker that already has older data loads this generation in the background; ask again */
+    if (status == eslOK && cmd->init.db_version != version) {
+      sleep(1);
+      continue;
+    }
+
     worker->next = NULL;
     worker->prev = NULL;
 
@@ -1788,6 +2072,7 @@ workerside_thread(void *arg)
      * the version has changed, force the worker to reload and verify.
      */
     if (version == parent->db_version) {
+      worker->db_version = version;
       if (status == eslOK) {
         worker->next    = parent->pending;
         parent->pending = worker;
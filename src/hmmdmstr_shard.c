@@ -1233,6 +1233,10 @@ clientside_loop(CLIENTSIDE_ARGS *data)
       client_msg_longjmp(data->sock_fd, eslEINVAL, &jmp_env, "No search database specified, --seqdb or --hmmdb.");
     }
 
+    if (esl_opt_IsUsed(opts, "--bath")) {
+      client_msg_longjmp(data->sock_fd, eslEINVAL, &jmp_env, "--bath scans are not supported by the sharded daemon.");
+    }
+
 
     abc = esl_alphabet_Create(eslAMINO);
     seq = NULL;
@@ -95,6 +95,7 @@ static ESL_OPTIONS searchOpts[] = {
   { "--hmmdb",      eslARG_INT,       NULL,  NULL, "n>0",   NULL,  NULL,  "--seqdb",       "hmm database to search",                                      12 },
   //{ "--hmmsearcht",    eslARG_NONE,        NULL,  NULL, NULL,    NULL,  NULL,  "--hmmdb",       "search sequence database with a 6 frame translated DNA sequence",  12 },
   { "--hmmscant",  eslARG_NONE,         NULL,  NULL, NULL,    NULL,  NULL,  "--seqdb",       "search hmm database with a 6 frame translated DNA sequence",  12 },
+  { "--bath",      eslARG_NONE,         NULL,  NULL, NULL,    NULL,  NULL,  "--seqdb,--hmmscant", "search hmm database with a DNA sequence, frameshift aware (BATH)", 12 },
   { "--seqdb",      eslARG_INT,         NULL,  NULL, "n>0",   NULL,  NULL,  "--hmmdb",       "protein database to search",                                  12 },
   { "--seqdb_ranges",eslARG_STRING,     NULL,  NULL,  NULL,   NULL, "--seqdb", NULL,         "range(s) of sequences within --seqdb that will be searched",  12 },
   
@@ -293,4 +294,28 @@ ERROR:
   return eslEMEM;
 }
 
+
+/* Function:  hmmpgmd_BathCost()
+ * Synopsis:  Predicted cost of a BATH scan of one model.
+ *
+ * Purpose:   Return the predicted cost of a <--bath> scan of a DNA
+ *            query of length <L> with model <om>, in arbitrary
+ *            units. The ORF filters are O(LM) on each strand, and
+ *            the frameshift stages that follow work on windows of
+ *            about the model's maximum hit length, so the cost is
+ *            taken to be M * (L + max_length).
+ *
+ *            The master uses this to give each worker a share of
+ *            the hmm database that should take it the same time,
+ *            and a worker to hand out its share to its threads
+ *            largest first.
+ *
+ * Returns:   the predicted cost.
+ */
+double
+hmmpgmd_BathCost(const P7_OPROFILE *om, int64_t L)
+{
+  return (double) om->M * (double) (L + ESL_MAX(om->max_length, 0));
+}
+
 #endif /*HMMER_THREADS*/
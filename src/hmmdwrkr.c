@@ -52,6 +52,9 @@ typedef struct {
   P7_OPROFILE     **om_list;     /* list of profiles to process      */
   int               om_cnt;      /* number of profiles               */
 
+  struct bath_lib_s *bath_db;    /* --bath: resident BATH models       */
+  struct bath_job_s *jobs;       /* --bath: models, largest cost first */
+
   pthread_mutex_t  *inx_mutex;   /* protect data                     */
   int              *blk_size;    /* sequences per block              */
   int              *limit;       /* point to decrease block size     */
@@ -73,14 +76,80 @@ typedef struct {
   P7_TOPHITS       *th;          /* top hit results                  */
 } WORKER_INFO;
 
+/* The resident BATH library, for --bath scans: the frameshift aware
+ * profiles of every model in the hmm cache, in the same order, built
+ * once when the cache is loaded, the way bathsearch builds its query's.
+ * A scan only has to hand the DNA query to p7_Pipeline_BATH().
+ */
+typedef struct bath_lib_s {
+  ESL_ALPHABET    *abcAA;        /* amino alphabet of the profiles     */
+  ESL_ALPHABET    *abcDNA;       /* DNA alphabet of <gcode>            */
+  ESL_GENCODE     *gcode;        /* standard code <gm_fs> were built for */
+  P7_PROFILE     **gm;           /* generic profiles [0..n-1]          */
+  P7_FS_PROFILE  **gm_fs;        /* frameshift aware profiles [0..n-1] */
+  P7_SCOREDATA   **scoredata;    /* ORF to DNA window data [0..n-1]    */
+  int              n;            /* number of models                   */
+} BATH_LIB;
+
+/* One job of a --bath scan: a model, or a pack of small models whose
+ * ORF MSV filter is run in one pass (p7_MSVFilter_packedBlock()), so
+ * only the models an ORF passes go on to p7_Pipeline_BATH().
+ */
+#define BATH_PACK_Q     4        /* vectors per row in a pack                   */
+#define BATH_PACK_MAXM  32       /* packed models take <= 8 of 16 lanes         */
+
+typedef struct bath_job_s {
+  int              n;                  /* number of models, 1..p7O_NLANEB     */
+  int              idx[p7O_NLANEB];    /* their indices in the hmm cache      */
+  P7_MSVPACK      *pack;               /* the <n> models packed, or NULL      */
+  double           cost;               /* hmmpgmd_BathCost() for this query   */
+} BATH_JOB;
+
+/* A model to pack, by length. */
+typedef struct {
+  int              idx;          /* index in the hmm cache             */
+  int              M;            /* its length                         */
+} BATH_MODEL;
+
+/* One loaded generation of the databases. A search holds a reference
+ * for as long as it runs. On a master's !reload, the worker loads the
+ * new generation in the background while it goes on searching the old
+ * one, and keeps both until the master's searches move to the new
+ * one; the old one is closed when its last reference goes.
+ */
+typedef struct {
+  uint32_t     version;          /* generation, from the master's INIT */
+  P7_SEQCACHE *seq_db;           /* cached sequence database         */
+  P7_HMMCACHE *hmm_db;           /* cached hmm database              */
+  BATH_LIB    *bath_db;          /* its BATH models, if worker has --bath */
+  int          refs;             /* env's own + one per running search */
+} WORKER_DB;
+
 typedef struct {
   int fd;                        /* socket connection to server      */
   int ncpus;                     /* number of cpus to use            */
+  int bath;                      /* TRUE to keep BATH models resident  */
 
-  P7_SEQCACHE *seq_db;           /* cached sequence database         */
-  P7_HMMCACHE *hmm_db;           /* cached hmm database              */
+  WORKER_DB       *db;           /* newest databases; NULL before the first INIT      */
+  WORKER_DB       *old;          /* previous generation, until the master leaves it   */
+  pthread_mutex_t  db_mutex;     /* protects <db>, <old> and their reference counts   */
+  pthread_t        loader;       /* background reload thread ...                      */
+  uint32_t         loading;      /* ... loading this generation; 0 if none            */
 } WORKER_ENV;
 
+static WORKER_DB *worker_db_Load(HMMD_COMMAND *cmd, int bath);
+static void       worker_db_Swap(WORKER_ENV *env, WORKER_DB *db);
+static uint32_t   worker_db_Version(WORKER_ENV *env);
+static WORKER_DB *worker_db_Acquire(WORKER_ENV *env, uint32_t version);
+static void       worker_db_Release(WORKER_ENV *env, WORKER_DB *db);
+static void      *reload_thread(void *arg);
+
+static BATH_LIB  *bath_lib_Load(P7_HMMCACHE *hcache);
+static void       bath_lib_Destroy(BATH_LIB *lib);
+static int        bath_job_sorter(const void *vj1, const void *vj2);
+static int        bath_jobs_Create(WORKER_DB *db, QUEUE_DATA *query, BATH_JOB **ret_jobs);
+static int        bath_model_sorter(const void *vi1, const void *vi2);
+
 static void process_InitCmd(HMMD_COMMAND *cmd, WORKER_ENV *env);
 static void process_SearchCmd(HMMD_COMMAND *cmd, WORKER_ENV *env, QUEUE_DATA *query);
 static void process_Shutdown(HMMD_COMMAND *cmd, WORKER_ENV *env);
@@ -95,6 +164,7 @@ static void send_results(int fd, ESL_STOPWATCH *w, P7_TOPHITS *th, P7_PIPELINE *
 static void search_thread(void *arg);
 static void scan_thread(void *arg);
 static void scan_thread_translated(void *arg);
+static void scan_thread_bath(void *arg);
 
 static void
 print_timings(int i, double elapsed, P7_PIPELINE *pli)
@@ -157,9 +227,12 @@ worker_process(ESL_GETOPTS *go)
   p7_FLogsumInit();      /* we're going to use table-driven Logsum() approximations at times */
 
   env.ncpus = ESL_MIN(esl_opt_GetInteger(go, "--cpu"),  esl_threads_GetCPUCount());
+  env.bath  = esl_opt_GetBoolean(go, "--bath");
 
-  env.hmm_db = NULL;
-  env.seq_db = NULL;
+  env.db      = NULL;
+  env.old     = NULL;
+  env.loading = 0;
+  if (pthread_mutex_init(&env.db_mutex, NULL) != 0) p7_Fail("mutex init failed");
   env.fd     = setup_masterside_comm(go);
 
   while (!shutdown) 
@@ -191,8 +264,10 @@ worker_process(ESL_GETOPTS *go)
       cmd = NULL;
     }
 
-  if (env.hmm_db) p7_hmmcache_Close(env.hmm_db);
-  if (env.seq_db) p7_seqcache_Close(env.seq_db);
+  if (env.loading) pthread_join(env.loader, NULL);
+  worker_db_Release(&env, env.old);
+  worker_db_Release(&env, env.db);
+  pthread_mutex_destroy(&env.db_mutex);
   if (env.fd != -1) close(env.fd);
   return;
 }
@@ -225,6 +300,10 @@ process_SearchCmd(HMMD_COMMAND *cmd, WORKER_ENV *env, QUEUE_DATA *query)
   int              status;
   int              blk_size;
   WORKER_INFO     *info       = NULL;
+  WORKER_DB       *db         = worker_db_Acquire(env, cmd->srch.db_version);  /* stays valid for this search, even across a reload */
+  int              is_bath    = (query->cmd_type == HMMD_CMD_SCAN && esl_opt_IsUsed(query->opts, "--bath"));
+  BATH_JOB        *jobs       = NULL;
+  int              njobs      = 0;
   ESL_ALPHABET    *abc;
   ESL_STOPWATCH   *w;
   ESL_THREADS     *threadObj  = NULL;
@@ -236,6 +315,12 @@ process_SearchCmd(HMMD_COMMAND *cmd, WORKER_ENV *env, QUEUE_DATA *query)
   w = esl_stopwatch_Create();
   abc = esl_alphabet_Create(eslAMINO);
 
+  /* the master only searches a generation once every worker has it */
+  if (db == NULL) {
+    p7_syslog(LOG_ERR,"[%s:%d] - search of database generation %u, which isn't loaded\n", __FILE__, __LINE__, cmd->srch.db_version);
+    LOG_FATAL_MSG("database generation error", 0);
+  }
+
   if (pthread_mutex_init(&inx_mutex, NULL) != 0) p7_Fail("mutex init failed");
   ESL_ALLOC(info, sizeof(*info) * env->ncpus);
 
@@ -258,6 +343,8 @@ process_SearchCmd(HMMD_COMMAND *cmd, WORKER_ENV *env, QUEUE_DATA *query)
       threadObj = esl_threads_Create(&search_thread);
   } else if (esl_opt_IsUsed(query->opts, "--hmmscant")) {
       threadObj = esl_threads_Create(&scan_thread_translated); /* hmmsearcht not implemented, so always do scant*/
+  } else if (is_bath) {
+      threadObj = esl_threads_Create(&scan_thread_bath);
   } else {
       threadObj = esl_threads_Create(&scan_thread);
   }
@@ -277,6 +364,16 @@ process_SearchCmd(HMMD_COMMAND *cmd, WORKER_ENV *env, QUEUE_DATA *query)
 
   fprintf(stdout, "\n");
 
+  /* a --bath scan hands out this worker's models largest predicted cost first,
+   * so no thread is left with a big model at the end
+   */
+  if (is_bath && db->bath_db == NULL) {
+    p7_syslog(LOG_ERR,"[%s:%d] - --bath scan, but no resident BATH models; start the worker with --bath\n", __FILE__, __LINE__);
+    fprintf(stdout, "No resident BATH models; start the worker with --bath\n");
+  } else if (is_bath) {
+    njobs = bath_jobs_Create(db, query, &jobs);
+  }
+
   /* Create processing pipeline and hit list */
   for (i = 0; i < env->ncpus; ++i) {
     info[i].abc   = query->abc;
@@ -289,23 +386,34 @@ process_SearchCmd(HMMD_COMMAND *cmd, WORKER_ENV *env, QUEUE_DATA *query)
     info[i].th    = NULL;
     info[i].pli   = NULL;
 
+    info[i].bath_db = NULL;
+    info[i].jobs    = NULL;
+
     info[i].inx_mutex = &inx_mutex;
     info[i].inx       = &current_index;/* this is confusing trickery - to share a single variable across all threads */
     info[i].blk_size  = &blk_size;     /* ditto */
     info[i].limit     = &limit;	       /* ditto. TODO: come back and clean this up. */
 
     if (query->cmd_type == HMMD_CMD_SEARCH) {
-      HMMER_SEQ **list  = env->seq_db->db[query->dbx].list;
+      HMMER_SEQ **list  = db->seq_db->db[query->dbx].list;
       info[i].sq_list   = &list[query->inx];
       info[i].sq_cnt    = query->cnt;
-      info[i].db_Z      = env->seq_db->db[query->dbx].K;
+      info[i].db_Z      = db->seq_db->db[query->dbx].K;
       info[i].om_list   = NULL;
       info[i].om_cnt    = 0;
+    } else if (is_bath) {
+      info[i].sq_list   = NULL;
+      info[i].sq_cnt    = 0;
+      info[i].db_Z      = 0;
+      info[i].om_list   = db->hmm_db->list;    /* <jobs> index the whole cache */
+      info[i].om_cnt    = njobs;
+      info[i].bath_db   = db->bath_db;
+      info[i].jobs      = jobs;
     } else {
       info[i].sq_list   = NULL;
       info[i].sq_cnt    = 0;
       info[i].db_Z      = 0;
-      info[i].om_list   = &env->hmm_db->list[query->inx];
+      info[i].om_list   = &db->hmm_db->list[query->inx];
       info[i].om_cnt    = query->cnt;
     }
 
@@ -343,7 +451,8 @@ process_SearchCmd(HMMD_COMMAND *cmd, WORKER_ENV *env, QUEUE_DATA *query)
     p7_tophits_Merge(info[0].th, info[i].th);
     p7_pipeline_Merge(info[0].pli, info[i].pli);
 
-    p7_pipeline_Destroy(info[i].pli);
+    if (is_bath) p7_pipeline_fs_Destroy(info[i].pli);
+    else         p7_pipeline_Destroy(info[i].pli);
     p7_tophits_Destroy(info[i].th);
   }
 
@@ -352,14 +461,27 @@ process_SearchCmd(HMMD_COMMAND *cmd, WORKER_ENV *env, QUEUE_DATA *query)
       /* Sort and remove duplicates */
       p7_tophits_SortBySeqidxAndAlipos(info[0].th);
       p7_tophits_RemoveDuplicates(info[0].th, info[0].pli->use_bit_cutoffs);
+  } else if (is_bath) {
+      /* one DNA query, however many threads searched it */
+      info[0].pli->nseqs = 1;
+      info[0].pli->nres  = query->seq->n * (info[0].pli->strands == p7_STRAND_BOTH ? 2 : 1);
+
+      /* the fs and non-fs branches can both report a hit */
+      p7_tophits_SortByModelnameAndAlipos(info[0].th);
+      p7_tophits_RemoveDuplicates(info[0].th, info[0].pli->use_bit_cutoffs);
   }
 
   print_timings(99, w->elapsed, info[0].pli);
   send_results(env->fd, w, info[0].th, info[0].pli);
 
   /* free the last of the pipeline data */
-  p7_pipeline_Destroy(info->pli);
+  if (is_bath) p7_pipeline_fs_Destroy(info->pli);
+  else         p7_pipeline_Destroy(info->pli);
   p7_tophits_Destroy(info->th);
+  if (jobs) {
+    for (i = 0; i < njobs; i++) p7_msvpack_Destroy(jobs[i].pack);
+    free(jobs);
+  }
 
   esl_threads_Destroy(threadObj);
 
@@ -375,6 +497,7 @@ process_SearchCmd(HMMD_COMMAND *cmd, WORKER_ENV *env, QUEUE_DATA *query)
 
   esl_stopwatch_Destroy(w);
   esl_alphabet_Destroy(abc);
+  worker_db_Release(env, db);
 
   return;
 
@@ -418,7 +541,7 @@ process_QueryCmd(HMMD_COMMAND *cmd, WORKER_ENV *env)
   query->hmm = NULL;
   query->seq = NULL;
 
-  if (esl_opt_IsUsed(query->opts, "--hmmscant"))
+  if (esl_opt_IsUsed(query->opts, "--hmmscant") || esl_opt_IsUsed(query->opts, "--bath"))
      query->abc = esl_alphabet_Create(eslDNA);
   else
      query->abc = esl_alphabet_Create(eslAMINO);
@@ -494,18 +617,24 @@ process_Shutdown(HMMD_COMMAND *cmd, WORKER_ENV  *env)
   }
 }
 
-static void
-process_InitCmd(HMMD_COMMAND *cmd, WORKER_ENV  *env)
+/* worker_db_Load()
+ * Open and validate the databases named in INIT command <cmd>, and
+ * if <bath> is TRUE, build the BATH models of the hmm database.
+ * Errors are fatal, as they always were for the worker.
+ */
+static WORKER_DB *
+worker_db_Load(HMMD_COMMAND *cmd, int bath)
 {
-  char *p;
-  int   n;
-  int   status;
-
-  if (env->hmm_db != NULL) p7_hmmcache_Close(env->hmm_db);
-  if (env->seq_db != NULL) p7_seqcache_Close(env->seq_db);
+  WORKER_DB *db = NULL;
+  char      *p;
+  int        status;
 
-  env->hmm_db = NULL;
-  env->seq_db = NULL;
+  if ((db = malloc(sizeof(WORKER_DB))) == NULL) LOG_FATAL_MSG("malloc", errno);
+  db->version = cmd->init.db_version;
+  db->seq_db  = NULL;
+  db->hmm_db  = NULL;
+  db->bath_db = NULL;
+  db->refs    = 1;
 
   /* load the sequence database */
   if (cmd->init.db_cnt != 0) {
@@ -525,7 +654,7 @@ process_InitCmd(HMMD_COMMAND *cmd, WORKER_ENV  *env)
       LOG_FATAL_MSG("database integrity error", 0);
     }
 
-    env->seq_db = sdb;
+    db->seq_db = sdb;
   }
 
   /* load the hmm database */
@@ -534,7 +663,8 @@ process_InitCmd(HMMD_COMMAND *cmd, WORKER_ENV  *env)
 
     p  = cmd->init.data + cmd->init.hmmdb_off;
 
-    status = p7_hmmcache_Open(p, &hcache, NULL);
+    /* --bath configures its models from the full HMMs, read in the same pass */
+    status = bath ? p7_hmmcache_OpenHMMs(p, &hcache, NULL) : p7_hmmcache_Open(p, &hcache, NULL);
     if (status != eslOK) {
       p7_syslog(LOG_ERR,"[%s:%d] - p7_hmmcache_Open %s error %d\n", __FILE__, __LINE__, p, status);
       LOG_FATAL_MSG("cache hmmdb error", status);
@@ -553,25 +683,347 @@ process_InitCmd(HMMD_COMMAND *cmd, WORKER_ENV  *env)
       LOG_FATAL_MSG("database integrity error", 0);
     }
 
-    env->hmm_db = hcache;
+    db->hmm_db = hcache;
+
+    if (bath) {
+      db->bath_db = bath_lib_Load(hcache);
+      p7_hmmcache_DropHMMs(hcache);
+    }
 
     printf("Loaded profile db %s;  models: %d  memory: %" PRId64 "\n",
          p, hcache->n, (uint64_t) p7_hmmcache_Sizeof(hcache));
+    if (bath) printf("Built BATH models for %s;  models: %d\n", p, db->bath_db->n);
 
   }
 
-  /* if stdout is redirected at the commandline, it causes printf's to be buffered,
-   * which means status logging isn't printed. This line strongly requests unbuffering,
-   * which should be ok, given the low stdout load of hmmpgmd
-   */
-  setvbuf (stdout, NULL, _IONBF, BUFSIZ);
-  printf("Data loaded into memory. Worker is ready.\n");
-  setvbuf (stdout, NULL, _IOFBF, BUFSIZ);
+  return db;
+}
 
+/* worker_db_Swap()
+ * Make <db> the newest databases. The ones it replaces are kept as
+ * the previous generation, for searches the master still sends them;
+ * any generation older than that is dropped.
+ */
+static void
+worker_db_Swap(WORKER_ENV *env, WORKER_DB *db)
+{
+  WORKER_DB *drop;
+
+  if (pthread_mutex_lock(&env->db_mutex) != 0) p7_Fail("mutex lock failed");
+  drop     = env->old;
+  env->old = env->db;
+  env->db  = db;
+  if (pthread_mutex_unlock(&env->db_mutex) != 0) p7_Fail("mutex unlock failed");
+  worker_db_Release(env, drop);   /* closed here, or by the last search still running on it */
+}
+
+/* worker_db_Version()
+ * The generation of the newest databases; 0 before the first INIT.
+ */
+static uint32_t
+worker_db_Version(WORKER_ENV *env)
+{
+  uint32_t version;
+
+  if (pthread_mutex_lock(&env->db_mutex) != 0) p7_Fail("mutex lock failed");
+  version = (env->db != NULL) ? env->db->version : 0;
+  if (pthread_mutex_unlock(&env->db_mutex) != 0) p7_Fail("mutex unlock failed");
+  return version;
+}
+
+/* worker_db_Acquire(), worker_db_Release()
+ * Take and drop a reference on the databases of generation <version>;
+ * the last release closes them. Acquire returns NULL if that generation
+ * isn't loaded. A search of the newest generation means the master has
+ * left the previous one, so that's dropped. Release of NULL is a no-op.
+ */
+static WORKER_DB *
+worker_db_Acquire(WORKER_ENV *env, uint32_t version)
+{
+  WORKER_DB *db   = NULL;
+  WORKER_DB *drop = NULL;
+
+  if (pthread_mutex_lock(&env->db_mutex) != 0) p7_Fail("mutex lock failed");
+  if (env->db != NULL && env->db->version == version) {
+    db       = env->db;
+    drop     = env->old;
+    env->old = NULL;
+  } else if (env->old != NULL && env->old->version == version) {
+    db       = env->old;
+  }
+  if (db != NULL) db->refs++;
+  if (pthread_mutex_unlock(&env->db_mutex) != 0) p7_Fail("mutex unlock failed");
+
+  worker_db_Release(env, drop);
+  return db;
+}
+
+static void
+worker_db_Release(WORKER_ENV *env, WORKER_DB *db)
+{
+  int last;
+
+  if (db == NULL) return;
+  if (pthread_mutex_lock(&env->db_mutex) != 0) p7_Fail("mutex lock failed");
+  last = (--db->refs == 0);
+  if (pthread_mutex_unlock(&env->db_mutex) != 0) p7_Fail("mutex unlock failed");
+
+  if (last) {
+    if (db->bath_db != NULL) bath_lib_Destroy(db->bath_db);
+    if (db->hmm_db != NULL) p7_hmmcache_Close(db->hmm_db);
+    if (db->seq_db != NULL) p7_seqcache_Close(db->seq_db);
+    free(db);
+  }
+}
+
+/* bath_lib_Load()
+ * Build the BATH models of hmm cache <hcache>, from the full HMMs
+ * that p7_hmmcache_OpenHMMs() kept; the caller drops those after.
+ * The frameshift aware profiles take the cache's numeric names,
+ * which is what their hits report. Errors are fatal.
+ */
+static BATH_LIB *
+bath_lib_Load(P7_HMMCACHE *hcache)
+{
+  BATH_LIB     *lib    = NULL;
+  P7_HMM       *hmm;
+  P7_BG        *bg     = NULL;
+  P7_OPROFILE  *om;
+  int           i;
+  int           status;
+
+  ESL_ALLOC(lib, sizeof(BATH_LIB));
+  lib->abcAA     = NULL;
+  lib->abcDNA    = NULL;
+  lib->gcode     = NULL;
+  lib->gm        = NULL;
+  lib->gm_fs     = NULL;
+  lib->scoredata = NULL;
+  lib->n         = 0;
+
+  ESL_ALLOC(lib->gm,        sizeof(P7_PROFILE *)    * ESL_MAX(1, hcache->n));
+  ESL_ALLOC(lib->gm_fs,     sizeof(P7_FS_PROFILE *) * ESL_MAX(1, hcache->n));
+  ESL_ALLOC(lib->scoredata, sizeof(P7_SCOREDATA *)  * ESL_MAX(1, hcache->n));
+
+  /* resident models are built for the standard code; the master turns away --bath with any other -c */
+  if ((lib->abcAA  = esl_alphabet_Create(eslAMINO))                == NULL) goto ERROR;
+  if ((lib->abcDNA = esl_alphabet_Create(eslDNA))                  == NULL) goto ERROR;
+  if ((lib->gcode  = esl_gencode_Create(lib->abcDNA, lib->abcAA))  == NULL) goto ERROR;
+  esl_gencode_Set(lib->gcode, 1);
+  if ((bg = p7_bg_fs_Create(lib->abcAA)) == NULL) goto ERROR;
+
+  for (i = 0; i < hcache->n; i++)
+    {
+      om  = hcache->list[i];
+      hmm = hcache->hmm[i];
+      if (hmm->max_length == -1) p7_Builder_MaxLength(hmm, p7_DEFAULT_WINDOW_BETA);
+      if (om->max_length  == -1) om->max_length = hmm->max_length;
+
+      lib->gm[i]    = p7_profile_Create   (hmm->M, lib->abcAA);
+      lib->gm_fs[i] = p7_profile_fs_Create(hmm->M, lib->abcAA);
+      if (lib->gm[i] == NULL || lib->gm_fs[i] == NULL) goto ERROR;
+      if ((status = p7_ProfileConfig   (hmm, bg,             lib->gm[i],    100, p7_LOCAL)) != eslOK) LOG_FATAL_MSG("p7_ProfileConfig", status);
+      if ((status = p7_ProfileConfig_fs(hmm, bg, lib->gcode, lib->gm_fs[i], 100, p7_LOCAL)) != eslOK) LOG_FATAL_MSG("p7_ProfileConfig_fs", status);
+      if ((lib->scoredata[i] = p7_hmm_ScoreDataCreate(om, NULL)) == NULL) goto ERROR;
+      lib->n++;
+
+      free(lib->gm_fs[i]->name);
+      if (esl_strdup(om->name, -1, &(lib->gm_fs[i]->name)) != eslOK) goto ERROR;
+    }
+
+  p7_bg_Destroy(bg);
+  return lib;
+
+ ERROR:
+  LOG_FATAL_MSG("malloc", errno);
+}
+
+static void
+bath_lib_Destroy(BATH_LIB *lib)
+{
+  int i;
+
+  if (lib == NULL) return;
+  for (i = 0; i < lib->n; i++) {
+    p7_hmm_ScoreDataDestroy(lib->scoredata[i]);
+    p7_profile_fs_Destroy(lib->gm_fs[i]);
+    p7_profile_Destroy(lib->gm[i]);
+  }
+  if (lib->scoredata) free(lib->scoredata);
+  if (lib->gm_fs)     free(lib->gm_fs);
+  if (lib->gm)        free(lib->gm);
+  if (lib->gcode)     esl_gencode_Destroy(lib->gcode);
+  if (lib->abcDNA)    esl_alphabet_Destroy(lib->abcDNA);
+  if (lib->abcAA)     esl_alphabet_Destroy(lib->abcAA);
+  free(lib);
+}
+
+/* bath_job_sorter()
+ * qsort() order for --bath jobs: largest predicted cost first.
+ */
+static int
+bath_job_sorter(const void *vj1, const void *vj2)
+{
+  const BATH_JOB *j1 = (const BATH_JOB *) vj1;
+  const BATH_JOB *j2 = (const BATH_JOB *) vj2;
+
+  if      (j1->cost < j2->cost) return  1;
+  else if (j1->cost > j2->cost) return -1;
+  else                          return (j1->idx[0] - j2->idx[0]);
+}
+
+/* bath_model_sorter()
+ * qsort() order for the models to pack: shortest first.
+ */
+static int
+bath_model_sorter(const void *vm1, const void *vm2)
+{
+  const BATH_MODEL *m1 = (const BATH_MODEL *) vm1;
+  const BATH_MODEL *m2 = (const BATH_MODEL *) vm2;
+
+  if (m1->M != m2->M) return (m1->M - m2->M);
+  else                return (m1->idx - m2->idx);
+}
+
+/* bath_jobs_Create()
+ * Make the jobs of a --bath scan of models <query->inx..> of <db>:
+ * models of length <= BATH_PACK_MAXM go into packs, filled shortest
+ * first, and every other model is a job of its own; a pack that ends
+ * up with one model is just that model. Jobs are sorted largest
+ * predicted cost first. Returns the number of jobs, and the jobs in
+ * <*ret_jobs>; the caller frees their packs and the array. Errors
+ * are fatal.
+ */
+static int
+bath_jobs_Create(WORKER_DB *db, QUEUE_DATA *query, BATH_JOB **ret_jobs)
+{
+  BATH_JOB    *jobs   = NULL;
+  BATH_JOB    *job    = NULL;
+  BATH_MODEL  *small  = NULL;
+  P7_OPROFILE *om;
+  int          nsmall = 0;
+  int          njobs  = 0;
+  int          i, idx;
+  int          status;
+
+  ESL_ALLOC(jobs,  sizeof(BATH_JOB) * ESL_MAX(1, query->cnt));
+  ESL_ALLOC(small, sizeof(BATH_MODEL) * ESL_MAX(1, query->cnt));
+
+  for (i = 0; i < query->cnt; i++) {
+    idx = query->inx + i;
+    om  = db->hmm_db->list[idx];
+    if (om->M <= BATH_PACK_MAXM) { small[nsmall].idx = idx; small[nsmall].M = om->M; nsmall++; continue; }
+
+    job = &jobs[njobs++];
+    job->n      = 1;
+    job->idx[0] = idx;
+    job->pack   = NULL;
+    job->cost   = hmmpgmd_BathCost(om, query->seq->n);
+  }
+
+  qsort(small, nsmall, sizeof(BATH_MODEL), bath_model_sorter);
+
+  for (i = 0; i < nsmall; i++) {
+    om = db->hmm_db->list[small[i].idx];
+    if (job == NULL || job->pack == NULL || p7_msvpack_Add(job->pack, om) != eslOK) {
+      if (job != NULL && job->pack != NULL && job->n == 1) { p7_msvpack_Destroy(job->pack); job->pack = NULL; }
+
+      job = &jobs[njobs++];
+      job->n    = 0;
+      job->cost = 0.;
+      if ((job->pack = p7_msvpack_Create(BATH_PACK_Q, db->bath_db->abcAA)) == NULL) LOG_FATAL_MSG("malloc", errno);
+      if (p7_msvpack_Add(job->pack, om) != eslOK) LOG_FATAL_MSG("msvpack", 0);
+    }
+    job->idx[job->n++] = small[i].idx;
+    job->cost         += hmmpgmd_BathCost(om, query->seq->n);
+  }
+  if (job != NULL && job->pack != NULL && job->n == 1) { p7_msvpack_Destroy(job->pack); job->pack = NULL; }
+
+  qsort(jobs, njobs, sizeof(BATH_JOB), bath_job_sorter);
+
+  free(small);
+  *ret_jobs = jobs;
+  return njobs;
+
+ ERROR:
+  LOG_FATAL_MSG("malloc", errno);
+}
+
+typedef struct {
+  WORKER_ENV   *env;
+  HMMD_COMMAND *cmd;             /* our own copy of the INIT command */
+} RELOAD_ARGS;
+
+static void *
+reload_thread(void *arg)
+{
+  RELOAD_ARGS *args = (RELOAD_ARGS *) arg;
 
-  /* write back to the master that we are on line */
+  worker_db_Swap(args->env, worker_db_Load(args->cmd, args->env->bath));
+  printf("Data generation %u loaded into memory.\n", args->cmd->init.db_version);
+  fflush(stdout);
+  free(args->cmd);
+  free(args);
+  return NULL;
+}
+
+/* process_InitCmd()
+ * The first INIT loads the databases before anything else happens,
+ * and the reply tells the master this worker is ready. A later one,
+ * for a new generation (a master's !reload), starts loading it on a
+ * background thread while this one goes on serving searches; the
+ * master asks again until the reply has the new generation. Either
+ * way the reply is the INIT command <cmd> echoed back, with the
+ * generation of this worker's newest loaded databases.
+ */
+static void
+process_InitCmd(HMMD_COMMAND *cmd, WORKER_ENV  *env)
+{
+  RELOAD_ARGS *args    = NULL;
+  uint32_t     version = cmd->init.db_version;
+  int          n;
+
+  if (env->db == NULL) {
+    worker_db_Swap(env, worker_db_Load(cmd, env->bath));
+
+    /* if stdout is redirected at the commandline, it causes printf's to be buffered,
+     * which means status logging isn't printed. This line strongly requests unbuffering,
+     * which should be ok, given the low stdout load of hmmpgmd
+     */
+    setvbuf (stdout, NULL, _IONBF, BUFSIZ);
+    printf("Data loaded into memory. Worker is ready.\n");
+    setvbuf (stdout, NULL, _IOFBF, BUFSIZ);
+  }
+
+  /* a finished reload */
+  if (env->loading != 0 && worker_db_Version(env) == env->loading) {
+    pthread_join(env->loader, NULL);
+    env->loading = 0;
+  }
+
+  if (version != worker_db_Version(env) && version != env->loading) {
+    /* one reload at a time */
+    if (env->loading != 0) {
+      pthread_join(env->loader, NULL);
+      env->loading = 0;
+    }
+
+    n = MSG_SIZE(cmd);
+    if ((args = malloc(sizeof(RELOAD_ARGS))) == NULL) LOG_FATAL_MSG("malloc", errno);
+    if ((args->cmd = malloc(n))             == NULL) LOG_FATAL_MSG("malloc", errno);
+    memcpy(args->cmd, cmd, n);
+    args->env = env;
+
+    if ((n = pthread_create(&env->loader, NULL, reload_thread, args)) != 0) LOG_FATAL_MSG("pthread_create", n);
+    env->loading = version;
+    printf("Reloading data generation %u in the background.\n", version);
+    fflush(stdout);
+  }
+
+  /* write back to the master which generation we are on line with */
   n = MSG_SIZE(cmd);
-  cmd->hdr.status = eslOK;
+  cmd->hdr.status       = eslOK;
+  cmd->init.db_version  = worker_db_Version(env);
   if (writen(env->fd, cmd, n) != n) {
     LOG_FATAL_MSG("write error", errno);
   }
@@ -992,6 +1444,184 @@ scan_thread_translated(void *arg)
   return;
 }
 
+/* scan_thread_bath()
+ * A --bath scan. The DNA query is translated once per strand, then
+ * the thread takes jobs off <info->jobs> one at a time, largest
+ * predicted cost first, and runs each model through p7_Pipeline_BATH()
+ * with its resident BATH profiles, on both strands as bathsearch
+ * searches a window. For a pack of small models, the ORFs' MSV scores
+ * come from one packed pass first, and a strand with no ORF passing a
+ * model's MSV threshold only gets the accounting p7_Pipeline_BATH()
+ * would have done for it. Each model's hits get their P-values for the
+ * whole query before they join the thread's hit list.
+ */
+static void
+scan_thread_bath(void *arg)
+{
+  int                    workeridx;
+  int                    inx;
+  int                    idx;
+  int                    j, b, s;
+  int64_t                nres;
+  BATH_JOB              *job;
+  ESL_SQ_BLOCK          *orfs[2];             /* ORFs of each strand                 */
+  int                   *pass = NULL;         /* packed MSV result [b*n+j]           */
+  int                    msv[2][p7O_NLANEB];  /* TRUE if model j passes on strand s  */
+  WORKER_INFO           *info;
+  ESL_THREADS           *obj;
+  BATH_LIB              *lib;
+  P7_OPROFILE           *om;
+
+  ESL_STOPWATCH         *w;
+
+  P7_BG                 *bg   = NULL;         /* null model                          */
+  P7_PIPELINE           *pli  = NULL;         /* work pipeline                       */
+  P7_TOPHITS            *th   = NULL;         /* top hit results                     */
+  P7_TOPHITS            *mth  = NULL;         /* one model's hits                    */
+  ESL_SQ                *fwd  = NULL;         /* our copy of the query ...           */
+  ESL_SQ                *rev  = NULL;         /* ... and of its reverse complement   */
+  ESL_GENCODE_WORKSTATE *wrkT = NULL;         /* ORFs of the top strand              */
+  ESL_GENCODE_WORKSTATE *wrkB = NULL;         /* ORFs of the bottom strand           */
+  ESL_GENCODE_WORKSTATE *wrk2 = NULL;         /* work space for p7_Pipeline_BATH()   */
+
+  obj = (ESL_THREADS *) arg;
+  esl_threads_Started(obj, &workeridx);
+
+  info = (WORKER_INFO *) esl_threads_GetData(obj, workeridx);
+  lib  = info->bath_db;
+
+  w = esl_stopwatch_Create();
+  esl_stopwatch_Start(w);
+
+  /* Create processing pipeline and hit list */
+  th  = p7_tophits_Create();
+  mth = p7_tophits_Create();
+  pli = p7_pipeline_fs_Create(info->opts, 100, 300, FALSE, p7_SCAN_MODELS); /* L_hint = 300 is just a dummy; bathsearch-only options take defaults */
+
+  /* strands as for --hmmscant: --watson is the top strand only, --crick the bottom only */
+  if      (esl_opt_GetBoolean(info->opts, "--crick"))  pli->strands = p7_STRAND_BOTTOMONLY;
+  else if (esl_opt_GetBoolean(info->opts, "--watson")) pli->strands = p7_STRAND_TOPONLY;
+  else                                                 pli->strands = p7_STRAND_BOTH;
+  nres = info->seq->n * (pli->strands == p7_STRAND_BOTH ? 2 : 1);
+
+  if (lib != NULL && info->om_cnt > 0) {
+    bg   = p7_bg_fs_Create(lib->abcAA);
+    wrkT = esl_gencode_WorkstateCreate(info->opts, lib->gcode);
+    wrkB = esl_gencode_WorkstateCreate(info->opts, lib->gcode);
+    wrk2 = esl_gencode_WorkstateCreate(info->opts, lib->gcode);
+    wrkT->orf_block = esl_sq_CreateDigitalBlock(1024, lib->abcAA);
+    wrkB->orf_block = esl_sq_CreateDigitalBlock(1024, lib->abcAA);
+    wrk2->orf_block = esl_sq_CreateDigitalBlock(1024, lib->abcAA);
+
+    /* the whole query is one window */
+    fwd = esl_sq_CreateDigital(info->abc);
+    esl_sq_Copy(info->seq, fwd);
+    fwd->idx   = 0;
+    fwd->start = 1;
+    fwd->end   = fwd->n;
+    fwd->C     = 0;
+    fwd->W     = fwd->n;
+    fwd->L     = fwd->n;
+    if (p7_pli_MaskTarget(pli, lib->gcode, fwd) != eslOK) p7_Fail("target masking failed in hmmdwrkr.c");
+
+    rev = esl_sq_CreateDigital(info->abc);
+    esl_sq_Copy(fwd, rev);
+    esl_sq_ReverseComplement(rev);
+
+    /* the ORFs are the same for every model */
+    if (pli->strands != p7_STRAND_BOTTOMONLY) {
+      esl_gencode_ProcessStart(lib->gcode, wrkT, fwd);
+      esl_gencode_ProcessPiece(lib->gcode, wrkT, fwd);
+      esl_gencode_ProcessEnd(wrkT, fwd);
+    }
+    if (pli->strands != p7_STRAND_TOPONLY) {
+      esl_gencode_ProcessStart(lib->gcode, wrkB, rev);
+      esl_gencode_ProcessPiece(lib->gcode, wrkB, rev);
+      esl_gencode_ProcessEnd(wrkB, rev);
+    }
+
+    orfs[0] = wrkT->orf_block;
+    orfs[1] = wrkB->orf_block;
+    if ((pass = malloc(sizeof(int) * p7O_NLANEB * ESL_MAX(1, ESL_MAX(orfs[0]->count, orfs[1]->count)))) == NULL) LOG_FATAL_MSG("malloc", errno);
+  }
+
+  /* loop until all models have been processed */
+  while (TRUE) {
+    /* grab the next model */
+    if (pthread_mutex_lock(info->inx_mutex) != 0) p7_Fail("mutex lock failed");
+    inx = (*info->inx)++;
+    if (pthread_mutex_unlock(info->inx_mutex) != 0) p7_Fail("mutex unlock failed");
+    if (inx >= info->om_cnt) break;
+
+    job = &(info->jobs[inx]);
+
+    /* packed MSV stage: which models does any ORF of each strand pass? */
+    for (s = 0; s < 2; s++)
+      for (j = 0; j < job->n; j++) msv[s][j] = TRUE;
+    if (job->pack != NULL && pli->seeds == NULL) {
+      for (s = 0; s < 2; s++) {
+        if (s == 0 && pli->strands == p7_STRAND_BOTTOMONLY) continue;
+        if (s == 1 && pli->strands == p7_STRAND_TOPONLY)    continue;
+
+        p7_pli_BATH_MSVPacked(pli, orfs[s], job->pack, bg, pass);
+        for (j = 0; j < job->n; j++) {
+          msv[s][j] = FALSE;
+          for (b = 0; b < orfs[s]->count && ! msv[s][j]; b++) msv[s][j] = pass[b * job->n + j];
+        }
+      }
+    }
+
+    for (j = 0; j < job->n; j++) {
+      idx = job->idx[j];
+      om  = info->om_list[idx];
+
+      p7_pli_NewModel(pli, om, bg);
+
+      if (pli->strands != p7_STRAND_BOTTOMONLY) {
+        if (msv[0][j]) {
+          p7_Pipeline_BATH(pli, om, lib->gm[idx], lib->gm_fs[idx], lib->scoredata[idx], bg, mth, fwd->idx, fwd, wrkT->orf_block, wrk2, lib->gcode, p7_NOCOMPLEMENT);
+          p7_pipeline_fs_Reuse(pli);
+        } else p7_pli_BATH_MSVSkip(pli, om, fwd, wrkT->orf_block);
+      }
+      if (pli->strands != p7_STRAND_TOPONLY) {
+        if (msv[1][j]) {
+          p7_Pipeline_BATH(pli, om, lib->gm[idx], lib->gm_fs[idx], lib->scoredata[idx], bg, mth, rev->idx, rev, wrkB->orf_block, wrk2, lib->gcode, p7_COMPLEMENT);
+          p7_pipeline_fs_Reuse(pli);
+        } else p7_pli_BATH_MSVSkip(pli, om, rev, wrkB->orf_block);
+      }
+
+      /* P-values for the whole query, with this model's window length */
+      p7_tophits_ComputeBATHEvalues(mth, nres, om->max_length);
+      p7_tophits_Merge(th, mth);
+      p7_tophits_Reuse(mth);
+    }
+  }
+
+  /* make the pipeline objects available to the main thread */
+  info->th  = th;
+  info->pli = pli;
+
+  /* clean up */
+  if (wrkT) { esl_sq_DestroyBlock(wrkT->orf_block); wrkT->orf_block = NULL; esl_gencode_WorkstateDestroy(wrkT); }
+  if (wrkB) { esl_sq_DestroyBlock(wrkB->orf_block); wrkB->orf_block = NULL; esl_gencode_WorkstateDestroy(wrkB); }
+  if (wrk2) { esl_sq_DestroyBlock(wrk2->orf_block); wrk2->orf_block = NULL; esl_gencode_WorkstateDestroy(wrk2); }
+  if (fwd)  esl_sq_Destroy(fwd);
+  if (rev)  esl_sq_Destroy(rev);
+  if (bg)   p7_bg_Destroy(bg);
+  if (pass) free(pass);
+  p7_tophits_Destroy(mth);
+
+  esl_stopwatch_Stop(w);
+  info->elapsed = w->elapsed;
+
+  esl_stopwatch_Destroy(w);
+
+  esl_threads_Finished(obj, workeridx);
+
+  pthread_exit(NULL);
+  return;
+}
+
 static void
 send_results(int fd, ESL_STOPWATCH *w, P7_TOPHITS *th, P7_PIPELINE *pli)
 {
@@ -1105,10 +1735,211 @@ setup_masterside_comm(ESL_GETOPTS *opts)
     }
   }
 
-  return fd;    
+  return fd;
 }
 
-#endif /*HMMER_THREADS*/
 
 
+/*****************************************************************
+ * Unit tests
+ *****************************************************************/
+#ifdef p7HMMDWRKR_TESTDRIVE
+
+/* A generation with no databases behind it, holding env's reference. */
+static WORKER_DB *
+utest_db(uint32_t version)
+{
+  WORKER_DB *db = NULL;
+
+  if ((db = malloc(sizeof(WORKER_DB))) == NULL) esl_fatal("malloc failed");
+  db->version = version;
+  db->seq_db  = NULL;
+  db->hmm_db  = NULL;
+  db->bath_db = NULL;
+  db->refs    = 1;
+  return db;
+}
+
+/* Walk the generations through reloads as the master's searches move
+ * from one to the next: a search can acquire the newest or the
+ * previous generation, not an older one or one not yet loaded; the
+ * first search of the newest drops the previous; a swap drops the
+ * generation before the previous, but a search still running on it
+ * keeps it open until its release.
+ */
+static void
+utest_generations(void)
+{
+  char       *msg = "hmmdwrkr generations unit test failed";
+  WORKER_ENV  env;
+  WORKER_DB  *db1, *db2, *db3, *db4;
+  WORKER_DB  *s1, *s2;
+
+  env.db      = NULL;
+  env.old     = NULL;
+  env.loading = 0;
+  if (pthread_mutex_init(&env.db_mutex, NULL) != 0) esl_fatal(msg);
+
+  if (worker_db_Version(&env)    != 0)    esl_fatal(msg);
+  if (worker_db_Acquire(&env, 1) != NULL) esl_fatal(msg);
+
+  db1 = utest_db(1);
+  worker_db_Swap(&env, db1);
+  if (worker_db_Version(&env) != 1)              esl_fatal(msg);
+  if (env.db != db1 || env.old != NULL)          esl_fatal(msg);
+  if ((s1 = worker_db_Acquire(&env, 1)) != db1)  esl_fatal(msg);
+  if (db1->refs != 2)                            esl_fatal(msg);
+
+  /* reload: generation 1 stays searchable until a search of 2 arrives */
+  db2 = utest_db(2);
+  worker_db_Swap(&env, db2);
+  if (worker_db_Version(&env) != 2)              esl_fatal(msg);
+  if (env.db != db2 || env.old != db1)           esl_fatal(msg);
+  if (worker_db_Acquire(&env, 3) != NULL)        esl_fatal(msg);
+  if (worker_db_Acquire(&env, 1) != db1)         esl_fatal(msg);
+  if (db1->refs != 3)                            esl_fatal(msg);
+  worker_db_Release(&env, db1);
+
+  if ((s2 = worker_db_Acquire(&env, 2)) != db2)  esl_fatal(msg);
+  if (env.old != NULL)                           esl_fatal(msg);
+  if (db1->refs != 1)                            esl_fatal(msg);   /* only s1's now */
+  if (worker_db_Acquire(&env, 1) != NULL)        esl_fatal(msg);
+  worker_db_Release(&env, s1);                                     /* closes generation 1 */
+
+  /* two reloads with no search between: the first keeps 2 as the
+   * previous generation, the second drops it, but s2 still holds it */
+  db3 = utest_db(3);
+  worker_db_Swap(&env, db3);
+  if (env.db != db3 || env.old != db2)           esl_fatal(msg);
+  db4 = utest_db(4);
+  worker_db_Swap(&env, db4);
+  if (env.db != db4 || env.old != db3)           esl_fatal(msg);
+  if (db2->refs != 1)                            esl_fatal(msg);
+  if (worker_db_Acquire(&env, 2) != NULL)        esl_fatal(msg);
+  if (s2->version != 2)                          esl_fatal(msg);
+  worker_db_Release(&env, s2);                                     /* closes generation 2 */
+
+  if (worker_db_Acquire(&env, 3) != db3)         esl_fatal(msg);
+  worker_db_Release(&env, db3);
+  if (db3->refs != 1 || db4->refs != 1)          esl_fatal(msg);
+
+  worker_db_Release(&env, NULL);
+  worker_db_Release(&env, env.old);
+  worker_db_Release(&env, env.db);
+  pthread_mutex_destroy(&env.db_mutex);
+}
+
+typedef struct {
+  WORKER_ENV *env;
+  int         n;             /* acquire/release cycles to run   */
+  int         nfound;        /* how many acquired a generation  */
+} UTEST_SEARCHER;
+
+/* A stream of searches, each of the newest generation or the one before. */
+static void *
+utest_searcher(void *arg)
+{
+  UTEST_SEARCHER *u = (UTEST_SEARCHER *) arg;
+  WORKER_DB      *db;
+  uint32_t        version;
+  int             i;
+
+  for (i = 0; i < u->n; i++)
+    {
+      version = worker_db_Version(u->env);
+      if (i % 3 == 0 && version > 1) version--;
+      if ((db = worker_db_Acquire(u->env, version)) == NULL) continue;   /* swapped out from under us: the master would resend */
+      if (db->version != version) esl_fatal("hmmdwrkr threaded generations unit test failed");
+      u->nfound++;
+      worker_db_Release(u->env, db);
+    }
+  return NULL;
+}
+
+/* Searcher threads acquire and release generations while the main
+ * thread swaps in new ones. Every acquired generation must be the one
+ * asked for (and, under valgrind, still open); at the end only env's
+ * own references remain.
+ */
+static void
+utest_threads(int nthreads, int ngen)
+{
+  char           *msg = "hmmdwrkr threaded generations unit test failed";
+  WORKER_ENV      env;
+  pthread_t      *tid = NULL;
+  UTEST_SEARCHER *u   = NULL;
+  int             i, g;
+
+  env.db      = NULL;
+  env.old     = NULL;
+  env.loading = 0;
+  if (pthread_mutex_init(&env.db_mutex, NULL) != 0) esl_fatal(msg);
+  worker_db_Swap(&env, utest_db(1));
+
+  if ((tid = malloc(sizeof(pthread_t)      * nthreads)) == NULL) esl_fatal(msg);
+  if ((u   = malloc(sizeof(UTEST_SEARCHER) * nthreads)) == NULL) esl_fatal(msg);
+  for (i = 0; i < nthreads; i++)
+    {
+      u[i].env    = &env;
+      u[i].n      = 10000;
+      u[i].nfound = 0;
+      if (pthread_create(&tid[i], NULL, utest_searcher, &u[i]) != 0) esl_fatal(msg);
+    }
+  for (g = 2; g <= ngen; g++)
+    worker_db_Swap(&env, utest_db(g));
+  for (i = 0; i < nthreads; i++)
+    {
+      if (pthread_join(tid[i], NULL) != 0) esl_fatal(msg);
+      if (u[i].nfound == 0)                esl_fatal(msg);
+    }
+
+  if (worker_db_Version(&env) != ngen)        esl_fatal(msg);
+  if (env.db->refs != 1)                      esl_fatal(msg);
+  if (env.old != NULL && env.old->refs != 1)  esl_fatal(msg);
+
+  worker_db_Release(&env, env.old);
+  worker_db_Release(&env, env.db);
+  pthread_mutex_destroy(&env.db_mutex);
+  free(u);
+  free(tid);
+}
+#endif /*p7HMMDWRKR_TESTDRIVE*/
+
+
+/*****************************************************************
+ * Test driver
+ *****************************************************************/
+#ifdef p7HMMDWRKR_TESTDRIVE
+/*
+  gcc -o hmmdwrkr_utest -g -Wall -pthread -I. -L. -I../easel -L../easel -Dp7HMMDWRKR_TESTDRIVE hmmdwrkr.c -lhmmer -leasel -lm
+  ./hmmdwrkr_utest
+ */
+static ESL_OPTIONS options[] = {
+  /* name  type         default  env   range togs  reqs  incomp  help                          docgrp */
+  { "-h",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show help and usage",              0 },
+  { "-n",  eslARG_INT,      "4",  NULL, "n>0",NULL, NULL, NULL, "number of searcher threads",       0 },
+  { "-g",  eslARG_INT,   "1000",  NULL, "n>1",NULL, NULL, NULL, "number of generations to swap in", 0 },
+  { 0,0,0,0,0,0,0,0,0,0},
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for hmmdwrkr.c";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS *go = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+
+  utest_generations();
+  utest_threads(esl_opt_GetInteger(go, "-n"), esl_opt_GetInteger(go, "-g"));
+
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7HMMDWRKR_TESTDRIVE*/
+/*---------------------- end, test driver ----------------------*/
+
+#endif /*HMMER_THREADS*/
 
+#if defined(p7HMMDWRKR_TESTDRIVE) && ! defined(HMMER_THREADS)
+int main(void) { return 0; }   /* the worker needs threads; there's nothing to test without them */
+#endif
@@ -84,6 +84,9 @@ enum p7_offsets_e  { p7_MOFFSET = 0, p7_FOFFSET = 1, p7_POFFSET = 2 };
 #define p7_ALL_CONSENSUS_COLS  (1<<1)
 #define p7_TRIM                (1<<2)
 
+/* Output formats for p7_tophits_StreamAlignment() */
+enum p7_streamali_e { p7_STREAMALI_STOCKHOLM = 0, p7_STREAMALI_A2M = 1, p7_STREAMALI_PSIBLAST = 2 };
+
 /* Option flags when creating faux traces with p7_trace_FauxFromMSA() */
 #define p7_MSA_COORDS         (1<<0) /* default: i = unaligned seq residue coords     */
 
@@ -524,6 +527,8 @@ enum p7_hmmfile_formats_e {
   p7_BATH_3f    = 7,
 };
 
+typedef struct p7_hmmbulk_s P7_HMMBULK;  /* opaque; see p7_hmmfile_SetParallel() */
+
 typedef struct p7_hmmfile_s {
   FILE         *f;     /* pointer to stream for reading models                 */
   char         *fname;           /* (fully qualified) name of the HMM file; [STDIN] if - */
@@ -545,6 +550,7 @@ typedef struct p7_hmmfile_s {
 #ifdef HMMER_THREADS
   int              syncRead;
   pthread_mutex_t  readMutex;
+  P7_HMMBULK      *bulk;        /* non-NULL: records parsed in parallel from a mapped copy of <fname> */
 #endif
 
   char          errbuf[eslERRBUFSIZE];
@@ -786,6 +792,39 @@ typedef struct p7_dom_s {
   P7_TRACE      *tr;  /*used by bathsearch when --fstblout flag is used */
 } P7_DOMAIN;
 
+/* Structure: P7_DPOCC
+ *
+ * Instrumentation for frameshift-aware domain definition (bathsearch
+ * --dpocc): aggregate statistics on how much of each envelope's M x L
+ * posterior decoding matrix carries posterior mass, and how far that
+ * mass spreads from the optimal accuracy alignment's diagonal. Used to
+ * choose banded/sparse DP settings from data. Filled by
+ * <p7_dpocc_Collect()> when a <P7_DOMAINDEF> has one attached.
+ */
+#define p7_DPOCC_NTHRESH    4      /* number of occupancy thresholds (see p7_dpocc.c)        */
+#define p7_DPOCC_BANDTHRESH 0.01   /* a cell is "in the band" if its posterior is >= this   */
+#define p7_DPOCC_NBAND      200    /* band half-width histogram bins 0..NBAND-1, + overflow */
+#define p7_DPOCC_GRIDI      64     /* heatmap columns: relative position along envelope     */
+#define p7_DPOCC_GRIDK      65     /* heatmap rows: model offset from diagonal -32..32      */
+
+typedef struct p7_dpocc_s {
+  int          sample_every;                   /* collect one of every <sample_every> envelopes          */
+  int64_t      nseen;                          /* envelopes offered to p7_dpocc_Collect()                */
+  int64_t      nsampled;                       /* envelopes actually collected                           */
+  double       ncells;                         /* M x L core cells in the sampled envelopes              */
+  double       mass;                           /* total M+I posterior mass in those cells                */
+  double       nabove[p7_DPOCC_NTHRESH];       /* # of cells with posterior >= each threshold            */
+  int64_t      nrows;                          /* envelope rows covered by the OA alignment              */
+  int64_t      bandhist[p7_DPOCC_NBAND+1];     /* per-row band half-width (model positions); last=overflow */
+  int          maxband;                        /* largest half-width seen                                */
+  ESL_DMATRIX *heat;                           /* p7_DPOCC_GRIDK x p7_DPOCC_GRIDI summed posterior mass  */
+
+  int         *diag;                           /* workspace: OA diagonal k for each row 1..L            */
+  int          diag_alloc;
+} P7_DPOCC;
+
+typedef struct p7_fs_wavepool_s P7_FS_WAVEPOOL;  /* opaque; see p7_fs_wavepool_Create() */
+
 /* Structure: P7_DOMAINDEF
  * 
  * This is a container for all the necessary information for domain
@@ -845,6 +884,11 @@ typedef struct p7_domaindef_s {
 
   /* flags */
   int fstbl;     /* True if --fstblout flag in on for bathsearch */
+  int fwd_ncpu;  /* threads for wavefront Forward on large envelopes (--fwd_cpu); <2 = serial only */
+  P7_FS_WAVEPOOL *fwd_pool; /* those threads, started once with the ddef; NULL if fwd_ncpu < 2 */
+
+  /* instrumentation */
+  P7_DPOCC *occ; /* if non-NULL, posterior occupancy statistics are collected here (bathsearch --dpocc); not owned */
 
 } P7_DOMAINDEF;
 
@@ -861,6 +905,35 @@ typedef struct p7_domaindef_s {
 #define p7_IS_DUPLICATE     (1<<4)
 
 
+/* Structure: P7_HITARENA
+ *
+ * Block storage for the strings and domain lists of the hits in one
+ * P7_TOPHITS, freed all at once; target name/acc/desc are interned
+ * by sequence index so all hits on a target share one copy.
+ */
+typedef struct p7_hitarena_tgt_s {
+  int64_t seqidx;
+  char   *name;     /* NULL for an empty slot */
+  char   *acc;
+  char   *desc;
+} P7_HITARENA_TGT;
+
+typedef struct p7_hitarena_s {
+  char   **blk;         /* memory blocks; the last is the current one        */
+  int      nblk;
+  int      nblkalloc;
+  size_t   blksize;     /* default block size                                */
+  size_t   used;        /* bytes used in the current block                   */
+  size_t   curr;        /* size of the current block                         */
+  size_t   nbytes;      /* total bytes handed out                            */
+
+  P7_HITARENA_TGT *tgt; /* open-addressed intern table, keyed by seqidx      */
+  int      ntgt;        /* number of targets interned                        */
+  int      ntgtalloc;   /* table size; a power of 2                          */
+  int64_t  nintern;     /* number of lookups that reused an interned target  */
+} P7_HITARENA;
+
+
 /* Structure: P7_HIT
  * 
  * Info about a high-scoring database hit, kept so we can output a
@@ -898,12 +971,14 @@ typedef struct p7_hit_s {
   int      nincluded;  /* # of domains satisfying inclusion thresholding */
   int      best_domain;  /* index of best-scoring domain in dcl */
   int      frameshift;
+  int      ct;           /* NCBI translation table of a translated hit, when several were searched; else 0 */
   int64_t  seqidx;          /*unique identifier to track the database sequence from which this hit came*/
   int64_t  subseq_start; /*used to track which subsequence of a full_length target this hit came from, for purposes of removing duplicates */
   int64_t  target_len;   /* used in translated search to hold the length of the nucleotide sequence */
 
   P7_DOMAIN *dcl;  /* domain coordinate list and alignment display */
   esl_pos_t  offset;  /* used in socket communications, in serialized communication: offset of P7_DOMAIN msg for this P7_HIT */
+  int        in_arena; /* TRUE if name/acc/desc/orfid and dcl live in the P7_TOPHITS arena, not malloc()'ed */
 } P7_HIT;
 
 
@@ -920,6 +995,7 @@ typedef struct p7_tophits_s {
   uint64_t nincluded;  /* number of hits that are includable       */
   int      is_sorted_by_sortkey; /* TRUE when hits sorted by sortkey and th->hit valid for all N hits */
   int      is_sorted_by_seqidx; /* TRUE when hits sorted by seq_idx, position, and th->hit valid for all N hits */
+  P7_HITARENA *arena;   /* storage for hits with in_arena set; NULL until first used */
 } P7_TOPHITS;
 
 
@@ -1342,6 +1418,111 @@ enum p7_pipemodes_e { p7_SEARCH_SEQS = 0, p7_SCAN_MODELS = 1 };
 enum p7_zsetby_e    { p7_ZSETBY_NTARGETS = 0, p7_ZSETBY_OPTION = 1, p7_ZSETBY_FILEINFO = 2 };
 enum p7_complementarity_e { p7_NOCOMPLEMENT    = 0, p7_COMPLEMENT   = 1 };
 
+/* Targets up to this long (reads, small contigs) are prefiltered in
+ * bulk by p7_Pipeline_BATH_Batch(), with no per-target allocation.
+ */
+#define p7_SHORTREAD_MAXLEN  2000
+
+/* P7_HMMCLUSTERS: redundancy clusters of a profile library (bathcluster; bathsearch --clusters).
+ * Models are indexed in library order; each cluster's representative
+ * is one of its members.
+ */
+#define p7_HMMCLUSTER_K       3      /* consensus word length, in residues                          */
+#define p7_HMMCLUSTER_THRESH  0.5    /* default single-linkage threshold on shared-word fraction    */
+#define p7_HMMCLUSTER_FRELAX  10.0   /* representative's F1, F2 are this many times the members'    */
+
+typedef struct p7_hmmclusters_s {
+  char        **name;     /* model names, name[0..nmodel-1]                        */
+  int          *assign;   /* assign[i]: cluster of model i, 0..nclust-1            */
+  int          *W;        /* W[i]: window length (max_length) of model i, or -1    */
+  int           nmodel;
+  int           nalloc;
+  int          *rep;      /* rep[c]:  index of the representative of cluster c     */
+  int          *size;     /* size[c]: number of models in cluster c                */
+  int          *maxW;     /* maxW[c]: largest window length in cluster c           */
+  int           nclust;
+  int           cnalloc;
+  ESL_KEYHASH  *kh;       /* model name -> index                                   */
+} P7_HMMCLUSTERS;
+
+/* P7_TMASK: low-complexity spans of one target DNA sequence (bathsearch --tmask).
+ * Spans are inclusive, 1..L top-strand coords of the full sequence;
+ * after p7_tmask_Finalize() they are sorted and nonoverlapping.
+ */
+#define p7_TMASK_DUSTW       64     /* dust window, in nucleotides                          */
+#define p7_TMASK_DUSTLEVEL   20.0   /* dust score threshold (x10, as dustmasker's -level)   */
+#define p7_TMASK_SEGW        12     /* SEG window, in amino acids                           */
+#define p7_TMASK_SEGK1       2.2    /* SEG trigger complexity, bits                         */
+#define p7_TMASK_SEGK2       2.5    /* SEG extension complexity, bits                       */
+#define p7_TMASK_ORFFRAC     0.5    /* ORFs at least this fraction masked are not searched  */
+
+typedef struct {
+  int64_t beg;
+  int64_t end;
+} P7_TMASK_SEG;
+
+typedef struct p7_tmask_s {
+  char         *name;     /* name of the target sequence                */
+  P7_TMASK_SEG *seg;      /* masked spans, seg[0..nseg-1]               */
+  int           nseg;
+  int           nalloc;
+} P7_TMASK;
+
+/* P7_TMASKDB: precomputed masks for a whole target database, read from BED */
+typedef struct p7_tmaskdb_s {
+  P7_TMASK    **mask;     /* mask[0..nmask-1], indexed by <kh>          */
+  int           nmask;
+  int           nalloc;
+  ESL_KEYHASH  *kh;       /* sequence name -> index in <mask>           */
+} P7_TMASKDB;
+
+/* P7_PERFCTR: hardware performance counters per pipeline stage (bathsearch --perfctr).
+ * One collector per pipeline; counters are opened in, and count only, the thread that uses it.
+ */
+enum p7_perfstage_e { p7_PERF_FILTERS = 0, p7_PERF_FORWARD = 1, p7_PERF_DOMAINDEF = 2, p7_PERF_ALIGN = 3 };
+#define p7_PERF_NSTAGES 4
+enum p7_perfevent_e { p7_PERF_CYCLES = 0, p7_PERF_INSTR = 1, p7_PERF_L1DMISS = 2, p7_PERF_LLCMISS = 3, p7_PERF_BRMISS = 4 };
+#define p7_PERF_NEVENTS 5
+
+typedef struct p7_perfctr_s {
+  int       fd[p7_PERF_NEVENTS];       /* perf event fds; fd[0] leads the group; -1 if not open */
+  uint64_t  id[p7_PERF_NEVENTS];       /* kernel ids, to match group read values to events    */
+  int       is_open;                   /* TRUE once an open has been attempted                 */
+  int       is_avail;                  /* TRUE if counters are working                         */
+  char      errmsg[eslERRBUFSIZE];     /* why counters are unavailable, if they are            */
+  int       stage;                     /* stage being counted, or -1                           */
+  uint64_t  start[p7_PERF_NEVENTS];    /* counter values at p7_perfctr_Start()                 */
+
+  uint64_t  count[p7_PERF_NSTAGES][p7_PERF_NEVENTS]; /* accumulated event counts             */
+  int64_t   ncalls[p7_PERF_NSTAGES];   /* number of Start/Stop pairs                           */
+  int64_t   cells[p7_PERF_NSTAGES];    /* DP cells (L*M) computed                              */
+  int       nthread;                   /* number of counting threads merged in                 */
+} P7_PERFCTR;
+
+/* P7_SEEDINDEX: amino acid k-mer seeds of one or more profiles (bathsearch --kseed).
+ * An open-addressed hash from word code to the profiles it seeds.
+ */
+#define p7_SEED_K           5      /* default word length, residues                      */
+#define p7_SEED_T           10.0   /* default word score threshold, bits                 */
+#define p7_SEED_MAXK        6      /* longest word; 20^6 codes still fit a uint32_t      */
+#define p7_SEED_MAXPERPOS   64     /* at most this many words per model diagonal         */
+
+typedef struct p7_seedindex_s {
+  int        k;        /* word length                                        */
+  float      T;        /* word score threshold, bits                         */
+  int        K;        /* alphabet size; words are base-K codes              */
+  uint32_t   kpow1;    /* K^(k-1), for the rolling word code                 */
+  int        nmodel;   /* number of profiles indexed                         */
+  uint32_t  *key;      /* key[0..hsize-1]: word code, or 0xffffffff if empty */
+  int64_t   *off;      /* off[h]: first of slot h's profiles in <mdl>        */
+  int       *cnt;      /* cnt[h]: number of profiles seeded by word key[h]   */
+  uint32_t   hsize;    /* hash table size, a power of 2                      */
+  int       *mdl;      /* profile lists, mdl[0..npairs-1]                    */
+  int64_t    nwords;   /* distinct seed words                                */
+  int64_t    npairs;   /* distinct (word, profile) pairs                     */
+  int64_t   *nseed;    /* nseed[m]: number of seed words of profile m        */
+} P7_SEEDINDEX;
+
 typedef struct p7_pipeline_s {
   /* Dynamic programming matrices                                           */
   P7_OMX     *oxf;    /* one-row Forward matrix, accel pipe       */
@@ -1393,6 +1574,18 @@ typedef struct p7_pipeline_s {
   int     do_biasfilter;  /* TRUE to use biased comp HMM filter       */
   int     do_null2;    /* TRUE to use null2 score corrections      */
 
+  /* Target masking (bathsearch --tmask)                                   */
+  int            do_tmask;    /* TRUE to mask low-complexity target DNA   */
+  P7_TMASKDB    *tmaskdb;     /* precomputed masks, or NULL to compute on the fly; not owned */
+  P7_TMASK      *tmask;       /* workspace for on-the-fly masks           */
+  ESL_STOPWATCH *tmask_w;     /* times on-the-fly masking                 */
+
+  /* Seed prefilter (bathsearch --kseed)                                   */
+  P7_SEEDINDEX  *seeds;       /* ORFs with no seed word skip MSV; or NULL; not owned */
+
+  /* Hardware counters (bathsearch --perfctr)                              */
+  P7_PERFCTR    *perf;        /* per-stage counts for this thread, or NULL */
+
   /* Accounting. (reduceable in threaded/MPI parallel version)              */
   uint64_t      nmodels;        /* # of HMMs searched                       */
   uint64_t      nseqs;          /* # of sequences searched                  */
@@ -1408,6 +1601,10 @@ typedef struct p7_pipeline_s {
   uint64_t      pos_past_vit;  /* # positions that pass ViterbiFilter()  (used for nhmmer) */
   uint64_t      pos_past_fwd;  /* # positions that pass ForwardFilter()  (used for nhmmer) */
   uint64_t      pos_output;      /* # positions that make it to the final output (used for nhmmer) */
+  uint64_t      tmask_nres;      /* # target residues masked (bathsearch --tmask) */
+  uint64_t      tmask_norfs;     /* # ORFs skipped as mostly masked               */
+  double        tmask_time;      /* wall clock seconds spent computing masks      */
+  uint64_t      seed_norfs;      /* # ORFs with no seed hit, not sent to MSV      */
 
   enum p7_pipemodes_e mode;     /* p7_SCAN_MODELS | p7_SEARCH_SEQS          */
   int           long_targets;   /* TRUE if the target sequences are expected to be very long (e.g. dna chromosome search in nhmmer) */
@@ -1430,6 +1627,40 @@ typedef struct p7_pipeline_s {
   char          errbuf[eslERRBUFSIZE];
 } P7_PIPELINE;
 
+/* P7_BATHSEARCH: one query's translated search of DNA handed over in
+ * memory (p7_bathsearch.c), for programs that link libhmmer.
+ */
+#define p7_BATHSEARCH_BLOCK     (1024 * 256) /* default window length, as bathsearch reads   */
+#define p7_BATHSEARCH_ORFBLOCK  1000         /* ORFs per translation block                   */
+
+typedef int (*p7_BATHSEARCH_HITFUNC)(const P7_HIT *hit, void *arg);
+
+typedef struct p7_bathsearch_s {
+  ESL_GETOPTS           *go;        /* search options                                     */
+  ESL_ALPHABET          *abcDNA;
+  ESL_ALPHABET          *abcAA;
+  ESL_GENCODE           *gcode;     /* for translating targets                            */
+  ESL_GENCODE_WORKSTATE *wrk1;      /* translation of target windows to ORFs              */
+  ESL_GENCODE_WORKSTATE *wrk2;      /* translation of DNA windows for the bias filter     */
+  P7_BG                 *bg;
+  P7_PROFILE            *gm;
+  P7_FS_PROFILE         *gm_fs;
+  P7_OPROFILE           *om;
+  P7_SCOREDATA          *scoredata;
+  P7_PIPELINE           *pli;
+  P7_TOPHITS            *th;
+
+  ESL_SQ                *win;       /* current window of the current target               */
+  int64_t                tidx;      /* index of the current target; -1 if none is open    */
+  int64_t                tL;        /* residues of the current target so far              */
+  int                    tfirst;    /* first of the current target's hits in th->unsrt    */
+  int64_t                ntargets;  /* targets started so far                             */
+
+  p7_BATHSEARCH_HITFUNC  hitfunc;   /* called with each new hit, or NULL                  */
+  void                  *hitarg;
+  char                   errbuf[eslERRBUFSIZE];
+} P7_BATHSEARCH;
+
 
 /*****************************************************************
  * 17. P7_BUILDER: pipeline for new HMM construction
@@ -1545,6 +1776,15 @@ extern int p7_ForwardParser_Frameshift     (const ESL_DSQ *dsq, const ESL_GENCOD
 extern int p7_Backward_Frameshift    (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *ret_sc);
 extern int p7_BackwardParser_Frameshift    (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *ret_sc);
 
+/* fwdback_frameshift_wavefront.c */
+extern int p7_ForwardAuto_Frameshift       (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, P7_FS_WAVEPOOL *pool, float *ret_sc);
+extern int p7_BackwardAuto_Frameshift      (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *ret_sc);
+extern int p7_Forward_Frameshift_Wavefront (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, P7_FS_WAVEPOOL *pool, float *ret_sc);
+extern int p7_Forward_Frameshift_Tiled     (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *ret_sc);
+extern int p7_Backward_Frameshift_Tiled    (const ESL_DSQ *dsq, const ESL_GENCODE *gcode, int L, const P7_FS_PROFILE *gm_fs, P7_GMX *gx, float *ret_sc);
+extern P7_FS_WAVEPOOL *p7_fs_wavepool_Create(int ncpu);
+extern void            p7_fs_wavepool_Destroy(P7_FS_WAVEPOOL *pool);
+
 
 /* generic_msv.c */
 extern int p7_GMSV           (const ESL_DSQ *dsq, int L, const P7_PROFILE *gm, P7_GMX *gx, float nu, float *ret_sc);
@@ -1677,6 +1917,12 @@ extern int p7_tracealign_MSA (const ESL_MSA *premsa, P7_TRACE **tr,           in
 extern int p7_tracealign_computeTraces(P7_HMM *hmm, ESL_SQ  **sq, int offset, int N, P7_TRACE  **tr);
 extern int p7_tracealign_getMSAandStats(P7_HMM *hmm, ESL_SQ  **sq, int N, ESL_MSA **ret_msa, float **ret_pp, float **ret_relent, float **ret_scores );
 
+/* p7_alloctrack.c */
+extern int  p7_alloctrack_Enable(void);
+extern void p7_alloctrack_Enter (int stage);
+extern void p7_alloctrack_Leave (int stage);
+extern int  p7_alloctrack_Report(FILE *ofp);
+
 /* p7_alidisplay.c */
 extern P7_ALIDISPLAY *p7_alidisplay_Create(const P7_TRACE *tr, int which, const P7_OPROFILE *om, const ESL_SQ *sq, const ESL_SQ *ntsq);
 extern P7_ALIDISPLAY *p7_alidisplay_fs_Create(const P7_TRACE *tr, int which, const P7_PROFILE *gm, const P7_FS_PROFILE *gm_fs, const ESL_SQ *sq, const ESL_GENCODE *gcode);
@@ -1724,6 +1970,16 @@ extern int    p7_bg_FilterScore(P7_BG *bg, const ESL_DSQ *dsq, int L, float *ret
 extern int    p7_bg_fs_FilterScore(P7_BG *bg, ESL_SQ *dnasq, ESL_GENCODE_WORKSTATE *wrk, ESL_GENCODE *gcode, int do_biasfilter, float *ret_sc);
 extern int      p7_bg_fs_Forward(const ESL_DSQ *dsq, int L, const ESL_GENCODE *gcode, const ESL_HMM *hmm, ESL_HMX *fwd, float *opt_sc);
 
+/* p7_bathsearch.c */
+extern int   p7_bathsearch_Create        (P7_HMM *hmm, const char *opts, P7_BATHSEARCH **ret_bs, char *errbuf);
+extern int   p7_bathsearch_SetHitCallback(P7_BATHSEARCH *bs, p7_BATHSEARCH_HITFUNC hitfunc, void *arg);
+extern int   p7_bathsearch_Reuse         (P7_BATHSEARCH *bs);
+extern void  p7_bathsearch_Destroy       (P7_BATHSEARCH *bs);
+extern int   p7_bathsearch_TargetBegin   (P7_BATHSEARCH *bs, const char *name);
+extern int   p7_bathsearch_Feed          (P7_BATHSEARCH *bs, const char *seq, int64_t n);
+extern int   p7_bathsearch_TargetEnd     (P7_BATHSEARCH *bs);
+extern int   p7_bathsearch_Finish        (P7_BATHSEARCH *bs, P7_TOPHITS **opt_th);
+
 /* p7_builder.c */
 extern P7_BUILDER *p7_builder_Create(const ESL_GETOPTS *go, const ESL_ALPHABET *abc);
 extern int         p7_builder_LoadScoreSystem(P7_BUILDER *bld, const char *matrix,                  double popen, double pextend, P7_BG *bg);
@@ -1744,7 +2000,7 @@ extern int p7_domain_Compare(P7_DOMAIN *first, P7_DOMAIN *second, double atol, d
 
 /* p7_domaindef.c */
 extern P7_DOMAINDEF *p7_domaindef_Create (ESL_RANDOMNESS *r);
-extern P7_DOMAINDEF *p7_domaindef_fs_Create (ESL_RANDOMNESS *r, ESL_GETOPTS *go);
+extern P7_DOMAINDEF *p7_domaindef_fs_Create (ESL_RANDOMNESS *r, int fstbl, int fwd_ncpu);
 extern int           p7_domaindef_Fetch  (P7_DOMAINDEF *ddef, int which, int *opt_i, int *opt_j, float *opt_sc, P7_ALIDISPLAY **opt_ad);
 extern int           p7_domaindef_GrowTo (P7_DOMAINDEF *ddef, int L);
 extern int           p7_domaindef_Reuse  (P7_DOMAINDEF *ddef);
@@ -1761,6 +2017,15 @@ extern int p7_domaindef_ByPosteriorHeuristics_Frameshift(ESL_SQ *windowsq,
                 P7_BG *bg, ESL_GENCODE *gcode, int64_t window_start, int do_biasfilter);
 extern int p7_domaindef_ByPosteriorHeuristics_nonFrameshift(const ESL_SQ *orfsq, const ESL_SQ *sq, const int64_t ntsqlen, const ESL_GENCODE *gcode, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS_PROFILE *gm_fs, P7_OMX *tmp_fwd, P7_OMX *fwd, P7_OMX *bck, P7_DOMAINDEF *ddef, P7_BG *bg);
 
+/* p7_dpocc.c */
+extern P7_DPOCC *p7_dpocc_Create   (int sample_every);
+extern int       p7_dpocc_Reuse    (P7_DPOCC *occ);
+extern void      p7_dpocc_Destroy  (P7_DPOCC *occ);
+extern int       p7_dpocc_Collect  (P7_DPOCC *occ, const P7_GMX *pp, const P7_TRACE *tr);
+extern int       p7_dpocc_Merge    (P7_DPOCC *occ1, const P7_DPOCC *occ2);
+extern int       p7_dpocc_WriteJSON(FILE *fp, const P7_DPOCC *occ, const char *qname, int M);
+extern int       p7_dpocc_Heatmap  (FILE *fp, const P7_DPOCC *occ);
+
 /* p7_gmx.c */
 extern P7_GMX *p7_gmx_Create (int allocM, int allocL);
 extern int     p7_gmx_GrowTo (P7_GMX *gx, int allocM, int allocL);
@@ -1788,6 +2053,16 @@ extern int p7_hit_Deserialize(const uint8_t *buf, uint32_t *n, P7_HIT *ret_obj);
 extern int p7_hit_TestSample(ESL_RAND64 *rng, P7_HIT **ret_obj);
 extern int p7_hit_Compare(P7_HIT *first, P7_HIT *second, double atol, double rtol);
 
+/* p7_hitarena.c */
+extern P7_HITARENA *p7_hitarena_Create(size_t blksize);
+extern int          p7_hitarena_Reuse(P7_HITARENA *ar);
+extern void         p7_hitarena_Destroy(P7_HITARENA *ar);
+extern int          p7_hitarena_Absorb(P7_HITARENA *ar, P7_HITARENA *ar2);
+extern void        *p7_hitarena_Alloc(P7_HITARENA *ar, size_t n);
+extern int          p7_hitarena_Strdup(P7_HITARENA *ar, const char *s, int64_t n, char **ret_s);
+extern int          p7_hitarena_InternTarget(P7_HITARENA *ar, int64_t seqidx, const char *name, const char *acc, const char *desc,
+                                             char **ret_name, char **ret_acc, char **ret_desc);
+
 
 /* p7_hmm.c */
 /*      1. The P7_HMM object: allocation, initialization, destruction. */
@@ -1826,6 +2101,16 @@ extern int     p7_hmm_CalculateOccupancy(const P7_HMM *hmm, float *mocc, float *
 
 
 
+/* p7_hmmcluster.c */
+extern P7_HMMCLUSTERS *p7_hmmclusters_Create    (void);
+extern int             p7_hmmclusters_Add       (P7_HMMCLUSTERS *hc, const char *name, int W, int c, int is_rep);
+extern int             p7_hmmclusters_Lookup    (const P7_HMMCLUSTERS *hc, const char *name, int *ret_c);
+extern void            p7_hmmclusters_Destroy   (P7_HMMCLUSTERS *hc);
+extern float           p7_hmmclusters_Similarity(const P7_HMM *hmm1, const P7_HMM *hmm2);
+extern int             p7_hmmclusters_Build     (P7_HMM **hmm, int nhmm, float thresh, P7_HMMCLUSTERS **ret_hc);
+extern int             p7_hmmclusters_Write     (FILE *fp, const P7_HMMCLUSTERS *hc);
+extern int             p7_hmmclusters_Read      (const char *mapfile, P7_HMMCLUSTERS **ret_hc, char *errbuf);
+
 /* p7_hmmfile.c */
 extern int  p7_hmmfile_OpenE    (const char *filename, char *env, P7_HMMFILE **ret_hfp, char *errbuf);
 extern int  p7_hmmfile_OpenENoDB(const char *filename, char *env, P7_HMMFILE **ret_hfp, char *errbuf);
@@ -1842,6 +2127,7 @@ extern int  p7_hmmfile_WriteToString (char **s, int format, P7_HMM *hmm);
 extern int  p7_hmmfile_Read(P7_HMMFILE *hfp, ESL_ALPHABET **ret_abc,  P7_HMM **opt_hmm);
 extern int  p7_hmmfile_PositionByKey(P7_HMMFILE *hfp, const char *key);
 extern int  p7_hmmfile_Position(P7_HMMFILE *hfp, const off_t offset);
+extern int  p7_hmmfile_SetParallel(P7_HMMFILE *hfp, int ncpu);
 
 
 /* p7_hmmwindow.c */
@@ -1849,6 +2135,10 @@ extern int p7_hmmwindow_init (P7_HMM_WINDOWLIST *list);
 extern P7_HMM_WINDOW *p7_hmmwindow_new (P7_HMM_WINDOWLIST *list, uint32_t id, uint32_t pos, uint32_t fm_pos, uint16_t k, uint32_t length, float score, uint8_t complementarity, uint32_t target_len);
 extern int p7_hmmwindow_SortByStart(P7_HMM_WINDOWLIST *w);
 
+/* p7_lengthdist.c */
+extern int p7_lengthdist_MaxLength    (const P7_HMM *hmm, double emit_thresh, int *ret_maxl);
+extern int p7_lengthdist_WindowLengths(const float *t_mi, const float *t_ii, int M, double beta, float *prefix, float *suffix);
+
 /* p7_msvdata.c */
 extern P7_SCOREDATA   *p7_hmm_ScoreDataCreate(P7_OPROFILE *om, P7_PROFILE *gm );
 extern P7_SCOREDATA   *p7_hmm_ScoreDataClone(P7_SCOREDATA *src, int K);
@@ -1863,12 +2153,21 @@ extern P7_HMM_WINDOW *p7_hmm_newWindow (P7_HMM_WINDOWLIST *list, uint32_t id, ui
 extern void p7_null3_score(const ESL_ALPHABET *abc, const ESL_DSQ *dsq, P7_TRACE *tr, int start, int stop, P7_BG *bg, float *ret_sc);
 extern void p7_null3_windowed_score(const ESL_ALPHABET *abc, const ESL_DSQ *dsq, int start, int stop, P7_BG *bg, float *ret_sc);
 
+/* p7_perfctr.c */
+extern P7_PERFCTR *p7_perfctr_Create (void);
+extern int         p7_perfctr_Reuse  (P7_PERFCTR *pc);
+extern void        p7_perfctr_Destroy(P7_PERFCTR *pc);
+extern int         p7_perfctr_Start  (P7_PERFCTR *pc, int stage);
+extern int         p7_perfctr_Stop   (P7_PERFCTR *pc, int stage, int64_t ncells);
+extern int         p7_perfctr_Merge  (P7_PERFCTR *pc1, const P7_PERFCTR *pc2);
+extern int         p7_perfctr_Report (FILE *ofp, const P7_PERFCTR *pc);
+
 /* p7_pipeline.c */
 extern P7_PIPELINE *p7_pipeline_Create(const ESL_GETOPTS *go, int M_hint, int L_hint, int long_targets, enum p7_pipemodes_e mode);
 extern int          p7_pipeline_Reuse  (P7_PIPELINE *pli);
 extern void         p7_pipeline_Destroy(P7_PIPELINE *pli);
 extern int          p7_pipeline_Merge  (P7_PIPELINE *p1, P7_PIPELINE *p2);
-extern P7_PIPELINE* p7_pipeline_fs_Create(ESL_GETOPTS *go, int M_hint, int L_hint, enum p7_pipemodes_e mode);
+extern P7_PIPELINE* p7_pipeline_fs_Create(ESL_GETOPTS *go, int M_hint, int L_hint, int bath_opts, enum p7_pipemodes_e mode);
 extern int          p7_pipeline_fs_Reuse  (P7_PIPELINE *pli);
 extern void         p7_pipeline_fs_Destroy(P7_PIPELINE *pli);
 
@@ -1892,6 +2191,13 @@ extern int p7_Pipeline_BATH   (P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm
              P7_BG *bg, P7_TOPHITS *hitlist, int64_t seqidx, ESL_SQ *dnasq, 
              ESL_SQ_BLOCK *orf_block, ESL_GENCODE_WORKSTATE *wrk, ESL_GENCODE *gcode, int complementarity);
 
+extern int p7_Pipeline_BATH_Batch(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS_PROFILE *gm_fs, P7_SCOREDATA *data, P7_BG *bg, P7_TOPHITS *hitlist,
+             ESL_SQ_BLOCK *dnablock, ESL_GENCODE_WORKSTATE *wrk1, ESL_GENCODE_WORKSTATE *wrk2, ESL_GENCODE *gcode);
+
+extern int p7_pli_MaskTarget(P7_PIPELINE *pli, const ESL_GENCODE *gcode, ESL_SQ *sq);
+extern int p7_pli_BATH_Prescreen(P7_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, ESL_SQ *dnasq, ESL_GENCODE_WORKSTATE *wrk, ESL_GENCODE *gcode, int *ret_pass);
+extern int p7_pli_BATH_MSVPacked(P7_PIPELINE *pli, const ESL_SQ_BLOCK *orf_block, P7_MSVPACK *mp, P7_BG *bg, int *pass);
+extern int p7_pli_BATH_MSVSkip(P7_PIPELINE *pli, const P7_OPROFILE *om, const ESL_SQ *dnasq, const ESL_SQ_BLOCK *orf_block);
 extern int p7_pli_Statistics(FILE *ofp, P7_PIPELINE *pli, ESL_STOPWATCH *w);
 
 
@@ -1925,6 +2231,12 @@ extern int         p7_profile_GetT(const P7_PROFILE *gm, char st1, int k1,
 extern int         p7_profile_Validate(const P7_PROFILE *gm, char *errbuf, float tol);
 extern int         p7_profile_Compare(P7_PROFILE *gm1, P7_PROFILE *gm2, float tol);
 
+/* p7_seedindex.c */
+extern int  p7_seedindex_Build  (P7_PROFILE **gm, int nmodel, int k, float T, P7_SEEDINDEX **ret_si);
+extern void p7_seedindex_Destroy(P7_SEEDINDEX *si);
+extern int  p7_seedindex_Hit    (const P7_SEEDINDEX *si, const ESL_DSQ *dsq, int64_t L);
+extern int  p7_seedindex_Scan   (const P7_SEEDINDEX *si, const ESL_DSQ *dsq, int64_t L, int *hit, int *opt_nhit);
+
 /* p7_spensemble.c */
 P7_SPENSEMBLE *p7_spensemble_Create(int init_n, int init_epc, int init_sigc);
 extern int     p7_spensemble_Reuse(P7_SPENSEMBLE *sp);
@@ -1953,6 +2265,9 @@ extern int         p7_tophits_Add(P7_TOPHITS *h,
           int hmmfrom, int hmmto, int hmmlen, 
           int domidx, int ndom,
           P7_ALIDISPLAY *ali);
+extern int         p7_tophits_HitAllocDomains(P7_TOPHITS *h, P7_HIT *hit, int ndom);
+extern int         p7_tophits_HitInternTarget(P7_TOPHITS *h, P7_HIT *hit, const char *name, const char *acc, const char *desc);
+extern int         p7_tophits_HitSetStrings(P7_TOPHITS *h, P7_HIT *hit, const char *name, const char *acc, const char *desc);
 extern int         p7_tophits_SortBySortkey(P7_TOPHITS *h);
 extern int         p7_tophits_SortBySeqidxAndAlipos(P7_TOPHITS *h);
 extern int         p7_tophits_SortByModelnameAndAlipos(P7_TOPHITS *h);
@@ -1978,6 +2293,7 @@ extern int p7_tophits_Domains(FILE *ofp, P7_TOPHITS *th, P7_PIPELINE *pli, int t
 extern int p7_tophits_Alignment(const P7_TOPHITS *th, const ESL_ALPHABET *abc, 
         ESL_SQ **inc_sqarr, P7_TRACE **inc_trarr, int inc_n, int optflags,
         ESL_MSA **ret_msa);
+extern int p7_tophits_StreamAlignment(FILE *ofp, const char *qname, const P7_TOPHITS *th, int M, int fmt, int matchonly);
 extern int p7_tophits_TabularTargets(FILE *ofp, char *qname, char *qacc, P7_TOPHITS *th, P7_PIPELINE *pli, int show_header);
 extern int p7_tophits_TabularDomains(FILE *ofp, char *qname, char *qacc, P7_TOPHITS *th, P7_PIPELINE *pli, int show_header);
 extern int p7_tophits_TabularXfam(FILE *ofp, char *qname, char *qacc, P7_TOPHITS *th, P7_PIPELINE *pli);
@@ -1986,6 +2302,24 @@ extern int p7_tophits_TabularTail(FILE *ofp, const char *progname, enum p7_pipem
 extern int p7_tophits_AliScores(FILE *ofp, char *qname, P7_TOPHITS *th );
 extern int p7_tophits_TabularFrameshifts(FILE *ofp, char *qname, char *qacc, P7_TOPHITS *th, P7_PIPELINE *pli, int show_header);
 
+/* p7_tmask.c */
+extern P7_TMASK   *p7_tmask_Create   (void);
+extern int         p7_tmask_SetName  (P7_TMASK *tm, const char *name);
+extern int         p7_tmask_Add      (P7_TMASK *tm, int64_t beg, int64_t end);
+extern int         p7_tmask_Finalize (P7_TMASK *tm);
+extern int         p7_tmask_Reuse    (P7_TMASK *tm);
+extern void        p7_tmask_Destroy  (P7_TMASK *tm);
+extern int         p7_tmask_Dust     (P7_TMASK *tm, const ESL_ALPHABET *abc, const ESL_DSQ *dsq, int64_t L, int64_t offset, int W, double level);
+extern int         p7_tmask_Seg      (P7_TMASK *tm, const ESL_GENCODE *gcode, const ESL_DSQ *dsq, int64_t L, int64_t offset, int W, double k1, double k2);
+extern int         p7_tmask_Apply    (const P7_TMASK *tm, ESL_SQ *sq, int64_t *opt_nmasked);
+extern int64_t     p7_tmask_Count    (const P7_TMASK *tm, int64_t lo, int64_t hi);
+extern float       p7_tmask_MaskedFraction(const ESL_SQ *sq);
+extern int         p7_tmask_WriteBED (FILE *fp, const P7_TMASK *tm);
+extern P7_TMASKDB *p7_tmaskdb_Create (void);
+extern P7_TMASK   *p7_tmaskdb_Get    (const P7_TMASKDB *db, const char *name);
+extern int         p7_tmaskdb_Read   (const char *bedfile, P7_TMASKDB **ret_db, char *errbuf);
+extern void        p7_tmaskdb_Destroy(P7_TMASKDB *db);
+
 /* p7_trace.c */
 extern P7_TRACE *p7_trace_Create(void);
 extern P7_TRACE *p7_trace_CreateWithPP(void);
@@ -34,6 +34,7 @@ static ESL_OPTIONS cmdlineOpts[] = {
   { "--seqdb",      eslARG_INFILE,  NULL,     NULL, NULL,           NULL,  NULL,  "--worker",      "protein database to cache for searches",                      12 },
   { "--hmmdb",      eslARG_INFILE,  NULL,     NULL, NULL,           NULL,  NULL,  "--worker",      "hmm database to cache for searches",                          12 },
   { "--cpu",        eslARG_INT,  p7_NCPU,"HMMER_NCPU","n>0",        NULL,  NULL,  "--master",      "number of parallel CPU workers to use for multithreads",      12 },
+  { "--bath",       eslARG_NONE,    FALSE,    NULL, NULL,           NULL,  NULL,  "--master",      "keep frameshift (BATH) models of the hmm db resident, for --bath scans", 12 },
   {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
 
   };
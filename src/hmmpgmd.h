@@ -56,6 +56,7 @@ typedef struct {
   uint32_t    query_type;           /* sequence / hmm                           */
   uint32_t    query_length;         /* length of the query data                 */
   uint32_t    opts_length;          /* length of the options string             */
+  uint32_t    db_version;           /* database generation to search            */
   char        data[1];              /* search data                              */
 } HMMD_SEARCH_CMD;
 
@@ -69,6 +70,8 @@ typedef struct {
   uint32_t    seq_cnt;              /* sequences in database                    */
   uint32_t    hmm_cnt;              /* total number hmm databases               */
   uint32_t    model_cnt;            /* models in hmm database                   */
+  uint32_t    db_version;           /* generation to load; in the reply, the    */
+                                    /* worker's newest loaded generation        */
   char        data[1];              /* string data                              */
 } HMMD_INIT_CMD;
 
@@ -129,6 +132,7 @@ typedef struct {
 extern void free_QueueData(QUEUE_DATA *data);
 extern int  hmmpgmd_IsWithinRanges (int64_t sq_idx, RANGE_LIST *list );
 extern int  hmmpgmd_GetRanges (RANGE_LIST *list, char *rangestr);
+extern double hmmpgmd_BathCost  (const P7_OPROFILE *om, int64_t L);
 
 extern int  process_searchopts(int fd, char *cmdstr, ESL_GETOPTS **ret_opts);
 
@@ -144,6 +144,28 @@ typedef struct {
   P7_OPROFILE  **list;        /* array of <P7_OPROFILE> objects               */
 } P7_OM_BLOCK;
 
+/* P7_MSVPACK: several small profiles scored as a group, the portable
+ * counterpart of the SSE pack. Models fill byte lanes the same way
+ * (a model of length M takes (M-1)/Q+1 of 16 lanes), so a pack holds
+ * the same models on every platform, but here each one is scored with
+ * its own p7_MSVFilter().
+ */
+#define p7O_NLANEB 16             /* byte lanes per vector                      */
+
+typedef struct p7_msvpack_s {
+  int          Q;                 /* vectors per row; each lane holds Q positions  */
+  int          Kp;                /* alphabet size, including degeneracies          */
+  int          nmodel;            /* number of packed models                        */
+  int          nlanes;            /* byte lanes used so far, 0..16                  */
+  int          L;                 /* currently configured target length             */
+
+  P7_OPROFILE *om[p7O_NLANEB];    /* packed models (not owned)                      */
+  int          lane0[p7O_NLANEB]; /* first lane of model m                          */
+  int          nl[p7O_NLANEB];    /* lanes taken by model m                         */
+
+  struct p7_omx_s *ox;            /* one-row DP matrix for p7_MSVFilter()           */
+} P7_MSVPACK;
+
 /* retrieve match odds ratio [k][x]
  * this gets used in p7_alidisplay.c, when we're deciding if a residue is conserved or not */
 static inline float
@@ -254,6 +276,7 @@ p7_omx_FSetMDI(const P7_OMX *ox, int s, int i, int k, float val)
 /* p7_omx.c */
 extern P7_OMX      *p7_omx_Create(int allocM, int allocL, int allocXL);
 extern int          p7_omx_GrowTo(P7_OMX *ox, int allocM, int allocL, int allocXL);
+extern int          p7_omx_GrowToCheckpointed(P7_OMX *ox, int allocM, int L);
 extern int          p7_omx_FDeconvert(P7_OMX *ox, P7_GMX *gx);
 extern int          p7_omx_Reuse  (P7_OMX *ox);
 extern void         p7_omx_Destroy(P7_OMX *ox);
@@ -305,6 +328,8 @@ extern int p7_Forward       (const ESL_DSQ *dsq, int L, const P7_OPROFILE *om,
 extern int p7_ForwardParser (const ESL_DSQ *dsq, int L, const P7_OPROFILE *om,                    P7_OMX *fwd, float *opt_sc);
 extern int p7_Backward      (const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, const P7_OMX *fwd, P7_OMX *bck, float *opt_sc);
 extern int p7_BackwardParser(const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, const P7_OMX *fwd, P7_OMX *bck, float *opt_sc);
+extern int p7_ForwardCheckpointed (const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, P7_OMX *fwd, float *opt_sc);
+extern int p7_DecodingCheckpointed(const ESL_DSQ *dsq, const P7_OPROFILE *om, P7_OMX *oxf, P7_OMX *oxb, P7_OMX *pp);
 
 /* io.c */
 extern int p7_oprofile_Write(FILE *ffp, FILE *pfp, P7_OPROFILE *om);
@@ -325,6 +350,15 @@ extern int p7_MSVFilter           (const ESL_DSQ *dsq, int L, const P7_OPROFILE
 extern int p7_SSVFilter_longtarget(const ESL_DSQ *dsq, int L, P7_OPROFILE *om, P7_OMX *ox, const P7_SCOREDATA *msvdata, P7_BG *bg, double P, P7_HMM_WINDOWLIST *windowlist);
 
 
+/* msvpack.c */
+extern P7_MSVPACK *p7_msvpack_Create(int Q, const ESL_ALPHABET *abc);
+extern int         p7_msvpack_Add(P7_MSVPACK *mp, const P7_OPROFILE *om);
+extern int         p7_msvpack_ReconfigLength(P7_MSVPACK *mp, int L);
+extern int         p7_msvpack_Reuse(P7_MSVPACK *mp);
+extern void        p7_msvpack_Destroy(P7_MSVPACK *mp);
+extern int         p7_MSVFilter_packed(const ESL_DSQ *dsq, int L, const P7_MSVPACK *mp, float *sc);
+extern int         p7_MSVFilter_packedBlock(const ESL_SQ_BLOCK *block, P7_MSVPACK *mp, P7_BG *bg, double F1, int *pass, int *opt_npass);
+
 /* null2.c */
 extern int p7_Null2_ByExpectation(const P7_OPROFILE *om, const P7_OMX *pp, float *null2);
 extern int p7_Null2_ByTrace      (const P7_OPROFILE *om, const P7_TRACE *tr, int zstart, int zend, P7_OMX *wrk, float *null2);
@@ -332,6 +366,7 @@ extern int p7_Null2_ByTrace      (const P7_OPROFILE *om, const P7_TRACE *tr, int
 /* optacc.c */
 extern int p7_OptimalAccuracy(const P7_OPROFILE *om, const P7_OMX *pp,       P7_OMX *ox, float *ret_e);
 extern int p7_OATrace        (const P7_OPROFILE *om, const P7_OMX *pp, const P7_OMX *ox, P7_TRACE *tr);
+extern int p7_OATraceCheckpointed(const P7_OPROFILE *om, const P7_OMX *pp, P7_OMX *ox, P7_TRACE *tr);
 
 /* stotrace.c */
 extern int p7_StochasticTrace(ESL_RANDOMNESS *rng, const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, const P7_OMX *ox, P7_TRACE *tr);
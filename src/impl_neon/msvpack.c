@@ -0,0 +1,374 @@
+/* The MSV filter for several small models at once; NEON version.
+ *
+ * The SSE implementation interleaves up to 16 small profiles into one
+ * striped layout and scores them in a single pass. This version
+ * doesn't vectorize across models: it keeps the same P7_MSVPACK
+ * interface and the same lane accounting, so a caller fills packs
+ * identically on every platform, and scores each packed model with
+ * its own p7_MSVFilter(). Per-model scores are p7_MSVFilter()'s.
+ *
+ * Contents:
+ *   1. The P7_MSVPACK object
+ *   2. p7_MSVFilter_packed() implementation
+ *   3. Unit tests
+ *   4. Test driver
+ */
+#include <p7_config.h>
+
+#include <stdio.h>
+#include <math.h>
+
+#include "easel.h"
+#include "esl_gumbel.h"
+#include "esl_sq.h"
+
+#include "hmmer.h"
+#include "impl_neon.h"
+
+
+/*****************************************************************
+ * 1. The P7_MSVPACK object
+ *****************************************************************/
+
+/* Function:  p7_msvpack_Create()
+ * Synopsis:  Create an empty model pack.
+ *
+ * Purpose:   Allocate a pack of <Q> vectors per row for profiles in
+ *            alphabet <abc>. A model of length <M> takes <(M-1)/Q+1>
+ *            of the 16 byte lanes, and the pack holds models until
+ *            their lanes add up to 16, as in the SSE version.
+ *
+ * Returns:   a pointer to the new pack.
+ *
+ * Throws:    <NULL> on allocation failure.
+ */
+P7_MSVPACK *
+p7_msvpack_Create(int Q, const ESL_ALPHABET *abc)
+{
+  P7_MSVPACK *mp = NULL;
+  int         status;
+
+  ESL_ALLOC(mp, sizeof(P7_MSVPACK));
+  mp->ox = NULL;
+  mp->Q  = ESL_MAX(1, Q);
+  mp->Kp = abc->Kp;
+
+  if ((mp->ox = p7_omx_Create(mp->Q * p7O_NLANEB, 0, 0)) == NULL) goto ERROR;
+
+  p7_msvpack_Reuse(mp);
+  return mp;
+
+ ERROR:
+  p7_msvpack_Destroy(mp);
+  return NULL;
+}
+
+/* Function:  p7_msvpack_Add()
+ * Synopsis:  Add one more optimized profile to a pack.
+ *
+ * Purpose:   Add <om> to the next free lanes of <mp>. The pack keeps
+ *            a pointer to <om>, so <om> must stay alive while the
+ *            pack is used. In this version, configuring the pack's
+ *            length sets the MSV length of <om> itself.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslENOSPACE> if <om> doesn't fit in the remaining lanes;
+ *            <mp> is unchanged.
+ *
+ * Throws:    <eslEINVAL> if <om>'s alphabet doesn't match the pack.
+ */
+int
+p7_msvpack_Add(P7_MSVPACK *mp, const P7_OPROFILE *om)
+{
+  int nl = (om->M - 1) / mp->Q + 1;
+  int m  = mp->nmodel;
+
+  if (om->abc->Kp != mp->Kp)               ESL_EXCEPTION(eslEINVAL, "profile alphabet doesn't match the pack");
+  if (mp->nlanes + nl > p7O_NLANEB)        return eslENOSPACE;
+
+  mp->om[m]    = (P7_OPROFILE *) om;  /* its length is ours to set; see p7_msvpack_ReconfigLength() */
+  mp->lane0[m] = mp->nlanes;
+  mp->nl[m]    = nl;
+
+  mp->nlanes += nl;
+  mp->nmodel++;
+  return eslOK;
+}
+
+/* Function:  p7_msvpack_ReconfigLength()
+ * Synopsis:  Set the target length of every model in a pack.
+ *
+ * Purpose:   Call <p7_oprofile_ReconfigMSVLength()> on each packed
+ *            model for target length <L>.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_msvpack_ReconfigLength(P7_MSVPACK *mp, int L)
+{
+  int m;
+
+  for (m = 0; m < mp->nmodel; m++)
+    p7_oprofile_ReconfigMSVLength(mp->om[m], L);
+  mp->L = L;
+  return eslOK;
+}
+
+/* Function:  p7_msvpack_Reuse()
+ * Synopsis:  Empty a pack, keeping its allocation.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_msvpack_Reuse(P7_MSVPACK *mp)
+{
+  mp->nmodel = 0;
+  mp->nlanes = 0;
+  mp->L      = -1;
+  return eslOK;
+}
+
+/* Function:  p7_msvpack_Destroy()
+ * Synopsis:  Free a model pack.
+ */
+void
+p7_msvpack_Destroy(P7_MSVPACK *mp)
+{
+  if (mp == NULL) return;
+  if (mp->ox) p7_omx_Destroy(mp->ox);
+  free(mp);
+}
+/*------------------ end, P7_MSVPACK object ---------------------*/
+
+
+
+/*****************************************************************
+ * 2. p7_MSVFilter_packed() implementation
+ *****************************************************************/
+
+/* Function:  p7_MSVFilter_packed()
+ * Synopsis:  MSV scores of target <dsq> against every model in a pack.
+ *
+ * Purpose:   Calculates the MSV score (in nats) of sequence <dsq> of
+ *            length <L> against each of the <mp->nmodel> packed
+ *            models, and returns them in <sc[0..nmodel-1]> (caller
+ *            provides the space). A model whose score overflows gets
+ *            <sc[m] = eslINFINITY>, as <p7_MSVFilter()> reports with
+ *            <eslERANGE>.
+ *
+ *            The pack must have been configured for length <L> (see
+ *            <p7_msvpack_ReconfigLength()>). Its DP row is
+ *            overwritten, so a pack can't be shared between threads.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_MSVFilter_packed(const ESL_DSQ *dsq, int L, const P7_MSVPACK *mp, float *sc)
+{
+  int m;
+
+  for (m = 0; m < mp->nmodel; m++)
+    p7_MSVFilter(dsq, L, mp->om[m], mp->ox, &(sc[m]));
+  return eslOK;
+}
+
+
+/* Function:  p7_MSVFilter_packedBlock()
+ * Synopsis:  MSV stage for a block of ORFs against every model in a pack.
+ *
+ * Purpose:   For each sequence <b> in <block> (ORFs, in the packed
+ *            models' alphabet) and each packed model <m>, apply the
+ *            MSV stage of the BATH ORF filters: configure the null
+ *            model <bg> and the pack for the ORF's length, score, and
+ *            set <pass[b*mp->nmodel+m]> TRUE if the MSV P-value is
+ *            <= <F1>. Optionally return the number of passing
+ *            (ORF, model) pairs in <*opt_npass>.
+ *
+ *            Caller provides <pass>, of size <block->count *
+ *            mp->nmodel>. <bg>'s length is left set for the last ORF.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_MSVFilter_packedBlock(const ESL_SQ_BLOCK *block, P7_MSVPACK *mp, P7_BG *bg, double F1, int *pass, int *opt_npass)
+{
+  float   sc[p7O_NLANEB];
+  float   nullsc;
+  double  P;
+  ESL_SQ *orfsq;
+  int     npass = 0;
+  int     b, m;
+
+  for (b = 0; b < block->count; b++)
+    {
+      orfsq = &(block->list[b]);
+
+      p7_bg_SetLength(bg, orfsq->n);
+      p7_msvpack_ReconfigLength(mp, orfsq->n);
+      p7_bg_NullOne  (bg, orfsq->dsq, orfsq->n, &nullsc);
+
+      p7_MSVFilter_packed(orfsq->dsq, orfsq->n, mp, sc);
+      for (m = 0; m < mp->nmodel; m++)
+        {
+          P = esl_gumbel_surv((sc[m] - nullsc) / eslCONST_LOG2, mp->om[m]->evparam[p7_MMU], mp->om[m]->evparam[p7_MLAMBDA]);
+          pass[b * mp->nmodel + m] = (P <= F1) ? TRUE : FALSE;
+          if (P <= F1) npass++;
+        }
+    }
+
+  if (opt_npass) *opt_npass = npass;
+  return eslOK;
+}
+/*------------------ end, p7_MSVFilter_packed() -----------------*/
+
+
+
+/*****************************************************************
+ * 3. Unit tests
+ *****************************************************************/
+#ifdef p7MSVPACK_TESTDRIVE
+#include "esl_random.h"
+#include "esl_randomseq.h"
+
+/* Pack models of random lengths 1..maxM into a pack of <Q> vectors
+ * per row until it's full, and check that every packed score is
+ * identical to p7_MSVFilter() on the model alone, for <N> random
+ * sequences of length <L>; then check p7_MSVFilter_packedBlock()
+ * against the same per-model P-value test on a block of them.
+ */
+static void
+utest_packed(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, P7_BG *bg, int Q, int maxM, int L, int N)
+{
+  char          msg[] = "msvpack unit test failed";
+  P7_MSVPACK   *mp    = p7_msvpack_Create(Q, abc);
+  P7_HMM       *hmm[p7O_NLANEB];
+  P7_PROFILE   *gm[p7O_NLANEB];
+  P7_OPROFILE  *om[p7O_NLANEB];
+  P7_OMX       *ox    = p7_omx_Create(maxM, 0, 0);
+  ESL_SQ_BLOCK *block = esl_sq_CreateDigitalBlock(N, abc);
+  ESL_SQ       *sq    = NULL;
+  int          *pass  = malloc(sizeof(int) * N * p7O_NLANEB);
+  float         sc[p7O_NLANEB];
+  float         sc1, nullsc;
+  double        P;
+  int           nmodel = 0;
+  int           npass;
+  int           i, m, M;
+
+  if (mp == NULL || ox == NULL || block == NULL || pass == NULL) esl_fatal(msg);
+
+  while (nmodel < p7O_NLANEB)
+    {
+      M = 1 + esl_rnd_Roll(r, maxM);
+      p7_oprofile_Sample(r, abc, bg, M, L, &hmm[nmodel], &gm[nmodel], &om[nmodel]);
+      if (p7_msvpack_Add(mp, om[nmodel]) != eslOK) break;
+      nmodel++;
+    }
+  if (nmodel < p7O_NLANEB) { p7_hmm_Destroy(hmm[nmodel]); p7_profile_Destroy(gm[nmodel]); p7_oprofile_Destroy(om[nmodel]); }
+  if (nmodel == 0 || mp->nmodel != nmodel) esl_fatal(msg);
+
+  for (i = 0; i < N; i++)
+    {
+      sq = &(block->list[i]);
+      if (esl_sq_GrowTo(sq, L) != eslOK) esl_fatal(msg);
+      esl_rsq_xfIID(r, bg->f, abc->K, L, sq->dsq);
+      sq->n = L;
+      block->count++;
+
+      p7_msvpack_ReconfigLength(mp, L);
+      p7_MSVFilter_packed(sq->dsq, L, mp, sc);
+      for (m = 0; m < nmodel; m++)
+        {
+          p7_oprofile_ReconfigLength(om[m], L);
+          p7_MSVFilter(sq->dsq, L, om[m], ox, &sc1);
+          if (sc1 != sc[m]) esl_fatal("%s: model %d of %d (M=%d): packed %.4f, alone %.4f", msg, m, nmodel, om[m]->M, sc[m], sc1);
+        }
+    }
+
+  if (p7_MSVFilter_packedBlock(block, mp, bg, 0.02, pass, &npass) != eslOK) esl_fatal(msg);
+  for (i = 0; i < N; i++)
+    {
+      sq = &(block->list[i]);
+      p7_bg_SetLength(bg, sq->n);
+      p7_bg_NullOne(bg, sq->dsq, sq->n, &nullsc);
+      for (m = 0; m < nmodel; m++)
+        {
+          p7_oprofile_ReconfigLength(om[m], sq->n);
+          p7_MSVFilter(sq->dsq, sq->n, om[m], ox, &sc1);
+          P = esl_gumbel_surv((sc1 - nullsc) / eslCONST_LOG2, om[m]->evparam[p7_MMU], om[m]->evparam[p7_MLAMBDA]);
+          if ((P <= 0.02) != pass[i*nmodel + m]) esl_fatal("%s: block pass flag differs", msg);
+          if (P <= 0.02) npass--;
+        }
+    }
+  if (npass != 0) esl_fatal("%s: block pass count differs", msg);
+
+  /* a reused pack is empty, and a full model still fits */
+  p7_msvpack_Reuse(mp);
+  if (mp->nmodel != 0 || mp->nlanes != 0)       esl_fatal(msg);
+  if (p7_msvpack_Add(mp, om[0]) != eslOK)        esl_fatal(msg);
+
+  for (m = 0; m < nmodel; m++) { p7_hmm_Destroy(hmm[m]); p7_profile_Destroy(gm[m]); p7_oprofile_Destroy(om[m]); }
+  free(pass);
+  esl_sq_DestroyBlock(block);
+  p7_omx_Destroy(ox);
+  p7_msvpack_Destroy(mp);
+}
+#endif /*p7MSVPACK_TESTDRIVE*/
+/*-------------------- end, unit tests --------------------------*/
+
+
+
+/*****************************************************************
+ * 4. Test driver
+ *****************************************************************/
+#ifdef p7MSVPACK_TESTDRIVE
+/*
+   gcc -g -Wall -std=gnu99 -I.. -L.. -I../../easel -L../../easel -o msvpack_utest -Dp7MSVPACK_TESTDRIVE msvpack.c -lhmmer -leasel -lm
+   ./msvpack_utest
+ */
+#include <p7_config.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+#include "impl_neon.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default  env  range toggles reqs incomp  help                                       docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",           0 },
+  { "-s",        eslARG_INT,     "42", NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                  0 },
+  { "-v",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "be verbose",                                     0 },
+  { "-L",        eslARG_INT,    "200", NULL, NULL,  NULL,  NULL, NULL, "size of random sequences to sample",             0 },
+  { "-N",        eslARG_INT,    "100", NULL, NULL,  NULL,  NULL, NULL, "number of random sequences to sample",           0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for the NEON packed multi-model MSVFilter()";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go   = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r    = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc  = NULL;
+  P7_BG          *bg   = NULL;
+  int             L    = esl_opt_GetInteger(go, "-L");
+  int             N    = esl_opt_GetInteger(go, "-N");
+
+  if ((abc = esl_alphabet_Create(eslAMINO)) == NULL)  esl_fatal("failed to create alphabet");
+  if ((bg = p7_bg_Create(abc))              == NULL)  esl_fatal("failed to create null model");
+
+  if (esl_opt_GetBoolean(go, "-v")) printf("packed MSVFilter() tests, protein\n");
+  utest_packed(r, abc, bg, 2, 20, L, N);   /* many tiny models, down to M=1 */
+  utest_packed(r, abc, bg, 4, 63, L, N);   /* a few models of up to 63      */
+  utest_packed(r, abc, bg, 4, 30, 1, 10);  /* size 1 sequences              */
+
+  esl_alphabet_Destroy(abc);
+  p7_bg_Destroy(bg);
+  esl_getopts_Destroy(go);
+  esl_randomness_Destroy(r);
+  return eslOK;
+}
+#endif /*p7MSVPACK_TESTDRIVE*/
@@ -261,6 +261,18 @@ p7_OATrace(const P7_OPROFILE *om, const P7_OMX *pp, const P7_OMX *ox, P7_TRACE *
   return p7_trace_Reverse(tr);
 }
 
+/* Function:  p7_OATraceCheckpointed()
+ * Synopsis:  Optimal accuracy traceback of a checkpointed OA matrix.
+ *
+ * Purpose:   API-compatible with the SSE implementation; here <ox>
+ *            is always a full OA matrix, so this is <p7_OATrace()>.
+ */
+int
+p7_OATraceCheckpointed(const P7_OPROFILE *om, const P7_OMX *pp, P7_OMX *ox, P7_TRACE *tr)
+{
+  return p7_OATrace(om, pp, ox, tr);
+}
+
 static inline float
 get_postprob(const P7_OMX *pp, int scur, int sprv, int k, int i)
 {
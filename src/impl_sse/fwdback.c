@@ -19,8 +19,15 @@
  * high-probability "regions" are, the first step of identifying the
  * domain structure of a target sequence.
  * 
+ * A third, checkpointed mode keeps only every ~sqrt(L)'th row of the
+ * Forward matrix, plus one segment's worth of rows, in O(M sqrt(L))
+ * memory. Posterior decoding recovers the missing rows one segment
+ * at a time by recalculating them from their checkpoint, which
+ * reproduces the full-matrix values exactly.
+ * 
  * Contents:
- *   1. Forward/Backward wrapper API
+ *   1. Forward/Backward wrapper API, including the checkpointed
+ *      Forward and its posterior decoding
  *   2. Forward and Backward engine implementations
  *   4. Benchmark driver.
  *   5. Unit tests.
@@ -43,8 +50,9 @@
 #include "hmmer.h"
 #include "impl_sse.h"
 
-static int forward_engine (int do_full, const ESL_DSQ *dsq, int L, const P7_OPROFILE *om,                    P7_OMX *fwd, float *opt_sc);
-static int backward_engine(int do_full, const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, const P7_OMX *fwd, P7_OMX *bck, float *opt_sc);
+static int  forward_engine (int do_full, const ESL_DSQ *dsq, int L, const P7_OPROFILE *om,                    P7_OMX *fwd, float *opt_sc);
+static void forward_rows   (int do_full, const ESL_DSQ *dsq, int i1, int i2, const P7_OPROFILE *om,            P7_OMX *fwd);
+static int  backward_engine(int do_full, const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, const P7_OMX *fwd, P7_OMX *bck, float *opt_sc);
 
 
 /*****************************************************************
@@ -248,12 +256,171 @@ p7_BackwardParser(const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, const P7_OMX
 
 
 
+/* Function:  p7_ForwardCheckpointed()
+ * Synopsis:  The Forward algorithm, checkpointed fill version.
+ *
+ * Purpose:   Same as <p7_Forward()>, but into a matrix <ox> that the
+ *            caller has laid out with
+ *            <p7_omx_GrowToCheckpointed(ox, M, L)>, so the fill takes
+ *            $O(M \sqrt{L})$ memory instead of $O(ML)$. Upon return,
+ *            <ox> holds the checkpointed rows, the last segment, and
+ *            all special states and scale factors; that is enough
+ *            for <p7_Backward()>, which only uses the scale factors
+ *            of its <fwd> matrix, and for <p7_DecodingCheckpointed()>,
+ *            which recovers the rest of the rows segment by segment.
+ *
+ *            The Forward score and every cell are identical to the
+ *            ones <p7_Forward()> calculates.
+ *
+ * Args:      dsq     - digital target sequence, 1..L
+ *            L       - length of dsq in residues          
+ *            om      - optimized profile
+ *            ox      - RETURN: checkpointed Forward DP matrix
+ *            opt_sc  - optRETURN: Forward score (in nats)          
+ *
+ * Returns:   <eslOK> on success. 
+ *
+ * Throws:    <eslEINVAL> if <ox> allocation is too small, or if the profile
+ *            isn't in local alignment mode.
+ *            <eslERANGE> if the score exceeds the limited range of
+ *            a probability-space odds ratio.
+ *            In either case, <*opt_sc> is undefined.
+ */
+int
+p7_ForwardCheckpointed(const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, P7_OMX *ox, float *opt_sc)
+{
+#if eslDEBUGLEVEL > 0		
+  if (om->M >  ox->allocQ4*4)    ESL_EXCEPTION(eslEINVAL, "DP matrix allocated too small (too few columns)");
+  if (L     >= ox->validR)       ESL_EXCEPTION(eslEINVAL, "DP matrix allocated too small (too few MDI rows)");
+  if (L     >= ox->allocXR)      ESL_EXCEPTION(eslEINVAL, "DP matrix allocated too small (too few X rows)");
+  if (! p7_oprofile_IsLocal(om)) ESL_EXCEPTION(eslEINVAL, "Forward implementation makes assumptions that only work for local alignment");
+#endif
+
+  return forward_engine(TRUE, dsq, L, om, ox, opt_sc);
+}
+
+
+/* Function:  p7_DecodingCheckpointed()
+ * Synopsis:  Posterior decoding from a checkpointed Forward matrix.
+ *
+ * Purpose:   Same as <p7_Decoding()>, except that <oxf> is a
+ *            checkpointed Forward matrix from
+ *            <p7_ForwardCheckpointed()> on the same <dsq>; each
+ *            segment of Forward rows is recalculated from its
+ *            checkpoint just before it is decoded. The posterior
+ *            probabilities in <pp> are identical to those of
+ *            <p7_Decoding()> on a full Forward matrix. As with
+ *            <p7_Decoding()>, <pp> may be the Backward matrix <oxb>
+ *            itself.
+ *
+ *            If <oxf> isn't checkpointed (<oxf->chkK == 0>), this is
+ *            simply <p7_Decoding()>.
+ *
+ *            <oxf>'s uncheckpointed rows are overwritten; its
+ *            checkpoints, specials and <totscale> are unchanged.
+ *
+ * Args:      dsq  - digital target sequence, 1..L, used to fill <oxf>
+ *            om   - profile (must be the same that was used to fill <oxf>, <oxb>).
+ *            oxf  - checkpointed Forward matrix 
+ *            oxb  - filled Backward matrix
+ *            pp   - RESULT: posterior decoding matrix.
+ *
+ * Returns:   <eslOK> on success.
+ *            
+ *            <eslERANGE> on numeric overflow, as for <p7_Decoding()>;
+ *            <pp> must not be used by the caller in that case.
+ *
+ * Throws:    (no abnormal error conditions)
+ */
+int
+p7_DecodingCheckpointed(const ESL_DSQ *dsq, const P7_OPROFILE *om, P7_OMX *oxf, P7_OMX *oxb, P7_OMX *pp)
+{
+  __m128 *ppv;
+  __m128 *fv;
+  __m128 *bv;
+  __m128  totrv;
+  int    L  = oxf->L;
+  int    K  = oxf->chkK;
+  int    M  = om->M;
+  int    Q  = p7O_NQF(M);	
+  int    i,q;
+  float  scaleproduct = 1.0 / oxb->xmx[p7X_N];
+  float  totscale     = oxf->totscale;
+
+  pp->M = M;
+  pp->L = L;
+
+  ppv = pp->dpf[0];
+  for (q = 0; q < Q; q++) {
+    *ppv = _mm_setzero_ps(); ppv++;
+    *ppv = _mm_setzero_ps(); ppv++;
+    *ppv = _mm_setzero_ps(); ppv++;
+  }
+  pp->xmx[p7X_E] = 0.0;
+  pp->xmx[p7X_N] = 0.0;
+  pp->xmx[p7X_J] = 0.0;
+  pp->xmx[p7X_C] = 0.0;
+  pp->xmx[p7X_B] = 0.0;
+
+  for (i = 1; i <= L; i++)
+    {
+      /* first row of a segment: bring the segment's Forward rows back */
+      if (K > 1 && (i-1) % K == 0) 
+	forward_rows(TRUE, dsq, i, ESL_MIN(i+K-2, L), om, oxf);
+
+      ppv   =  pp->dpf[i];
+      fv    = oxf->dpf[i];
+      bv    = oxb->dpf[i];
+      totrv = _mm_set1_ps(scaleproduct * oxf->xmx[i*p7X_NXCELLS+p7X_SCALE]);
+
+      for (q = 0; q < Q; q++)
+	{
+	  /* M */
+	  *ppv = _mm_mul_ps(*fv,  *bv);
+	  *ppv = _mm_mul_ps(*ppv,  totrv);
+	  ppv++;  fv++;  bv++;
+
+	  /* D */
+	  *ppv = _mm_setzero_ps();
+	  ppv++;  fv++;  bv++;
+
+	  /* I */
+	  *ppv = _mm_mul_ps(*fv,  *bv);
+	  *ppv = _mm_mul_ps(*ppv,  totrv);
+	  ppv++;  fv++;  bv++;
+	}
+      pp->xmx[i*p7X_NXCELLS+p7X_E] = 0.0;
+      pp->xmx[i*p7X_NXCELLS+p7X_N] = oxf->xmx[(i-1)*p7X_NXCELLS+p7X_N] * oxb->xmx[i*p7X_NXCELLS+p7X_N] * om->xf[p7O_N][p7O_LOOP] * scaleproduct;
+      pp->xmx[i*p7X_NXCELLS+p7X_J] = oxf->xmx[(i-1)*p7X_NXCELLS+p7X_J] * oxb->xmx[i*p7X_NXCELLS+p7X_J] * om->xf[p7O_J][p7O_LOOP] * scaleproduct;
+      pp->xmx[i*p7X_NXCELLS+p7X_C] = oxf->xmx[(i-1)*p7X_NXCELLS+p7X_C] * oxb->xmx[i*p7X_NXCELLS+p7X_C] * om->xf[p7O_C][p7O_LOOP] * scaleproduct;
+      pp->xmx[i*p7X_NXCELLS+p7X_B] = 0.0;
+
+      if (oxb->has_own_scales) scaleproduct *= oxf->xmx[i*p7X_NXCELLS+p7X_SCALE] /  oxb->xmx[i*p7X_NXCELLS+p7X_SCALE];
+    }
+  oxf->totscale = totscale;	/* recalculated segments added their scale factors again */
+
+  if (isinf(scaleproduct)) return eslERANGE;
+  else                     return eslOK;
+}
+
+
+
 /*****************************************************************
  * 2. Forward/Backward engine implementations (called thru API)
  *****************************************************************/
 
-static int
-forward_engine(int do_full, const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, P7_OMX *ox, float *opt_sc)
+/* forward_rows()
+ * 
+ * The Forward recursion for rows <i1>..<i2>, starting from row <i1-1>
+ * and its special states, which must already be in <ox>. Called by
+ * <forward_engine()> for rows 1..L, and by
+ * <p7_DecodingCheckpointed()> to recalculate one segment of a
+ * checkpointed matrix; recalculating a segment reproduces the
+ * original values exactly, because row i depends only on row i-1.
+ * Each scaling event adds to <ox->totscale>.
+ */
+static void
+forward_rows(int do_full, const ESL_DSQ *dsq, int i1, int i2, const P7_OPROFILE *om, P7_OMX *ox)
 {
   register __m128 mpv, dpv, ipv;   /* previous row values                                       */
   register __m128 sv;		   /* temp storage of 1 curr row value in progress              */
@@ -262,36 +429,22 @@ forward_engine(int do_full, const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, P7
   register __m128 xBv;		   /* B state: splatted vector of B[i-1] for B->Mk calculations */
   __m128   zerov;		   /* splatted 0.0's in a vector                                */
   float    xN, xE, xB, xC, xJ;	   /* special states' scores                                    */
-  int i;			   /* counter over sequence positions 1..L                      */
+  int i;			   /* counter over sequence positions i1..i2                    */
   int q;			   /* counter over quads 0..nq-1                                */
   int j;			   /* counter over DD iterations (4 is full serialization)      */
   int Q       = p7O_NQF(om->M);	   /* segment length: # of vectors                              */
-  __m128 *dpc = ox->dpf[0];        /* current row, for use in {MDI}MO(dpp,q) access macro       */
+  __m128 *dpc = ox->dpf[do_full * (i1-1)]; /* current row, for use in {MDI}MO(dpp,q) access macro */
   __m128 *dpp;                     /* previous row, for use in {MDI}MO(dpp,q) access macro      */
   __m128 *rp;			   /* will point at om->rfv[x] for residue x[i]                 */
   __m128 *tp;			   /* will point into (and step thru) om->tfv                   */
 
-  /* Initialization. */
-  ox->M  = om->M;
-  ox->L  = L;
-  ox->has_own_scales = TRUE; 	/* all forward matrices control their own scalefactors */
-  zerov  = _mm_setzero_ps();
-  for (q = 0; q < Q; q++)
-    MMO(dpc,q) = IMO(dpc,q) = DMO(dpc,q) = zerov;
-  xE    = ox->xmx[p7X_E] = 0.;
-  xN    = ox->xmx[p7X_N] = 1.;
-  xJ    = ox->xmx[p7X_J] = 0.;
-  xB    = ox->xmx[p7X_B] = om->xf[p7O_N][p7O_MOVE];
-  xC    = ox->xmx[p7X_C] = 0.;
-
-  ox->xmx[p7X_SCALE] = 1.0;
-  ox->totscale       = 0.0;
-
-#if eslDEBUGLEVEL > 0
-  if (ox->debugging) p7_omx_DumpFBRow(ox, TRUE, 0, 9, 5, xE, xN, xJ, xB, xC);	/* logify=TRUE, <rowi>=0, width=8, precision=5*/
-#endif
+  zerov = _mm_setzero_ps();
+  xN    = ox->xmx[(i1-1)*p7X_NXCELLS+p7X_N];
+  xJ    = ox->xmx[(i1-1)*p7X_NXCELLS+p7X_J];
+  xB    = ox->xmx[(i1-1)*p7X_NXCELLS+p7X_B];
+  xC    = ox->xmx[(i1-1)*p7X_NXCELLS+p7X_C];
 
-  for (i = 1; i <= L; i++)
+  for (i = i1; i <= i2; i++)
     {
       dpp   = dpc;                      
       dpc   = ox->dpf[do_full * i];     /* avoid conditional, use do_full as kronecker delta */
@@ -447,7 +600,40 @@ forward_engine(int do_full, const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, P7
 #if eslDEBUGLEVEL > 0
       if (ox->debugging) p7_omx_DumpFBRow(ox, TRUE, i, 9, 5, xE, xN, xJ, xB, xC);	/* logify=TRUE, <rowi>=i, width=8, precision=5*/
 #endif
-    } /* end loop over sequence residues 1..L */
+    } /* end loop over sequence residues i1..i2 */
+}
+
+static int
+forward_engine(int do_full, const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, P7_OMX *ox, float *opt_sc)
+{
+  __m128   zerov;		   /* splatted 0.0's in a vector                                */
+  float    xC;			   /* C state score at row L                                    */
+  int q;			   /* counter over quads 0..nq-1                                */
+  int Q       = p7O_NQF(om->M);	   /* segment length: # of vectors                              */
+  __m128 *dpc = ox->dpf[0];        /* row 0                                                     */
+
+  /* Initialization. */
+  ox->M  = om->M;
+  ox->L  = L;
+  ox->has_own_scales = TRUE; 	/* all forward matrices control their own scalefactors */
+  zerov  = _mm_setzero_ps();
+  for (q = 0; q < Q; q++)
+    MMO(dpc,q) = IMO(dpc,q) = DMO(dpc,q) = zerov;
+  ox->xmx[p7X_E] = 0.;
+  ox->xmx[p7X_N] = 1.;
+  ox->xmx[p7X_J] = 0.;
+  ox->xmx[p7X_B] = om->xf[p7O_N][p7O_MOVE];
+  ox->xmx[p7X_C] = 0.;
+
+  ox->xmx[p7X_SCALE] = 1.0;
+  ox->totscale       = 0.0;
+
+#if eslDEBUGLEVEL > 0
+  if (ox->debugging) p7_omx_DumpFBRow(ox, TRUE, 0, 9, 5, ox->xmx[p7X_E], ox->xmx[p7X_N], ox->xmx[p7X_J], ox->xmx[p7X_B], ox->xmx[p7X_C]);	/* logify=TRUE, <rowi>=0, width=8, precision=5*/
+#endif
+
+  forward_rows(do_full, dsq, 1, L, om, ox);
+  xC = ox->xmx[L*p7X_NXCELLS+p7X_C];
 
   /* finally C->T, and flip total score back to log space (nats) */
   /* On overflow, xC is inf or nan (nan arises because inf*0 = nan). */
@@ -0,0 +1,650 @@
+/* The MSV filter for several small models at once; SSE version.
+ *
+ * For short models the striped MSV filter uses only one or two
+ * vectors per row, and the per-row work outside the inner loop (the
+ * horizontal max for E, the overflow test, the J/B updates) dominates.
+ * A P7_MSVPACK interleaves up to 16 small profiles into one striped
+ * layout, each model taking a contiguous run of byte lanes, so one
+ * pass over the target scores all of them. The horizontal max becomes
+ * a segmented max within each model's lanes, and the diagonal carry
+ * from one model's last position into the next model's first lane is
+ * masked off. Per-model scores are identical to p7_MSVFilter()'s.
+ *
+ * Contents:
+ *   1. The P7_MSVPACK object
+ *   2. p7_MSVFilter_packed() implementation
+ *   3. Benchmark driver
+ *   4. Unit tests
+ *   5. Test driver
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#include <xmmintrin.h>		/* SSE  */
+#include <emmintrin.h>		/* SSE2 */
+
+#include "easel.h"
+#include "esl_gumbel.h"
+#include "esl_sq.h"
+#include "esl_sse.h"
+
+#include "hmmer.h"
+#include "impl_sse.h"
+
+
+/*****************************************************************
+ * 1. The P7_MSVPACK object
+ *****************************************************************/
+
+/* same rounding as p7_oprofile.c's unbiased_byteify() */
+static uint8_t
+unbiased_byteify(float scale_b, float sc)
+{
+  sc = -1.0f * roundf(scale_b * sc);
+  return (sc > 255.) ? 255 : (uint8_t) sc;
+}
+
+/* Function:  p7_msvpack_Create()
+ * Synopsis:  Create an empty model pack.
+ *
+ * Purpose:   Allocate a pack of <Q> vectors per row for profiles in
+ *            alphabet <abc>. Each of the 16 byte lanes holds <Q>
+ *            consecutive model positions, so a model of length <M>
+ *            takes <(M-1)/Q+1> lanes, and the pack holds models
+ *            until their lanes add up to 16. Small <Q> packs more
+ *            models of length <= Q*16/n; pick <Q> from the longest
+ *            model to be packed.
+ *
+ * Returns:   a pointer to the new pack.
+ *
+ * Throws:    <NULL> on allocation failure.
+ */
+P7_MSVPACK *
+p7_msvpack_Create(int Q, const ESL_ALPHABET *abc)
+{
+  P7_MSVPACK *mp = NULL;
+  int         x;
+  int         status;
+
+  ESL_ALLOC(mp, sizeof(P7_MSVPACK));
+  mp->rbv     = NULL;
+  mp->rbv_mem = NULL;
+  mp->dp_mem  = NULL;
+  mp->Q       = ESL_MAX(1, Q);
+  mp->Kp      = abc->Kp;
+
+  ESL_ALLOC(mp->rbv_mem, sizeof(__m128i) * mp->Q * abc->Kp +15); /* +15 is for manual 16-byte alignment */
+  ESL_ALLOC(mp->dp_mem,  sizeof(__m128i) * mp->Q           +15);
+  ESL_ALLOC(mp->rbv,     sizeof(__m128i *) * abc->Kp);
+
+  mp->rbv[0] = (__m128i *) (((unsigned long int) mp->rbv_mem + 15) & (~0xf));
+  mp->dp     = (__m128i *) (((unsigned long int) mp->dp_mem  + 15) & (~0xf));
+  for (x = 1; x < abc->Kp; x++) mp->rbv[x] = mp->rbv[0] + (x * mp->Q);
+
+  p7_msvpack_Reuse(mp);
+  return mp;
+
+ ERROR:
+  p7_msvpack_Destroy(mp);
+  return NULL;
+}
+
+/* Function:  p7_msvpack_Add()
+ * Synopsis:  Interleave one more optimized profile into a pack.
+ *
+ * Purpose:   Copy the MSV match costs of <om> into the next free lanes
+ *            of <mp>. The pack keeps a pointer to <om> for its score
+ *            constants and E-value parameters, so <om> must stay
+ *            alive, and unchanged apart from its length configuration,
+ *            while the pack is used. The pack starts out configured
+ *            for <om>'s current length.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslENOSPACE> if <om> doesn't fit in the remaining lanes;
+ *            <mp> is unchanged.
+ *
+ * Throws:    <eslEINVAL> if <om>'s alphabet doesn't match the pack.
+ */
+int
+p7_msvpack_Add(P7_MSVPACK *mp, const P7_OPROFILE *om)
+{
+  int      Qm = p7O_NQB(om->M);   /* <om>'s own striping */
+  int      nl = (om->M - 1) / mp->Q + 1;
+  int      m  = mp->nmodel;
+  uint8_t *src;
+  uint8_t *dst;
+  int      k, x, z;
+
+  if (om->abc->Kp != mp->Kp)               ESL_EXCEPTION(eslEINVAL, "profile alphabet doesn't match the pack");
+  if (mp->nlanes + nl > p7O_NLANEB)        return eslENOSPACE;
+
+  for (x = 0; x < mp->Kp; x++)
+    {
+      src = (uint8_t *) om->rbv[x];
+      dst = (uint8_t *) mp->rbv[x];
+      for (k = 0; k < om->M; k++)         /* position k+1: om's (q,z) = (k%Qm, k/Qm); ours (k%Q, lane0+k/Q) */
+        dst[(k % mp->Q) * p7O_NLANEB + mp->nlanes + k / mp->Q] = src[(k % Qm) * p7O_NLANEB + k / Qm];
+    }
+
+  mp->om[m]    = om;
+  mp->lane0[m] = mp->nlanes;
+  mp->nl[m]    = nl;
+  mp->tjb_b[m] = om->tjb_b;
+  for (z = mp->nlanes; z < mp->nlanes + nl; z++) mp->lanemodel[z] = m;
+
+  mp->nlanes += nl;
+  mp->nmodel++;
+  return eslOK;
+}
+
+/* Function:  p7_msvpack_ReconfigLength()
+ * Synopsis:  Set the target length of every model in a pack.
+ *
+ * Purpose:   The packed counterpart of calling
+ *            <p7_oprofile_ReconfigMSVLength()> on each model: set the
+ *            NCJ move cost of each model for target length <L>.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_msvpack_ReconfigLength(P7_MSVPACK *mp, int L)
+{
+  int m;
+
+  for (m = 0; m < mp->nmodel; m++)
+    mp->tjb_b[m] = unbiased_byteify(mp->om[m]->scale_b, logf(3.0f / (float) (L+3)));
+  mp->L = L;
+  return eslOK;
+}
+
+/* Function:  p7_msvpack_Reuse()
+ * Synopsis:  Empty a pack, keeping its allocation.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_msvpack_Reuse(P7_MSVPACK *mp)
+{
+  int x, q, z;
+
+  /* unused positions cost 255, so they always score -infinity (0) */
+  for (x = 0; x < mp->Kp; x++)
+    for (q = 0; q < mp->Q; q++)
+      mp->rbv[x][q] = _mm_set1_epi8((int8_t) 255);
+  for (z = 0; z < p7O_NLANEB; z++) mp->lanemodel[z] = 0xff;
+
+  mp->nmodel = 0;
+  mp->nlanes = 0;
+  mp->L      = -1;
+  return eslOK;
+}
+
+/* Function:  p7_msvpack_Destroy()
+ * Synopsis:  Free a model pack.
+ */
+void
+p7_msvpack_Destroy(P7_MSVPACK *mp)
+{
+  if (mp == NULL) return;
+  if (mp->rbv_mem) free(mp->rbv_mem);
+  if (mp->dp_mem)  free(mp->dp_mem);
+  if (mp->rbv)     free(mp->rbv);
+  free(mp);
+}
+/*------------------ end, P7_MSVPACK object ---------------------*/
+
+
+
+/*****************************************************************
+ * 2. p7_MSVFilter_packed() implementation
+ *****************************************************************/
+
+/* Function:  p7_MSVFilter_packed()
+ * Synopsis:  MSV scores of target <dsq> against every model in a pack.
+ *
+ * Purpose:   Calculates the MSV score (in nats) of sequence <dsq> of
+ *            length <L> against each of the <mp->nmodel> packed
+ *            models, in one pass, and returns them in <sc[0..nmodel-1]>
+ *            (caller provides the space). The recurrence, rounding
+ *            and overflow behavior for each model are those of
+ *            <p7_MSVFilter()>: a model whose score overflows the
+ *            limited range gets <sc[m] = eslINFINITY>, which is what
+ *            <p7_MSVFilter()> reports with <eslERANGE>.
+ *
+ *            The pack must have been configured for length <L> (see
+ *            <p7_msvpack_ReconfigLength()>). Its one-row DP matrix is
+ *            overwritten, so a pack can't be shared between threads.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_MSVFilter_packed(const ESL_DSQ *dsq, int L, const P7_MSVPACK *mp, float *sc)
+{
+  register __m128i mpv;            /* previous row values                                       */
+  register __m128i xEv;		   /* E state: keeps max for Mk->E as we go                     */
+  register __m128i xBv;		   /* B state: each model's B[i-1] in its lanes                 */
+  register __m128i sv;		   /* temp storage of 1 curr row value in progress              */
+  __m128i biasv;                   /* emission bias of each lane's model                        */
+  __m128i basev;                   /* offset for scores                                         */
+  __m128i tjbmv;                   /* J|N->B->M cost of each lane's model                      */
+  __m128i tecv;                    /* E->C cost                                                 */
+  __m128i xJv;                     /* J state, per model                                        */
+  __m128i ceilingv;                /* saturated simd value used to test for overflow           */
+  __m128i startv;                  /* 0 on each model's first lane: no diagonal from the model before */
+  __m128i fwv[4], bwv[4];          /* same-model masks for lane shifts of 1,2,4,8, up and down  */
+  __m128i fv, bv, tempv;
+  __m128i *dp  = mp->dp;
+  __m128i *rsc;
+  int      Q   = mp->Q;
+  int      ovf = 0;                /* lanes that overflowed at some row                         */
+  int      i, q, j, m, z, sh;
+  union { __m128i v; uint8_t b[p7O_NLANEB]; } u[5], uf[4], ub[4];
+  enum { BIAS = 0, BASE = 1, TJBM = 2, TEC = 3, START = 4 };
+
+  if (mp->nmodel == 0) return eslOK;
+
+  /* Lane-wise constants. Unused lanes are all zero, and stay at -infinity. */
+  for (z = 0; z < p7O_NLANEB; z++)
+    {
+      m = mp->lanemodel[z];
+      if (m == 0xff) { u[BIAS].b[z] = u[BASE].b[z] = u[TJBM].b[z] = u[TEC].b[z] = u[START].b[z] = 0; }
+      else {
+        u[BIAS].b[z]  = mp->om[m]->bias_b;
+        u[BASE].b[z]  = mp->om[m]->base_b;
+        u[TJBM].b[z]  = (uint8_t) (mp->tjb_b[m] + mp->om[m]->tbm_b);
+        u[TEC].b[z]   = mp->om[m]->tec_b;
+        u[START].b[z] = (z == mp->lane0[m]) ? 0x00 : 0xff;
+      }
+      for (j = 0, sh = 1; j < 4; j++, sh <<= 1)
+        {
+          uf[j].b[z] = (z >= sh             && mp->lanemodel[z-sh] == mp->lanemodel[z]) ? 0xff : 0x00;
+          ub[j].b[z] = (z + sh < p7O_NLANEB && mp->lanemodel[z+sh] == mp->lanemodel[z]) ? 0xff : 0x00;
+        }
+    }
+  biasv  = u[BIAS].v;
+  basev  = u[BASE].v;
+  tjbmv  = u[TJBM].v;
+  tecv   = u[TEC].v;
+  startv = u[START].v;
+  for (j = 0; j < 4; j++) { fwv[j] = uf[j].v; bwv[j] = ub[j].v; }
+
+  /* Initialization. In offset unsigned arithmetic, -infinity is 0, and 0 is om->base. */
+  for (q = 0; q < Q; q++) dp[q] = _mm_setzero_si128();
+  ceilingv = _mm_cmpeq_epi8(biasv, biasv);
+  xJv      = _mm_setzero_si128();
+  xBv      = _mm_subs_epu8(basev, tjbmv);
+
+  for (i = 1; i <= L; i++)
+    {
+      rsc = mp->rbv[dsq[i]];
+      xEv = _mm_setzero_si128();
+
+      /* Shift the last vector up one lane for the diagonal into q=0,
+       * and cut the carry across each model boundary.
+       */
+      mpv = _mm_and_si128(_mm_slli_si128(dp[Q-1], 1), startv);
+      for (q = 0; q < Q; q++)
+        {
+          sv   = _mm_max_epu8(mpv, xBv);
+          sv   = _mm_adds_epu8(sv, biasv);
+          sv   = _mm_subs_epu8(sv, *rsc);   rsc++;
+          xEv  = _mm_max_epu8(xEv, sv);
+
+          mpv   = dp[q];
+          dp[q] = sv;
+        }
+
+      /* overflow test, per lane; an overflowed model keeps going in its own lanes, harmlessly */
+      tempv = _mm_adds_epu8(xEv, biasv);
+      tempv = _mm_cmpeq_epi8(tempv, ceilingv);
+      ovf  |= _mm_movemask_epi8(tempv);
+
+      /* Segmented max: after the up and down scans, every lane holds its own model's max. */
+      fv = xEv;
+      fv = _mm_max_epu8(fv, _mm_and_si128(_mm_slli_si128(fv, 1), fwv[0]));
+      fv = _mm_max_epu8(fv, _mm_and_si128(_mm_slli_si128(fv, 2), fwv[1]));
+      fv = _mm_max_epu8(fv, _mm_and_si128(_mm_slli_si128(fv, 4), fwv[2]));
+      fv = _mm_max_epu8(fv, _mm_and_si128(_mm_slli_si128(fv, 8), fwv[3]));
+      bv = xEv;
+      bv = _mm_max_epu8(bv, _mm_and_si128(_mm_srli_si128(bv, 1), bwv[0]));
+      bv = _mm_max_epu8(bv, _mm_and_si128(_mm_srli_si128(bv, 2), bwv[1]));
+      bv = _mm_max_epu8(bv, _mm_and_si128(_mm_srli_si128(bv, 4), bwv[2]));
+      bv = _mm_max_epu8(bv, _mm_and_si128(_mm_srli_si128(bv, 8), bwv[3]));
+      xEv = _mm_max_epu8(fv, bv);
+
+      xEv = _mm_subs_epu8(xEv, tecv);
+      xJv = _mm_max_epu8(xJv, xEv);
+
+      xBv = _mm_max_epu8(basev, xJv);
+      xBv = _mm_subs_epu8(xBv, tjbmv);
+    } /* end loop over sequence residues 1..L */
+
+  /* finally C->T, and add our missing precision on the NN,CC,JJ back */
+  u[0].v = xJv;
+  for (m = 0; m < mp->nmodel; m++)
+    {
+      if ((ovf >> mp->lane0[m]) & ((1 << mp->nl[m]) - 1)) { sc[m] = eslINFINITY; continue; }
+      sc[m]  = ((float) (u[0].b[mp->lane0[m]] - mp->tjb_b[m]) - (float) mp->om[m]->base_b);
+      sc[m] /= mp->om[m]->scale_b;
+      sc[m] -= 3.0; /* that's ~ L \log \frac{L}{L+3}, for our NN,CC,JJ */
+    }
+  return eslOK;
+}
+
+
+/* Function:  p7_MSVFilter_packedBlock()
+ * Synopsis:  MSV stage for a block of ORFs against every model in a pack.
+ *
+ * Purpose:   For each sequence <b> in <block> (ORFs, in the packed
+ *            models' alphabet) and each packed model <m>, apply the
+ *            MSV stage of the BATH ORF filters: configure the null
+ *            model <bg> and the pack for the ORF's length, score, and
+ *            set <pass[b*mp->nmodel+m]> TRUE if the MSV P-value is
+ *            <= <F1>. Optionally return the number of passing
+ *            (ORF, model) pairs in <*opt_npass>. This is the same
+ *            test <p7_Pipeline_BATH()> makes with one model at a time,
+ *            so a multi-model scan can send each ORF on only to the
+ *            models that passed.
+ *
+ *            Caller provides <pass>, of size <block->count *
+ *            mp->nmodel>. <bg>'s length is left set for the last ORF.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_MSVFilter_packedBlock(const ESL_SQ_BLOCK *block, P7_MSVPACK *mp, P7_BG *bg, double F1, int *pass, int *opt_npass)
+{
+  float   sc[p7O_NLANEB];
+  float   nullsc;
+  double  P;
+  ESL_SQ *orfsq;
+  int     npass = 0;
+  int     b, m;
+
+  for (b = 0; b < block->count; b++)
+    {
+      orfsq = &(block->list[b]);
+
+      p7_bg_SetLength(bg, orfsq->n);
+      p7_msvpack_ReconfigLength(mp, orfsq->n);
+      p7_bg_NullOne  (bg, orfsq->dsq, orfsq->n, &nullsc);
+
+      p7_MSVFilter_packed(orfsq->dsq, orfsq->n, mp, sc);
+      for (m = 0; m < mp->nmodel; m++)
+        {
+          P = esl_gumbel_surv((sc[m] - nullsc) / eslCONST_LOG2, mp->om[m]->evparam[p7_MMU], mp->om[m]->evparam[p7_MLAMBDA]);
+          pass[b * mp->nmodel + m] = (P <= F1) ? TRUE : FALSE;
+          if (P <= F1) npass++;
+        }
+    }
+
+  if (opt_npass) *opt_npass = npass;
+  return eslOK;
+}
+/*------------------ end, p7_MSVFilter_packed() -----------------*/
+
+
+
+/*****************************************************************
+ * 3. Benchmark driver.
+ *****************************************************************/
+#ifdef p7MSVPACK_BENCHMARK
+/*
+   gcc -o msvpack_benchmark -std=gnu99 -g -O3 -Wall -msse2 -I.. -L.. -I../../easel -L../../easel -Dp7MSVPACK_BENCHMARK msvpack.c -lhmmer -leasel -lm
+   ./msvpack_benchmark                 packs as many length-20 models as fit at Q=4
+   ./msvpack_benchmark -M 40 -Q 8
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+#include "esl_random.h"
+#include "esl_randomseq.h"
+#include "esl_stopwatch.h"
+
+#include "hmmer.h"
+#include "impl_sse.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default  env  range toggles reqs incomp  help                                       docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",             0 },
+  { "-s",        eslARG_INT,     "42", NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                    0 },
+  { "-L",        eslARG_INT,    "400", NULL, "n>0", NULL,  NULL, NULL, "length of random target seqs",                     0 },
+  { "-M",        eslARG_INT,     "20", NULL, "n>0", NULL,  NULL, NULL, "length of sampled models",                         0 },
+  { "-N",        eslARG_INT,  "50000", NULL, "n>0", NULL,  NULL, NULL, "number of random target seqs",                     0 },
+  { "-Q",        eslARG_INT,      "4", NULL, "n>0", NULL,  NULL, NULL, "vectors per row in the pack",                      0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+static char usage[]  = "[-options]";
+static char banner[] = "benchmark driver for packed multi-model MSVFilter()";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go      = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_STOPWATCH  *w       = esl_stopwatch_Create();
+  ESL_RANDOMNESS *r       = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc     = esl_alphabet_Create(eslAMINO);
+  P7_BG          *bg      = p7_bg_Create(abc);
+  int             L       = esl_opt_GetInteger(go, "-L");
+  int             M       = esl_opt_GetInteger(go, "-M");
+  int             N       = esl_opt_GetInteger(go, "-N");
+  P7_MSVPACK     *mp      = p7_msvpack_Create(esl_opt_GetInteger(go, "-Q"), abc);
+  P7_HMM         *hmm[p7O_NLANEB];
+  P7_PROFILE     *gm[p7O_NLANEB];
+  P7_OPROFILE    *om[p7O_NLANEB];
+  P7_OMX         *ox      = p7_omx_Create(M, 0, 0);
+  ESL_DSQ        *dsq     = malloc(sizeof(ESL_DSQ) * (L+2));
+  float           sc[p7O_NLANEB];
+  float           sc1;
+  double          base_time, single_time, packed_time;
+  int             nmodel  = 0;
+  int             i, m;
+
+  do {
+    p7_oprofile_Sample(r, abc, bg, M, L, &hmm[nmodel], &gm[nmodel], &om[nmodel]);
+    if (p7_msvpack_Add(mp, om[nmodel]) != eslOK) break;
+    nmodel++;
+  } while (nmodel < p7O_NLANEB);
+  if (nmodel < p7O_NLANEB) { p7_hmm_Destroy(hmm[nmodel]); p7_profile_Destroy(gm[nmodel]); p7_oprofile_Destroy(om[nmodel]); }
+  if (nmodel == 0) p7_Fail("a model of length %d doesn't fit in a pack with Q=%d", M, mp->Q);
+  p7_msvpack_ReconfigLength(mp, L);
+
+  esl_stopwatch_Start(w);
+  for (i = 0; i < N; i++) esl_rsq_xfIID(r, bg->f, abc->K, L, dsq);
+  esl_stopwatch_Stop(w);
+  base_time = w->user;
+
+  esl_stopwatch_Start(w);
+  for (i = 0; i < N; i++)
+    {
+      esl_rsq_xfIID(r, bg->f, abc->K, L, dsq);
+      for (m = 0; m < nmodel; m++) p7_MSVFilter(dsq, L, om[m], ox, &sc1);
+    }
+  esl_stopwatch_Stop(w);
+  single_time = w->user - base_time;
+  esl_stopwatch_Display(stdout, w, "# CPU time, one model at a time: ");
+
+  esl_stopwatch_Start(w);
+  for (i = 0; i < N; i++)
+    {
+      esl_rsq_xfIID(r, bg->f, abc->K, L, dsq);
+      p7_MSVFilter_packed(dsq, L, mp, sc);
+    }
+  esl_stopwatch_Stop(w);
+  packed_time = w->user - base_time;
+  esl_stopwatch_Display(stdout, w, "# CPU time, packed:              ");
+
+  printf("# M       = %d\n", M);
+  printf("# models  = %d  (Q=%d, %d lanes)\n", nmodel, mp->Q, mp->nlanes);
+  printf("# one at a time: %.1f Mc/s\n", (double) N * (double) L * (double) M * (double) nmodel * 1e-6 / single_time);
+  printf("# packed:        %.1f Mc/s\n", (double) N * (double) L * (double) M * (double) nmodel * 1e-6 / packed_time);
+
+  for (m = 0; m < nmodel; m++) { p7_hmm_Destroy(hmm[m]); p7_profile_Destroy(gm[m]); p7_oprofile_Destroy(om[m]); }
+  free(dsq);
+  p7_omx_Destroy(ox);
+  p7_msvpack_Destroy(mp);
+  p7_bg_Destroy(bg);
+  esl_alphabet_Destroy(abc);
+  esl_stopwatch_Destroy(w);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return 0;
+}
+#endif /*p7MSVPACK_BENCHMARK*/
+/*------------------ end, benchmark driver ----------------------*/
+
+
+
+/*****************************************************************
+ * 4. Unit tests
+ *****************************************************************/
+#ifdef p7MSVPACK_TESTDRIVE
+#include "esl_random.h"
+#include "esl_randomseq.h"
+
+/* Pack models of random lengths 1..maxM into a pack of <Q> vectors
+ * per row until it's full, and check that every packed score is
+ * identical to p7_MSVFilter() on the model alone, for <N> random
+ * sequences of length <L>; then check p7_MSVFilter_packedBlock()
+ * against the same per-model P-value test on a block of them.
+ */
+static void
+utest_packed(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, P7_BG *bg, int Q, int maxM, int L, int N)
+{
+  char          msg[] = "msvpack unit test failed";
+  P7_MSVPACK   *mp    = p7_msvpack_Create(Q, abc);
+  P7_HMM       *hmm[p7O_NLANEB];
+  P7_PROFILE   *gm[p7O_NLANEB];
+  P7_OPROFILE  *om[p7O_NLANEB];
+  P7_OMX       *ox    = p7_omx_Create(maxM, 0, 0);
+  ESL_SQ_BLOCK *block = esl_sq_CreateDigitalBlock(N, abc);
+  ESL_SQ       *sq    = NULL;
+  int          *pass  = malloc(sizeof(int) * N * p7O_NLANEB);
+  float         sc[p7O_NLANEB];
+  float         sc1, nullsc;
+  double        P;
+  int           nmodel = 0;
+  int           npass;
+  int           i, m, M;
+
+  if (mp == NULL || ox == NULL || block == NULL || pass == NULL) esl_fatal(msg);
+
+  while (nmodel < p7O_NLANEB)
+    {
+      M = 1 + esl_rnd_Roll(r, maxM);
+      p7_oprofile_Sample(r, abc, bg, M, L, &hmm[nmodel], &gm[nmodel], &om[nmodel]);
+      if (p7_msvpack_Add(mp, om[nmodel]) != eslOK) break;
+      nmodel++;
+    }
+  if (nmodel < p7O_NLANEB) { p7_hmm_Destroy(hmm[nmodel]); p7_profile_Destroy(gm[nmodel]); p7_oprofile_Destroy(om[nmodel]); }
+  if (nmodel == 0 || mp->nmodel != nmodel) esl_fatal(msg);
+
+  for (i = 0; i < N; i++)
+    {
+      sq = &(block->list[i]);
+      if (esl_sq_GrowTo(sq, L) != eslOK) esl_fatal(msg);
+      esl_rsq_xfIID(r, bg->f, abc->K, L, sq->dsq);
+      sq->n = L;
+      block->count++;
+
+      for (m = 0; m < nmodel; m++) p7_oprofile_ReconfigLength(om[m], L);
+      p7_msvpack_ReconfigLength(mp, L);
+      p7_MSVFilter_packed(sq->dsq, L, mp, sc);
+      for (m = 0; m < nmodel; m++)
+        {
+          p7_MSVFilter(sq->dsq, L, om[m], ox, &sc1);
+          if (sc1 != sc[m]) esl_fatal("%s: model %d of %d (M=%d): packed %.4f, alone %.4f", msg, m, nmodel, om[m]->M, sc[m], sc1);
+        }
+    }
+
+  if (p7_MSVFilter_packedBlock(block, mp, bg, 0.02, pass, &npass) != eslOK) esl_fatal(msg);
+  for (i = 0; i < N; i++)
+    {
+      sq = &(block->list[i]);
+      p7_bg_SetLength(bg, sq->n);
+      p7_bg_NullOne(bg, sq->dsq, sq->n, &nullsc);
+      for (m = 0; m < nmodel; m++)
+        {
+          p7_oprofile_ReconfigLength(om[m], sq->n);
+          p7_MSVFilter(sq->dsq, sq->n, om[m], ox, &sc1);
+          P = esl_gumbel_surv((sc1 - nullsc) / eslCONST_LOG2, om[m]->evparam[p7_MMU], om[m]->evparam[p7_MLAMBDA]);
+          if ((P <= 0.02) != pass[i*nmodel + m]) esl_fatal("%s: block pass flag differs", msg);
+          if (P <= 0.02) npass--;
+        }
+    }
+  if (npass != 0) esl_fatal("%s: block pass count differs", msg);
+
+  /* a reused pack is empty, and a full model still fits */
+  p7_msvpack_Reuse(mp);
+  if (mp->nmodel != 0 || mp->nlanes != 0)       esl_fatal(msg);
+  if (p7_msvpack_Add(mp, om[0]) != eslOK)        esl_fatal(msg);
+
+  for (m = 0; m < nmodel; m++) { p7_hmm_Destroy(hmm[m]); p7_profile_Destroy(gm[m]); p7_oprofile_Destroy(om[m]); }
+  free(pass);
+  esl_sq_DestroyBlock(block);
+  p7_omx_Destroy(ox);
+  p7_msvpack_Destroy(mp);
+}
+#endif /*p7MSVPACK_TESTDRIVE*/
+/*-------------------- end, unit tests --------------------------*/
+
+
+
+/*****************************************************************
+ * 5. Test driver
+ *****************************************************************/
+#ifdef p7MSVPACK_TESTDRIVE
+/*
+   gcc -g -Wall -msse2 -std=gnu99 -I.. -L.. -I../../easel -L../../easel -o msvpack_utest -Dp7MSVPACK_TESTDRIVE msvpack.c -lhmmer -leasel -lm
+   ./msvpack_utest
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+#include "impl_sse.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default  env  range toggles reqs incomp  help                                       docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",           0 },
+  { "-s",        eslARG_INT,     "42", NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                  0 },
+  { "-v",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "be verbose",                                     0 },
+  { "-L",        eslARG_INT,    "200", NULL, NULL,  NULL,  NULL, NULL, "size of random sequences to sample",             0 },
+  { "-N",        eslARG_INT,    "100", NULL, NULL,  NULL,  NULL, NULL, "number of random sequences to sample",           0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for the SSE packed multi-model MSVFilter()";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go   = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r    = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc  = NULL;
+  P7_BG          *bg   = NULL;
+  int             L    = esl_opt_GetInteger(go, "-L");
+  int             N    = esl_opt_GetInteger(go, "-N");
+
+  if ((abc = esl_alphabet_Create(eslAMINO)) == NULL)  esl_fatal("failed to create alphabet");
+  if ((bg = p7_bg_Create(abc))              == NULL)  esl_fatal("failed to create null model");
+
+  if (esl_opt_GetBoolean(go, "-v")) printf("packed MSVFilter() tests, protein\n");
+  utest_packed(r, abc, bg, 2, 20, L, N);   /* many tiny models, down to M=1 */
+  utest_packed(r, abc, bg, 4, 63, L, N);   /* a few models of up to 63      */
+  utest_packed(r, abc, bg, 4, 30, 1, 10);  /* size 1 sequences              */
+
+  esl_alphabet_Destroy(abc);
+  p7_bg_Destroy(bg);
+  esl_getopts_Destroy(go);
+  esl_randomness_Destroy(r);
+  return eslOK;
+}
+#endif /*p7MSVPACK_TESTDRIVE*/
@@ -28,6 +28,8 @@
  * 1. Optimal accuracy alignment, DP fill
  *****************************************************************/
 
+static void oa_rows(const P7_OPROFILE *om, const P7_OMX *pp, P7_OMX *ox, int i1, int i2);
+
 /* Function:  p7_OptimalAccuracy()
  * Synopsis:  DP fill of an optimal accuracy alignment calculation.
  * Incept:    SRE, Mon Aug 18 11:04:48 2008 [Janelia]
@@ -42,6 +44,11 @@
  *            Caller also provides a DP matrix <ox>, allocated for a full
  *            <om->M> by <L> comparison. The routine fills this in
  *            with OA scores.
+ *            
+ *            <ox> may instead be laid out by
+ *            <p7_omx_GrowToCheckpointed()>, in which case only its
+ *            checkpointed rows and last segment are kept, and the
+ *            traceback must be done by <p7_OATraceCheckpointed()>.
  *  
  * Args:      gm    - query profile      
  *            pp    - posterior decoding matrix created by <p7_GPosteriorDecoding()>
@@ -56,6 +63,38 @@
  */
 int
 p7_OptimalAccuracy(const P7_OPROFILE *om, const P7_OMX *pp, P7_OMX *ox, float *ret_e)
+{
+  float  *xmx = ox->xmx;
+  __m128 *dpc = ox->dpf[0];        /* row 0                                                     */
+  __m128 infv  = _mm_set1_ps(-eslINFINITY);
+  int M = om->M;
+  int Q = p7O_NQF(M);
+  int q;
+
+  ox->M = om->M;
+  ox->L = pp->L;
+  for (q = 0; q < Q; q++) MMO(dpc, q) = IMO(dpc,q) = DMO(dpc,q) = infv;
+  XMXo(0, p7X_E)    = -eslINFINITY;
+  XMXo(0, p7X_N)    = 0.;
+  XMXo(0, p7X_J)    = -eslINFINITY;
+  XMXo(0, p7X_B)    = 0.;
+  XMXo(0, p7X_C)    = -eslINFINITY;
+
+  oa_rows(om, pp, ox, 1, pp->L);
+
+  *ret_e = ox->xmx[pp->L*p7X_NXCELLS+p7X_C];
+  return eslOK;
+}
+
+/* oa_rows()
+ * 
+ * The OA recursion for rows <i1>..<i2> of <ox>, from row <i1-1>. Used
+ * by <p7_OptimalAccuracy()> for rows 1..L, and by
+ * <p7_OATraceCheckpointed()> to recalculate a segment of a
+ * checkpointed OA matrix.
+ */
+static void
+oa_rows(const P7_OPROFILE *om, const P7_OMX *pp, P7_OMX *ox, int i1, int i2)
 {
   register __m128 mpv, dpv, ipv;   /* previous row values                                       */
   register __m128 sv;		   /* temp storage of 1 curr row value in progress              */
@@ -63,7 +102,7 @@ p7_OptimalAccuracy(const P7_OPROFILE *om, const P7_OMX *pp, P7_OMX *ox, float *r
   register __m128 xBv;		   /* B state: splatted vector of B[i-1] for B->Mk calculations */
   register __m128 dcv;
   float  *xmx = ox->xmx;
-  __m128 *dpc = ox->dpf[0];        /* current row, for use in {MDI}MO(dpp,q) access macro       */
+  __m128 *dpc = ox->dpf[i1-1];     /* current row, for use in {MDI}MO(dpp,q) access macro       */
   __m128 *dpp;                     /* previous row, for use in {MDI}MO(dpp,q) access macro      */
   __m128 *ppp;			   /* quads in the <pp> posterior probability matrix            */
   __m128 *tp;			   /* quads in the <om->tfv> transition scores                  */
@@ -76,16 +115,7 @@ p7_OptimalAccuracy(const P7_OPROFILE *om, const P7_OMX *pp, P7_OMX *ox, float *r
   int i;
   float t1, t2;
 
-  ox->M = om->M;
-  ox->L = pp->L;
-  for (q = 0; q < Q; q++) MMO(dpc, q) = IMO(dpc,q) = DMO(dpc,q) = infv;
-  XMXo(0, p7X_E)    = -eslINFINITY;
-  XMXo(0, p7X_N)    = 0.;
-  XMXo(0, p7X_J)    = -eslINFINITY;
-  XMXo(0, p7X_B)    = 0.;
-  XMXo(0, p7X_C)    = -eslINFINITY;
-
-  for (i = 1; i <= pp->L; i++)
+  for (i = i1; i <= i2; i++)
     {
       dpp = dpc;		/* previous DP row in OA matrix */
       dpc = ox->dpf[i];   	/* current DP row in OA matrix  */
@@ -165,8 +195,6 @@ p7_OptimalAccuracy(const P7_OPROFILE *om, const P7_OMX *pp, P7_OMX *ox, float *r
       ox->xmx[i*p7X_NXCELLS+p7X_B] = ESL_MAX(t1, t2);
     }
 
-  *ret_e = ox->xmx[pp->L*p7X_NXCELLS+p7X_C];
-  return eslOK;
 }
 /*------------------- end, OA DP fill ---------------------------*/
 
@@ -261,6 +289,83 @@ p7_OATrace(const P7_OPROFILE *om, const P7_OMX *pp, const P7_OMX *ox, P7_TRACE *
   return p7_trace_Reverse(tr);
 }
 
+/* Function:  p7_OATraceCheckpointed()
+ * Synopsis:  Optimal accuracy traceback of a checkpointed OA matrix.
+ *
+ * Purpose:   Same as <p7_OATrace()>, for an OA matrix <ox> that
+ *            <p7_OptimalAccuracy()> filled in a checkpointed layout
+ *            (see <p7_omx_GrowToCheckpointed()>). As the traceback
+ *            moves up into a segment whose rows are no longer in
+ *            <ox>, that segment is recalculated from its checkpoint
+ *            and <pp>; the traceback is identical to the one
+ *            <p7_OATrace()> finds in a full OA matrix.
+ *
+ *            If <ox> isn't checkpointed, this is simply <p7_OATrace()>.
+ *
+ * Args:      om  - profile
+ *            pp  - posterior probability matrix
+ *            ox  - checkpointed OA matrix to trace; uncheckpointed rows are overwritten
+ *            tr  - storage for the recovered traceback
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation error.
+ *            <eslEINVAL> if the trace <tr> isn't empty (needs to be Reuse()'d).
+ */
+int
+p7_OATraceCheckpointed(const P7_OPROFILE *om, const P7_OMX *pp, P7_OMX *ox, P7_TRACE *tr)
+{
+  int   K   = ox->chkK;
+  int   i   = ox->L;		/* position in sequence 1..L */
+  int   k   = 0;		/* position in model 1..M */
+  int   s0, s1;			/* choice of a state */
+  int   seg;			/* segment that rows i, i-1 need; -1 if both are checkpoints */
+  int   loaded = -1;		/* segment whose rows are currently in <ox> */
+  float postprob;
+  int   status;			
+
+  if (K <= 1) return p7_OATrace(om, pp, ox, tr);
+  if (tr->N != 0) ESL_EXCEPTION(eslEINVAL, "trace not empty; needs to be Reuse()'d?");
+
+  if ((status = p7_trace_AppendWithPP(tr, p7T_T, k, i, 0.0)) != eslOK) return status;
+  if ((status = p7_trace_AppendWithPP(tr, p7T_C, k, i, 0.0)) != eslOK) return status;
+
+  s0 = tr->st[tr->N-1];
+  while (s0 != p7T_S)
+    {
+      /* selections read row i and/or i-1; make sure both are present */
+      if      (i % K != 0)                seg = i / K;
+      else if (i > 0 && (i-1) % K != 0)   seg = (i-1) / K;
+      else                                seg = -1;
+      if (seg != -1 && seg != loaded) {
+	oa_rows(om, pp, ox, seg*K+1, ESL_MIN(seg*K+K-1, ox->L));
+	loaded = seg;
+      }
+
+      switch (s0) {
+      case p7T_M: s1 = select_m(om,     ox, i, k);  k--; i--; break;
+      case p7T_D: s1 = select_d(om,     ox, i, k);  k--;      break;
+      case p7T_I: s1 = select_i(om,     ox, i, k);       i--; break;
+      case p7T_N: s1 = select_n(i);                           break;
+      case p7T_C: s1 = select_c(om, pp, ox, i);               break;
+      case p7T_J: s1 = select_j(om, pp, ox, i);               break;
+      case p7T_E: s1 = select_e(om,     ox, i, &k);           break;
+      case p7T_B: s1 = select_b(om,     ox, i);               break;
+      default: ESL_EXCEPTION(eslEINVAL, "bogus state in traceback");
+      }
+      if (s1 == -1) ESL_EXCEPTION(eslEINVAL, "OA traceback choice failed");
+
+      postprob = get_postprob(pp, s1, s0, k, i);
+      if ((status = p7_trace_AppendWithPP(tr, s1, k, i, postprob)) != eslOK) return status;
+
+      if ( (s1 == p7T_N || s1 == p7T_J || s1 == p7T_C) && s1 == s0) i--;
+      s0 = s1;
+    } /* end traceback, at S state */
+  tr->M = om->M;
+  tr->L = ox->L;
+  return p7_trace_Reverse(tr);
+}
+
 static inline float
 get_postprob(const P7_OMX *pp, int scur, int sprv, int k, int i)
 {
@@ -573,6 +678,8 @@ main(int argc, char **argv)
  * 4. Unit tests
  *****************************************************************/
 #ifdef p7OPTACC_TESTDRIVE
+#include <string.h>
+
 #include "esl_alphabet.h"
 #include "esl_getopts.h"
 #include "esl_random.h"
@@ -727,6 +834,80 @@ utest_optacc(ESL_GETOPTS *go, ESL_RANDOMNESS *r, ESL_ALPHABET *abc, P7_BG *bg, i
   p7_hmm_Destroy(hmm);
 }
 
+/* The checkpointed path (p7_ForwardCheckpointed(), p7_DecodingCheckpointed(),
+ * checkpointed OA fill, p7_OATraceCheckpointed()) must reproduce the
+ * full-matrix path exactly: same posterior probabilities bit for bit,
+ * same OA score, same trace.
+ */
+static void
+utest_checkpointed(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, P7_BG *bg, int M, int L, int N)
+{
+  char        *msg = "checkpointed optimal accuracy unit test failed";
+  P7_HMM      *hmm = NULL;
+  P7_PROFILE  *gm  = NULL;
+  P7_OPROFILE *om  = NULL;
+  ESL_SQ      *sq  = esl_sq_CreateDigital(abc);
+  P7_OMX      *ox1 = p7_omx_Create(M, L, L);
+  P7_OMX      *ox2 = p7_omx_Create(M, L, L);
+  P7_OMX      *oxc = p7_omx_Create(M, 0, L);
+  P7_OMX      *pp  = p7_omx_Create(M, L, L);
+  P7_TRACE    *tr1 = p7_trace_CreateWithPP();
+  P7_TRACE    *tr2 = p7_trace_CreateWithPP();
+  P7_TRACE    *tro = p7_trace_CreateWithPP();
+  float        fsc1, fsc2, oasc1, oasc2;
+  int          i, s;
+
+  if (p7_oprofile_Sample(r, abc, bg, M, L, &hmm, &gm, &om)!= eslOK) esl_fatal(msg);
+  while (N--)
+    {
+      if (p7_ProfileEmit(r, hmm, gm, bg, sq, tro)          != eslOK) esl_fatal(msg);
+
+      if (p7_omx_GrowTo(ox1, M, sq->n, sq->n)              != eslOK) esl_fatal(msg);
+      if (p7_omx_GrowTo(ox2, M, sq->n, sq->n)              != eslOK) esl_fatal(msg);
+      if (p7_omx_GrowTo(pp,  M, sq->n, sq->n)              != eslOK) esl_fatal(msg);
+      if (p7_omx_GrowToCheckpointed(oxc, M, sq->n)         != eslOK) esl_fatal(msg);
+
+      if (p7_Forward (sq->dsq, sq->n, om, ox1,      &fsc1) != eslOK) esl_fatal(msg);
+      if (p7_Backward(sq->dsq, sq->n, om, ox1, ox2, NULL)  != eslOK) esl_fatal(msg);
+      if (p7_Decoding(om, ox1, ox2, ox2)                   != eslOK) esl_fatal(msg);
+      if (p7_OptimalAccuracy(om, ox2, ox1, &oasc1)         != eslOK) esl_fatal(msg);
+      if (p7_OATrace(om, ox2, ox1, tr1)                    != eslOK) esl_fatal(msg);
+
+      if (p7_ForwardCheckpointed(sq->dsq, sq->n, om, oxc, &fsc2) != eslOK) esl_fatal(msg);
+      if (p7_Backward(sq->dsq, sq->n, om, oxc, pp, NULL)   != eslOK) esl_fatal(msg);
+      if (p7_DecodingCheckpointed(sq->dsq, om, oxc, pp, pp) != eslOK) esl_fatal(msg);
+      if (p7_OptimalAccuracy(om, pp, oxc, &oasc2)          != eslOK) esl_fatal(msg);
+      if (p7_OATraceCheckpointed(om, pp, oxc, tr2)         != eslOK) esl_fatal(msg);
+
+      if (fsc1  != fsc2)  esl_fatal(msg);
+      if (oasc1 != oasc2) esl_fatal(msg);
+      for (i = 0; i <= sq->n; i++)
+	{
+	  if (memcmp(ox2->dpf[i], pp->dpf[i], sizeof(__m128) * p7O_NQF(M) * p7X_NSCELLS) != 0) esl_fatal(msg);
+	  for (s = 0; s < p7X_NXCELLS; s++)
+	    if (s != p7X_SCALE && ox2->xmx[i*p7X_NXCELLS+s] != pp->xmx[i*p7X_NXCELLS+s]) esl_fatal(msg);
+	}
+      if (p7_trace_Compare(tr1, tr2, 0.0)                  != eslOK) esl_fatal(msg);
+
+      esl_sq_Reuse(sq);
+      p7_trace_Reuse(tr1);
+      p7_trace_Reuse(tr2);
+      p7_trace_Reuse(tro);
+    }
+
+  p7_trace_Destroy(tro);
+  p7_trace_Destroy(tr2);
+  p7_trace_Destroy(tr1);
+  p7_omx_Destroy(pp);
+  p7_omx_Destroy(oxc);
+  p7_omx_Destroy(ox2);
+  p7_omx_Destroy(ox1);  
+  esl_sq_Destroy(sq);
+  p7_oprofile_Destroy(om);
+  p7_profile_Destroy(gm);
+  p7_hmm_Destroy(hmm);
+}
+
 #endif /*p7OPTACC_TESTDRIVE*/
 /*------------------- end, unit tests ---------------------------*/
 
@@ -810,6 +991,9 @@ main(int argc, char **argv)
   utest_optacc(go, r, abc, bg, 1, L, 10);  
   utest_optacc(go, r, abc, bg, M, 1, 10);  
 
+  utest_checkpointed(r, abc, bg, M,  L, N);
+  utest_checkpointed(r, abc, bg, M, 10*L, 5);  /* several segments of checkpointed rows */
+
   esl_alphabet_Destroy(abc);
   p7_bg_Destroy(bg);
 
@@ -104,6 +104,7 @@ p7_omx_Create(int allocM, int allocL, int allocXL)
   ox->L              = 0;
   ox->totscale       = 0.0;
   ox->has_own_scales = TRUE;	/* most matrices are Forward, control their own scale factors */
+  ox->chkK           = 0;
 #if eslDEBUGLEVEL > 0
   ox->debugging = FALSE;
   ox->dfp       = NULL;
@@ -146,8 +147,11 @@ p7_omx_GrowTo(P7_OMX *ox, int allocM, int allocL, int allocXL)
   int    i;
   int    status;
 
-   /* If all possible dimensions are already satisfied, the matrix is fine */
-  if (ox->allocQ4*4 >= allocM && ox->validR > allocL && ox->allocXR >= allocXL+1) return eslOK;
+   /* If all possible dimensions are already satisfied, the matrix is fine;
+    * unless its rows were aliased by p7_omx_GrowToCheckpointed(), in which
+    * case the row pointers must be laid out flat again.
+    */
+  if (! ox->chkK && ox->allocQ4*4 >= allocM && ox->validR > allocL && ox->allocXR >= allocXL+1) return eslOK;
 
   /* If the main matrix is too small in cells, reallocate it; 
    * and we'll need to realign/reset the row pointers later.
@@ -184,7 +188,7 @@ p7_omx_GrowTo(P7_OMX *ox, int allocM, int allocL, int allocXL)
     reset_row_pointers = TRUE;
 
   /* must we set some more valid row pointers? */
-  if (allocL >= ox->validR)
+  if (allocL >= ox->validR || ox->chkK)
     reset_row_pointers = TRUE;
 
   /* now reset the row pointers, if needed */
@@ -205,6 +209,7 @@ p7_omx_GrowTo(P7_OMX *ox, int allocM, int allocL, int allocXL)
       ox->allocQ4  = nqf;
       ox->allocQ8  = nqw;
       ox->allocQ16 = nqb;
+      ox->chkK     = 0;
     }
   
   ox->M = 0;
@@ -215,6 +220,98 @@ p7_omx_GrowTo(P7_OMX *ox, int allocM, int allocL, int allocXL)
   return status;
 }  
 
+/* Function:  p7_omx_GrowToCheckpointed()
+ * Synopsis:  Lay out a DP matrix for checkpointed Forward/OA fills.
+ *
+ * Purpose:   Assures that <ox> can hold a checkpointed <allocM> by
+ *            <L> comparison in $O(M \sqrt{L})$ memory, and lays out
+ *            its row pointers accordingly.
+ *
+ *            With a checkpoint interval $K = \lceil \sqrt{L} \rceil$,
+ *            only $L/K + K$ rows of DP memory are allocated. Rows
+ *            $0,K,2K...$ each get their own storage (the
+ *            checkpoints); the $K-1$ rows of every segment between
+ *            two checkpoints all share one segment's worth of
+ *            storage, so <ox->dpf[i]> for uncheckpointed <i> aliases
+ *            the same memory as the corresponding row of every other
+ *            segment. The special states <xmx> are kept for all
+ *            <0..L>, as in a full matrix.
+ *
+ *            Because every row only reads the row above it, any
+ *            one-pass fill (<p7_Forward()>, <p7_OptimalAccuracy()>)
+ *            works unchanged on this layout: upon return, the
+ *            checkpoint rows and the last segment are valid. Other
+ *            segments must be recalculated from their checkpoint
+ *            before use; <p7_DecodingCheckpointed()> and
+ *            <p7_OATraceCheckpointed()> do that.
+ *
+ *            <ox->chkK> is set to $K$. A subsequent <p7_omx_GrowTo()>
+ *            restores a flat layout.
+ *
+ * Returns:   <eslOK> on success. Any data that may have been in <ox>
+ *            must be assumed to be invalidated.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_omx_GrowToCheckpointed(P7_OMX *ox, int allocM, int L)
+{
+  void  *p;
+  int    nqf  = p7O_NQF(allocM);
+  int    nqw  = p7O_NQW(allocM);
+  int    nqb  = p7O_NQB(allocM);
+  int    K    = ESL_MAX(1, (int) ceil(sqrt((double) L)));
+  int    nchk = L/K + 1;	                 /* checkpointed rows 0,K,2K..    */
+  int    R    = nchk + K - 1;	                 /* + one segment's worth of rows */
+  size_t ncells = (size_t) R * nqf * 4;
+  int    i, r;
+  int    status;
+
+  if (ncells > ox->ncells)
+    {
+      ESL_RALLOC(ox->dp_mem, p, sizeof(__m128) * R * nqf * p7X_NSCELLS + 15);
+      ox->ncells = ncells;
+    }
+
+  if (L+1 > ox->allocXR)
+    {
+      ESL_RALLOC(ox->x_mem, p,  sizeof(float) * (L+1) * p7X_NXCELLS + 15); 
+      ox->allocXR = L+1;
+      ox->xmx     = (float *) ( ( (unsigned long int) ((char *) ox->x_mem  + 15) & (~0xf)));
+    }
+
+  if (L+1 > ox->allocR)
+    {
+      ESL_RALLOC(ox->dpb, p, sizeof(__m128i *) * (L+1));
+      ESL_RALLOC(ox->dpw, p, sizeof(__m128i *) * (L+1));
+      ESL_RALLOC(ox->dpf, p, sizeof(__m128  *) * (L+1));
+      ox->allocR = L+1;
+    }
+
+  ox->dpb[0] = (__m128i *) ( ( (unsigned long int) ((char *) ox->dp_mem + 15) & (~0xf)));
+  ox->dpw[0] = (__m128i *) ( ( (unsigned long int) ((char *) ox->dp_mem + 15) & (~0xf)));
+  ox->dpf[0] = (__m128  *) ( ( (unsigned long int) ((char *) ox->dp_mem + 15) & (~0xf)));
+  for (i = 1; i <= L; i++)
+    {
+      r = (i % K == 0) ? i / K : nchk + (i % K) - 1;
+      ox->dpb[i] = ox->dpb[0] + r * nqb;
+      ox->dpw[i] = ox->dpw[0] + r * nqw * p7X_NSCELLS;
+      ox->dpf[i] = ox->dpf[0] + r * nqf * p7X_NSCELLS;
+    }
+
+  ox->validR   = L+1;
+  ox->allocQ4  = nqf;
+  ox->allocQ8  = nqw;
+  ox->allocQ16 = nqb;
+  ox->chkK     = K;
+  ox->M        = 0;
+  ox->L        = 0;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
 /* Function:  p7_omx_FDeconvert()
  * Synopsis:  Convert an optimized DP matrix to generic one.
  * Incept:    SRE, Tue Aug 19 17:58:13 2008 [Janelia]
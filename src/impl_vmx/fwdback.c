@@ -248,6 +248,34 @@ p7_BackwardParser(const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, const P7_OMX
 }
 
 
+/* Function:  p7_ForwardCheckpointed()
+ * Synopsis:  The Forward algorithm, checkpointed fill version.
+ *
+ * Purpose:   API-compatible with the SSE implementation. The VMX
+ *            implementation has no checkpointed layout (see
+ *            <p7_omx_GrowToCheckpointed()>), so this is <p7_Forward()>
+ *            into a full matrix.
+ */
+int
+p7_ForwardCheckpointed(const ESL_DSQ *dsq, int L, const P7_OPROFILE *om, P7_OMX *ox, float *opt_sc)
+{
+  return p7_Forward(dsq, L, om, ox, opt_sc);
+}
+
+/* Function:  p7_DecodingCheckpointed()
+ * Synopsis:  Posterior decoding from a checkpointed Forward matrix.
+ *
+ * Purpose:   API-compatible with the SSE implementation; here <oxf>
+ *            is a full Forward matrix, so this is <p7_Decoding()>.
+ *            <dsq> is unused.
+ */
+int
+p7_DecodingCheckpointed(const ESL_DSQ *dsq, const P7_OPROFILE *om, P7_OMX *oxf, P7_OMX *oxb, P7_OMX *pp)
+{
+  return p7_Decoding(om, oxf, oxb, pp);
+}
+
+
 
 /*****************************************************************
  * 2. Forward/Backward engine implementations (called thru API)
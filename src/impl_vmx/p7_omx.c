@@ -218,6 +218,24 @@ p7_omx_GrowTo(P7_OMX *ox, int allocM, int allocL, int allocXL)
   return status;
 }  
 
+/* Function:  p7_omx_GrowToCheckpointed()
+ * Synopsis:  Lay out a DP matrix for checkpointed Forward/OA fills.
+ *
+ * Purpose:   API-compatible with the SSE implementation, where <ox>
+ *            keeps only every ~sqrt(L)'th row. The VMX implementation
+ *            has no checkpointed fills, so this simply grows <ox> to
+ *            a full <allocM> by <L> matrix.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_omx_GrowToCheckpointed(P7_OMX *ox, int allocM, int L)
+{
+  return p7_omx_GrowTo(ox, allocM, L, L);
+}
+
 /* Function:  p7_omx_FDeconvert()
  * Synopsis:  Convert an optimized DP matrix to generic one.
  * Incept:    SRE, Tue Aug 19 17:58:13 2008 [Janelia]
@@ -0,0 +1,522 @@
+/* The "kernels" integration test: cross-backend equivalence and speed.
+ *
+ * BATH carries several implementations of each DP algorithm: the
+ * generic (reference) ones, the vectorized impl_* ones, checkpointed
+ * and parser variants, and for the frameshift-aware algorithms the
+ * serial, specialized, tiled and wavefront-parallel fills and the
+ * dispatchers that pick among them. Each has its own unit test
+ * against one other version, on one kind of target. This test runs
+ * every version that was compiled in on the same models and targets,
+ * checks scores and posterior probabilities against the reference
+ * implementation of each family within a tolerance, and reports the
+ * relative speed of all of them in one table.
+ *
+ * Each round samples one model (alternately gapped and ungapped),
+ * configures a protein profile, an optimized profile and a
+ * frameshift-aware profile from it, and scores four kinds of target
+ * in turn:
+ *    0. i.i.d. residues;
+ *    1. i.i.d. residues peppered with degenerate residues;
+ *    2. an emitted core embedded in i.i.d. flanks (for DNA targets,
+ *       back-translated through the genetic code, with frameshifts);
+ *    3. as 2, also peppered with degenerate residues.
+ * All-canonical and degenerate targets take different specialized
+ * frameshift kernels, so both kinds have to be covered.
+ *
+ * Vector kernels that overflow their limited range (eslERANGE) are
+ * counted as skipped, not compared.
+ *
+ * The impl_* backends share one API, so this tests whichever one was
+ * built. Kernels that only exist in some backends show up as "not
+ * built" in the others.
+ */
+#include "p7_config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_gencode.h"
+#include "esl_getopts.h"
+#include "esl_random.h"
+#include "esl_randomseq.h"
+#include "esl_sq.h"
+#include "esl_stopwatch.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default  env  range toggles reqs incomp  help                                       docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",             0 },
+  { "-s",        eslARG_INT,     "42", NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                    0 },
+  { "-v",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "be verbose",                                       0 },
+  { "-t",        eslARG_REAL,  "0.01", NULL, "x>0", NULL,  NULL, NULL, "tolerance on posterior probabilities",             0 },
+  { "-L",        eslARG_INT,    "600", NULL, "n>=30",NULL, NULL, NULL, "length of DNA targets (protein targets are L/3)",  0 },
+  { "-M",        eslARG_INT,     "60", NULL, "n>1", NULL,  NULL, NULL, "length of sampled models",                         0 },
+  { "-N",        eslARG_INT,     "12", NULL, "n>0", NULL,  NULL, NULL, "number of sampled models",                         0 },
+  { "--cpu",     eslARG_INT,      "2", NULL, "n>0", NULL,  NULL, NULL, "number of threads for the wavefront kernel",       0 },
+  { "--fsrate",  eslARG_REAL,  "0.01", NULL, "0<=x<1",NULL,NULL, NULL, "per-codon frameshift rate in emitted DNA cores",   0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+static char usage[]  = "[-options]";
+static char banner[] = "cross-backend DP kernel equivalence and speed test";
+
+/* One row of the report per kernel. Each family's first kernel is
+ * its reference; the others are compared to it.
+ */
+enum kernel_e {
+  K_FSFWD = 0, K_FSFWD_PARSER, K_FSFWD_TILED, K_FSFWD_WAVE, K_FSFWD_AUTO,
+  K_FSBCK,     K_FSBCK_PARSER, K_FSBCK_TILED, K_FSBCK_AUTO,
+  K_FSDEC,     K_FSDEC_TILED,
+  K_FSOA,      K_FSOA_TILED,
+  K_MSV,       K_MSV_FILTER,   K_MSV_PACKED,
+  K_VIT,       K_VIT_FILTER,
+  K_FWD,       K_FWD_PARSER,   K_FWD_VEC,     K_FWD_CHK,
+  K_BCK,       K_BCK_PARSER,   K_BCK_VEC,
+  K_DEC,       K_DEC_VEC,      K_DEC_CHK,
+  K_OA,        K_OA_VEC,
+  K_NKERNELS
+};
+
+struct kernel_s {
+  char   *family;   /* family name, shared by a reference and its candidates */
+  char   *name;     /* kernel                                               */
+  int     ref;      /* index of this family's reference kernel              */
+  int     ncalls;   /* number of calls timed                                */
+  int     nskip;    /* number of calls not compared (vector overflow)       */
+  double  maxdiff;  /* max |difference| from the reference                  */
+  double  tol;      /* tolerance on <maxdiff>; set in main()                */
+  double  secs;     /* total elapsed time                                   */
+};
+
+static struct kernel_s kernel[K_NKERNELS] = {
+  { "fs-forward",  "Forward_Frameshift",           K_FSFWD, 0, 0, 0., 0., 0. },
+  { "fs-forward",  "ForwardParser_Frameshift",     K_FSFWD, 0, 0, 0., 0., 0. },
+  { "fs-forward",  "Forward_Frameshift_Tiled",     K_FSFWD, 0, 0, 0., 0., 0. },
+  { "fs-forward",  "Forward_Frameshift_Wavefront", K_FSFWD, 0, 0, 0., 0., 0. },
+  { "fs-forward",  "ForwardAuto_Frameshift",       K_FSFWD, 0, 0, 0., 0., 0. },
+  { "fs-backward", "Backward_Frameshift",          K_FSBCK, 0, 0, 0., 0., 0. },
+  { "fs-backward", "BackwardParser_Frameshift",    K_FSBCK, 0, 0, 0., 0., 0. },
+  { "fs-backward", "Backward_Frameshift_Tiled",    K_FSBCK, 0, 0, 0., 0., 0. },
+  { "fs-backward", "BackwardAuto_Frameshift",      K_FSBCK, 0, 0, 0., 0., 0. },
+  { "fs-decoding", "Decoding_Frameshift",          K_FSDEC, 0, 0, 0., 0., 0. },
+  { "fs-decoding", "Decoding_Frameshift(tiled)",   K_FSDEC, 0, 0, 0., 0., 0. },
+  { "fs-optacc",   "OptimalAccuracy_Frameshift",   K_FSOA,  0, 0, 0., 0., 0. },
+  { "fs-optacc",   "OptimalAccuracy_FS(tiled)",    K_FSOA,  0, 0, 0., 0., 0. },
+  { "msv",         "GViterbi(MSV-rounded)",        K_MSV,   0, 0, 0., 0., 0. },
+  { "msv",         "MSVFilter",                    K_MSV,   0, 0, 0., 0., 0. },
+  { "msv",         "MSVFilter_packed",             K_MSV,   0, 0, 0., 0., 0. },
+  { "viterbi",     "GViterbi(VF-rounded)",         K_VIT,   0, 0, 0., 0., 0. },
+  { "viterbi",     "ViterbiFilter",                K_VIT,   0, 0, 0., 0., 0. },
+  { "forward",     "GForward",                     K_FWD,   0, 0, 0., 0., 0. },
+  { "forward",     "ForwardParser",                K_FWD,   0, 0, 0., 0., 0. },
+  { "forward",     "Forward",                      K_FWD,   0, 0, 0., 0., 0. },
+  { "forward",     "ForwardCheckpointed",          K_FWD,   0, 0, 0., 0., 0. },
+  { "backward",    "GBackward",                    K_BCK,   0, 0, 0., 0., 0. },
+  { "backward",    "BackwardParser",               K_BCK,   0, 0, 0., 0., 0. },
+  { "backward",    "Backward",                     K_BCK,   0, 0, 0., 0., 0. },
+  { "decoding",    "GDecoding",                    K_DEC,   0, 0, 0., 0., 0. },
+  { "decoding",    "Decoding",                     K_DEC,   0, 0, 0., 0., 0. },
+  { "decoding",    "DecodingCheckpointed",         K_DEC,   0, 0, 0., 0., 0. },
+  { "optacc",      "GOptimalAccuracy",             K_OA,    0, 0, 0., 0., 0. },
+  { "optacc",      "OptimalAccuracy",              K_OA,    0, 0, 0., 0., 0. },
+};
+
+static void   sample_target(ESL_RANDOMNESS *r, const P7_HMM *hmm, const P7_BG *bg, const ESL_GENCODE *gcode, int type, double fsrate, ESL_SQ *csq, ESL_DSQ *dsq, int L);
+static float  gmx_maxdiff(const P7_GMX *gx1, const P7_GMX *gx2, int M, int L, int nscells, int logspace);
+static void   record(int k, int status, double ref, double val);
+static void   report(FILE *ofp);
+
+/* time one kernel call: stopwatch <w> around <call>, result in <status> */
+#define TIMED(w, k, status, call) do {           \
+    esl_stopwatch_Start(w);                      \
+    (status) = (call);                           \
+    esl_stopwatch_Stop(w);                       \
+    kernel[(k)].secs += (w)->elapsed;            \
+    kernel[(k)].ncalls++;                        \
+  } while (0)
+
+int
+main(int argc, char **argv)
+{
+  char           *msg    = "kernels integration test failed";
+  ESL_GETOPTS    *go     = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r      = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_STOPWATCH  *w      = esl_stopwatch_Create();
+  ESL_ALPHABET   *abc    = esl_alphabet_Create(eslAMINO);
+  ESL_ALPHABET   *abcDNA = esl_alphabet_Create(eslDNA);
+  ESL_GENCODE    *gcode  = esl_gencode_Create(abcDNA, abc);
+  P7_BG          *bg     = p7_bg_Create(abc);
+  ESL_SQ         *csq    = esl_sq_CreateDigital(abc);
+  int             L      = esl_opt_GetInteger(go, "-L");
+  int             Lp     = L / 3;
+  int             M      = esl_opt_GetInteger(go, "-M");
+  int             N      = esl_opt_GetInteger(go, "-N");
+  P7_FS_WAVEPOOL *pool   = p7_fs_wavepool_Create(esl_opt_GetInteger(go, "--cpu"));
+  double          fsrate = esl_opt_GetReal   (go, "--fsrate");
+  float           ptol   = esl_opt_GetReal   (go, "-t");
+  ESL_DSQ        *dna    = malloc(sizeof(ESL_DSQ) * (L+2));
+  ESL_DSQ        *aa     = malloc(sizeof(ESL_DSQ) * (Lp+2));
+  P7_GMX         *fsf1   = p7_gmx_fs_Create(M, L, L, p7P_CODONS);  /* reference fs Forward             */
+  P7_GMX         *fsf2   = p7_gmx_fs_Create(M, L, L, p7P_CODONS);  /* candidate fs Forward             */
+  P7_GMX         *fsb1   = p7_gmx_fs_Create(M, L, L, 0);           /* reference fs Backward            */
+  P7_GMX         *fsb2   = p7_gmx_fs_Create(M, L, L, 0);           /* candidate fs Backward            */
+  P7_GMX         *fsfp   = p7_gmx_fs_Create(M, 4, L, p7P_CODONS);  /* fs Forward parser, 4 rows        */
+  P7_GMX         *fsbp   = p7_gmx_fs_Create(M, 6, L, 0);           /* fs Backward parser, 6 rows       */
+  P7_GMX         *fspp1  = p7_gmx_fs_Create(M, L, L, p7P_CODONS);  /* fs posteriors, reference F/B     */
+  P7_GMX         *fspp2  = p7_gmx_fs_Create(M, L, L, p7P_CODONS);  /* fs posteriors, tiled F/B         */
+  P7_GMX         *gx1    = p7_gmx_Create(M, Lp);
+  P7_GMX         *gx2    = p7_gmx_Create(M, Lp);
+  P7_GMX         *gxpp   = p7_gmx_Create(M, Lp);
+  P7_GMX         *gxv    = p7_gmx_Create(M, Lp);                   /* deconverted vector posteriors    */
+  P7_OMX         *ox1    = p7_omx_Create(M, Lp, Lp);
+  P7_OMX         *ox2    = p7_omx_Create(M, Lp, Lp);
+  P7_OMX         *oxp    = p7_omx_Create(M, 0, Lp);                /* parsers and filters              */
+  P7_OMX         *oxp2   = p7_omx_Create(M, 0, Lp);
+  P7_OMX         *oxc    = p7_omx_Create(M, 0, Lp);                /* checkpointed Forward             */
+  P7_OMX         *oxcpp  = p7_omx_Create(M, Lp, Lp);               /* Backward/posteriors for <oxc>    */
+  float           gtol, ftol;
+  float           sc1, sc2, fssc, gsc;
+  int             round, type, k, status;
+  int             dec_ok;
+#ifdef eslENABLE_SSE
+  P7_MSVPACK     *mp     = NULL;
+  float           psc[p7O_NLANEB];
+#endif
+
+  if (dna == NULL || aa == NULL) esl_fatal(msg);
+  p7_FLogsumInit();
+  esl_gencode_Set(gcode, 1);
+  if (p7_omx_GrowToCheckpointed(oxc, M, Lp) != eslOK) esl_fatal(msg);
+
+  /* Tolerances follow the impl unit tests: Forward-family scores and
+   * OA scores depend on whether FLogsum() uses its lookup table.
+   */
+  gtol = (p7_FLogsumError(-0.4, -0.5) > 0.0001) ? 0.1 : 0.001;
+  ftol = (p7_FLogsumError(-0.4, -0.5) > 0.0001) ? 1.0 : 0.0001;
+  kernel[K_FSFWD_PARSER].tol = 0.001;      /* the others must be exact */
+  kernel[K_FSBCK_PARSER].tol = 0.001;
+  kernel[K_FSBCK_TILED].tol  = 0.01;       /* B summed in tile order   */
+  kernel[K_FSBCK_AUTO].tol   = 0.01;
+  kernel[K_FSDEC_TILED].tol  = ptol;
+  kernel[K_FSOA_TILED].tol   = gtol;
+  kernel[K_MSV_FILTER].tol   = 0.001;
+  kernel[K_MSV_PACKED].tol   = 0.001;
+  kernel[K_VIT_FILTER].tol   = 0.001;
+  kernel[K_FWD_PARSER].tol   = ftol;
+  kernel[K_FWD_VEC].tol      = ftol;
+  kernel[K_FWD_CHK].tol      = ftol;
+  kernel[K_BCK_PARSER].tol   = ftol;
+  kernel[K_BCK_VEC].tol      = ftol;
+  kernel[K_DEC_VEC].tol      = ptol;
+  kernel[K_DEC_CHK].tol      = ptol;
+  kernel[K_OA_VEC].tol       = gtol;
+
+  for (round = 0; round < N; round++)
+    {
+      P7_HMM        *hmm   = NULL;
+      P7_PROFILE    *gm    = NULL;
+      P7_PROFILE    *gm_mf = NULL;
+      P7_PROFILE    *gm_vf = NULL;
+      P7_OPROFILE   *om    = NULL;
+      P7_FS_PROFILE *gm_fs = NULL;
+
+      /* Models: alternately gapped and ungapped. */
+      if (round % 2 == 0) { if (p7_hmm_Sample        (r, M, abc, &hmm) != eslOK) esl_fatal(msg); }
+      else                { if (p7_hmm_SampleUngapped(r, M, abc, &hmm) != eslOK) esl_fatal(msg); }
+      hmm->fs = 0.01;
+
+      if ((gm = p7_profile_Create(hmm->M, abc))                      == NULL)  esl_fatal(msg);
+      if (p7_ProfileConfig(hmm, bg, gm, Lp, p7_LOCAL)                != eslOK) esl_fatal(msg);
+      if ((om = p7_oprofile_Create(hmm->M, abc))                     == NULL)  esl_fatal(msg);
+      if (p7_oprofile_Convert(gm, om)                                != eslOK) esl_fatal(msg);
+      if (p7_oprofile_ReconfigLength(om, Lp)                         != eslOK) esl_fatal(msg);
+      if ((gm_mf = p7_profile_Clone(gm))                             == NULL)  esl_fatal(msg);
+      if ((gm_vf = p7_profile_Clone(gm))                             == NULL)  esl_fatal(msg);
+      if (p7_profile_SameAsMF(om, gm_mf)                             != eslOK) esl_fatal(msg);
+      if (p7_profile_SameAsVF(om, gm_vf)                             != eslOK) esl_fatal(msg);
+
+      /* The tiled and wavefront fills only take over from the serial
+       * one in unihit mode, as used for envelope rescoring.
+       */
+      if ((gm_fs = p7_profile_fs_Create(hmm->M, abc))                == NULL)  esl_fatal(msg);
+      if (p7_ProfileConfig_fs(hmm, bg, gcode, gm_fs, Lp, p7_LOCAL)   != eslOK) esl_fatal(msg);
+      if (p7_fs_ReconfigUnihit(gm_fs, L)                             != eslOK) esl_fatal(msg);
+
+#ifdef eslENABLE_SSE
+      if ((mp = p7_msvpack_Create(p7O_NQB(hmm->M), abc))             == NULL)  esl_fatal(msg);
+      if (p7_msvpack_Add(mp, om)                                     != eslOK) esl_fatal(msg);
+#endif
+
+      for (type = 0; type < 4; type++)
+        {
+          /* Frameshift-aware kernels on a DNA target. */
+          sample_target(r, hmm, bg, gcode, type, fsrate, csq, dna, L);
+
+          TIMED(w, K_FSFWD,        status, p7_Forward_Frameshift          (dna, gcode, L, gm_fs, fsf1, &sc1));       if (status != eslOK) esl_fatal(msg);
+          TIMED(w, K_FSFWD_PARSER, status, p7_ForwardParser_Frameshift    (dna, gcode, L, gm_fs, fsfp, &sc2));       record(K_FSFWD_PARSER, status, sc1, sc2);
+          TIMED(w, K_FSFWD_WAVE,   status, p7_Forward_Frameshift_Wavefront(dna, gcode, L, gm_fs, fsf2, pool, &sc2)); record(K_FSFWD_WAVE,   status, sc1, sc2);
+          TIMED(w, K_FSFWD_AUTO,   status, p7_ForwardAuto_Frameshift      (dna, gcode, L, gm_fs, fsf2, pool, &sc2)); record(K_FSFWD_AUTO,   status, sc1, sc2);
+          TIMED(w, K_FSFWD_TILED,  status, p7_Forward_Frameshift_Tiled    (dna, gcode, L, gm_fs, fsf2, &sc2));       record(K_FSFWD_TILED,  status, sc1, sc2);
+          kernel[K_FSFWD_TILED].maxdiff = ESL_MAX(kernel[K_FSFWD_TILED].maxdiff, gmx_maxdiff(fsf1, fsf2, hmm->M, L, p7G_NSCELLS_FS, FALSE));
+          fssc = sc1;
+
+          TIMED(w, K_FSBCK,        status, p7_Backward_Frameshift         (dna, gcode, L, gm_fs, fsb1, &sc1));       if (status != eslOK) esl_fatal(msg);
+          TIMED(w, K_FSBCK_PARSER, status, p7_BackwardParser_Frameshift   (dna, gcode, L, gm_fs, fsbp, &sc2));       record(K_FSBCK_PARSER, status, sc1, sc2);
+          TIMED(w, K_FSBCK_AUTO,   status, p7_BackwardAuto_Frameshift     (dna, gcode, L, gm_fs, fsb2, &sc2));       record(K_FSBCK_AUTO,   status, sc1, sc2);
+          TIMED(w, K_FSBCK_TILED,  status, p7_Backward_Frameshift_Tiled   (dna, gcode, L, gm_fs, fsb2, &sc2));       record(K_FSBCK_TILED,  status, sc1, sc2);
+
+          /* Decoding normalizes the Forward matrix in place, so it
+           * goes last; each pair of matrices is decoded once.
+           */
+          TIMED(w, K_FSDEC,        status, p7_Decoding_Frameshift(gm_fs, fsf1, fsb1, fspp1));                        if (status != eslOK) esl_fatal(msg);
+          TIMED(w, K_FSDEC_TILED,  status, p7_Decoding_Frameshift(gm_fs, fsf2, fsb2, fspp2));
+          if (status == eslOK) kernel[K_FSDEC_TILED].maxdiff = ESL_MAX(kernel[K_FSDEC_TILED].maxdiff, gmx_maxdiff(fspp1, fspp2, hmm->M, L, p7G_NSCELLS_FS, TRUE));
+          else                 esl_fatal(msg);
+
+          TIMED(w, K_FSOA,         status, p7_OptimalAccuracy_Frameshift(gm_fs, fspp1, fsb1, &sc1));                 if (status != eslOK) esl_fatal(msg);
+          TIMED(w, K_FSOA_TILED,   status, p7_OptimalAccuracy_Frameshift(gm_fs, fspp2, fsb2, &sc2));                 record(K_FSOA_TILED,   status, sc1, sc2);
+
+          /* Protein kernels on a protein target. */
+          sample_target(r, hmm, bg, NULL, type, 0., csq, aa, Lp);
+
+          TIMED(w, K_MSV,          status, p7_GViterbi(aa, Lp, gm_mf, gx1, &sc1));                                  if (status != eslOK) esl_fatal(msg);
+          sc1 = sc1 / om->scale_b - 3.0f;
+          TIMED(w, K_MSV_FILTER,   status, p7_MSVFilter(aa, Lp, om, oxp, &sc2));                                    record(K_MSV_FILTER,   status, sc1, sc2);
+#ifdef eslENABLE_SSE
+          TIMED(w, K_MSV_PACKED,   status, p7_MSVFilter_packed(aa, Lp, mp, psc));                                   record(K_MSV_PACKED,   status, sc1, psc[0]);
+#endif
+
+          TIMED(w, K_VIT,          status, p7_GViterbi(aa, Lp, gm_vf, gx1, &sc1));                                  if (status != eslOK) esl_fatal(msg);
+          sc1 = sc1 / om->scale_w - 3.0f;
+          TIMED(w, K_VIT_FILTER,   status, p7_ViterbiFilter(aa, Lp, om, oxp, &sc2));                                record(K_VIT_FILTER,   status, sc1, sc2);
+
+          TIMED(w, K_FWD,          status, p7_GForward(aa, Lp, gm, gx1, &sc1));                                     if (status != eslOK) esl_fatal(msg);
+          gsc = sc1;
+          TIMED(w, K_FWD_PARSER,   status, p7_ForwardParser(aa, Lp, om, oxp, &sc2));                                record(K_FWD_PARSER,   status, sc1, sc2);
+          TIMED(w, K_FWD_VEC,      status, p7_Forward(aa, Lp, om, ox1, &sc2));                                      record(K_FWD_VEC,      status, sc1, sc2);
+          TIMED(w, K_FWD_CHK,      status, p7_ForwardCheckpointed(aa, Lp, om, oxc, &sc2));                          record(K_FWD_CHK,      status, sc1, sc2);
+
+          TIMED(w, K_BCK,          status, p7_GBackward(aa, Lp, gm, gx2, &sc1));                                    if (status != eslOK) esl_fatal(msg);
+          TIMED(w, K_BCK_PARSER,   status, p7_BackwardParser(aa, Lp, om, oxp, oxp2, &sc2));                         record(K_BCK_PARSER,   status, sc1, sc2);
+          TIMED(w, K_BCK_VEC,      status, p7_Backward(aa, Lp, om, ox1, ox2, &sc2));                                record(K_BCK_VEC,      status, sc1, sc2);
+          if (p7_Backward(aa, Lp, om, oxc, oxcpp, NULL) != eslOK) esl_fatal(msg);
+
+          TIMED(w, K_DEC,          status, p7_GDecoding(gm, gx1, gx2, gxpp));                                       if (status != eslOK) esl_fatal(msg);
+          TIMED(w, K_DEC_VEC,      status, p7_Decoding(om, ox1, ox2, ox2));
+          dec_ok = (status == eslOK);
+          if      (status == eslERANGE) kernel[K_DEC_VEC].nskip++;
+          else if (status != eslOK || p7_omx_FDeconvert(ox2, gxv) != eslOK) esl_fatal(msg);
+          else    kernel[K_DEC_VEC].maxdiff = ESL_MAX(kernel[K_DEC_VEC].maxdiff, gmx_maxdiff(gxpp, gxv, hmm->M, Lp, p7G_NSCELLS, FALSE));
+          TIMED(w, K_DEC_CHK,      status, p7_DecodingCheckpointed(aa, om, oxc, oxcpp, oxcpp));
+          if      (status == eslERANGE) kernel[K_DEC_CHK].nskip++;
+          else if (status != eslOK || p7_omx_FDeconvert(oxcpp, gxv) != eslOK) esl_fatal(msg);
+          else    kernel[K_DEC_CHK].maxdiff = ESL_MAX(kernel[K_DEC_CHK].maxdiff, gmx_maxdiff(gxpp, gxv, hmm->M, Lp, p7G_NSCELLS, FALSE));
+
+          TIMED(w, K_OA,           status, p7_GOptimalAccuracy(gm, gxpp, gx1, &sc1));                               if (status != eslOK) esl_fatal(msg);
+          if (dec_ok) {
+            TIMED(w, K_OA_VEC,     status, p7_OptimalAccuracy(om, ox2, ox1, &sc2));                                 record(K_OA_VEC,       status, sc1, sc2);
+          }
+
+          if (esl_opt_GetBoolean(go, "-v"))
+            printf("model %2d target type %d: fs Forward %8.3f nats, Forward %8.3f nats\n", round, type, fssc, gsc);
+        }
+
+#ifdef eslENABLE_SSE
+      p7_msvpack_Destroy(mp);
+#endif
+      p7_profile_fs_Destroy(gm_fs);
+      p7_oprofile_Destroy(om);
+      p7_profile_Destroy(gm_vf);
+      p7_profile_Destroy(gm_mf);
+      p7_profile_Destroy(gm);
+      p7_hmm_Destroy(hmm);
+    }
+
+  report(stdout);
+
+  for (k = 0; k < K_NKERNELS; k++)
+    if (kernel[k].ref != k && kernel[k].ncalls > kernel[k].nskip && kernel[k].maxdiff > kernel[k].tol)
+      esl_fatal("%s: %s differs from %s by %g (tolerance %g)", msg, kernel[k].name, kernel[kernel[k].ref].name, kernel[k].maxdiff, kernel[k].tol);
+
+  free(aa);
+  free(dna);
+  p7_omx_Destroy(oxcpp);
+  p7_omx_Destroy(oxc);
+  p7_omx_Destroy(oxp2);
+  p7_omx_Destroy(oxp);
+  p7_omx_Destroy(ox2);
+  p7_omx_Destroy(ox1);
+  p7_gmx_Destroy(gxv);
+  p7_gmx_Destroy(gxpp);
+  p7_gmx_Destroy(gx2);
+  p7_gmx_Destroy(gx1);
+  p7_gmx_Destroy(fspp2);
+  p7_gmx_Destroy(fspp1);
+  p7_gmx_Destroy(fsbp);
+  p7_gmx_Destroy(fsfp);
+  p7_gmx_Destroy(fsb2);
+  p7_gmx_Destroy(fsb1);
+  p7_gmx_Destroy(fsf2);
+  p7_gmx_Destroy(fsf1);
+  esl_sq_Destroy(csq);
+  p7_fs_wavepool_Destroy(pool);
+  p7_bg_Destroy(bg);
+  esl_gencode_Destroy(gcode);
+  esl_alphabet_Destroy(abcDNA);
+  esl_alphabet_Destroy(abc);
+  esl_stopwatch_Destroy(w);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+
+  printf("ok\n");
+  return 0;
+}
+
+
+/* sample_target()
+ * Sample target <dsq>[1..L] of <type> (0..3, see top of file). If
+ * <gcode> is non-NULL it's a DNA target: emitted cores are
+ * back-translated, choosing uniformly among synonymous codons, and
+ * each codon is followed by a 1-nt insertion or loses one of its
+ * nucleotides with probability <fsrate>/2 each. Cores longer than
+ * <L> are truncated. <csq> is workspace for the emitted core.
+ */
+static void
+sample_target(ESL_RANDOMNESS *r, const P7_HMM *hmm, const P7_BG *bg, const ESL_GENCODE *gcode, int type, double fsrate,
+              ESL_SQ *csq, ESL_DSQ *dsq, int L)
+{
+  const ESL_ALPHABET *abc   = (gcode ? gcode->nt_abc : hmm->abc);
+  double              fq[4] = { 0.25, 0.25, 0.25, 0.25 };
+  ESL_DSQ            *core  = NULL;
+  int                 n     = 0;
+  int                 ncodon[64];     /* ncodon[a]: number of codons for amino acid a */
+  int                 codon[64][64];  /* codon[a][0..ncodon[a]-1]                     */
+  int                 i, c, a, x, off;
+
+  if (gcode) esl_rsq_xfIID(r, fq,    4,      L, dsq);
+  else       esl_rsq_xfIID(r, bg->f, abc->K, L, dsq);
+
+  if (type >= 2)
+    {
+      if (p7_CoreEmit(r, hmm, csq, NULL) != eslOK) esl_fatal("core emission failed");
+
+      if (gcode)
+        {
+          for (a = 0; a < 64; a++) ncodon[a] = 0;
+          for (c = 0; c < 64; c++)
+            if (gcode->basic[c] < hmm->abc->K) { a = gcode->basic[c]; codon[a][ncodon[a]++] = c; }
+
+          if ((core = malloc(sizeof(ESL_DSQ) * (4 * csq->n + 1))) == NULL) esl_fatal("malloc failed");
+          for (i = 1; i <= csq->n; i++)
+            {
+              a = csq->dsq[i];
+              if (a >= hmm->abc->K || ncodon[a] == 0) continue;
+              c = codon[a][esl_rnd_Roll(r, ncodon[a])];
+              core[n++] = c / 16;
+              core[n++] = (c / 4) % 4;
+              core[n++] = c % 4;
+              if (esl_rnd_UniformPositive(r) < fsrate)
+                {
+                  if (esl_rnd_Roll(r, 2)) core[n++] = esl_rnd_Roll(r, 4);                 /* insertion */
+                  else { x = n - 1 - esl_rnd_Roll(r, 3); memmove(core+x, core+x+1, n-x-1); n--; } /* deletion  */
+                }
+            }
+        }
+      else
+        {
+          core = csq->dsq + 1;
+          n    = csq->n;
+        }
+
+      n   = ESL_MIN(n, L);
+      off = esl_rnd_Roll(r, L - n + 1);
+      memcpy(dsq + 1 + off, core, n);
+      if (gcode) free(core);
+    }
+
+  /* Degenerate residues: codes K+1..Kp-3 are the degeneracies, ending with the unknown residue */
+  if (type % 2 == 1)
+    for (i = 0; i < 1 + L/100; i++)
+      dsq[1 + esl_rnd_Roll(r, L)] = abc->K + 1 + esl_rnd_Roll(r, abc->Kp - abc->K - 3);
+}
+
+
+/* gmx_maxdiff()
+ * Max absolute difference between corresponding cells of two
+ * matrices with <nscells> cells per node, over rows 0..L and nodes
+ * 0..M, including the special states. With <logspace>, cells are log
+ * probabilities, compared as probabilities. Cells that are -inf in
+ * both count as equal.
+ */
+static float
+gmx_maxdiff(const P7_GMX *gx1, const P7_GMX *gx2, int M, int L, int nscells, int logspace)
+{
+  float maxdiff = 0.;
+  float a, b;
+  int   i, k, s;
+
+  for (i = 0; i <= L; i++)
+    {
+      for (k = 0; k <= M; k++)
+        for (s = 0; s < nscells; s++)
+          {
+            a = gx1->dp[i][k*nscells+s];
+            b = gx2->dp[i][k*nscells+s];
+            if (a == b) continue;
+            if (logspace) { a = expf(a); b = expf(b); }
+            maxdiff = ESL_MAX(maxdiff, fabsf(a-b));
+          }
+      for (s = 0; s < p7G_NXCELLS; s++)
+        {
+          a = gx1->xmx[i*p7G_NXCELLS+s];
+          b = gx2->xmx[i*p7G_NXCELLS+s];
+          if (a == b) continue;
+          if (logspace) { a = expf(a); b = expf(b); }
+          maxdiff = ESL_MAX(maxdiff, fabsf(a-b));
+        }
+    }
+  return maxdiff;
+}
+
+
+/* record()
+ * Compare score <val> of kernel <k> to its reference score <ref>. A
+ * vector kernel's eslERANGE (overflow) counts as a skip; any other
+ * error is fatal.
+ */
+static void
+record(int k, int status, double ref, double val)
+{
+  if      (status == eslERANGE) { kernel[k].nskip++; return; }
+  else if (status != eslOK)     esl_fatal("kernels integration test failed: %s returned %d", kernel[k].name, status);
+  if (ref == val) return;
+  kernel[k].maxdiff = ESL_MAX(kernel[k].maxdiff, fabs(ref - val));
+}
+
+
+/* report()
+ * One line per kernel: calls, skips, max difference from the family
+ * reference and its tolerance, total time, and speed relative to the
+ * reference (>1 is faster).
+ */
+static void
+report(FILE *ofp)
+{
+  int k;
+
+  fprintf(ofp, "# %-12s %-30s %6s %5s %10s %8s %10s %8s\n", "family", "kernel", "calls", "skip", "max|diff|", "tol", "seconds", "speedup");
+  fprintf(ofp, "# %-12s %-30s %6s %5s %10s %8s %10s %8s\n", "------------", "------------------------------", "------", "-----", "----------", "--------", "----------", "--------");
+  for (k = 0; k < K_NKERNELS; k++)
+    {
+      if (kernel[k].ncalls == 0)
+        fprintf(ofp, "  %-12s %-30s %6s\n", kernel[k].family, kernel[k].name, "not built");
+      else if (kernel[k].ref == k)
+        fprintf(ofp, "  %-12s %-30s %6d %5d %10s %8s %10.4f %8s\n", kernel[k].family, kernel[k].name, kernel[k].ncalls, kernel[k].nskip, "(ref)", "-", kernel[k].secs, "1.00");
+      else
+        fprintf(ofp, "  %-12s %-30s %6d %5d %10.3g %8.3g %10.4f %8.2f\n", kernel[k].family, kernel[k].name, kernel[k].ncalls, kernel[k].nskip,
+                kernel[k].maxdiff, kernel[k].tol, kernel[k].secs,
+                kernel[k].secs > 0. ? kernel[kernel[k].ref].secs / kernel[k].secs : 0.);
+    }
+}
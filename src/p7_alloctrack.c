@@ -0,0 +1,379 @@
+/* Allocation accounting per pipeline stage.
+ *
+ * The BATH pipeline allocates in its inner loops: coordinate arrays,
+ * ORF copies, a Forward matrix per ORF, frameshift DP matrices for
+ * rescoring, bias filter matrices, traces and alignment displays.
+ * bathsearch --alloctrack counts those allocations by pipeline stage
+ * (the stages of <P7_PERFCTR>: filters, Forward, domain definition,
+ * alignment), to show where allocation elimination will pay.
+ *
+ * Most of these allocations are made inside Easel and the DP
+ * libraries, not by pipeline code, so wrapping our own allocation
+ * macros would miss them. Instead, a build configured with
+ * --enable-alloctrack (glibc only) interposes malloc(), calloc(),
+ * realloc() and free(), forwarding to glibc's own and, when the
+ * calling thread is inside an instrumented stage, counting the
+ * call against that stage. The stage is a thread-local tag set by
+ * <p7_alloctrack_Enter()>/<p7_alloctrack_Leave()>; outside a stage,
+ * or if tracking was never enabled, the wrappers only forward. Block
+ * sizes are glibc's usable sizes, so bytes include malloc's rounding.
+ *
+ * For each stage we count allocations, frees, bytes allocated, and
+ * the peak live bytes of a single pass through the stage (bytes
+ * allocated minus bytes freed since the stage was entered). Each
+ * thread keeps its own counts; <p7_alloctrack_Report()> sums them.
+ *
+ * Without --enable-alloctrack, <p7_alloctrack_Enable()> returns
+ * <eslEUNIMPLEMENTED> and the rest of the interface does nothing.
+ *
+ * Contents:
+ *   1. Enabling, and stage tags
+ *   2. The allocator wrappers
+ *   3. Reporting
+ *   4. Unit tests
+ *   5. Test driver
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef p7_ALLOCTRACK
+#include <malloc.h>
+#endif
+#ifdef HMMER_THREADS
+#include <pthread.h>
+#endif
+
+#include "easel.h"
+
+#include "hmmer.h"
+
+#ifdef p7_ALLOCTRACK
+typedef struct {
+  uint64_t nalloc;       /* # of malloc/calloc/realloc calls     */
+  uint64_t nfree;        /* # of free calls (and realloc moves)  */
+  uint64_t bytes;        /* usable bytes allocated               */
+  int64_t  live;         /* net bytes since the stage was entered */
+  int64_t  peak;         /* max of <live> over any one pass      */
+} AT_STAGE;
+
+typedef struct at_thread_s {
+  AT_STAGE             st[p7_PERF_NSTAGES];
+  struct at_thread_s  *next;
+} AT_THREAD;
+
+extern void *__libc_malloc (size_t n);
+extern void *__libc_calloc (size_t nmemb, size_t n);
+extern void *__libc_realloc(void *p, size_t n);
+extern void  __libc_free   (void *p);
+
+static int              at_enabled = FALSE;
+static AT_THREAD       *at_threads = NULL;   /* every thread that has entered a stage */
+static __thread int        at_stage  = -1;   /* this thread's current stage, or -1     */
+static __thread AT_THREAD *at_thr    = NULL; /* this thread's counts                  */
+#ifdef HMMER_THREADS
+static pthread_mutex_t  at_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#endif /*p7_ALLOCTRACK*/
+
+
+/*****************************************************************
+ *= 1. Enabling, and stage tags
+ *****************************************************************/
+
+/* Function:  p7_alloctrack_Enable()
+ * Synopsis:  Turn on allocation accounting.
+ *
+ * Purpose:   Start counting allocations in instrumented pipeline
+ *            stages, in all threads. Call once, before any searching.
+ *
+ * Returns:   <eslOK> on success; <eslEUNIMPLEMENTED> if this build
+ *            was not configured with --enable-alloctrack.
+ */
+int
+p7_alloctrack_Enable(void)
+{
+#ifdef p7_ALLOCTRACK
+  at_enabled = TRUE;
+  return eslOK;
+#else
+  return eslEUNIMPLEMENTED;
+#endif
+}
+
+/* Function:  p7_alloctrack_Enter()
+ * Synopsis:  Tag this thread's allocations with a pipeline stage.
+ *
+ * Purpose:   Attribute the calling thread's allocations and frees to
+ *            <stage> (one of the <p7_PERF_*> stages) until the matching
+ *            <p7_alloctrack_Leave()>, and start a new pass for the
+ *            stage's peak live bytes. Stages don't nest; entering a
+ *            stage while in another is ignored. A no-op unless
+ *            tracking is enabled.
+ */
+void
+p7_alloctrack_Enter(int stage)
+{
+#ifdef p7_ALLOCTRACK
+  if (! at_enabled || at_stage != -1) return;
+
+  if (at_thr == NULL)
+    {
+      if ((at_thr = __libc_calloc(1, sizeof(AT_THREAD))) == NULL) return;
+#ifdef HMMER_THREADS
+      pthread_mutex_lock(&at_mutex);
+#endif
+      at_thr->next = at_threads;
+      at_threads   = at_thr;
+#ifdef HMMER_THREADS
+      pthread_mutex_unlock(&at_mutex);
+#endif
+    }
+  at_thr->st[stage].live = 0;
+  at_stage = stage;
+#endif
+}
+
+/* Function:  p7_alloctrack_Leave()
+ * Synopsis:  End a stage tag set by <p7_alloctrack_Enter()>.
+ */
+void
+p7_alloctrack_Leave(int stage)
+{
+#ifdef p7_ALLOCTRACK
+  if (at_stage == stage) at_stage = -1;
+#endif
+}
+/*------------------ end, enabling and stage tags ---------------*/
+
+
+/*****************************************************************
+ *= 2. The allocator wrappers
+ *****************************************************************/
+#ifdef p7_ALLOCTRACK
+
+static void
+at_count_alloc(void *p)
+{
+  AT_STAGE *s = &(at_thr->st[at_stage]);
+  size_t    n = malloc_usable_size(p);
+
+  s->nalloc++;
+  s->bytes += n;
+  s->live  += n;
+  if (s->live > s->peak) s->peak = s->live;
+}
+
+static void
+at_count_free(size_t n)
+{
+  AT_STAGE *s = &(at_thr->st[at_stage]);
+
+  s->nfree++;
+  s->live -= n;
+}
+
+void *
+malloc(size_t n)
+{
+  void *p = __libc_malloc(n);
+  if (at_stage >= 0 && p != NULL) at_count_alloc(p);
+  return p;
+}
+
+void *
+calloc(size_t nmemb, size_t n)
+{
+  void *p = __libc_calloc(nmemb, n);
+  if (at_stage >= 0 && p != NULL) at_count_alloc(p);
+  return p;
+}
+
+void *
+realloc(void *old, size_t n)
+{
+  size_t oldn = (at_stage >= 0 && old != NULL) ? malloc_usable_size(old) : 0;
+  void  *p    = __libc_realloc(old, n);
+
+  if (at_stage >= 0 && p != NULL)
+    {
+      if (old != NULL) at_count_free(oldn);
+      at_count_alloc(p);
+    }
+  return p;
+}
+
+void
+free(void *p)
+{
+  if (at_stage >= 0 && p != NULL) at_count_free(malloc_usable_size(p));
+  __libc_free(p);
+}
+#endif /*p7_ALLOCTRACK*/
+/*------------------ end, allocator wrappers --------------------*/
+
+
+/*****************************************************************
+ *= 3. Reporting
+ *****************************************************************/
+
+/* Function:  p7_alloctrack_Report()
+ * Synopsis:  Print allocation counts by pipeline stage.
+ *
+ * Purpose:   Print a table to <ofp> of allocations, frees, megabytes
+ *            allocated, and the largest peak live megabytes of one pass
+ *            through each stage, summed (or, for the peak, maximized)
+ *            over all threads that have run instrumented stages. Call
+ *            when no thread is searching.
+ *
+ *            If tracking isn't available in this build, print a line
+ *            saying so.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEWRITE> on write failure.
+ */
+int
+p7_alloctrack_Report(FILE *ofp)
+{
+#ifdef p7_ALLOCTRACK
+  static const char *stage_name[p7_PERF_NSTAGES] = { "filters", "forward", "domaindef", "alignment" };
+  AT_THREAD *t;
+  AT_STAGE   tot;
+  int        nthread = 0;
+  int        s;
+
+  for (t = at_threads; t != NULL; t = t->next) nthread++;
+  if (fprintf(ofp, "Allocations by pipeline stage, %d thread%s:\n", nthread, nthread == 1 ? "" : "s") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (fprintf(ofp, "  %-10s %14s %14s %12s %12s\n", "stage", "allocs", "frees", "MB alloc", "peak MB") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  for (s = 0; s < p7_PERF_NSTAGES; s++)
+    {
+      memset(&tot, 0, sizeof(AT_STAGE));
+      for (t = at_threads; t != NULL; t = t->next)
+        {
+          tot.nalloc += t->st[s].nalloc;
+          tot.nfree  += t->st[s].nfree;
+          tot.bytes  += t->st[s].bytes;
+          tot.peak    = ESL_MAX(tot.peak, t->st[s].peak);
+        }
+      if (fprintf(ofp, "  %-10s %14" PRIu64 " %14" PRIu64 " %12.1f %12.3f\n", stage_name[s],
+                  tot.nalloc, tot.nfree, (double) tot.bytes / 1048576., (double) tot.peak / 1048576.) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+    }
+#else
+  if (fprintf(ofp, "Allocations by pipeline stage:       unavailable (configure with --enable-alloctrack)\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+#endif
+  return eslOK;
+}
+/*----------------------- end, reporting ------------------------*/
+
+
+
+/*****************************************************************
+ *= 4. Unit tests
+ *****************************************************************/
+#ifdef p7ALLOCTRACK_TESTDRIVE
+
+/* Allocations inside a stage are counted against it, and only
+ * against it; allocations outside any stage aren't counted; the peak
+ * is the high-water mark of one pass. Without --enable-alloctrack,
+ * Enable() must say so and the rest must be harmless no-ops.
+ */
+static void
+utest_stages(void)
+{
+  char  *msg = "p7_alloctrack stages unit test failed";
+  FILE  *ofp = tmpfile();
+  void  *(* volatile my_malloc) (size_t)          = malloc;   /* called through volatile pointers, */
+  void  *(* volatile my_calloc) (size_t, size_t)  = calloc;   /* so the compiler can't elide the   */
+  void  *(* volatile my_realloc)(void *, size_t)  = realloc;  /* malloc/free pairs                 */
+  void   (* volatile my_free)   (void *)          = free;
+  char  *p, *q;
+  int    status;
+
+  if (ofp == NULL) esl_fatal(msg);
+
+  status = p7_alloctrack_Enable();
+#ifdef p7_ALLOCTRACK
+  if (status != eslOK) esl_fatal(msg);
+
+  p = my_malloc(1000);                       /* not in a stage: not counted */
+  my_free(p);
+  if (at_thr != NULL) esl_fatal(msg);
+
+  p7_alloctrack_Enter(p7_PERF_FORWARD);
+  p7_alloctrack_Enter(p7_PERF_FILTERS);      /* stages don't nest: ignored */
+  p = my_malloc(1000);
+  q = my_calloc(10, 100);
+  q = my_realloc(q, 100000);
+  my_free(p);
+  my_free(q);
+  p7_alloctrack_Leave(p7_PERF_FILTERS);      /* ignored */
+  p = my_malloc(1000);
+  my_free(p);
+  p7_alloctrack_Leave(p7_PERF_FORWARD);
+
+  if (at_thr == NULL)                                 esl_fatal(msg);
+  if (at_thr->st[p7_PERF_FILTERS].nalloc != 0)        esl_fatal(msg);
+  if (at_thr->st[p7_PERF_FORWARD].nalloc != 4)        esl_fatal(msg);
+  if (at_thr->st[p7_PERF_FORWARD].nfree  != 4)        esl_fatal(msg);  /* includes the realloc move */
+  if (at_thr->st[p7_PERF_FORWARD].live   != 0)        esl_fatal(msg);
+  if (at_thr->st[p7_PERF_FORWARD].bytes  <  103000)   esl_fatal(msg);
+  if (at_thr->st[p7_PERF_FORWARD].peak   <  101000)   esl_fatal(msg);
+  if (at_thr->st[p7_PERF_FORWARD].peak   >  at_thr->st[p7_PERF_FORWARD].bytes) esl_fatal(msg);
+
+  p = my_malloc(1000);                       /* after leaving: not counted */
+  my_free(p);
+  if (at_thr->st[p7_PERF_FORWARD].nalloc != 4)        esl_fatal(msg);
+#else
+  if (status != eslEUNIMPLEMENTED) esl_fatal(msg);
+  p7_alloctrack_Enter(p7_PERF_FORWARD);
+  p = my_malloc(1000);
+  q = my_calloc(10, 100);
+  q = my_realloc(q, 100000);
+  my_free(p);
+  my_free(q);
+  p7_alloctrack_Leave(p7_PERF_FORWARD);
+#endif
+
+  if (p7_alloctrack_Report(ofp) != eslOK) esl_fatal(msg);
+  fclose(ofp);
+}
+#endif /*p7ALLOCTRACK_TESTDRIVE*/
+
+/*****************************************************************
+ *= 5. Test driver
+ *****************************************************************/
+#ifdef p7ALLOCTRACK_TESTDRIVE
+/*
+  gcc -o p7_alloctrack_utest -g -Wall -I. -L. -I../easel -L../easel -Dp7ALLOCTRACK_TESTDRIVE p7_alloctrack.c -lhmmer -leasel -lm
+  ./p7_alloctrack_utest
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name  type         default  env   range togs  reqs  incomp  help                   docgrp */
+  { "-h",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show help and usage",           0 },
+  { 0,0,0,0,0,0,0,0,0,0},
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for p7_alloctrack.c";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS *go = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+
+  utest_stages();
+
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7ALLOCTRACK_TESTDRIVE*/
+/*---------------------- end, test driver ----------------------*/
@@ -0,0 +1,792 @@
+/* P7_BATHSEARCH: a translated search of in-memory DNA, for programs
+ * that link libhmmer.
+ *
+ * A <P7_BATHSEARCH> holds one query model and everything bathsearch
+ * sets up around it (genetic code, profiles, pipeline, hit list). The
+ * caller hands it target DNA as text, in as many pieces as it likes;
+ * each time a window's worth of a target has arrived, that window is
+ * searched on both strands with <p7_Pipeline_BATH()>, exactly as
+ * bathsearch searches the windows it reads from a file, and any new
+ * hits are passed to an optional callback. When all targets are in,
+ * <p7_bathsearch_Finish()> computes E-values, removes the duplicates
+ * that overlapping windows produce, and applies the reporting and
+ * inclusion thresholds.
+ *
+ * Search options are given as a string in bathsearch's command line
+ * syntax ("-E 1e-5 --ct 11 --strand plus"), like the options sent to
+ * hmmpgmd. Objects share no state, so a threaded program gives each
+ * thread its own <P7_BATHSEARCH>; to search a library of models,
+ * read each one with <p7_hmmfile_Read()> and create a search for it.
+ *
+ * Contents:
+ *   1. The <P7_BATHSEARCH> object
+ *   2. Searching targets
+ *   3. Internal routines
+ *   4. Unit tests
+ *   5. Test driver
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_gencode.h"
+#include "esl_getopts.h"
+#include "esl_sq.h"
+
+#include "hmmer.h"
+
+#define REPOPTS     "-E,-T"
+#define DOMREPOPTS  "--domE,--domT"
+#define INCOPTS     "--incE,--incT"
+#define INCDOMOPTS  "--incdomE,--incdomT"
+
+/* The subset of bathsearch's options that affect one search, under
+ * the same names, so a caller can pass a bathsearch option string.
+ * p7_pipeline_fs_Create() (with <bath_opts> TRUE) and
+ * esl_gencode_WorkstateCreate() look up their options unconditionally,
+ * and esl_getopts fails on a name that isn't in the table, so theirs
+ * must all be here even where they have no effect on a search.
+ */
+static ESL_OPTIONS searchOpts[] = {
+  /* name             type            default    env   range      toggles reqs  incomp           help                                                                 docgroup*/
+  { "--acc",          eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL, NULL,            "prefer accessions over names in output",                            2 },
+  { "--noali",        eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL, NULL,            "don't output alignments, so output is smaller",                     2 },
+  { "--notrans",      eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL, NULL,            "don't show the translated DNA sequence in  alignment",              2 },
+  { "--frameline",    eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL, NULL,            "include frame of each codon in  alignment",                         2 },
+  { "--cigar",        eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL, NULL,            "include alignment CIGAR string in table output",                    2 },
+  { "--fstblout",     eslARG_OUTFILE, NULL,      NULL, NULL,      NULL,   NULL, NULL,            "accepted; <f> unused: caller writes p7_tophits_TabularFrameshifts()", 2 },
+  { "-E",             eslARG_REAL,   "10.0",     NULL, "x>0",     NULL,   NULL, REPOPTS,         "report sequences <= this E-value threshold in output",              4 },
+  { "-T",             eslARG_REAL,    FALSE,     NULL, NULL,      NULL,   NULL, REPOPTS,         "report sequences >= this score threshold in output",                4 },
+  { "--incE",         eslARG_REAL,   "0.01",     NULL, "x>0",     NULL,   NULL, INCOPTS,         "consider sequences <= this E-value threshold as significant",       4 },
+  { "--incT",         eslARG_REAL,    FALSE,     NULL, NULL,      NULL,   NULL, INCOPTS,         "consider sequences >= this score threshold as significant",         4 },
+  { "--max",          eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL,"--F1,--F2,--F3", "turn all heuristic filters off (less speed, more power)",           7 },
+  { "--F1",           eslARG_REAL,   "0.02",     NULL, NULL,      NULL,   NULL,"--max",          "stage 1 (MSV) threshold: promote hits w/ P <= F1",                  7 },
+  { "--F2",           eslARG_REAL,   "1e-3",     NULL, NULL,      NULL,   NULL,"--max",          "stage 2 (Vit) threshold: promote hits w/ P <= F2",                  7 },
+  { "--F3",           eslARG_REAL,   "1e-5",     NULL, NULL,      NULL,   NULL,"--max",          "stage 3 (Fwd) threshold: promote hits w/ P <= F3",                  7 },
+  { "--nobias",       eslARG_NONE,    NULL,      NULL, NULL,      NULL,   NULL,"--max",          "turn off composition bias filter",                                  7 },
+  { "--nonull2",      eslARG_NONE,    NULL,      NULL, NULL,      NULL,   NULL, NULL,            "turn off biased composition score corrections",                     7 },
+  { "--fsonly",       eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL,"--nofs",         "send all potential hits to the frameshift aware pipeline",          7 },
+  { "--nofs",         eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL,"--fsonly",       "send all potential hits to the non-frameshift aware pipeline",      7 },
+  { "--tmask",        eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL, NULL,            "mask low-complexity target DNA (dust) and translations (SEG)",      7 },
+  { "-Z",             eslARG_REAL,    FALSE,     NULL, "x>=0",    NULL,   NULL, NULL,            "set database size (Megabases) to <x> for E-value calculations",     12 },
+  { "--seed",         eslARG_INT,    "42",       NULL, "n>=0",    NULL,   NULL, NULL,            "set RNG seed to <n> (if 0: one-time arbitrary seed)",               12 },
+  { "--block_length", eslARG_INT,     NULL,      NULL, "n>=50000",NULL,   NULL, NULL,            "length of the windows targets are searched in",                     12 },
+  { "--perfctr",      eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL, NULL,            "count hardware performance events per pipeline stage",              12 },
+#ifdef HMMER_THREADS
+  { "--fwd_cpu",      eslARG_INT,       "0",     NULL, "n>=0",    NULL,   NULL, NULL,            "threads for Forward on very large frameshift envelopes (0,1: no split)", 12 },
+#endif
+  { "--ct",           eslARG_INT,    "1",        NULL, NULL,      NULL,   NULL, NULL,            "use alt genetic code of NCBI translation table",                    15 },
+  { "-l",             eslARG_INT,    "20",       NULL, NULL,      NULL,   NULL, NULL,            "minimum ORF length",                                                15 },
+  { "-m",             eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL,"-M",             "ORFs must initiate with AUG only",                                  15 },
+  { "-M",             eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL,"-m",             "ORFs must start with allowed initiation codon",                     15 },
+  { "--strand",       eslARG_STRING, "both",     NULL, NULL,      NULL,   NULL, NULL,            "search only the 'plus' or 'minus' strand, or 'both'",               15 },
+  { "--B1",           eslARG_INT,    "110",      NULL, NULL,      NULL,   NULL,"--max,--nobias", "window length for biased-composition modifier (SSV)",               99 },
+  { "--B2",           eslARG_INT,    "240",      NULL, NULL,      NULL,   NULL,"--max,--nobias", "window length for biased-composition modifier (Vit)",               99 },
+  { "--B3",           eslARG_INT,    "1000",     NULL, NULL,      NULL,   NULL,"--max,--nobias", "window length for biased-composition modifier (Fwd)",               99 },
+  { "--domZ",         eslARG_REAL,    FALSE,     NULL, "x>0",     NULL,   NULL, NULL,            "Not used",                                                          99 },
+  { "--domE",         eslARG_REAL,   "10.0",     NULL, "x>0",     NULL,   NULL, DOMREPOPTS,      "Not used",                                                          99 },
+  { "--domT",         eslARG_REAL,    FALSE,     NULL, NULL,      NULL,   NULL, DOMREPOPTS,      "Not used",                                                          99 },
+  { "--incdomE",      eslARG_REAL,   "0.01",     NULL, "x>0",     NULL,   NULL, INCDOMOPTS,      "Not used",                                                          99 },
+  { "--incdomT",      eslARG_REAL,    FALSE,     NULL, NULL,      NULL,   NULL, INCDOMOPTS,      "Not used",                                                          99 },
+  { "--crick",        eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL, NULL,            "only translate top strand",                                         99 },
+  { "--watson",       eslARG_NONE,    FALSE,     NULL, NULL,      NULL,   NULL, NULL,            "only translate bottom strand",                                      99 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+
+static int bathsearch_pipeline(P7_BATHSEARCH *bs);
+static int search_window      (P7_BATHSEARCH *bs);
+static int report_new_hits    (P7_BATHSEARCH *bs, int first);
+
+
+/*****************************************************************
+ *= 1. The <P7_BATHSEARCH> object
+ *****************************************************************/
+
+/* Function:  p7_bathsearch_Create()
+ * Synopsis:  Set up a translated search with one protein model.
+ *
+ * Purpose:   Create a search of DNA targets with query model <hmm>,
+ *            configured by <opts>, a string of bathsearch options
+ *            (<NULL> or "" for the defaults). Return it in
+ *            <*ret_bs>.
+ *
+ *            If <hmm> has no maximum hit length yet, one is
+ *            computed and set in it. <hmm> isn't needed once the
+ *            search has been created.
+ *
+ *            <--fstblout <f>> is accepted as in bathsearch, but <f>
+ *            isn't opened: the hits always carry the traces that
+ *            <p7_tophits_TabularFrameshifts()> writes the table from.
+ *            <--fwd_cpu> (threaded builds) splits Forward on very
+ *            large frameshift envelopes over threads.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ *            <eslEINVAL> if <opts> can't be parsed, or <hmm> isn't a
+ *            protein model; <eslENOTFOUND> if <--ct> isn't an NCBI
+ *            translation table. In either case <errbuf>, if
+ *            non-<NULL>, contains an error message, and <*ret_bs> is
+ *            <NULL>.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_bathsearch_Create(P7_HMM *hmm, const char *opts, P7_BATHSEARCH **ret_bs, char *errbuf)
+{
+  P7_BATHSEARCH *bs      = NULL;
+  char          *cmdline = NULL;
+  char          *strand;
+  int            status;
+
+  if (errbuf) errbuf[0] = '\0';
+  if (hmm->abc->type != eslAMINO) ESL_XFAIL(eslEINVAL, errbuf, "query model %s is not a protein model", hmm->name);
+
+  ESL_ALLOC(bs, sizeof(P7_BATHSEARCH));
+  bs->go        = NULL;
+  bs->abcDNA    = NULL;
+  bs->abcAA     = NULL;
+  bs->gcode     = NULL;
+  bs->wrk1      = NULL;
+  bs->wrk2      = NULL;
+  bs->bg        = NULL;
+  bs->gm        = NULL;
+  bs->gm_fs     = NULL;
+  bs->om        = NULL;
+  bs->scoredata = NULL;
+  bs->pli       = NULL;
+  bs->th        = NULL;
+  bs->win       = NULL;
+  bs->tidx      = -1;
+  bs->tL        = 0;
+  bs->tfirst    = 0;
+  bs->ntargets  = 0;
+  bs->hitfunc   = NULL;
+  bs->hitarg    = NULL;
+  bs->errbuf[0] = '\0';
+
+  /* search options */
+  if ((status = esl_sprintf(&cmdline, "p7_bathsearch %s", (opts == NULL ? "" : opts))) != eslOK) goto ERROR;
+  if ((bs->go = esl_getopts_Create(searchOpts)) == NULL) { status = eslEMEM; goto ERROR; }
+  if (esl_opt_ProcessSpoof(bs->go, cmdline) != eslOK) ESL_XFAIL(eslEINVAL, errbuf, "%s", bs->go->errbuf);
+  if (esl_opt_VerifyConfig(bs->go)          != eslOK) ESL_XFAIL(eslEINVAL, errbuf, "%s", bs->go->errbuf);
+  strand = esl_opt_GetString(bs->go, "--strand");
+  if (strcmp(strand, "both") != 0 && strcmp(strand, "plus") != 0 && strcmp(strand, "minus") != 0)
+    ESL_XFAIL(eslEINVAL, errbuf, "Unrecognized argument for --strand ('%s'). Only 'both', 'plus', and 'minus' allowed.", strand);
+
+  /* translation */
+  bs->abcDNA = esl_alphabet_Create(eslDNA);
+  bs->abcAA  = esl_alphabet_Create(eslAMINO);
+  if (bs->abcDNA == NULL || bs->abcAA == NULL) { status = eslEMEM; goto ERROR; }
+  if ((bs->gcode = esl_gencode_Create(bs->abcDNA, bs->abcAA)) == NULL) { status = eslEMEM; goto ERROR; }
+  if (esl_gencode_Set(bs->gcode, esl_opt_GetInteger(bs->go, "--ct")) != eslOK)
+    ESL_XFAIL(eslENOTFOUND, errbuf, "%d is not an NCBI translation table id", esl_opt_GetInteger(bs->go, "--ct"));
+  if      (esl_opt_GetBoolean(bs->go, "-m"))   esl_gencode_SetInitiatorOnlyAUG(bs->gcode);
+  else if (! esl_opt_GetBoolean(bs->go, "-M")) esl_gencode_SetInitiatorAny(bs->gcode);
+
+  bs->wrk1 = esl_gencode_WorkstateCreate(bs->go, bs->gcode);
+  bs->wrk2 = esl_gencode_WorkstateCreate(bs->go, bs->gcode);
+  if (bs->wrk1 == NULL || bs->wrk2 == NULL) { status = eslEMEM; goto ERROR; }
+  bs->wrk1->orf_block = esl_sq_CreateDigitalBlock(p7_BATHSEARCH_ORFBLOCK, bs->abcAA);
+  bs->wrk2->orf_block = esl_sq_CreateDigitalBlock(p7_BATHSEARCH_ORFBLOCK, bs->abcAA);
+  if (bs->wrk1->orf_block == NULL || bs->wrk2->orf_block == NULL) { status = eslEMEM; goto ERROR; }
+
+  /* query profiles, configured as bathsearch configures them */
+  if (hmm->max_length == -1) p7_Builder_MaxLength(hmm, p7_DEFAULT_WINDOW_BETA);
+  bs->bg    = p7_bg_fs_Create(bs->abcAA);
+  bs->gm    = p7_profile_Create   (hmm->M, bs->abcAA);
+  bs->gm_fs = p7_profile_fs_Create(hmm->M, bs->abcAA);
+  bs->om    = p7_oprofile_Create  (hmm->M, bs->abcAA);
+  if (bs->bg == NULL || bs->gm == NULL || bs->gm_fs == NULL || bs->om == NULL) { status = eslEMEM; goto ERROR; }
+  if ((status = p7_ProfileConfig   (hmm, bs->bg,            bs->gm,    100, p7_LOCAL)) != eslOK) goto ERROR;
+  if ((status = p7_oprofile_Convert(bs->gm, bs->om))                                    != eslOK) goto ERROR;
+  if ((status = p7_ProfileConfig_fs(hmm, bs->bg, bs->gcode, bs->gm_fs, 100, p7_LOCAL)) != eslOK) goto ERROR;
+  if ((bs->scoredata = p7_hmm_ScoreDataCreate(bs->om, NULL)) == NULL) { status = eslEMEM; goto ERROR; }
+
+  if ((status = bathsearch_pipeline(bs)) != eslOK) goto ERROR;
+  if (bs->om->max_length >= bs->pli->block_length)
+    ESL_XFAIL(eslEINVAL, errbuf, "--block_length must be longer than the query's maximum hit length (%d)", bs->om->max_length);
+
+  if ((bs->win = esl_sq_CreateDigital(bs->abcDNA)) == NULL) { status = eslEMEM; goto ERROR; }
+  if ((status  = esl_sq_GrowTo(bs->win, bs->pli->block_length)) != eslOK) goto ERROR;
+
+  free(cmdline);
+  *ret_bs = bs;
+  return eslOK;
+
+ ERROR:
+  if (cmdline) free(cmdline);
+  p7_bathsearch_Destroy(bs);
+  *ret_bs = NULL;
+  return status;
+}
+
+
+/* Function:  p7_bathsearch_SetHitCallback()
+ * Synopsis:  Have each new hit passed to a function as it's found.
+ *
+ * Purpose:   After each window of target DNA is searched, call
+ *            <hitfunc(hit, arg)> for each hit found in it, in the
+ *            order they were found. <hitfunc> returns <eslOK> to
+ *            continue; anything else stops the search, and is
+ *            returned by the call that was feeding it DNA.
+ *
+ *            At this point a hit has its scores and P-value, but
+ *            not an E-value, which depends on the size of the whole
+ *            search; and a hit in the overlap between two windows
+ *            is passed once for each window. <p7_bathsearch_Finish()>
+ *            settles both.
+ *
+ *            <hitfunc> of <NULL> turns the callback off.
+ *
+ * Returns:   <eslOK>.
+ */
+int
+p7_bathsearch_SetHitCallback(P7_BATHSEARCH *bs, p7_BATHSEARCH_HITFUNC hitfunc, void *arg)
+{
+  bs->hitfunc = hitfunc;
+  bs->hitarg  = arg;
+  return eslOK;
+}
+
+
+/* Function:  p7_bathsearch_Reuse()
+ * Synopsis:  Get ready for a new search with the same query.
+ *
+ * Purpose:   Discard the hits and counts of the search so far, and
+ *            any unfinished target, so <bs> can search a new set of
+ *            targets.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_bathsearch_Reuse(P7_BATHSEARCH *bs)
+{
+  esl_sq_Reuse(bs->win);
+  esl_sq_ReuseBlock(bs->wrk1->orf_block);
+  esl_sq_ReuseBlock(bs->wrk2->orf_block);
+  bs->tidx     = -1;
+  bs->tL       = 0;
+  bs->tfirst   = 0;
+  bs->ntargets = 0;
+  bs->errbuf[0] = '\0';
+  return bathsearch_pipeline(bs);
+}
+
+
+/* Function:  p7_bathsearch_Destroy()
+ * Synopsis:  Free a <P7_BATHSEARCH>.
+ */
+void
+p7_bathsearch_Destroy(P7_BATHSEARCH *bs)
+{
+  if (bs == NULL) return;
+  if (bs->win)       esl_sq_Destroy(bs->win);
+  if (bs->th)        p7_tophits_Destroy(bs->th);
+  if (bs->pli)       p7_pipeline_fs_Destroy(bs->pli);
+  if (bs->scoredata) p7_hmm_ScoreDataDestroy(bs->scoredata);
+  if (bs->om)        p7_oprofile_Destroy(bs->om);
+  if (bs->gm_fs)     p7_profile_fs_Destroy(bs->gm_fs);
+  if (bs->gm)        p7_profile_Destroy(bs->gm);
+  if (bs->bg)        p7_bg_Destroy(bs->bg);
+  if (bs->wrk1) {
+    if (bs->wrk1->orf_block) esl_sq_DestroyBlock(bs->wrk1->orf_block);
+    bs->wrk1->orf_block = NULL;
+    esl_gencode_WorkstateDestroy(bs->wrk1);
+  }
+  if (bs->wrk2) {
+    if (bs->wrk2->orf_block) esl_sq_DestroyBlock(bs->wrk2->orf_block);
+    bs->wrk2->orf_block = NULL;
+    esl_gencode_WorkstateDestroy(bs->wrk2);
+  }
+  if (bs->gcode)     esl_gencode_Destroy(bs->gcode);
+  if (bs->abcAA)     esl_alphabet_Destroy(bs->abcAA);
+  if (bs->abcDNA)    esl_alphabet_Destroy(bs->abcDNA);
+  if (bs->go)        esl_getopts_Destroy(bs->go);
+  free(bs);
+}
+/*----------------- end, P7_BATHSEARCH object -------------------*/
+
+
+
+/*****************************************************************
+ *= 2. Searching targets
+ *****************************************************************/
+
+/* Function:  p7_bathsearch_TargetBegin()
+ * Synopsis:  Start a new target DNA sequence.
+ *
+ * Purpose:   Start target sequence <name>, whose residues will
+ *            follow in calls to <p7_bathsearch_Feed()>. A target
+ *            that is still open is ended first.
+ *
+ * Returns:   <eslOK> on success, or whatever the hit callback
+ *            returned if it stopped the search.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_bathsearch_TargetBegin(P7_BATHSEARCH *bs, const char *name)
+{
+  int status;
+
+  if (bs->tidx >= 0 && (status = p7_bathsearch_TargetEnd(bs)) != eslOK) return status;
+
+  esl_sq_Reuse(bs->win);
+  if ((status = esl_sq_SetName(bs->win, name)) != eslOK) return status;
+  bs->tidx     = bs->ntargets++;
+  bs->tL       = 0;
+  bs->tfirst   = bs->th->N;
+  bs->win->idx = bs->tidx;
+  return eslOK;
+}
+
+
+/* Function:  p7_bathsearch_Feed()
+ * Synopsis:  Add DNA to the current target.
+ *
+ * Purpose:   Append the <n> characters of <seq> (which need not be
+ *            NUL-terminated) to the target started by
+ *            <p7_bathsearch_TargetBegin()>. Whitespace is skipped, so
+ *            FASTA sequence lines can be fed as they are. Each time
+ *            the target's unsearched DNA reaches the window length
+ *            (<--block_length>), that window is searched, keeping
+ *            the end of it as the start of the next window so that
+ *            hits spanning the boundary are found.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ *            <eslEINVAL> if no target has been started, or <seq>
+ *            contains a character that isn't a DNA residue; <errbuf>
+ *            in <bs> says which. Anything else the hit callback
+ *            returned, if it stopped the search.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_bathsearch_Feed(P7_BATHSEARCH *bs, const char *seq, int64_t n)
+{
+  ESL_SQ  *win = bs->win;
+  int64_t  W   = bs->om->max_length;
+  int64_t  i;
+  int      status;
+
+  if (bs->tidx < 0) ESL_FAIL(eslEINVAL, bs->errbuf, "no target sequence started");
+
+  for (i = 0; i < n; i++)
+  {
+    if (isspace((int) seq[i])) continue;
+    if (! esl_abc_CIsValid(bs->abcDNA, seq[i]))
+      ESL_FAIL(eslEINVAL, bs->errbuf, "illegal character '%c' at position %" PRId64 " of target %s", seq[i], bs->tL + 1, win->name);
+
+    if (win->n == bs->pli->block_length)
+    {
+      if ((status = search_window(bs)) != eslOK) return status;
+
+      /* keep the last W residues as context for the next window */
+      memmove(win->dsq + 1, win->dsq + 1 + win->n - W, sizeof(ESL_DSQ) * W);
+      win->start += win->n - W;
+      win->n      = W;
+      win->C      = W;
+    }
+    win->dsq[++win->n] = esl_abc_DigitizeSymbol(bs->abcDNA, seq[i]);
+    bs->tL++;
+  }
+  win->dsq[win->n+1] = eslDSQ_SENTINEL;
+  return eslOK;
+}
+
+
+/* Function:  p7_bathsearch_TargetEnd()
+ * Synopsis:  Finish the current target DNA sequence.
+ *
+ * Purpose:   Search what remains of the current target, and record
+ *            its full length in its hits. Does nothing if no target
+ *            is open.
+ *
+ * Returns:   <eslOK> on success, or whatever the hit callback
+ *            returned if it stopped the search.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_bathsearch_TargetEnd(P7_BATHSEARCH *bs)
+{
+  P7_HIT *hit;
+  int     h;
+  int     status;
+
+  if (bs->tidx < 0) return eslOK;
+
+  /* do not process sequence of less than 5 codons */
+  if (bs->win->n > bs->win->C && bs->win->n >= 15 && (status = search_window(bs)) != eslOK) return status;
+
+  for (h = bs->tfirst; h < bs->th->N; h++)
+  {
+    hit = &(bs->th->unsrt[h]);
+    if (hit->ndom > 0) hit->dcl[0].ad->L = bs->tL;
+  }
+  bs->pli->nseqs++;
+  bs->tidx = -1;
+  return eslOK;
+}
+
+
+/* Function:  p7_bathsearch_Finish()
+ * Synopsis:  Finalize the hits of a search.
+ *
+ * Purpose:   End any open target, then compute E-values for the
+ *            whole search (or for <-Z>), remove duplicate hits from
+ *            overlapping windows, sort the hits by score and mark
+ *            those that pass the reporting and inclusion thresholds,
+ *            as bathsearch does before its output.
+ *
+ *            The hits are returned in <*opt_th>, and stay owned by
+ *            <bs> until it is reused or destroyed. They and
+ *            <bs->pli> can be passed to the <p7_tophits_*> output
+ *            routines.
+ *
+ * Returns:   <eslOK> on success, or whatever the hit callback
+ *            returned if it stopped the search.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_bathsearch_Finish(P7_BATHSEARCH *bs, P7_TOPHITS **opt_th)
+{
+  P7_PIPELINE *pli = bs->pli;
+  P7_TOPHITS  *th  = bs->th;
+  int64_t      resCnt;
+  int          i, d;
+  int          status;
+
+  if ((status = p7_bathsearch_TargetEnd(bs)) != eslOK) return status;
+
+  if (esl_opt_IsUsed(bs->go, "-Z")) {
+    resCnt = 1000000*esl_opt_GetReal(bs->go, "-Z");
+    if (pli->strands == p7_STRAND_BOTH) resCnt *= 2;
+  }
+  else resCnt = pli->nres;
+  p7_tophits_ComputeBATHEvalues(th, resCnt, bs->om->max_length);
+
+  p7_tophits_SortBySeqidxAndAlipos(th);
+  p7_tophits_RemoveDuplicates(th, pli->use_bit_cutoffs);
+
+  /* Z = 1, since p7_tophits_ComputeBATHEvalues() already set the E-values */
+  p7_tophits_SortBySortkey(th);
+  pli->Z = 1;
+  p7_tophits_Threshold(th, pli);
+
+  pli->n_output = pli->pos_output = 0;
+  for (i = 0; i < th->N; i++) {
+    if ( (th->hit[i]->flags & p7_IS_REPORTED) || th->hit[i]->flags & p7_IS_INCLUDED) {
+      pli->n_output++;
+      for (d = 0; d < th->hit[i]->ndom; d++)
+        pli->pos_output += 1 + (th->hit[i]->dcl[d].jali > th->hit[i]->dcl[d].iali ? th->hit[i]->dcl[d].jali - th->hit[i]->dcl[d].iali : th->hit[i]->dcl[d].iali - th->hit[i]->dcl[d].jali);
+    }
+  }
+
+  if (opt_th) *opt_th = th;
+  return eslOK;
+}
+/*------------------ end, searching targets ---------------------*/
+
+
+
+/*****************************************************************
+ *= 3. Internal routines
+ *****************************************************************/
+
+/* bathsearch_pipeline()
+ * (Re)create the pipeline and hit list of <bs>.
+ */
+static int
+bathsearch_pipeline(P7_BATHSEARCH *bs)
+{
+  char *strand = esl_opt_GetString(bs->go, "--strand");
+
+  if (bs->th)  p7_tophits_Destroy(bs->th);
+  if (bs->pli) p7_pipeline_fs_Destroy(bs->pli);
+
+  if ((bs->th  = p7_tophits_Create()) == NULL) return eslEMEM;
+  if ((bs->pli = p7_pipeline_fs_Create(bs->go, bs->om->M, 300, TRUE, p7_SEARCH_SEQS)) == NULL) return eslEMEM; /* L_hint = 300 is just a dummy for now */
+  if (p7_pli_NewModel(bs->pli, bs->om, bs->bg) != eslOK) ESL_FAIL(eslEINVAL, bs->errbuf, "%s", bs->pli->errbuf);
+  bs->pli->nmodels = 1;
+  bs->pli->nnodes  = bs->om->M;
+
+  if      (strcmp(strand, "plus")  == 0) bs->pli->strands = p7_STRAND_TOPONLY;
+  else if (strcmp(strand, "minus") == 0) bs->pli->strands = p7_STRAND_BOTTOMONLY;
+  else                                   bs->pli->strands = p7_STRAND_BOTH;
+
+  bs->pli->block_length = esl_opt_IsOn(bs->go, "--block_length") ? esl_opt_GetInteger(bs->go, "--block_length") : p7_BATHSEARCH_BLOCK;
+  return eslOK;
+}
+
+/* search_window()
+ * Search the window of the current target that's in <bs->win>, on
+ * the strands asked for, as bathsearch's search_window() does, and
+ * pass any new hits to the callback.
+ */
+static int
+search_window(P7_BATHSEARCH *bs)
+{
+  ESL_SQ *win   = bs->win;
+  int     first = bs->th->N;
+  int     status;
+
+  win->end = win->start + win->n - 1;
+  win->W   = win->n - win->C;
+  win->L   = win->n; /* here, L is not the full length of the sequence, just of the current window; required for esl_gencode machinations */
+  win->dsq[win->n+1] = eslDSQ_SENTINEL;
+  if ((status = p7_pli_MaskTarget(bs->pli, bs->gcode, win)) != eslOK) return status;
+
+  if (bs->pli->strands != p7_STRAND_BOTTOMONLY)
+  {
+    bs->pli->nres += win->n;
+    esl_gencode_ProcessStart(bs->gcode, bs->wrk1, win);
+    esl_gencode_ProcessPiece(bs->gcode, bs->wrk1, win);
+    esl_gencode_ProcessEnd(bs->wrk1, win);
+
+    p7_Pipeline_BATH(bs->pli, bs->om, bs->gm, bs->gm_fs, bs->scoredata, bs->bg, bs->th, win->idx, win, bs->wrk1->orf_block, bs->wrk2, bs->gcode, p7_NOCOMPLEMENT);
+    p7_pipeline_fs_Reuse(bs->pli);
+    esl_sq_ReuseBlock(bs->wrk1->orf_block);
+  }
+
+  if (bs->pli->strands != p7_STRAND_TOPONLY)
+  {
+    bs->pli->nres += win->n;
+    esl_sq_ReverseComplement(win);
+    esl_gencode_ProcessStart(bs->gcode, bs->wrk1, win);
+    esl_gencode_ProcessPiece(bs->gcode, bs->wrk1, win);
+    esl_gencode_ProcessEnd(bs->wrk1, win);
+
+    p7_Pipeline_BATH(bs->pli, bs->om, bs->gm, bs->gm_fs, bs->scoredata, bs->bg, bs->th, win->idx, win, bs->wrk1->orf_block, bs->wrk2, bs->gcode, p7_COMPLEMENT);
+    p7_pipeline_fs_Reuse(bs->pli);
+    esl_sq_ReuseBlock(bs->wrk1->orf_block);
+
+    /* Reverse sequence back to original */
+    esl_sq_ReverseComplement(win);
+  }
+
+  return report_new_hits(bs, first);
+}
+
+/* report_new_hits()
+ * Pass hits <first>..N-1 of <bs->th>, which haven't been sorted
+ * yet, to the callback, if there is one.
+ */
+static int
+report_new_hits(P7_BATHSEARCH *bs, int first)
+{
+  int h;
+  int status;
+
+  if (bs->hitfunc == NULL) return eslOK;
+  for (h = first; h < bs->th->N; h++)
+    if ((status = (*bs->hitfunc)(&(bs->th->unsrt[h]), bs->hitarg)) != eslOK) return status;
+  return eslOK;
+}
+/*------------------ end, internal routines ---------------------*/
+
+
+
+/*****************************************************************
+ *= 4. Unit tests
+ *****************************************************************/
+#ifdef p7BATHSEARCH_TESTDRIVE
+#include "esl_random.h"
+#include "esl_randomseq.h"
+
+static int
+utest_count_hits(const P7_HIT *hit, void *arg)
+{
+  int *nhits = (int *) arg;
+  (*nhits)++;
+  return eslOK;
+}
+
+/* Plant a reverse-translated copy of the query's sequence in random
+ * DNA, on the minus strand, and search it twice: fed all at once into
+ * one window, and fed in small ragged pieces into several overlapping
+ * windows. Both searches must find the planted hit, with the same
+ * score, at the same coordinates; the callback must have been called
+ * for every hit before Finish().
+ */
+static void
+utest_feed(ESL_RANDOMNESS *r, ESL_GENCODE *gcode, int L)
+{
+  char           *msg    = "p7_bathsearch feed unit test failed";
+  const ESL_ALPHABET *abcAA  = gcode->aa_abc;
+  const ESL_ALPHABET *abcDNA = gcode->nt_abc;
+  P7_BG          *bg     = p7_bg_fs_Create(abcAA);
+  P7_BUILDER     *bld    = p7_builder_Create(NULL, abcAA);
+  ESL_SQ         *qsq    = esl_sq_CreateDigital(abcAA);
+  P7_HMM         *hmm    = NULL;
+  P7_BATHSEARCH  *bs     = NULL;
+  P7_TOPHITS     *th     = NULL;
+  double          fq[4]  = { 0.25, 0.25, 0.25, 0.25 };
+  char           *dna    = NULL;
+  char           *rc     = NULL;
+  char            errbuf[eslERRBUFSIZE];
+  int             M      = 80;
+  int64_t         pos    = L/3;
+  int64_t         i, n;
+  int             c, x, codon;
+  int             nhits;
+  float           sc[2];
+  int64_t         iali[2], jali[2];
+  int             pass;
+
+  if (bg == NULL || bld == NULL || qsq == NULL) esl_fatal(msg);
+  if (p7_builder_LoadScoreSystem(bld, "BLOSUM62", 0.02, 0.4, bg) != eslOK) esl_fatal(msg);
+
+  /* random query, and a model of it */
+  esl_sq_GrowTo(qsq, M);
+  esl_rsq_xfIID(r, bg->f, abcAA->K, M, qsq->dsq);
+  qsq->n = M;
+  esl_sq_SetName(qsq, "query");
+  if (p7_SingleBuilder(bld, qsq, bg, &hmm, NULL, NULL, NULL) != eslOK) esl_fatal(msg);
+
+  /* random target, with the query reverse-translated into it */
+  if ((dna = malloc(sizeof(char) * (L+1))) == NULL) esl_fatal(msg);
+  if ((rc  = malloc(sizeof(char) * (L+1))) == NULL) esl_fatal(msg);
+  for (i = 0; i < L; i++) dna[i] = abcDNA->sym[esl_rnd_DChoose(r, fq, 4)];
+  dna[L] = '\0';
+  for (i = 1; i <= M; i++)
+  {
+    for (codon = 0; codon < 64; codon++) if (gcode->basic[codon] == qsq->dsq[i]) break;
+    if (codon == 64) esl_fatal(msg);
+    for (c = 0; c < 3; c++) dna[pos + 3*(i-1) + c] = abcDNA->sym[(codon >> (2*(2-c))) & 3];
+  }
+  /* ... on the minus strand */
+  for (i = 0; i < L; i++) {
+    x = esl_abc_DigitizeSymbol(abcDNA, dna[L-1-i]);
+    rc[i] = abcDNA->sym[abcDNA->complement[x]];
+  }
+  rc[L] = '\0';
+
+  for (pass = 0; pass < 2; pass++)
+  {
+    if (pass == 0 && p7_bathsearch_Create(hmm, NULL, &bs, errbuf) != eslOK) esl_fatal("%s: %s", msg, errbuf);
+    if (pass == 1 && p7_bathsearch_Create(hmm, "--block_length 50000", &bs, errbuf) != eslOK) esl_fatal("%s: %s", msg, errbuf);
+    nhits = 0;
+    p7_bathsearch_SetHitCallback(bs, utest_count_hits, &nhits);
+
+    if (p7_bathsearch_TargetBegin(bs, "target") != eslOK) esl_fatal(msg);
+    if (pass == 0) {
+      if (p7_bathsearch_Feed(bs, rc, L) != eslOK) esl_fatal(msg);
+    } else {
+      for (i = 0; i < L; i += n) {
+        n = ESL_MIN(L - i, 1 + esl_rnd_Roll(r, 997));
+        if (p7_bathsearch_Feed(bs, rc + i, n) != eslOK) esl_fatal(msg);
+      }
+    }
+    if (p7_bathsearch_Feed(bs, "1", 1) != eslEINVAL) esl_fatal(msg);
+    if (p7_bathsearch_TargetEnd(bs) != eslOK) esl_fatal(msg);
+
+    if (nhits != bs->th->N)                        esl_fatal(msg);
+    if (p7_bathsearch_Finish(bs, &th) != eslOK)    esl_fatal(msg);
+    if (th->N < 1 || th->nincluded < 1)            esl_fatal(msg);
+    if (bs->pli->nseqs != 1 || bs->pli->nres < 2*L) esl_fatal(msg);
+    if (th->hit[0]->dcl[0].ad->L != L)             esl_fatal(msg);
+
+    sc[pass]   = th->hit[0]->score;
+    iali[pass] = th->hit[0]->dcl[0].iali;
+    jali[pass] = th->hit[0]->dcl[0].jali;
+    p7_bathsearch_Destroy(bs);
+  }
+  if (esl_FCompare(sc[0], sc[1], 1e-4) != eslOK) esl_fatal(msg);
+  if (iali[0] != iali[1] || jali[0] != jali[1]) esl_fatal(msg);
+
+  free(dna);
+  free(rc);
+  p7_hmm_Destroy(hmm);
+  esl_sq_Destroy(qsq);
+  p7_builder_Destroy(bld);
+  p7_bg_Destroy(bg);
+}
+
+/* Bad option strings and DNA models are user errors, not exceptions. */
+static void
+utest_errors(ESL_RANDOMNESS *r, ESL_ALPHABET *abcAA, ESL_ALPHABET *abcDNA)
+{
+  char          *msg = "p7_bathsearch errors unit test failed";
+  P7_HMM        *hmm = NULL;
+  P7_BATHSEARCH *bs  = NULL;
+  char           errbuf[eslERRBUFSIZE];
+
+  if (p7_hmm_Sample(r, 20, abcDNA, &hmm) != eslOK)                          esl_fatal(msg);
+  if (p7_bathsearch_Create(hmm, NULL, &bs, errbuf) != eslEINVAL || bs != NULL) esl_fatal(msg);
+  p7_hmm_Destroy(hmm);
+
+  if (p7_hmm_Sample(r, 20, abcAA, &hmm) != eslOK)                                      esl_fatal(msg);
+  if (p7_bathsearch_Create(hmm, "--nosuchopt", &bs, errbuf) != eslEINVAL || bs != NULL)  esl_fatal(msg);
+  if (p7_bathsearch_Create(hmm, "--strand up", &bs, errbuf) != eslEINVAL || bs != NULL)  esl_fatal(msg);
+  if (p7_bathsearch_Create(hmm, "--ct 99",     &bs, errbuf) != eslENOTFOUND || bs != NULL) esl_fatal(msg);
+
+  /* bathsearch's frameshift output and Forward thread options are accepted */
+  if (p7_bathsearch_Create(hmm, "--fstblout fs.tbl", &bs, errbuf) != eslOK)                esl_fatal("%s: %s", msg, errbuf);
+  p7_bathsearch_Destroy(bs);
+#ifdef HMMER_THREADS
+  if (p7_bathsearch_Create(hmm, "--fwd_cpu 2", &bs, errbuf) != eslOK)                      esl_fatal("%s: %s", msg, errbuf);
+  p7_bathsearch_Destroy(bs);
+#endif
+  p7_hmm_Destroy(hmm);
+}
+#endif /*p7BATHSEARCH_TESTDRIVE*/
+
+/*****************************************************************
+ *= 5. Test driver
+ *****************************************************************/
+#ifdef p7BATHSEARCH_TESTDRIVE
+/*
+  gcc -o p7_bathsearch_utest -g -Wall -I. -L. -I../easel -L../easel -Dp7BATHSEARCH_TESTDRIVE p7_bathsearch.c -lhmmer -leasel -lm
+  ./p7_bathsearch_utest
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name  type         default  env   range togs  reqs  incomp  help                   docgrp */
+  { "-h",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show help and usage",           0 },
+  { "-s",  eslARG_INT,     "42",  NULL, NULL, NULL, NULL, NULL, "set random number seed to <n>", 0 },
+  { "-L",  eslARG_INT, "120000",  NULL, NULL, NULL, NULL, NULL, "length of the test target",     0 },
+  { 0,0,0,0,0,0,0,0,0,0},
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for p7_bathsearch.c";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go     = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r      = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abcDNA = esl_alphabet_Create(eslDNA);
+  ESL_ALPHABET   *abcAA  = esl_alphabet_Create(eslAMINO);
+  ESL_GENCODE    *gcode  = esl_gencode_Create(abcDNA, abcAA);
+
+  impl_Init();
+  p7_FLogsumInit();
+
+  utest_feed(r, gcode, esl_opt_GetInteger(go, "-L"));
+  utest_errors(r, abcAA, abcDNA);
+
+  esl_gencode_Destroy(gcode);
+  esl_alphabet_Destroy(abcAA);
+  esl_alphabet_Destroy(abcDNA);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7BATHSEARCH_TESTDRIVE*/
+/*---------------------- end, test driver ----------------------*/
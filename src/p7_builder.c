@@ -666,6 +666,9 @@ p7_SingleBuilder(P7_BUILDER *bld, ESL_SQ *sq, P7_BG *bg, P7_HMM **opt_hmm,
  * simply set to length_bound (usually 20 * model_length).
  *
  *
+ * The DP itself is done by p7_lengthdist_MaxLength(), which lays it out
+ * as contiguous rows and vectorizes the M and I updates.
+ *
  * Args:      hmm         - p7_HMM (required for the transition probabilities)
  *
  * Returns:   <eslOK> on success. The max length is set in hmm->max_length.
@@ -674,114 +677,12 @@ p7_SingleBuilder(P7_BUILDER *bld, ESL_SQ *sq, P7_BG *bg, P7_HMM **opt_hmm,
 int
 p7_Builder_MaxLength (P7_HMM *hmm, double emit_thresh)
 {
-  int      col_ptr, prev_col_ptr; // which true column in above 2d-arrays is active
-  int      col;                   // which conceptual column in above 2d-arrays is active (up to table_len)
-  double   p_sum;                 // sum of probabilities for lengths <=L;  X from above
-  double   surv;                  // surviving probability mass at length L; Y from above
-  int      k;                     // active state in model
-  int      i;
-  double **I            = NULL;
-  double **M            = NULL;
-  double **D            = NULL;
-  int      model_len    = hmm->M; // model length
-  int      length_bound = ESL_MAX(model_len, ESL_MIN(20*model_len, 100000)); // cap on # iterations (aka max model length)
-  int      status;
-  
-  if (model_len==1) {
-    hmm->max_length = 1;
-    return eslOK;
-  }
-
-  hmm->max_length = length_bound;  //default, if it never reaches the target surviving density
-
-
-  //    double I[model_len+1][2], M[model_len+1][2], D[model_len+1][2]; //2 columns for each way of ending a subpath
-  ESL_ALLOC(I, (model_len+1) * sizeof(double*)); 
-  ESL_ALLOC(M, (model_len+1) * sizeof(double*)); 
-  ESL_ALLOC(D, (model_len+1) * sizeof(double*)); 
-  for (i = 0; i <= model_len; i++) {
-    I[i] = M[i] = D[i] = NULL; 
-  }
-  for (i=0; i <= model_len; i++) {
-    ESL_ALLOC(I[i], 2 * sizeof(double));
-    ESL_ALLOC(M[i], 2 * sizeof(double));
-    ESL_ALLOC(D[i], 2 * sizeof(double));
-  }
-
-  /*  Compute max length and max prefix lengths*/
-  // special case for filling in 1st column of DP table,  col=1;
-  M[1][0] = 1.0;// 1st match state must emit a character
-  I[1][0] = D[1][0] = M[2][0] = I[2][0] = 0;
-  D[2][0] = hmm->t[1][p7H_MD];  // The 2nd delete state is reached, having emitted only 1 character
-  for (k=3; k<=model_len; k++){
-    M[k][0] = I[k][0] = 0;
-    D[k][0] = hmm->t[k-1][p7H_DD] * D[k-1][0];  // only way to get to the 3rd or greater state with only 1 character
-  }
-
-  //special case for 2nd column
-  M[1][1] = D[1][1] = D[2][1] = I[2][1] = 0;  //No way any of these states can be responsible for the second emitted character.
-  I[1][1] = hmm->t[1][p7H_MI] * M[1][0];  //1st insert state can emit char #2.
-  M[2][1] = hmm->t[1][p7H_MM] * M[1][0] ; //2nd match state can emit char #2.
-  for (k=3; k<=model_len; k++){
-    M[k][1] = hmm->t[k-1][p7H_DM] * D[k-1][0] ; //kth match state would have to follow the k-1th delete state, having emitted only 1 char so far
-    I[k][1] = 0;
-    D[k][1] = hmm->t[k-1][p7H_MD] * M[k-1][1]  +  hmm->t[k-1][p7H_DD] * D[k-1][1]; //in general only by extending a delete.  For k=3, this could be a transition from M=2, with 2 chars.
-  }
-
-  p_sum = M[model_len][0] + M[model_len][1] + D[model_len][0] + D[model_len][1];
-
-  //general case for all remaining columns
-  col_ptr = 0;
-  for (col=3; col<=length_bound; col++) {
-    prev_col_ptr = 1-col_ptr;
-    surv = 0.0;
-    M[1][col_ptr] = D[1][col_ptr] = 0; //M[i][prev_col_ptr] is zero :  no way the first M state could have emitted >=2 chars
-    I[1][col_ptr] =  hmm->t[1][p7H_II] * I[1][prev_col_ptr];  // 1st insert state can emit chars indefinitely
-    surv += I[1][col_ptr];
-
-    for (k=2; k<=model_len; k++){
-      M[k][col_ptr] = hmm->t[k-1][p7H_MM] * M[k-1][prev_col_ptr]  +  hmm->t[k-1][p7H_DM] * D[k-1][prev_col_ptr]  +  hmm->t[k-1][p7H_IM] * I[k-1][prev_col_ptr];
-      I[k][col_ptr] = hmm->t[k][p7H_MI] * M[k][prev_col_ptr]    +  hmm->t[k][p7H_II] * I[k][prev_col_ptr];
-      D[k][col_ptr] = hmm->t[k-1][p7H_MD] * M[k-1][col_ptr]  +  hmm->t[k-1][p7H_DD] * D[k-1][col_ptr];
-
-      if (k<=model_len) {
-        surv +=  I[k][col_ptr] +
-     	           M[k][col_ptr] * ( 1 - hmm->t[k][p7H_MD] ) +  //this much of M[k]'s mass will bleed into D[k+1], and thus be added to surv then
-                 D[k][col_ptr] * ( 1 - hmm->t[k][p7H_DD] )  ; //this much of D[k]'s mass will bleed into D[k+1], and thus be added to surv then
-      }
-    }
-    surv +=    M[model_len][col_ptr] * ( hmm->t[model_len][p7H_MD] )   //the final state doesn't pass on to the next D state
-             + D[model_len][col_ptr] * ( hmm->t[model_len][p7H_DD] )  // the final state doesn't pass on to the next D state
-             - I[model_len][col_ptr] ;  // no I state for final position
-
-    p_sum += M[model_len][col_ptr] + D[model_len][col_ptr];
-    surv /= surv + p_sum;
-
-    if (surv < emit_thresh) {
-      hmm->max_length = col;
-      break;
-    }
-
-    col_ptr = 1-col_ptr; // alternating between 0 and 1
-  }
-
-  for (i=0; i<model_len+1; i++) {
-    free(I[i]);
-    free(M[i]);
-    free(D[i]);
-  }
-  free(I);
-  free(M);
-  free(D);
+  int maxl;
+  int status;
 
-  if (hmm->max_length > length_bound) return eslERANGE;
+  if ((status = p7_lengthdist_MaxLength(hmm, emit_thresh, &maxl)) != eslOK) return status;
+  hmm->max_length = maxl;
   return eslOK;
-  
- ERROR:
-  if (I) { for (i = 0; i <= model_len; i++) { if (I[i]) free(I[i]); }  free(I);  }
-  if (D) { for (i = 0; i <= model_len; i++) { if (D[i]) free(D[i]); }  free(D);  }
-  if (M) { for (i = 0; i <= model_len; i++) { if (M[i]) free(M[i]); }  free(M);  }
-  return status;
 }
 
 /*------------- end, model construction API ---------------------*/
@@ -135,6 +135,8 @@ p7_domaindef_Create(ESL_RANDOMNESS *r)
   /* keep a copy of ptr to the RNG */
   ddef->r            = r;  
   ddef->do_reseeding = TRUE;
+
+  ddef->occ = NULL;
   return ddef;
   
  ERROR:
@@ -147,14 +149,18 @@ p7_domaindef_Create(ESL_RANDOMNESS *r)
  *
  * Purpose:   Creates a new <P7_DOMAINDEF> object, with <r> registered
  *            as its random number generator, using default settings
- *            for all thresholds.
+ *            for all thresholds. <fstbl> is TRUE if the caller
+ *            writes a frameshift location table (bathsearch
+ *            --fstblout). If <fwd_ncpu> is greater than one, and
+ *            we're threaded, Forward on very large envelopes is
+ *            split over a pool of <fwd_ncpu> threads (--fwd_cpu).
  *
  * Returns:   a pointer to the new <P7_DOMAINDEF> object.
  *
  * Throws:    <NULL> on allocation failure.
  */
 P7_DOMAINDEF *
-p7_domaindef_fs_Create(ESL_RANDOMNESS *r, ESL_GETOPTS *go)
+p7_domaindef_fs_Create(ESL_RANDOMNESS *r, int fstbl, int fwd_ncpu)
 {
   P7_DOMAINDEF *ddef   = NULL;
   int           Lalloc = 512;  /* this initial alloc doesn't matter much; space is realloced as needed */
@@ -168,6 +174,7 @@ p7_domaindef_fs_Create(ESL_RANDOMNESS *r, ESL_GETOPTS *go)
   ddef->sp   = NULL;
   ddef->tr   = NULL;
   ddef->dcl  = NULL;
+  ddef->fwd_pool = NULL;
   
   /* level 2 alloc: posterior prob arrays */
   ESL_ALLOC(ddef->mocc, sizeof(float) * (Lalloc+1));
@@ -209,7 +216,13 @@ p7_domaindef_fs_Create(ESL_RANDOMNESS *r, ESL_GETOPTS *go)
   ddef->r            = r;  
   ddef->do_reseeding = TRUE;
 
-  ddef->fstbl = esl_opt_IsUsed(go, "--fstblout"); /* TRUE to produce tabular frameshift location output */
+  ddef->fstbl    = fstbl;    /* TRUE to produce tabular frameshift location output */
+  ddef->fwd_ncpu = 0;
+#ifdef HMMER_THREADS
+  ddef->fwd_ncpu = fwd_ncpu; /* threads for wavefront Forward on large envelopes */
+  if (ddef->fwd_ncpu > 1 && (ddef->fwd_pool = p7_fs_wavepool_Create(ddef->fwd_ncpu)) == NULL) goto ERROR;
+#endif
+  ddef->occ = NULL;   /* bathsearch attaches a collector for --dpocc */
 
   return ddef;
   
@@ -411,6 +424,7 @@ p7_domaindef_fs_Destroy(P7_DOMAINDEF *ddef)
   p7_spensemble_Destroy(ddef->sp);
   p7_trace_fs_Destroy(ddef->tr);
   p7_trace_fs_Destroy(ddef->gtr);
+  p7_fs_wavepool_Destroy(ddef->fwd_pool);
   free(ddef);
   return;
 }
@@ -764,7 +778,12 @@ p7_domaindef_ByPosteriorHeuristics_Frameshift(ESL_SQ *windowsq, P7_PROFILE *gm,
  *            and for each domain found, score it (with null2
  *            calculations) and obtain an optimal accuracy alignment,
  *            using <fwd> and <bck> matrices as workspace for the
- *            necessary full-matrix DP calculations. Caller provides a
+ *            necessary DP calculations. Envelopes are rescored with
+ *            a checkpointed Forward/OA matrix in <fwd> and a full
+ *            posterior matrix in <bck>, both sized to the envelope
+ *            rather than to the ORF; only stochastic clustering of a
+ *            multidomain region needs a full Forward matrix of the
+ *            region. Caller provides a
  *            new or reused <ddef> object to hold these results.
  *            Upon return, <ddef> contains the definitions of all the
  *            domains: their bounds, their null-corrected Forward
@@ -813,12 +832,17 @@ p7_domaindef_ByPosteriorHeuristics_nonFrameshift(const ESL_SQ *orfsq, const ESL_
     else if (ddef->mocc[j] - (ddef->etot[j] - ddef->etot[j-1])  <  ddef->rt2)
     {
         /* We have a region i..j to evaluate. */
-        p7_omx_GrowTo(fwd, om->M, j-i+1, j-i+1);
-        p7_omx_GrowTo(bck, om->M, j-i+1, j-i+1);
         ddef->nregions++;
         
         if (is_multidomain_region(ddef, i, j))
         {  
+            /* stochastic traces need the full Forward matrix; <bck> is
+             * only the one-row null2 workspace here. Envelopes get
+             * their own (checkpointed) matrices in rescore_isolated_domain_nonframeshift().
+             */
+            p7_omx_GrowTo(fwd, om->M, j-i+1, j-i+1);
+            p7_omx_GrowTo(bck, om->M, 0,     0);
+
         /* This region appears to contain more than one domain, so we have to
              * resolve it by cluster analysis of posterior trace samples, to define
              * one or more domain envelopes.
@@ -1612,11 +1636,11 @@ rescore_isolated_domain_frameshift(P7_DOMAINDEF *ddef, P7_PROFILE *gm, P7_FS_PRO
   windowsq->n = n_holder; 
   windowsq->L = n_holder;  
    
-  /* Forward */ 
-  p7_Forward_Frameshift(windowsq->dsq+i-1, gcode, Ld, gm_fs, gx1, &envsc);
+  /* Forward; split across threads on very large envelopes */ 
+  p7_ForwardAuto_Frameshift(windowsq->dsq+i-1, gcode, Ld, gm_fs, gx1, ddef->fwd_pool, &envsc);
   
   /* Backward */
-  p7_Backward_Frameshift(windowsq->dsq+i-1, gcode, Ld, gm_fs, gx2, NULL);
+  p7_BackwardAuto_Frameshift(windowsq->dsq+i-1, gcode, Ld, gm_fs, gx2, NULL);
 
   /* Posterior Probabilities */
   if ((gxppfs = p7_gmx_fs_Create(gm_fs->M, Ld, Ld, p7P_CODONS)) == NULL) goto ERROR;
@@ -1626,6 +1650,9 @@ rescore_isolated_domain_frameshift(P7_DOMAINDEF *ddef, P7_PROFILE *gm, P7_FS_PRO
   p7_OptimalAccuracy_Frameshift(gm_fs, gxppfs, gx2, &oasc);      
   p7_OATrace_Frameshift(gm_fs, gxppfs, gx2, gx1, ddef->tr);   /* <tr>'s seq coords are offset by i-1, rel to orig dsq */
 
+  /* optional instrumentation: posterior occupancy of this envelope's matrix (still in envelope coords) */
+  if (ddef->occ != NULL) p7_dpocc_Collect(ddef->occ, gxppfs, ddef->tr);
+
   /* hack the trace's sq coords to be correct w.r.t. original dsq */
   for (z = 0; z < ddef->tr->N; z++)    
     if (ddef->tr->i[z] >= 0) ddef->tr->i[z] += i-1;
@@ -1768,11 +1795,11 @@ rescore_isolated_domain_frameshift(P7_DOMAINDEF *ddef, P7_PROFILE *gm, P7_FS_PRO
  * The alignment is an optimal accuracy alignment (sensu IH Holmes),
  * also obtained in unilocal mode.
  * 
- * The caller provides DP matrices <ox1> and <ox2> with sufficient
- * space to hold Forward and Backward calculations for this domain
- * against the model. (The caller will typically already have matrices
- * sufficient for the complete sequence lying around, and can just use
- * those.) The caller also provides a <P7_DOMAINDEF> object (ddef)
+ * The caller provides DP matrices <ox1> and <ox2>, which are grown
+ * here as needed: <ox1> is laid out for checkpointed Forward and OA
+ * fills, $O(M \sqrt{L_d})$, and <ox2> holds the full envelope-sized
+ * Backward matrix that becomes the posterior decoding matrix. The
+ * caller also provides a <P7_DOMAINDEF> object (ddef)
  * which is (efficiently, we trust) managing any necessary temporary
  * working space and heuristic thresholds.
  *
@@ -1802,20 +1829,24 @@ rescore_isolated_domain_nonframeshift(P7_DOMAINDEF *ddef, P7_OPROFILE *om, P7_PR
   float          null2[p7_MAXCODE];
   int            status;
  
+  /* Only <ox2> holds a full Ld x M matrix (Backward, then posteriors);
+   * <ox1> is checkpointed, O(M sqrt(Ld)), for both the Forward and 
+   * the OA fill. Posteriors and OA trace are the same as full-matrix ones.
+   */
   p7_oprofile_ReconfigLength(om, orfsq->n);
-  p7_omx_GrowTo(ox1, om->M, orfsq->n, orfsq->n); 
-  p7_omx_GrowTo(ox2, om->M, orfsq->n, orfsq->n); 
+  p7_omx_GrowToCheckpointed(ox1, om->M, Ld); 
+  p7_omx_GrowTo(ox2, om->M, Ld, Ld); 
 	
-  p7_Forward (orfsq->dsq + i-1, Ld, om,      ox1, &envsc);
-  p7_Backward(orfsq->dsq + i-1, Ld, om, ox1, ox2, &bcksc);
+  p7_ForwardCheckpointed(orfsq->dsq + i-1, Ld, om,      ox1, &envsc);
+  p7_Backward           (orfsq->dsq + i-1, Ld, om, ox1, ox2, &bcksc);
    
-  status = p7_Decoding(om, ox1, ox2, ox2);      /* <ox2> is now overwritten with post probabilities     */
+  status = p7_DecodingCheckpointed(orfsq->dsq + i-1, om, ox1, ox2, ox2); /* <ox2> is now overwritten with post probabilities */
   if (status == eslERANGE) return eslFAIL;      /* rare: numeric overflow; domain is assumed to be repetitive garbage [J3/119-121] */
  
   /* Find an optimal accuracy alignment */
-  p7_OptimalAccuracy(om, ox2, ox1, &oasc);      /* <ox1> is now overwritten with OA scores              */
+  p7_OptimalAccuracy    (om, ox2, ox1, &oasc);     /* <ox1> is now overwritten with OA scores              */
 
-  p7_OATrace        (om, ox2, ox1, ddef->tr);   /* <tr>'s seq coords are offset by i-1, rel to orig dsq */
+  p7_OATraceCheckpointed(om, ox2, ox1, ddef->tr);  /* <tr>'s seq coords are offset by i-1, rel to orig dsq */
   
    
   /* get ptr to next empty domain structure in domaindef's results */
@@ -0,0 +1,444 @@
+/* P7_DPOCC: posterior occupancy statistics for frameshift-aware
+ * domain definition.
+ *
+ * Frameshift-aware Forward/Backward/Decoding on an envelope fills the
+ * full M x L matrix, but most of the posterior mass usually sits in a
+ * narrow band around the alignment. A <P7_DPOCC> attached to a
+ * <P7_DOMAINDEF> samples decoded envelopes and aggregates how many
+ * cells carry mass above a few thresholds, and how wide the band is
+ * around the optimal accuracy (OA) alignment's diagonal, so that
+ * banded/sparse DP settings can be picked from data rather than guessed.
+ *
+ * Contents:
+ *   1. The <P7_DPOCC> object
+ *   2. Collecting statistics
+ *   3. Output
+ *   4. Unit tests
+ *   5. Test driver
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "easel.h"
+#include "esl_dmatrix.h"
+#include "esl_vectorops.h"
+
+#include "hmmer.h"
+
+/* posterior thresholds for the occupancy fractions; must have p7_DPOCC_NTHRESH entries */
+static const double dpocc_thresh[p7_DPOCC_NTHRESH] = { 0.001, 0.01, 0.1, 0.5 };
+
+/*****************************************************************
+ *= 1. The <P7_DPOCC> object
+ *****************************************************************/
+
+/* Function:  p7_dpocc_Create()
+ * Synopsis:  Create a new <P7_DPOCC> collector.
+ *
+ * Purpose:   Create an empty occupancy collector that will sample one of
+ *            every <sample_every> envelopes offered to it. 
+ *
+ * Returns:   ptr to the new <P7_DPOCC>.
+ *
+ * Throws:    <NULL> on allocation failure.
+ */
+P7_DPOCC *
+p7_dpocc_Create(int sample_every)
+{
+  P7_DPOCC *occ = NULL;
+  int       status;
+
+  ESL_ALLOC(occ, sizeof(P7_DPOCC));
+  occ->heat       = NULL;
+  occ->diag       = NULL;
+  occ->diag_alloc = 0;
+
+  if ((occ->heat = esl_dmatrix_Create(p7_DPOCC_GRIDK, p7_DPOCC_GRIDI)) == NULL) goto ERROR;
+  occ->diag_alloc = 512;
+  ESL_ALLOC(occ->diag, sizeof(int) * (occ->diag_alloc+1));
+
+  occ->sample_every = ESL_MAX(1, sample_every);
+  p7_dpocc_Reuse(occ);
+  return occ;
+
+ ERROR:
+  p7_dpocc_Destroy(occ);
+  return NULL;
+}
+
+/* Function:  p7_dpocc_Reuse()
+ * Synopsis:  Zero the statistics in a <P7_DPOCC>.
+ *
+ * Purpose:   Reset all counts in <occ>, keeping its allocations and its
+ *            sampling rate.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_dpocc_Reuse(P7_DPOCC *occ)
+{
+  occ->nseen    = 0;
+  occ->nsampled = 0;
+  occ->ncells   = 0.;
+  occ->mass     = 0.;
+  occ->nrows    = 0;
+  occ->maxband  = 0;
+  esl_vec_DSet(occ->nabove, p7_DPOCC_NTHRESH, 0.);
+  memset(occ->bandhist, 0, sizeof(int64_t) * (p7_DPOCC_NBAND+1));
+  esl_dmatrix_SetZero(occ->heat);
+  return eslOK;
+}
+
+/* Function:  p7_dpocc_Destroy()
+ * Synopsis:  Free a <P7_DPOCC>.
+ */
+void
+p7_dpocc_Destroy(P7_DPOCC *occ)
+{
+  if (occ == NULL) return;
+  if (occ->heat != NULL) esl_dmatrix_Destroy(occ->heat);
+  if (occ->diag != NULL) free(occ->diag);
+  free(occ);
+}
+
+/*****************************************************************
+ *= 2. Collecting statistics
+ *****************************************************************/
+
+/* Function:  p7_dpocc_Collect()
+ * Synopsis:  Add one decoded envelope to the occupancy statistics.
+ *
+ * Purpose:   Given a frameshift-aware posterior decoding matrix <pp>
+ *            (from <p7_Decoding_Frameshift()>) for one envelope, and the
+ *            OA trace <tr> computed from it (row coords 1..pp->L, i.e.
+ *            not yet offset into the window), add the envelope to
+ *            <occ>, if it is one of the envelopes <occ> samples.
+ *
+ *            The posterior of core cell (i,k) is its match mass
+ *            (summed over codon lengths) plus its insert mass. The OA
+ *            diagonal gives, for each row inside the alignment, the
+ *            model position aligned to it; a codon's earlier
+ *            nucleotides take the codon's model position. For each
+ *            such row, the band half-width is the largest |k - diag|
+ *            of any cell with posterior >= <p7_DPOCC_BANDTHRESH>.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_dpocc_Collect(P7_DPOCC *occ, const P7_GMX *pp, const P7_TRACE *tr)
+{
+  float  **dp    = pp->dp;    /* so the MMX_FS, IMX_FS macros work */
+  int      L     = pp->L;
+  int      M     = pp->M;
+  int      half  = p7_DPOCC_GRIDK / 2;
+  double   p;
+  int      i, k, r, t, z;
+  int      c, col, off, w;
+  int      status;
+
+  occ->nseen++;
+  if ((occ->nseen - 1) % occ->sample_every != 0) return eslOK;
+  occ->nsampled++;
+
+  if (L > occ->diag_alloc) {
+    ESL_REALLOC(occ->diag, sizeof(int) * (L+1));
+    occ->diag_alloc = L;
+  }
+
+  /* OA diagonal; 0 = row not covered by the alignment */
+  for (i = 0; i <= L; i++) occ->diag[i] = 0;
+  for (z = 0; z < tr->N; z++)
+    {
+      if (tr->st[z] != p7T_M && tr->st[z] != p7T_I) continue;
+      if (tr->i[z] < 1 || tr->i[z] > L)             continue;
+      c = (tr->st[z] == p7T_M) ? tr->c[z] : 3;
+      for (r = ESL_MAX(1, tr->i[z] - c + 1); r <= tr->i[z]; r++)
+        occ->diag[r] = tr->k[z];
+    }
+
+  for (i = 1; i <= L; i++)
+    {
+      w   = 0;
+      col = ((i-1) * p7_DPOCC_GRIDI) / L;
+
+      for (k = 1; k <= M; k++)
+        {
+          p = exp(MMX_FS(i,k,p7G_C0));
+          if (k < M) p += exp(IMX_FS(i,k));
+
+          occ->mass += p;
+          for (t = 0; t < p7_DPOCC_NTHRESH; t++)
+            if (p >= dpocc_thresh[t]) occ->nabove[t] += 1.;
+
+          if (occ->diag[i] == 0) continue;
+          off = k - occ->diag[i];
+          if (p >= p7_DPOCC_BANDTHRESH) w = ESL_MAX(w, abs(off));
+          if (off >= -half && off <= half) occ->heat->mx[off+half][col] += p;
+        }
+
+      if (occ->diag[i] != 0) {
+        occ->nrows++;
+        occ->bandhist[ESL_MIN(w, p7_DPOCC_NBAND)]++;
+        occ->maxband = ESL_MAX(occ->maxband, w);
+      }
+    }
+  occ->ncells += (double) M * (double) L;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* Function:  p7_dpocc_Merge()
+ * Synopsis:  Add the statistics of one <P7_DPOCC> to another.
+ *
+ * Purpose:   Add everything collected in <occ2> to <occ1>; for example
+ *            to combine the collectors of several worker threads.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_dpocc_Merge(P7_DPOCC *occ1, const P7_DPOCC *occ2)
+{
+  int b, r, c;
+
+  occ1->nseen    += occ2->nseen;
+  occ1->nsampled += occ2->nsampled;
+  occ1->ncells   += occ2->ncells;
+  occ1->mass     += occ2->mass;
+  occ1->nrows    += occ2->nrows;
+  occ1->maxband   = ESL_MAX(occ1->maxband, occ2->maxband);
+  esl_vec_DAdd(occ1->nabove, occ2->nabove, p7_DPOCC_NTHRESH);
+  for (b = 0; b <= p7_DPOCC_NBAND; b++)
+    occ1->bandhist[b] += occ2->bandhist[b];
+  for (r = 0; r < occ1->heat->n; r++)
+    for (c = 0; c < occ1->heat->m; c++)
+      occ1->heat->mx[r][c] += occ2->heat->mx[r][c];
+  return eslOK;
+}
+
+/*****************************************************************
+ *= 3. Output
+ *****************************************************************/
+
+/* smallest half-width that covers fraction <q> of the path rows */
+static int
+dpocc_band_quantile(const P7_DPOCC *occ, double q)
+{
+  int64_t n = 0;
+  int     b;
+
+  if (occ->nrows == 0) return 0;
+  for (b = 0; b < p7_DPOCC_NBAND; b++) {
+    n += occ->bandhist[b];
+    if ((double) n >= q * (double) occ->nrows) return b;
+  }
+  return occ->maxband;
+}
+
+/* Function:  p7_dpocc_WriteJSON()
+ * Synopsis:  Write occupancy statistics as one line of JSON.
+ *
+ * Purpose:   Write the statistics in <occ> for query <qname> of length
+ *            <M> as a single-line JSON object to <fp> (so a file of
+ *            several queries is in JSON Lines format).
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEWRITE> on write failure.
+ */
+int
+p7_dpocc_WriteJSON(FILE *fp, const P7_DPOCC *occ, const char *qname, int M)
+{
+  double denom = (occ->ncells > 0.) ? occ->ncells : 1.;
+  int    t, b, last;
+
+  if (fprintf(fp, "{\"query\": \"%s\", \"M\": %d, \"envelopes_seen\": %" PRId64 ", \"envelopes_sampled\": %" PRId64 ", \"cells\": %.0f, \"posterior_mass\": %.4f, \"occupancy\": [",
+              qname, M, occ->nseen, occ->nsampled, occ->ncells, occ->mass) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "dpocc write failed");
+  for (t = 0; t < p7_DPOCC_NTHRESH; t++)
+    if (fprintf(fp, "%s{\"threshold\": %g, \"fraction\": %.6g}", (t ? ", " : ""), dpocc_thresh[t], occ->nabove[t] / denom) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "dpocc write failed");
+
+  if (fprintf(fp, "], \"band_threshold\": %g, \"path_rows\": %" PRId64 ", \"band_halfwidth\": {\"p50\": %d, \"p90\": %d, \"p99\": %d, \"max\": %d, \"histogram\": [",
+              p7_DPOCC_BANDTHRESH, occ->nrows, dpocc_band_quantile(occ, 0.5), dpocc_band_quantile(occ, 0.9), dpocc_band_quantile(occ, 0.99), occ->maxband) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "dpocc write failed");
+
+  /* histogram up to the last nonempty bin; the final (overflow) bin counts widths >= p7_DPOCC_NBAND */
+  for (last = p7_DPOCC_NBAND; last > 0 && occ->bandhist[last] == 0; last--) ;
+  for (b = 0; b <= last; b++)
+    if (fprintf(fp, "%s%" PRId64, (b ? ", " : ""), occ->bandhist[b]) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "dpocc write failed");
+
+  if (fprintf(fp, "]}}\n") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "dpocc write failed");
+  return eslOK;
+}
+
+/* Function:  p7_dpocc_Heatmap()
+ * Synopsis:  Draw the band heatmap as a PostScript page.
+ *
+ * Purpose:   Write one PostScript page to <fp> showing mean posterior
+ *            mass per sampled envelope, with relative position along
+ *            the envelope on the x axis and model offset from the OA
+ *            diagonal (-32..32, bottom to top) on the y axis. Uses
+ *            <dmx_Visualize()>; the caller writes the PostScript header.
+ *
+ * Returns:   <eslOK> on success, including the no-op case of nothing
+ *            having been sampled.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_dpocc_Heatmap(FILE *fp, const P7_DPOCC *occ)
+{
+  ESL_DMATRIX *D   = NULL;
+  double       max = 0.;
+  int          r, c;
+
+  if (occ->nsampled == 0) return eslOK;
+  if ((D = esl_dmatrix_Create(occ->heat->n, occ->heat->m)) == NULL) return eslEMEM;
+  for (r = 0; r < D->n; r++)
+    for (c = 0; c < D->m; c++) {
+      D->mx[r][c] = occ->heat->mx[r][c] / (double) occ->nsampled;
+      max = ESL_MAX(max, D->mx[r][c]);
+    }
+  dmx_Visualize(fp, D, 0.0, (max > 0.) ? max : 1.0);
+  esl_dmatrix_Destroy(D);
+  return eslOK;
+}
+
+/*****************************************************************
+ * 4. Unit tests
+ *****************************************************************/
+#ifdef p7DPOCC_TESTDRIVE
+
+/* A synthetic envelope: all posterior mass on the diagonal k = i/3
+ * (one 3-nt codon per model position), with the trace on the same
+ * diagonal. Every path row should then have band half-width 0, one
+ * cell per row should pass every threshold, and merging a collector
+ * with itself should double the counts.
+ */
+static void
+utest_diagonal(int M)
+{
+  char      *msg = "p7_dpocc diagonal unit test failed";
+  int        L   = 3*M;
+  P7_GMX    *pp  = p7_gmx_fs_Create(M, L, L, p7P_CODONS);
+  P7_TRACE  *tr  = p7_trace_fs_Create();
+  P7_DPOCC  *occ = p7_dpocc_Create(1);
+  P7_DPOCC  *two = p7_dpocc_Create(1);
+  float    **dp;
+  int        i, k, t;
+
+  if (pp == NULL || tr == NULL || occ == NULL || two == NULL) esl_fatal(msg);
+  pp->M = M;
+  pp->L = L;
+  dp    = pp->dp;
+
+  for (i = 1; i <= L; i++)
+    for (k = 1; k <= M; k++) {
+      MMX_FS(i,k,p7G_C0) = (k == (i+2)/3) ? 0.0 : -eslINFINITY;
+      IMX_FS(i,k)        = -eslINFINITY;
+    }
+
+  p7_trace_fs_Append(tr, p7T_S, 0, 0, 0);
+  p7_trace_fs_Append(tr, p7T_N, 0, 0, 0);
+  p7_trace_fs_Append(tr, p7T_B, 0, 0, 0);
+  for (k = 1; k <= M; k++)
+    p7_trace_fs_Append(tr, p7T_M, k, 3*k, 3);
+  p7_trace_fs_Append(tr, p7T_E, 0, 0, 0);
+  p7_trace_fs_Append(tr, p7T_C, 0, 0, 0);
+  p7_trace_fs_Append(tr, p7T_T, 0, 0, 0);
+
+  if (p7_dpocc_Collect(occ, pp, tr) != eslOK) esl_fatal(msg);
+
+  if (occ->nsampled != 1)                              esl_fatal(msg);
+  if (occ->nrows != L)                                 esl_fatal(msg);
+  if (occ->bandhist[0] != L || occ->maxband != 0)      esl_fatal(msg);
+  if (esl_DCompare(occ->mass,   (double) L,     1e-6) != eslOK) esl_fatal(msg);
+  if (esl_DCompare(occ->ncells, (double) L * M, 1e-6) != eslOK) esl_fatal(msg);
+  for (t = 0; t < p7_DPOCC_NTHRESH; t++)
+    if (esl_DCompare(occ->nabove[t], (double) L, 1e-6) != eslOK) esl_fatal(msg);
+
+  p7_dpocc_Merge(two, occ);
+  p7_dpocc_Merge(two, occ);
+  if (two->nsampled != 2 || two->nrows != 2*L || two->bandhist[0] != 2*L) esl_fatal(msg);
+
+  p7_dpocc_Reuse(two);
+  if (two->nsampled != 0 || two->mass != 0.) esl_fatal(msg);
+
+  p7_dpocc_Destroy(two);
+  p7_dpocc_Destroy(occ);
+  p7_trace_fs_Destroy(tr);
+  p7_gmx_Destroy(pp);
+}
+
+/* With sample_every = n, only envelopes 1, n+1, 2n+1... are collected. */
+static void
+utest_sampling(void)
+{
+  char      *msg = "p7_dpocc sampling unit test failed";
+  int        M   = 5;
+  int        L   = 15;
+  P7_GMX    *pp  = p7_gmx_fs_Create(M, L, L, p7P_CODONS);
+  P7_TRACE  *tr  = p7_trace_fs_Create();
+  P7_DPOCC  *occ = p7_dpocc_Create(3);
+  float    **dp;
+  int        i, k, n;
+
+  pp->M = M;
+  pp->L = L;
+  dp    = pp->dp;
+  for (i = 1; i <= L; i++)
+    for (k = 1; k <= M; k++)
+      MMX_FS(i,k,p7G_C0) = IMX_FS(i,k) = -eslINFINITY;
+
+  for (n = 0; n < 7; n++)
+    if (p7_dpocc_Collect(occ, pp, tr) != eslOK) esl_fatal(msg);
+  if (occ->nseen != 7 || occ->nsampled != 3) esl_fatal(msg);
+  if (occ->nrows != 0)                        esl_fatal(msg);
+
+  p7_dpocc_Destroy(occ);
+  p7_trace_fs_Destroy(tr);
+  p7_gmx_Destroy(pp);
+}
+#endif /*p7DPOCC_TESTDRIVE*/
+
+/*****************************************************************
+ * 5. Test driver
+ *****************************************************************/
+#ifdef p7DPOCC_TESTDRIVE
+/*
+  gcc -o p7_dpocc_utest -g -Wall -I. -L. -I../easel -L../easel -Dp7DPOCC_TESTDRIVE p7_dpocc.c -lhmmer -leasel -lm
+  ./p7_dpocc_utest
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name  type         default  env   range togs  reqs  incomp  help                   docgrp */
+  { "-h",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show help and usage",           0 },
+  { "-M",  eslARG_INT,     "40",  NULL, NULL, NULL, NULL, NULL, "length of the test model",      0 },
+  { 0,0,0,0,0,0,0,0,0,0},
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for p7_dpocc.c";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS *go = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+
+  utest_diagonal(esl_opt_GetInteger(go, "-M"));
+  utest_sampling();
+
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7DPOCC_TESTDRIVE*/
+/*---------------------- end, test driver ----------------------*/
@@ -64,10 +64,12 @@ extern P7_HIT *p7_hit_Create_empty()
   the_hit->nincluded = 0;
   the_hit->best_domain = 0;
   the_hit->frameshift = FALSE;
+  the_hit->ct = 0;
   the_hit->seqidx = 0;
   the_hit->subseq_start = 0;
   the_hit->dcl = NULL;
   the_hit->offset = 0;
+  the_hit->in_arena = FALSE;
 
   return the_hit;
 ERROR:
@@ -94,6 +96,20 @@ extern void p7_hit_Destroy(P7_HIT *the_hit)
     return;
   }
 
+  // strings and domain list of a hit in a P7_TOPHITS arena belong to the arena
+  if(the_hit->in_arena){
+    for(i = 0; the_hit->dcl != NULL && i < the_hit->ndom; i++){
+      if(the_hit->dcl[i].scores_per_pos != NULL){
+        free(the_hit->dcl[i].scores_per_pos);
+      }
+      if(the_hit->dcl[i].ad != NULL){
+        p7_alidisplay_Destroy(the_hit->dcl[i].ad);
+      }
+    }
+    free(the_hit);
+    return;
+  }
+
   if(the_hit->name != NULL){
     free(the_hit->name);
   }
@@ -418,6 +434,7 @@ extern int p7_hit_Deserialize(const uint8_t *buf, uint32_t *n, P7_HIT *ret_obj)
   }   
 
   ptr = (uint8_t *) buf + *n;
+  ret_obj->in_arena = FALSE; // strings and domains are malloc()'ed below
   
   //First field: Size of the serialized object.  Copy out of buffer into scalar variable to deal with memory alignment, convert to 
   // host machine order
@@ -0,0 +1,541 @@
+/* P7_HITARENA: bulk storage for the strings and domain lists of hits.
+ *
+ * Every hit the BATH pipeline accepts used to get its own domain
+ * list and its own copies of the target name, accession and
+ * description, all freed one by one when the hit list was
+ * destroyed. Hit-dense searches report many hits per target, so
+ * most of those copies were of the same few strings.
+ *
+ * A hit arena hands out memory from large blocks that are only freed
+ * all at once, and interns target metadata by sequence index: the
+ * first hit on a target copies its name, accession and description
+ * into the arena, and later hits on the same target share them.
+ *
+ * Each P7_TOPHITS owns its own arena (created on first use), so the
+ * hit lists of worker threads need no locking; when
+ * <p7_tophits_Merge()> moves hits from one list to another, the
+ * arena's blocks move with them.
+ *
+ * Contents:
+ *   1. The P7_HITARENA object
+ *   2. Allocation and interning
+ *   3. Unit tests
+ *   4. Test driver
+ */
+#include "p7_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "easel.h"
+#include "hmmer.h"
+
+#define p7_HITARENA_BLKSIZE  65536   /* default block size in bytes */
+#define p7_HITARENA_ALIGN    16      /* alignment of everything handed out */
+#define p7_HITARENA_NTGT0    256     /* initial size of the intern table; power of 2 */
+
+static int tgt_grow(P7_HITARENA *ar);
+
+
+/*****************************************************************
+ *= 1. The P7_HITARENA object
+ *****************************************************************/
+
+/* Function:  p7_hitarena_Create()
+ * Synopsis:  Create an empty hit arena.
+ *
+ * Purpose:   Create an arena that allocates in blocks of <blksize>
+ *            bytes, or of a default size if <blksize> is 0. No block
+ *            is allocated until the first request.
+ *
+ * Returns:   a pointer to the new arena.
+ *
+ * Throws:    <NULL> on allocation failure.
+ */
+P7_HITARENA *
+p7_hitarena_Create(size_t blksize)
+{
+  P7_HITARENA *ar = NULL;
+  int          i;
+  int          status;
+
+  ESL_ALLOC(ar, sizeof(P7_HITARENA));
+  ar->blk       = NULL;
+  ar->nblk      = 0;
+  ar->nblkalloc = 0;
+  ar->blksize   = (blksize > 0 ? blksize : p7_HITARENA_BLKSIZE);
+  ar->used      = 0;
+  ar->curr      = 0;
+  ar->nbytes    = 0;
+  ar->tgt       = NULL;
+  ar->ntgt      = 0;
+  ar->ntgtalloc = p7_HITARENA_NTGT0;
+  ar->nintern   = 0;
+
+  ESL_ALLOC(ar->tgt, sizeof(P7_HITARENA_TGT) * ar->ntgtalloc);
+  for (i = 0; i < ar->ntgtalloc; i++) ar->tgt[i].name = NULL;
+  return ar;
+
+ ERROR:
+  p7_hitarena_Destroy(ar);
+  return NULL;
+}
+
+
+/* Function:  p7_hitarena_Reuse()
+ * Synopsis:  Free everything in an arena, keeping one block.
+ *
+ * Purpose:   Free all the memory <ar> has handed out and empty its
+ *            intern table. The first block is kept for reuse.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_hitarena_Reuse(P7_HITARENA *ar)
+{
+  int b, i;
+
+  if (ar == NULL) return eslOK;
+  for (b = 1; b < ar->nblk; b++) free(ar->blk[b]);
+  ar->nblk   = ESL_MIN(ar->nblk, 1);
+  ar->used   = 0;
+  ar->curr   = (ar->nblk ? ar->blksize : 0);
+  ar->nbytes = 0;
+
+  for (i = 0; i < ar->ntgtalloc; i++) ar->tgt[i].name = NULL;
+  ar->ntgt    = 0;
+  ar->nintern = 0;
+  return eslOK;
+}
+
+
+/* Function:  p7_hitarena_Destroy()
+ * Synopsis:  Free an arena and everything allocated from it.
+ */
+void
+p7_hitarena_Destroy(P7_HITARENA *ar)
+{
+  int b;
+
+  if (ar == NULL) return;
+  for (b = 0; b < ar->nblk; b++) free(ar->blk[b]);
+  if (ar->blk) free(ar->blk);
+  if (ar->tgt) free(ar->tgt);
+  free(ar);
+}
+
+
+/* Function:  p7_hitarena_Absorb()
+ * Synopsis:  Take over another arena's memory.
+ *
+ * Purpose:   Move all the blocks of <ar2> into <ar>, so that memory
+ *            handed out by <ar2> now lives (and dies) with <ar>; its
+ *            interned targets are added to <ar>'s intern table.
+ *            <ar2> is left empty and may be reused or destroyed.
+ *
+ *            <ar> keeps allocating from its own current block.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure; both arenas are then
+ *            unchanged, except that <ar>'s tables may have grown.
+ */
+int
+p7_hitarena_Absorb(P7_HITARENA *ar, P7_HITARENA *ar2)
+{
+  void *p;
+  int   nblk = ar->nblk + ar2->nblk;
+  int   i, j;
+  int   status;
+
+  if (ar2->nblk == 0) return eslOK;
+
+  /* intern table first: it's the only step that can fail after the blocks move */
+  while ((ar->ntgt + ar2->ntgt) * 2 > ar->ntgtalloc)
+    if ((status = tgt_grow(ar)) != eslOK) return status;
+
+  if (nblk > ar->nblkalloc)
+    {
+      ESL_RALLOC(ar->blk, p, sizeof(char *) * nblk);
+      ar->nblkalloc = nblk;
+    }
+
+  /* <ar2>'s blocks go in front of <ar>'s current (last) one */
+  if (ar->nblk > 0)
+    {
+      ar->blk[nblk-1] = ar->blk[ar->nblk-1];
+      for (i = 0; i < ar2->nblk; i++) ar->blk[ar->nblk-1+i] = ar2->blk[i];
+    }
+  else
+    {
+      for (i = 0; i < ar2->nblk; i++) ar->blk[i] = ar2->blk[i];
+      ar->used = ar2->used;
+      ar->curr = ar2->curr;
+    }
+  ar->nblk    = nblk;
+  ar->nbytes += ar2->nbytes;
+
+  for (i = 0; i < ar2->ntgtalloc; i++)
+    if (ar2->tgt[i].name != NULL)
+      {
+        j = (int) ((uint64_t) ar2->tgt[i].seqidx * 0x9E3779B97F4A7C15ULL >> 32) & (ar->ntgtalloc - 1);
+        while (ar->tgt[j].name != NULL && ar->tgt[j].seqidx != ar2->tgt[i].seqidx) j = (j+1) & (ar->ntgtalloc - 1);
+        if (ar->tgt[j].name == NULL) { ar->tgt[j] = ar2->tgt[i]; ar->ntgt++; }
+      }
+
+  ar2->nblk = 0;
+  ar2->used = 0;
+  ar2->curr = 0;
+  ar2->nbytes = 0;
+  for (i = 0; i < ar2->ntgtalloc; i++) ar2->tgt[i].name = NULL;
+  ar2->ntgt    = 0;
+  ar2->nintern = 0;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+/*------------------ end, P7_HITARENA object --------------------*/
+
+
+
+/*****************************************************************
+ *= 2. Allocation and interning
+ *****************************************************************/
+
+/* Function:  p7_hitarena_Alloc()
+ * Synopsis:  Allocate memory from an arena.
+ *
+ * Purpose:   Return <n> bytes of memory from <ar>, aligned for any
+ *            type. The memory can't be freed or reallocated by
+ *            itself; it lives until <ar> is reused or destroyed.
+ *            Requests bigger than the block size get a block of
+ *            their own.
+ *
+ * Returns:   a pointer to the memory.
+ *
+ * Throws:    <NULL> on allocation failure.
+ */
+void *
+p7_hitarena_Alloc(P7_HITARENA *ar, size_t n)
+{
+  void   *p;
+  char   *blk = NULL;
+  size_t  bsz;
+  int     status;
+
+  n = (n + p7_HITARENA_ALIGN - 1) & ~((size_t) p7_HITARENA_ALIGN - 1);
+
+  if (ar->nblk == 0 || ar->used + n > ar->curr)
+    {
+      bsz = ESL_MAX(n, ar->blksize);
+      if (ar->nblk == ar->nblkalloc)
+        {
+          ESL_RALLOC(ar->blk, p, sizeof(char *) * (ar->nblkalloc + 16));
+          ar->nblkalloc += 16;
+        }
+      ESL_ALLOC(blk, bsz);
+
+      /* an oversized block goes in front of the current one, which keeps serving small requests */
+      if (bsz > ar->blksize && ar->nblk > 0 && ar->curr - ar->used >= p7_HITARENA_ALIGN)
+        {
+          ar->blk[ar->nblk]   = ar->blk[ar->nblk-1];
+          ar->blk[ar->nblk-1] = blk;
+          ar->nblk++;
+          ar->nbytes += n;
+          return blk;
+        }
+      ar->blk[ar->nblk++] = blk;
+      ar->used = 0;
+      ar->curr = bsz;
+    }
+
+  p         = ar->blk[ar->nblk-1] + ar->used;
+  ar->used += n;
+  ar->nbytes += n;
+  return p;
+
+ ERROR:
+  return NULL;
+}
+
+
+/* Function:  p7_hitarena_Strdup()
+ * Synopsis:  Copy a string into an arena.
+ *
+ * Purpose:   Like <esl_strdup()>: copy <s> (of length <n>, or -1 if
+ *            unknown) into memory from <ar>, and return the copy in
+ *            <*ret_s>. If <s> is <NULL>, <*ret_s> is <NULL>.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure; <*ret_s> is <NULL>.
+ */
+int
+p7_hitarena_Strdup(P7_HITARENA *ar, const char *s, int64_t n, char **ret_s)
+{
+  char *new = NULL;
+
+  *ret_s = NULL;
+  if (s == NULL) return eslOK;
+  if (n < 0) n = strlen(s);
+  if ((new = p7_hitarena_Alloc(ar, n+1)) == NULL) ESL_EXCEPTION(eslEMEM, "hit arena allocation failed");
+  memcpy(new, s, n);
+  new[n] = '\0';
+  *ret_s = new;
+  return eslOK;
+}
+
+
+/* Function:  p7_hitarena_InternTarget()
+ * Synopsis:  Get arena copies of a target's name, accession and description.
+ *
+ * Purpose:   Return copies in <ar> of the <name>, <acc> and <desc> of
+ *            the target sequence with index <seqidx>, in <*ret_name>,
+ *            <*ret_acc> and <*ret_desc>. The first call for a
+ *            <seqidx> copies the strings; later calls with the same
+ *            strings return the same copies. An empty or <NULL>
+ *            <acc> or <desc> is returned as <NULL>, as the pipeline
+ *            stores a target without one.
+ *
+ *            If a call for a <seqidx> has different strings than
+ *            the interned ones (sequence indices are only unique
+ *            within one database), the new ones are copied and
+ *            replace the old in the table; copies already handed out
+ *            stay valid.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_hitarena_InternTarget(P7_HITARENA *ar, int64_t seqidx, const char *name, const char *acc, const char *desc,
+                         char **ret_name, char **ret_acc, char **ret_desc)
+{
+  P7_HITARENA_TGT *e;
+  char            *n = NULL;
+  char            *a = NULL;
+  char            *d = NULL;
+  int              j;
+  int              status;
+
+  if (acc  != NULL && acc[0]  == '\0') acc  = NULL;
+  if (desc != NULL && desc[0] == '\0') desc = NULL;
+
+  if ((ar->ntgt + 1) * 2 > ar->ntgtalloc && (status = tgt_grow(ar)) != eslOK) return status;
+
+  j = (int) ((uint64_t) seqidx * 0x9E3779B97F4A7C15ULL >> 32) & (ar->ntgtalloc - 1);
+  while (ar->tgt[j].name != NULL && ar->tgt[j].seqidx != seqidx) j = (j+1) & (ar->ntgtalloc - 1);
+  e = &(ar->tgt[j]);
+
+  if (e->name != NULL && esl_strcmp(e->name, name) == 0 && esl_strcmp(e->acc, acc) == 0 && esl_strcmp(e->desc, desc) == 0)
+    {
+      ar->nintern++;
+    }
+  else
+    {
+      if ((status = p7_hitarena_Strdup(ar, name, -1, &n)) != eslOK) goto ERROR;
+      if ((status = p7_hitarena_Strdup(ar, acc,  -1, &a)) != eslOK) goto ERROR;
+      if ((status = p7_hitarena_Strdup(ar, desc, -1, &d)) != eslOK) goto ERROR;
+      if (e->name == NULL) ar->ntgt++;
+      e->seqidx = seqidx;
+      e->name   = n;
+      e->acc    = a;
+      e->desc   = d;
+    }
+
+  *ret_name = e->name;
+  *ret_acc  = e->acc;
+  *ret_desc = e->desc;
+  return eslOK;
+
+ ERROR:
+  *ret_name = *ret_acc = *ret_desc = NULL;
+  return status;
+}
+
+
+/* tgt_grow()
+ * Double the intern table and rehash. Called before it gets more
+ * than half full, so linear probing stays short.
+ */
+static int
+tgt_grow(P7_HITARENA *ar)
+{
+  P7_HITARENA_TGT *old  = ar->tgt;
+  int              nold = ar->ntgtalloc;
+  int              i, j;
+  int              status;
+
+  ESL_ALLOC(ar->tgt, sizeof(P7_HITARENA_TGT) * nold * 2);
+  ar->ntgtalloc = nold * 2;
+  for (j = 0; j < ar->ntgtalloc; j++) ar->tgt[j].name = NULL;
+
+  for (i = 0; i < nold; i++)
+    if (old[i].name != NULL)
+      {
+        j = (int) ((uint64_t) old[i].seqidx * 0x9E3779B97F4A7C15ULL >> 32) & (ar->ntgtalloc - 1);
+        while (ar->tgt[j].name != NULL) j = (j+1) & (ar->ntgtalloc - 1);
+        ar->tgt[j] = old[i];
+      }
+  free(old);
+  return eslOK;
+
+ ERROR:
+  ar->tgt = old;
+  return status;
+}
+/*------------- end, allocation and interning -------------------*/
+
+
+
+/*****************************************************************
+ *= 3. Unit tests
+ *****************************************************************/
+#ifdef p7HITARENA_TESTDRIVE
+#include "esl_random.h"
+
+/* Allocations are aligned, don't overlap, and survive later
+ * allocations; oversized requests work; interning returns the same
+ * copies for a repeated target and fresh ones for changed strings.
+ */
+static void
+utest_arena(ESL_RANDOMNESS *r, int N)
+{
+  char         *msg  = "hit arena unit test failed";
+  P7_HITARENA  *ar   = p7_hitarena_Create(256);
+  char        **s    = malloc(sizeof(char *) * N);
+  char        **name = malloc(sizeof(char *) * N);
+  char          buf[64];
+  char         *big, *n1, *a1, *d1, *n2, *a2, *d2;
+  int           i, len;
+
+  if (ar == NULL || s == NULL || name == NULL) esl_fatal(msg);
+
+  for (i = 0; i < N; i++)
+    {
+      len = esl_rnd_Roll(r, 60);
+      memset(buf, 'a' + i % 26, len);
+      buf[len] = '\0';
+      if (p7_hitarena_Strdup(ar, buf, -1, &(s[i])) != eslOK)  esl_fatal(msg);
+      if (((uintptr_t) s[i]) % p7_HITARENA_ALIGN != 0)        esl_fatal(msg);
+      if (i % 50 == 0) {
+        if ((big = p7_hitarena_Alloc(ar, 1000)) == NULL)      esl_fatal(msg);
+        memset(big, 0xff, 1000);
+      }
+    }
+  for (i = 0; i < N; i++)
+    {
+      len = strlen(s[i]);
+      if (len >= 60)                                  esl_fatal(msg);
+      if (len > 0 && s[i][0] != 'a' + i % 26)         esl_fatal(msg);
+      if (len > 0 && s[i][len-1] != 'a' + i % 26)     esl_fatal(msg);
+    }
+
+  if (p7_hitarena_InternTarget(ar, 7, "seq7", "",   "a description", &n1, &a1, &d1) != eslOK) esl_fatal(msg);
+  if (p7_hitarena_InternTarget(ar, 7, "seq7", NULL, "a description", &n2, &a2, &d2) != eslOK) esl_fatal(msg);
+  if (n1 != n2 || a1 != NULL || a2 != NULL || d1 != d2)                                   esl_fatal(msg);
+  if (strcmp(n1, "seq7") != 0 || strcmp(d1, "a description") != 0)                        esl_fatal(msg);
+  if (p7_hitarena_InternTarget(ar, 7, "other", "ACC", NULL, &n2, &a2, &d2) != eslOK)      esl_fatal(msg);
+  if (n1 == n2 || strcmp(n2, "other") != 0 || strcmp(a2, "ACC") != 0 || d2 != NULL)       esl_fatal(msg);
+  if (strcmp(n1, "seq7") != 0)                                                            esl_fatal(msg);
+
+  /* enough targets to grow the table */
+  for (i = 0; i < N; i++)
+    {
+      snprintf(buf, 64, "target%d", i);
+      if (p7_hitarena_InternTarget(ar, i * 1000003, buf, NULL, NULL, &(name[i]), &a1, &d1) != eslOK) esl_fatal(msg);
+    }
+  for (i = 0; i < N; i++)
+    {
+      snprintf(buf, 64, "target%d", i);
+      if (p7_hitarena_InternTarget(ar, i * 1000003, buf, NULL, NULL, &n1, &a1, &d1) != eslOK) esl_fatal(msg);
+      if (n1 != name[i]) esl_fatal(msg);
+    }
+
+  free(name);
+  free(s);
+  p7_hitarena_Destroy(ar);
+}
+
+/* After Absorb(), memory from both arenas is intact and owned by the
+ * first; both arenas keep working.
+ */
+static void
+utest_absorb(int N)
+{
+  char         *msg = "hit arena absorb unit test failed";
+  P7_HITARENA  *ar1 = p7_hitarena_Create(128);
+  P7_HITARENA  *ar2 = p7_hitarena_Create(128);
+  char        **s1  = malloc(sizeof(char *) * N);
+  char        **s2  = malloc(sizeof(char *) * N);
+  char          buf[32];
+  char         *n, *a, *d;
+  int           i;
+
+  for (i = 0; i < N; i++)
+    {
+      snprintf(buf, 32, "one%d", i);
+      if (p7_hitarena_Strdup(ar1, buf, -1, &(s1[i])) != eslOK) esl_fatal(msg);
+      snprintf(buf, 32, "two%d", i);
+      if (p7_hitarena_Strdup(ar2, buf, -1, &(s2[i])) != eslOK) esl_fatal(msg);
+    }
+  if (p7_hitarena_InternTarget(ar2, 3, "three", NULL, NULL, &n, &a, &d) != eslOK) esl_fatal(msg);
+
+  if (p7_hitarena_Absorb(ar1, ar2) != eslOK) esl_fatal(msg);
+  if (ar2->nblk != 0 || ar2->ntgt != 0)      esl_fatal(msg);
+  p7_hitarena_Destroy(ar2);
+
+  if (p7_hitarena_InternTarget(ar1, 3, "three", NULL, NULL, &a, &d, &d) != eslOK || a != n) esl_fatal(msg);
+  if (p7_hitarena_Strdup(ar1, "after", -1, &a) != eslOK || strcmp(a, "after") != 0)        esl_fatal(msg);
+  for (i = 0; i < N; i++)
+    {
+      snprintf(buf, 32, "one%d", i);
+      if (strcmp(s1[i], buf) != 0) esl_fatal(msg);
+      snprintf(buf, 32, "two%d", i);
+      if (strcmp(s2[i], buf) != 0) esl_fatal(msg);
+    }
+
+  if (p7_hitarena_Reuse(ar1) != eslOK || ar1->nblk != 1) esl_fatal(msg);
+  if (p7_hitarena_Strdup(ar1, "again", -1, &a) != eslOK || strcmp(a, "again") != 0) esl_fatal(msg);
+
+  free(s1);
+  free(s2);
+  p7_hitarena_Destroy(ar1);
+}
+#endif /*p7HITARENA_TESTDRIVE*/
+/*------------------- end, unit tests ---------------------------*/
+
+
+
+/*****************************************************************
+ *= 4. Test driver
+ *****************************************************************/
+#ifdef p7HITARENA_TESTDRIVE
+#include "esl_getopts.h"
+
+static ESL_OPTIONS options[] = {
+  /* name           type      default  env  range toggles reqs incomp  help                                       docgroup*/
+  { "-h",        eslARG_NONE,   FALSE, NULL, NULL,  NULL,  NULL, NULL, "show brief help on version and usage",             0 },
+  { "-s",        eslARG_INT,     "42", NULL, NULL,  NULL,  NULL, NULL, "set random number seed to <n>",                    0 },
+  { "-N",        eslARG_INT,   "1000", NULL, NULL,  NULL,  NULL, NULL, "number of allocations",                            0 },
+  {  0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for P7_HITARENA";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r  = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  int             N  = esl_opt_GetInteger(go, "-N");
+
+  utest_arena(r, N);
+  utest_absorb(N);
+
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7HITARENA_TESTDRIVE*/
@@ -15,6 +15,8 @@
 #include "hmmer.h"
 #include "p7_hmmcache.h"
 
+static int hmmcache_open(char *hmmfile, int keep_hmms, P7_HMMCACHE **ret_cache, char *errbuf);
+
 /*****************************************************************
  * 1. P7_HMMCACHE: a daemon's cached profile database
  *****************************************************************/ 
@@ -49,37 +51,92 @@
  */
 int
 p7_hmmcache_Open(char *hmmfile, P7_HMMCACHE **ret_cache, char *errbuf)
+{
+  return hmmcache_open(hmmfile, FALSE, ret_cache, errbuf);
+}
+
+
+/* Function:  p7_hmmcache_OpenHMMs()
+ * Synopsis:  Cache a profile database, keeping the full HMMs too.
+ *
+ * Purpose:   As <p7_hmmcache_Open()>, but also keep each full model,
+ *            in <cache->hmm[0..n-1]>, for a caller that needs to
+ *            configure other profiles from them (the BATH models of
+ *            an hmmpgmd worker). <hmmfile> must be pressed; its
+ *            full models are read from the <.h3m> in the same pass
+ *            that reads the optimized profiles from the <.h3f> and
+ *            <.h3p>. The caller drops them with
+ *            <p7_hmmcache_DropHMMs()> once it's done with them.
+ *
+ * Returns:   As <p7_hmmcache_Open()>; <eslEFORMAT> also if <hmmfile>
+ *            isn't pressed, or if a full model doesn't match its
+ *            optimized profile.
+ *
+ * Throws:    <eslEMEM> : memory allocation error.
+ */
+int
+p7_hmmcache_OpenHMMs(char *hmmfile, P7_HMMCACHE **ret_cache, char *errbuf)
+{
+  return hmmcache_open(hmmfile, TRUE, ret_cache, errbuf);
+}
+
+/* hmmcache_open()
+ * Does the work of p7_hmmcache_Open() and p7_hmmcache_OpenHMMs().
+ */
+static int
+hmmcache_open(char *hmmfile, int keep_hmms, P7_HMMCACHE **ret_cache, char *errbuf)
 {
   P7_HMMCACHE *cache    = NULL;
   P7_HMMFILE  *hfp      = NULL;        /* open HMM database file    */
   P7_OPROFILE *om       = NULL;        /* target profile            */
+  P7_HMM      *hmm      = NULL;        /* its full model, if kept   */
   int          status;
   
   ESL_ALLOC(cache, sizeof(P7_HMMCACHE));
   cache->name      = NULL;
   cache->abc       = NULL;
   cache->list      = NULL;
+  cache->hmm       = NULL;
   cache->lalloc    = 4096;	/* allocation chunk size for <list> of ptrs  */
   cache->n         = 0;
 
   if ( ( status = esl_strdup(hmmfile, -1, &cache->name) != eslOK)) goto ERROR; 
   ESL_ALLOC(cache->list, sizeof(P7_OPROFILE *) * cache->lalloc);
+  if (keep_hmms) ESL_ALLOC(cache->hmm, sizeof(P7_HMM *) * cache->lalloc);
 
   if ( (status = p7_hmmfile_OpenE(hmmfile, NULL, &hfp, errbuf)) != eslOK) goto ERROR;  // eslENOTFOUND | eslEFORMAT 
+  if (keep_hmms && ! hfp->is_pressed) {
+    if (errbuf) snprintf(errbuf, eslERRBUFSIZE, "%s isn't pressed", hmmfile);
+    status = eslEFORMAT;
+    goto ERROR;
+  }
 
   while ((status = p7_oprofile_ReadMSV(hfp, &(cache->abc), &om)) == eslOK) /* eslEFORMAT | eslEINCOMPAT */
     {
       if (( status = p7_oprofile_ReadRest(hfp, om)) != eslOK) break; /* eslEFORMAT */
 
+      /* the .h3m holds the same models, in the same order, as the .h3f/.h3p */
+      if (keep_hmms) {
+        if (( status = p7_hmmfile_Read(hfp, &(cache->abc), &hmm)) != eslOK) break; /* eslEFORMAT | eslEINCOMPAT */
+        if (hmm->M != om->M) { 
+          snprintf(hfp->errbuf, eslERRBUFSIZE, "model %d doesn't match its optimized profile", cache->n+1);
+          status = eslEFORMAT; 
+          break; 
+        }
+      }
+
       if (cache->n >= cache->lalloc) {
 	ESL_REALLOC(cache->list, sizeof(char *) * cache->lalloc * 2);
+	if (keep_hmms) ESL_REALLOC(cache->hmm, sizeof(P7_HMM *) * cache->lalloc * 2);
 	cache->lalloc *= 2;
       }
       
+      if (keep_hmms) cache->hmm[cache->n] = hmm;
       cache->list[cache->n++] = om;
-      om = NULL;
+      om  = NULL;
+      hmm = NULL;
     }
-  if (status != eslEOF)  { strncpy(errbuf, hfp->errbuf, eslERRBUFSIZE); goto ERROR; }
+  if (status != eslEOF)  { if (errbuf) strncpy(errbuf, hfp->errbuf, eslERRBUFSIZE); goto ERROR; }
 
   //printf("\nfinal:: %d  memory %" PRId64 "\n", inx, total_mem);
   p7_hmmfile_Close(hfp);
@@ -89,7 +146,9 @@ p7_hmmcache_Open(char *hmmfile, P7_HMMCACHE **ret_cache, char *errbuf)
  ERROR:
   if (cache) p7_hmmcache_Close(cache);
   if (om)    p7_oprofile_Destroy(om);
+  if (hmm)   p7_hmm_Destroy(hmm);
   if (hfp)   p7_hmmfile_Close(hfp);
+  *ret_cache = NULL;
   return status;
 }
 
@@ -145,6 +204,26 @@ p7_hmmcache_SetNumericNames(P7_HMMCACHE *cache)
 }
 
 
+/* Function:  p7_hmmcache_DropHMMs()
+ * Synopsis:  Free the full HMMs kept by p7_hmmcache_OpenHMMs().
+ *
+ * Purpose:   Free the full models of <cache>, leaving only the
+ *            optimized profiles, as <p7_hmmcache_Open()> would have.
+ *            A no-op if there are none.
+ */
+void
+p7_hmmcache_DropHMMs(P7_HMMCACHE *cache)
+{
+  int i;
+
+  if (! cache->hmm) return;
+  for (i = 0; i < cache->n; i++)
+    p7_hmm_Destroy(cache->hmm[i]);
+  free(cache->hmm);
+  cache->hmm = NULL;
+}
+
+
 /* Function:  p7_hmmcache_Close()
  * Synopsis:  Free a profile cache.
  */
@@ -155,6 +234,7 @@ p7_hmmcache_Close(P7_HMMCACHE *cache)
 
   if (! cache) return;
   if (cache->name) free(cache->name);
+  p7_hmmcache_DropHMMs(cache);
   if (cache->abc)  esl_alphabet_Destroy(cache->abc);
   if (cache->list) 
     {
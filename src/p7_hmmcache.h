@@ -11,11 +11,14 @@ typedef struct {
   ESL_ALPHABET       *abc;         /* alphabet for database                 */
 
   P7_OPROFILE       **list;        /* list of profiles [0 .. n-1]           */
+  P7_HMM            **hmm;         /* their full models [0 .. n-1], or NULL */
   uint32_t            lalloc;	   /* allocated length of <list>            */
   uint32_t            n;           /* number of entries in <list>           */
 } P7_HMMCACHE;
 
-extern int    p7_hmmcache_Open (char *hmmfile, P7_HMMCACHE **ret_cache, char *errbuf);
+extern int    p7_hmmcache_Open           (char *hmmfile, P7_HMMCACHE **ret_cache, char *errbuf);
+extern int    p7_hmmcache_OpenHMMs       (char *hmmfile, P7_HMMCACHE **ret_cache, char *errbuf);
+extern void   p7_hmmcache_DropHMMs       (P7_HMMCACHE *cache);
 extern size_t p7_hmmcache_Sizeof         (P7_HMMCACHE *cache);
 extern int    p7_hmmcache_SetNumericNames(P7_HMMCACHE *cache);
 extern void   p7_hmmcache_Close          (P7_HMMCACHE *cache);
@@ -0,0 +1,723 @@
+/* P7_HMMCLUSTERS: redundancy clusters of a profile library.
+ *
+ * Large profile libraries are full of near-duplicates: subfamily
+ * models, models of the same domain built from different seeds,
+ * species-specific copies. Searching a genome with every one of them
+ * runs the same MSV and Viterbi filters over the same DNA again and
+ * again, only to find that the same handful of windows pass.
+ *
+ * bathcluster groups the models of a library by single-linkage
+ * clustering on profile similarity, and picks one member of each
+ * cluster as its representative: the medoid, the member most similar
+ * to all the others. bathsearch --clusters screens the target
+ * database once per cluster with the representative, with loosened
+ * filter thresholds, and then searches each member only against the
+ * windows that passed.
+ *
+ * Profile similarity is the fraction of shared consensus words: the
+ * number of distinct 3-mers of consensus residues the two models have
+ * in common, divided by the number in the smaller model. It is
+ * cheap, symmetric, and high exactly for the kind of redundancy that
+ * lets one model's filter survivors stand in for another's.
+ *
+ * The cluster map is a small text file kept next to the library,
+ * <hmmfile>.bclust, one line per model.
+ *
+ * Contents:
+ *   1. The <P7_HMMCLUSTERS> object
+ *   2. Profile similarity
+ *   3. Clustering a library
+ *   4. Cluster map input/output
+ *   5. Unit tests
+ *   6. Test driver
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_fileparser.h"
+#include "esl_keyhash.h"
+
+#include "hmmer.h"
+
+static int consensus_words(const P7_HMM *hmm, int **ret_w, int *ret_n);
+static int shared_words   (const int *w1, int n1, const int *w2, int n2);
+
+
+/*****************************************************************
+ * 1. The <P7_HMMCLUSTERS> object
+ *****************************************************************/
+
+/* Function:  p7_hmmclusters_Create()
+ * Synopsis:  Create an empty cluster map.
+ *
+ * Returns:   a pointer to the new <P7_HMMCLUSTERS>.
+ *
+ * Throws:    <NULL> on allocation failure.
+ */
+P7_HMMCLUSTERS *
+p7_hmmclusters_Create(void)
+{
+  P7_HMMCLUSTERS *hc = NULL;
+  int             status;
+
+  ESL_ALLOC(hc, sizeof(P7_HMMCLUSTERS));
+  hc->name     = NULL;
+  hc->assign   = NULL;
+  hc->W        = NULL;
+  hc->rep      = NULL;
+  hc->size     = NULL;
+  hc->maxW     = NULL;
+  hc->kh       = NULL;
+  hc->nmodel   = 0;
+  hc->nclust   = 0;
+  hc->nalloc   = 64;
+  hc->cnalloc  = 64;
+
+  ESL_ALLOC(hc->name,   sizeof(char *) * hc->nalloc);
+  ESL_ALLOC(hc->assign, sizeof(int)    * hc->nalloc);
+  ESL_ALLOC(hc->W,      sizeof(int)    * hc->nalloc);
+  ESL_ALLOC(hc->rep,    sizeof(int)    * hc->cnalloc);
+  ESL_ALLOC(hc->size,   sizeof(int)    * hc->cnalloc);
+  ESL_ALLOC(hc->maxW,   sizeof(int)    * hc->cnalloc);
+  if ((hc->kh = esl_keyhash_Create()) == NULL) goto ERROR;
+  return hc;
+
+ ERROR:
+  p7_hmmclusters_Destroy(hc);
+  return NULL;
+}
+
+/* Function:  p7_hmmclusters_Add()
+ * Synopsis:  Add one model to a cluster map.
+ *
+ * Purpose:   Add model <name> to cluster <c> of map <hc>, with window
+ *            length <W> (its <max_length>, or -1 if unknown). If
+ *            <is_rep> is TRUE, the model is the cluster's
+ *            representative. Clusters are numbered from 0; a cluster
+ *            comes into existence when its first member is added.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEDUP> if <name> is already in the map.
+ *            <eslEINVAL> if <c> is negative, or if <is_rep> is TRUE
+ *            and cluster <c> already has a representative.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_hmmclusters_Add(P7_HMMCLUSTERS *hc, const char *name, int W, int c, int is_rep)
+{
+  int idx;
+  int status;
+
+  if (c < 0)                                 return eslEINVAL;
+  if (is_rep && c < hc->nclust && hc->rep[c] >= 0) return eslEINVAL;
+
+  status = esl_keyhash_Store(hc->kh, name, -1, &idx);
+  if (status != eslOK) return status;
+
+  if (hc->nmodel == hc->nalloc)
+    {
+      ESL_REALLOC(hc->name,   sizeof(char *) * hc->nalloc * 2);
+      ESL_REALLOC(hc->assign, sizeof(int)    * hc->nalloc * 2);
+      ESL_REALLOC(hc->W,      sizeof(int)    * hc->nalloc * 2);
+      hc->nalloc *= 2;
+    }
+  while (c >= hc->cnalloc)
+    {
+      ESL_REALLOC(hc->rep,  sizeof(int) * hc->cnalloc * 2);
+      ESL_REALLOC(hc->size, sizeof(int) * hc->cnalloc * 2);
+      ESL_REALLOC(hc->maxW, sizeof(int) * hc->cnalloc * 2);
+      hc->cnalloc *= 2;
+    }
+  for (; hc->nclust <= c; hc->nclust++)
+    {
+      hc->rep[hc->nclust]  = -1;
+      hc->size[hc->nclust] = 0;
+      hc->maxW[hc->nclust] = -1;
+    }
+
+  if ((status = esl_strdup(name, -1, &(hc->name[idx]))) != eslOK) goto ERROR;
+  hc->assign[idx] = c;
+  hc->W[idx]      = W;
+  hc->nmodel++;
+
+  hc->size[c]++;
+  hc->maxW[c] = ESL_MAX(hc->maxW[c], W);
+  if (is_rep) hc->rep[c] = idx;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+/* Function:  p7_hmmclusters_Lookup()
+ * Synopsis:  Which cluster is a model in?
+ *
+ * Purpose:   Look up model <name> in map <hc> and return its cluster
+ *            in <*ret_c>.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslENOTFOUND> if <name> isn't in the map; <*ret_c> is -1.
+ */
+int
+p7_hmmclusters_Lookup(const P7_HMMCLUSTERS *hc, const char *name, int *ret_c)
+{
+  int idx;
+
+  if (esl_keyhash_Lookup(hc->kh, name, -1, &idx) != eslOK) { *ret_c = -1; return eslENOTFOUND; }
+  *ret_c = hc->assign[idx];
+  return eslOK;
+}
+
+/* Function:  p7_hmmclusters_Destroy()
+ * Synopsis:  Free a cluster map.
+ */
+void
+p7_hmmclusters_Destroy(P7_HMMCLUSTERS *hc)
+{
+  int i;
+
+  if (hc == NULL) return;
+  if (hc->name) {
+    for (i = 0; i < hc->nmodel; i++) free(hc->name[i]);
+    free(hc->name);
+  }
+  if (hc->assign) free(hc->assign);
+  if (hc->W)      free(hc->W);
+  if (hc->rep)    free(hc->rep);
+  if (hc->size)   free(hc->size);
+  if (hc->maxW)   free(hc->maxW);
+  if (hc->kh)     esl_keyhash_Destroy(hc->kh);
+  free(hc);
+}
+/*------------------ end, P7_HMMCLUSTERS object -----------------*/
+
+
+/*****************************************************************
+ * 2. Profile similarity
+ *****************************************************************/
+
+/* consensus_words()
+ * The sorted, distinct consensus words of <hmm>: each run of
+ * p7_HMMCLUSTER_K consecutive match states, with each state's most
+ * probable residue, packed into an integer in base <abc->K>. Models
+ * shorter than a word have none.
+ */
+static int
+consensus_words(const P7_HMM *hmm, int **ret_w, int *ret_n)
+{
+  int  *cons = NULL;
+  int  *w    = NULL;
+  int   K    = hmm->abc->K;
+  int   n    = 0;
+  int   i, j, k, a;
+  int   status;
+
+  *ret_w = NULL;
+  *ret_n = 0;
+  if (hmm->M < p7_HMMCLUSTER_K) return eslOK;
+
+  ESL_ALLOC(cons, sizeof(int) * (hmm->M + 1));
+  ESL_ALLOC(w,    sizeof(int) * (hmm->M - p7_HMMCLUSTER_K + 1));
+
+  for (k = 1; k <= hmm->M; k++)
+    {
+      cons[k] = 0;
+      for (a = 1; a < K; a++)
+        if (hmm->mat[k][a] > hmm->mat[k][cons[k]]) cons[k] = a;
+    }
+
+  for (k = 1; k + p7_HMMCLUSTER_K - 1 <= hmm->M; k++)
+    {
+      for (a = 0, j = 0; j < p7_HMMCLUSTER_K; j++) a = a * K + cons[k+j];
+      w[n++] = a;
+    }
+
+  /* sort and make distinct; n is at most a few thousand, so insertion sort is fine */
+  for (i = 1; i < n; i++)
+    {
+      a = w[i];
+      for (j = i; j > 0 && w[j-1] > a; j--) w[j] = w[j-1];
+      w[j] = a;
+    }
+  for (i = 0, j = 0; i < n; i++)
+    if (j == 0 || w[i] != w[j-1]) w[j++] = w[i];
+
+  free(cons);
+  *ret_w = w;
+  *ret_n = j;
+  return eslOK;
+
+ ERROR:
+  if (cons) free(cons);
+  if (w)    free(w);
+  return status;
+}
+
+/* shared_words()
+ * Number of words two sorted distinct word lists have in common.
+ */
+static int
+shared_words(const int *w1, int n1, const int *w2, int n2)
+{
+  int i = 0, j = 0, nshared = 0;
+
+  while (i < n1 && j < n2)
+    {
+      if      (w1[i] < w2[j]) i++;
+      else if (w1[i] > w2[j]) j++;
+      else  { nshared++; i++; j++; }
+    }
+  return nshared;
+}
+
+/* Function:  p7_hmmclusters_Similarity()
+ * Synopsis:  Consensus word similarity of two profiles.
+ *
+ * Purpose:   Return the fraction of consensus words shared by <hmm1>
+ *            and <hmm2>: the number of distinct p7_HMMCLUSTER_K-mers
+ *            of consensus residues the two have in common, divided by
+ *            the number in the model that has fewer. 1.0 for identical
+ *            consensus sequences, or when one is contained in the
+ *            other; 0.0 if either model is shorter than a word.
+ *
+ * Throws:    (no abnormal error conditions; returns 0.0 on allocation
+ *            failure.)
+ */
+float
+p7_hmmclusters_Similarity(const P7_HMM *hmm1, const P7_HMM *hmm2)
+{
+  int   *w1 = NULL, *w2 = NULL;
+  int    n1, n2;
+  float  sim = 0.;
+
+  if (consensus_words(hmm1, &w1, &n1) == eslOK && consensus_words(hmm2, &w2, &n2) == eslOK && n1 > 0 && n2 > 0)
+    sim = (float) shared_words(w1, n1, w2, n2) / (float) ESL_MIN(n1, n2);
+
+  if (w1) free(w1);
+  if (w2) free(w2);
+  return sim;
+}
+/*--------------------- end, profile similarity -----------------*/
+
+
+/*****************************************************************
+ * 3. Clustering a library
+ *****************************************************************/
+
+static int
+uf_find(int *parent, int i)
+{
+  int root = i, next;
+
+  while (parent[root] != root) root = parent[root];
+  while (parent[i] != root) { next = parent[i]; parent[i] = root; i = next; }
+  return root;
+}
+
+/* Function:  p7_hmmclusters_Build()
+ * Synopsis:  Cluster a profile library.
+ *
+ * Purpose:   Single-linkage cluster the <nhmm> profiles <hmm[]>: two
+ *            models are linked if their
+ *            <p7_hmmclusters_Similarity()> is at least <thresh>, and
+ *            the clusters are the connected components. The
+ *            representative of each cluster is its medoid, the member
+ *            with the greatest summed similarity to the other
+ *            members (the earliest such, on ties). Return the map in
+ *            <*ret_hc>, with models in the order of <hmm[]> and
+ *            clusters numbered by their first member.
+ *
+ *            Candidate pairs are found through an inverted index of
+ *            consensus words, so only models that share at least one
+ *            word are ever compared.
+ *
+ *            Each model's window length in the map is its
+ *            <max_length>, which should be set.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslEDUP> if two models have the same name.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_hmmclusters_Build(P7_HMM **hmm, int nhmm, float thresh, P7_HMMCLUSTERS **ret_hc)
+{
+  P7_HMMCLUSTERS *hc      = NULL;
+  int           **w       = NULL;   /* w[i][0..nw[i]-1]: consensus words of model i */
+  int            *nw      = NULL;
+  int            *poff    = NULL;   /* inverted index: models with word a are post[poff[a]..poff[a+1]-1] */
+  int            *post    = NULL;
+  int            *fill    = NULL;   /* next free slot in each posting list, while filling                */
+  int            *nshared = NULL;   /* nshared[j]: words model j shares with the current model            */
+  int            *touched = NULL;
+  int            *parent  = NULL;
+  int            *clust   = NULL;   /* clust[root]: cluster number of a union-find root                   */
+  int            *rep     = NULL;
+  float          *simsum  = NULL;
+  int             nwords, ntouched, ncl;
+  int             i, j, k, a, c;
+  int             status;
+
+  *ret_hc = NULL;
+  if (nhmm < 1) return eslEINVAL;
+  nwords = 1;
+  for (k = 0; k < p7_HMMCLUSTER_K; k++) nwords *= hmm[0]->abc->K;
+
+  ESL_ALLOC(w,       sizeof(int *) * nhmm);
+  ESL_ALLOC(nw,      sizeof(int)   * nhmm);
+  for (i = 0; i < nhmm; i++) w[i] = NULL;
+  for (i = 0; i < nhmm; i++)
+    if ((status = consensus_words(hmm[i], &(w[i]), &(nw[i]))) != eslOK) goto ERROR;
+
+  /* inverted index, word -> models, each posting list in model order */
+  ESL_ALLOC(poff, sizeof(int) * (nwords + 1));
+  for (a = 0; a <= nwords; a++) poff[a] = 0;
+  for (i = 0; i < nhmm; i++)
+    for (k = 0; k < nw[i]; k++) poff[w[i][k]+1]++;
+  for (a = 1; a <= nwords; a++) poff[a] += poff[a-1];
+  ESL_ALLOC(post, sizeof(int) * ESL_MAX(1, poff[nwords]));
+  ESL_ALLOC(fill, sizeof(int) * nwords);
+  for (a = 0; a < nwords; a++) fill[a] = poff[a];
+  for (i = 0; i < nhmm; i++)
+    for (k = 0; k < nw[i]; k++) post[fill[w[i][k]]++] = i;
+
+  /* single linkage: for each model, count words shared with every earlier model */
+  ESL_ALLOC(nshared, sizeof(int) * nhmm);
+  ESL_ALLOC(touched, sizeof(int) * nhmm);
+  ESL_ALLOC(parent,  sizeof(int) * nhmm);
+  for (i = 0; i < nhmm; i++) { parent[i] = i; nshared[i] = 0; }
+
+  for (i = 1; i < nhmm; i++)
+    {
+      ntouched = 0;
+      for (k = 0; k < nw[i]; k++)
+        {
+          a = w[i][k];
+          for (j = poff[a]; j < poff[a+1] && post[j] < i; j++)
+            {
+              if (nshared[post[j]] == 0) touched[ntouched++] = post[j];
+              nshared[post[j]]++;
+            }
+        }
+      for (k = 0; k < ntouched; k++)
+        {
+          j = touched[k];
+          if ((float) nshared[j] / (float) ESL_MIN(nw[i], nw[j]) >= thresh)
+            parent[uf_find(parent, i)] = uf_find(parent, j);
+          nshared[j] = 0;
+        }
+    }
+
+  /* number the clusters by their first member */
+  ESL_ALLOC(clust, sizeof(int) * nhmm);
+  for (i = 0; i < nhmm; i++) clust[i] = -1;
+  for (ncl = 0, i = 0; i < nhmm; i++)
+    {
+      j = uf_find(parent, i);
+      if (clust[j] == -1) clust[j] = ncl++;
+    }
+
+  /* medoids */
+  ESL_ALLOC(rep,    sizeof(int)   * ncl);
+  ESL_ALLOC(simsum, sizeof(float) * nhmm);
+  for (c = 0; c < ncl; c++) rep[c] = -1;
+  for (i = 0; i < nhmm; i++) simsum[i] = 0.;
+  for (i = 0; i < nhmm; i++)
+    for (j = i+1; j < nhmm; j++)
+      if (uf_find(parent, i) == uf_find(parent, j) && nw[i] > 0 && nw[j] > 0)
+        {
+          float sim = (float) shared_words(w[i], nw[i], w[j], nw[j]) / (float) ESL_MIN(nw[i], nw[j]);
+          simsum[i] += sim;
+          simsum[j] += sim;
+        }
+  for (i = 0; i < nhmm; i++)
+    {
+      c = clust[uf_find(parent, i)];
+      if (rep[c] == -1 || simsum[i] > simsum[rep[c]]) rep[c] = i;
+    }
+
+  if ((hc = p7_hmmclusters_Create()) == NULL) { status = eslEMEM; goto ERROR; }
+  for (i = 0; i < nhmm; i++)
+    {
+      c = clust[uf_find(parent, i)];
+      if ((status = p7_hmmclusters_Add(hc, hmm[i]->name, hmm[i]->max_length, c, (rep[c] == i))) != eslOK) goto ERROR;
+    }
+
+  for (i = 0; i < nhmm; i++) free(w[i]);
+  free(w);     free(nw);
+  free(poff);  free(post);  free(fill);
+  free(nshared); free(touched);
+  free(parent);  free(clust);
+  free(rep);     free(simsum);
+  *ret_hc = hc;
+  return eslOK;
+
+ ERROR:
+  if (w) { for (i = 0; i < nhmm; i++) if (w[i]) free(w[i]); free(w); }
+  if (nw)      free(nw);
+  if (poff)    free(poff);
+  if (post)    free(post);
+  if (fill)    free(fill);
+  if (nshared) free(nshared);
+  if (touched) free(touched);
+  if (parent)  free(parent);
+  if (clust)   free(clust);
+  if (rep)     free(rep);
+  if (simsum)  free(simsum);
+  if (hc)      p7_hmmclusters_Destroy(hc);
+  return status;
+}
+/*-------------------- end, clustering a library ----------------*/
+
+
+/*****************************************************************
+ * 4. Cluster map input/output
+ *****************************************************************/
+
+/* Function:  p7_hmmclusters_Write()
+ * Synopsis:  Save a cluster map.
+ *
+ * Purpose:   Write map <hc> to stream <fp>, one line per model, in
+ *            library order: name, cluster number, <*> for the
+ *            cluster's representative or <-> for any other member,
+ *            and window length.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEWRITE> on any write error.
+ */
+int
+p7_hmmclusters_Write(FILE *fp, const P7_HMMCLUSTERS *hc)
+{
+  int i;
+
+  if (fprintf(fp, "# %d models in %d clusters\n", hc->nmodel, hc->nclust) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "cluster map write failed");
+  if (fprintf(fp, "# %-30s %8s %3s %6s\n", "model", "cluster", "rep", "W")  < 0) ESL_EXCEPTION_SYS(eslEWRITE, "cluster map write failed");
+  for (i = 0; i < hc->nmodel; i++)
+    if (fprintf(fp, "%-32s %8d %3s %6d\n", hc->name[i], hc->assign[i], (hc->rep[hc->assign[i]] == i ? "*" : "-"), hc->W[i]) < 0)
+      ESL_EXCEPTION_SYS(eslEWRITE, "cluster map write failed");
+  return eslOK;
+}
+
+/* Function:  p7_hmmclusters_Read()
+ * Synopsis:  Read a cluster map.
+ *
+ * Purpose:   Read a cluster map written by <p7_hmmclusters_Write()>
+ *            from file <mapfile>, and return it in <*ret_hc>. Lines
+ *            starting with # are comments.
+ *
+ * Returns:   <eslOK> on success.
+ *            <eslENOTFOUND> if <mapfile> can't be opened.
+ *            <eslEFORMAT> on a parse error, a model listed twice, or a
+ *            cluster without exactly one representative; <errbuf>
+ *            says why.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_hmmclusters_Read(const char *mapfile, P7_HMMCLUSTERS **ret_hc, char *errbuf)
+{
+  ESL_FILEPARSER *efp = NULL;
+  P7_HMMCLUSTERS *hc  = NULL;
+  char           *name;
+  char           *tok;
+  int             namelen, toklen;
+  int             c, W, is_rep;
+  int             status;
+
+  if (errbuf) errbuf[0] = '\0';
+
+  status = esl_fileparser_Open(mapfile, NULL, &efp);
+  if      (status == eslENOTFOUND) ESL_XFAIL(eslENOTFOUND, errbuf, "couldn't open cluster map %s for reading", mapfile);
+  else if (status != eslOK)        goto ERROR;
+  esl_fileparser_SetCommentChar(efp, '#');
+
+  if ((hc = p7_hmmclusters_Create()) == NULL) { status = eslEMEM; goto ERROR; }
+
+  while ((status = esl_fileparser_NextLine(efp)) == eslOK)
+    {
+      if ((status = esl_fileparser_GetTokenOnLine(efp, &name, &namelen)) != eslOK) goto ERROR;
+
+      if (esl_fileparser_GetTokenOnLine(efp, &tok, &toklen) != eslOK || ! esl_str_IsInteger(tok))
+        ESL_XFAIL(eslEFORMAT, errbuf, "expected a cluster number [line %d of cluster map %s]", efp->linenumber, mapfile);
+      c = atoi(tok);
+
+      if (esl_fileparser_GetTokenOnLine(efp, &tok, &toklen) != eslOK || (strcmp(tok, "*") != 0 && strcmp(tok, "-") != 0))
+        ESL_XFAIL(eslEFORMAT, errbuf, "expected * or - [line %d of cluster map %s]", efp->linenumber, mapfile);
+      is_rep = (tok[0] == '*');
+
+      if (esl_fileparser_GetTokenOnLine(efp, &tok, &toklen) != eslOK || ! esl_str_IsInteger(tok))
+        ESL_XFAIL(eslEFORMAT, errbuf, "expected a window length [line %d of cluster map %s]", efp->linenumber, mapfile);
+      W = atoi(tok);
+
+      status = p7_hmmclusters_Add(hc, name, W, c, is_rep);
+      if      (status == eslEDUP)   ESL_XFAIL(eslEFORMAT, errbuf, "model %s is listed twice [line %d of cluster map %s]", name, efp->linenumber, mapfile);
+      else if (status == eslEINVAL) ESL_XFAIL(eslEFORMAT, errbuf, "bad cluster number, or second representative [line %d of cluster map %s]", efp->linenumber, mapfile);
+      else if (status != eslOK)     goto ERROR;
+    }
+  if (status != eslEOF) goto ERROR;
+
+  for (c = 0; c < hc->nclust; c++)
+    if (hc->size[c] > 0 && hc->rep[c] < 0)
+      ESL_XFAIL(eslEFORMAT, errbuf, "cluster %d has no representative in cluster map %s", c, mapfile);
+
+  esl_fileparser_Close(efp);
+  *ret_hc = hc;
+  return eslOK;
+
+ ERROR:
+  if (efp) esl_fileparser_Close(efp);
+  if (hc)  p7_hmmclusters_Destroy(hc);
+  *ret_hc = NULL;
+  return status;
+}
+/*------------------ end, cluster map input/output --------------*/
+
+
+/*****************************************************************
+ * 5. Unit tests
+ *****************************************************************/
+#ifdef p7HMMCLUSTER_TESTDRIVE
+#include "esl_random.h"
+
+/* Two copies of one random model and an unrelated random model: the
+ * copies cluster together, with the first as representative (a tie,
+ * broken toward the earlier model); the third model is alone.
+ */
+static void
+utest_build(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, int M)
+{
+  char           *msg = "p7_hmmcluster build unit test failed";
+  P7_HMM         *hmm[3];
+  P7_HMMCLUSTERS *hc  = NULL;
+  int             c0, c1, c2;
+
+  if (p7_hmm_Sample(r, M, abc, &hmm[0]) != eslOK) esl_fatal(msg);
+  if ((hmm[1] = p7_hmm_Clone(hmm[0]))   == NULL)  esl_fatal(msg);
+  if (p7_hmm_Sample(r, M, abc, &hmm[2]) != eslOK) esl_fatal(msg);
+  p7_hmm_SetName(hmm[0], "first");
+  p7_hmm_SetName(hmm[1], "copy");
+  p7_hmm_SetName(hmm[2], "other");
+  hmm[0]->max_length = hmm[1]->max_length = 2*M;
+  hmm[2]->max_length = 3*M;
+
+  if (p7_hmmclusters_Similarity(hmm[0], hmm[1]) != 1.0)   esl_fatal(msg);
+  if (p7_hmmclusters_Similarity(hmm[0], hmm[2]) >= 0.5)   esl_fatal(msg);
+
+  if (p7_hmmclusters_Build(hmm, 3, p7_HMMCLUSTER_THRESH, &hc) != eslOK) esl_fatal(msg);
+  if (hc->nmodel != 3 || hc->nclust != 2)                                  esl_fatal(msg);
+  if (p7_hmmclusters_Lookup(hc, "first", &c0) != eslOK)                   esl_fatal(msg);
+  if (p7_hmmclusters_Lookup(hc, "copy",  &c1) != eslOK)                   esl_fatal(msg);
+  if (p7_hmmclusters_Lookup(hc, "other", &c2) != eslOK)                   esl_fatal(msg);
+  if (c0 != 0 || c1 != 0 || c2 != 1)                                      esl_fatal(msg);
+  if (hc->rep[0] != 0 || hc->rep[1] != 2)                                  esl_fatal(msg);
+  if (hc->size[0] != 2 || hc->size[1] != 1)                                esl_fatal(msg);
+  if (hc->maxW[0] != 2*M || hc->maxW[1] != 3*M)                            esl_fatal(msg);
+  if (p7_hmmclusters_Lookup(hc, "nonesuch", &c0) != eslENOTFOUND || c0 != -1) esl_fatal(msg);
+
+  p7_hmmclusters_Destroy(hc);
+  p7_hmm_Destroy(hmm[0]);
+  p7_hmm_Destroy(hmm[1]);
+  p7_hmm_Destroy(hmm[2]);
+}
+
+/* A map written by p7_hmmclusters_Write() reads back the same, and
+ * maps with a cluster that has no representative, or two, are
+ * rejected.
+ */
+static void
+utest_readwrite(void)
+{
+  char           *msg       = "p7_hmmcluster read/write unit test failed";
+  char            tmpfile[] = "esltmpXXXXXX";
+  P7_HMMCLUSTERS *hc        = p7_hmmclusters_Create();
+  P7_HMMCLUSTERS *hc2       = NULL;
+  FILE           *fp        = NULL;
+  char            errbuf[eslERRBUFSIZE];
+  int             i;
+
+  if (p7_hmmclusters_Add(hc, "a", 100, 0, FALSE) != eslOK)   esl_fatal(msg);
+  if (p7_hmmclusters_Add(hc, "b", 120, 1, TRUE)  != eslOK)   esl_fatal(msg);
+  if (p7_hmmclusters_Add(hc, "c", 150, 0, TRUE)  != eslOK)   esl_fatal(msg);
+  if (p7_hmmclusters_Add(hc, "c", 150, 0, FALSE) != eslEDUP) esl_fatal(msg);
+  if (p7_hmmclusters_Add(hc, "d", 150, 0, TRUE)  != eslEINVAL) esl_fatal(msg);
+
+  if (esl_tmpfile_named(tmpfile, &fp)   != eslOK) esl_fatal(msg);
+  if (p7_hmmclusters_Write(fp, hc)      != eslOK) esl_fatal(msg);
+  fclose(fp);
+  if (p7_hmmclusters_Read(tmpfile, &hc2, errbuf) != eslOK) esl_fatal(msg);
+  if (hc2->nmodel != hc->nmodel || hc2->nclust != hc->nclust) esl_fatal(msg);
+  for (i = 0; i < hc->nmodel; i++)
+    if (strcmp(hc2->name[i], hc->name[i]) != 0 || hc2->assign[i] != hc->assign[i] || hc2->W[i] != hc->W[i]) esl_fatal(msg);
+  if (hc2->rep[0] != 2 || hc2->rep[1] != 1 || hc2->maxW[0] != 150) esl_fatal(msg);
+  p7_hmmclusters_Destroy(hc2);
+  remove(tmpfile);
+
+  strcpy(tmpfile, "esltmpXXXXXX");
+  if (esl_tmpfile_named(tmpfile, &fp)   != eslOK) esl_fatal(msg);
+  fprintf(fp, "a 0 - 100\nb 0 - 100\n");
+  fclose(fp);
+  if (p7_hmmclusters_Read(tmpfile, &hc2, errbuf) != eslEFORMAT) esl_fatal(msg);
+  remove(tmpfile);
+
+  strcpy(tmpfile, "esltmpXXXXXX");
+  if (esl_tmpfile_named(tmpfile, &fp)   != eslOK) esl_fatal(msg);
+  fprintf(fp, "a 0 * 100\nb 0 * 100\n");
+  fclose(fp);
+  if (p7_hmmclusters_Read(tmpfile, &hc2, errbuf) != eslEFORMAT) esl_fatal(msg);
+  remove(tmpfile);
+
+  p7_hmmclusters_Destroy(hc);
+}
+#endif /*p7HMMCLUSTER_TESTDRIVE*/
+/*---------------------- end, unit tests -----------------------*/
+
+
+/*****************************************************************
+ * 6. Test driver
+ *****************************************************************/
+#ifdef p7HMMCLUSTER_TESTDRIVE
+/*
+  gcc -o p7_hmmcluster_utest -g -Wall -I. -L. -I../easel -L../easel -Dp7HMMCLUSTER_TESTDRIVE p7_hmmcluster.c -lhmmer -leasel -lm
+  ./p7_hmmcluster_utest
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name  type         default  env   range togs  reqs  incomp  help                   docgrp */
+  { "-h",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show help and usage",           0 },
+  { "-s",  eslARG_INT,     "42",  NULL, NULL, NULL, NULL, NULL, "set random number seed to <n>", 0 },
+  { "-M",  eslARG_INT,    "100",  NULL, NULL, NULL, NULL, NULL, "length of the test models",     0 },
+  { 0,0,0,0,0,0,0,0,0,0},
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for p7_hmmcluster.c";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go  = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r   = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc = esl_alphabet_Create(eslAMINO);
+
+  utest_build(r, abc, esl_opt_GetInteger(go, "-M"));
+  utest_readwrite();
+
+  esl_alphabet_Destroy(abc);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7HMMCLUSTER_TESTDRIVE*/
+/*---------------------- end, test driver ----------------------*/
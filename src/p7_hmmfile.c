@@ -13,10 +13,18 @@
  */
 #include "p7_config.h"
 
+#include <ctype.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 #ifdef HMMER_THREADS
 #include <pthread.h>
 #endif
@@ -25,6 +33,9 @@
 #include "esl_alphabet.h"
 #include "esl_ssi.h"     /* this gives us esl_byteswap */
 #include "esl_vectorops.h"   /* gives us esl_vec_FCopy()   */
+#ifdef HMMER_THREADS
+#include "esl_threads.h"
+#endif
 
 #include "hmmer.h"
 
@@ -56,6 +67,12 @@ static int read_asc30hmm(P7_HMMFILE *hfp, ESL_ALPHABET **ret_abc, P7_HMM **opt_h
 static int read_bin30hmm(P7_HMMFILE *hfp, ESL_ALPHABET **ret_abc, P7_HMM **opt_hmm);
 static int read_asc20hmm(P7_HMMFILE *hfp, ESL_ALPHABET **ret_abc, P7_HMM **opt_hmm);
 
+#ifdef HMMER_THREADS
+static int  bulk_Create (P7_HMMFILE *hfp, int ncpu, P7_HMMBULK **ret_bk);
+static int  bulk_Read   (P7_HMMFILE *hfp, ESL_ALPHABET **ret_abc, P7_HMM **opt_hmm);
+static void bulk_Destroy(P7_HMMBULK *bk);
+#endif
+
 static int   write_bin_string(FILE *fp, char *s);
 static int   read_bin_string (FILE *fp, char **ret_s);
 static float h2ascii2prob(char *s, float null);
@@ -225,6 +242,7 @@ p7_hmmfile_OpenBuffer(const char *buffer, int size, P7_HMMFILE **ret_hfp)
   hfp->is_pressed   = FALSE;
 #ifdef HMMER_THREADS
   hfp->syncRead     = FALSE;
+  hfp->bulk         = NULL;
 #endif
   hfp->parser       = NULL;
   hfp->efp          = NULL;
@@ -296,6 +314,7 @@ open_engine(const char *filename, char *env, P7_HMMFILE **ret_hfp, int do_ascii_
   hfp->is_pressed   = FALSE;
 #ifdef HMMER_THREADS
   hfp->syncRead     = FALSE;
+  hfp->bulk         = NULL;
 #endif
   hfp->parser       = NULL;
   hfp->efp          = NULL;
@@ -494,6 +513,7 @@ p7_hmmfile_Close(P7_HMMFILE *hfp)
   if (hfp->efp   != NULL) esl_fileparser_Destroy(hfp->efp);
   if (hfp->ssi   != NULL) esl_ssi_Close(hfp->ssi);
 #ifdef HMMER_THREADS
+  if (hfp->bulk  != NULL) bulk_Destroy(hfp->bulk);
   if (hfp->syncRead)      pthread_mutex_destroy (&hfp->readMutex);
 #endif
   free(hfp);
@@ -1216,6 +1236,9 @@ int
 p7_hmmfile_Read(P7_HMMFILE *hfp, ESL_ALPHABET **ret_abc,  P7_HMM **opt_hmm)
 {
   /* A call to SSI to remember file position may eventually go here.  */
+#ifdef HMMER_THREADS
+  if (hfp->bulk != NULL) return bulk_Read(hfp, ret_abc, opt_hmm);
+#endif
   return (*hfp->parser)(hfp, ret_abc, opt_hmm);
 }
 
@@ -1253,6 +1276,9 @@ p7_hmmfile_PositionByKey(P7_HMMFILE *hfp, const char *key)
   if (hfp->ssi == NULL) ESL_EXCEPTION(eslEINVAL, "Need an open SSI index to call p7_hmmfile_PositionByKey()");
   if ((status = esl_ssi_FindName(hfp->ssi, key, &fh, &offset, NULL, NULL)) != eslOK) return status;
   if (fseeko(hfp->f, offset, SEEK_SET) != 0)    ESL_EXCEPTION(eslESYS, "fseek failed");
+#ifdef HMMER_THREADS
+  if (hfp->bulk != NULL) { bulk_Destroy(hfp->bulk); hfp->bulk = NULL; } /* back to reading from <f> */
+#endif
 
   hfp->newly_opened = FALSE;  /* because we're poised on the magic number, and must read it */
   return eslOK;
@@ -1276,10 +1302,57 @@ int
 p7_hmmfile_Position(P7_HMMFILE *hfp, const off_t offset)
 {
   if (fseeko(hfp->f, offset, SEEK_SET) != 0)    ESL_EXCEPTION(eslESYS, "fseek failed");
+#ifdef HMMER_THREADS
+  if (hfp->bulk != NULL) { bulk_Destroy(hfp->bulk); hfp->bulk = NULL; } /* back to reading from <f> */
+#endif
 
   hfp->newly_opened = FALSE;  /* because we're poised on the magic number, and must read it */
   return eslOK;
 }
+
+
+/* Function:  p7_hmmfile_SetParallel()
+ * Synopsis:  Parse an ASCII HMM file on several threads.
+ *
+ * Purpose:   Have <p7_hmmfile_Read()> parse the models of <hfp> in
+ *            batches on <ncpu> threads (or as many as there are
+ *            CPUs, if <ncpu> is 0), instead of one line at a time on
+ *            the caller's. The whole file is mapped into memory (or
+ *            read, where <mmap()> isn't available) and split into
+ *            records at its <//> lines; each record is parsed by the
+ *            same code as before, and models are still returned one
+ *            at a time, in file order, with the same offsets and
+ *            error reports.
+ *
+ *            This only pays for programs that read most of a large
+ *            file. It has to be called before the first
+ *            <p7_hmmfile_Read()>. Repositioning <hfp> with
+ *            <p7_hmmfile_Position()> or <p7_hmmfile_PositionByKey()>
+ *            goes back to serial reading.
+ *
+ *            If <hfp> isn't an ASCII HMMER3/BATH file on disk, if
+ *            it's already been read from, if only one thread is
+ *            available, or if HMMER was built without thread
+ *            support, nothing changes: models are read serially.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure; <eslESYS> if the file
+ *            can't be mapped or read.
+ */
+int
+p7_hmmfile_SetParallel(P7_HMMFILE *hfp, int ncpu)
+{
+#ifdef HMMER_THREADS
+  if (ncpu <= 0) ncpu = esl_threads_GetCPUCount();
+  if (ncpu < 2 || hfp->bulk != NULL)                           return eslOK;
+  if (hfp->parser != read_asc30hmm || ! hfp->newly_opened)     return eslOK;
+  if (hfp->do_stdin || hfp->do_gzip || hfp->f == NULL)         return eslOK;
+  return bulk_Create(hfp, ncpu, &(hfp->bulk));
+#else
+  return eslOK;
+#endif /*HMMER_THREADS*/
+}
 /*------------------- end, input API ----------------------------*/
 
 
@@ -2294,6 +2367,317 @@ h2ascii2prob(char *s, float null)
 {
   return ((*s == '*') ? 0. : null * exp( atoi(s) * 0.00069314718));
 }
+
+
+
+#ifdef HMMER_THREADS
+/* The parallel ASCII reader behind p7_hmmfile_SetParallel().
+ *
+ * The file is mapped (or slurped) whole and cut into records at its
+ * "//" lines. Records are parsed a batch at a time: each one through
+ * its own p7_hmmfile_OpenBuffer() handle, by the same read_asc30hmm()
+ * that reads them serially, then handed back in file order by
+ * bulk_Read(). Each record gets its own alphabet, so workers share
+ * nothing but the (read-only) buffer; bulk_Read() reconciles that
+ * alphabet with the caller's exactly the way read_asc30hmm() would.
+ */
+struct p7_hmmbulk_s {
+  char          *buf;        /* whole file, mapped or read                   */
+  off_t          n;          /* size of <buf>                                */
+  int            is_mapped;  /* TRUE: munmap() <buf>; FALSE: free() it        */
+
+  off_t         *roff;       /* record r is buf[roff[r]..roff[r+1]-1]; 0..nrec */
+  int64_t       *rline;      /* line number of record r's first line; 0..nrec-1 */
+  int            nrec;       /* number of records                            */
+  int            rnext;      /* next record not yet in a batch               */
+
+  int            format;     /* format code of the file, p7_HMMFILE_3a..p7_BATH_3f */
+  int            ncpu;       /* number of worker threads                     */
+  int            balloc;     /* batch size                                   */
+  int            nb;         /* number of records in the current batch       */
+  int            b;          /* next batch slot to return                    */
+  P7_HMM       **hmm;        /* parsed models [0..nb-1]; NULL once returned   */
+  ESL_ALPHABET **abc;        /* their alphabets                               */
+  int           *status;     /* parse status for each slot                    */
+  int64_t       *linenumber; /* line of a parse error, in the whole file     */
+  char          *errbuf;     /* error messages, eslERRBUFSIZE per slot        */
+
+  pthread_mutex_t mutex;     /* guards <bnext>                               */
+  int            bnext;      /* next batch slot to parse                     */
+};
+
+static void bulk_thread(void *arg);
+
+/* bulk_Create()
+ * Map <hfp->fname> and index its records, for <ncpu> workers.
+ */
+static int
+bulk_Create(P7_HMMFILE *hfp, int ncpu, P7_HMMBULK **ret_bk)
+{
+  P7_HMMBULK *bk     = NULL;
+  FILE       *fp     = NULL;
+  int         ralloc = 256;
+  int64_t     line   = 1;
+  int64_t     startline = 1;
+  off_t       pos, eol, start;
+  char       *s;
+  struct stat st;
+  int         status;
+
+  ESL_ALLOC(bk, sizeof(P7_HMMBULK));
+  bk->buf        = NULL;
+  bk->n          = 0;
+  bk->is_mapped  = FALSE;
+  bk->roff       = NULL;
+  bk->rline      = NULL;
+  bk->nrec       = 0;
+  bk->rnext      = 0;
+  bk->format     = hfp->format;
+  bk->ncpu       = ncpu;
+  bk->balloc     = ncpu * 16;
+  bk->nb         = 0;
+  bk->b          = 0;
+  bk->hmm        = NULL;
+  bk->abc        = NULL;
+  bk->status     = NULL;
+  bk->linenumber = NULL;
+  bk->errbuf     = NULL;
+  bk->bnext      = 0;
+  if (pthread_mutex_init(&bk->mutex, NULL) != 0) { free(bk); ESL_EXCEPTION(eslESYS, "mutex init failed"); }
+
+  if ((fp = fopen(hfp->fname, "r"))   == NULL) ESL_XEXCEPTION(eslESYS, "failed to reopen HMM file %s", hfp->fname);
+  if (fstat(fileno(fp), &st)          != 0)    ESL_XEXCEPTION(eslESYS, "fstat() failed on HMM file %s", hfp->fname);
+  bk->n = st.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+  if (bk->n > 0 && (bk->buf = mmap(NULL, bk->n, PROT_READ, MAP_PRIVATE, fileno(fp), 0)) != MAP_FAILED) bk->is_mapped = TRUE;
+  else bk->buf = NULL;
+#endif
+  if (bk->buf == NULL)
+    {
+      ESL_ALLOC(bk->buf, sizeof(char) * (bk->n + 1));
+      if (bk->n > 0 && fread(bk->buf, sizeof(char), bk->n, fp) != (size_t) bk->n) ESL_XEXCEPTION(eslESYS, "failed to read HMM file %s", hfp->fname);
+    }
+  fclose(fp); fp = NULL;
+
+  /* Cut at "//" lines. A record also ends at EOF, unless all that's left is whitespace. */
+  ESL_ALLOC(bk->roff,  sizeof(off_t)   * (ralloc+1));
+  ESL_ALLOC(bk->rline, sizeof(int64_t) * (ralloc+1));
+  start = 0;
+  for (pos = 0; pos < bk->n; pos = eol, line++)
+    {
+      for (eol = pos; eol < bk->n && bk->buf[eol] != '\n'; eol++) ;
+      if (eol < bk->n) eol++;
+
+      for (s = bk->buf + pos; s < bk->buf + eol && isspace(*s); s++) ;
+      if (s + 2 <= bk->buf + eol && s[0] == '/' && s[1] == '/' && (s + 2 == bk->buf + eol || isspace(s[2])))
+	{
+	  if (bk->nrec == ralloc) {
+	    ralloc *= 2;
+	    ESL_REALLOC(bk->roff,  sizeof(off_t)   * (ralloc+1));
+	    ESL_REALLOC(bk->rline, sizeof(int64_t) * (ralloc+1));
+	  }
+	  bk->rline[bk->nrec]  = startline;
+	  bk->roff[bk->nrec++] = start;
+	  start     = eol;
+	  startline = line+1;
+	}
+    }
+  for (s = bk->buf + start; s < bk->buf + bk->n && isspace(*s); s++) ;
+  if (s < bk->buf + bk->n)  /* unterminated last record: parse it anyway, for read_asc30hmm()'s error message */
+    {
+      bk->rline[bk->nrec]  = startline; /* roff, rline have room for nrec+1 */
+      bk->roff[bk->nrec++] = start;
+      start = bk->n;
+    }
+  bk->roff[bk->nrec] = start;
+
+  ESL_ALLOC(bk->hmm,        sizeof(P7_HMM *)       * bk->balloc);
+  ESL_ALLOC(bk->abc,        sizeof(ESL_ALPHABET *) * bk->balloc);
+  ESL_ALLOC(bk->status,     sizeof(int)            * bk->balloc);
+  ESL_ALLOC(bk->linenumber, sizeof(int64_t)        * bk->balloc);
+  ESL_ALLOC(bk->errbuf,     sizeof(char)           * bk->balloc * eslERRBUFSIZE);
+
+  *ret_bk = bk;
+  return eslOK;
+
+ ERROR:
+  if (fp) fclose(fp);
+  bulk_Destroy(bk);
+  *ret_bk = NULL;
+  return status;
+}
+
+/* bulk_parse()
+ * Parse record <r> into batch slot <i>.
+ */
+static void
+bulk_parse(P7_HMMBULK *bk, int r, int i)
+{
+  P7_HMMFILE *rhfp   = NULL;
+  char       *errbuf = bk->errbuf + (size_t) i * eslERRBUFSIZE;
+  off_t       len    = bk->roff[r+1] - bk->roff[r];
+  int         status;
+
+  bk->hmm[i]        = NULL;
+  bk->abc[i]        = NULL;
+  bk->linenumber[i] = bk->rline[r];
+  errbuf[0]         = '\0';
+
+  if (len > INT_MAX) { status = eslEFORMAT; sprintf(errbuf, "HMM record too large"); goto DONE; }
+
+  status = p7_hmmfile_OpenBuffer(bk->buf + bk->roff[r], (int) len, &rhfp);
+  if      (status == eslEMEM)                           { sprintf(errbuf, "allocation failure, HMM record parser"); goto DONE; }
+  else if (status != eslOK || rhfp->format != bk->format)
+    {
+      status = eslEFORMAT;
+      if (bk->format == p7_BATH_3f) sprintf(errbuf, "Didn't find BATH3/f tag: bad format or not a BATH save file?");
+      else                          sprintf(errbuf, "Didn't find HMMER3/%c tag: bad format or not a HMMER save file?", 'a' + bk->format - p7_HMMFILE_3a);
+      goto DONE;
+    }
+
+  if ((status = p7_hmmfile_Read(rhfp, &(bk->abc[i]), &(bk->hmm[i]))) == eslOK)
+    bk->hmm[i]->offset = bk->roff[r];
+  else
+    {
+      strcpy(errbuf, rhfp->errbuf);
+      bk->linenumber[i] = bk->rline[r] + rhfp->efp->linenumber - 1;
+      if (bk->abc[i] != NULL) { esl_alphabet_Destroy(bk->abc[i]); bk->abc[i] = NULL; }
+    }
+
+ DONE:
+  if (rhfp) p7_hmmfile_Close(rhfp);
+  bk->status[i] = status;
+}
+
+/* bulk_thread()
+ * Worker: parse batch slots until the batch is done.
+ */
+static void
+bulk_thread(void *arg)
+{
+  ESL_THREADS *obj = (ESL_THREADS *) arg;
+  P7_HMMBULK  *bk;
+  int          workeridx;
+  int          i;
+
+  esl_threads_Started(obj, &workeridx);
+  bk = (P7_HMMBULK *) esl_threads_GetData(obj, workeridx);
+
+  while (1)
+    {
+      pthread_mutex_lock(&bk->mutex);
+      i = bk->bnext++;
+      pthread_mutex_unlock(&bk->mutex);
+      if (i >= bk->nb) break;
+      bulk_parse(bk, bk->rnext + i, i);
+    }
+  esl_threads_Finished(obj, workeridx);
+  return;
+}
+
+/* bulk_Read()
+ * p7_hmmfile_Read() for a <hfp> with a bulk reader: return the next
+ * model of the current batch, parsing the next batch when this one
+ * is used up. Same contract as read_asc30hmm().
+ */
+static int
+bulk_Read(P7_HMMFILE *hfp, ESL_ALPHABET **ret_abc, P7_HMM **opt_hmm)
+{
+  P7_HMMBULK   *bk  = hfp->bulk;
+  ESL_THREADS  *obj = NULL;
+  P7_HMM       *hmm = NULL;
+  ESL_ALPHABET *abc = NULL;
+  int           n;
+  int           status;
+
+  hfp->errbuf[0]    = '\0';
+  hfp->newly_opened = FALSE;
+
+  if (bk->b == bk->nb)
+    {
+      if (bk->rnext == bk->nrec) { status = eslEOF; goto ERROR; }
+
+      bk->nb    = ESL_MIN(bk->balloc, bk->nrec - bk->rnext);
+      bk->b     = 0;
+      bk->bnext = 0;
+      if (bk->nb == 1) bulk_parse(bk, bk->rnext, 0);
+      else
+	{
+	  if ((obj = esl_threads_Create(&bulk_thread)) == NULL) ESL_XEXCEPTION(eslESYS, "failed to create HMM parser threads");
+	  for (n = 0; n < ESL_MIN(bk->ncpu, bk->nb); n++) esl_threads_AddThread(obj, bk);
+	  esl_threads_WaitForStart(obj);
+	  esl_threads_WaitForFinish(obj);
+	  esl_threads_Destroy(obj);
+	}
+      bk->rnext += bk->nb;
+    }
+
+  /* Hand over slot <b>, reconciling its alphabet with the caller's */
+  hmm    = bk->hmm[bk->b];
+  abc    = bk->abc[bk->b];
+  status = bk->status[bk->b];
+  bk->hmm[bk->b] = NULL;
+  bk->abc[bk->b] = NULL;
+  if (status != eslOK)
+    {
+      strcpy(hfp->errbuf, bk->errbuf + (size_t) bk->b * eslERRBUFSIZE);
+      if (hfp->efp) hfp->efp->linenumber = bk->linenumber[bk->b];
+      bk->b++;
+      goto ERROR;
+    }
+  bk->b++;
+
+  if (*ret_abc == NULL)
+    *ret_abc = abc;
+  else if ((*ret_abc)->type != abc->type)
+    ESL_XFAIL(eslEINCOMPAT, hfp->errbuf, "Alphabet type mismatch: was %s, but current HMM says %s", esl_abc_DecodeType( (*ret_abc)->type), esl_abc_DecodeType(abc->type));
+  else
+    {
+      hmm->abc = *ret_abc;
+      esl_alphabet_Destroy(abc);
+    }
+
+  if (opt_hmm != NULL) *opt_hmm = hmm; else p7_hmm_Destroy(hmm);
+  return eslOK;
+
+ ERROR:
+  if (hmm)     p7_hmm_Destroy(hmm);
+  if (abc)     esl_alphabet_Destroy(abc);
+  if (opt_hmm) *opt_hmm = NULL;
+  return status;
+}
+
+/* bulk_Destroy()
+ */
+static void
+bulk_Destroy(P7_HMMBULK *bk)
+{
+  int i;
+
+  if (bk)
+    {
+      for (i = bk->b; bk->hmm && i < bk->nb; i++)
+	{
+	  if (bk->hmm[i]) p7_hmm_Destroy(bk->hmm[i]);
+	  if (bk->abc[i]) esl_alphabet_Destroy(bk->abc[i]);
+	}
+#ifdef HAVE_SYS_MMAN_H
+      if (bk->is_mapped) munmap(bk->buf, bk->n);
+#endif
+      if (! bk->is_mapped && bk->buf) free(bk->buf);
+      if (bk->roff)       free(bk->roff);
+      if (bk->rline)      free(bk->rline);
+      if (bk->hmm)        free(bk->hmm);
+      if (bk->abc)        free(bk->abc);
+      if (bk->status)     free(bk->status);
+      if (bk->linenumber) free(bk->linenumber);
+      if (bk->errbuf)     free(bk->errbuf);
+      pthread_mutex_destroy(&bk->mutex);
+      free(bk);
+    }
+}
+#endif /*HMMER_THREADS*/
 /*---------------- end, private utilities -----------------------*/
 
 
@@ -2498,6 +2882,72 @@ utest_io_3a(char *tmpfile, P7_HMM *hmm)
   return eslOK;
 }
 
+#ifdef HMMER_THREADS
+/* utest_parallel: a multi-model ASCII file read with
+ *                 p7_hmmfile_SetParallel() gives the same models,
+ *                 in the same order, at the same offsets, as
+ *                 reading it serially.
+ */
+static int
+utest_parallel(ESL_RANDOMNESS *r, char *tmpfile, ESL_ALPHABET *abc)
+{
+  FILE         *fp     = NULL;
+  P7_HMMFILE   *hfp    = NULL;
+  P7_HMM      **hmm    = NULL;
+  P7_HMM       *new    = NULL;
+  ESL_ALPHABET *newabc = NULL;
+  int           nhmm   = 50;
+  int           i;
+  char          msg[]  = "parallel hmmfile read unit test failed";
+
+  if ((hmm = malloc(sizeof(P7_HMM *) * nhmm)) == NULL) esl_fatal(msg);
+  if ((fp = fopen(tmpfile, "w"))              == NULL) esl_fatal(msg);
+  for (i = 0; i < nhmm; i++)
+    {
+      if (p7_hmm_Sample(r, 1 + esl_rnd_Roll(r, 40), abc, &(hmm[i]))   != eslOK) esl_fatal(msg);
+      if (p7_hmmfile_WriteASCII(fp, p7_HMMFILE_3f, hmm[i])             != eslOK) esl_fatal(msg);
+    }
+  fclose(fp);
+
+  /* serial read, for the offsets */
+  if (p7_hmmfile_OpenE(tmpfile, NULL, &hfp, NULL) != eslOK) esl_fatal(msg);
+  for (i = 0; i < nhmm; i++)
+    {
+      if (p7_hmmfile_Read(hfp, &newabc, &new)     != eslOK) esl_fatal(msg);
+      hmm[i]->offset = new->offset;
+      p7_hmm_Destroy(new);
+    }
+  p7_hmmfile_Close(hfp);
+
+  if (p7_hmmfile_OpenE(tmpfile, NULL, &hfp, NULL) != eslOK)  esl_fatal(msg);
+  if (p7_hmmfile_SetParallel(hfp, 4)              != eslOK)  esl_fatal(msg);
+  if (hfp->bulk == NULL)                                     esl_fatal(msg);
+  for (i = 0; i < nhmm; i++)
+    {
+      if (p7_hmmfile_Read(hfp, &newabc, &new)     != eslOK)  esl_fatal(msg);
+      if (new->abc != newabc)                                esl_fatal(msg);
+      if (new->offset != hmm[i]->offset)                     esl_fatal(msg);
+      if (p7_hmm_Compare(hmm[i], new, 0.0001)     != eslOK)  esl_fatal(msg);
+      p7_hmm_Destroy(new);
+    }
+  if (p7_hmmfile_Read(hfp, &newabc, &new)         != eslEOF) esl_fatal(msg);
+  if (new != NULL)                                           esl_fatal(msg);
+
+  /* repositioning goes back to serial reading */
+  if (p7_hmmfile_Position(hfp, hmm[nhmm/2]->offset) != eslOK) esl_fatal(msg);
+  if (hfp->bulk != NULL)                                      esl_fatal(msg);
+  if (p7_hmmfile_Read(hfp, &newabc, &new)         != eslOK)   esl_fatal(msg);
+  if (p7_hmm_Compare(hmm[nhmm/2], new, 0.0001)    != eslOK)   esl_fatal(msg);
+  p7_hmm_Destroy(new);
+  p7_hmmfile_Close(hfp);
+
+  for (i = 0; i < nhmm; i++) p7_hmm_Destroy(hmm[i]);
+  free(hmm);
+  esl_alphabet_Destroy(newabc);
+  return eslOK;
+}
+#endif /*HMMER_THREADS*/
+
 #endif /*p7HMMFILE_TESTDRIVE*/
 /*-------------------- end, unit tests --------------------------*/
 
@@ -2548,6 +2998,10 @@ main(int argc, char **argv)
   utest_io_3a     (tmpfile, hmm);
   p7_hmm_Destroy(hmm);
 
+#ifdef HMMER_THREADS
+  utest_parallel(r, tmpfile, aa_abc);
+#endif
+
   esl_alphabet_Destroy(aa_abc);
   esl_alphabet_Destroy(nt_abc);
   esl_randomness_Destroy(r);
@@ -0,0 +1,375 @@
+/* Length distributions of sequences emitted by a profile HMM.
+ *
+ * Two quantities BATH needs about how long a model's hits can be:
+ * MAXL, the length that all but a tiny fraction of emitted
+ * sequences fall under (stored in the model file; sets the size of
+ * every window the long-target pipeline extracts), and the per-node
+ * prefix/suffix fractions of MAXL that decide how far a window
+ * reaches before and after a seed diagonal.
+ *
+ * Contents:
+ *   1. Length distribution API.
+ *   2. Unit tests.
+ *   3. Test driver.
+ */
+#include "p7_config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#if defined eslENABLE_SSE
+#include <emmintrin.h>		/* SSE2 */
+#endif
+
+#include "easel.h"
+#include "esl_vectorops.h"
+
+#include "hmmer.h"
+
+
+/*****************************************************************
+ * 1. Length distribution API.
+ *****************************************************************/
+
+/* Function:  p7_lengthdist_MaxLength()
+ * Synopsis:  Compute MAXL for a model.
+ *
+ * Purpose:   Find the smallest length <L> such that the probability
+ *            mass of sequences emitted by the core model <hmm> that
+ *            are longer than <L> is below <emit_thresh>, capped at
+ *            20*M (and at most 100000). Return it in <*ret_maxl>.
+ *
+ *            This is the DP described at <p7_Builder_MaxLength()>,
+ *            laid out for speed: transitions are copied once into
+ *            contiguous per-type arrays indexed by the node they
+ *            lead into, and the two DP columns are contiguous
+ *            arrays swapped by pointer, so the M and I rows of each
+ *            column are computed two nodes at a time with SSE2
+ *            (scalar elsewhere). The D row, a chain along the column,
+ *            is left serial, and the surviving mass is summed in the
+ *            same pass, node by node in the original order, so the
+ *            result is the same MAXL as <p7_Builder_MaxLength()>'s
+ *            original loop gave, to the bit.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_lengthdist_MaxLength(const P7_HMM *hmm, double emit_thresh, int *ret_maxl)
+{
+  int      M      = hmm->M;
+  int      bound  = ESL_MAX(M, ESL_MIN(20*M, 100000)); /* cap on # of columns */
+  int      n      = M+1;
+  double  *mem    = NULL;
+  double  *tmm, *tim, *tdm, *tmi, *tii, *tmd, *tdd; /* t*M, t*D: into node k from k-1; t*I: node k */
+  double  *omd, *odd;                               /* 1-t[k][MD], 1-t[k][DD]: mass kept at node k */
+  double  *Mp, *Ip, *Dp, *Mc, *Ic, *Dc, *tmp;       /* previous, current column */
+  double   p_sum;                                   /* mass of lengths <= col ending in M_M/D_M */
+  double   surv;                                    /* mass still to emit more residues */
+  int      col, k;
+  int      status;
+#if defined eslENABLE_SSE
+  __m128d  mv, iv;
+#endif
+
+  *ret_maxl = bound;
+  if (M == 1) { *ret_maxl = 1; return eslOK; }
+
+  ESL_ALLOC(mem, sizeof(double) * n * 15);
+  esl_vec_DSet(mem, n * 15, 0.0);
+  tmm = mem;      tim = tmm + n;  tdm = tim + n;
+  tmi = tdm + n;  tii = tmi + n;
+  tmd = tii + n;  tdd = tmd + n;
+  omd = tdd + n;  odd = omd + n;
+  Mp  = odd + n;  Ip  = Mp  + n;  Dp  = Ip  + n;
+  Mc  = Dp  + n;  Ic  = Mc  + n;  Dc  = Ic  + n;
+
+  for (k = 1; k <= M; k++)
+    {
+      if (k > 1) {
+	tmm[k] = hmm->t[k-1][p7H_MM];
+	tim[k] = hmm->t[k-1][p7H_IM];
+	tdm[k] = hmm->t[k-1][p7H_DM];
+	tmd[k] = hmm->t[k-1][p7H_MD];
+	tdd[k] = hmm->t[k-1][p7H_DD];
+      }
+      tmi[k] = hmm->t[k][p7H_MI];
+      tii[k] = hmm->t[k][p7H_II];
+      omd[k] = 1 - hmm->t[k][p7H_MD];  /* in float, as the original loop has it */
+      odd[k] = 1 - hmm->t[k][p7H_DD];
+    }
+
+  /* Column 1: M_1 emits the first residue; D_k carry it down the model. */
+  Mp[1] = 1.0;
+  for (k = 2; k <= M; k++) Dp[k] = tmd[k] * Mp[k-1] + tdd[k] * Dp[k-1];
+  p_sum = Mp[M] + Dp[M];
+
+  /* Columns 2..bound all follow the general recurrence (the special
+   * cases in the original two-column version are its zero terms).
+   * MAXL can't be less than 3.
+   */
+  for (col = 2; col <= bound; col++)
+    {
+      k = 1;
+#if defined eslENABLE_SSE
+      for ( ; k+1 <= M; k += 2)
+	{
+	  mv = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(tmm+k), _mm_loadu_pd(Mp+k-1)),
+				     _mm_mul_pd(_mm_loadu_pd(tdm+k), _mm_loadu_pd(Dp+k-1))),
+			  _mm_mul_pd(_mm_loadu_pd(tim+k), _mm_loadu_pd(Ip+k-1)));
+	  iv = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(tmi+k), _mm_loadu_pd(Mp+k)),
+			  _mm_mul_pd(_mm_loadu_pd(tii+k), _mm_loadu_pd(Ip+k)));
+	  _mm_storeu_pd(Mc+k, mv);
+	  _mm_storeu_pd(Ic+k, iv);
+	}
+#endif
+      for ( ; k <= M; k++)
+	{
+	  Mc[k] = tmm[k] * Mp[k-1] + tdm[k] * Dp[k-1] + tim[k] * Ip[k-1];
+	  Ic[k] = tmi[k] * Mp[k]   + tii[k] * Ip[k];
+	}
+
+      /* M_1 and D_1 are empty after column 1 */
+      Dc[1] = 0.;
+      surv  = Ic[1];
+      for (k = 2; k <= M; k++)
+	{
+	  Dc[k] = tmd[k] * Mc[k-1] + tdd[k] * Dc[k-1];
+	  surv += Ic[k] + Mc[k] * omd[k] + Dc[k] * odd[k];
+	}
+
+      /* the final node doesn't pass mass on to a next D, and has no I */
+      surv  += Mc[M] * hmm->t[M][p7H_MD] + Dc[M] * hmm->t[M][p7H_DD] - Ic[M];
+      p_sum += Mc[M] + Dc[M];
+      surv  /= surv + p_sum;
+
+      if (col >= 3 && surv < emit_thresh) { *ret_maxl = col; break; }
+
+      tmp = Mp; Mp = Mc; Mc = tmp;
+      tmp = Ip; Ip = Ic; Ic = tmp;
+      tmp = Dp; Dp = Dc; Dc = tmp;
+    }
+
+  free(mem);
+  return eslOK;
+
+ ERROR:
+  if (mem) free(mem);
+  return status;
+}
+
+
+/* Function:  p7_lengthdist_WindowLengths()
+ * Synopsis:  Prefix/suffix fractions of MAXL for each model node.
+ *
+ * Purpose:   Given a model's per-node insert transitions <t_mi>
+ *            (M->I) and <t_ii> (I->I), indexed <1..M-1>, compute
+ *            how much of a MAXL-long window should precede a seed
+ *            ending at node <k> (<prefix[k]>) and follow one starting
+ *            at node <k> (<suffix[k]>), as fractions of MAXL.
+ *
+ *            Each node's share is the length <l_k> at which the
+ *            tail mass of its insert run falls below <beta>,
+ *            normalized by the sum over all nodes; <prefix> and
+ *            <suffix> are running sums of the shares. Caller
+ *            provides both arrays, <0..M>.
+ *
+ *            Cost is O(M), cheap enough to do once for each model
+ *            when its <P7_SCOREDATA> is created.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_lengthdist_WindowLengths(const float *t_mi, const float *t_ii, int M, double beta, float *prefix, float *suffix)
+{
+  float sum = 0.;
+  int   k;
+
+  for (k = 1; k < M; k++)
+    {
+      if (t_mi[k] == 0) prefix[k] = 1;
+      else              prefix[k] = 1 + (int)(log(beta / t_mi[k]) / log(t_ii[k]));
+      sum += prefix[k];
+    }
+  prefix[0] = prefix[M] = 0;
+
+  for (k = 1; k < M; k++)
+    prefix[k] /= sum;
+
+  suffix[M] = prefix[M-1];
+  for (k = M-1; k >= 1; k--)
+    suffix[k] = suffix[k+1] + prefix[k-1];
+  for (k = 2; k < M; k++)
+    prefix[k] += prefix[k-1];
+
+  return eslOK;
+}
+/*------------- end, length distribution API --------------------*/
+
+
+
+/*****************************************************************
+ * 2. Unit tests.
+ *****************************************************************/
+#ifdef p7LENGTHDIST_TESTDRIVE
+#include "esl_random.h"
+
+/* The original two-column DP of p7_Builder_MaxLength(), kept here as
+ * the reference the engine has to agree with.
+ */
+static int
+reference_maxlength(const P7_HMM *hmm, double emit_thresh)
+{
+  int     L     = hmm->M;
+  int     bound = ESL_MAX(L, ESL_MIN(20*L, 100000));
+  int     maxl  = bound;
+  double  (*M)[2] = malloc(sizeof(double[2]) * (L+1));
+  double  (*I)[2] = malloc(sizeof(double[2]) * (L+1));
+  double  (*D)[2] = malloc(sizeof(double[2]) * (L+1));
+  double  p_sum, surv;
+  int     c, p, col, k;
+
+  if (L == 1) { free(M); free(I); free(D); return 1; }
+
+  M[1][0] = 1.0;
+  I[1][0] = D[1][0] = M[2][0] = I[2][0] = 0;
+  D[2][0] = hmm->t[1][p7H_MD];
+  for (k = 3; k <= L; k++) { M[k][0] = I[k][0] = 0; D[k][0] = hmm->t[k-1][p7H_DD] * D[k-1][0]; }
+
+  M[1][1] = D[1][1] = D[2][1] = I[2][1] = 0;
+  I[1][1] = hmm->t[1][p7H_MI] * M[1][0];
+  M[2][1] = hmm->t[1][p7H_MM] * M[1][0];
+  for (k = 3; k <= L; k++) {
+    M[k][1] = hmm->t[k-1][p7H_DM] * D[k-1][0];
+    I[k][1] = 0;
+    D[k][1] = hmm->t[k-1][p7H_MD] * M[k-1][1] + hmm->t[k-1][p7H_DD] * D[k-1][1];
+  }
+  p_sum = M[L][0] + M[L][1] + D[L][0] + D[L][1];
+
+  c = 0;
+  for (col = 3; col <= bound; col++)
+    {
+      p = 1-c;
+      M[1][c] = D[1][c] = 0;
+      I[1][c] = hmm->t[1][p7H_II] * I[1][p];
+      surv    = I[1][c];
+      for (k = 2; k <= L; k++) {
+	M[k][c] = hmm->t[k-1][p7H_MM] * M[k-1][p] + hmm->t[k-1][p7H_DM] * D[k-1][p] + hmm->t[k-1][p7H_IM] * I[k-1][p];
+	I[k][c] = hmm->t[k][p7H_MI]   * M[k][p]   + hmm->t[k][p7H_II]   * I[k][p];
+	D[k][c] = hmm->t[k-1][p7H_MD] * M[k-1][c] + hmm->t[k-1][p7H_DD] * D[k-1][c];
+	surv   += I[k][c] + M[k][c] * (1 - hmm->t[k][p7H_MD]) + D[k][c] * (1 - hmm->t[k][p7H_DD]);
+      }
+      surv  += M[L][c] * hmm->t[L][p7H_MD] + D[L][c] * hmm->t[L][p7H_DD] - I[L][c];
+      p_sum += M[L][c] + D[L][c];
+      surv  /= surv + p_sum;
+      if (surv < emit_thresh) { maxl = col; break; }
+      c = 1-c;
+    }
+  free(M); free(I); free(D);
+  return maxl;
+}
+
+/* utest_maxlength: the engine gives exactly the reference DP's MAXL.
+ */
+static void
+utest_maxlength(ESL_RANDOMNESS *r, ESL_ALPHABET *abc)
+{
+  char    msg[] = "p7_lengthdist MaxLength unit test failed";
+  P7_HMM *hmm   = NULL;
+  int     Mlist[] = { 1, 2, 3, 4, 17, 100, 257 };
+  int     i, maxl, ref;
+
+  for (i = 0; i < sizeof(Mlist) / sizeof(int); i++)
+    {
+      if (p7_hmm_Sample(r, Mlist[i], abc, &hmm)                           != eslOK) esl_fatal(msg);
+      if (p7_lengthdist_MaxLength(hmm, p7_DEFAULT_WINDOW_BETA, &maxl)     != eslOK) esl_fatal(msg);
+      ref = reference_maxlength(hmm, p7_DEFAULT_WINDOW_BETA);
+      if (maxl != ref)                                                              esl_fatal("%s: M=%d, MAXL %d vs %d", msg, hmm->M, maxl, ref);
+      if (maxl < ESL_MIN(hmm->M, 3) || maxl > ESL_MAX(hmm->M, 20*hmm->M))           esl_fatal(msg);
+
+      /* p7_Builder_MaxLength() is a wrapper around it */
+      if (p7_Builder_MaxLength(hmm, p7_DEFAULT_WINDOW_BETA)              != eslOK) esl_fatal(msg);
+      if (hmm->max_length != maxl)                                                  esl_fatal(msg);
+      p7_hmm_Destroy(hmm);
+    }
+}
+
+/* utest_windowlengths: prefix sums rise to 1 across the model;
+ *                      suffix sums fall from 1.
+ */
+static void
+utest_windowlengths(ESL_RANDOMNESS *r, ESL_ALPHABET *abc)
+{
+  char    msg[]  = "p7_lengthdist WindowLengths unit test failed";
+  P7_HMM *hmm    = NULL;
+  float  *t_mi   = NULL;
+  float  *t_ii   = NULL;
+  float  *prefix = NULL;
+  float  *suffix = NULL;
+  int     M      = 50;
+  int     k;
+
+  if (p7_hmm_Sample(r, M, abc, &hmm) != eslOK) esl_fatal(msg);
+  if ((t_mi   = malloc(sizeof(float) * (M+1))) == NULL) esl_fatal(msg);
+  if ((t_ii   = malloc(sizeof(float) * (M+1))) == NULL) esl_fatal(msg);
+  if ((prefix = malloc(sizeof(float) * (M+1))) == NULL) esl_fatal(msg);
+  if ((suffix = malloc(sizeof(float) * (M+1))) == NULL) esl_fatal(msg);
+  for (k = 1; k <= M; k++) { t_mi[k] = hmm->t[k][p7H_MI]; t_ii[k] = hmm->t[k][p7H_II]; }
+
+  if (p7_lengthdist_WindowLengths(t_mi, t_ii, M, p7_DEFAULT_WINDOW_BETA, prefix, suffix) != eslOK) esl_fatal(msg);
+  if (prefix[0] != 0. || prefix[M] != 0.)                   esl_fatal(msg);
+  if (esl_FCompare(prefix[M-1], 1.0, 1e-4)        != eslOK) esl_fatal(msg);
+  if (esl_FCompare(suffix[1],   1.0, 1e-4)        != eslOK) esl_fatal(msg);
+  for (k = 2; k < M; k++) {
+    if (prefix[k] < prefix[k-1]) esl_fatal(msg);
+    if (suffix[k] > suffix[k-1]) esl_fatal(msg);
+  }
+
+  free(t_mi); free(t_ii); free(prefix); free(suffix);
+  p7_hmm_Destroy(hmm);
+}
+#endif /*p7LENGTHDIST_TESTDRIVE*/
+/*----------------- end, unit tests -----------------------------*/
+
+
+
+/*****************************************************************
+ * 3. Test driver.
+ *****************************************************************/
+#ifdef p7LENGTHDIST_TESTDRIVE
+#include "esl_getopts.h"
+#include "esl_alphabet.h"
+#include "esl_random.h"
+
+static ESL_OPTIONS options[] = {
+  /* name  type         default  env   range togs  reqs  incomp  help                docgrp */
+  {"-h",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show help and usage",                            0},
+  {"-s",  eslARG_INT,       "0", NULL, NULL, NULL, NULL, NULL, "set random number seed to <n>",                  0},
+  {"-v",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show verbose commentary/output",                 0},
+  { 0,0,0,0,0,0,0,0,0,0},
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for p7_lengthdist";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go         = esl_getopts_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *rng        = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *aa_abc     = esl_alphabet_Create(eslAMINO);
+  int             be_verbose = esl_opt_GetBoolean(go, "-v");
+
+  if (be_verbose) printf("p7_lengthdist unit test: rng seed %" PRIu32 "\n", esl_randomness_GetSeed(rng));
+
+  utest_maxlength    (rng, aa_abc);
+  utest_windowlengths(rng, aa_abc);
+
+  esl_alphabet_Destroy(aa_abc);
+  esl_randomness_Destroy(rng);
+  esl_getopts_Destroy(go);
+  return 0;
+}
+#endif /*p7LENGTHDIST_TESTDRIVE*/
+/*------------------ end, test driver ---------------------------*/
@@ -0,0 +1,470 @@
+/* P7_PERFCTR: hardware performance counters per pipeline stage.
+ *
+ * bathsearch --perfctr reads the CPU's performance monitoring
+ * counters (cycles, instructions retired, L1 data cache misses,
+ * last-level cache misses, and mispredicted branches) around each
+ * stage of the BATH pipeline: the per-ORF MSV/bias/Viterbi filters,
+ * the Forward filters, domain definition (Backward, posterior
+ * decoding and envelope definition), and alignment (rescoring,
+ * alignment displays and hit construction). Wall-clock time alone
+ * can't tell whether a stage is compute bound or memory bound; IPC and
+ * cache misses per thousand DP cells can.
+ *
+ * Counters are read with the Linux perf_event_open() system call, one
+ * event group per thread, counting only the calling thread in user
+ * space. They are opened lazily by the first <p7_perfctr_Start()>
+ * call, so each worker thread's pipeline counts its own work. Where
+ * perf_event_open() is missing, or refused (kernel.perf_event_paranoid,
+ * seccomp, containers, virtual machines without a virtual PMU), the
+ * collector quietly does nothing and the report says so; individual
+ * events the CPU doesn't support are skipped.
+ *
+ * Contents:
+ *   1. The <P7_PERFCTR> object
+ *   2. Counting
+ *   3. Merging and reporting
+ *   4. Unit tests
+ *   5. Test driver
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "easel.h"
+
+#include "hmmer.h"
+
+static const char *stage_name[p7_PERF_NSTAGES] = { "filters", "forward", "domaindef", "alignment" };
+
+static int  perfctr_open(P7_PERFCTR *pc);
+static void perfctr_close(P7_PERFCTR *pc);
+static int  perfctr_read(P7_PERFCTR *pc, uint64_t *val);
+
+/*****************************************************************
+ *= 1. The <P7_PERFCTR> object
+ *****************************************************************/
+
+/* Function:  p7_perfctr_Create()
+ * Synopsis:  Create a new <P7_PERFCTR> collector.
+ *
+ * Purpose:   Create a collector with all counts zero. No counters
+ *            are opened until the first <p7_perfctr_Start()>, so a
+ *            collector created in one thread may be used in another,
+ *            and a collector that is only a merge target (the master's
+ *            pipeline) never opens any.
+ *
+ * Returns:   ptr to the new <P7_PERFCTR>.
+ *
+ * Throws:    <NULL> on allocation failure.
+ */
+P7_PERFCTR *
+p7_perfctr_Create(void)
+{
+  P7_PERFCTR *pc = NULL;
+  int         e;
+  int         status;
+
+  ESL_ALLOC(pc, sizeof(P7_PERFCTR));
+  for (e = 0; e < p7_PERF_NEVENTS; e++) pc->fd[e] = -1;
+  pc->is_open  = FALSE;
+  pc->is_avail = FALSE;
+  pc->errmsg[0] = '\0';
+  p7_perfctr_Reuse(pc);
+  return pc;
+
+ ERROR:
+  return NULL;
+}
+
+/* Function:  p7_perfctr_Reuse()
+ * Synopsis:  Zero the counts in a <P7_PERFCTR>.
+ *
+ * Purpose:   Zero all accumulated counts, keeping any open counters.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_perfctr_Reuse(P7_PERFCTR *pc)
+{
+  int s, e;
+
+  for (s = 0; s < p7_PERF_NSTAGES; s++)
+    {
+      for (e = 0; e < p7_PERF_NEVENTS; e++) pc->count[s][e] = 0;
+      pc->ncalls[s] = 0;
+      pc->cells[s]  = 0;
+    }
+  for (e = 0; e < p7_PERF_NEVENTS; e++) pc->start[e] = 0;
+  pc->stage   = -1;
+  pc->nthread = 0;
+  return eslOK;
+}
+
+/* Function:  p7_perfctr_Destroy()
+ * Synopsis:  Free a <P7_PERFCTR>, closing its counters.
+ */
+void
+p7_perfctr_Destroy(P7_PERFCTR *pc)
+{
+  if (pc == NULL) return;
+  perfctr_close(pc);
+  free(pc);
+}
+/*------------------ end, P7_PERFCTR object ---------------------*/
+
+
+/*****************************************************************
+ *= 2. Counting
+ *****************************************************************/
+
+/* Function:  p7_perfctr_Start()
+ * Synopsis:  Start counting one pipeline stage.
+ *
+ * Purpose:   Snapshot the counters at the start of stage <stage>
+ *            (<p7_PERF_FILTERS>, <p7_PERF_FORWARD>,
+ *            <p7_PERF_DOMAINDEF> or <p7_PERF_ALIGN>). The first call opens the counters
+ *            for the calling thread. Stages don't nest: starting a
+ *            stage while another is open is a no-op.
+ *
+ *            <pc> may be <NULL>, in which case nothing happens, so
+ *            callers need not test whether counting is on.
+ *
+ * Returns:   <eslOK>, whether or not counters are available.
+ */
+int
+p7_perfctr_Start(P7_PERFCTR *pc, int stage)
+{
+  if (pc == NULL || pc->stage != -1) return eslOK;
+  if (! pc->is_open) perfctr_open(pc);
+  if (pc->is_avail && perfctr_read(pc, pc->start) != eslOK) return eslOK;
+  pc->stage = stage;
+  return eslOK;
+}
+
+/* Function:  p7_perfctr_Stop()
+ * Synopsis:  Stop counting one pipeline stage.
+ *
+ * Purpose:   Read the counters at the end of stage <stage> and add
+ *            the difference from the matching <p7_perfctr_Start()>
+ *            to that stage's totals, along with <ncells> DP cells
+ *            (sequence length times model length, summed over the
+ *            DP calls the stage made) for normalization.
+ *
+ *            <pc> may be <NULL>, in which case nothing happens.
+ *
+ * Returns:   <eslOK>.
+ */
+int
+p7_perfctr_Stop(P7_PERFCTR *pc, int stage, int64_t ncells)
+{
+  uint64_t now[p7_PERF_NEVENTS];
+  int      e;
+
+  if (pc == NULL || pc->stage != stage) return eslOK;
+  pc->stage = -1;
+  pc->ncalls[stage]++;
+  pc->cells[stage] += ncells;
+
+  if (pc->is_avail && perfctr_read(pc, now) == eslOK)
+    for (e = 0; e < p7_PERF_NEVENTS; e++)
+      if (pc->fd[e] >= 0 && now[e] >= pc->start[e])
+        pc->count[stage][e] += now[e] - pc->start[e];
+  return eslOK;
+}
+
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+static const struct { uint32_t type; uint64_t config; } perf_event[p7_PERF_NEVENTS] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES       },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS     },
+  { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D  | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+  { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL   | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES    },
+};
+
+/* Open one event group for the calling thread, led by the cycle
+ * counter. Events after the leader that fail to open are skipped;
+ * if the leader fails, counting is unavailable.
+ */
+static int
+perfctr_open(P7_PERFCTR *pc)
+{
+  struct perf_event_attr attr;
+  int                    e;
+
+  pc->is_open = TRUE;
+  for (e = 0; e < p7_PERF_NEVENTS; e++)
+    {
+      memset(&attr, 0, sizeof(attr));
+      attr.size           = sizeof(attr);
+      attr.type           = perf_event[e].type;
+      attr.config         = perf_event[e].config;
+      attr.disabled       = (e == 0);
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      pc->fd[e] = syscall(__NR_perf_event_open, &attr, 0, -1, (e == 0 ? -1 : pc->fd[0]), 0);
+      if (pc->fd[e] < 0)
+        {
+          if (e == 0) {
+            snprintf(pc->errmsg, sizeof(pc->errmsg), "perf_event_open: %s", strerror(errno));
+            return eslFAIL;
+          }
+          continue;
+        }
+      if (ioctl(pc->fd[e], PERF_EVENT_IOC_ID, &(pc->id[e])) < 0) { close(pc->fd[e]); pc->fd[e] = -1; }
+    }
+  if (pc->fd[0] < 0) {
+    perfctr_close(pc);
+    snprintf(pc->errmsg, sizeof(pc->errmsg), "perf_event_open: can't identify counters");
+    return eslFAIL;
+  }
+
+  ioctl(pc->fd[0], PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+  ioctl(pc->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  pc->is_avail = TRUE;
+  pc->nthread  = 1;
+  return eslOK;
+}
+
+static void
+perfctr_close(P7_PERFCTR *pc)
+{
+  int e;
+
+  for (e = p7_PERF_NEVENTS-1; e >= 0; e--)
+    if (pc->fd[e] >= 0) { close(pc->fd[e]); pc->fd[e] = -1; }
+}
+
+/* Read the whole group at once, matching values to events by id, and
+ * scale for multiplexing if the group wasn't on the PMU the whole time.
+ */
+static int
+perfctr_read(P7_PERFCTR *pc, uint64_t *val)
+{
+  uint64_t buf[3 + 2*p7_PERF_NEVENTS];
+  uint64_t nr, enabled, running;
+  uint64_t i;
+  int      e;
+  double   scale;
+
+  if (read(pc->fd[0], buf, sizeof(buf)) < (ssize_t) (3 * sizeof(uint64_t))) return eslFAIL;
+  nr      = buf[0];
+  enabled = buf[1];
+  running = buf[2];
+  if (nr > p7_PERF_NEVENTS || running == 0) return eslFAIL;
+  scale = (double) enabled / (double) running;
+
+  for (e = 0; e < p7_PERF_NEVENTS; e++) val[e] = 0;
+  for (i = 0; i < nr; i++)
+    for (e = 0; e < p7_PERF_NEVENTS; e++)
+      if (pc->fd[e] >= 0 && pc->id[e] == buf[3 + 2*i + 1])
+        val[e] = (uint64_t) ((double) buf[3 + 2*i] * scale);
+  return eslOK;
+}
+
+#else /*! HAVE_LINUX_PERF_EVENT_H*/
+static int
+perfctr_open(P7_PERFCTR *pc)
+{
+  pc->is_open = TRUE;
+  snprintf(pc->errmsg, sizeof(pc->errmsg), "not supported on this platform");
+  return eslFAIL;
+}
+static void perfctr_close(P7_PERFCTR *pc)                { return; }
+static int  perfctr_read (P7_PERFCTR *pc, uint64_t *val) { return eslFAIL; }
+#endif /*HAVE_LINUX_PERF_EVENT_H*/
+/*----------------------- end, counting -------------------------*/
+
+
+/*****************************************************************
+ *= 3. Merging and reporting
+ *****************************************************************/
+
+/* Function:  p7_perfctr_Merge()
+ * Synopsis:  Add one collector's counts to another's.
+ *
+ * Purpose:   Add the counts in <pc2> to <pc1>, as when merging
+ *            worker pipelines into the master's. <pc1>'s own
+ *            counters, if any, are left as they are.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_perfctr_Merge(P7_PERFCTR *pc1, const P7_PERFCTR *pc2)
+{
+  int s, e;
+
+  for (s = 0; s < p7_PERF_NSTAGES; s++)
+    {
+      for (e = 0; e < p7_PERF_NEVENTS; e++) pc1->count[s][e] += pc2->count[s][e];
+      pc1->ncalls[s] += pc2->ncalls[s];
+      pc1->cells[s]  += pc2->cells[s];
+    }
+  pc1->nthread += pc2->nthread;
+  if (pc2->is_avail) pc1->is_avail = TRUE;
+  if (pc1->errmsg[0] == '\0' && pc2->errmsg[0] != '\0') strcpy(pc1->errmsg, pc2->errmsg);
+  return eslOK;
+}
+
+/* Function:  p7_perfctr_Report()
+ * Synopsis:  Print per-stage counter totals and derived rates.
+ *
+ * Purpose:   Print a small table to <ofp>: for each stage, the number
+ *            of calls, millions of DP cells, billions of cycles,
+ *            instructions per cycle, and L1D, LLC and branch misses
+ *            per thousand DP cells. Events that could not be counted
+ *            print as "-". If no thread could open counters, print a
+ *            single line saying why.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEWRITE> on write failure.
+ */
+int
+p7_perfctr_Report(FILE *ofp, const P7_PERFCTR *pc)
+{
+  char   buf[3][16];
+  double kcells;
+  int    s, e;
+
+  if (! pc->is_avail)
+    {
+      if (fprintf(ofp, "Hardware counters:                   unavailable (%s)\n",
+                  pc->errmsg[0] ? pc->errmsg : "no counting threads") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+      return eslOK;
+    }
+
+  if (fprintf(ofp, "Hardware counters, %d thread%s (per 1000 DP cells):\n", pc->nthread, pc->nthread == 1 ? "" : "s") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  if (fprintf(ofp, "  %-10s %10s %10s %9s %6s %9s %9s %9s\n", "stage", "calls", "Mcells", "Gcycles", "IPC", "L1D miss", "LLC miss", "br miss") < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+  for (s = 0; s < p7_PERF_NSTAGES; s++)
+    {
+      kcells = (double) pc->cells[s] / 1000.;
+      for (e = p7_PERF_L1DMISS; e <= p7_PERF_BRMISS; e++)
+        {
+          if (pc->count[s][e] == 0 || kcells == 0.) strcpy(buf[e-p7_PERF_L1DMISS], "-");
+          else snprintf(buf[e-p7_PERF_L1DMISS], 16, "%.2f", (double) pc->count[s][e] / kcells);
+        }
+      if (fprintf(ofp, "  %-10s %10" PRId64 " %10.2f %9.3f %6.2f %9s %9s %9s\n",
+                  stage_name[s], pc->ncalls[s], (double) pc->cells[s] / 1e6,
+                  (double) pc->count[s][p7_PERF_CYCLES] / 1e9,
+                  pc->count[s][p7_PERF_CYCLES] ? (double) pc->count[s][p7_PERF_INSTR] / (double) pc->count[s][p7_PERF_CYCLES] : 0.,
+                  buf[0], buf[1], buf[2]) < 0) ESL_EXCEPTION_SYS(eslEWRITE, "write failed");
+    }
+  return eslOK;
+}
+/*------------------ end, merging and reporting -----------------*/
+
+
+
+/*****************************************************************
+ *= 4. Unit tests
+ *****************************************************************/
+#ifdef p7PERFCTR_TESTDRIVE
+
+/* Count a busy loop as one stage in two collectors, merge them, and
+ * check the bookkeeping. Where the counters are available, the cycle
+ * and instruction counts must be nonzero and merging must add them;
+ * where they aren't, everything must still work and report cleanly.
+ */
+static void
+utest_count_merge(void)
+{
+  char       *msg  = "p7_perfctr count/merge unit test failed";
+  P7_PERFCTR *pc1  = p7_perfctr_Create();
+  P7_PERFCTR *pc2  = p7_perfctr_Create();
+  FILE       *ofp  = tmpfile();
+  volatile double x = 0.;
+  uint64_t    c1, c2;
+  int         i;
+
+  if (pc1 == NULL || pc2 == NULL || ofp == NULL) esl_fatal(msg);
+
+  p7_perfctr_Start(pc1, p7_PERF_FORWARD);
+  for (i = 0; i < 1000000; i++) x += (double) i * 0.5;
+  p7_perfctr_Stop (pc1, p7_PERF_FORWARD, 1000);
+
+  p7_perfctr_Start(pc2, p7_PERF_FORWARD);
+  p7_perfctr_Start(pc2, p7_PERF_FILTERS);              /* stages don't nest: ignored */
+  for (i = 0; i < 1000000; i++) x += (double) i * 0.5;
+  p7_perfctr_Stop (pc2, p7_PERF_FILTERS, 5);           /* ignored */
+  p7_perfctr_Stop (pc2, p7_PERF_FORWARD, 2000);
+
+  if (pc1->ncalls[p7_PERF_FORWARD] != 1 || pc1->cells[p7_PERF_FORWARD] != 1000) esl_fatal(msg);
+  if (pc2->ncalls[p7_PERF_FILTERS] != 0 || pc2->cells[p7_PERF_FILTERS] != 0)    esl_fatal(msg);
+  if (pc1->is_avail != pc2->is_avail)                                          esl_fatal(msg);
+  if (pc1->is_avail)
+    {
+      if (pc1->count[p7_PERF_FORWARD][p7_PERF_CYCLES] == 0) esl_fatal(msg);
+      if (pc1->count[p7_PERF_FORWARD][p7_PERF_INSTR]  == 0) esl_fatal(msg);
+      if (pc1->count[p7_PERF_FILTERS][p7_PERF_CYCLES] != 0) esl_fatal(msg);
+    }
+  else if (pc1->errmsg[0] == '\0') esl_fatal(msg);
+
+  c1 = pc1->count[p7_PERF_FORWARD][p7_PERF_CYCLES];
+  c2 = pc2->count[p7_PERF_FORWARD][p7_PERF_CYCLES];
+  p7_perfctr_Merge(pc1, pc2);
+  if (pc1->ncalls[p7_PERF_FORWARD] != 2 || pc1->cells[p7_PERF_FORWARD] != 3000) esl_fatal(msg);
+  if (pc1->count[p7_PERF_FORWARD][p7_PERF_CYCLES] != c1 + c2)                  esl_fatal(msg);
+
+  if (p7_perfctr_Report(ofp, pc1) != eslOK) esl_fatal(msg);
+
+  p7_perfctr_Reuse(pc1);
+  if (pc1->ncalls[p7_PERF_FORWARD] != 0 || pc1->count[p7_PERF_FORWARD][p7_PERF_CYCLES] != 0) esl_fatal(msg);
+
+  /* a NULL collector is a no-op */
+  if (p7_perfctr_Start(NULL, p7_PERF_DOMAINDEF)    != eslOK) esl_fatal(msg);
+  if (p7_perfctr_Stop (NULL, p7_PERF_DOMAINDEF, 1) != eslOK) esl_fatal(msg);
+
+  fclose(ofp);
+  p7_perfctr_Destroy(pc1);
+  p7_perfctr_Destroy(pc2);
+}
+#endif /*p7PERFCTR_TESTDRIVE*/
+
+/*****************************************************************
+ *= 5. Test driver
+ *****************************************************************/
+#ifdef p7PERFCTR_TESTDRIVE
+/*
+  gcc -o p7_perfctr_utest -g -Wall -I. -L. -I../easel -L../easel -Dp7PERFCTR_TESTDRIVE p7_perfctr.c -lhmmer -leasel -lm
+  ./p7_perfctr_utest
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name  type         default  env   range togs  reqs  incomp  help                   docgrp */
+  { "-h",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show help and usage",           0 },
+  { 0,0,0,0,0,0,0,0,0,0},
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for p7_perfctr.c";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS *go = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+
+  utest_count_merge();
+
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7PERFCTR_TESTDRIVE*/
+/*---------------------- end, test driver ----------------------*/
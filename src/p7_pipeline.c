@@ -219,6 +219,12 @@ p7_pipeline_Create(const ESL_GETOPTS *go, int M_hint, int L_hint, int long_targe
   pli->do_max        = FALSE;
   pli->do_biasfilter = TRUE;
   pli->do_null2      = TRUE;
+  pli->do_tmask      = FALSE;
+  pli->tmaskdb       = NULL;
+  pli->tmask         = NULL;
+  pli->tmask_w       = NULL;
+  pli->seeds         = NULL;
+  pli->perf          = NULL;
   pli->F1     = ((go && esl_opt_IsOn(go, "--F1")) ? ESL_MIN(1.0, esl_opt_GetReal(go, "--F1")) : 0.02);
   pli->F2     = (go ? ESL_MIN(1.0, esl_opt_GetReal(go, "--F2")) : 1e-3);
   pli->F3     = (go ? ESL_MIN(1.0, esl_opt_GetReal(go, "--F3")) : 1e-5);
@@ -254,6 +260,10 @@ p7_pipeline_Create(const ESL_GETOPTS *go, int M_hint, int L_hint, int long_targe
   pli->pos_past_bias   = 0;
   pli->pos_past_vit    = 0;
   pli->pos_past_fwd    = 0;
+  pli->tmask_nres      = 0;
+  pli->tmask_norfs     = 0;
+  pli->tmask_time      = 0.;
+  pli->seed_norfs      = 0;
   pli->mode            = mode;
   pli->show_accessions = (go && esl_opt_GetBoolean(go, "--acc")   ? TRUE  : FALSE);
   pli->show_alignments = (go && esl_opt_GetBoolean(go, "--noali") ? FALSE : TRUE);
@@ -313,6 +323,27 @@ p7_pipeline_Create(const ESL_GETOPTS *go, int M_hint, int L_hint, int long_targe
  *            | --nonull2    |  turn OFF biased comp score correction      |   FALSE   |
  *            | --seed       |  RNG seed (0=use arbitrary seed)            |      42   |
  *            | --acc        |  prefer accessions over names in output     |   FALSE   |
+ *            | --notrans    |  don't show the translated DNA sequence     |   FALSE   |
+ *
+ *            If <bath_opts> is TRUE, <go> also has the options of
+ *            bathsearch's own that configure the pipeline:
+ *
+ *            || option      ||            description                    || usually  ||
+ *            | --nofs       |  use only the non-frameshift pipeline       |   FALSE   |
+ *            | --fsonly     |  use only the frameshift pipeline           |   FALSE   |
+ *            | --B1         |  window length, SSV bias filter             |     110   |
+ *            | --B2         |  window length, Viterbi bias filter         |     240   |
+ *            | --B3         |  window length, Forward bias filter         |    1000   |
+ *            | --tmask      |  mask low-complexity target DNA             |   FALSE   |
+ *            | --perfctr    |  count hardware events per stage            |   FALSE   |
+ *            | --frameline  |  show the frame of each codon in alignments |   FALSE   |
+ *            | --cigar      |  add CIGAR strings to tabular output        |   FALSE   |
+ *            | --fstblout   |  save a table of frameshift locations       |    NULL   |
+ *            | --fwd_cpu    |  threads for Forward on very large envelopes|       0   |
+ *
+ *            If <bath_opts> is FALSE (the hmmpgmd daemon, whose query
+ *            options are hmmscan's), these take the defaults they get
+ *            when <go> is <NULL>.
  *
  *            As a special case, if <go> is <NULL>, defaults are set as above.
  *            This shortcut is used in simplifying test programs and the like.
@@ -323,7 +354,7 @@ p7_pipeline_Create(const ESL_GETOPTS *go, int M_hint, int L_hint, int long_targe
  * Throws:    <NULL> on allocation failure.
  */
 P7_PIPELINE *
-p7_pipeline_fs_Create(ESL_GETOPTS *go, int M_hint, int L_hint, enum p7_pipemodes_e mode)
+p7_pipeline_fs_Create(ESL_GETOPTS *go, int M_hint, int L_hint, int bath_opts, enum p7_pipemodes_e mode)
 {
   P7_PIPELINE *pli  = NULL;
   int          seed = (go ? esl_opt_GetInteger(go, "--seed") : 42);
@@ -333,12 +364,29 @@ p7_pipeline_fs_Create(ESL_GETOPTS *go, int M_hint, int L_hint, enum p7_pipemodes
 
   pli->do_alignment_score_calc = 0;
 
+  /* Target masking; the mask database, if any, is attached by the caller */
+  pli->do_tmask = (go && bath_opts && esl_opt_IsOn(go, "--tmask")) ? TRUE : FALSE;
+  pli->tmaskdb  = NULL;
+  pli->tmask    = NULL;
+  pli->tmask_w  = NULL;
+  pli->seeds    = NULL;   /* seed index (--kseed), if any, is attached by the caller too */
+  if (pli->do_tmask)
+    {
+      if ((pli->tmask   = p7_tmask_Create())      == NULL) goto ERROR;
+      if ((pli->tmask_w = esl_stopwatch_Create()) == NULL) goto ERROR;
+    }
+
+  /* Hardware counters; opened lazily by the thread that runs the pipeline */
+  pli->perf = NULL;
+  if (go && bath_opts && esl_opt_IsOn(go, "--perfctr"))
+    if ((pli->perf = p7_perfctr_Create()) == NULL) goto ERROR;
+
   /* Set Frameshift Mode */
   pli->frameshift = TRUE;
   pli->long_targets = FALSE;
   pli->is_translated = FALSE; 
-  pli->fs_pipe  = (go ? !esl_opt_IsUsed(go, "--nofs")   : 1); 
-  pli->std_pipe = (go ? !esl_opt_IsUsed(go, "--fsonly") : 1);
+  pli->fs_pipe  = (go && bath_opts ? !esl_opt_IsUsed(go, "--nofs")   : 1); 
+  pli->std_pipe = (go && bath_opts ? !esl_opt_IsUsed(go, "--fsonly") : 1);
 
   /* Create forward and backward optimized matricies for use in the 
    * non-frameshift pipeline branch
@@ -365,7 +413,10 @@ p7_pipeline_fs_Create(ESL_GETOPTS *go, int M_hint, int L_hint, enum p7_pipemodes
    */
    pli->r                  =  esl_randomness_CreateFast(seed);
    pli->do_reseeding       = (seed == 0) ? FALSE : TRUE;
-   pli->ddef               = p7_domaindef_fs_Create(pli->r, go);
+   pli->ddef               = p7_domaindef_fs_Create(pli->r,
+                                                    (go && bath_opts) ? esl_opt_IsUsed(go, "--fstblout")    : FALSE,
+                                                    (go && bath_opts) ? esl_opt_GetInteger(go, "--fwd_cpu") : 0);
+   if (pli->ddef == NULL) goto ERROR;
    pli->ddef->do_reseeding = pli->do_reseeding;
 
    /* Configure reporting thresholds */
@@ -426,9 +477,9 @@ p7_pipeline_fs_Create(ESL_GETOPTS *go, int M_hint, int L_hint, enum p7_pipemodes
    pli->F1     = ((go && esl_opt_IsOn(go, "--F1")) ? ESL_MIN(1.0, esl_opt_GetReal(go, "--F1")) : 0.02);
    pli->F2     = (go ? ESL_MIN(1.0, esl_opt_GetReal(go, "--F2")) : 1e-3);
    pli->F3     = (go ? ESL_MIN(1.0, esl_opt_GetReal(go, "--F3")) : 1e-5);
-   pli->B1     = (go ? esl_opt_GetInteger(go, "--B1") : 100);
-   pli->B2     = (go ? esl_opt_GetInteger(go, "--B2") : 240);
-   pli->B3     = (go ? esl_opt_GetInteger(go, "--B3") : 1000);
+   pli->B1     = (go && bath_opts ? esl_opt_GetInteger(go, "--B1") : 100);
+   pli->B2     = (go && bath_opts ? esl_opt_GetInteger(go, "--B2") : 240);
+   pli->B3     = (go && bath_opts ? esl_opt_GetInteger(go, "--B3") : 1000);
 
    if (go && esl_opt_GetBoolean(go, "--max")) 
    {
@@ -454,12 +505,16 @@ p7_pipeline_fs_Create(ESL_GETOPTS *go, int M_hint, int L_hint, enum p7_pipemodes
    pli->pos_past_bias   = 0;
    pli->pos_past_vit    = 0;
    pli->pos_past_fwd    = 0;
+   pli->tmask_nres      = 0;
+   pli->tmask_norfs     = 0;
+   pli->tmask_time      = 0.;
+   pli->seed_norfs      = 0;
    pli->mode            = mode;
    pli->show_accessions = (go && esl_opt_GetBoolean(go, "--acc")   ? TRUE  : FALSE);
    pli->show_alignments = (go && esl_opt_GetBoolean(go, "--noali") ? FALSE : TRUE);
    pli->show_translated_sequence = (go && esl_opt_GetBoolean(go, "--notrans") ? FALSE : TRUE); /* TRUE to display translated DNA sequence in alignment display for bathsearch */
-   pli->show_frameline = (go && esl_opt_GetBoolean(go, "--frameline") ? TRUE : FALSE); /* TRUE to display the frame of each codon in alignment display for bathsearch */
-   pli->show_cigar     = (go && esl_opt_GetBoolean(go, "--cigar") ? TRUE : FALSE); /* TRUE to alignment CIGAR string int tabular output for bathsearch */
+   pli->show_frameline = (go && bath_opts && esl_opt_GetBoolean(go, "--frameline") ? TRUE : FALSE); /* TRUE to display the frame of each codon in alignment display for bathsearch */
+   pli->show_cigar     = (go && bath_opts && esl_opt_GetBoolean(go, "--cigar") ? TRUE : FALSE); /* TRUE to alignment CIGAR string int tabular output for bathsearch */
    pli->hfp             = NULL;
    pli->errbuf[0]       = '\0';
 
@@ -545,6 +600,9 @@ p7_pipeline_fs_Destroy(P7_PIPELINE *pli)
   p7_omx_Destroy(pli->oxb);
   esl_randomness_Destroy(pli->r);
   p7_domaindef_fs_Destroy(pli->ddef);
+  if (pli->tmask)   p7_tmask_Destroy(pli->tmask);
+  if (pli->tmask_w) esl_stopwatch_Destroy(pli->tmask_w);
+  if (pli->perf)    p7_perfctr_Destroy(pli->perf);
   free(pli);
 }
 
@@ -996,6 +1054,65 @@ p7_pli_NewSeq(P7_PIPELINE *pli, const ESL_SQ *sq)
   return eslOK;
 }
 
+/* Function:  p7_pli_MaskTarget() - BATH
+ * Synopsis:  Mask low-complexity regions of a target DNA window.
+ *
+ * Purpose:   If target masking is on (bathsearch --tmask), replace the
+ *            low-complexity residues of DNA window <sq> with N before
+ *            it is translated, so the ORFs built from it carry X at
+ *            every masked codon. Masks are taken from the precomputed
+ *            <pli->tmaskdb> if one is attached, by sequence name;
+ *            otherwise they are computed on the fly for this window
+ *            with dust and SEG (translating with <gcode>), and the
+ *            elapsed time is added to <pli->tmask_time>. Only the new
+ *            residues of a window are counted in <pli->tmask_nres>;
+ *            its leading <sq->C> residues of context were counted
+ *            with the previous window.
+ *
+ *            Call once per window, before either strand is searched.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_pli_MaskTarget(P7_PIPELINE *pli, const ESL_GENCODE *gcode, ESL_SQ *sq)
+{
+  P7_TMASK *tm;
+  int64_t   offset;
+  int64_t   lo, hi;
+  int       status;
+
+  if (! pli->do_tmask || sq->n == 0) return eslOK;
+
+  if (pli->tmaskdb != NULL)
+    {
+      if ((tm = p7_tmaskdb_Get(pli->tmaskdb, sq->name)) == NULL) return eslOK;
+    }
+  else
+    {
+      tm     = pli->tmask;
+      offset = ESL_MIN(sq->start, sq->end) - 1;
+      esl_stopwatch_Start(pli->tmask_w);
+      p7_tmask_Reuse(tm);
+      if ((status = p7_tmask_Dust(tm, sq->abc, sq->dsq, sq->n, offset, p7_TMASK_DUSTW, p7_TMASK_DUSTLEVEL))                 != eslOK) return status;
+      if ((status = p7_tmask_Seg (tm, gcode,   sq->dsq, sq->n, offset, p7_TMASK_SEGW, p7_TMASK_SEGK1, p7_TMASK_SEGK2)) != eslOK) return status;
+      p7_tmask_Finalize(tm);
+      esl_stopwatch_Stop(pli->tmask_w);
+      pli->tmask_time += pli->tmask_w->elapsed;  /* <user> is process-wide CPU time, inflated by other threads */
+    }
+
+  p7_tmask_Apply(tm, sq, NULL);
+
+  lo = ESL_MIN(sq->start, sq->end);
+  hi = ESL_MAX(sq->start, sq->end);
+  if      (lo == 0)              { lo = 1; hi = sq->n; }  /* no coords: a whole sequence */
+  else if (sq->start <= sq->end) lo += sq->C;
+  else                           hi -= sq->C;
+  pli->tmask_nres += p7_tmask_Count(tm, lo, hi) * (pli->strands == p7_STRAND_BOTH ? 2 : 1);
+  return eslOK;
+}
+
 /* Function:  p7_pipeline_Merge()
  * Synopsis:  Merge the pipeline statistics
  *
@@ -1041,6 +1158,12 @@ p7_pipeline_Merge(P7_PIPELINE *p1, P7_PIPELINE *p2)
   p1->pos_past_fwd  += p2->pos_past_fwd;
   p1->pos_output    += p2->pos_output;
 
+  p1->tmask_nres    += p2->tmask_nres;
+  p1->tmask_norfs   += p2->tmask_norfs;
+  p1->tmask_time    += p2->tmask_time;
+  p1->seed_norfs    += p2->seed_norfs;
+  if (p1->perf && p2->perf) p7_perfctr_Merge(p1->perf, p2->perf);
+
   if (p1->Z_setby == p7_ZSETBY_NTARGETS)
     {
       if(p2->frameshift)
@@ -2029,7 +2152,7 @@ p7_Pipeline_LongTarget(P7_PIPELINE *pli, P7_OPROFILE *om, P7_SCOREDATA *data,
 
     p7_oprofile_GetFwdEmissionArray(om, bg, pli_tmp->fwd_emissions_arr);
 
-    if (data->prefix_lengths == NULL)  //otherwise, already filled in
+    if (data->fwd_scores == NULL)  //otherwise, already filled in
       p7_hmm_ScoreDataComputeRest(om, data);
 
     p7_pli_ExtendAndMergeWindows (om, data, &msv_windowlist, 0);
@@ -2284,7 +2407,7 @@ p7_pli_postDomainDef_Frameshift(P7_PIPELINE *pli, P7_FS_PROFILE *gm_fs, P7_BG *b
       hit->seqidx = seqidx;
       hit->subseq_start = dnasq->start;
 
-      ESL_ALLOC(hit->dcl, sizeof(P7_DOMAIN) );
+      if ((status = p7_tophits_HitAllocDomains(hitlist, hit, 1)) != eslOK) goto ERROR;
       hit->dcl[0] = pli->ddef->dcl[d];
 
       hit->dcl[0].ad->L = 0;     
@@ -2301,15 +2424,12 @@ p7_pli_postDomainDef_Frameshift(P7_PIPELINE *pli, P7_FS_PROFILE *gm_fs, P7_BG *b
     
       hit->frameshift = TRUE;
 	
+      /* target strings are shared by all hits on the same sequence, in the hit list's arena */
       if (pli->mode == p7_SEARCH_SEQS)
       {
-        if (                       (status  = esl_strdup(dnasq->name, -1, &(hit->name)))  != eslOK) ESL_EXCEPTION(eslEMEM, "allocation failure");
-        if (dnasq->acc[0]  != '\0' && (status  = esl_strdup(dnasq->acc,  -1, &(hit->acc)))   != eslOK) ESL_EXCEPTION(eslEMEM, "allocation failure");
-        if (dnasq->desc[0] != '\0' && (status  = esl_strdup(dnasq->desc, -1, &(hit->desc)))  != eslOK) ESL_EXCEPTION(eslEMEM, "allocation failure");
+        if ((status = p7_tophits_HitInternTarget(hitlist, hit, dnasq->name, dnasq->acc, dnasq->desc)) != eslOK) ESL_EXCEPTION(eslEMEM, "allocation failure");
       } else {
-        if ((status  = esl_strdup(gm_fs->name, -1, &(hit->name)))  != eslOK) esl_fatal("allocation failure");
-        if ((status  = esl_strdup(gm_fs->acc,  -1, &(hit->acc)))   != eslOK) esl_fatal("allocation failure");
-        if ((status  = esl_strdup(gm_fs->desc, -1, &(hit->desc)))  != eslOK) esl_fatal("allocation failure");
+        if ((status = p7_tophits_HitSetStrings(hitlist, hit, gm_fs->name, gm_fs->acc, gm_fs->desc))   != eslOK) esl_fatal("allocation failure");
       }
     }
     else  //delete unused P7_ALIDSPLAY and P7_TRACE
@@ -2450,7 +2570,7 @@ p7_pli_postDomainDef_nonFrameshift(P7_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg,
        hit->seqidx = seqidx;
        hit->subseq_start = orfsq->start;
 
-       ESL_ALLOC(hit->dcl, sizeof(P7_DOMAIN) );
+       if ((status = p7_tophits_HitAllocDomains(hitlist, hit, 1)) != eslOK) goto ERROR;
        hit->dcl[0] = pli->ddef->dcl[d];
 
        hit->dcl[0].ad->L = 0;
@@ -2465,9 +2585,12 @@ p7_pli_postDomainDef_nonFrameshift(P7_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg,
 
        hit->sortkey    = pli->inc_by_E ? -dom_lnP : dom_score; // per-seq output sorts on bit score if inclusion is by score
 
-       if (                       (status  = esl_strdup(dnasq->name, -1, &(hit->name)))  != eslOK) ESL_EXCEPTION(eslEMEM, "allocation failure");
-       if (dnasq->acc[0]  != '\0' && (status  = esl_strdup(dnasq->acc,  -1, &(hit->acc)))   != eslOK) ESL_EXCEPTION(eslEMEM, "allocation failure");
-       if (dnasq->desc[0] != '\0' && (status  = esl_strdup(dnasq->desc, -1, &(hit->desc)))  != eslOK) ESL_EXCEPTION(eslEMEM, "allocation failure");
+       if (pli->mode == p7_SEARCH_SEQS)
+       {
+         if ((status = p7_tophits_HitInternTarget(hitlist, hit, dnasq->name, dnasq->acc, dnasq->desc)) != eslOK) ESL_EXCEPTION(eslEMEM, "allocation failure");
+       } else {
+         if ((status = p7_tophits_HitSetStrings(hitlist, hit, om->name, om->acc, om->desc))               != eslOK) ESL_EXCEPTION(eslEMEM, "allocation failure");
+       }
 
      
     } 
@@ -2487,6 +2610,25 @@ ERROR:
   ESL_EXCEPTION(eslEMEM, "Error in nonFrameshift pipeline\n");
 }
 
+/* pli_stage_start(), pli_stage_stop()
+ * Bracket one instrumented stage of the BATH pipeline, for the
+ * hardware counters (--perfctr) and allocation accounting
+ * (--alloctrack). <ncells> is the DP cells the stage computed.
+ */
+static void
+pli_stage_start(P7_PIPELINE *pli, int stage)
+{
+  p7_perfctr_Start(pli->perf, stage);
+  p7_alloctrack_Enter(stage);
+}
+
+static void
+pli_stage_stop(P7_PIPELINE *pli, int stage, int64_t ncells)
+{
+  p7_alloctrack_Leave(stage);
+  p7_perfctr_Stop(pli->perf, stage, ncells);
+}
+
 /* Function:  p7_pli_postViterbi_BATH()
  * Synopsis:  the part of the BATH search Pipeline downstream
  *            of the Viterbi filter
@@ -2553,6 +2695,7 @@ p7_pli_postViterbi_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS
   double           tot_orf_P;                  /* P-value of summed forward score for all ORFs */
   double           min_P_orf;                  /* lowest p-value produced by an ORF */
   double          *P_orf;                      /* list of standard forward P-values for each ORf*/
+  int64_t          fwd_cells = 0;              /* DP cells in the Forward filters, for --perfctr */
 
   pli_tmp->oxf_holder = NULL;
 
@@ -2575,6 +2718,7 @@ p7_pli_postViterbi_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS
  
   P_fs        = eslINFINITY;
   P_fs_nobias = eslINFINITY;
+  pli_stage_start(pli, p7_PERF_FORWARD);
 
   /*If this search is using the frameshift aware pipeline 
    * (user did not specify --nofs) than run Frameshift 
@@ -2586,6 +2730,7 @@ p7_pli_postViterbi_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS
     p7_fs_ReconfigLength(gm_fs, dna_window->length);
 	
     p7_ForwardParser_Frameshift(subseq, gcode, dna_window->length, gm_fs, pli->gxf, &fwdsc_fs);
+    fwd_cells += (int64_t) dna_window->length * gm_fs->M;
     
     seqscore_fs = (fwdsc_fs-filtersc_fs) / eslCONST_LOG2;
     P_fs = esl_exp_surv(seqscore_fs,  gm_fs->evparam[p7_FTAUFS],  gm_fs->evparam[p7_FLAMBDA]);
@@ -2634,6 +2779,7 @@ p7_pli_postViterbi_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS
        p7_oprofile_ReconfigLength(om, curr_orf->n);
        if ((pli_tmp->oxf_holder[f] = p7_omx_Create(om->M, 0, curr_orf->n)) == NULL) goto ERROR ;
        p7_ForwardParser(curr_orf->dsq, curr_orf->n, om, pli_tmp->oxf_holder[f], &fwdsc_orf);
+       fwd_cells += (int64_t) curr_orf->n * om->M;
        
        /* Find the individual p-value (with bias) of each ORF in 
         * the window and store it. Also find the minimum p-value 
@@ -2660,6 +2806,7 @@ p7_pli_postViterbi_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS
     }
     tot_orf_P = esl_exp_surv(tot_orf_sc / eslCONST_LOG2,  om->evparam[p7_FTAU],  om->evparam[p7_FLAMBDA]);
   } 
+  pli_stage_stop(pli, p7_PERF_FORWARD, fwd_cells);
 
   /* Compare Pvalues to select either the standard or the frameshift pipeline
    * If the DNA window passed frameshift forward AND produced a lower P-value 
@@ -2670,6 +2817,7 @@ p7_pli_postViterbi_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS
   if(P_fs <= pli->F3 && (P_fs_nobias < tot_orf_P || min_P_orf > pli->F3)) { 
     
     pli->pos_past_fwd += dna_window->length; 
+    pli_stage_start(pli, p7_PERF_DOMAINDEF);
     p7_gmx_fs_GrowTo(pli->gxb, gm_fs->M, 6, dna_window->length, 0);
     p7_BackwardParser_Frameshift(subseq, gcode, dna_window->length, gm_fs, pli->gxb, NULL);
     p7_bg_SetLength(bg, dna_window->length);
@@ -2677,12 +2825,15 @@ p7_pli_postViterbi_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS
     status = p7_domaindef_ByPosteriorHeuristics_Frameshift(pli_tmp->tmpseq, gm, gm_fs,
            pli->gxf, pli->gxb, pli->gfwd, pli->gbck, pli->ddef, bg, gcode,
            dna_window->n, pli->do_biasfilter);
+    pli_stage_stop(pli, p7_PERF_DOMAINDEF, (int64_t) dna_window->length * gm_fs->M);
     if (status != eslOK) ESL_FAIL(status, pli->errbuf, "domain definition workflow failure"); 
     if (pli->ddef->nregions == 0)  return eslOK; /* score passed threshold but there's no discrete domains here     */
     if (pli->ddef->nenvelopes ==   0)  return eslOK; /* rarer: region was found, stochastic clustered, no envelope found*/
    
     /* Send any hits from the Frameshift aware pipeline to be further processed */ 
+    pli_stage_start(pli, p7_PERF_ALIGN);
     p7_pli_postDomainDef_Frameshift(pli, gm_fs, bg, hitlist, seqidx, dna_window->n, dnasq, complementarity);
+    pli_stage_stop(pli, p7_PERF_ALIGN, 0);
 
   } 
 
@@ -2706,18 +2857,22 @@ p7_pli_postViterbi_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS
       /* Ensure current ORF is within the current window and that it passed  the Forward filter */
       if(orf_start >= window_start && orf_end <= window_end && P_orf[f] <= pli->F3) { 
         pli->pos_past_fwd += curr_orf->n * 3;
+        pli_stage_start(pli, p7_PERF_DOMAINDEF);
         p7_oprofile_ReconfigLength(om, curr_orf->n);
         p7_omx_GrowTo(pli->oxb, om->M, 0, curr_orf->n);     
         
         p7_BackwardParser(curr_orf->dsq, curr_orf->n, om, pli_tmp->oxf_holder[f], pli->oxb, NULL);
         
         status = p7_domaindef_ByPosteriorHeuristics_nonFrameshift(curr_orf, pli_tmp->tmpseq, dnasq->n, gcode, om, gm, gm_fs, pli_tmp->oxf_holder[f], pli->oxf, pli->oxb, pli->ddef, bg);
+        pli_stage_stop(pli, p7_PERF_DOMAINDEF, (int64_t) curr_orf->n * om->M);
         if (status != eslOK) ESL_FAIL(status, pli->errbuf, "domain definition workflow failure"); /* eslERANGE can happen */
         if (pli->ddef->nregions   == 0)  continue; /* score passed threshold but there's no discrete domains here     */
         if (pli->ddef->nenvelopes == 0)  continue; /* rarer: region was found, stochastic clustered, no envelope found*/
         
         /* Send any hits from the standard pipeline to be further processed */   
+        pli_stage_start(pli, p7_PERF_ALIGN);
         p7_pli_postDomainDef_nonFrameshift(pli, om, bg, hitlist, seqidx, dna_window->n, curr_orf, dnasq, complementarity, nullsc_orf);
+        pli_stage_stop(pli, p7_PERF_ALIGN, 0);
       }
     }  
   } 
@@ -2750,77 +2905,76 @@ ERROR:
 
 }
 
-/* Function:  p7_Pipeline_BATH()
- * Synopsis:  Sequence to profile comparison pipeline for 
- *            frameshift aware translated search - bathsearch.
- *
- * Purpose:   Run translated search pipeline to compare a protien 
- *            profile <gm/om> against a DNA sequence <sq>. For the 
- *            first stages of the pipeline (MSV, bias and viterbi 
- *            filters) each DNA strand is translated into ORFs in 
- *            all 3 frames and these are compared directly to an 
- *            optimized protien profile <om>. For the forward filter
- *            both an ORF to <om> and a DNA window to frameshift 
- *            aware codon model <gm_fs> and a comparison is preformed. 
- *            Which ever Forward filter produces the lower p-value  
- *            determines which target and query form are used for the 
- *            remainder of the pipeline. If a significant hit is 
- *            found, information about it is added to the <hitlist>. 
- *            The pipeline accumulates bean-counting information about 
- *            how many comparisons flow through the pipeline while it's 
- *            active.
- *            
- * Returns:   <eslOK> on success. If a significant hit is obtained,
- *            its information is added to the growing <hitlist>. 
- *            
- *            <eslEINVAL> if (in a scan pipeline) we're supposed to
- *            set GA/TC/NC bit score thresholds but the model doesn't
- *            have any.
- *            
- *            <eslERANGE> on numerical overflow errors in the
- *            optimized vector implementations; particularly in
- *            posterior decoding. I don't believe this is possible for
- *            multihit local models, but I'm set up to catch it
- *            anyway. We may emit a warning to the user, but cleanly
- *            skip the problematic sequence and continue.
- * 
- * Args:      pli             - the main pipeline object
- *            om              - optimized protein profile (query)
- *            gm              - generic protein profile (query)
- *            gm_fs           - generic fs-aware codon profile (query)
- *            data            - for picking window edges based on 
- *                              maximum prefix/suffix extensions
- *            bg              - background model
- *            hitlist         - pointer to hit storage bin (already 
- *                              allocated)
- *            seqidx          - the id # of the sequence from which 
- *                              the current window was extracted
- *            dnasq           - digital sequence of the DNA window
- *            orf_block       - collection of ORFs translated form <dnasq>
- *            wrk             - codon translation workstate
- *            gcode           - genetic code information for codon translation
- *            complementarity - is <sq> from the top strand 
- *                        (p7_NOCOMPLEMENT), or bottom strand 
- *                        (P7_COMPLEMENT)
- *
- * Throws:    <eslEMEM> on allocation failure.
- *
- * Xref:      J4/25.
+/* bath_orf_filters()
+ * Run the MSV, bias and Viterbi filters on one ORF, as p7_Pipeline_BATH()
+ * does, and return how many of them it passed (0..3); 3 means the ORF
+ * goes on to the Forward stage. -1 means it has no word of the seed
+ * index and wasn't filtered at all; the caller counts that in
+ * <pli->seed_norfs>, as it counts masked ORFs.
  */
-int
-p7_Pipeline_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS_PROFILE *gm_fs, P7_SCOREDATA *data, P7_BG *bg, P7_TOPHITS *hitlist, int64_t seqidx, ESL_SQ *dnasq, ESL_SQ_BLOCK *orf_block, ESL_GENCODE_WORKSTATE *wrk, ESL_GENCODE *gcode, int complementarity)
+static int
+bath_orf_filters(P7_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, const ESL_SQ *orfsq)
+{
+  float   nullsc;      /* null model score           */
+  float   usc;         /* msv score                  */
+  float   vfsc;        /* viterbi score              */
+  float   filtersc;    /* bias and null score        */
+  float   seq_score;   /* null corrected bit score   */
+  double  P;           /* p-value holder             */
+
+  /* no seed word, no MSV */
+  if (pli->seeds != NULL && ! p7_seedindex_Hit(pli->seeds, orfsq->dsq, orfsq->n)) return -1;
+
+  p7_bg_SetLength(bg, orfsq->n);
+  p7_oprofile_ReconfigLength(om, orfsq->n);
+  p7_bg_NullOne  (bg, orfsq->dsq, orfsq->n, &nullsc);
+
+  p7_omx_GrowTo(pli->oxf, om->M, 0, orfsq->n);    /* expand the one-row omx if needed */
+
+  /* MSV Filter on ORF */
+  p7_MSVFilter(orfsq->dsq, orfsq->n, om, pli->oxf, &usc);
+  seq_score = (usc - nullsc) / eslCONST_LOG2;
+  P = esl_gumbel_surv( seq_score,  om->evparam[p7_MMU],  om->evparam[p7_MLAMBDA]);
+  if (P > pli->F1) return 0;
+
+  /* biased composition HMM filtering */
+  if (pli->do_biasfilter)
+  {
+    p7_bg_FilterScore(bg, orfsq->dsq, orfsq->n, &filtersc);
+
+    seq_score = (usc - filtersc) / eslCONST_LOG2;
+    P = esl_gumbel_surv(seq_score,  om->evparam[p7_MMU],  om->evparam[p7_MLAMBDA]);
+    if (P > pli->F1) return 1;
+  }  else filtersc = nullsc;
+
+  /* Viterbi filer on ORF */
+  if (P > pli->F2)
+  {
+    p7_ViterbiFilter(orfsq->dsq, orfsq->n, om, pli->oxf, &vfsc);
+    seq_score = (vfsc-filtersc) / eslCONST_LOG2;
+    P  = esl_gumbel_surv(seq_score,  om->evparam[p7_VMU],  om->evparam[p7_VLAMBDA]);
+    if (P > pli->F2) return 2;
+  }
+  return 3;
+}
+
+/* bath_pipeline()
+ * The body of p7_Pipeline_BATH(). The first <nknown> ORFs of
+ * <orf_block> have already been through bath_orf_filters(), by
+ * p7_Pipeline_BATH_Batch()'s prescreen, which passed on the result
+ * for each in <orf_npass>; those aren't filtered again.
+ */
+static int
+bath_pipeline(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS_PROFILE *gm_fs, P7_SCOREDATA *data, P7_BG *bg, P7_TOPHITS *hitlist, int64_t seqidx, ESL_SQ *dnasq, ESL_SQ_BLOCK *orf_block, ESL_GENCODE_WORKSTATE *wrk, ESL_GENCODE *gcode, int complementarity,
+              const int *orf_npass, int nknown)
 {
 
   int                i;
   int                status, wstatus;
-  float              nullsc;              /* null model score                        */
-  float              usc;                 /* msv score                               */
-  float              vfsc;                /* viterbi score                           */
-  float              seq_score;           /* null corrected bit score                */
-  float              filtersc;            /* bias and null score                     */
-  double             P;                   /* p-value holder                          */
+  int                npass;               /* number of ORF filters passed            */
   int                window_len;          /* length of DNA window                    */
   int                min_length;          /* minimum number of nucs passing a filter */
+  int64_t            filter_cells = 0;    /* DP cells in the ORF filters, for --perfctr */
   int32_t           *k_coords_list, *m_coords_list; /* ORF Viterbi trace HMM coords            */
   ESL_SQ            *orfsq;               /* ORF sequence                            */
   ESL_SQ_BLOCK      *post_vit_orf_block;  /* block of ORFs that pass viterbi         */
@@ -2846,6 +3000,7 @@ p7_Pipeline_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS_PROFIL
   ESL_ALLOC(pli_tmp, sizeof(P7_PIPELINE_BATH_OBJS));
   pli_tmp->tmpseq = NULL;
 
+  pli_stage_start(pli, p7_PERF_FILTERS);
   ESL_ALLOC(msv_coords, sizeof(P7_ORF_COORDS));
   ESL_ALLOC(msv_coords->orf_starts, sizeof(int64_t) *  orf_block->count);
   ESL_ALLOC(msv_coords->orf_ends, sizeof(int64_t) *  orf_block->count);
@@ -2874,46 +3029,28 @@ p7_Pipeline_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS_PROFIL
     if ((wstatus = esl_sq_SetAccession(orfsq, dnasq->acc))    != eslOK)  ESL_EXCEPTION_SYS(eslEWRITE, "Set query sequence accession failed");
     if ((wstatus = esl_sq_SetDesc     (orfsq, dnasq->desc))   != eslOK)  ESL_EXCEPTION_SYS(eslEWRITE, "Set query sequence description failed");
     
+    /* an ORF that is mostly masked low-complexity sequence can't carry a real hit; don't filter it */
+    if (pli->do_tmask && p7_tmask_MaskedFraction(orfsq) >= p7_TMASK_ORFFRAC) { pli->tmask_norfs++; continue; }
+
     if(orfsq->n > 0) 
     {
-      p7_bg_SetLength(bg, orfsq->n);
-      p7_oprofile_ReconfigLength(om, orfsq->n);
-      p7_bg_NullOne  (bg, orfsq->dsq, orfsq->n, &nullsc);
-	
-      p7_omx_GrowTo(pli->oxf, om->M, 0, orfsq->n);    /* expand the one-row omx if needed */
-	
-      /* MSV Filter on ORF */
-      p7_MSVFilter(orfsq->dsq, orfsq->n, om, pli->oxf, &usc);
-      seq_score = (usc - nullsc) / eslCONST_LOG2;
-      P = esl_gumbel_surv( seq_score,  om->evparam[p7_MMU],  om->evparam[p7_MLAMBDA]);
-      if (P > pli->F1 ) continue;    
+      if (i < nknown) npass = orf_npass[i];
+      else {
+        npass = bath_orf_filters(pli, om, bg, orfsq);
+        if (npass >= 0) filter_cells += (int64_t) orfsq->n * om->M;
+      }
+      if (npass < 0) { pli->seed_norfs++; continue; }
+      if (npass < 1) continue;
     
       msv_coords->orf_starts[msv_coords->orf_cnt] = ESL_MIN(orfsq->start, orfsq->end);
       msv_coords->orf_ends[msv_coords->orf_cnt] =   ESL_MAX(orfsq->start, orfsq->end);
       msv_coords->orf_cnt++;
+      if (npass < 2) continue;
        
-      /* biased composition HMM filtering */
-      if (pli->do_biasfilter)
-      {
-        p7_bg_FilterScore(bg, orfsq->dsq, orfsq->n, &filtersc);
-
-        seq_score = (usc - filtersc) / eslCONST_LOG2;
-        P = esl_gumbel_surv(seq_score,  om->evparam[p7_MMU],  om->evparam[p7_MLAMBDA]);
-        if (P > pli->F1) continue;
-      }  else filtersc = nullsc;
-      
       bias_coords->orf_starts[bias_coords->orf_cnt] = ESL_MIN(orfsq->start, orfsq->end);
       bias_coords->orf_ends[bias_coords->orf_cnt] =   ESL_MAX(orfsq->start, orfsq->end);
       bias_coords->orf_cnt++;
-
-      /* Viterbi filer on ORF */
-      if (P > pli->F2)
-      {
-        p7_ViterbiFilter(orfsq->dsq, orfsq->n, om, pli->oxf, &vfsc);
-        seq_score = (vfsc-filtersc) / eslCONST_LOG2;
-        P  = esl_gumbel_surv(seq_score,  om->evparam[p7_VMU],  om->evparam[p7_VLAMBDA]);
-        if (P > pli->F2) continue;
-      }
+      if (npass < 3) continue;
       
       vit_coords->orf_starts[vit_coords->orf_cnt] = ESL_MIN(orfsq->start, orfsq->end);
       vit_coords->orf_ends[vit_coords->orf_cnt] =   ESL_MAX(orfsq->start, orfsq->end);
@@ -2924,13 +3061,14 @@ p7_Pipeline_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS_PROFIL
       post_vit_orf_block->count++;
     }
   }
+  pli_stage_stop(pli, p7_PERF_FILTERS, filter_cells);
 
   min_length = ESL_MIN(dnasq->n, om->max_length * 3);
   pli->pos_past_msv += ESL_MAX(p7_pli_fs_GetPosPast(msv_coords), min_length);
   pli->pos_past_bias += ESL_MAX(p7_pli_fs_GetPosPast(bias_coords), min_length);
   pli->pos_past_vit += ESL_MAX(p7_pli_fs_GetPosPast(vit_coords), min_length);
 
-  if (data->prefix_lengths == NULL)  //otherwise, already filled in
+  if (data->fwd_scores == NULL)  //otherwise, already filled in
     p7_hmm_ScoreDataComputeRest(om, data);
 
   /* convert block of ORFs that passed Viterbi into collection of non-overlapping DNA windows */
@@ -3023,6 +3161,352 @@ ERROR:
   return status;
 }
 
+/* Function:  p7_Pipeline_BATH()
+ * Synopsis:  Sequence to profile comparison pipeline for 
+ *            frameshift aware translated search - bathsearch.
+ *
+ * Purpose:   Run translated search pipeline to compare a protien 
+ *            profile <gm/om> against a DNA sequence <sq>. For the 
+ *            first stages of the pipeline (MSV, bias and viterbi 
+ *            filters) each DNA strand is translated into ORFs in 
+ *            all 3 frames and these are compared directly to an 
+ *            optimized protien profile <om>. For the forward filter
+ *            both an ORF to <om> and a DNA window to frameshift 
+ *            aware codon model <gm_fs> and a comparison is preformed. 
+ *            Which ever Forward filter produces the lower p-value  
+ *            determines which target and query form are used for the 
+ *            remainder of the pipeline. If a significant hit is 
+ *            found, information about it is added to the <hitlist>. 
+ *            The pipeline accumulates bean-counting information about 
+ *            how many comparisons flow through the pipeline while it's 
+ *            active.
+ *            
+ * Returns:   <eslOK> on success. If a significant hit is obtained,
+ *            its information is added to the growing <hitlist>. 
+ *            
+ *            <eslEINVAL> if (in a scan pipeline) we're supposed to
+ *            set GA/TC/NC bit score thresholds but the model doesn't
+ *            have any.
+ *            
+ *            <eslERANGE> on numerical overflow errors in the
+ *            optimized vector implementations; particularly in
+ *            posterior decoding. I don't believe this is possible for
+ *            multihit local models, but I'm set up to catch it
+ *            anyway. We may emit a warning to the user, but cleanly
+ *            skip the problematic sequence and continue.
+ * 
+ * Args:      pli             - the main pipeline object
+ *            om              - optimized protein profile (query)
+ *            gm              - generic protein profile (query)
+ *            gm_fs           - generic fs-aware codon profile (query)
+ *            data            - for picking window edges based on 
+ *                              maximum prefix/suffix extensions
+ *            bg              - background model
+ *            hitlist         - pointer to hit storage bin (already 
+ *                              allocated)
+ *            seqidx          - the id # of the sequence from which 
+ *                              the current window was extracted
+ *            dnasq           - digital sequence of the DNA window
+ *            orf_block       - collection of ORFs translated form <dnasq>
+ *            wrk             - codon translation workstate
+ *            gcode           - genetic code information for codon translation
+ *            complementarity - is <sq> from the top strand 
+ *                        (p7_NOCOMPLEMENT), or bottom strand 
+ *                        (P7_COMPLEMENT)
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ *
+ * Xref:      J4/25.
+ */
+int
+p7_Pipeline_BATH(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS_PROFILE *gm_fs, P7_SCOREDATA *data, P7_BG *bg, P7_TOPHITS *hitlist, int64_t seqidx, ESL_SQ *dnasq, ESL_SQ_BLOCK *orf_block, ESL_GENCODE_WORKSTATE *wrk, ESL_GENCODE *gcode, int complementarity)
+{
+  return bath_pipeline(pli, om, gm, gm_fs, data, bg, hitlist, seqidx, dnasq, orf_block, wrk, gcode, complementarity, NULL, 0);
+}
+
+/* Function:  p7_Pipeline_BATH_Batch()
+ * Synopsis:  Run the bathsearch pipeline on a block of short targets.
+ *
+ * Purpose:   Search every sequence in <dnablock> (both strands, or the
+ *            one selected by <pli->strands>) with the query, exactly
+ *            as calling <p7_Pipeline_BATH()> once per sequence and
+ *            strand would, but cheaply for blocks of many short
+ *            targets (metagenomic reads, small contigs).
+ *
+ *            For a target of at most <p7_SHORTREAD_MAXLEN> residues,
+ *            the ORFs of each strand are first run through the MSV,
+ *            bias and Viterbi filters here, with no per-target
+ *            allocation. Only a strand with an ORF that survives
+ *            Viterbi goes on to the full pipeline, which builds its
+ *            DNA windows and runs the Forward stages, taking the
+ *            prescreen's results for the ORFs up to the survivor
+ *            rather than filtering them again; for all others
+ *            (nearly all of a read set) the filter accounting is
+ *            updated directly. Longer targets go straight to
+ *            <p7_Pipeline_BATH()>. The hit list and the accounting
+ *            come out the same either way.
+ *
+ *            If target masking is on, the caller masks the block's
+ *            sequences first with <p7_pli_MaskTarget()>, once however
+ *            many genetic codes it searches them with. Residues are
+ *            counted in <pli->nres>; translation uses <wrk1>, and
+ *            <wrk2> is passed on for the Forward stages. Hits are indexed by each sequence's <idx>, so the
+ *            block needn't hold consecutive database sequences.
+ *
+ * Returns:   <eslOK> on success; hits are added to <hitlist>.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_Pipeline_BATH_Batch(P7_PIPELINE *pli, P7_OPROFILE *om, P7_PROFILE *gm, P7_FS_PROFILE *gm_fs, P7_SCOREDATA *data, P7_BG *bg, P7_TOPHITS *hitlist,
+                       ESL_SQ_BLOCK *dnablock, ESL_GENCODE_WORKSTATE *wrk1, ESL_GENCODE_WORKSTATE *wrk2, ESL_GENCODE *gcode)
+{
+  P7_ORF_COORDS  coords[3];    /* DNA spans of ORFs passing MSV, bias, Viterbi, for one strand */
+  int           *orf_npass = NULL; /* filters passed by each prefiltered ORF                  */
+  int            nknown;       /* ORFs prefiltered, passed on to bath_pipeline()              */
+  int            nalloc = 0;   /* allocated size of each coords[] list and orf_npass          */
+  ESL_SQ_BLOCK  *orf_block = wrk1->orf_block;
+  ESL_SQ        *dnasq;
+  ESL_SQ        *orfsq;
+  int64_t        min_length;
+  int            nmasked;      /* ORFs skipped as masked, on this strand                     */
+  int            nseedless;    /* ORFs skipped for want of a seed word, on this strand       */
+  int64_t        filter_cells; /* DP cells in the ORF filters, for --perfctr                 */
+  int            survivor;     /* TRUE if an ORF on this strand passed Viterbi               */
+  int            i, j, k, s;
+  int            npass;
+  int            status;
+
+  for (k = 0; k < 3; k++) { coords[k].orf_starts = NULL; coords[k].orf_ends = NULL; coords[k].orf_cnt = 0; }
+
+  for (i = 0; i < dnablock->count; i++)
+  {
+    dnasq    = dnablock->list + i;
+    dnasq->L = dnasq->n; /* L is the length of the active window, as esl_gencode expects */
+
+    for (s = 0; s < 2; s++)
+    {
+      if (s == 0 && pli->strands == p7_STRAND_BOTTOMONLY) continue;
+      if (s == 1 && pli->strands == p7_STRAND_TOPONLY)    continue;
+
+      pli->nres += dnasq->n;
+      if (s == 1) esl_sq_ReverseComplement(dnasq);
+
+      esl_gencode_ProcessStart(gcode, wrk1, dnasq);
+      esl_gencode_ProcessPiece(gcode, wrk1, dnasq);
+      esl_gencode_ProcessEnd(wrk1, dnasq);
+
+      if (dnasq->n >= 15 && orf_block->count > 0)
+      {
+        survivor = TRUE;
+        nknown   = 0;
+        if (dnasq->n <= p7_SHORTREAD_MAXLEN)
+        {
+          if (orf_block->count > nalloc) {
+            for (k = 0; k < 3; k++) {
+              ESL_REALLOC(coords[k].orf_starts, sizeof(int64_t) * orf_block->count);
+              ESL_REALLOC(coords[k].orf_ends,   sizeof(int64_t) * orf_block->count);
+            }
+            ESL_REALLOC(orf_npass, sizeof(int) * orf_block->count);
+            nalloc = orf_block->count;
+          }
+          for (k = 0; k < 3; k++) coords[k].orf_cnt = 0;
+
+          survivor     = FALSE;
+          nmasked      = 0;
+          nseedless    = 0;
+          filter_cells = 0;
+          pli_stage_start(pli, p7_PERF_FILTERS);
+          for (j = 0; j < orf_block->count && ! survivor; j++)
+          {
+            orfsq = &(orf_block->list[j]);
+            if (   (orfsq->start < orfsq->end    &&  orfsq->end < dnasq->C )  ||
+                   (orfsq->end < orfsq->start    &&  orfsq->start < dnasq->C ) )
+              continue;
+            if (pli->do_tmask && p7_tmask_MaskedFraction(orfsq) >= p7_TMASK_ORFFRAC) { nmasked++; continue; }
+            if (orfsq->n == 0) continue;
+
+            npass = orf_npass[j] = bath_orf_filters(pli, om, bg, orfsq);
+            if (npass < 0) { nseedless++; continue; }
+            filter_cells += (int64_t) orfsq->n * om->M;
+            for (k = 0; k < npass; k++) {
+              coords[k].orf_starts[coords[k].orf_cnt] = ESL_MIN(orfsq->start, orfsq->end);
+              coords[k].orf_ends[coords[k].orf_cnt]   = ESL_MAX(orfsq->start, orfsq->end);
+              coords[k].orf_cnt++;
+            }
+            if (npass == 3) survivor = TRUE;
+          }
+          pli_stage_stop(pli, p7_PERF_FILTERS, filter_cells);
+          nknown = j;  /* ORFs 0..j-1 are filtered; j-1 is the survivor, if any */
+
+          if (! survivor)
+          { /* the same accounting p7_Pipeline_BATH() would have done */
+            min_length = ESL_MIN(dnasq->n, om->max_length * 3);
+            pli->pos_past_msv  += ESL_MAX(p7_pli_fs_GetPosPast(&coords[0]), min_length);
+            pli->pos_past_bias += ESL_MAX(p7_pli_fs_GetPosPast(&coords[1]), min_length);
+            pli->pos_past_vit  += ESL_MAX(p7_pli_fs_GetPosPast(&coords[2]), min_length);
+            pli->tmask_norfs   += nmasked;
+            pli->seed_norfs    += nseedless;
+          }
+        }
+
+        if (survivor)
+        {
+          if ((status = bath_pipeline(pli, om, gm, gm_fs, data, bg, hitlist, dnasq->idx, dnasq, orf_block, wrk2, gcode,
+                                      (s == 0 ? p7_NOCOMPLEMENT : p7_COMPLEMENT), orf_npass, nknown)) != eslOK) goto ERROR;
+          p7_pipeline_fs_Reuse(pli);
+        }
+      }
+
+      esl_sq_ReuseBlock(orf_block);
+      if (s == 1) esl_sq_ReverseComplement(dnasq);
+    }
+  }
+
+  for (k = 0; k < 3; k++) { free(coords[k].orf_starts); free(coords[k].orf_ends); }
+  free(orf_npass);
+  return eslOK;
+
+ ERROR:
+  for (k = 0; k < 3; k++) { if (coords[k].orf_starts) free(coords[k].orf_starts); if (coords[k].orf_ends) free(coords[k].orf_ends); }
+  if (orf_npass) free(orf_npass);
+  return status;
+}
+
+/* Function:  p7_pli_BATH_Prescreen()
+ * Synopsis:  Does any ORF of a DNA window pass the filters?
+ *
+ * Purpose:   Translate <dnasq> (both strands, or the one selected by
+ *            <pli->strands>) into ORFs with <gcode> and <wrk>, and run
+ *            the ORFs through the MSV, bias and Viterbi filters with
+ *            the thresholds in <pli>, stopping at the first one that
+ *            passes all three. Set <*ret_pass> TRUE if one does,
+ *            FALSE if none does. ORFs are skipped exactly as
+ *            <p7_Pipeline_BATH()> would skip them: those wholly in the
+ *            window's leading context, and mostly masked ones.
+ *
+ *            Nothing is aligned and no hits are made; only
+ *            <pli->nres> is counted. bathsearch --clusters uses this to
+ *            screen the target database with a cluster's
+ *            representative profile.
+ *
+ *            <dnasq> is returned in its original orientation.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_pli_BATH_Prescreen(P7_PIPELINE *pli, P7_OPROFILE *om, P7_BG *bg, ESL_SQ *dnasq, ESL_GENCODE_WORKSTATE *wrk, ESL_GENCODE *gcode, int *ret_pass)
+{
+  ESL_SQ_BLOCK *orf_block = wrk->orf_block;
+  ESL_SQ       *orfsq;
+  int           pass = FALSE;
+  int           j, s;
+
+  dnasq->L = dnasq->n;
+  for (s = 0; s < 2; s++)
+  {
+    if (s == 0 && pli->strands == p7_STRAND_BOTTOMONLY) continue;
+    if (s == 1 && pli->strands == p7_STRAND_TOPONLY)    continue;
+
+    pli->nres += dnasq->n;
+    if (pass || dnasq->n < 15) continue;   /* keep counting residues, but one survivor is enough */
+
+    if (s == 1) esl_sq_ReverseComplement(dnasq);
+    esl_gencode_ProcessStart(gcode, wrk, dnasq);
+    esl_gencode_ProcessPiece(gcode, wrk, dnasq);
+    esl_gencode_ProcessEnd(wrk, dnasq);
+
+    for (j = 0; j < orf_block->count && ! pass; j++)
+    {
+      orfsq = &(orf_block->list[j]);
+      if (   (orfsq->start < orfsq->end    &&  orfsq->end < dnasq->C )  ||
+             (orfsq->end < orfsq->start    &&  orfsq->start < dnasq->C ) )
+        continue;
+      if (pli->do_tmask && p7_tmask_MaskedFraction(orfsq) >= p7_TMASK_ORFFRAC) continue;
+      if (orfsq->n == 0) continue;
+
+      if (bath_orf_filters(pli, om, bg, orfsq) == 3) pass = TRUE;
+    }
+
+    esl_sq_ReuseBlock(orf_block);
+    if (s == 1) esl_sq_ReverseComplement(dnasq);
+  }
+
+  *ret_pass = pass;
+  return eslOK;
+}
+
+/* Function:  p7_pli_BATH_MSVPacked()
+ * Synopsis:  Packed MSV filter stage for a group of small models.
+ *
+ * Purpose:   Score every ORF of <orf_block> against the models packed
+ *            in <mp> with <p7_MSVFilter_packedBlock()> and threshold
+ *            <pli->F1>, setting <pass[b * mp->nmodel + m]> as that
+ *            function does. The call is bracketed as the filter stage
+ *            for --perfctr, counting the cells of every packed model
+ *            against every ORF, so that the MSV work of models that
+ *            then go to <p7_pli_BATH_MSVSkip()> is still counted.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_pli_BATH_MSVPacked(P7_PIPELINE *pli, const ESL_SQ_BLOCK *orf_block, P7_MSVPACK *mp, P7_BG *bg, int *pass)
+{
+  int64_t cells = 0;
+  int64_t Msum  = 0;
+  int     b, m;
+  int     status;
+
+  for (m = 0; m < mp->nmodel; m++) Msum += mp->om[m]->M;
+  for (b = 0; b < orf_block->count; b++) cells += (int64_t) orf_block->list[b].n * Msum;
+
+  pli_stage_start(pli, p7_PERF_FILTERS);
+  status = p7_MSVFilter_packedBlock(orf_block, mp, bg, pli->F1, pass, NULL);
+  pli_stage_stop(pli, p7_PERF_FILTERS, cells);
+  return status;
+}
+
+/* Function:  p7_pli_BATH_MSVSkip()
+ * Synopsis:  Account for a strand whose ORFs all fail MSV.
+ *
+ * Purpose:   Update the accounting in <pli> exactly as
+ *            <p7_Pipeline_BATH()> would for DNA window <dnasq>, its
+ *            ORFs <orf_block> and model <om>, when no ORF passes the
+ *            MSV filter; nothing further happens in that case, so a
+ *            caller that has already scored the ORFs (several models
+ *            at once, with <p7_pli_BATH_MSVPacked()>) can skip the
+ *            call. The MSV stage's --perfctr time and cells are
+ *            counted there, not here. Only valid without a seed index,
+ *            which would have counted its misses instead.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_pli_BATH_MSVSkip(P7_PIPELINE *pli, const P7_OPROFILE *om, const ESL_SQ *dnasq, const ESL_SQ_BLOCK *orf_block)
+{
+  ESL_SQ  *orfsq;
+  int64_t  min_length;
+  int      i;
+
+  if (dnasq->n < 15 || orf_block->count == 0) return eslOK;
+
+  if (pli->do_tmask)
+    for (i = 0; i < orf_block->count; i++)
+    {
+      orfsq = &(orf_block->list[i]);
+      if (   (orfsq->start < orfsq->end    &&  orfsq->end < dnasq->C )  ||
+             (orfsq->end < orfsq->start    &&  orfsq->start < dnasq->C ) )
+        continue;
+      if (p7_tmask_MaskedFraction(orfsq) >= p7_TMASK_ORFFRAC) pli->tmask_norfs++;
+    }
+
+  min_length = ESL_MIN(dnasq->n, om->max_length * 3);
+  pli->pos_past_msv  += min_length;
+  pli->pos_past_bias += min_length;
+  pli->pos_past_vit  += min_length;
+  return eslOK;
+}
+
 /* Function:  p7_pli_Statistics()
  * Synopsis:  Final statistics output from a processing pipeline.
  *
@@ -3052,6 +3536,17 @@ p7_pli_Statistics(FILE *ofp, P7_PIPELINE *pli, ESL_STOPWATCH *w)
     ntargets = pli->nmodels;
   }
 
+  if (pli->do_tmask) {
+    fprintf(ofp, "Target residues masked:      %15" PRId64 "  (%.3g)\n",
+        pli->tmask_nres,
+        (pli->nres > 0 ? (double) pli->tmask_nres / pli->nres : 0.));
+    fprintf(ofp, "ORFs skipped as masked:      %15" PRId64 "\n", pli->tmask_norfs);
+    if (pli->tmaskdb == NULL)
+      fprintf(ofp, "Masking time:                %15.2fs\n", pli->tmask_time);
+  }
+  if (pli->seeds != NULL)
+    fprintf(ofp, "ORFs without a k-mer seed:   %15" PRId64 "\n", pli->seed_norfs);
+
   if (pli->long_targets || pli->frameshift) { // nhmmer style
     fprintf(ofp, "Residues passing SSV filter: %15" PRId64 "  (%.3g); expected (%.3g)\n",
         pli->pos_past_msv,
@@ -3107,6 +3602,8 @@ p7_pli_Statistics(FILE *ofp, P7_PIPELINE *pli, ESL_STOPWATCH *w)
     fprintf(ofp, "Domain search space  (domZ): %15.0f  %s\n", pli->domZ, pli->domZ_setby == p7_ZSETBY_OPTION ? "[as set by --domZ on cmdline]" : "[number of targets reported over threshold]");
   }
 
+  if (pli->perf != NULL) p7_perfctr_Report(ofp, pli->perf);
+
   if (w != NULL) {
     esl_stopwatch_Display(ofp, w, "# CPU time: ");
     fprintf(ofp, "# Mc/sec: %.2f\n", 
@@ -116,6 +116,48 @@ ERROR:
 }
 
 
+/* scoredata_GetWindowLengths()
+ *
+ * Elsewhere, we compute the MAXL of a given model, which is the length L
+ * such that only a minute fraction (BETA = 1e-7) of emitted sequence are length > L.
+ *
+ * In the DNA search pipeline, when a high-scoring SSV alignment is identified,
+ * we extract a window around that seed. The length of the window is based on
+ * MAXL, but we need to figure out how much the window should precede the seed
+ * (the prefix of the window) and how much should follow the seed (the suffix).
+ * p7_lengthdist_WindowLengths() estimates each position's share of MAXL from its
+ * insert rates; here we just pull those rates out of the striped <om>.
+ *
+ * Done once when the <P7_SCOREDATA> is created, so that clones handed to
+ * worker threads carry the result instead of each recomputing it.
+ */
+static int
+scoredata_GetWindowLengths(P7_OPROFILE *om, P7_SCOREDATA *data)
+{
+  float *t_mis = NULL;
+  float *t_iis = NULL;
+  int    status;
+
+  ESL_ALLOC(t_mis,                (om->M+1) * sizeof(float));
+  ESL_ALLOC(t_iis,                (om->M+1) * sizeof(float));
+  ESL_ALLOC(data->prefix_lengths, (om->M+1) * sizeof(float));
+  ESL_ALLOC(data->suffix_lengths, (om->M+1) * sizeof(float));
+  p7_oprofile_GetFwdTransitionArray(om, p7O_MI, t_mis);
+  p7_oprofile_GetFwdTransitionArray(om, p7O_II, t_iis);
+
+  p7_lengthdist_WindowLengths(t_mis, t_iis, om->M, p7_DEFAULT_WINDOW_BETA, data->prefix_lengths, data->suffix_lengths);
+
+  free(t_mis);
+  free(t_iis);
+  return eslOK;
+
+ ERROR:
+  if (t_mis) free(t_mis);
+  if (t_iis) free(t_iis);
+  return status;
+}
+
+
 /* Function:  p7_hmm_ScoreDataDestroy()
  *
  * Synopsis:  Destroy a <P7_SCOREDATA> object.
@@ -160,8 +202,9 @@ p7_hmm_ScoreDataDestroy(P7_SCOREDATA *data )
  * Purpose:   Allocate a <P7_SCOREDATA> object, then populate
  *            it with data based on the given optimized matrix.
  *
- *            Once a hit passes the MSV filter, and the prefix/suffix
- *            values of P7_SCOREDATA are required, p7_hmm_ScoreDataComputeRest()
+ *            The MAXL-based window prefix/suffix lengths are computed
+ *            here too. Once a hit passes the MSV filter, and the Forward
+ *            arrays of P7_SCOREDATA are required, p7_hmm_ScoreDataComputeRest()
  *            must be called.
  *
  * Args:      om         - P7_OPROFILE containing scores used to produce SCOREDATA contents
@@ -189,6 +232,7 @@ p7_hmm_ScoreDataCreate(P7_OPROFILE *om, P7_PROFILE *gm )
   data->fwd_transitions = NULL;
 
   scoredata_GetSSVScoreArrays(om, gm, data);
+  if (scoredata_GetWindowLengths(om, data) != eslOK) goto ERROR;
 
   return data;
 
@@ -288,20 +332,17 @@ ERROR:
 }
 
 /* Function:  p7_hmm_ScoreDataComputeRest()
- * Synopsis:  Using position-specific insert rates, compute MAXL-based prefix and suffix lengths
+ * Synopsis:  Fill in the Forward emission and transition arrays
  *
- * Purpose:   Using position-specific insert rates, compute MAXL-based prefix
- *            and suffix lengths for each position in the model, used when
- *            establishing windows around SSV diagonals. This fleshes out
+ * Purpose:   Extract flat Forward emission scores and transition
+ *            probabilities from <om>, used by the long-target pipeline
+ *            once a window has passed the SSV filter. This fleshes out
  *            the <P7_SCOREDATA> model object that was created by
  *            p7_hmmScoreDataCreate().
  *
- *            This approach of computing the prefix/suffix length, used
- *            in establishing windows around a seed diagonal, is fast
- *            because it uses a simple closed-form computation of the
- *            length L_i for each position i at which all but
- *            (1-p7_DEFAULT_WINDOW_BETA) of position i's match- and
- *            insert-state emissions are length L_i or shorter.
+ *            The MAXL-based prefix and suffix lengths are already set
+ *            by p7_hmm_ScoreDataCreate(); they're only computed here
+ *            if they're missing.
  *
  * Args:      om         - P7_OPROFILE containing emission/transition probabilities used to for calculations
  *            data       - P7_SCOREDATA into which the computed values are placed
@@ -315,9 +356,6 @@ p7_hmm_ScoreDataComputeRest(P7_OPROFILE *om, P7_SCOREDATA *data )
 {
   int    status;
   int k;
-  float sum;
-  float *t_mis;
-  float *t_iis;
 
   ESL_ALLOC(data->fwd_scores, sizeof(float) *  om->abc->Kp * (om->M+1));
   p7_oprofile_GetFwdEmissionScoreArray(om, data->fwd_scores);
@@ -329,54 +367,8 @@ p7_hmm_ScoreDataComputeRest(P7_OPROFILE *om, P7_SCOREDATA *data )
     ESL_ALLOC(data->fwd_transitions[k], sizeof(float) * (om->M+1));
     p7_oprofile_GetFwdTransitionArray(om, k, data->fwd_transitions[k] );
   }
-  t_mis = data->fwd_transitions[p7O_MI];
-  t_iis = data->fwd_transitions[p7O_II];
-
-  /*
-   * Elsewhere, we compute the MAXL of a given model, which is the length L
-   * such that only a minute fraction (BETA = 1e-7) of emitted sequence are length > L.
-   *
-   * In the DNA search pipeline, when a high-scoring SSV alignment is identified,
-   * we extract a window around that seed. The length of the window is based on
-   * MAXL, but we need to figure out how much the window should precede the seed
-   * (the prefix of the window) and how much should follow the seed (the suffix).
-   *
-   * Our heuristic strategy is to estimate how much of that MAXL is likely to have
-   * come from each position.  Using these relative contributions of each position,
-   * we can compute the length of extracted window prior to the seed as
-   *    MAXL * (sum of the expected fractional contributions of preceding positions),
-   * and do the same for the extracted window following the seed (suffix sum). This
-   * code supports that process, by computing prefix-sum and suffix-sum values for
-   * these relative contributions.
-   *
-   * We estimate the relative contributions of a position k by computing for position
-   * k, the minimum length l_k at which the tail probability mass for sequences
-   * emitted by position k (match and insert states)  P(L>l_k) < BETA.
-   * These per-position lengths are summed, and the relative contribution of a
-   * position is it's l_k normalized by the sum of all lengths
-   */
-  ESL_ALLOC(data->prefix_lengths, (om->M+1) * sizeof(float));
-  ESL_ALLOC(data->suffix_lengths, (om->M+1) * sizeof(float));
-
-  sum = 0;
-  for (k=1; k < om->M; k++) {
-    if (t_mis[k] == 0)
-      data->prefix_lengths[k] = 1;
-    else
-      data->prefix_lengths[k] = 1 + (int)(log(p7_DEFAULT_WINDOW_BETA / t_mis[k] )/log(t_iis[k]));
-
-    sum += data->prefix_lengths[k];
-  }
-  data->prefix_lengths[0] = data->prefix_lengths[om->M] = 0;
-
-  for (k=1; k < om->M; k++)
-    data->prefix_lengths[k] /=  sum;
 
-  data->suffix_lengths[om->M] = data->prefix_lengths[om->M-1];
-  for (k=om->M - 1; k >= 1; k--)
-    data->suffix_lengths[k] = data->suffix_lengths[k+1] + data->prefix_lengths[k-1];
-  for (k=2; k < om->M; k++)
-    data->prefix_lengths[k] += data->prefix_lengths[k-1];
+  if (data->prefix_lengths == NULL && (status = scoredata_GetWindowLengths(om, data)) != eslOK) goto ERROR;
 
   return eslOK;
 
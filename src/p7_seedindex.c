@@ -0,0 +1,495 @@
+/* P7_SEEDINDEX: amino acid k-mer seeds of profiles.
+ *
+ * MSV is the first thing every ORF meets, and for a genome-scale
+ * search almost every ORF fails it. A seed index lets most of those
+ * ORFs be thrown out without running any DP at all: from each
+ * profile's match emissions we collect every k-mer whose ungapped
+ * score along some diagonal of the model reaches a threshold (the
+ * profile's "neighborhood words", as in BLAST), and an ORF that
+ * contains none of them is not sent to MSV. The ORF is scanned once,
+ * with a rolling word code and one hash lookup per position, whatever
+ * the number of profiles in the index.
+ *
+ * An index can hold any number of profiles; each word maps to the
+ * list of profiles it seeds. bathsearch --kseed builds one per query.
+ * <p7_seedindex_Scan()> reports every profile with a seed in a
+ * sequence, for scanning a sequence against a whole library.
+ *
+ * Seeding trades sensitivity for speed: a remote homolog may align
+ * well without any k residues in a row scoring T bits together.
+ * Shorter words and lower thresholds are more sensitive and slower.
+ *
+ * Contents:
+ *   1. The <P7_SEEDINDEX> object
+ *   2. Scanning sequences
+ *   3. Unit tests
+ *   4. Test driver
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+
+#include "hmmer.h"
+
+#define p7_SEED_EMPTY  0xffffffffu   /* unused hash slot */
+
+typedef struct {
+  uint32_t word;
+  int      model;
+} SEED_PAIR;
+
+static int profile_seeds(const P7_PROFILE *gm, int k, float T, int maxper, SEED_PAIR **byp_pair, int64_t *byp_n, int64_t *byp_nalloc, int model);
+static int seed_pair_compare(const void *a, const void *b);
+
+static inline uint32_t
+seed_hash(uint32_t word, uint32_t mask)
+{
+  return (word * 2654435761u) & mask;
+}
+
+static inline int
+seed_lookup(const P7_SEEDINDEX *si, uint32_t word)
+{
+  uint32_t h = seed_hash(word, si->hsize - 1);
+
+  while (si->key[h] != p7_SEED_EMPTY)
+    {
+      if (si->key[h] == word) return (int) h;
+      h = (h + 1) & (si->hsize - 1);
+    }
+  return -1;
+}
+
+
+/*****************************************************************
+ * 1. The <P7_SEEDINDEX> object
+ *****************************************************************/
+
+/* profile_seeds()
+ * Append to <*byp_pair> the (word, <model>) pairs for every k-mer
+ * scoring at least <T> bits on some diagonal of <gm>, at most
+ * <maxper> per diagonal, best-first. Residues at each position are
+ * tried in decreasing score order, and a branch is abandoned as soon
+ * as even the best remaining residues can't reach <T>.
+ */
+static int
+profile_seeds(const P7_PROFILE *gm, int k, float T, int maxper, SEED_PAIR **byp_pair, int64_t *byp_n, int64_t *byp_nalloc, int model)
+{
+  int     K = gm->abc->K;
+  int     order[p7_SEED_MAXK][32];   /* residues at each word position, best first */
+  float   sc[p7_SEED_MAXK][32];      /* their scores, bits                         */
+  float   rest[p7_SEED_MAXK+1];      /* best possible score of positions j..k-1    */
+  int     choice[p7_SEED_MAXK];
+  float   partial[p7_SEED_MAXK+1];
+  int     i, j, a, b, tmp, nword, depth;
+  uint32_t word;
+  int     status;
+
+  for (i = 1; i + k - 1 <= gm->M; i++)
+    {
+      for (j = 0; j < k; j++)
+        {
+          for (a = 0; a < K; a++) { order[j][a] = a; sc[j][a] = p7P_MSC(gm, i+j, a) / eslCONST_LOG2; }
+          for (a = 1; a < K; a++)
+            for (b = a; b > 0 && sc[j][order[j][b]] > sc[j][order[j][b-1]]; b--)
+              { tmp = order[j][b]; order[j][b] = order[j][b-1]; order[j][b-1] = tmp; }
+        }
+      rest[k] = 0.;
+      for (j = k-1; j >= 0; j--) rest[j] = rest[j+1] + sc[j][order[j][0]];
+      if (rest[0] < T) continue;
+
+      /* depth-first over words, best residues first */
+      nword      = 0;
+      depth      = 0;
+      choice[0]  = 0;
+      partial[0] = 0.;
+      while (depth >= 0 && nword < maxper)
+        {
+          if (choice[depth] >= K || partial[depth] + sc[depth][order[depth][choice[depth]]] + rest[depth+1] < T)
+            { /* nothing more to try at this depth: back up */
+              depth--;
+              if (depth >= 0) choice[depth]++;
+              continue;
+            }
+          partial[depth+1] = partial[depth] + sc[depth][order[depth][choice[depth]]];
+          if (depth == k-1)
+            {
+              for (word = 0, j = 0; j < k; j++) word = word * K + order[j][choice[j]];
+              if (*byp_n == *byp_nalloc) {
+                *byp_nalloc = ESL_MAX(1024, *byp_nalloc * 2);
+                ESL_REALLOC(*byp_pair, sizeof(SEED_PAIR) * *byp_nalloc);
+              }
+              (*byp_pair)[*byp_n].word  = word;
+              (*byp_pair)[*byp_n].model = model;
+              (*byp_n)++;
+              nword++;
+              choice[depth]++;
+            }
+          else
+            {
+              depth++;
+              choice[depth] = 0;
+            }
+        }
+    }
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+static int
+seed_pair_compare(const void *a, const void *b)
+{
+  const SEED_PAIR *p1 = (const SEED_PAIR *) a;
+  const SEED_PAIR *p2 = (const SEED_PAIR *) b;
+
+  if (p1->word  != p2->word)  return (p1->word  < p2->word)  ? -1 : 1;
+  if (p1->model != p2->model) return (p1->model < p2->model) ? -1 : 1;
+  return 0;
+}
+
+/* Function:  p7_seedindex_Build()
+ * Synopsis:  Build a seed index for a set of profiles.
+ *
+ * Purpose:   Collect the seed words of the <nmodel> profiles <gm[]>:
+ *            every word of <k> residues that scores at least <T> bits
+ *            on some diagonal of a profile's match emissions, keeping
+ *            at most <p7_SEED_MAXPERPOS> of the best per diagonal, so
+ *            that very conserved models don't flood the index. Models
+ *            are numbered by their position in <gm[]>.
+ *
+ *            Only the match emission scores of the profiles are used,
+ *            so any configuration of them will do.
+ *
+ * Returns:   <eslOK> on success, and <*ret_si> is the new index.
+ *            <eslEINVAL> if <k> is outside 1..<p7_SEED_MAXK>.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_seedindex_Build(P7_PROFILE **gm, int nmodel, int k, float T, P7_SEEDINDEX **ret_si)
+{
+  P7_SEEDINDEX *si     = NULL;
+  SEED_PAIR    *pair   = NULL;
+  int64_t       npair  = 0;
+  int64_t       nalloc = 0;
+  int64_t       p, q;
+  uint32_t      h;
+  int           K;
+  int           m;
+  int           status;
+
+  *ret_si = NULL;
+  if (k < 1 || k > p7_SEED_MAXK || nmodel < 1) return eslEINVAL;
+  K = gm[0]->abc->K;
+
+  for (m = 0; m < nmodel; m++)
+    if ((status = profile_seeds(gm[m], k, T, p7_SEED_MAXPERPOS, &pair, &npair, &nalloc, m)) != eslOK) goto ERROR;
+  if (npair > 0) qsort(pair, npair, sizeof(SEED_PAIR), seed_pair_compare);
+
+  ESL_ALLOC(si, sizeof(P7_SEEDINDEX));
+  si->key    = NULL;
+  si->off    = NULL;
+  si->cnt    = NULL;
+  si->mdl    = NULL;
+  si->nseed  = NULL;
+  si->k      = k;
+  si->T      = T;
+  si->K      = K;
+  si->nmodel = nmodel;
+  si->nwords = 0;
+  si->npairs = 0;
+  for (si->kpow1 = 1, m = 0; m < k-1; m++) si->kpow1 *= K;
+
+  /* distinct (word, model) pairs */
+  for (p = 0, q = 0; p < npair; p++)
+    if (q == 0 || pair[p].word != pair[q-1].word || pair[p].model != pair[q-1].model) pair[q++] = pair[p];
+  si->npairs = q;
+  for (p = 0; p < si->npairs; p++)
+    if (p == 0 || pair[p].word != pair[p-1].word) si->nwords++;
+
+  for (si->hsize = 16; si->hsize < 2 * si->nwords; si->hsize *= 2) ;
+  ESL_ALLOC(si->key,   sizeof(uint32_t) * si->hsize);
+  ESL_ALLOC(si->off,   sizeof(int64_t)  * si->hsize);
+  ESL_ALLOC(si->cnt,   sizeof(int)      * si->hsize);
+  ESL_ALLOC(si->mdl,   sizeof(int)      * ESL_MAX(1, si->npairs));
+  ESL_ALLOC(si->nseed, sizeof(int64_t)  * nmodel);
+  for (h = 0; h < si->hsize; h++) si->key[h] = p7_SEED_EMPTY;
+  for (m = 0; m < nmodel; m++)    si->nseed[m] = 0;
+
+  for (p = 0; p < si->npairs; p++)
+    {
+      si->mdl[p] = pair[p].model;
+      si->nseed[pair[p].model]++;
+      if (p > 0 && pair[p].word == pair[p-1].word) { si->cnt[h]++; continue; }
+
+      h = seed_hash(pair[p].word, si->hsize - 1);
+      while (si->key[h] != p7_SEED_EMPTY) h = (h + 1) & (si->hsize - 1);
+      si->key[h] = pair[p].word;
+      si->off[h] = p;
+      si->cnt[h] = 1;
+    }
+
+  free(pair);
+  *ret_si = si;
+  return eslOK;
+
+ ERROR:
+  if (pair) free(pair);
+  p7_seedindex_Destroy(si);
+  return status;
+}
+
+/* Function:  p7_seedindex_Destroy()
+ * Synopsis:  Free a seed index.
+ */
+void
+p7_seedindex_Destroy(P7_SEEDINDEX *si)
+{
+  if (si == NULL) return;
+  if (si->key)   free(si->key);
+  if (si->off)   free(si->off);
+  if (si->cnt)   free(si->cnt);
+  if (si->mdl)   free(si->mdl);
+  if (si->nseed) free(si->nseed);
+  free(si);
+}
+/*------------------ end, P7_SEEDINDEX object -------------------*/
+
+
+/*****************************************************************
+ * 2. Scanning sequences
+ *****************************************************************/
+
+/* Function:  p7_seedindex_Hit()
+ * Synopsis:  Does a sequence contain any seed word?
+ *
+ * Purpose:   Return TRUE if digital sequence <dsq> of length <L>
+ *            contains a seed word of any profile in <si>, FALSE if
+ *            not. Words with noncanonical residues (X from masked or
+ *            ambiguous codons, stops) never match.
+ */
+int
+p7_seedindex_Hit(const P7_SEEDINDEX *si, const ESL_DSQ *dsq, int64_t L)
+{
+  uint32_t word = 0;
+  int      run  = 0;
+  int64_t  i;
+
+  for (i = 1; i <= L; i++)
+    {
+      if (dsq[i] >= si->K) { run = 0; word = 0; continue; }
+      word = (word % si->kpow1) * si->K + dsq[i];
+      if (++run >= si->k && seed_lookup(si, word) >= 0) return TRUE;
+    }
+  return FALSE;
+}
+
+/* Function:  p7_seedindex_Scan()
+ * Synopsis:  Which profiles have seeds in a sequence?
+ *
+ * Purpose:   Scan digital sequence <dsq> of length <L> once and set
+ *            <hit[m]> TRUE for every profile <m> of <si> with a seed
+ *            word in it. <hit[0..nmodel-1]> is caller-provided and is
+ *            not cleared first, so one array can collect over several
+ *            sequences (the ORFs of a window, say). The number of
+ *            entries newly set is returned in <*opt_nhit>.
+ *
+ * Returns:   <eslOK>.
+ */
+int
+p7_seedindex_Scan(const P7_SEEDINDEX *si, const ESL_DSQ *dsq, int64_t L, int *hit, int *opt_nhit)
+{
+  uint32_t word = 0;
+  int      run  = 0;
+  int      nhit = 0;
+  int64_t  i, p;
+  int      h;
+
+  for (i = 1; i <= L; i++)
+    {
+      if (dsq[i] >= si->K) { run = 0; word = 0; continue; }
+      word = (word % si->kpow1) * si->K + dsq[i];
+      if (++run < si->k || (h = seed_lookup(si, word)) < 0) continue;
+
+      for (p = si->off[h]; p < si->off[h] + si->cnt[h]; p++)
+        if (! hit[si->mdl[p]]) { hit[si->mdl[p]] = TRUE; nhit++; }
+    }
+  if (opt_nhit) *opt_nhit = nhit;
+  return eslOK;
+}
+/*------------------- end, scanning sequences -------------------*/
+
+
+/*****************************************************************
+ * 3. Unit tests
+ *****************************************************************/
+#ifdef p7SEEDINDEX_TESTDRIVE
+#include "esl_random.h"
+#include "esl_randomseq.h"
+
+/* Every diagonal's consensus word is its best-scoring word, so it is
+ * a seed whenever anything on that diagonal is: the consensus
+ * sequence of a profile must hit its own index, and Scan() must find
+ * the right profile in a two-profile index. A sequence of X never
+ * hits.
+ */
+static void
+utest_consensus(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, int M)
+{
+  char         *msg = "p7_seedindex consensus unit test failed";
+  P7_HMM       *hmm[2];
+  P7_PROFILE   *gm[2];
+  P7_BG        *bg  = p7_bg_Create(abc);
+  P7_SEEDINDEX *si  = NULL;
+  ESL_DSQ      *dsq = NULL;
+  float         best, sc;
+  int           hit[2];
+  int           nhit;
+  int           i, j, a, m, nseeded;
+
+  for (m = 0; m < 2; m++)
+    {
+      if (p7_hmm_Sample(r, M, abc, &hmm[m])                         != eslOK) esl_fatal(msg);
+      if ((gm[m] = p7_profile_Create(M, abc))                       == NULL)  esl_fatal(msg);
+      if (p7_ProfileConfig(hmm[m], bg, gm[m], 100, p7_LOCAL)       != eslOK) esl_fatal(msg);
+    }
+  if (p7_seedindex_Build(gm, 2, p7_SEED_K, p7_SEED_T, &si)         != eslOK) esl_fatal(msg);
+  if (si->nmodel != 2 || si->nwords == 0)                                    esl_fatal(msg);
+  if (si->nseed[0] == 0 || si->nseed[1] == 0)                                esl_fatal(msg);
+
+  /* the consensus of profile 1, one diagonal at a time */
+  if ((dsq = malloc(sizeof(ESL_DSQ) * (p7_SEED_K + 2))) == NULL) esl_fatal(msg);
+  for (nseeded = 0, i = 1; i + p7_SEED_K - 1 <= M; i++)
+    {
+      dsq[0] = dsq[p7_SEED_K+1] = eslDSQ_SENTINEL;
+      for (best = 0., j = 0; j < p7_SEED_K; j++)
+        {
+          for (dsq[j+1] = 0, a = 1; a < abc->K; a++)
+            if (p7P_MSC(gm[1], i+j, a) > p7P_MSC(gm[1], i+j, dsq[j+1])) dsq[j+1] = a;
+          best += p7P_MSC(gm[1], i+j, dsq[j+1]) / eslCONST_LOG2;
+        }
+      if (best < p7_SEED_T) continue;
+      nseeded++;
+
+      if (! p7_seedindex_Hit(si, dsq, p7_SEED_K)) esl_fatal(msg);
+      hit[0] = hit[1] = FALSE;
+      p7_seedindex_Scan(si, dsq, p7_SEED_K, hit, &nhit);
+      if (! hit[1] || nhit < 1) esl_fatal(msg);
+    }
+  if (nseeded == 0) esl_fatal(msg);
+
+  /* X's never seed */
+  for (j = 1; j <= p7_SEED_K; j++) dsq[j] = esl_abc_XGetUnknown(abc);
+  if (p7_seedindex_Hit(si, dsq, p7_SEED_K)) esl_fatal(msg);
+
+  /* every indexed word scores >= T on some diagonal (check model 0's words by brute force on a sample) */
+  for (a = 0; a < si->hsize; a++)
+    {
+      uint32_t word;
+      int      found = FALSE;
+      int      p;
+
+      if (si->key[a] == p7_SEED_EMPTY) continue;
+      for (p = si->off[a]; p < si->off[a] + si->cnt[a]; p++) if (si->mdl[p] == 0) break;
+      if (p == si->off[a] + si->cnt[a]) continue;
+
+      for (i = 1; i + p7_SEED_K - 1 <= M && ! found; i++)
+        {
+          for (sc = 0., word = si->key[a], j = p7_SEED_K - 1; j >= 0; j--, word /= abc->K)
+            sc += p7P_MSC(gm[0], i+j, word % abc->K) / eslCONST_LOG2;
+          if (sc >= p7_SEED_T - 1e-4) found = TRUE;
+        }
+      if (! found) esl_fatal(msg);
+    }
+
+  free(dsq);
+  p7_seedindex_Destroy(si);
+  for (m = 0; m < 2; m++) { p7_profile_Destroy(gm[m]); p7_hmm_Destroy(hmm[m]); }
+  p7_bg_Destroy(bg);
+}
+
+/* On random sequence, most ORF-length pieces have no seed: the filter
+ * has to be selective to be worth anything.
+ */
+static void
+utest_selectivity(ESL_RANDOMNESS *r, ESL_ALPHABET *abc, int M)
+{
+  char         *msg = "p7_seedindex selectivity unit test failed";
+  P7_HMM       *hmm = NULL;
+  P7_PROFILE   *gm  = p7_profile_Create(M, abc);
+  P7_BG        *bg  = p7_bg_Create(abc);
+  P7_SEEDINDEX *si  = NULL;
+  ESL_DSQ      *dsq = malloc(sizeof(ESL_DSQ) * 102);
+  int           n, nhit;
+
+  if (p7_hmm_Sample(r, M, abc, &hmm)                       != eslOK) esl_fatal(msg);
+  if (p7_ProfileConfig(hmm, bg, gm, 100, p7_LOCAL)         != eslOK) esl_fatal(msg);
+  if (p7_seedindex_Build(&gm, 1, p7_SEED_K, p7_SEED_T, &si) != eslOK) esl_fatal(msg);
+
+  for (nhit = 0, n = 0; n < 1000; n++)
+    {
+      esl_rsq_xfIID(r, bg->f, abc->K, 100, dsq);
+      if (p7_seedindex_Hit(si, dsq, 100)) nhit++;
+    }
+  if (nhit > 500) esl_fatal(msg);
+
+  free(dsq);
+  p7_seedindex_Destroy(si);
+  p7_profile_Destroy(gm);
+  p7_hmm_Destroy(hmm);
+  p7_bg_Destroy(bg);
+}
+#endif /*p7SEEDINDEX_TESTDRIVE*/
+/*---------------------- end, unit tests -----------------------*/
+
+
+/*****************************************************************
+ * 4. Test driver
+ *****************************************************************/
+#ifdef p7SEEDINDEX_TESTDRIVE
+/*
+  gcc -o p7_seedindex_utest -g -Wall -I. -L. -I../easel -L../easel -Dp7SEEDINDEX_TESTDRIVE p7_seedindex.c -lhmmer -leasel -lm
+  ./p7_seedindex_utest
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name  type         default  env   range togs  reqs  incomp  help                   docgrp */
+  { "-h",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show help and usage",           0 },
+  { "-s",  eslARG_INT,     "42",  NULL, NULL, NULL, NULL, NULL, "set random number seed to <n>", 0 },
+  { "-M",  eslARG_INT,    "100",  NULL, NULL, NULL, NULL, NULL, "length of the test models",     0 },
+  { 0,0,0,0,0,0,0,0,0,0},
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for p7_seedindex.c";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go  = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r   = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abc = esl_alphabet_Create(eslAMINO);
+  int             M   = esl_opt_GetInteger(go, "-M");
+
+  utest_consensus  (r, abc, M);
+  utest_selectivity(r, abc, M);
+
+  esl_alphabet_Destroy(abc);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7SEEDINDEX_TESTDRIVE*/
+/*---------------------- end, test driver ----------------------*/
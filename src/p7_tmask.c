@@ -0,0 +1,885 @@
+/* P7_TMASK: low-complexity and tandem-repeat masking of target DNA.
+ *
+ * Repeat-rich genomes send large numbers of low-complexity ORFs
+ * through MSV and the bias filter, and some of them get as far as
+ * frameshift Forward before null2 removes them. bathsearch --tmask
+ * masks such regions before translation: masked nucleotides are
+ * replaced by N, so their codons translate to X and score as
+ * background in every filter, and ORFs that are mostly X are skipped
+ * outright.
+ *
+ * Two maskers are provided. <p7_tmask_Dust()> is a windowed DUST
+ * triplet score on the DNA, which catches microsatellites and short
+ * tandem repeats. <p7_tmask_Seg()> is a SEG-style compositional
+ * complexity mask on all six reading frames, mapped back to DNA
+ * coordinates, which catches low-complexity protein-coding regions
+ * that dust misses. Masks can be computed on the fly for each target
+ * window, or once per genome with bathmask and saved as a BED file
+ * next to the database (<seqdb>.bmask), then loaded into a
+ * <P7_TMASKDB>.
+ *
+ * Contents:
+ *   1. The <P7_TMASK> object
+ *   2. Maskers
+ *   3. Applying masks
+ *   4. The <P7_TMASKDB> object, and BED input/output
+ *   5. Unit tests
+ *   6. Test driver
+ */
+#include "p7_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "easel.h"
+#include "esl_alphabet.h"
+#include "esl_fileparser.h"
+#include "esl_gencode.h"
+#include "esl_keyhash.h"
+#include "esl_sq.h"
+
+#include "hmmer.h"
+
+static int seg_frame(P7_TMASK *tm, const ESL_ALPHABET *aa_abc, const ESL_DSQ *aa, int64_t n, int W, double k1, double k2,
+                     int64_t L, int frame, int revcomp, int64_t offset, double *clogc);
+
+/*****************************************************************
+ *= 1. The <P7_TMASK> object
+ *****************************************************************/
+
+/* Function:  p7_tmask_Create()
+ * Synopsis:  Create a new, empty <P7_TMASK>.
+ *
+ * Returns:   ptr to the new <P7_TMASK>.
+ *
+ * Throws:    <NULL> on allocation failure.
+ */
+P7_TMASK *
+p7_tmask_Create(void)
+{
+  P7_TMASK *tm = NULL;
+  int       status;
+
+  ESL_ALLOC(tm, sizeof(P7_TMASK));
+  tm->name   = NULL;
+  tm->seg    = NULL;
+  tm->nseg   = 0;
+  tm->nalloc = 16;
+  ESL_ALLOC(tm->seg, sizeof(P7_TMASK_SEG) * tm->nalloc);
+  return tm;
+
+ ERROR:
+  p7_tmask_Destroy(tm);
+  return NULL;
+}
+
+/* Function:  p7_tmask_SetName()
+ * Synopsis:  Set the name of the sequence a mask belongs to.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_tmask_SetName(P7_TMASK *tm, const char *name)
+{
+  if (tm->name != NULL) free(tm->name);
+  tm->name = NULL;
+  return esl_strdup(name, -1, &(tm->name));
+}
+
+/* Function:  p7_tmask_Add()
+ * Synopsis:  Add one masked span to a mask.
+ *
+ * Purpose:   Append span <beg>..<end> (inclusive; either order) to
+ *            <tm>. Spans may be added in any order and may overlap;
+ *            call <p7_tmask_Finalize()> before using the mask.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_tmask_Add(P7_TMASK *tm, int64_t beg, int64_t end)
+{
+  int status;
+
+  if (tm->nseg == tm->nalloc) {
+    ESL_REALLOC(tm->seg, sizeof(P7_TMASK_SEG) * tm->nalloc * 2);
+    tm->nalloc *= 2;
+  }
+  tm->seg[tm->nseg].beg = ESL_MIN(beg, end);
+  tm->seg[tm->nseg].end = ESL_MAX(beg, end);
+  tm->nseg++;
+  return eslOK;
+
+ ERROR:
+  return status;
+}
+
+static int
+seg_compare(const void *a, const void *b)
+{
+  const P7_TMASK_SEG *s1 = (const P7_TMASK_SEG *) a;
+  const P7_TMASK_SEG *s2 = (const P7_TMASK_SEG *) b;
+
+  if      (s1->beg < s2->beg) return -1;
+  else if (s1->beg > s2->beg) return  1;
+  else if (s1->end < s2->end) return -1;
+  else if (s1->end > s2->end) return  1;
+  return 0;
+}
+
+/* Function:  p7_tmask_Finalize()
+ * Synopsis:  Sort a mask's spans and merge overlaps.
+ *
+ * Purpose:   Sort the spans in <tm> by start position and merge any
+ *            that overlap or abut, leaving a sorted list of
+ *            nonoverlapping spans, as <p7_tmask_Apply()> expects.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_tmask_Finalize(P7_TMASK *tm)
+{
+  int i, n;
+
+  if (tm->nseg < 2) return eslOK;
+  qsort(tm->seg, tm->nseg, sizeof(P7_TMASK_SEG), seg_compare);
+
+  for (n = 0, i = 1; i < tm->nseg; i++)
+    {
+      if (tm->seg[i].beg <= tm->seg[n].end + 1)
+        tm->seg[n].end = ESL_MAX(tm->seg[n].end, tm->seg[i].end);
+      else
+        tm->seg[++n] = tm->seg[i];
+    }
+  tm->nseg = n+1;
+  return eslOK;
+}
+
+/* Function:  p7_tmask_Reuse()
+ * Synopsis:  Reuse a <P7_TMASK> for another sequence.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_tmask_Reuse(P7_TMASK *tm)
+{
+  if (tm->name != NULL) free(tm->name);
+  tm->name = NULL;
+  tm->nseg = 0;
+  return eslOK;
+}
+
+/* Function:  p7_tmask_Destroy()
+ * Synopsis:  Free a <P7_TMASK>.
+ */
+void
+p7_tmask_Destroy(P7_TMASK *tm)
+{
+  if (tm == NULL) return;
+  if (tm->name != NULL) free(tm->name);
+  if (tm->seg  != NULL) free(tm->seg);
+  free(tm);
+}
+/*------------------ end, P7_TMASK object -----------------------*/
+
+
+
+/*****************************************************************
+ *= 2. Maskers
+ *****************************************************************/
+
+/* Function:  p7_tmask_Dust()
+ * Synopsis:  Mask low-complexity DNA with a windowed DUST score.
+ *
+ * Purpose:   Score every window of <W> nucleotides in digital DNA
+ *            sequence <dsq> (1..L) by the DUST triplet score
+ *            $\sum_t c_t (c_t - 1) / 2 / (l - 1)$, where $c_t$ is
+ *            the count of triplet <t> among the $l$ triplets in the
+ *            window, and add every window whose score times ten
+ *            exceeds <level> to <tm>, the same scaling dustmasker
+ *            uses for its level. Triplets that include a noncanonical residue are
+ *            not counted. Spans are added in coordinates
+ *            <offset>+1..<offset>+L, so a window of a longer sequence
+ *            can be masked in the full sequence's coordinates.
+ *
+ *            The score is computed incrementally as the window
+ *            slides, so this is $O(L)$.
+ *
+ * Args:      tm     - mask to add spans to
+ *            abc    - DNA alphabet of <dsq>
+ *            dsq    - digital DNA sequence, 1..L
+ *            L      - length of <dsq>
+ *            offset - coordinate of dsq[1] in the full sequence, minus one
+ *            W      - window length (p7_TMASK_DUSTW)
+ *            level  - score threshold (p7_TMASK_DUSTLEVEL)
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_tmask_Dust(P7_TMASK *tm, const ESL_ALPHABET *abc, const ESL_DSQ *dsq, int64_t L, int64_t offset, int W, double level)
+{
+  int     c[64];          /* triplet counts in the current window        */
+  int64_t sum  = 0;       /* sum_t c_t (c_t - 1) / 2                     */
+  int     nt   = 0;       /* number of valid triplets in the window       */
+  int64_t open_beg = -1;  /* span being extended, or -1                   */
+  int64_t open_end = -1;
+  int64_t i;
+  int     t;
+  int     status;
+
+  if (L < W || W < 4) return eslOK;
+  for (t = 0; t < 64; t++) c[t] = 0;
+
+  /* triplet ending at position j is dsq[j-2..j]; window ending at i holds triplets ending at i-W+3..i */
+#define DUST_TRIPLET(j) ( (esl_abc_XIsCanonical(abc, dsq[(j)-2]) && esl_abc_XIsCanonical(abc, dsq[(j)-1]) && esl_abc_XIsCanonical(abc, dsq[(j)])) ? \
+                          (dsq[(j)-2] * 16 + dsq[(j)-1] * 4 + dsq[(j)]) : -1 )
+
+  for (i = 3; i <= L; i++)
+    {
+      if ((t = DUST_TRIPLET(i)) >= 0) { sum += c[t]; c[t]++; nt++; }
+      if (i - W + 2 >= 3 && (t = DUST_TRIPLET(i-W+2)) >= 0) { c[t]--; sum -= c[t]; nt--; }
+      if (i < W) continue;
+
+      if (nt > 1 && 10. * (double) sum > level * (double) (nt - 1))
+        {
+          if (open_beg != -1 && i - W + 1 <= open_end + 1) open_end = i;
+          else {
+            if (open_beg != -1 && (status = p7_tmask_Add(tm, offset + open_beg, offset + open_end)) != eslOK) return status;
+            open_beg = i - W + 1;
+            open_end = i;
+          }
+        }
+    }
+  if (open_beg != -1 && (status = p7_tmask_Add(tm, offset + open_beg, offset + open_end)) != eslOK) return status;
+#undef DUST_TRIPLET
+
+  return eslOK;
+}
+
+
+/* Function:  p7_tmask_Seg()
+ * Synopsis:  Mask DNA whose translations have low compositional complexity.
+ *
+ * Purpose:   Translate digital DNA sequence <dsq> (1..L) in all six
+ *            reading frames with genetic code <gcode>, and find
+ *            low-complexity stretches in the manner of SEG: every
+ *            window of <W> amino acids whose composition has Shannon
+ *            entropy $\leq$ <k1> bits triggers a masked stretch,
+ *            which is extended over neighbouring windows with
+ *            entropy $\leq$ <k2>. Windows that include a stop codon
+ *            or an ambiguous codon never qualify. The DNA under each
+ *            stretch is added to <tm> in coordinates
+ *            <offset>+1..<offset>+L of the top strand.
+ *
+ *            This keeps SEG's trigger/extension thresholds but not
+ *            its optimal-subsequence trimming, so stretches are
+ *            whole windows.
+ *
+ * Args:      tm     - mask to add spans to
+ *            gcode  - genetic code for translation
+ *            dsq    - digital DNA sequence, 1..L
+ *            L      - length of <dsq>
+ *            offset - coordinate of dsq[1] in the full sequence, minus one
+ *            W      - window length in amino acids (p7_TMASK_SEGW)
+ *            k1     - trigger complexity in bits (p7_TMASK_SEGK1)
+ *            k2     - extension complexity in bits (p7_TMASK_SEGK2)
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_tmask_Seg(P7_TMASK *tm, const ESL_GENCODE *gcode, const ESL_DSQ *dsq, int64_t L, int64_t offset, int W, double k1, double k2)
+{
+  ESL_DSQ *rc    = NULL;   /* reverse complement of <dsq>, 1..L           */
+  ESL_DSQ *aa    = NULL;   /* one frame's translation, 0..n-1             */
+  double  *clogc = NULL;   /* c log2 c for c = 0..W                       */
+  int64_t  n, i, k;
+  int      f, s, c;
+  int      status;
+
+  if (L < 3 * W) return eslOK;
+
+  ESL_ALLOC(rc,    sizeof(ESL_DSQ) * (L+2));
+  ESL_ALLOC(aa,    sizeof(ESL_DSQ) * (L/3+1));
+  ESL_ALLOC(clogc, sizeof(double)  * (W+1));
+
+  for (c = 0; c <= W; c++) clogc[c] = (c > 0) ? (double) c * log2((double) c) : 0.0;
+
+  rc[0] = rc[L+1] = eslDSQ_SENTINEL;
+  for (i = 1; i <= L; i++)
+    rc[i] = esl_abc_XIsCanonical(gcode->nt_abc, dsq[L-i+1]) ? gcode->nt_abc->complement[dsq[L-i+1]] : esl_abc_XGetUnknown(gcode->nt_abc);
+
+  for (s = 0; s < 2; s++)
+    for (f = 0; f < 3; f++)
+      {
+        const ESL_DSQ *src = (s == 0) ? dsq : rc;
+
+        n = (L - f) / 3;
+        for (k = 0; k < n; k++)
+          aa[k] = esl_gencode_GetTranslation(gcode, (ESL_DSQ *) src + 1 + f + 3*k);
+
+        if ((status = seg_frame(tm, gcode->aa_abc, aa, n, W, k1, k2, L, f, s, offset, clogc)) != eslOK) goto ERROR;
+      }
+
+  free(clogc);
+  free(aa);
+  free(rc);
+  return eslOK;
+
+ ERROR:
+  if (clogc) free(clogc);
+  if (aa)    free(aa);
+  if (rc)    free(rc);
+  return status;
+}
+
+/* seg_frame()
+ * Slide a <W>-residue window along translation <aa> (0..n-1) of frame
+ * <frame> of the top (<revcomp> FALSE) or bottom strand, keeping the
+ * composition's sum of c log2 c up to date, and add the DNA under each
+ * triggered low-complexity stretch to <tm>.
+ */
+static int
+seg_frame(P7_TMASK *tm, const ESL_ALPHABET *aa_abc, const ESL_DSQ *aa, int64_t n, int W, double k1, double k2,
+          int64_t L, int frame, int revcomp, int64_t offset, double *clogc)
+{
+  int      cnt[32];          /* counts of canonical residues in the window */
+  int      nbad   = 0;       /* noncanonical residues (stops, X) in it     */
+  double   sumclogc = 0.;
+  double   H;
+  int      in_run = FALSE;
+  int      seeded = FALSE;
+  int64_t  run_beg = 0, run_end = 0;
+  int64_t  s, a, b, dbeg, dend;
+  int      x;
+  int      status;
+
+  if (n < W) return eslOK;
+  for (x = 0; x < 32; x++) cnt[x] = 0;
+
+#define SEG_IN(x)  do { if (esl_abc_XIsCanonical(aa_abc, (x))) { sumclogc += clogc[cnt[(x)]+1] - clogc[cnt[(x)]]; cnt[(x)]++; } else nbad++; } while (0)
+#define SEG_OUT(x) do { if (esl_abc_XIsCanonical(aa_abc, (x))) { sumclogc += clogc[cnt[(x)]-1] - clogc[cnt[(x)]]; cnt[(x)]--; } else nbad--; } while (0)
+
+  for (s = 0; s < W; s++) SEG_IN(aa[s]);
+
+  for (s = 0; s + W <= n; s++)
+    {
+      if (s > 0) { SEG_OUT(aa[s-1]); SEG_IN(aa[s+W-1]); }
+
+      H = log2((double) W) - sumclogc / (double) W;
+      if (nbad == 0 && H <= k2)
+        {
+          if (! in_run) { in_run = TRUE; seeded = FALSE; run_beg = s; }
+          if (H <= k1) seeded = TRUE;
+          run_end = s + W - 1;
+        }
+      if (in_run && (s + W == n || ! (nbad == 0 && H <= k2)))
+        {
+          if (seeded)
+            {
+              /* amino acids a..b of this frame are nucleotides 1+frame+3a .. 3+frame+3b of this strand */
+              a    = run_beg;
+              b    = run_end;
+              dbeg = 1 + frame + 3*a;
+              dend = 3 + frame + 3*b;
+              if (revcomp) status = p7_tmask_Add(tm, offset + L - dend + 1, offset + L - dbeg + 1);
+              else         status = p7_tmask_Add(tm, offset + dbeg,         offset + dend);
+              if (status != eslOK) return status;
+            }
+          in_run = FALSE;
+        }
+    }
+#undef SEG_IN
+#undef SEG_OUT
+  return eslOK;
+}
+/*----------------------- end, maskers --------------------------*/
+
+
+
+/*****************************************************************
+ *= 3. Applying masks
+ *****************************************************************/
+
+/* Function:  p7_tmask_Apply()
+ * Synopsis:  Mask a target sequence (or a window of one).
+ *
+ * Purpose:   Replace every residue of digital sequence <sq> that lies
+ *            in a span of finalized mask <tm> with the unknown residue
+ *            (N). <sq> may be a window of a longer sequence; its
+ *            <start>..<end> coords place it in the full sequence, in
+ *            either orientation.
+ *
+ *            Optionally return the number of residues masked in
+ *            <*opt_nmasked>.
+ *
+ * Returns:   <eslOK> on success.
+ */
+int
+p7_tmask_Apply(const P7_TMASK *tm, ESL_SQ *sq, int64_t *opt_nmasked)
+{
+  int64_t lo      = ESL_MIN(sq->start, sq->end);
+  int64_t hi      = ESL_MAX(sq->start, sq->end);
+  int     revcomp = (sq->start > sq->end);
+  int64_t nmasked = 0;
+  int64_t p, i;
+  ESL_DSQ unk     = esl_abc_XGetUnknown(sq->abc);
+  int     j;
+
+  if (lo == 0) { lo = 1; hi = sq->n; revcomp = FALSE; }  /* no coords: sq is a whole sequence */
+
+  for (j = 0; j < tm->nseg; j++)
+    {
+      if (tm->seg[j].end < lo) continue;
+      if (tm->seg[j].beg > hi) break;
+      for (p = ESL_MAX(lo, tm->seg[j].beg); p <= ESL_MIN(hi, tm->seg[j].end); p++)
+        {
+          i = revcomp ? hi - p + 1 : p - lo + 1;
+          sq->dsq[i] = unk;
+          nmasked++;
+        }
+    }
+
+  if (opt_nmasked) *opt_nmasked = nmasked;
+  return eslOK;
+}
+
+/* Function:  p7_tmask_Count()
+ * Synopsis:  Number of masked positions in a coordinate range.
+ *
+ * Purpose:   Return the number of positions <lo..hi> (1-based, in
+ *            the coordinates of the full sequence) that lie in a span
+ *            of finalized mask <tm>.
+ */
+int64_t
+p7_tmask_Count(const P7_TMASK *tm, int64_t lo, int64_t hi)
+{
+  int64_t n = 0;
+  int     j;
+
+  for (j = 0; j < tm->nseg; j++)
+    {
+      if (tm->seg[j].end < lo) continue;
+      if (tm->seg[j].beg > hi) break;
+      n += ESL_MIN(hi, tm->seg[j].end) - ESL_MAX(lo, tm->seg[j].beg) + 1;
+    }
+  return n;
+}
+
+/* Function:  p7_tmask_MaskedFraction()
+ * Synopsis:  Fraction of a sequence that is masked.
+ *
+ * Purpose:   Return the fraction of the residues of digital sequence
+ *            <sq> that are the unknown residue (N for DNA, X for
+ *            protein). An ORF translated from masked DNA carries X at
+ *            every masked codon.
+ */
+float
+p7_tmask_MaskedFraction(const ESL_SQ *sq)
+{
+  int64_t i;
+  int64_t n = 0;
+
+  if (sq->n == 0) return 0.;
+  for (i = 1; i <= sq->n; i++)
+    if (esl_abc_XIsUnknown(sq->abc, sq->dsq[i])) n++;
+  return (float) n / (float) sq->n;
+}
+/*-------------------- end, applying masks ----------------------*/
+
+
+
+/*****************************************************************
+ *= 4. The <P7_TMASKDB> object, and BED input/output
+ *****************************************************************/
+
+/* Function:  p7_tmaskdb_Create()
+ * Synopsis:  Create an empty <P7_TMASKDB>.
+ *
+ * Returns:   ptr to the new <P7_TMASKDB>.
+ *
+ * Throws:    <NULL> on allocation failure.
+ */
+P7_TMASKDB *
+p7_tmaskdb_Create(void)
+{
+  P7_TMASKDB *db = NULL;
+  int         status;
+
+  ESL_ALLOC(db, sizeof(P7_TMASKDB));
+  db->mask   = NULL;
+  db->nmask  = 0;
+  db->nalloc = 64;
+  db->kh     = NULL;
+  ESL_ALLOC(db->mask, sizeof(P7_TMASK *) * db->nalloc);
+  if ((db->kh = esl_keyhash_Create()) == NULL) goto ERROR;
+  return db;
+
+ ERROR:
+  p7_tmaskdb_Destroy(db);
+  return NULL;
+}
+
+/* Function:  p7_tmaskdb_Get()
+ * Synopsis:  Look up the mask for a target sequence.
+ *
+ * Returns:   ptr to the mask for sequence <name>, or <NULL> if the
+ *            sequence has no masked spans. The mask is owned by <db>.
+ */
+P7_TMASK *
+p7_tmaskdb_Get(const P7_TMASKDB *db, const char *name)
+{
+  int idx;
+
+  if (esl_keyhash_Lookup(db->kh, name, -1, &idx) != eslOK) return NULL;
+  return db->mask[idx];
+}
+
+/* Function:  p7_tmaskdb_Read()
+ * Synopsis:  Read a BED file of masked spans.
+ *
+ * Purpose:   Read masked spans from BED file <bedfile>: one span per
+ *            line, as sequence name, 0-based start and end-exclusive
+ *            end; further columns are ignored, as are comment lines
+ *            and UCSC "track"/"browser" lines. A sequence's spans
+ *            need not be contiguous or sorted in the file. Return the
+ *            new, finalized database in <*ret_db>.
+ *
+ *            Such a file is written by bathmask, but masks from other
+ *            tools (dustmasker, RepeatMasker, ...) converted to BED
+ *            work too.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ *            <eslENOTFOUND> if <bedfile> can't be opened for reading.
+ *            <eslEFORMAT> on a parse error. In both cases <errbuf>
+ *            contains a user-directed error message, and <*ret_db>
+ *            is <NULL>.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_tmaskdb_Read(const char *bedfile, P7_TMASKDB **ret_db, char *errbuf)
+{
+  ESL_FILEPARSER *efp  = NULL;
+  P7_TMASKDB     *db   = NULL;
+  char           *name;
+  char           *tok;
+  int             namelen, toklen;
+  int64_t         beg, end;
+  int             idx;
+  int             status;
+
+  if (errbuf) errbuf[0] = '\0';
+
+  status = esl_fileparser_Open(bedfile, NULL, &efp);
+  if      (status == eslENOTFOUND) ESL_XFAIL(eslENOTFOUND, errbuf, "couldn't open mask file %s for reading", bedfile);
+  else if (status != eslOK)        goto ERROR;
+  esl_fileparser_SetCommentChar(efp, '#');
+
+  if ((db = p7_tmaskdb_Create()) == NULL) { status = eslEMEM; goto ERROR; }
+
+  while ((status = esl_fileparser_NextLine(efp)) == eslOK)
+    {
+      if ((status = esl_fileparser_GetTokenOnLine(efp, &name, &namelen)) != eslOK) goto ERROR;
+      if (strcmp(name, "track") == 0 || strcmp(name, "browser") == 0) continue;
+
+      status = esl_fileparser_GetTokenOnLine(efp, &tok, &toklen);
+      if      (status == eslEOL)       ESL_XFAIL(eslEFORMAT, errbuf, "expected a start coordinate [line %d of mask file %s]", efp->linenumber, bedfile);
+      else if (status != eslOK)        goto ERROR;
+      if (! esl_str_IsInteger(tok))    ESL_XFAIL(eslEFORMAT, errbuf, "expected a start coordinate, saw %s [line %d of mask file %s]", tok, efp->linenumber, bedfile);
+      beg = strtoll(tok, NULL, 10);
+
+      status = esl_fileparser_GetTokenOnLine(efp, &tok, &toklen);
+      if      (status == eslEOL)       ESL_XFAIL(eslEFORMAT, errbuf, "expected an end coordinate [line %d of mask file %s]", efp->linenumber, bedfile);
+      else if (status != eslOK)        goto ERROR;
+      if (! esl_str_IsInteger(tok))    ESL_XFAIL(eslEFORMAT, errbuf, "expected an end coordinate, saw %s [line %d of mask file %s]", tok, efp->linenumber, bedfile);
+      end = strtoll(tok, NULL, 10);
+
+      if (beg < 0 || end <= beg)       ESL_XFAIL(eslEFORMAT, errbuf, "bad span %" PRId64 "..%" PRId64 " [line %d of mask file %s]", beg, end, efp->linenumber, bedfile);
+
+      status = esl_keyhash_Store(db->kh, name, -1, &idx);
+      if (status == eslOK)
+        {
+          if (db->nmask == db->nalloc) {
+            ESL_REALLOC(db->mask, sizeof(P7_TMASK *) * db->nalloc * 2);
+            db->nalloc *= 2;
+          }
+          if ((db->mask[idx] = p7_tmask_Create())                  == NULL)  { status = eslEMEM; goto ERROR; }
+          db->nmask++;
+          if ((status = p7_tmask_SetName(db->mask[idx], name))     != eslOK) goto ERROR;
+        }
+      else if (status != eslEDUP) goto ERROR;
+
+      if ((status = p7_tmask_Add(db->mask[idx], beg+1, end)) != eslOK) goto ERROR;   /* BED is 0-based, end-exclusive */
+    }
+  if (status != eslEOF) goto ERROR;
+
+  for (idx = 0; idx < db->nmask; idx++)
+    p7_tmask_Finalize(db->mask[idx]);
+
+  esl_fileparser_Close(efp);
+  *ret_db = db;
+  return eslOK;
+
+ ERROR:
+  if (efp) esl_fileparser_Close(efp);
+  if (db)  p7_tmaskdb_Destroy(db);
+  *ret_db = NULL;
+  return status;
+}
+
+/* Function:  p7_tmask_WriteBED()
+ * Synopsis:  Write a mask's spans as BED lines.
+ *
+ * Purpose:   Write the spans of finalized mask <tm> to stream <fp>, one
+ *            BED line (name, 0-based start, end-exclusive end) each.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEWRITE> on a write error.
+ */
+int
+p7_tmask_WriteBED(FILE *fp, const P7_TMASK *tm)
+{
+  int j;
+
+  for (j = 0; j < tm->nseg; j++)
+    if (fprintf(fp, "%s\t%" PRId64 "\t%" PRId64 "\n", tm->name, tm->seg[j].beg - 1, tm->seg[j].end) < 0)
+      ESL_EXCEPTION_SYS(eslEWRITE, "mask write failed");
+  return eslOK;
+}
+
+/* Function:  p7_tmaskdb_Destroy()
+ * Synopsis:  Free a <P7_TMASKDB>, and the masks it holds.
+ */
+void
+p7_tmaskdb_Destroy(P7_TMASKDB *db)
+{
+  int i;
+
+  if (db == NULL) return;
+  if (db->mask != NULL) {
+    for (i = 0; i < db->nmask; i++) p7_tmask_Destroy(db->mask[i]);
+    free(db->mask);
+  }
+  if (db->kh != NULL) esl_keyhash_Destroy(db->kh);
+  free(db);
+}
+/*--------------- end, P7_TMASKDB and BED i/o -------------------*/
+
+
+
+/*****************************************************************
+ *= 5. Unit tests
+ *****************************************************************/
+#ifdef p7TMASK_TESTDRIVE
+#include "esl_random.h"
+#include "esl_randomseq.h"
+
+/* A random DNA sequence with a (CA)n microsatellite and a
+ * poly-glutamine (CAG)n coding repeat planted in it: dust must mask
+ * the microsatellite, SEG must mask the CAG repeat, and neither should
+ * mask much of the random flanks. Applying the mask to a window of
+ * the sequence must only touch residues under the mask.
+ */
+static void
+utest_plant(ESL_RANDOMNESS *r, ESL_GENCODE *gcode, int L)
+{
+  char         *msg   = "p7_tmask plant unit test failed";
+  ESL_ALPHABET *abc   = gcode->nt_abc;
+  ESL_SQ       *sq    = esl_sq_CreateDigital(abc);
+  P7_TMASK     *dust  = p7_tmask_Create();
+  P7_TMASK     *seg   = p7_tmask_Create();
+  double        fq[4] = { 0.25, 0.25, 0.25, 0.25 };
+  int64_t       ms_beg  = L/4,     ms_end  = L/4 + 99;      /* (CA)50   */
+  int64_t       cag_beg = L/2 + 1, cag_end = L/2 + 150;     /* (CAG)50  */
+  int64_t       nmasked, p, nflank;
+  int           j, inside;
+
+  if (sq == NULL || dust == NULL || seg == NULL) esl_fatal(msg);
+  esl_sq_GrowTo(sq, L);
+  sq->n = L;
+  esl_rsq_xIID(r, fq, 4, L, sq->dsq);
+  for (p = ms_beg;  p <= ms_end;  p++) sq->dsq[p] = ((p - ms_beg)  % 2 == 0) ? 1 : 0;                      /* C A        */
+  for (p = cag_beg; p <= cag_end; p++) sq->dsq[p] = ((p - cag_beg) % 3 == 0) ? 1 : (((p - cag_beg) % 3 == 1) ? 0 : 2); /* C A G */
+
+  if (p7_tmask_Dust(dust, abc, sq->dsq, L, 0, p7_TMASK_DUSTW, p7_TMASK_DUSTLEVEL) != eslOK) esl_fatal(msg);
+  if (p7_tmask_Finalize(dust) != eslOK) esl_fatal(msg);
+  if (p7_tmask_Seg(seg, gcode, sq->dsq, L, 0, p7_TMASK_SEGW, p7_TMASK_SEGK1, p7_TMASK_SEGK2) != eslOK) esl_fatal(msg);
+  if (p7_tmask_Finalize(seg) != eslOK) esl_fatal(msg);
+
+  /* every residue of the microsatellite is dust-masked; the CAG repeat is SEG-masked */
+  for (p = ms_beg; p <= ms_end; p++) {
+    for (inside = FALSE, j = 0; j < dust->nseg; j++) if (dust->seg[j].beg <= p && p <= dust->seg[j].end) inside = TRUE;
+    if (! inside) esl_fatal(msg);
+  }
+  for (p = cag_beg + 2; p <= cag_end - 2; p++) {
+    for (inside = FALSE, j = 0; j < seg->nseg; j++) if (seg->seg[j].beg <= p && p <= seg->seg[j].end) inside = TRUE;
+    if (! inside) esl_fatal(msg);
+  }
+
+  /* spans are sorted, nonoverlapping, and in range */
+  for (j = 0; j < dust->nseg; j++) {
+    if (dust->seg[j].beg < 1 || dust->seg[j].end > L || dust->seg[j].beg > dust->seg[j].end) esl_fatal(msg);
+    if (j > 0 && dust->seg[j].beg <= dust->seg[j-1].end + 1) esl_fatal(msg);
+  }
+
+  /* random flanks are mostly left alone: each planted repeat can drag in at most a window on either side */
+  for (nflank = 0, j = 0; j < dust->nseg; j++)
+    for (p = dust->seg[j].beg; p <= dust->seg[j].end; p++)
+      if (p < ms_beg || (p > ms_end && p < cag_beg) || p > cag_end) nflank++;
+  if (nflank > 4 * p7_TMASK_DUSTW + L/20) esl_fatal(msg);
+
+  /* apply the SEG mask to the second half of the sequence, as a window */
+  sq->start = L/2;
+  sq->end   = L;
+  sq->n     = L - L/2 + 1;
+  memmove(sq->dsq + 1, sq->dsq + L/2, sizeof(ESL_DSQ) * sq->n);
+  sq->dsq[sq->n+1] = eslDSQ_SENTINEL;
+  if (p7_tmask_Apply(seg, sq, &nmasked) != eslOK) esl_fatal(msg);
+  if (nmasked < cag_end - cag_beg + 1) esl_fatal(msg);
+  for (p = cag_beg; p <= cag_end; p++)
+    if (! esl_abc_XIsUnknown(abc, sq->dsq[p - sq->start + 1])) esl_fatal(msg);
+
+  esl_sq_Destroy(sq);
+  p7_tmask_Destroy(dust);
+  p7_tmask_Destroy(seg);
+}
+
+/* Finalize() merges overlapping and abutting spans, and Apply() of a
+ * reverse-oriented window masks the mirror-image positions.
+ */
+static void
+utest_merge_apply(ESL_ALPHABET *abc)
+{
+  char     *msg = "p7_tmask merge/apply unit test failed";
+  P7_TMASK *tm  = p7_tmask_Create();
+  ESL_SQ   *sq  = esl_sq_CreateDigital(abc);
+  int64_t   nmasked;
+  int       i;
+
+  p7_tmask_Add(tm, 40, 30);
+  p7_tmask_Add(tm, 5, 10);
+  p7_tmask_Add(tm, 11, 12);
+  p7_tmask_Add(tm, 35, 45);
+  p7_tmask_Finalize(tm);
+  if (tm->nseg != 2)                                 esl_fatal(msg);
+  if (tm->seg[0].beg != 5  || tm->seg[0].end != 12)  esl_fatal(msg);
+  if (tm->seg[1].beg != 30 || tm->seg[1].end != 45)  esl_fatal(msg);
+
+  /* window 101..21 of the bottom strand: dsq[i] is position 101-i+1 */
+  esl_sq_GrowTo(sq, 81);
+  sq->n     = 81;
+  sq->start = 101;
+  sq->end   = 21;
+  for (i = 1; i <= sq->n; i++) sq->dsq[i] = 0;
+  sq->dsq[sq->n+1] = eslDSQ_SENTINEL;
+  p7_tmask_Apply(tm, sq, &nmasked);
+  if (nmasked != 16) esl_fatal(msg);
+  for (i = 1; i <= sq->n; i++)
+    if (esl_abc_XIsUnknown(abc, sq->dsq[i]) != (101-i+1 >= 30 && 101-i+1 <= 45)) esl_fatal(msg);
+
+  if (p7_tmask_Count(tm, 21, 101) != 16) esl_fatal(msg);
+  if (p7_tmask_Count(tm, 1, 4)    != 0)  esl_fatal(msg);
+  if (p7_tmask_Count(tm, 8, 35)   != 11) esl_fatal(msg);
+
+  esl_sq_Destroy(sq);
+  p7_tmask_Destroy(tm);
+}
+
+/* A BED file written by p7_tmask_WriteBED() reads back to the same spans. */
+static void
+utest_bed(void)
+{
+  char        *msg       = "p7_tmask BED unit test failed";
+  char         tmpfile[] = "esltmpXXXXXX";
+  FILE        *fp        = NULL;
+  P7_TMASK    *tm        = p7_tmask_Create();
+  P7_TMASKDB  *db        = NULL;
+  P7_TMASK    *tm2;
+  char         errbuf[eslERRBUFSIZE];
+  int          j;
+
+  p7_tmask_SetName(tm, "chr1");
+  p7_tmask_Add(tm, 1, 64);
+  p7_tmask_Add(tm, 1000, 1100);
+  p7_tmask_Finalize(tm);
+
+  if (esl_tmpfile_named(tmpfile, &fp)          != eslOK) esl_fatal(msg);
+  fprintf(fp, "# comment\ntrack name=mask\n");
+  if (p7_tmask_WriteBED(fp, tm)                != eslOK) esl_fatal(msg);
+  fprintf(fp, "chr2\t9\t20\textra\tcolumns\n");
+  fclose(fp);
+
+  if (p7_tmaskdb_Read(tmpfile, &db, errbuf)    != eslOK) esl_fatal(msg);
+  if (db->nmask != 2)                                    esl_fatal(msg);
+  if ((tm2 = p7_tmaskdb_Get(db, "chr1")) == NULL)        esl_fatal(msg);
+  if (tm2->nseg != tm->nseg)                             esl_fatal(msg);
+  for (j = 0; j < tm->nseg; j++)
+    if (tm2->seg[j].beg != tm->seg[j].beg || tm2->seg[j].end != tm->seg[j].end) esl_fatal(msg);
+  if ((tm2 = p7_tmaskdb_Get(db, "chr2")) == NULL)        esl_fatal(msg);
+  if (tm2->nseg != 1 || tm2->seg[0].beg != 10 || tm2->seg[0].end != 20) esl_fatal(msg);
+  if (p7_tmaskdb_Get(db, "chr3") != NULL)                esl_fatal(msg);
+
+  remove(tmpfile);
+  p7_tmaskdb_Destroy(db);
+  p7_tmask_Destroy(tm);
+}
+#endif /*p7TMASK_TESTDRIVE*/
+
+/*****************************************************************
+ *= 6. Test driver
+ *****************************************************************/
+#ifdef p7TMASK_TESTDRIVE
+/*
+  gcc -o p7_tmask_utest -g -Wall -I. -L. -I../easel -L../easel -Dp7TMASK_TESTDRIVE p7_tmask.c -lhmmer -leasel -lm
+  ./p7_tmask_utest
+ */
+#include "p7_config.h"
+
+#include "easel.h"
+#include "esl_getopts.h"
+
+#include "hmmer.h"
+
+static ESL_OPTIONS options[] = {
+  /* name  type         default  env   range togs  reqs  incomp  help                   docgrp */
+  { "-h",  eslARG_NONE,    FALSE, NULL, NULL, NULL, NULL, NULL, "show help and usage",           0 },
+  { "-s",  eslARG_INT,     "42",  NULL, NULL, NULL, NULL, NULL, "set random number seed to <n>", 0 },
+  { "-L",  eslARG_INT,   "4000",  NULL, NULL, NULL, NULL, NULL, "length of the test sequence",   0 },
+  { 0,0,0,0,0,0,0,0,0,0},
+};
+static char usage[]  = "[-options]";
+static char banner[] = "test driver for p7_tmask.c";
+
+int
+main(int argc, char **argv)
+{
+  ESL_GETOPTS    *go     = p7_CreateDefaultApp(options, 0, argc, argv, banner, usage);
+  ESL_RANDOMNESS *r      = esl_randomness_CreateFast(esl_opt_GetInteger(go, "-s"));
+  ESL_ALPHABET   *abcDNA = esl_alphabet_Create(eslDNA);
+  ESL_ALPHABET   *abcAA  = esl_alphabet_Create(eslAMINO);
+  ESL_GENCODE    *gcode  = esl_gencode_Create(abcDNA, abcAA);
+
+  utest_plant(r, gcode, esl_opt_GetInteger(go, "-L"));
+  utest_merge_apply(abcDNA);
+  utest_bed();
+
+  esl_gencode_Destroy(gcode);
+  esl_alphabet_Destroy(abcAA);
+  esl_alphabet_Destroy(abcDNA);
+  esl_randomness_Destroy(r);
+  esl_getopts_Destroy(go);
+  return eslOK;
+}
+#endif /*p7TMASK_TESTDRIVE*/
+/*---------------------- end, test driver ----------------------*/
@@ -12,8 +12,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <ctype.h>
 
 #include "easel.h"
+#include "esl_vectorops.h"
+
 #include "hmmer.h"
 
 /*****************************************************************
@@ -38,6 +41,7 @@ p7_tophits_Create(void)
   ESL_ALLOC(h, sizeof(P7_TOPHITS));
   h->hit    = NULL;
   h->unsrt  = NULL;
+  h->arena  = NULL;
 
   ESL_ALLOC(h->hit,   sizeof(P7_HIT *) * default_nalloc);
   ESL_ALLOC(h->unsrt, sizeof(P7_HIT)   * default_nalloc);
@@ -48,6 +52,7 @@ p7_tophits_Create(void)
   h->is_sorted_by_sortkey = TRUE; /* but only because there's 0 hits */
   h->is_sorted_by_seqidx  = FALSE;
   h->hit[0]    = h->unsrt;        /* if you're going to call it "sorted" when it contains just one hit, you need this */
+  h->arena     = NULL;            /* created on first use by the p7_tophits_Hit*() calls */
   return h;
 
  ERROR:
@@ -153,8 +158,10 @@ p7_tophits_CreateNextHit(P7_TOPHITS *h, P7_HIT **ret_hit)
   hit->best_domain  = -1;
   hit->target_len   = 0;
   hit->frameshift   = FALSE;
+  hit->ct           = 0;
   hit->dcl          = NULL;
   hit->offset       = 0;
+  hit->in_arena     = FALSE;
 
   *ret_hit = hit;
   return eslOK;
@@ -165,6 +172,81 @@ p7_tophits_CreateNextHit(P7_TOPHITS *h, P7_HIT **ret_hit)
 }
 
 
+/* Function:  p7_tophits_HitAllocDomains()
+ * Synopsis:  Allocate a new hit's domain list in the hit list's arena.
+ *
+ * Purpose:   Allocate room for <ndom> domains for <hit>, which was
+ *            just obtained from <p7_tophits_CreateNextHit()> on <h>,
+ *            from <h>'s arena instead of with <malloc()>. The domain
+ *            list is freed with the list, not hit by hit.
+ *
+ *            A hit is either entirely arena-owned or not at all: once
+ *            this or one of the other <p7_tophits_Hit*()> calls has
+ *            been used on <hit>, its name, acc, desc, orfid and dcl
+ *            must all come from the arena (or be <NULL>).
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_tophits_HitAllocDomains(P7_TOPHITS *h, P7_HIT *hit, int ndom)
+{
+  if (h->arena == NULL && (h->arena = p7_hitarena_Create(0)) == NULL) ESL_EXCEPTION(eslEMEM, "hit arena allocation failed");
+  if ((hit->dcl = p7_hitarena_Alloc(h->arena, sizeof(P7_DOMAIN) * ndom)) == NULL) ESL_EXCEPTION(eslEMEM, "hit arena allocation failed");
+  hit->in_arena = TRUE;
+  return eslOK;
+}
+
+
+/* Function:  p7_tophits_HitInternTarget()
+ * Synopsis:  Set a new hit's target strings, shared with other hits on the target.
+ *
+ * Purpose:   Set <hit>'s name, accession and description to copies of
+ *            <name>, <acc> and <desc> in <h>'s arena, interned by
+ *            <hit->seqidx>: all hits on the same target sequence share
+ *            a single copy. An empty <acc> or <desc> is stored as
+ *            <NULL>. <hit->seqidx> must be set first.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_tophits_HitInternTarget(P7_TOPHITS *h, P7_HIT *hit, const char *name, const char *acc, const char *desc)
+{
+  if (h->arena == NULL && (h->arena = p7_hitarena_Create(0)) == NULL) ESL_EXCEPTION(eslEMEM, "hit arena allocation failed");
+  hit->in_arena = TRUE;
+  return p7_hitarena_InternTarget(h->arena, hit->seqidx, name, acc, desc, &(hit->name), &(hit->acc), &(hit->desc));
+}
+
+
+/* Function:  p7_tophits_HitSetStrings()
+ * Synopsis:  Set a new hit's name, accession and description in the arena.
+ *
+ * Purpose:   Like <p7_tophits_HitInternTarget()>, but copy <name>,
+ *            <acc> and <desc> (any of which may be <NULL>) as they
+ *            are, without interning; for hits whose "target" isn't a
+ *            sequence, as in a scan.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure.
+ */
+int
+p7_tophits_HitSetStrings(P7_TOPHITS *h, P7_HIT *hit, const char *name, const char *acc, const char *desc)
+{
+  int status;
+
+  if (h->arena == NULL && (h->arena = p7_hitarena_Create(0)) == NULL) ESL_EXCEPTION(eslEMEM, "hit arena allocation failed");
+  hit->in_arena = TRUE;
+  if ((status = p7_hitarena_Strdup(h->arena, name, -1, &(hit->name))) != eslOK) return status;
+  if ((status = p7_hitarena_Strdup(h->arena, acc,  -1, &(hit->acc)))  != eslOK) return status;
+  if ((status = p7_hitarena_Strdup(h->arena, desc, -1, &(hit->desc))) != eslOK) return status;
+  return eslOK;
+}
+
+
 
 /* Function:  p7_tophits_Add()
  * Synopsis:  Add a hit to the top hits list.
@@ -244,8 +326,10 @@ p7_tophits_Add(P7_TOPHITS *h,
   h->unsrt[h->N].nincluded  = 0;
   h->unsrt[h->N].best_domain= 0;
   h->unsrt[h->N].frameshift = FALSE;
+  h->unsrt[h->N].ct         = 0;
   h->unsrt[h->N].dcl        = NULL;
   h->unsrt[h->N].orfid      = NULL;
+  h->unsrt[h->N].in_arena   = FALSE;
   h->N++;
 
   if (h->N >= 2) {
@@ -446,6 +530,13 @@ p7_tophits_Merge(P7_TOPHITS *h1, P7_TOPHITS *h2)
   for (i = 0; i < h1->N; i++)
     h1->hit[i] = h1->unsrt + (h1->hit[i] - ori1);
 
+  /* h2's arena-owned hit data move to h1's arena */
+  if (h2->arena != NULL)
+  {
+      if (h1->arena == NULL) { h1->arena = h2->arena; h2->arena = NULL; }
+      else if ((status = p7_hitarena_Absorb(h1->arena, h2->arena)) != eslOK) goto ERROR;
+  }
+
   /* Append h2's unsorted data array to h1. h2's data begin at <new2> */
   new2 = h1->unsrt + h1->N;
   memcpy(new2, h2->unsrt, sizeof(P7_HIT) * h2->N);
@@ -668,17 +759,19 @@ p7_tophits_Reuse(P7_TOPHITS *h)
   {
     for (i = 0; i < h->N; i++)
     {
-      if (h->unsrt[i].name != NULL) free(h->unsrt[i].name);
-      if (h->unsrt[i].acc  != NULL) free(h->unsrt[i].acc);
-      if (h->unsrt[i].desc != NULL) free(h->unsrt[i].desc);
-      if (h->unsrt[i].orfid!= NULL) free(h->unsrt[i].orfid);
       if (h->unsrt[i].dcl  != NULL) {
         for (j = 0; j < h->unsrt[i].ndom; j++)
           if (h->unsrt[i].dcl[j].ad != NULL) p7_alidisplay_Destroy(h->unsrt[i].dcl[j].ad);
-        free(h->unsrt[i].dcl);
       }
+      if (h->unsrt[i].in_arena) continue; /* the rest goes with the arena */
+      if (h->unsrt[i].name != NULL) free(h->unsrt[i].name);
+      if (h->unsrt[i].acc  != NULL) free(h->unsrt[i].acc);
+      if (h->unsrt[i].desc != NULL) free(h->unsrt[i].desc);
+      if (h->unsrt[i].orfid!= NULL) free(h->unsrt[i].orfid);
+      if (h->unsrt[i].dcl  != NULL) free(h->unsrt[i].dcl);
     }
   }
+  p7_hitarena_Reuse(h->arena);
   h->N         = 0;
   h->is_sorted_by_seqidx = FALSE;
   h->is_sorted_by_sortkey = TRUE;  /* because there are 0 hits */
@@ -699,10 +792,6 @@ p7_tophits_Destroy(P7_TOPHITS *h)
   {
     for (i = 0; i < h->N; i++)
     {
-      if (h->unsrt[i].name  != NULL) free(h->unsrt[i].name);
-      if (h->unsrt[i].acc   != NULL) free(h->unsrt[i].acc);
-      if (h->unsrt[i].desc  != NULL) free(h->unsrt[i].desc);
-      if (h->unsrt[i].orfid != NULL) free(h->unsrt[i].orfid);
       if (h->unsrt[i].dcl   != NULL) {
         for (j = 0; j < h->unsrt[i].ndom; j++) {
 
@@ -710,11 +799,17 @@ p7_tophits_Destroy(P7_TOPHITS *h)
           if (h->unsrt[i].dcl[j].tr             != NULL) p7_trace_fs_Destroy(h->unsrt[i].dcl[j].tr);
 	  if (h->unsrt[i].dcl[j].scores_per_pos != NULL) free (h->unsrt[i].dcl->scores_per_pos);
 	}
-        free(h->unsrt[i].dcl);
       }
+      if (h->unsrt[i].in_arena) continue; /* the rest goes with the arena */
+      if (h->unsrt[i].name  != NULL) free(h->unsrt[i].name);
+      if (h->unsrt[i].acc   != NULL) free(h->unsrt[i].acc);
+      if (h->unsrt[i].desc  != NULL) free(h->unsrt[i].desc);
+      if (h->unsrt[i].orfid != NULL) free(h->unsrt[i].orfid);
+      if (h->unsrt[i].dcl   != NULL) free(h->unsrt[i].dcl);
     }
     free(h->unsrt);
   }
+  p7_hitarena_Destroy(h->arena);
   free(h);
   return;
 }
@@ -1490,6 +1585,12 @@ p7_tophits_Domains(FILE *ofp, P7_TOPHITS *th, P7_PIPELINE *pli, int textw)
         if (fprintf(ofp, ">> %s  %s\n",    showname,        (th->hit[h]->desc == NULL ? "" : th->hit[h]->desc)) < 0)
           ESL_EXCEPTION_SYS(eslEWRITE, "domain hit list: write failed");
       }
+
+      if (pli->frameshift && th->hit[h]->ct > 0) /* bathsearch --ctlist: which genetic code found it */
+      {
+        if (fprintf(ofp, "   [NCBI translation table %d]\n", th->hit[h]->ct) < 0)
+          ESL_EXCEPTION_SYS(eslEWRITE, "domain hit list: write failed");
+      }
     
       if (th->hit[h]->nreported == 0)
       {
@@ -1832,6 +1933,145 @@ p7_tophits_Alignment(const P7_TOPHITS *th, const ESL_ALPHABET *abc,
   return status;
 }
 
+/* Function:  p7_tophits_StreamAlignment()
+ * Synopsis:  Write a model-anchored alignment of all included domains.
+ *
+ * Purpose:   Write an alignment of all domains marked "includable" in
+ *            the sorted top hits list <th>, from query <qname> of
+ *            length <M>, to stream <ofp> in format <fmt>, one row at
+ *            a time straight from each domain's <P7_ALIDISPLAY>.
+ *            Rows are the (translated) target residues, anchored on
+ *            the <M> consensus columns of the query.
+ *
+ *            Unlike <p7_tophits_Alignment()>, no traces, sequences or
+ *            <ESL_MSA> are built: besides one row buffer, only the
+ *            most residues any row inserts after each consensus
+ *            column are kept, so memory doesn't grow with the number
+ *            of hits.
+ *
+ *            <fmt> is one of:
+ *              <p7_STREAMALI_STOCKHOLM>: one-line-per-sequence
+ *                Stockholm with an RF line; inserts are lowercase,
+ *                padded with '.' to the widest insert in the column;
+ *              <p7_STREAMALI_A2M>: A2M; inserts are lowercase and not
+ *                padded (so rows differ in length), as A2M defines;
+ *              <p7_STREAMALI_PSIBLAST>: PSI-BLAST; like Stockholm,
+ *                but gaps in inserts are '-'.
+ *            If <matchonly> is TRUE, insert columns are dropped and
+ *            every row has exactly <M> columns.
+ *
+ *            Stockholm alignments end with a "//" line, so successive
+ *            queries can be written to one stream; in A2M and
+ *            PSI-BLAST format they just follow one another.
+ *
+ *            Nothing is written if there are no included domains.
+ *
+ * Returns:   <eslOK> on success.
+ *
+ * Throws:    <eslEMEM> on allocation failure;
+ *            <eslEINVAL> if a domain extends past consensus column <M>;
+ *            <eslEWRITE> if a write to <ofp> fails.
+ */
+int
+p7_tophits_StreamAlignment(FILE *ofp, const char *qname, const P7_TOPHITS *th, int M, int fmt, int matchonly)
+{
+  P7_ALIDISPLAY *ad     = NULL;
+  int           *maxins = NULL;     /* maxins[k]: most residues any row inserts after consensus column k; 1..M */
+  char          *row    = NULL;
+  int64_t        alen   = M;        /* width of a padded row */
+  int            namew  = 0;
+  int            nrow   = 0;
+  int            pad    = (fmt == p7_STREAMALI_STOCKHOLM ? '.' : '-');
+  int            padded = (fmt != p7_STREAMALI_A2M && ! matchonly);
+  int            h, d, k, z, n, x;
+  int            status;
+
+  ESL_ALLOC(maxins, sizeof(int) * (M+1));
+  esl_vec_ISet(maxins, M+1, 0);
+
+  /* First pass: name width, and the insert maxima that fix the column layout */
+  for (h = 0; h < th->N; h++)
+    if (th->hit[h]->flags & p7_IS_INCLUDED)
+      for (d = 0; d < th->hit[h]->ndom; d++)
+        if (th->hit[h]->dcl[d].is_included)
+          {
+            ad = th->hit[h]->dcl[d].ad;
+            if (ad->hmmto > M) ESL_XEXCEPTION(eslEINVAL, "domain on %s ends at consensus column %d of %d", th->hit[h]->name, ad->hmmto, M);
+            namew = ESL_MAX(namew, snprintf(NULL, 0, "%s/%" PRId64 "-%" PRId64, th->hit[h]->name, th->hit[h]->dcl[d].iali, th->hit[h]->dcl[d].jali));
+            for (k = ad->hmmfrom - 1, n = 0, z = 0; z < ad->N; z++)
+              if (ad->model[z] == '.') n++;
+              else { if (k > 0) maxins[k] = ESL_MAX(maxins[k], n); n = 0; k++; }
+            nrow++;
+          }
+  if (nrow == 0) { free(maxins); return eslOK; }
+  for (k = 1; k <= M; k++) alen += maxins[k];
+
+  ESL_ALLOC(row, sizeof(char) * (alen+1));
+
+  if (fmt == p7_STREAMALI_STOCKHOLM)
+    {
+      if (fprintf(ofp, "# STOCKHOLM 1.0\n")    < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "alignment stream: write failed");
+      if (fprintf(ofp, "#=GF ID %s\n\n", qname) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "alignment stream: write failed");
+      namew = ESL_MAX(namew, 7);   /* "#=GC RF" */
+    }
+
+  /* Second pass: one row per included domain, in rank order */
+  for (h = 0; h < th->N; h++)
+    if (th->hit[h]->flags & p7_IS_INCLUDED)
+      for (d = 0; d < th->hit[h]->ndom; d++)
+        if (th->hit[h]->dcl[d].is_included)
+          {
+            ad = th->hit[h]->dcl[d].ad;
+            for (x = 0, z = 0, k = 1; k <= M; k++)
+              {
+                if (k < ad->hmmfrom || k > ad->hmmto) { row[x++] = '-'; n = 0; }
+                else
+                  {
+                    row[x++] = ad->aseq[z++];
+                    for (n = 0; z < ad->N && ad->model[z] == '.'; z++, n++)
+                      if (! matchonly) row[x++] = tolower(ad->aseq[z]);
+                  }
+                if (padded) for (; n < maxins[k]; n++) row[x++] = pad;
+              }
+            row[x] = '\0';
+
+            if (fmt == p7_STREAMALI_A2M)
+              {
+                if (fprintf(ofp, ">%s/%" PRId64 "-%" PRId64 "%s%s\n", th->hit[h]->name, th->hit[h]->dcl[d].iali, th->hit[h]->dcl[d].jali,
+                            (th->hit[h]->desc != NULL ? " " : ""), (th->hit[h]->desc != NULL ? th->hit[h]->desc : "")) < 0)
+                  ESL_XEXCEPTION_SYS(eslEWRITE, "alignment stream: write failed");
+                for (z = 0; z < x; z += 60)
+                  if (fprintf(ofp, "%.60s\n", row+z) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "alignment stream: write failed");
+              }
+            else
+              {
+                n = fprintf(ofp, "%s/%" PRId64 "-%" PRId64, th->hit[h]->name, th->hit[h]->dcl[d].iali, th->hit[h]->dcl[d].jali);
+                if (n < 0 || fprintf(ofp, "%*s %s\n", namew - n, "", row) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "alignment stream: write failed");
+              }
+          }
+
+  if (fmt == p7_STREAMALI_STOCKHOLM)
+    {
+      for (x = 0, k = 1; k <= M; k++)
+        {
+          row[x++] = 'x';
+          if (padded) for (n = 0; n < maxins[k]; n++) row[x++] = '.';
+        }
+      row[x] = '\0';
+      if (fprintf(ofp, "%-*s %s\n//\n", namew, "#=GC RF", row) < 0) ESL_XEXCEPTION_SYS(eslEWRITE, "alignment stream: write failed");
+    }
+
+  free(row);
+  free(maxins);
+  return eslOK;
+
+ ERROR:
+  if (row)    free(row);
+  if (maxins) free(maxins);
+  return status;
+}
+
+
 /* Function:  p7_tophits_CreateCigarString()
  * Synopsis:  Coonvert trace to a CIGAR string for tabular ouput - BATH.
  *
@@ -2973,6 +3213,76 @@ static ESL_OPTIONS options[] = {
 static char usage[]  = "[-options]";
 static char banner[] = "test driver for P7_TOPHITS";
 
+/* utest_stream_alignment()
+ * Included domains with random alignments, written in each format:
+ * every row must cover all <M> consensus columns, and in the padded
+ * formats every row must be as wide as the RF line.
+ */
+static void
+utest_stream_alignment(ESL_RANDOMNESS *r, int N)
+{
+  char        *msg   = "StreamAlignment() unit test failed";
+  P7_TOPHITS  *th    = p7_tophits_Create();
+  P7_HIT      *hit   = NULL;
+  FILE        *fp    = NULL;
+  char         line[4096];
+  char        *tok;
+  int          M     = 0;
+  int          fmt, matchonly;
+  int          i, n, nrow, ncons, width;
+
+  for (i = 0; i < N; i++)
+    {
+      if (p7_tophits_CreateNextHit(th, &hit)                   != eslOK) esl_fatal(msg);
+      hit->seqidx  = i;
+      hit->sortkey = esl_random(r);
+      hit->flags  |= p7_IS_INCLUDED;
+      hit->ndom    = 1;
+      if (p7_tophits_HitAllocDomains(th, hit, 1)               != eslOK) esl_fatal(msg);
+      memset(hit->dcl, 0, sizeof(P7_DOMAIN));
+      hit->dcl[0].is_included = TRUE;
+      hit->dcl[0].iali = 1 + i;
+      hit->dcl[0].jali = 1 + i + 3 * esl_rnd_Roll(r, 100);
+      if (p7_alidisplay_Sample(r, 2 + esl_rnd_Roll(r, 100), &(hit->dcl[0].ad)) != eslOK) esl_fatal(msg);
+      if (p7_tophits_HitInternTarget(th, hit, "target", NULL, (i % 2 ? "desc" : NULL)) != eslOK) esl_fatal(msg);
+      M = ESL_MAX(M, hit->dcl[0].ad->M);
+    }
+  p7_tophits_SortBySortkey(th);
+
+  for (fmt = p7_STREAMALI_STOCKHOLM; fmt <= p7_STREAMALI_PSIBLAST; fmt++)
+    for (matchonly = FALSE; matchonly <= TRUE; matchonly++)
+      {
+        if ((fp = tmpfile()) == NULL) esl_fatal(msg);
+        if (p7_tophits_StreamAlignment(fp, "query", th, M, fmt, matchonly) != eslOK) esl_fatal(msg);
+        rewind(fp);
+
+        nrow = 0; ncons = -1; width = -1;
+        while (fgets(line, sizeof(line), fp) != NULL)
+          {
+            if (line[0] == '\n' || strncmp(line, "# STOCKHOLM", 11) == 0 || strncmp(line, "#=GF", 4) == 0 || strncmp(line, "//", 2) == 0) continue;
+            if (fmt == p7_STREAMALI_A2M)
+              {
+                if (line[0] == '>') { if (ncons != -1 && ncons != M) esl_fatal(msg); ncons = 0; nrow++; continue; }
+                for (tok = line; *tok != '\n'; tok++)
+                  if (isupper(*tok) || *tok == '-' || *tok == '*') ncons++;
+                  else if (matchonly) esl_fatal(msg);
+                continue;
+              }
+            if (strncmp(line, "#=GC RF", 7) == 0) tok = line + 7;
+            else { tok = strchr(line, ' '); nrow++; }
+            while (*tok == ' ') tok++;
+            n = strcspn(tok, "\n");
+            if (width == -1) width = n;
+            if (n != width || (matchonly && n != M) || n < M) esl_fatal(msg);
+          }
+        if (fmt == p7_STREAMALI_A2M && ncons != M) esl_fatal(msg);
+        if (nrow != N) esl_fatal(msg);
+        fclose(fp);
+      }
+
+  p7_tophits_Destroy(th);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -2982,6 +3292,7 @@ main(int argc, char **argv)
   P7_TOPHITS     *h1       = NULL;
   P7_TOPHITS     *h2       = NULL;
   P7_TOPHITS     *h3       = NULL;
+  P7_HIT         *hit      = NULL;
   char            name[]   = "not_unique_name";
   char            acc[]    = "not_unique_acc";
   char            desc[]   = "Test description for the purposes of making the test driver allocate space";
@@ -3000,7 +3311,18 @@ main(int argc, char **argv)
       p7_tophits_Add(h2, name, acc, desc, key, (float) key, key, (float) key, key, i, i, N, i, i, N, 2, 2, NULL);
       key = 0.1 * esl_random(r);
       p7_tophits_Add(h3, name, acc, desc, key, (float) key, key, (float) key, key, i, i, N, i, i, N, 3, 3, NULL);
+
+      /* and a hit whose strings and domains live in h2's arena */
+      if (p7_tophits_CreateNextHit(h2, &hit)                      != eslOK) esl_fatal("CreateNextHit() failed");
+      hit->seqidx  = i % 10;
+      hit->sortkey = 5.0 * esl_random(r);
+      hit->ndom    = 1;
+      if (p7_tophits_HitAllocDomains(h2, hit, 1)                  != eslOK) esl_fatal("HitAllocDomains() failed");
+      memset(hit->dcl, 0, sizeof(P7_DOMAIN));
+      if (p7_tophits_HitInternTarget(h2, hit, name, "", desc)     != eslOK) esl_fatal("HitInternTarget() failed");
+      if (hit->acc != NULL || strcmp(hit->desc, desc) != 0)                 esl_fatal("HitInternTarget() failed");
   }
+  if (h2->arena == NULL || h2->arena->ntgt != ESL_MIN(N, 10))               esl_fatal("HitInternTarget() didn't intern");
   p7_tophits_Add(h1, "last",  NULL, NULL, -1.0, (float) key, key, (float) key, key, i, i, N, i, i, N, 1, 1, NULL);
   p7_tophits_Add(h1, "first", NULL, NULL, 20.0, (float) key, key, (float) key, key, i, i, N, i, i, N, 1, 1, NULL);
 
@@ -3010,17 +3332,21 @@ main(int argc, char **argv)
 
   p7_tophits_Merge(h1, h2);
   if (strcmp(h1->hit[0]->name,     "first") != 0) esl_fatal("after merge 1, sort failed (top is %s = %f)", h1->hit[0]->name,     h1->hit[0]->sortkey);
-  if (strcmp(h1->hit[2*N+1]->name, "last")  != 0) esl_fatal("after merge 1, sort failed (last is %s = %f)", h1->hit[2*N+1]->name, h1->hit[2*N+1]->sortkey);
+  if (strcmp(h1->hit[3*N+1]->name, "last")  != 0) esl_fatal("after merge 1, sort failed (last is %s = %f)", h1->hit[3*N+1]->name, h1->hit[3*N+1]->sortkey);
 
   p7_tophits_Merge(h3, h1);
   if (strcmp(h3->hit[0]->name,     "first") != 0) esl_fatal("after merge 2, sort failed (top is %s = %f)", h3->hit[0]->name,     h3->hit[0]->sortkey);
-  if (strcmp(h3->hit[3*N+1]->name, "last")  != 0) esl_fatal("after merge 2, sort failed (last is %s = %f)", h3->hit[3*N+1]->name,     h3->hit[3*N+1]->sortkey);
-  
-  if (p7_tophits_GetMaxNameLength(h3) != strlen(name)) esl_fatal("GetMaxNameLength() failed");
+  if (strcmp(h3->hit[4*N+1]->name, "last")  != 0) esl_fatal("after merge 2, sort failed (last is %s = %f)", h3->hit[4*N+1]->name,     h3->hit[4*N+1]->sortkey);
 
+  /* arena-owned hits now belong to h3, and outlive the lists they came from */
   p7_tophits_Destroy(h1);
   p7_tophits_Destroy(h2);
+  if (p7_tophits_GetMaxNameLength(h3) != strlen(name)) esl_fatal("GetMaxNameLength() failed");
+
   p7_tophits_Destroy(h3);
+
+  utest_stream_alignment(r, N);
+
   esl_randomness_Destroy(r);
   esl_getopts_Destroy(go);
   return eslOK;
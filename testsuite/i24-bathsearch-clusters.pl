@@ -0,0 +1,95 @@
+#! /usr/bin/perl
+
+# Measure what bathsearch --clusters loses against a full search.
+#
+# Clusters the query library with bathcluster, then searches the
+# target DNA three ways: a full search, a serial --clusters search,
+# and (in a threaded build) a --clusters search on two worker threads.
+# Reports how many of the full search's hits (and of its included
+# hits) the cluster screen recovered. Fails if the screen loses an included hit,
+# or if the serial and threaded --clusters searches disagree.
+#
+# Usage:    ./i24-bathsearch-clusters.pl <bathcluster> <bathsearch> <hmmfile> <DNA seqfile> <tmpfile prefix>
+# Example:  ./i24-bathsearch-clusters.pl ../src/bathcluster ../src/bathsearch minifam.bhmm 2OG-FeII_Oxy_3-nt.fa tmpfoo
+
+$bathcluster = shift;
+$bathsearch  = shift;
+$hmmfile     = shift;
+$seqfile     = shift;
+$tmppfx      = shift;
+
+$incE = 0.01;
+
+if (! -x "$bathcluster") { die "FAIL: didn't find bathcluster binary $bathcluster\n"; }
+if (! -x "$bathsearch")  { die "FAIL: didn't find bathsearch binary $bathsearch\n";   }
+if (! -e "$hmmfile")     { die "FAIL: didn't find HMM file $hmmfile\n";               }
+if (! -e "$seqfile")     { die "FAIL: didn't find sequence file $seqfile\n";          }
+
+# Without thread support there's no --cpu, and only the serial searches run.
+$help     = `$bathsearch -h 2>&1`;
+$threaded = ($help =~ /--cpu/) ? 1 : 0;
+$serial   = $threaded ? "--cpu 0" : "";
+
+`$bathcluster -o $tmppfx.bclust $hmmfile 2>&1`;
+if ($? != 0) { die "FAIL: bathcluster failed\n"; }
+
+`$bathsearch $serial --tblout $tmppfx.full.tbl $hmmfile $seqfile 2>&1`;
+if ($? != 0) { die "FAIL: full bathsearch failed\n"; }
+`$bathsearch $serial --clusters --clusterfile $tmppfx.bclust --tblout $tmppfx.cl1.tbl $hmmfile $seqfile 2>&1`;
+if ($? != 0) { die "FAIL: bathsearch --clusters failed\n"; }
+if ($threaded) {
+    `$bathsearch --cpu 2 --clusters --clusterfile $tmppfx.bclust --tblout $tmppfx.cl2.tbl $hmmfile $seqfile 2>&1`;
+    if ($? != 0) { die "FAIL: threaded bathsearch --clusters failed\n"; }
+}
+
+%full = &read_hits("$tmppfx.full.tbl");
+%cl1  = &read_hits("$tmppfx.cl1.tbl");
+%cl2  = $threaded ? &read_hits("$tmppfx.cl2.tbl") : %cl1;
+
+$n = $ninc = $nfound = $nincfound = 0;
+foreach $key (keys %full)
+{
+    $n++;
+    if ($full{$key} <= $incE) { $ninc++; }
+    if (exists $cl1{$key})
+    {
+        $nfound++;
+        if ($full{$key} <= $incE) { $nincfound++; }
+    }
+    elsif ($full{$key} <= $incE) { print "lost included hit: $key (E=$full{$key})\n"; }
+}
+printf("--clusters recovered %d of %d hits (%.1f%% lost), %d of %d included hits (%.1f%% lost)\n",
+       $nfound,    $n,    ($n    ? 100. * ($n    - $nfound)    / $n    : 0.),
+       $nincfound, $ninc, ($ninc ? 100. * ($ninc - $nincfound) / $ninc : 0.));
+if ($nincfound < $ninc) { die "FAIL: --clusters lost included hits\n"; }
+
+foreach $key (keys %cl1) { if (! exists $cl2{$key}) { die "FAIL: threaded --clusters missed $key\n"; } }
+foreach $key (keys %cl2) { if (! exists $cl1{$key}) { die "FAIL: threaded --clusters added $key\n";  } }
+
+print "ok\n";
+unlink "$tmppfx.bclust";
+unlink "$tmppfx.full.tbl";
+unlink "$tmppfx.cl1.tbl";
+unlink "$tmppfx.cl2.tbl";
+exit 0;
+
+
+# Hits in a --tblout file, keyed by target, query and alignment
+# coordinates; the value is the E-value.
+sub read_hits
+{
+    my ($tblfile) = @_;
+    my %hits;
+    my @f;
+
+    open(TBL, $tblfile) || die "FAIL: couldn't open $tblfile\n";
+    while (<TBL>)
+    {
+        next if /^\#/;
+        @f = split;
+        next if $#f < 12;
+        $hits{"$f[0] $f[2] $f[8] $f[9]"} = $f[12];
+    }
+    close TBL;
+    return %hits;
+}
@@ -0,0 +1,237 @@
+#! /usr/bin/perl
+
+# Check bathsearch --regions against a full search.
+#
+# Builds a target database of two random DNA sequences with members
+# of the query's family planted at known places, indexes it with
+# esl-sfetch --index, and searches it in full and with --regions on a
+# BED file of intervals:
+#   - two short intervals inside one planted hit, whose spans merge
+#     once widened by the window length, and which find the hit whole
+#     only as one span;
+#   - a short interval inside another planted hit, which finds it
+#     whole only once widened;
+#   - an interval longer than --block_length, with a planted hit
+#     straddling the overlap of its first two blocks and one planted
+#     wholly in each block;
+#   - a short interval on the second sequence;
+# and one planted hit outside every interval, which must not be found.
+#
+# Every hit the --regions search reports must be a full-search hit,
+# reported once, with the same coordinates and (to the precision
+# --tblout prints) the same E-value. With --regions_searched, the
+# residue count must be that of the widened, blocked spans, and
+# E-values must scale by it over the size of the database.
+#
+# Usage:    ./i25-bathsearch-regions.pl <bathsearch> <esl-sfetch> <hmmfile> <DNA seqfile> <tmpfile prefix>
+# Example:  ./i25-bathsearch-regions.pl ../src/bathsearch ../easel/miniapps/esl-sfetch 2OG-FeII_Oxy_3.bhmm 2OG-FeII_Oxy_3-nt.fa tmpfoo
+
+$bathsearch = shift;
+$sfetch     = shift;
+$hmmfile    = shift;
+$seqfile    = shift;
+$tmppfx     = shift;
+
+$B = 50000;   # --block_length; the smallest allowed
+
+if (! -x "$bathsearch") { die "FAIL: didn't find bathsearch binary $bathsearch\n"; }
+if (! -x "$sfetch")     { die "FAIL: didn't find esl-sfetch binary $sfetch\n";     }
+if (! -e "$hmmfile")    { die "FAIL: didn't find HMM file $hmmfile\n";             }
+if (! -e "$seqfile")    { die "FAIL: didn't find sequence file $seqfile\n";        }
+
+# The window length regions are widened by is the model's MAXL.
+$W = 0;
+open(HMM, $hmmfile) || die "FAIL: couldn't open $hmmfile\n";
+while (<HMM>) { if (/^MAXL\s+(\d+)/) { $W = $1; last; } }
+close HMM;
+if ($W == 0) { die "FAIL: no MAXL line in $hmmfile\n"; }
+
+@planted = &read_fasta($seqfile);
+if ($#planted < 6) { die "FAIL: need at least 7 sequences in $seqfile\n"; }
+
+# Two random sequences, with the family members planted at 1-based
+# positions. 'in' is 1 for a plant inside an interval.
+srand(42);
+%tlen = ("regions1" => 130000, "regions2" => 4000);
+@plants = ( [ "regions1",  10001, 0, 1 ],   # inside merged intervals I0a, I0b
+            [ "regions1",  20001, 1, 1 ],   # inside I1
+            [ "regions1",  89701, 2, 1 ],   # straddles the end of I2's first block
+            [ "regions1",  60001, 3, 1 ],   # in I2's first block
+            [ "regions1",  95001, 4, 1 ],   # in I2's second block only
+            [ "regions1", 115001, 5, 0 ],   # outside every interval
+            [ "regions2",   1501, 6, 1 ] ); # inside I3
+foreach $t (sort keys %tlen) { $tseq{$t} = join("", map { ("A","C","G","T")[int(rand(4))] } (1..$tlen{$t})); }
+foreach $p (@plants)
+{
+    ($t, $pos, $i, $in) = @$p;
+    substr($tseq{$t}, $pos-1, length($planted[$i])) = $planted[$i];
+    $p->[4] = $pos + length($planted[$i]) - 1;
+}
+
+open(DB, ">$tmppfx.fa") || die "FAIL: couldn't write $tmppfx.fa\n";
+foreach $t (sort keys %tlen) { print DB ">$t\n"; for ($x = 0; $x < $tlen{$t}; $x += 60) { print DB substr($tseq{$t}, $x, 60), "\n"; } }
+close DB;
+
+# BED: 0-based start, end-exclusive. I0a and I0b lie 150 apart, well
+# within 2W, inside plant 0; neither one widened reaches both of its ends.
+@bed = ( [ "regions1", 10050, 10060 ],    # I0a
+         [ "regions1", 10200, 10210 ],    # I0b
+         [ "regions1", 20100, 20140 ],    # I1
+         [ "regions1", 40000, 100000 ],   # I2
+         [ "regions2",  1600,  1650 ] );  # I3
+open(BED, ">$tmppfx.bed") || die "FAIL: couldn't write $tmppfx.bed\n";
+foreach $r (@bed) { print BED join("\t", @$r), "\n"; }
+close BED;
+
+`$sfetch --index $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: esl-sfetch --index failed\n"; }
+
+# regions_loop() runs serially; so does the full search here.
+$help   = `$bathsearch -h 2>&1`;
+$serial = ($help =~ /--cpu/) ? "--cpu 0" : "";
+
+`$bathsearch $serial --tblout $tmppfx.full.tbl $hmmfile $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: full bathsearch failed\n"; }
+`$bathsearch $serial --block_length $B --regions $tmppfx.bed --tblout $tmppfx.rg.tbl $hmmfile $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: bathsearch --regions failed\n"; }
+`$bathsearch $serial --block_length $B --regions $tmppfx.bed --regions_searched -o $tmppfx.rgs.out --tblout $tmppfx.rgs.tbl $hmmfile $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: bathsearch --regions --regions_searched failed\n"; }
+
+%full = &read_hits("$tmppfx.full.tbl");
+%rg   = &read_hits("$tmppfx.rg.tbl");
+%rgs  = &read_hits("$tmppfx.rgs.tbl");
+
+# Each --regions hit is a full-search hit, with its E-value.
+foreach $key (keys %rg)
+{
+    if ($rg{$key}{n} > 1)      { die "FAIL: --regions reported $key $rg{$key}{n} times\n"; }
+    if (! exists $full{$key})  { die "FAIL: --regions hit $key isn't a full-search hit\n"; }
+    if (! &same_E($rg{$key}{E}, $full{$key}{E})) { die "FAIL: --regions E-value $rg{$key}{E} for $key; full search $full{$key}{E}\n"; }
+}
+
+# Each plant in an interval is found, and the one outside isn't.
+foreach $p (@plants)
+{
+    ($t, $pos, $i, $in, $end) = @$p;
+    $key = &hit_on($t, $pos, $end, %full);
+    if ($key eq "") { die "FAIL: full search missed the family member planted at $t/$pos-$end\n"; }
+    if ($in  && ! exists $rg{$key}) { die "FAIL: --regions missed $key\n"; }
+    if (! $in &&  exists $rg{$key}) { die "FAIL: --regions found $key, outside every interval\n"; }
+}
+
+# --regions_searched: residues of every block of every widened,
+# merged span, on both strands, and E-values scaled to match.
+%iv = ();
+foreach $r (@bed) { push @{$iv{$r->[0]}}, [ $r->[1]+1, $r->[2] ]; }
+$nres = 0;
+foreach $t (keys %iv)
+{
+    @segs = sort { $a->[0] <=> $b->[0] } @{$iv{$t}};
+    for ($s = 0; $s <= $#segs; $s++)
+    {
+        $beg = &max(1,          $segs[$s][0] - $W);
+        $end = &min($tlen{$t},  $segs[$s][1] + $W);
+        while ($s < $#segs && $segs[$s+1][0] - $W <= $end + 1) { $s++; $end = &min($tlen{$t}, $segs[$s][1] + $W); }
+        for ($wbeg = $beg; ; $wbeg += &max(1, $B - $W))
+        {
+            $wend  = &min($end, $wbeg + $B - 1);
+            if ($wend - $wbeg + 1 >= 15) { $nres += 2 * ($wend - $wbeg + 1); }
+            last if $wend == $end;
+        }
+    }
+}
+$searched = -1;
+open(OUT, "$tmppfx.rgs.out") || die "FAIL: couldn't open $tmppfx.rgs.out\n";
+while (<OUT>) { if (/\((\d+) residues searched\)/) { $searched = $1; } }
+close OUT;
+if ($searched != $nres) { die "FAIL: --regions searched $searched residues; expected $nres\n"; }
+
+$dbres = 0;
+foreach $t (keys %tlen) { $dbres += $tlen{$t}; }
+$ratio = $nres / (2 * $dbres);
+foreach $key (keys %rg)
+{
+    if (! exists $rgs{$key}) { die "FAIL: --regions_searched missed $key\n"; }
+    if ($rg{$key}{E} > 0 && abs($rgs{$key}{E} / $rg{$key}{E} - $ratio) > 0.1 * $ratio)
+    { die "FAIL: --regions_searched E-value $rgs{$key}{E} for $key; expected about " . ($rg{$key}{E} * $ratio) . "\n"; }
+}
+
+print "ok\n";
+unlink "$tmppfx.fa";
+unlink "$tmppfx.fa.ssi";
+unlink "$tmppfx.bed";
+unlink "$tmppfx.full.tbl";
+unlink "$tmppfx.rg.tbl";
+unlink "$tmppfx.rgs.tbl";
+unlink "$tmppfx.rgs.out";
+exit 0;
+
+
+# Sequences of a FASTA file, in order, upper case.
+sub read_fasta
+{
+    my ($fafile) = @_;
+    my @seqs;
+    my $n = -1;
+
+    open(FA, $fafile) || die "FAIL: couldn't open $fafile\n";
+    while (<FA>)
+    {
+        chomp;
+        if (/^>/) { $n++; $seqs[$n] = ""; next; }
+        s/\s//g;
+        $seqs[$n] .= uc($_);
+    }
+    close FA;
+    return @seqs;
+}
+
+# Hits in a --tblout file, keyed by target, query and alignment
+# coordinates; each has its E-value and the number of times it's there.
+sub read_hits
+{
+    my ($tblfile) = @_;
+    my %hits;
+    my @f;
+    my $key;
+
+    open(TBL, $tblfile) || die "FAIL: couldn't open $tblfile\n";
+    while (<TBL>)
+    {
+        next if /^\#/;
+        @f = split;
+        next if $#f < 12;
+        $key = "$f[0] $f[2] $f[8] $f[9]";
+        $hits{$key}{E} = $f[12];
+        $hits{$key}{n}++;
+    }
+    close TBL;
+    return %hits;
+}
+
+# The hit whose alignment overlaps <beg..end> of target <t>, or "".
+sub hit_on
+{
+    my ($t, $beg, $end, %hits) = @_;
+    my ($key, $tname, $qname, $from, $to);
+
+    foreach $key (keys %hits)
+    {
+        ($tname, $qname, $from, $to) = split(' ', $key);
+        next if $tname ne $t;
+        if ($from > $to) { ($from, $to) = ($to, $from); }
+        return $key if $from <= $end && $to >= $beg;
+    }
+    return "";
+}
+
+# E-values equal to the two digits --tblout prints.
+sub same_E
+{
+    my ($e1, $e2) = @_;
+    return 1 if $e1 == $e2;
+    return abs($e1 - $e2) <= 0.05 * &max($e1, $e2);
+}
+
+sub min { my ($x, $y) = @_; return ($x < $y) ? $x : $y; }
+sub max { my ($x, $y) = @_; return ($x > $y) ? $x : $y; }
@@ -0,0 +1,141 @@
+#! /usr/bin/perl
+
+# Check that bathsearch --mpi reports what a serial search does.
+#
+# Builds a target database of four random 1.5 Mb DNA sequences with
+# members of the query's family planted in each; that's two of the
+# 4 Mb blocks the MPI master hands out, so with two workers each
+# searches one, and hits in the second block carry sequence indices
+# offset by the first. Searches it serially and under mpirun, and
+# requires the same --tblout hit lines and the same residue count.
+#
+# Passes without searching if bathsearch wasn't built with MPI support
+# (no --mpi in its help) or if there's no mpirun or mpiexec on the
+# PATH. Set MPIRUN to override the launcher, e.g.
+# MPIRUN="mpirun --oversubscribe".
+#
+# Usage:    ./i26-bathsearch-mpi.pl <bathsearch> <hmmfile> <DNA seqfile> <tmpfile prefix>
+# Example:  ./i26-bathsearch-mpi.pl ../src/bathsearch 2OG-FeII_Oxy_3.bhmm 2OG-FeII_Oxy_3-nt.fa tmpfoo
+
+$bathsearch = shift;
+$hmmfile    = shift;
+$seqfile    = shift;
+$tmppfx     = shift;
+
+$ntarget = 4;
+$tlen    = 1500000;
+@ppos    = (100001, 700001, 1300001);   # 1-based plant positions in each target
+
+if (! -x "$bathsearch") { die "FAIL: didn't find bathsearch binary $bathsearch\n"; }
+if (! -e "$hmmfile")    { die "FAIL: didn't find HMM file $hmmfile\n";             }
+if (! -e "$seqfile")    { die "FAIL: didn't find sequence file $seqfile\n";        }
+
+$help = `$bathsearch -h 2>&1`;
+if ($help !~ /--mpi/) { print "ok (no MPI support)\n"; exit 0; }
+$threaded = ($help =~ /--cpu/) ? 1 : 0;
+$serial   = $threaded ? "--cpu 0" : "";
+
+$mpirun = $ENV{"MPIRUN"};
+if (! defined $mpirun || $mpirun eq "")
+{
+    foreach $launcher ("mpirun", "mpiexec")
+    {
+        `which $launcher 2>/dev/null`;
+        if ($? == 0) { $mpirun = $launcher; last; }
+    }
+}
+if (! defined $mpirun || $mpirun eq "") { print "ok (no mpirun)\n"; exit 0; }
+
+@planted = &read_fasta($seqfile);
+if ($#planted < 0) { die "FAIL: no sequences in $seqfile\n"; }
+
+srand(42);
+open(DB, ">$tmppfx.fa") || die "FAIL: couldn't write $tmppfx.fa\n";
+for ($t = 0; $t < $ntarget; $t++)
+{
+    $seq = "";
+    for ($x = 0; $x < $tlen; $x++) { $seq .= ("A","C","G","T")[int(rand(4))]; }
+    for ($j = 0; $j <= $#ppos; $j++)
+    {
+        $p = $planted[($t * ($#ppos+1) + $j) % ($#planted+1)];
+        substr($seq, $ppos[$j]-1, length($p)) = $p;
+    }
+    print DB ">mpi", $t+1, "\n";
+    for ($x = 0; $x < $tlen; $x += 60) { print DB substr($seq, $x, 60), "\n"; }
+}
+close DB;
+
+`$bathsearch $serial -o $tmppfx.serial.out --tblout $tmppfx.serial.tbl $hmmfile $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: serial bathsearch failed\n"; }
+`$mpirun -np 3 $bathsearch --mpi $serial -o $tmppfx.mpi.out --tblout $tmppfx.mpi.tbl $hmmfile $tmppfx.fa 2>&1`;
+if ($? != 0) { die "FAIL: bathsearch --mpi failed\n"; }
+
+@shits = &read_hits("$tmppfx.serial.tbl");
+@mhits = &read_hits("$tmppfx.mpi.tbl");
+if ($#shits < $ntarget * ($#ppos+1) - 1) { die "FAIL: serial search found only " . ($#shits+1) . " hits\n"; }
+if ($#shits != $#mhits)                  { die "FAIL: serial search found " . ($#shits+1) . " hits, --mpi found " . ($#mhits+1) . "\n"; }
+for ($i = 0; $i <= $#shits; $i++)
+{
+    if ($shits[$i] ne $mhits[$i]) { die "FAIL: serial and --mpi hits differ:\n  $shits[$i]\n  $mhits[$i]\n"; }
+}
+
+$sres = &residues_searched("$tmppfx.serial.out");
+$mres = &residues_searched("$tmppfx.mpi.out");
+if ($sres != $mres) { die "FAIL: serial search searched $sres residues, --mpi $mres\n"; }
+
+print "ok\n";
+unlink "$tmppfx.fa";
+unlink "$tmppfx.serial.out";
+unlink "$tmppfx.serial.tbl";
+unlink "$tmppfx.mpi.out";
+unlink "$tmppfx.mpi.tbl";
+exit 0;
+
+
+# Sequences of a FASTA file, in order, upper case.
+sub read_fasta
+{
+    my ($fafile) = @_;
+    my @seqs;
+    my $n = -1;
+
+    open(FA, $fafile) || die "FAIL: couldn't open $fafile\n";
+    while (<FA>)
+    {
+        chomp;
+        if (/^>/) { $n++; $seqs[$n] = ""; next; }
+        s/\s//g;
+        $seqs[$n] .= uc($_);
+    }
+    close FA;
+    return @seqs;
+}
+
+# The hit lines of a --tblout file, whitespace-normalized and sorted.
+sub read_hits
+{
+    my ($tblfile) = @_;
+    my @hits;
+
+    open(TBL, $tblfile) || die "FAIL: couldn't open $tblfile\n";
+    while (<TBL>)
+    {
+        next if /^\#/;
+        push @hits, join(" ", split);
+    }
+    close TBL;
+    return sort @hits;
+}
+
+# The residue count from the pipeline statistics of an -o file.
+sub residues_searched
+{
+    my ($outfile) = @_;
+    my $nres = -1;
+
+    open(OUT, $outfile) || die "FAIL: couldn't open $outfile\n";
+    while (<OUT>) { if (/\((\d+) residues searched\)/) { $nres = $1; } }
+    close OUT;
+    if ($nres < 0) { die "FAIL: no residue count in $outfile\n"; }
+    return $nres;
+}